@@ -76,13 +76,12 @@ bool SkyBoxTextureCube::createSkyBox()
         #include "geometry/cube_position.txt"
     };
 
-    // Add 6 textures to the sky box
-    if (!m_skybox.textureCube("skybox").load<SOIL>(GLTextureCube::Map::POSITIVE_X, "external/assets/right.jpg")) return false;
-    if (!m_skybox.textureCube("skybox").load<SOIL>(GLTextureCube::Map::NEGATIVE_X, "external/assets/left.jpg")) return false;
-    if (!m_skybox.textureCube("skybox").load<SOIL>(GLTextureCube::Map::POSITIVE_Y, "external/assets/top.jpg")) return false;
-    if (!m_skybox.textureCube("skybox").load<SOIL>(GLTextureCube::Map::NEGATIVE_Y, "external/assets/bottom.jpg")) return false;
-    if (!m_skybox.textureCube("skybox").load<SOIL>(GLTextureCube::Map::POSITIVE_Z, "external/assets/front.jpg")) return false;
-    if (!m_skybox.textureCube("skybox").load<SOIL>(GLTextureCube::Map::NEGATIVE_Z, "external/assets/back.jpg")) return false;
+    // Add 6 textures to the sky box (decoded concurrently)
+    if (!m_skybox.textureCube("skybox").load<SOIL>({
+                "external/assets/right.jpg", "external/assets/left.jpg",
+                "external/assets/top.jpg", "external/assets/bottom.jpg",
+                "external/assets/front.jpg", "external/assets/back.jpg" }))
+        return false;
 
     return true;
 }
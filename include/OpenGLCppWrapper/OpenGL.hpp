@@ -22,6 +22,8 @@
 #  define OPENGLCPPWRAPPER_INCLUDE_OPENGL_HPP
 
 #  include "OpenGL/Shaders/Program.hpp"
+#  include "OpenGL/Shaders/CompileQueue.hpp"
+#  include "OpenGL/Textures/TextureLoadQueue.hpp"
 #  include "OpenGL/Buffers/FrameBuffers.hpp"
 
 #endif // OPENGLCPPWRAPPER_INCLUDE_OPENGL_HPP
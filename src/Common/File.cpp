@@ -21,6 +21,9 @@
 #include "File.hpp"
 #include <fstream>
 #include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <vector>
 
 //------------------------------------------------------------------
 //! \param filename the file path to read.
@@ -61,3 +64,48 @@ bool File::readAllFile(std::string const& filename, std::string& buffer)
 
   return res;
 }
+
+//------------------------------------------------------------------
+//! \param path the file path to normalize.
+//! \return the canonical form of the path.
+//------------------------------------------------------------------
+std::string File::normalize(std::string const& path)
+{
+  char resolved[PATH_MAX];
+  if (realpath(path.c_str(), resolved) != nullptr)
+    return resolved;
+
+  // The file does not exist: lexical normalization
+  bool const absolute = (!path.empty()) && (path[0] == '/');
+  std::vector<std::string> parts;
+  std::string::size_type start = 0u;
+  while (start <= path.size())
+    {
+      std::string::size_type end = path.find('/', start);
+      if (end == std::string::npos)
+        end = path.size();
+      std::string const part = path.substr(start, end - start);
+      start = end + 1u;
+
+      if ((part.empty()) || (part == "."))
+        continue;
+      if (part == "..")
+        {
+          if ((!parts.empty()) && (parts.back() != ".."))
+            parts.pop_back();
+          else if (!absolute)
+            parts.push_back(part);
+          continue;
+        }
+      parts.push_back(part);
+    }
+
+  std::string res(absolute ? "/" : "");
+  for (size_t i = 0u; i < parts.size(); ++i)
+    {
+      if (i != 0u)
+        res += '/';
+      res += parts[i];
+    }
+  return res.empty() ? "." : res;
+}
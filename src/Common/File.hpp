@@ -154,6 +154,14 @@ public:
     return "";
   }
 
+  //------------------------------------------------------------------
+  //! \brief Return a canonical form of the path, so that different
+  //! spellings of the same file compare equal. The real path is
+  //! returned if the file exists (symbolic links resolved, absolute
+  //! path), else "//", "./" and "dir/.." are removed from the path.
+  //------------------------------------------------------------------
+  static std::string normalize(std::string const& path);
+
   //------------------------------------------------------------------
   //! \brief Generate the name of a temporary file or directory.
   //! The name is made with the current date. There is no garanty that
@@ -0,0 +1,85 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "MappedFile.hpp"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+//------------------------------------------------------------------
+//! \param filename the file path to map.
+//! \return true if success, else false.
+//------------------------------------------------------------------
+bool MappedFile::open(std::string const& filename)
+{
+  close();
+  m_error.clear();
+
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    {
+      m_error = ::strerror(errno);
+      return false;
+    }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0)
+    {
+      m_error = ::strerror(errno);
+    }
+  else if (st.st_size <= 0)
+    {
+      m_error = "Empty file";
+    }
+  else
+    {
+      size_t const size = static_cast<size_t>(st.st_size);
+      void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data == MAP_FAILED)
+        {
+          m_error = ::strerror(errno);
+        }
+      else
+        {
+          // Files are decoded from the beginning to the end
+          madvise(data, size, MADV_SEQUENTIAL);
+          m_data = static_cast<const unsigned char*>(data);
+          m_size = size;
+        }
+    }
+
+  // The mapping holds its own reference on the file
+  ::close(fd);
+  return m_data != nullptr;
+}
+
+//------------------------------------------------------------------
+void MappedFile::close()
+{
+  if (m_data != nullptr)
+    {
+      munmap(const_cast<unsigned char*>(m_data), m_size);
+      m_data = nullptr;
+      m_size = 0u;
+    }
+}
@@ -0,0 +1,112 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#ifndef MAPPED_FILE_HPP_
+#  define MAPPED_FILE_HPP_
+
+#  include "Common/NonCppStd.hpp"
+#  include <string>
+
+// **************************************************************
+//! \brief Read-only view of a whole file mapped in memory.
+//!
+//! Contrary to File::readAllFile() the content is not copied into
+//! a heap buffer: pages are read by the kernel when accessed and
+//! are not counted twice in the memory of the process. Decoders
+//! shall therefore read files through this class and write texels
+//! directly into their destination.
+// **************************************************************
+class MappedFile: private NonCopyable
+{
+public:
+
+  //------------------------------------------------------------------
+  //! \brief Empty constructor: no file is mapped.
+  //------------------------------------------------------------------
+  MappedFile() = default;
+
+  //------------------------------------------------------------------
+  //! \brief Map the given file. Check isOpen() for the result.
+  //------------------------------------------------------------------
+  explicit MappedFile(std::string const& filename)
+  {
+    open(filename);
+  }
+
+  //------------------------------------------------------------------
+  //! \brief Unmap the file.
+  //------------------------------------------------------------------
+  ~MappedFile()
+  {
+    close();
+  }
+
+  //------------------------------------------------------------------
+  //! \brief Map the whole file (after unmapping the previous one).
+  //! \return false if the file cannot be opened, is empty or cannot
+  //! be mapped. The reason is given by strerror().
+  //------------------------------------------------------------------
+  bool open(std::string const& filename);
+
+  //------------------------------------------------------------------
+  //! \brief Unmap the file.
+  //------------------------------------------------------------------
+  void close();
+
+  //------------------------------------------------------------------
+  //! \brief Return true if a file is mapped.
+  //------------------------------------------------------------------
+  inline bool isOpen() const
+  {
+    return m_data != nullptr;
+  }
+
+  //------------------------------------------------------------------
+  //! \brief Return the address of the first byte of the file.
+  //------------------------------------------------------------------
+  inline const unsigned char* data() const
+  {
+    return m_data;
+  }
+
+  //------------------------------------------------------------------
+  //! \brief Return the number of bytes of the file.
+  //------------------------------------------------------------------
+  inline size_t size() const
+  {
+    return m_size;
+  }
+
+  //------------------------------------------------------------------
+  //! \brief Return the reason of the last failure of open().
+  //------------------------------------------------------------------
+  inline std::string const& strerror() const
+  {
+    return m_error;
+  }
+
+private:
+
+  const unsigned char* m_data = nullptr;
+  size_t m_size = 0u;
+  std::string m_error;
+};
+
+#endif /* MAPPED_FILE_HPP_ */
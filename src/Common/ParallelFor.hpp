@@ -0,0 +1,73 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#ifndef OPENGLCPPWRAPPER_PARALLEL_FOR_HPP
+#  define OPENGLCPPWRAPPER_PARALLEL_FOR_HPP
+
+#  include <algorithm>
+#  include <atomic>
+#  include <functional>
+#  include <thread>
+#  include <vector>
+
+//------------------------------------------------------------------------------
+//! \brief Call job(i) for each i in [0, count) on a pool of threads and wait
+//! for all calls. Indices are taken by threads in increasing order as soon as
+//! they are free, so jobs of different durations are balanced. The calling
+//! thread is part of the pool.
+//!
+//! \param count the number of jobs.
+//! \param threads the maximum number of threads. If 0 then the number of
+//! hardware threads is used. If 1 then jobs are called in order by the calling
+//! thread.
+//! \param job the function to call. Shall not throw and shall be safe to call
+//! from several threads for different indices.
+//------------------------------------------------------------------------------
+inline void parallelFor(size_t const count, size_t threads,
+                        std::function<void(size_t)> const& job)
+{
+    if (threads == 0u)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, count);
+
+    if (threads <= 1u)
+    {
+        for (size_t i = 0u; i < count; ++i)
+            job(i);
+        return ;
+    }
+
+    std::atomic<size_t> next{0u};
+    auto work = [&]()
+    {
+        for (size_t i = next++; i < count; i = next++)
+            job(i);
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1u);
+    for (size_t t = 1u; t < threads; ++t)
+        workers.emplace_back(work);
+    work();
+    for (auto& worker: workers)
+        worker.join();
+}
+
+#endif // OPENGLCPPWRAPPER_PARALLEL_FOR_HPP
@@ -0,0 +1,227 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#ifndef OPENGLCPPWRAPPER_PENDING_BOXES_HPP
+#  define OPENGLCPPWRAPPER_PENDING_BOXES_HPP
+
+#  include <algorithm>
+#  include <vector>
+#  include <cstddef>
+
+// *****************************************************************************
+//! \brief Class tracking the regions of a 2D or 3D container (ie texture) that
+//! have been modified (aka dirty). Contrary to Pending, which tracks a single
+//! linear range of elements, regions are kept as a list of boxes (rectangles
+//! when the depth is 1) so that painting two distant texels of a texture does
+//! not tag all rows between them as dirty.
+//!
+//! Boxes are kept disjoint: a new box overlapping existing ones is merged with
+//! them into their bounding box. Boxes whose bounding box does not hold more
+//! elements than themselves (ie adjacent texels of a row) are merged too. To
+//! limit the number of transfers to the GPU, when the maximum number of boxes
+//! is reached the new box is merged with the box whose bounding box grows the
+//! least.
+//!
+//! Example: painting texels (1,1), (2,1) and (6,4) of a texture gives two
+//! boxes: {x=1, y=1, width=2, height=1} and {x=6, y=4, width=1, height=1}.
+// *****************************************************************************
+class PendingBoxes
+{
+public:
+
+    // *************************************************************************
+    //! \brief A box of dirty elements.
+    // *************************************************************************
+    struct Box
+    {
+        size_t x = 0u;
+        size_t y = 0u;
+        size_t z = 0u;
+        size_t width = 0u;
+        size_t height = 0u;
+        size_t depth = 0u;
+
+        //! \brief Number of elements inside the box.
+        inline size_t volume() const
+        {
+            return width * height * depth;
+        }
+
+        //! \brief Do the two boxes share at least one element ?
+        inline bool overlaps(Box const& other) const
+        {
+            return (x < other.x + other.width) && (other.x < x + width) &&
+                   (y < other.y + other.height) && (other.y < y + height) &&
+                   (z < other.z + other.depth) && (other.z < z + depth);
+        }
+
+        //! \brief Does the box hold the given element ?
+        inline bool contains(size_t const i, size_t const j, size_t const k = 0u) const
+        {
+            return (i >= x) && (i < x + width) &&
+                   (j >= y) && (j < y + height) &&
+                   (k >= z) && (k < z + depth);
+        }
+
+        //! \brief Return the smallest box holding the two boxes.
+        Box merge(Box const& other) const
+        {
+            Box res;
+            res.x = std::min(x, other.x);
+            res.y = std::min(y, other.y);
+            res.z = std::min(z, other.z);
+            res.width = std::max(x + width, other.x + other.width) - res.x;
+            res.height = std::max(y + height, other.y + other.height) - res.y;
+            res.depth = std::max(z + depth, other.z + other.depth) - res.z;
+            return res;
+        }
+
+        inline bool operator==(Box const& other) const
+        {
+            return (x == other.x) && (y == other.y) && (z == other.z) &&
+                   (width == other.width) && (height == other.height) &&
+                   (depth == other.depth);
+        }
+    };
+
+    //--------------------------------------------------------------------------
+    //! \brief Default maximum number of boxes.
+    //--------------------------------------------------------------------------
+    static constexpr size_t MAX_BOXES = 16u;
+
+    //--------------------------------------------------------------------------
+    //! \brief Constructor with no dirty elements.
+    //! \param max_boxes maximum number of boxes. Shall be > 0.
+    //--------------------------------------------------------------------------
+    PendingBoxes(size_t const max_boxes = MAX_BOXES)
+        : m_max_boxes(std::max(size_t(1u), max_boxes))
+    {
+        m_boxes.reserve(m_max_boxes);
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return a boolean indicating if at least one element is dirty.
+    //--------------------------------------------------------------------------
+    inline bool isPending() const
+    {
+        return !m_boxes.empty();
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the disjoint boxes holding all dirty elements.
+    //--------------------------------------------------------------------------
+    inline std::vector<Box> const& getPending() const
+    {
+        return m_boxes;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Call this when dirty elements have been updated.
+    //--------------------------------------------------------------------------
+    inline void clearPending()
+    {
+        m_boxes.clear();
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Tag a single element as dirty.
+    //--------------------------------------------------------------------------
+    inline void setPending(size_t const x, size_t const y, size_t const z = 0u)
+    {
+        setPending(x, y, z, 1u, 1u, 1u);
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Tag a box of elements as dirty. Empty boxes are ignored.
+    //--------------------------------------------------------------------------
+    void setPending(size_t const x, size_t const y, size_t const z,
+                    size_t const width, size_t const height, size_t const depth)
+    {
+        if ((width == 0u) || (height == 0u) || (depth == 0u))
+            return ;
+
+        Box box;
+        box.x = x; box.y = y; box.z = z;
+        box.width = width; box.height = height; box.depth = depth;
+
+        // Merge with boxes overlapping the new box or with boxes whose union
+        // with it is exact. The merged box may reach other boxes: loop.
+        auto it = m_boxes.begin();
+        while (it != m_boxes.end())
+        {
+            Box merged = box.merge(*it);
+            if (box.overlaps(*it) || (merged.volume() <= box.volume() + it->volume()))
+            {
+                box = merged;
+                m_boxes.erase(it);
+                it = m_boxes.begin();
+            }
+            else
+            {
+                ++it;
+            }
+        }
+
+        // Too many boxes: merge with the box wasting the least elements. The
+        // bounding box may overlap other boxes.
+        while (m_boxes.size() >= m_max_boxes)
+        {
+            auto best = m_boxes.begin();
+            size_t best_waste = static_cast<size_t>(-1);
+            for (auto i = m_boxes.begin(); i != m_boxes.end(); ++i)
+            {
+                size_t waste = box.merge(*i).volume() - box.volume() - i->volume();
+                if (waste < best_waste)
+                {
+                    best_waste = waste;
+                    best = i;
+                }
+            }
+
+            box = box.merge(*best);
+            m_boxes.erase(best);
+            it = m_boxes.begin();
+            while (it != m_boxes.end())
+            {
+                if (box.overlaps(*it))
+                {
+                    box = box.merge(*it);
+                    m_boxes.erase(it);
+                    it = m_boxes.begin();
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+        }
+
+        m_boxes.push_back(box);
+    }
+
+private:
+
+    //! \brief Disjoint boxes of dirty elements.
+    std::vector<Box> m_boxes;
+    //! \brief Maximum number of boxes.
+    size_t m_max_boxes;
+};
+
+#endif // OPENGLCPPWRAPPER_PENDING_BOXES_HPP
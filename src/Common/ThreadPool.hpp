@@ -0,0 +1,164 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#ifndef OPENGLCPPWRAPPER_THREAD_POOL_HPP
+#  define OPENGLCPPWRAPPER_THREAD_POOL_HPP
+
+#  include "Common/NonCppStd.hpp"
+#  include <condition_variable>
+#  include <functional>
+#  include <mutex>
+#  include <thread>
+#  include <vector>
+
+// *****************************************************************************
+//! \brief Threads kept alive between calls of run() for splitting short jobs
+//! (ie resizing a mipmap level each frame) without paying the creation of
+//! threads at each call. Workers are created when a call needs them and are
+//! joined when the program exits.
+//!
+//! \code
+//!   ThreadPool::instance().run(4u, [&](size_t const i) { ... });
+//! \endcode
+// *****************************************************************************
+class ThreadPool : private NonCopyable
+{
+public:
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the pool shared by the process.
+    //--------------------------------------------------------------------------
+    static ThreadPool& instance()
+    {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Join the worker threads.
+    //--------------------------------------------------------------------------
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        for (auto& it: m_workers)
+            it.join();
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Call job(i) for each i in [0 .. count[ and wait for all calls.
+    //! The calling thread calls job(0) and workers the other ones. When the
+    //! pool is already running jobs for another caller (or for a job calling
+    //! run()), jobs are called in order by the calling thread instead of
+    //! waiting for the pool.
+    //!
+    //! \param job the function to call. Shall not throw and shall be safe to
+    //! call from several threads for different indices.
+    //--------------------------------------------------------------------------
+    void run(size_t const count, std::function<void(size_t)> const& job)
+    {
+        std::unique_lock<std::mutex> busy(m_busy, std::try_to_lock);
+        if ((count <= 1u) || !busy.owns_lock())
+        {
+            for (size_t i = 0u; i < count; ++i)
+                job(i);
+            return ;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            while (m_workers.size() + 1u < count)
+                m_workers.emplace_back(&ThreadPool::work, this);
+            m_job = &job;
+            m_next = 1u;
+            m_count = count;
+            m_pending = count - 1u;
+        }
+        m_wake.notify_all();
+
+        job(0u);
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this] { return m_pending == 0u; });
+        m_job = nullptr;
+        m_count = 0u;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of worker threads created so far.
+    //--------------------------------------------------------------------------
+    size_t workers() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_workers.size();
+    }
+
+private:
+
+    ThreadPool() = default;
+
+    //--------------------------------------------------------------------------
+    //! \brief Loop of worker threads: call jobs of the current run().
+    //--------------------------------------------------------------------------
+    void work()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true)
+        {
+            m_wake.wait(lock, [this] { return m_stop || (m_next < m_count); });
+            if (m_stop)
+                return ;
+
+            size_t const i = m_next++;
+            std::function<void(size_t)> const& job = *m_job;
+            lock.unlock();
+            job(i);
+            lock.lock();
+            if (--m_pending == 0u)
+                m_done.notify_one();
+        }
+    }
+
+private:
+
+    //! \brief Held by the caller of run() during the call.
+    std::mutex m_busy;
+    //! \brief Protect members below.
+    mutable std::mutex m_mutex;
+    //! \brief Wake up workers when jobs are given or when stopping.
+    std::condition_variable m_wake;
+    //! \brief Wake up the caller of run() when all jobs are done.
+    std::condition_variable m_done;
+    //! \brief Job of the current run().
+    std::function<void(size_t)> const* m_job = nullptr;
+    //! \brief Next index to call and number of indices of the current run().
+    size_t m_next = 0u;
+    size_t m_count = 0u;
+    //! \brief Number of indices not yet done by workers.
+    size_t m_pending = 0u;
+    //! \brief Ask workers to return.
+    bool m_stop = false;
+    std::vector<std::thread> m_workers;
+};
+
+#endif // OPENGLCPPWRAPPER_THREAD_POOL_HPP
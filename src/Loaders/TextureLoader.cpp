@@ -0,0 +1,205 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "Loaders/TextureLoader.hpp"
+#include <algorithm>
+#include <iostream>
+
+//------------------------------------------------------------------------------
+//! \brief Number of texels converted at once: converted texels stay in the
+//! cache between the kernels.
+//------------------------------------------------------------------------------
+static constexpr size_t CHUNK = 1024u;
+
+//------------------------------------------------------------------------------
+//! \brief Return the name of each channel of the format ("" if channels cannot
+//! be reordered).
+//------------------------------------------------------------------------------
+static const char* channelNames(GLTexture::PixelFormat const format)
+{
+    switch (format)
+    {
+    case GLTexture::PixelFormat::RGBA:
+        return "RGBA";
+    case GLTexture::PixelFormat::BGRA:
+        return "BGRA";
+    case GLTexture::PixelFormat::RGB:
+        return "RGB";
+    case GLTexture::PixelFormat::BGR:
+        return "BGR";
+    default:
+        return "";
+    }
+}
+
+//------------------------------------------------------------------------------
+//! \brief Return the number of channels of the format.
+//------------------------------------------------------------------------------
+static size_t channelCount(GLTexture::PixelFormat const format)
+{
+    switch (format)
+    {
+    case GLTexture::PixelFormat::RGBA:
+    case GLTexture::PixelFormat::BGRA:
+        return 4u;
+    case GLTexture::PixelFormat::RGB:
+    case GLTexture::PixelFormat::BGR:
+        return 3u;
+    case GLTexture::PixelFormat::LUMINANCE_ALPHA:
+    case GLTexture::PixelFormat::RG:
+    case GLTexture::PixelFormat::DEPTH_STENCIL:
+        return 2u;
+    default:
+        return 1u;
+    }
+}
+
+//------------------------------------------------------------------------------
+bool TextureLoader::configure(GLTexture::PixelFormat const pixelformat,
+                              GLenum const type, bool const premultiplied)
+{
+    m_channels = channelCount(pixelformat);
+    m_type = type;
+    m_premultiplied = premultiplied;
+    m_reorder = false;
+    m_convert = false;
+
+    if (setPixelFormat(pixelformat))
+    {
+        m_channels = getPixelCount();
+    }
+    else
+    {
+        // Decode texels with the same colors then reorder them: first the
+        // format with the same number of channels.
+        std::string const names(channelNames(pixelformat));
+        if (names.empty())
+            return false;
+
+        GLTexture::PixelFormat const candidates[] = {
+            (names.size() == 4u) ? GLTexture::PixelFormat::RGBA : GLTexture::PixelFormat::RGB,
+            (names.size() == 4u) ? GLTexture::PixelFormat::RGB : GLTexture::PixelFormat::RGBA,
+        };
+        GLTexture::PixelFormat const* decoded =
+                std::find_if(std::begin(candidates), std::end(candidates),
+                             [&](GLTexture::PixelFormat const candidate)
+                             {
+                                 return (candidate != pixelformat) && setPixelFormat(candidate);
+                             });
+        if (decoded == std::end(candidates))
+            return false;
+
+        std::string const from(channelNames(*decoded));
+        for (size_t i = 0u; i < names.size(); ++i)
+        {
+            size_t const c = from.find(names[i]);
+            m_swizzle[i] = (c != std::string::npos) ? uint8_t(c)
+                         : ((names[i] == 'A') ? pixel::ONE : pixel::ZERO);
+        }
+        m_reorder = true;
+    }
+    m_decodedChannels = getPixelCount();
+
+    if ((type == getPixelType()) && !m_reorder && !premultiplied)
+        return true;
+
+    // Kernels only convert texels decoded as bytes
+    if ((getPixelType() != GL_UNSIGNED_BYTE) ||
+        ((type != GL_UNSIGNED_BYTE) && (type != GL_HALF_FLOAT) && (type != GL_FLOAT)))
+    {
+        m_error = "Texels cannot be converted into the pixel type of the texture";
+        return false;
+    }
+
+    m_convert = true;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool TextureLoader::decode(std::string const& filename, GLTexture::Buffer& buffer,
+                           size_t& width, size_t& height)
+{
+    if (!m_convert)
+        return load(filename, buffer, width, height);
+
+    // Loaders keeping compressed blocks always return a layout: reject them
+    // before the buffer is touched.
+    if (compression() != nullptr)
+    {
+        m_error = "Block-compressed texels cannot be converted";
+        return false;
+    }
+
+    // Premultiply bytes in place
+    if ((!m_reorder) && (m_type == GL_UNSIGNED_BYTE))
+    {
+        size_t const start = buffer.size();
+        if (!load(filename, buffer, width, height))
+            return false;
+        pixel::premultiply(buffer.to_array() + start, m_channels,
+                           (buffer.size() - start) / m_channels);
+        return true;
+    }
+
+    m_decoded.reset();
+    if (!load(filename, m_decoded, width, height))
+        return false;
+
+    size_t const count = m_decoded.size() / m_decodedChannels;
+    size_t const bytes = (m_type == GL_FLOAT) ? 4u : ((m_type == GL_HALF_FLOAT) ? 2u : 1u);
+    unsigned char* texels = buffer.extend(count * m_channels * bytes);
+    const unsigned char* src = m_decoded.to_array();
+
+    uint8_t reordered[CHUNK * 4u];
+    float floats[CHUNK * 4u];
+    for (size_t first = 0u; first < count; first += CHUNK)
+    {
+        size_t const n = std::min(CHUNK, count - first);
+        size_t const offset = first * m_channels;
+        const uint8_t* chunk = src + first * m_decodedChannels;
+
+        if (m_type == GL_UNSIGNED_BYTE)
+        {
+            pixel::swizzle(chunk, m_decodedChannels, texels + offset,
+                           m_channels, m_swizzle, n);
+            if (m_premultiplied)
+                pixel::premultiply(texels + offset, m_channels, n);
+            continue;
+        }
+
+        if (m_reorder)
+        {
+            pixel::swizzle(chunk, m_decodedChannels, reordered, m_channels, m_swizzle, n);
+            chunk = reordered;
+        }
+
+        // Color channels of picture files are sRGB
+        float* linear = (m_type == GL_FLOAT)
+                        ? reinterpret_cast<float*>(texels) + offset : floats;
+        pixel::srgbToLinear(chunk, linear, m_channels, n);
+        if (m_premultiplied)
+            pixel::premultiply(linear, m_channels, n);
+        if (m_type == GL_HALF_FLOAT)
+            pixel::toHalf(linear, reinterpret_cast<uint16_t*>(texels) + offset, n * m_channels);
+    }
+
+    m_decoded.reset();
+    return true;
+}
@@ -22,11 +22,18 @@
 #  define TEXTURES_LOADER_HPP
 
 #  include "OpenGL/Textures/Texture.hpp"
+#  include "OpenGL/Textures/PixelKernels.hpp"
 
 // ***************************************************************************
 //! \brief Interface class for loading and saving 2D texture from picture file
 //! (jpeg, bmp, png ...). The derived class shall implement concretly these
 //! method using for example an external library (SOIL ...)
+//!
+//! Loaders decode texels into the few pixel formats of their library. Textures
+//! call configure() and decode() instead of setPixelFormat() and load(): when
+//! the texture wants another channel order, other channels, half floats,
+//! floats or premultiplied alpha, texels are decoded into a scratch buffer and
+//! converted by the kernels of PixelKernels.hpp.
 // ***************************************************************************
 class TextureLoader
 {
@@ -92,6 +99,47 @@ public:
     virtual bool save(std::string const& filename, GLTexture::Buffer const& buffer,
                       size_t const width, size_t const height) = 0;
 
+    //--------------------------------------------------------------------------
+    //! \brief Return the layout of block-compressed texels that the last call
+    //! to load() has stored in the buffer, or nullptr if texels have been
+    //! decompressed (default).
+    //--------------------------------------------------------------------------
+    virtual GLTexture::Compression const* compression() const
+    {
+        return nullptr;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Configure the loader for texels of the given texture format. Use
+    //! setPixelFormat() when the loader decodes the format, else a format with
+    //! the same color channels (ie RGB for BGRA) whose texels are swizzled.
+    //! 8-bits texels are converted to the type (sRGB decoded to linear for
+    //! GL_HALF_FLOAT and GL_FLOAT) and premultiplied if asked.
+    //!
+    //! \param[in] pixelformat the CPU pixel format of the texture.
+    //! \param[in] type the CPU pixel type of the texture: GL_UNSIGNED_BYTE,
+    //! GL_HALF_FLOAT, GL_FLOAT or the type returned by getPixelType().
+    //! \param[in] premultiplied multiply color channels by alpha.
+    //! \return false if texels cannot be converted into this format.
+    //--------------------------------------------------------------------------
+    bool configure(GLTexture::PixelFormat const pixelformat, GLenum const type,
+                   bool const premultiplied = false);
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of channels of texels returned by decode().
+    //--------------------------------------------------------------------------
+    inline size_t channels() const
+    {
+        return m_channels;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Call load() and convert texels into the format given to
+    //! configure(). Same parameters than load().
+    //--------------------------------------------------------------------------
+    bool decode(std::string const& filename, GLTexture::Buffer& buffer,
+                size_t& width, size_t& height);
+
     //--------------------------------------------------------------------------
     //! \brief Return the last errorr (if occured).
     //--------------------------------------------------------------------------
@@ -104,6 +152,20 @@ protected:
 
     //! \brief Store the current error.
     std::string m_error;
+
+private:
+
+    //! \brief Texels decoded before their conversion.
+    GLTexture::Buffer m_decoded;
+    //! \brief Channels of decoded texels and of converted texels.
+    size_t m_decodedChannels = 4u;
+    size_t m_channels = 4u;
+    //! \brief Conversion made by decode().
+    pixel::Swizzle m_swizzle = {{ 0u, 1u, 2u, 3u }};
+    GLenum m_type = GL_UNSIGNED_BYTE;
+    bool m_reorder = false;
+    bool m_premultiplied = false;
+    bool m_convert = false;
 };
 
 #endif
@@ -0,0 +1,385 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "Loaders/Textures/CompressedLoader.hpp"
+#include "Common/MappedFile.hpp"
+#include <string.h>
+
+//! \brief Magic number of DDS files.
+static const unsigned char DDS_MAGIC[4] = { 'D', 'D', 'S', ' ' };
+//! \brief Magic number of KTX (version 1) files.
+static const unsigned char KTX_MAGIC[12] =
+{
+    0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
+};
+
+//! \brief Size of the magic number and of the header of DDS files.
+static constexpr size_t DDS_HEADER_SIZE = 128u;
+//! \brief Size of the optional DX10 header following the DDS header.
+static constexpr size_t DDS_DX10_HEADER_SIZE = 20u;
+//! \brief Size of the header of KTX files.
+static constexpr size_t KTX_HEADER_SIZE = 64u;
+
+// DDS flags
+static constexpr uint32_t DDSD_MIPMAPCOUNT = 0x20000u;
+static constexpr uint32_t DDPF_FOURCC = 0x4u;
+static constexpr uint32_t DDSCAPS2_CUBEMAP = 0x200u;
+static constexpr uint32_t DDSCAPS2_CUBEMAP_ALLFACES = 0xFC00u;
+static constexpr uint32_t DDSCAPS2_VOLUME = 0x200000u;
+static constexpr uint32_t DDS_RESOURCE_MISC_TEXTURECUBE = 0x4u;
+
+//------------------------------------------------------------------------------
+//! \brief Read a little-endian 32-bits integer.
+//------------------------------------------------------------------------------
+static inline uint32_t read32(const unsigned char* data)
+{
+    return uint32_t(data[0]) | (uint32_t(data[1]) << 8) |
+           (uint32_t(data[2]) << 16) | (uint32_t(data[3]) << 24);
+}
+
+//------------------------------------------------------------------------------
+//! \brief Make a four character code.
+//------------------------------------------------------------------------------
+static constexpr uint32_t fourCC(char const a, char const b, char const c, char const d)
+{
+    return uint32_t(a) | (uint32_t(b) << 8) | (uint32_t(c) << 16) | (uint32_t(d) << 24);
+}
+
+//------------------------------------------------------------------------------
+//! \brief Convert a DXGI format of DDS DX10 headers into an OpenGL compressed
+//! format. Return 0 if not managed.
+//------------------------------------------------------------------------------
+static GLenum DXGI2GLFormat(uint32_t const dxgi)
+{
+    switch (dxgi)
+    {
+    case 71u: return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;       // BC1_UNORM
+    case 72u: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT; // BC1_UNORM_SRGB
+    case 74u: return GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;       // BC2_UNORM
+    case 75u: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT; // BC2_UNORM_SRGB
+    case 77u: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;       // BC3_UNORM
+    case 78u: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT; // BC3_UNORM_SRGB
+    case 80u: return GL_COMPRESSED_RED_RGTC1;                // BC4_UNORM
+    case 81u: return GL_COMPRESSED_SIGNED_RED_RGTC1;         // BC4_SNORM
+    case 83u: return GL_COMPRESSED_RG_RGTC2;                 // BC5_UNORM
+    case 84u: return GL_COMPRESSED_SIGNED_RG_RGTC2;          // BC5_SNORM
+    case 95u: return GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT;  // BC6H_UF16
+    case 96u: return GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT;    // BC6H_SF16
+    case 98u: return GL_COMPRESSED_RGBA_BPTC_UNORM;          // BC7_UNORM
+    case 99u: return GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM;    // BC7_UNORM_SRGB
+    default: return 0u;
+    }
+}
+
+//------------------------------------------------------------------------------
+//! \brief Convert a four character code of DDS headers into an OpenGL
+//! compressed format. Return 0 if not managed.
+//------------------------------------------------------------------------------
+static GLenum FourCC2GLFormat(uint32_t const code)
+{
+    switch (code)
+    {
+    case fourCC('D', 'X', 'T', '1'): return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+    case fourCC('D', 'X', 'T', '3'): return GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+    case fourCC('D', 'X', 'T', '5'): return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case fourCC('A', 'T', 'I', '1'):
+    case fourCC('B', 'C', '4', 'U'): return GL_COMPRESSED_RED_RGTC1;
+    case fourCC('B', 'C', '4', 'S'): return GL_COMPRESSED_SIGNED_RED_RGTC1;
+    case fourCC('A', 'T', 'I', '2'):
+    case fourCC('B', 'C', '5', 'U'): return GL_COMPRESSED_RG_RGTC2;
+    case fourCC('B', 'C', '5', 'S'): return GL_COMPRESSED_SIGNED_RG_RGTC2;
+    default: return 0u;
+    }
+}
+
+//------------------------------------------------------------------------------
+size_t CompressedLoader::blockSize(GLenum const format)
+{
+    switch (format)
+    {
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RED_RGTC1:
+    case GL_COMPRESSED_SIGNED_RED_RGTC1:
+        return 8u;
+    case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+    case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+    case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+    case GL_COMPRESSED_RG_RGTC2:
+    case GL_COMPRESSED_SIGNED_RG_RGTC2:
+    case GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT:
+    case GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT:
+    case GL_COMPRESSED_RGBA_BPTC_UNORM:
+    case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+        return 16u;
+    default:
+        return 0u;
+    }
+}
+
+//------------------------------------------------------------------------------
+size_t CompressedLoader::levelSize(GLenum const format, size_t const width,
+                                   size_t const height)
+{
+    return std::max(size_t(1u), (width + 3u) / 4u) *
+           std::max(size_t(1u), (height + 3u) / 4u) *
+           blockSize(format);
+}
+
+//------------------------------------------------------------------------------
+bool CompressedLoader::setPixelFormat(GLTexture::PixelFormat const cpuformat)
+{
+    m_error.clear();
+
+    switch (cpuformat)
+    {
+    case GLTexture::PixelFormat::RGBA:
+        m_pixelCount = 4_z;
+        m_isValid = true;
+        break;
+    case GLTexture::PixelFormat::RGB:
+        m_pixelCount = 3_z;
+        m_isValid = true;
+        break;
+    default:
+        m_error = "CompressedLoader does not suport the given CPU pixel format";
+        std::cerr << m_error << std::endl;
+        m_isValid = false;
+        break;
+    }
+
+    return m_isValid;
+}
+
+//------------------------------------------------------------------------------
+bool CompressedLoader::parse(const unsigned char* data, size_t const size,
+                             size_t& width, size_t& height)
+{
+    m_error.clear();
+    m_compression = GLTexture::Compression();
+
+    if ((size >= sizeof(DDS_MAGIC)) && (0 == memcmp(data, DDS_MAGIC, sizeof(DDS_MAGIC))))
+        return parseDDS(data, size, width, height);
+    if ((size >= sizeof(KTX_MAGIC)) && (0 == memcmp(data, KTX_MAGIC, sizeof(KTX_MAGIC))))
+        return parseKTX(data, size, width, height);
+    return fail("Neither a DDS nor a KTX file");
+}
+
+//------------------------------------------------------------------------------
+bool CompressedLoader::parseDDS(const unsigned char* data, size_t const size,
+                                size_t& width, size_t& height)
+{
+    if ((size < DDS_HEADER_SIZE) || (read32(data + 4u) != 124u))
+        return fail("Truncated or invalid DDS header");
+
+    const uint32_t flags = read32(data + 8u);
+    const size_t h = read32(data + 12u);
+    const size_t w = read32(data + 16u);
+    const uint32_t pfflags = read32(data + 80u);
+    const uint32_t code = read32(data + 84u);
+    const uint32_t caps2 = read32(data + 112u);
+    size_t mipmaps = ((flags & DDSD_MIPMAPCOUNT) != 0u) ? read32(data + 28u) : 1u;
+    size_t offset = DDS_HEADER_SIZE;
+    bool cube = ((caps2 & DDSCAPS2_CUBEMAP) != 0u);
+
+    if ((pfflags & DDPF_FOURCC) == 0u)
+        return fail("Uncompressed DDS files are not managed");
+    if ((caps2 & DDSCAPS2_VOLUME) != 0u)
+        return fail("Volume DDS files are not managed");
+    if (cube && ((caps2 & DDSCAPS2_CUBEMAP_ALLFACES) != DDSCAPS2_CUBEMAP_ALLFACES))
+        return fail("Cube maps shall have 6 faces");
+
+    if (code == fourCC('D', 'X', '1', '0'))
+    {
+        if (size < DDS_HEADER_SIZE + DDS_DX10_HEADER_SIZE)
+            return fail("Truncated DX10 header");
+
+        m_compression.format = DXGI2GLFormat(read32(data + offset));
+        cube = ((read32(data + offset + 8u) & DDS_RESOURCE_MISC_TEXTURECUBE) != 0u);
+        if (read32(data + offset + 12u) > 1u)
+            return fail("DDS texture arrays are not managed");
+        offset += DDS_DX10_HEADER_SIZE;
+    }
+    else
+    {
+        m_compression.format = FourCC2GLFormat(code);
+    }
+
+    if (m_compression.format == 0u)
+        return fail("Compressed format not managed");
+    if ((w == 0u) || (h == 0u))
+        return fail("Invalid dimension");
+    mipmaps = std::max(size_t(1u), mipmaps);
+    if (mipmaps > image::levels(w, h))
+        return fail("Too many mipmap levels");
+
+    // Levels are stored face after face
+    m_compression.faces = cube ? 6u : 1u;
+    m_compression.levels.resize(m_compression.faces * mipmaps);
+    for (size_t face = 0u; face < m_compression.faces; ++face)
+    {
+        for (size_t level = 0u; level < mipmaps; ++level)
+        {
+            GLTexture::Compression::Level& it = m_compression.levels[face * mipmaps + level];
+            it.width = std::max(size_t(1u), w >> level);
+            it.height = std::max(size_t(1u), h >> level);
+            it.size = levelSize(m_compression.format, it.width, it.height);
+            it.offset = offset;
+            offset += it.size;
+        }
+    }
+
+    if (offset > size)
+        return fail("Truncated file");
+
+    width = w;
+    height = h;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool CompressedLoader::parseKTX(const unsigned char* data, size_t const size,
+                                size_t& width, size_t& height)
+{
+    if (size < KTX_HEADER_SIZE)
+        return fail("Truncated KTX header");
+    if (read32(data + 12u) != 0x04030201u)
+        return fail("Big endian KTX files are not managed");
+
+    const uint32_t type = read32(data + 16u);
+    const uint32_t format = read32(data + 24u);
+    const size_t w = read32(data + 36u);
+    const size_t h = read32(data + 40u);
+    const size_t depth = read32(data + 44u);
+    const size_t elements = read32(data + 48u);
+    const size_t faces = read32(data + 52u);
+    const size_t mipmaps = std::max(uint32_t(1u), read32(data + 56u));
+    size_t offset = KTX_HEADER_SIZE + read32(data + 60u);
+
+    if ((type != 0u) || (format != 0u))
+        return fail("Uncompressed KTX files are not managed");
+    m_compression.format = read32(data + 28u);
+    if (blockSize(m_compression.format) == 0u)
+        return fail("Compressed format not managed");
+    if ((depth > 1u) || (elements > 1u))
+        return fail("Volume KTX files and texture arrays are not managed");
+    if ((faces != 1u) && (faces != 6u))
+        return fail("Cube maps shall have 6 faces");
+    if ((w == 0u) || (h == 0u))
+        return fail("Invalid dimension");
+    if (mipmaps > image::levels(w, h))
+        return fail("Too many mipmap levels");
+
+    // Faces are stored level after level: reorder them face after face
+    m_compression.faces = faces;
+    m_compression.levels.resize(faces * mipmaps);
+    for (size_t level = 0u; level < mipmaps; ++level)
+    {
+        if (offset + 4u > size)
+            return fail("Truncated file");
+
+        const size_t bytes = read32(data + offset);
+        offset += 4u;
+        for (size_t face = 0u; face < faces; ++face)
+        {
+            GLTexture::Compression::Level& it = m_compression.levels[face * mipmaps + level];
+            it.width = std::max(size_t(1u), w >> level);
+            it.height = std::max(size_t(1u), h >> level);
+            it.size = levelSize(m_compression.format, it.width, it.height);
+            it.offset = offset;
+            if (it.size != bytes)
+                return fail("Invalid image size");
+
+            // Faces and levels are aligned on 4 bytes
+            offset += (it.size + 3u) & ~size_t(3u);
+        }
+    }
+
+    if (offset > size)
+        return fail("Truncated file");
+
+    width = w;
+    height = h;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool CompressedLoader::load(std::string const& filename, GLTexture::Buffer& buffer,
+                            size_t& width, size_t& height)
+{
+    if (unlikely(!m_isValid))
+    {
+        m_error = "Failed loading picture file '" + filename + "'. Reason was: '"
+                  + "the setPixelFormat() method previously return false "
+                  + "or you have never called it !'";
+        std::cerr << m_error << std::endl;
+        return false;
+    }
+
+    // Compressed blocks are copied from the mapped file straight into the
+    // texture buffer: no intermediate copy of the file on the heap.
+    MappedFile file;
+    size_t w, h;
+    if (!file.open(filename))
+    {
+        fail("File not found or empty");
+    }
+    else if (parse(file.data(), file.size(), w, h))
+    {
+        size_t bytes = 0u;
+        for (auto const& it: m_compression.levels)
+            bytes += it.size;
+
+        // Pack levels into the buffer and make their offset relative to it.
+        size_t offset = buffer.size();
+        unsigned char* storage = buffer.extend(bytes);
+        for (auto& it: m_compression.levels)
+        {
+            memcpy(storage, file.data() + it.offset, it.size);
+            storage += it.size;
+            it.offset = offset;
+            offset += it.size;
+        }
+
+        width = w;
+        height = h;
+        m_error.clear();
+        return true;
+    }
+
+    width = height = 0;
+    m_error = "Failed loading picture file '" + filename + "'. Reason was: '"
+              + m_error + "'";
+    std::cerr << m_error << std::endl;
+    return false;
+}
+
+//------------------------------------------------------------------------------
+bool CompressedLoader::save(std::string const& filename, GLTexture::Buffer const& /*buffer*/,
+                            size_t const /*width*/, size_t const /*height*/)
+{
+    m_error = "Failed saving picture file '" + filename + "'. Reason was: '"
+              + "saving compressed textures is not managed'";
+    std::cerr << m_error << std::endl;
+    return false;
+}
@@ -0,0 +1,144 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#ifndef OPENGLCPPWRAPPER_COMPRESSED_TEXTURES_LOADER_HPP
+#  define OPENGLCPPWRAPPER_COMPRESSED_TEXTURES_LOADER_HPP
+
+#  include "Loaders/TextureLoader.hpp"
+#  include <iostream>
+
+// *****************************************************************************
+//! \brief Load block-compressed textures (BC1 .. BC7) from DDS and KTX (version
+//! 1) files. Contrary to SOIL, texels are not decompressed: compressed blocks of
+//! all pre-baked mipmap levels (and of the 6 faces of cube maps) are stored
+//! into the texture buffer and are given as such to glCompressedTexImage2D().
+//! The texture buffer, and therefore GPUMemory(), holds the compressed size.
+//!
+//! Accepted formats:
+//!   - DDS: DXT1, DXT3, DXT5, ATI1, ATI2, BC4U, BC4S, BC5U, BC5S four character
+//!     codes and DX10 headers with BC1 .. BC7 DXGI formats.
+//!   - KTX: little-endian files with BC1 .. BC7 internal formats.
+//! Volume textures and texture arrays are not managed.
+// *****************************************************************************
+class CompressedLoader: public TextureLoader
+{
+public:
+
+    //--------------------------------------------------------------------------
+    //! \brief See documention from TextureLoader class. Texels keep the format
+    //! stored in the file: the pixel format only has to be one of:
+    //!   - GLTexture::PixelFormat::RGBA
+    //!   - GLTexture::PixelFormat::RGB
+    //--------------------------------------------------------------------------
+    virtual bool setPixelFormat(GLTexture::PixelFormat const cpuformat) override;
+
+    //--------------------------------------------------------------------------
+    //! \brief See documention from TextureLoader class.
+    //! Will always return GL_UNSIGNED_BYTE
+    //--------------------------------------------------------------------------
+    virtual GLenum getPixelType() const override
+    {
+        return GL_UNSIGNED_BYTE;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief See documention from TextureLoader class.
+    //--------------------------------------------------------------------------
+    virtual size_t getPixelCount() const override
+    {
+        return m_pixelCount;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief See documention from TextureLoader class. Compressed blocks of
+    //! all levels are appended to the buffer.
+    //--------------------------------------------------------------------------
+    virtual bool load(std::string const& filename, GLTexture::Buffer& buffer,
+                      size_t& width, size_t& height) override;
+
+    //--------------------------------------------------------------------------
+    //! \brief Saving compressed textures is not managed: return false.
+    //--------------------------------------------------------------------------
+    virtual bool save(std::string const& filename, GLTexture::Buffer const& buffer,
+                      size_t const width, size_t const height) override;
+
+    //--------------------------------------------------------------------------
+    //! \brief See documention from TextureLoader class.
+    //--------------------------------------------------------------------------
+    virtual GLTexture::Compression const* compression() const override
+    {
+        return &m_compression;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Parse a DDS or KTX file held in memory. On success, compression()
+    //! returns the layout of levels with offsets relative to the beginning of
+    //! the file.
+    //!
+    //! \return false if the file is not managed or truncated. The error message
+    //! can be get through the method error().
+    //--------------------------------------------------------------------------
+    bool parse(const unsigned char* data, size_t const size,
+               size_t& width, size_t& height);
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of bytes of a 4x4 block of the compressed
+    //! format or 0 if the format is not managed.
+    //--------------------------------------------------------------------------
+    static size_t blockSize(GLenum const format);
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of bytes of an image of the compressed format.
+    //--------------------------------------------------------------------------
+    static size_t levelSize(GLenum const format, size_t const width,
+                            size_t const height);
+
+private:
+
+    //--------------------------------------------------------------------------
+    //! \brief Parse a DDS file. See parse().
+    //--------------------------------------------------------------------------
+    bool parseDDS(const unsigned char* data, size_t const size,
+                  size_t& width, size_t& height);
+
+    //--------------------------------------------------------------------------
+    //! \brief Parse a KTX file. See parse().
+    //--------------------------------------------------------------------------
+    bool parseKTX(const unsigned char* data, size_t const size,
+                  size_t& width, size_t& height);
+
+    //--------------------------------------------------------------------------
+    //! \brief Store the error and return false.
+    //--------------------------------------------------------------------------
+    bool fail(std::string const& msg)
+    {
+        m_error = msg;
+        m_compression = GLTexture::Compression();
+        return false;
+    }
+
+private:
+
+    GLTexture::Compression m_compression;
+    size_t m_pixelCount = 0;
+    bool   m_isValid = false;
+};
+
+#endif // OPENGLCPPWRAPPER_COMPRESSED_TEXTURES_LOADER_HPP
@@ -20,6 +20,19 @@
 
 #include "Loaders/Textures/SOIL.hpp"
 #include "Common/File.hpp"
+#include "Common/MappedFile.hpp"
+#include <mutex>
+
+//------------------------------------------------------------------------------
+//! \brief SOIL stores its last error in a global: decodings run concurrently
+//! (see GLTextureLoadQueue) but the error message is read under this lock.
+//------------------------------------------------------------------------------
+static std::string lastResult()
+{
+    static std::mutex mutex;
+    std::lock_guard<std::mutex> lock(mutex);
+    return SOIL_last_result();
+}
 
 //------------------------------------------------------------------------------
 bool SOIL::setPixelFormat(GLTexture::PixelFormat const cpuformat)
@@ -53,6 +66,9 @@ bool SOIL::setPixelFormat(GLTexture::PixelFormat const cpuformat)
     case GLTexture::PixelFormat::RED:
     case GLTexture::PixelFormat::ALPHA:
     case GLTexture::PixelFormat::DEPTH_STENCIL:
+    case GLTexture::PixelFormat::RG:
+    case GLTexture::PixelFormat::BGR:
+    case GLTexture::PixelFormat::BGRA:
     default:
         m_error = "SOIL does not suport the given CPU pixel format";
         std::cerr << m_error << std::endl;
@@ -78,20 +94,41 @@ bool SOIL::load(std::string const& filename, GLTexture::Buffer& buffer,
         return false;
     }
 
-    // Load the image as a C array.
+    // Decode the image from the mapped file as a C array.
+    MappedFile file(filename);
     int w, h;
-    unsigned char* image = SOIL_load_image(filename.c_str(), &w, &h, 0,
-                                           static_cast<int>(m_soilFormat));
+    unsigned char* image = nullptr;
+    std::string reason;
+    if (likely(file.isOpen()))
+    {
+        image = SOIL_load_image_from_memory(file.data(), static_cast<int>(file.size()),
+                                            &w, &h, 0, static_cast<int>(m_soilFormat));
+        if (nullptr == image)
+            reason = lastResult();
+    }
+    else
+    {
+        reason = file.strerror();
+    }
     if (likely(nullptr != image))
     {
         // Use the max because with framebuffer we can resize texture
         width = std::max(width, static_cast<size_t>(w)); // FIXME
         height = std::max(height, static_cast<size_t>(h));
 
-        // Convert it as std::vector
+        // SOIL allocates its own array with malloc(): the empty buffer adopts
+        // it instead of holding a copy. Else copy it once into the storage of
+        // the texture (reserved storage is reused).
         size_t size = static_cast<size_t>(w * h) * m_pixelCount * sizeof(unsigned char);
-        buffer.append(image, size); // FIXME: not working with preallocated size
-        SOIL_free_image_data(image);
+        if ((buffer.size() == 0u) && (buffer.capacity() < size))
+        {
+            buffer.adopt(image, size);
+        }
+        else
+        {
+            memcpy(buffer.extend(size), image, size);
+            SOIL_free_image_data(image);
+        }
         m_error.clear();
         return true;
     }
@@ -100,7 +137,7 @@ bool SOIL::load(std::string const& filename, GLTexture::Buffer& buffer,
         width = height = 0;
         buffer.clear();
         m_error = "Failed loading picture file '" + filename + "'. Reason was: '"
-                  + SOIL_last_result() + "'";
+                  + reason + "'";
         std::cerr << m_error << std::endl;
         return false;
     }
@@ -152,7 +189,7 @@ bool SOIL::save(std::string const& filename, GLTexture::Buffer const& texture,
     if (unlikely(!res))
     {
         m_error = "Failed saving picture file '" + filename + "'. Reason was: '"
-                  + SOIL_last_result() + "'";
+                  + lastResult() + "'";
         std::cerr << m_error << std::endl;
         return false;
     }
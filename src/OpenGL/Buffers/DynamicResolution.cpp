@@ -0,0 +1,229 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "OpenGL/Buffers/DynamicResolution.hpp"
+#include <algorithm>
+#include <cmath>
+
+constexpr size_t GLDynamicResolution::QUERIES;
+
+//------------------------------------------------------------------------------
+GLDynamicResolution::GLDynamicResolution(Timing const timing)
+    : GLDynamicResolution(Config(), timing)
+{}
+
+//------------------------------------------------------------------------------
+GLDynamicResolution::GLDynamicResolution(Config const& config, Timing const timing)
+    : m_config(config), m_timing(timing), m_scale(config.maxScale)
+{}
+
+//------------------------------------------------------------------------------
+GLDynamicResolution::~GLDynamicResolution()
+{
+    for (auto& it: m_queries)
+    {
+        if (it.handle != 0u)
+        {
+            glCheck(glDeleteQueries(1, &it.handle));
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void GLDynamicResolution::resize(uint32_t const width, uint32_t const height)
+{
+    m_window_width = width;
+    m_window_height = height;
+
+    uint32_t const w = std::max(1u, static_cast<uint32_t>(std::ceil(float(width) * m_config.maxScale)));
+    uint32_t const h = std::max(1u, static_cast<uint32_t>(std::ceil(float(height) * m_config.maxScale)));
+    if ((m_framebuffer != nullptr) && (w <= m_capacity_width) && (h <= m_capacity_height))
+        return ;
+
+    // Never shrink: going back to a previous size shall not reallocate.
+    m_capacity_width = std::max(m_capacity_width, w);
+    m_capacity_height = std::max(m_capacity_height, h);
+
+    m_framebuffer.reset();
+    m_color.reset(new GLTexture2D("DynamicResolutionColor"));
+    m_color->wrap(GLTexture::Wrap::CLAMP_TO_EDGE);
+    m_framebuffer.reset(new GLFrameBuffer("DynamicResolution"));
+    m_framebuffer->resize(m_capacity_width, m_capacity_height);
+    m_framebuffer->createColorTexture(*m_color);
+    m_framebuffer->createDepthBuffer();
+    ++m_allocations;
+}
+
+//------------------------------------------------------------------------------
+float GLDynamicResolution::update(float const milliseconds, float const scale)
+{
+    if ((milliseconds <= 0.0f) || (scale <= 0.0f))
+        return m_scale;
+
+    // The frame time is proportional to the number of pixels: smooth the
+    // time the frame would take at full resolution, so measurements made at
+    // previous scales do not make the controller overshoot.
+    float const cost = milliseconds / (scale * scale);
+    m_cost = (m_measurements == 0u)
+             ? cost
+             : m_cost + m_config.smoothing * (cost - m_cost);
+    ++m_measurements;
+
+    if (std::fabs(1.0f - m_config.target / frameTime()) <= m_config.tolerance)
+        return m_scale;
+
+    float const desired = std::sqrt(m_config.target / m_cost);
+    float const step = std::max(-m_config.maxStep, std::min(m_config.maxStep, desired - m_scale));
+    m_scale = std::max(m_config.minScale, std::min(m_config.maxScale, m_scale + step));
+    return m_scale;
+}
+
+//------------------------------------------------------------------------------
+uint32_t GLDynamicResolution::viewportWidth() const
+{
+    uint32_t const w = static_cast<uint32_t>(std::lround(float(m_window_width) * m_scale));
+    return std::max(1u, std::min(w, m_capacity_width));
+}
+
+//------------------------------------------------------------------------------
+uint32_t GLDynamicResolution::viewportHeight() const
+{
+    uint32_t const h = static_cast<uint32_t>(std::lround(float(m_window_height) * m_scale));
+    return std::max(1u, std::min(h, m_capacity_height));
+}
+
+//------------------------------------------------------------------------------
+float GLDynamicResolution::uvScaleX() const
+{
+    return (m_capacity_width == 0u) ? 1.0f : float(viewportWidth()) / float(m_capacity_width);
+}
+
+//------------------------------------------------------------------------------
+float GLDynamicResolution::uvScaleY() const
+{
+    return (m_capacity_height == 0u) ? 1.0f : float(viewportHeight()) / float(m_capacity_height);
+}
+
+//------------------------------------------------------------------------------
+GLFrameBuffer& GLDynamicResolution::framebuffer()
+{
+    if (m_framebuffer == nullptr)
+    {
+        throw GL::Exception("Dynamic resolution needs the window size");
+    }
+    return *m_framebuffer;
+}
+
+//------------------------------------------------------------------------------
+GLTexture2D& GLDynamicResolution::texture()
+{
+    framebuffer();
+    return *m_color;
+}
+
+//------------------------------------------------------------------------------
+void GLDynamicResolution::beginTiming()
+{
+    if (m_timing == Timing::CPU)
+    {
+        auto const now = std::chrono::steady_clock::now();
+        if (m_has_last_frame)
+        {
+            update(std::chrono::duration<float, std::milli>(now - m_last_frame).count());
+        }
+        m_last_frame = now;
+        m_has_last_frame = true;
+    }
+    else if (m_timing == Timing::GPU)
+    {
+        // Skip the measurement of this frame rather than waiting for the GPU
+        // when all queries are still in flight.
+        Query& query = m_queries[m_query];
+        if (query.pending)
+            return ;
+
+        if (query.handle == 0u)
+        {
+            glCheck(glGenQueries(1, &query.handle));
+        }
+        glCheck(glBeginQuery(GL_TIME_ELAPSED, query.handle));
+        query.scale = m_scale;
+        m_running = m_query;
+    }
+}
+
+//------------------------------------------------------------------------------
+void GLDynamicResolution::endTiming()
+{
+    if ((m_timing != Timing::GPU) || (m_running == QUERIES))
+        return ;
+
+    glCheck(glEndQuery(GL_TIME_ELAPSED));
+    m_queries[m_running].pending = true;
+    m_running = QUERIES;
+    m_query = (m_query + 1u) % QUERIES;
+
+    // Collect finished queries, oldest first
+    for (size_t i = 0u; i < QUERIES; ++i)
+    {
+        Query& query = m_queries[(m_query + i) % QUERIES];
+        if (!query.pending)
+            continue;
+
+        GLint available = GL_FALSE;
+        glCheck(glGetQueryObjectiv(query.handle, GL_QUERY_RESULT_AVAILABLE, &available));
+        if (available == GL_FALSE)
+            break;
+
+        GLuint64 nanoseconds = 0u;
+        glCheck(glGetQueryObjectui64v(query.handle, GL_QUERY_RESULT, &nanoseconds));
+        query.pending = false;
+        update(float(double(nanoseconds) / 1000000.0), query.scale);
+    }
+}
+
+//------------------------------------------------------------------------------
+void GLDynamicResolution::blit(uint32_t const width, uint32_t const height)
+{
+    glCheck(glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer().handle()));
+    glCheck(glReadBuffer(GL_COLOR_ATTACHMENT0));
+    glCheck(glBlitFramebuffer(0, 0, GLint(viewportWidth()), GLint(viewportHeight()),
+                              0, 0, GLint(width), GLint(height),
+                              GL_COLOR_BUFFER_BIT, m_config.filter));
+    glCheck(glBindFramebuffer(GL_READ_FRAMEBUFFER, 0u));
+}
+
+//------------------------------------------------------------------------------
+void GLDynamicResolution::present()
+{
+    glCheck(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0u));
+    blit(m_window_width, m_window_height);
+}
+
+//------------------------------------------------------------------------------
+void GLDynamicResolution::present(GLFrameBuffer& destination)
+{
+    // Make sure the destination has been specified to OpenGL
+    destination.begin(); destination.end();
+
+    glCheck(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, destination.handle()));
+    blit(destination.width(), destination.height());
+    glCheck(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0u));
+}
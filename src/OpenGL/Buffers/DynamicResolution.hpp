@@ -0,0 +1,299 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#ifndef OPENGLCPPWRAPPER_GLDYNAMIC_RESOLUTION_HPP
+#  define OPENGLCPPWRAPPER_GLDYNAMIC_RESOLUTION_HPP
+
+#  include "OpenGL/Buffers/FrameBuffers.hpp"
+#  include "Common/NonCppStd.hpp"
+#  include <array>
+#  include <chrono>
+
+// *****************************************************************************
+//! \brief Render the scene at a resolution adapted to the measured frame time.
+//!
+//! The scene is rendered into a framebuffer allocated for the largest
+//! resolution (the window size times the maximal scale). Each frame only the
+//! viewport changes: its scale (ie 50% .. 100% of the window) follows the
+//! ratio between a target frame time and the smoothed measured frame time.
+//! GPU time of a frame being proportional to its number of pixels, measured
+//! times are converted into the time of a frame at full resolution before
+//! being smoothed. The scale then moves toward the square root of the ratio
+//! between the target and this smoothed time, with a tolerance avoiding
+//! oscillations and a maximal change per frame. The viewport is then upscaled
+//! to the window by present().
+//!
+//! \code
+//!   GLDynamicResolution resolution;
+//!   resolution.resize(width, height); // On window resized
+//!   // Each frame
+//!   resolution.render([&]() { draw the scene });
+//!   resolution.present();
+//! \endcode
+//!
+//! Attachments are only reallocated when the largest resolution grows.
+// *****************************************************************************
+class GLDynamicResolution : private NonCopyable
+{
+public:
+
+    // *************************************************************************
+    //! \brief Source of the frame time.
+    // *************************************************************************
+    enum class Timing
+    {
+        //! \brief GPU time of render() measured by timer queries, read a few
+        //! frames later without stalling.
+        GPU,
+        //! \brief CPU time between two calls to render(). With vsync, frames
+        //! faster than the target cannot be detected.
+        CPU,
+        //! \brief Frame times are given by update().
+        MANUAL,
+    };
+
+    // *************************************************************************
+    //! \brief Settings of the controller.
+    // *************************************************************************
+    struct Config
+    {
+        //! \brief Frame time to reach (in milliseconds).
+        float target = 1000.0f / 60.0f;
+        //! \brief Range of the scale of the window resolution.
+        float minScale = 0.5f;
+        float maxScale = 1.0f;
+        //! \brief Weight of a new measurement in the smoothed frame time
+        //! (exponential moving average). Shall be in ]0 1].
+        float smoothing = 0.1f;
+        //! \brief Relative difference between the smoothed frame time and the
+        //! target below which the scale is kept.
+        float tolerance = 0.05f;
+        //! \brief Maximal change of scale per frame.
+        float maxStep = 0.05f;
+        //! \brief Filter upscaling the viewport to the window: GL_LINEAR or
+        //! GL_NEAREST.
+        GLenum filter = GL_LINEAR;
+    };
+
+    //--------------------------------------------------------------------------
+    //! \brief Controller with default settings, starting at the maximal scale.
+    //! The framebuffer is allocated by resize().
+    //--------------------------------------------------------------------------
+    explicit GLDynamicResolution(Timing const timing = Timing::GPU);
+
+    //--------------------------------------------------------------------------
+    //! \brief Controller starting at the maximal scale. The framebuffer is
+    //! allocated by resize().
+    //--------------------------------------------------------------------------
+    GLDynamicResolution(Config const& config, Timing const timing = Timing::GPU);
+
+    //--------------------------------------------------------------------------
+    //! \brief Destroy timer queries and the framebuffer.
+    //--------------------------------------------------------------------------
+    ~GLDynamicResolution();
+
+    //--------------------------------------------------------------------------
+    //! \brief Set the size of the window. Attachments are reallocated only if
+    //! the largest viewport no longer fits in them.
+    //--------------------------------------------------------------------------
+    void resize(uint32_t const width, uint32_t const height);
+
+    //--------------------------------------------------------------------------
+    //! \brief Feed the controller with the time of a frame and adapt the
+    //! scale of the next frames. Called by render() unless the timing is
+    //! MANUAL.
+    //!
+    //! \param milliseconds the frame time. Ignored if <= 0.
+    //! \return the new scale.
+    //--------------------------------------------------------------------------
+    inline float update(float const milliseconds)
+    {
+        return update(milliseconds, m_scale);
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Same as update(milliseconds) for a frame rendered at the given
+    //! scale. Measurements arriving late (ie timer queries) shall be given
+    //! with the scale of their frame, not the current one.
+    //--------------------------------------------------------------------------
+    float update(float const milliseconds, float const scale);
+
+    //--------------------------------------------------------------------------
+    //! \brief Render into the framebuffer with the viewport set to the current
+    //! scale, and measure the frame time.
+    //! \throw GL::Exception if resize() has not been called.
+    //--------------------------------------------------------------------------
+    template<typename Functor>
+    void render(Functor functor)
+    {
+        if (m_framebuffer == nullptr)
+        {
+            throw GL::Exception("Dynamic resolution needs the window size");
+        }
+
+        beginTiming();
+        m_framebuffer->render(0u, 0u, viewportWidth(), viewportHeight(), functor);
+        endTiming();
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Upscale the last rendered viewport to the back buffer of the
+    //! window with the configured filter.
+    //--------------------------------------------------------------------------
+    void present();
+
+    //--------------------------------------------------------------------------
+    //! \brief Upscale the last rendered viewport to the color buffers of the
+    //! destination (ie for post-processing at the window resolution).
+    //--------------------------------------------------------------------------
+    void present(GLFrameBuffer& destination);
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the current scale of the window resolution.
+    //--------------------------------------------------------------------------
+    inline float scale() const
+    {
+        return m_scale;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the smoothed frame time expected at the current scale (in
+    //! milliseconds).
+    //--------------------------------------------------------------------------
+    inline float frameTime() const
+    {
+        return m_cost * m_scale * m_scale;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of frame times given to the controller.
+    //--------------------------------------------------------------------------
+    inline size_t measurements() const
+    {
+        return m_measurements;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the size of the rendered viewport (in pixels).
+    //--------------------------------------------------------------------------
+    uint32_t viewportWidth() const;
+    uint32_t viewportHeight() const;
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the size of the attachments (in pixels).
+    //--------------------------------------------------------------------------
+    inline uint32_t capacityWidth() const
+    {
+        return m_capacity_width;
+    }
+
+    inline uint32_t capacityHeight() const
+    {
+        return m_capacity_height;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return how many times attachments have been allocated.
+    //--------------------------------------------------------------------------
+    inline size_t allocations() const
+    {
+        return m_allocations;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the framebuffer the scene is rendered into.
+    //! \throw GL::Exception if resize() has not been called.
+    //--------------------------------------------------------------------------
+    GLFrameBuffer& framebuffer();
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the color texture of the framebuffer, for upscaling
+    //! with a custom shader. Only the part given by uvScale() is rendered.
+    //! \throw GL::Exception if resize() has not been called.
+    //--------------------------------------------------------------------------
+    GLTexture2D& texture();
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the texture coordinates of the upper right corner of the
+    //! rendered viewport inside texture().
+    //--------------------------------------------------------------------------
+    float uvScaleX() const;
+    float uvScaleY() const;
+
+private:
+
+    //--------------------------------------------------------------------------
+    //! \brief Start measuring the frame.
+    //--------------------------------------------------------------------------
+    void beginTiming();
+
+    //--------------------------------------------------------------------------
+    //! \brief Stop measuring the frame and give available measurements to
+    //! update().
+    //--------------------------------------------------------------------------
+    void endTiming();
+
+    //--------------------------------------------------------------------------
+    //! \brief Blit the viewport into the framebuffer bound to
+    //! GL_DRAW_FRAMEBUFFER.
+    //--------------------------------------------------------------------------
+    void blit(uint32_t const width, uint32_t const height);
+
+private:
+
+    //! \brief Number of timer queries in flight.
+    static constexpr size_t QUERIES = 3u;
+
+    struct Query
+    {
+        GLuint handle = 0u;
+        bool pending = false;
+        //! \brief Scale of the measured frame.
+        float scale = 1.0f;
+    };
+
+    Config m_config;
+    Timing m_timing;
+    float m_scale;
+    //! \brief Smoothed frame time at full resolution (in milliseconds).
+    float m_cost = 0.0f;
+    size_t m_measurements = 0u;
+
+    uint32_t m_window_width = 0u;
+    uint32_t m_window_height = 0u;
+    uint32_t m_capacity_width = 0u;
+    uint32_t m_capacity_height = 0u;
+    size_t m_allocations = 0u;
+    //! \brief Framebuffer and its color texture, recreated when growing. The
+    //! framebuffer is destroyed first.
+    std::unique_ptr<GLTexture2D> m_color;
+    std::unique_ptr<GLFrameBuffer> m_framebuffer;
+
+    //! \brief Ring of GL_TIME_ELAPSED queries.
+    std::array<Query, QUERIES> m_queries;
+    size_t m_query = 0u;
+    //! \brief Index of the query measuring the current frame (or QUERIES).
+    size_t m_running = QUERIES;
+    //! \brief Start of the previous frame for CPU timing.
+    std::chrono::steady_clock::time_point m_last_frame;
+    bool m_has_last_frame = false;
+};
+
+#endif // OPENGLCPPWRAPPER_GLDYNAMIC_RESOLUTION_HPP
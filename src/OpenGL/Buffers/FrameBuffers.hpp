@@ -28,6 +28,8 @@
 #  define OPENGLCPPWRAPPER_GLFRAMEBUFFER_HPP
 
 #  include "OpenGL/Textures/Texture2D.hpp"
+#  include <algorithm>
+#  include <memory>
 
 // *****************************************************************************
 //! \brief Base class for render buffer object.
@@ -43,16 +45,18 @@ public:
     //! \param width Buffer width (pixels)
     //! \param height Buffer height (pixel)
     //! \param format Buffer format
+    //! \param samples Number of samples per pixel (0 for a single sample).
     //--------------------------------------------------------------------------
     GLRenderBuffer(std::string const& name, const uint32_t width,
                    const uint32_t height, const GLenum attachment,
-                   const GLenum format)
+                   const GLenum format, const GLsizei samples = 0)
         : GLObject(name, GL_RENDERBUFFER)
     {
         m_width = width;
         m_height = height;
         m_attachment = attachment;
         m_format = format;
+        m_samples = samples;
     }
 
     //--------------------------------------------------------------------------
@@ -64,9 +68,12 @@ public:
     }
 
     //--------------------------------------------------------------------------
-    //! \brief
+    //! \brief Attach the buffer to the framebuffer bound to GL_FRAMEBUFFER.
+    //! \param attachment the attachment point chosen by the framebuffer: a
+    //! buffer shared by several framebuffers can be attached to different
+    //! color attachment points.
     //--------------------------------------------------------------------------
-    virtual void attach() = 0;
+    virtual void attach(const GLenum attachment) = 0;
 
     //--------------------------------------------------------------------------
     //! \brief
@@ -90,6 +97,31 @@ public:
         return m_height;
     }
 
+    //--------------------------------------------------------------------------
+    //! \brief Return the attachment point given at construction. Framebuffers
+    //! attach color buffers to the point matching their index instead.
+    //--------------------------------------------------------------------------
+    inline GLenum attachment() const
+    {
+        return m_attachment;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the internal format of the buffer.
+    //--------------------------------------------------------------------------
+    inline GLenum format() const
+    {
+        return m_format;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of samples per pixel (0 for a single sample).
+    //--------------------------------------------------------------------------
+    inline GLsizei samples() const
+    {
+        return m_samples;
+    }
+
     //--------------------------------------------------------------------------
     //! \brief Resize the buffer.
     //!
@@ -138,9 +170,18 @@ private:
     //--------------------------------------------------------------------------
     virtual bool onSetup() override
     {
-        glCheck(glRenderbufferStorage(m_target, m_format,
-                                      static_cast<GLsizei>(m_width),
-                                      static_cast<GLsizei>(m_height)));
+        if (m_samples > 0)
+        {
+            glCheck(glRenderbufferStorageMultisample(m_target, m_samples, m_format,
+                                                     static_cast<GLsizei>(m_width),
+                                                     static_cast<GLsizei>(m_height)));
+        }
+        else
+        {
+            glCheck(glRenderbufferStorage(m_target, m_format,
+                                          static_cast<GLsizei>(m_width),
+                                          static_cast<GLsizei>(m_height)));
+        }
         return false;
     }
 
@@ -176,6 +217,7 @@ protected:
     uint32_t m_height;
     GLenum   m_attachment;
     GLenum   m_format;
+    GLsizei  m_samples;
 };
 
 // *****************************************************************************
@@ -203,10 +245,10 @@ public:
         return m_texture;
     }
 
-    virtual void attach() override
+    virtual void attach(const GLenum attachment) override
     {
         glCheck(glFramebufferTexture2D(GL_FRAMEBUFFER,
-                                       m_attachment,
+                                       attachment,
                                        m_texture.target(),
                                        m_texture.handle(),
                                        0));
@@ -265,9 +307,22 @@ public:
         : GLRenderBuffer(name, width, height, attachment, static_cast<GLenum>(format))
     {}
 
-    virtual void attach() override
+    //--------------------------------------------------------------------------
+    //! \brief Constructor with a sized internal format (ie GL_RGBA16F) and a
+    //! number of samples per pixel.
+    //--------------------------------------------------------------------------
+    GLColorBuffer(std::string const& name,
+                  const uint32_t width,
+                  const uint32_t height,
+                  const GLenum attachment,
+                  const GLenum format,
+                  const GLsizei samples)
+        : GLRenderBuffer(name, width, height, attachment, format, samples)
+    {}
+
+    virtual void attach(const GLenum attachment) override
     {
-        glCheck(glFramebufferRenderbuffer(GL_FRAMEBUFFER, m_attachment, m_target, m_handle));
+        glCheck(glFramebufferRenderbuffer(GL_FRAMEBUFFER, attachment, m_target, m_handle));
     }
 
     //--------------------------------------------------------------------------
@@ -293,9 +348,25 @@ public:
         : GLRenderBuffer(name, width, height, GL_DEPTH_ATTACHMENT, static_cast<GLenum>(format))
     {}
 
-    virtual void attach() override
+    //--------------------------------------------------------------------------
+    //! \brief Constructor with a sized internal format (ie GL_DEPTH_COMPONENT24
+    //! or GL_DEPTH24_STENCIL8, attached to GL_DEPTH_STENCIL_ATTACHMENT) and a
+    //! number of samples per pixel.
+    //--------------------------------------------------------------------------
+    GLDepthBuffer(std::string const& name,
+                  const uint32_t width,
+                  const uint32_t height,
+                  const GLenum format,
+                  const GLsizei samples)
+        : GLRenderBuffer(name, width, height,
+                         ((format == GL_DEPTH24_STENCIL8) || (format == GL_DEPTH32F_STENCIL8))
+                         ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT,
+                         format, samples)
+    {}
+
+    virtual void attach(const GLenum attachment) override
     {
-        glCheck(glFramebufferRenderbuffer(GL_FRAMEBUFFER, m_attachment, m_target, m_handle));
+        glCheck(glFramebufferRenderbuffer(GL_FRAMEBUFFER, attachment, m_target, m_handle));
     }
 };
 
@@ -313,9 +384,21 @@ public:
         : GLRenderBuffer(name, width, height, GL_STENCIL_ATTACHMENT, static_cast<GLenum>(format))
     {}
 
-    virtual void attach() override
+    //--------------------------------------------------------------------------
+    //! \brief Constructor with a sized internal format (ie GL_STENCIL_INDEX8)
+    //! and a number of samples per pixel.
+    //--------------------------------------------------------------------------
+    GLStencilBuffer(std::string const& name,
+                    const uint32_t width,
+                    const uint32_t height,
+                    const GLenum format,
+                    const GLsizei samples)
+        : GLRenderBuffer(name, width, height, GL_STENCIL_ATTACHMENT, format, samples)
+    {}
+
+    virtual void attach(const GLenum attachment) override
     {
-        glCheck(glFramebufferRenderbuffer(GL_FRAMEBUFFER, m_attachment, m_target, m_handle));
+        glCheck(glFramebufferRenderbuffer(GL_FRAMEBUFFER, attachment, m_target, m_handle));
     }
 };
 
@@ -328,9 +411,17 @@ public:
 //! A framebuffer has at least one buffer (color, depth or stencil buffer).
 //! It has one or several color buffers, zero or one depth buffer and zero
 //! or one stencil buffer.
+//!
+//! Multisampled framebuffers (anti-aliasing) hold several samples per pixel.
+//! They cannot be sampled as textures: resolve() averages samples into a
+//! single-sample framebuffer (ie holding textures for post-processing) then
+//! discards the samples.
 // *****************************************************************************
 class GLFrameBuffer : public GLObject<GLenum>
 {
+    //! \brief Reads back color buffers asynchronously.
+    friend class GLReadbackQueue;
+
 public:
 
     //--------------------------------------------------------------------------
@@ -346,11 +437,13 @@ public:
     GLFrameBuffer(std::string const& name,
                   const uint32_t width, const uint32_t height,
                   const uint8_t nb_colors = 1u, // FIXME: use enum to detect error at compile-time
-                  const bool with_depth = true, const bool with_stencil = false)
+                  const bool with_depth = true, const bool with_stencil = false,
+                  const GLsizei samples = 0)
         : GLObject(name, GL_FRAMEBUFFER)
     {
         m_width = width;
         m_height = height;
+        m_samples = samples;
 
         if (likely(nb_colors <= 16))
         {
@@ -455,6 +548,112 @@ public:
         return m_height;
     }
 
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of samples per pixel of the buffers created by
+    //! this framebuffer (0 for a single sample).
+    //--------------------------------------------------------------------------
+    inline GLsizei samples() const
+    {
+        return m_samples;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Average the samples of this multisampled framebuffer into the
+    //! single-sample destination (or copy pixels between single-sample
+    //! framebuffers) with glBlitFramebuffer().
+    //!
+    //! \param destination framebuffer of the same size. Color buffers are
+    //! resolved into the color buffers of the same index.
+    //! \param mask GL_COLOR_BUFFER_BIT, GL_DEPTH_BUFFER_BIT and/or
+    //! GL_STENCIL_BUFFER_BIT. Depth and stencil buffers shall have identical
+    //! formats.
+    //! \param discard if true, invalidate the attachments of this framebuffer
+    //! after the resolve (see invalidate()).
+    //! \throw GL::Exception if the destination is this framebuffer or has a
+    //! different size.
+    //--------------------------------------------------------------------------
+    void resolve(GLFrameBuffer& destination,
+                 const GLbitfield mask = GL_COLOR_BUFFER_BIT,
+                 const bool discard = true)
+    {
+        if (&destination == this)
+        {
+            throw GL::Exception("Framebuffer '" + name() + "' cannot be resolved into itself");
+        }
+        if ((destination.m_width != m_width) || (destination.m_height != m_height))
+        {
+            throw GL::Exception("Framebuffer '" + name() + "' cannot be resolved into '" +
+                                destination.name() + "' of a different size");
+        }
+
+        // Make sure both framebuffers have been specified to OpenGL
+        begin(); end();
+        destination.begin(); destination.end();
+
+        glCheck(glBindFramebuffer(GL_READ_FRAMEBUFFER, m_handle));
+        glCheck(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, destination.m_handle));
+        if (mask & GL_COLOR_BUFFER_BIT)
+        {
+            // A blit reads a single color buffer: resolve them one by one.
+            const size_t count = std::min(m_color_buffers.size(),
+                                          destination.m_color_buffers.size());
+            for (size_t i = 0u; i < count; ++i)
+            {
+                const GLenum attachment = GLenum(GL_COLOR_ATTACHMENT0 + i);
+                glCheck(glReadBuffer(attachment));
+                glCheck(glDrawBuffers(1, &attachment));
+                blit(GL_COLOR_BUFFER_BIT);
+            }
+            glCheck(glReadBuffer(GL_COLOR_ATTACHMENT0));
+            destination.drawBuffers();
+        }
+        if (mask & (GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT))
+        {
+            blit(mask & (GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT));
+        }
+        if (discard)
+        {
+            invalidate(GL_READ_FRAMEBUFFER);
+        }
+        glCheck(glBindFramebuffer(GL_READ_FRAMEBUFFER, 0));
+        glCheck(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0));
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Average the samples of the first color buffer into the back
+    //! buffer of the default framebuffer (the window) of the same size.
+    //!
+    //! \param discard if true, invalidate the attachments of this framebuffer
+    //! after the resolve (see invalidate()).
+    //--------------------------------------------------------------------------
+    void resolveToScreen(const bool discard = true)
+    {
+        begin(); end();
+
+        glCheck(glBindFramebuffer(GL_READ_FRAMEBUFFER, m_handle));
+        glCheck(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0));
+        glCheck(glReadBuffer(GL_COLOR_ATTACHMENT0));
+        blit(GL_COLOR_BUFFER_BIT);
+        if (discard)
+        {
+            invalidate(GL_READ_FRAMEBUFFER);
+        }
+        glCheck(glBindFramebuffer(GL_READ_FRAMEBUFFER, 0));
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Tell OpenGL that the content of all attachments is no longer
+    //! needed (ie multisampled buffers once resolved, depth buffers at the end
+    //! of the pass). Tile-based GPUs then skip writing them back to memory.
+    //! Does nothing if glInvalidateFramebuffer() is not supported.
+    //--------------------------------------------------------------------------
+    void invalidate()
+    {
+        begin();
+        invalidate(GL_FRAMEBUFFER);
+        end();
+    }
+
     //--------------------------------------------------------------------------
     //! \brief
     //----------------------------------------------------------------------------
@@ -481,6 +680,7 @@ public:
         const GLenum attachment = GL_COLOR_ATTACHMENT0 + id;
 
         GLTextureBuffer* buf = new GLTextureBuffer(texture, m_width, m_height, attachment);
+        m_owned_buffers.emplace_back(buf);
         m_color_buffers.push_back(buf);
         m_pending_attachments.push_back(buf);
         m_need_setup = true;
@@ -496,22 +696,61 @@ public:
         const GLenum attachment = GL_COLOR_ATTACHMENT0 + id;
         const std::string name("ColorBuffer" + std::to_string(id));
 
-        GLColorBuffer* buf = new GLColorBuffer(name, m_width, m_height, attachment);
+        GLColorBuffer* buf = (m_samples > 0)
+            ? new GLColorBuffer(name, m_width, m_height, attachment, GL_RGBA8, m_samples)
+            : new GLColorBuffer(name, m_width, m_height, attachment);
+        m_owned_buffers.emplace_back(buf);
         m_color_buffers.push_back(buf); // TODO: max 16 elements
         m_pending_attachments.push_back(buf);
         m_need_setup = true;
         return *buf;
     }
 
+    //--------------------------------------------------------------------------
+    //! \brief Attach a color buffer owned by another object (ie a
+    //! GLRenderTargetPool) to the next color attachment point. The buffer
+    //! shall live longer than this framebuffer and have the same size.
+    //! \throw GL::Exception if 16 color buffers are already attached.
+    //--------------------------------------------------------------------------
+    GLFrameBuffer& attachColorBuffer(GLRenderBuffer& buffer)
+    {
+        throw_if_reached_max_buffers();
+        m_color_buffers.push_back(&buffer);
+        m_pending_attachments.push_back(&buffer);
+        m_need_setup = true;
+        return *this;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Attach a depth buffer owned by another object (ie a
+    //! GLRenderTargetPool). The buffer shall live longer than this framebuffer
+    //! and have the same size.
+    //! \throw GL::Exception if the framebuffer already has a depth buffer.
+    //--------------------------------------------------------------------------
+    GLFrameBuffer& attachDepthBuffer(GLDepthBuffer& buffer)
+    {
+        if (nullptr != m_depth_buffer)
+        {
+            throw GL::Exception("Framebuffer '" + name() + "' already has a depth buffer");
+        }
+        m_depth_buffer = &buffer;
+        m_pending_attachments.push_back(&buffer);
+        m_need_setup = true;
+        return *this;
+    }
+
     //--------------------------------------------------------------------------
     //! \brief
-    //! \fixme use smart pointers
     //--------------------------------------------------------------------------
     GLDepthBuffer& getDepthBuffer()
     {
         if (unlikely(nullptr == m_depth_buffer))
         {
-            m_depth_buffer = new GLDepthBuffer("DepthBuffer", m_width, m_height);
+            m_depth_buffer = (m_samples > 0)
+                ? new GLDepthBuffer("DepthBuffer", m_width, m_height,
+                                    GL_DEPTH_COMPONENT24, m_samples)
+                : new GLDepthBuffer("DepthBuffer", m_width, m_height);
+            m_owned_buffers.emplace_back(m_depth_buffer);
             m_pending_attachments.push_back(m_depth_buffer);
             m_need_setup = true;
         }
@@ -525,7 +764,11 @@ public:
     {
         if (unlikely(nullptr == m_stencil_buffer))
         {
-            m_stencil_buffer = new GLStencilBuffer("StencilBuffer", m_width, m_height);
+            m_stencil_buffer = (m_samples > 0)
+                ? new GLStencilBuffer("StencilBuffer", m_width, m_height,
+                                      GL_STENCIL_INDEX8, m_samples)
+                : new GLStencilBuffer("StencilBuffer", m_width, m_height);
+            m_owned_buffers.emplace_back(m_stencil_buffer);
             m_pending_attachments.push_back(m_stencil_buffer);
             m_need_setup = true;
         }
@@ -579,10 +822,16 @@ private:
                 glCheck(glClearColor(1.0f, 0.0f, 0.4f, 0.0f));
                 //DEBUG("Framebuffer '%s' is attaching '%s'", cname(), it->cname());
                 it->begin();
-                it->attach();
-                it->draw();
+                it->attach(attachmentOf(*it));
                 it->end();
             }
+
+            // Render into all color buffers (or none for depth-only passes).
+            if (m_color_buffers.empty())
+            {
+                glCheck(glReadBuffer(GL_NONE));
+            }
+            drawBuffers();
             m_pending_attachments.clear();
             m_need_update = true;
             return false;
@@ -618,6 +867,8 @@ private:
             throw GL::Exception("FRAMEBUFFER_INCOMPLETE_READ_BUFFER");
         case GL_FRAMEBUFFER_UNSUPPORTED:
             throw GL::Exception("Framebuffer '" + name() + "' has a combination of internal formats used by attachments is not supported");
+        case GL_FRAMEBUFFER_INCOMPLETE_MULTISAMPLE:
+            throw GL::Exception("Framebuffer '" + name() + "' has attachments with different numbers of samples");
         case 0:
         default:
             throw GL::Exception("Framebuffer '" + name() + "' has its target not equal to GL_FRAMEBUFFER");
@@ -644,10 +895,97 @@ private:
         m_color_buffers.clear();
         m_depth_buffer = nullptr;
         m_stencil_buffer = nullptr;
+        m_owned_buffers.clear();
         m_width = 0;
         m_height = 0;
     }
 
+    //--------------------------------------------------------------------------
+    //! \brief Return the attachment point of the buffer in this framebuffer.
+    //! Color buffers attached from outside may be shared by framebuffers at
+    //! different indices: their point is given by their index here and is not
+    //! stored in the buffer.
+    //--------------------------------------------------------------------------
+    GLenum attachmentOf(GLRenderBuffer const& buffer) const
+    {
+        for (size_t i = 0u; i < m_color_buffers.size(); ++i)
+        {
+            if (m_color_buffers[i] == &buffer)
+                return GLenum(GL_COLOR_ATTACHMENT0 + i);
+        }
+        return buffer.attachment();
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Render into all color buffers of the bound framebuffer, or none
+    //! for depth-only framebuffers.
+    //--------------------------------------------------------------------------
+    void drawBuffers()
+    {
+        std::vector<GLenum> draw_buffers;
+        for (size_t i = 0u; i < m_color_buffers.size(); ++i)
+        {
+            draw_buffers.push_back(GLenum(GL_COLOR_ATTACHMENT0 + i));
+        }
+
+        if (draw_buffers.empty())
+        {
+            glCheck(glDrawBuffer(GL_NONE));
+        }
+        else
+        {
+            glCheck(glDrawBuffers(static_cast<GLsizei>(draw_buffers.size()),
+                                  draw_buffers.data()));
+        }
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Copy the whole framebuffer bound to GL_READ_FRAMEBUFFER into the
+    //! one bound to GL_DRAW_FRAMEBUFFER.
+    //--------------------------------------------------------------------------
+    void blit(const GLbitfield mask)
+    {
+        glCheck(glBlitFramebuffer(0, 0, GLint(m_width), GLint(m_height),
+                                  0, 0, GLint(m_width), GLint(m_height),
+                                  mask, GL_NEAREST));
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the attachment points used by this framebuffer. Color
+    //! buffers may be shared: their point is their index here.
+    //--------------------------------------------------------------------------
+    std::vector<GLenum> attachments() const
+    {
+        std::vector<GLenum> attachments;
+        for (size_t i = 0u; i < m_color_buffers.size(); ++i)
+        {
+            attachments.push_back(GLenum(GL_COLOR_ATTACHMENT0 + i));
+        }
+        if (nullptr != m_depth_buffer)
+        {
+            attachments.push_back(m_depth_buffer->attachment());
+        }
+        if (nullptr != m_stencil_buffer)
+        {
+            attachments.push_back(m_stencil_buffer->attachment());
+        }
+        return attachments;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Invalidate all attachments of this framebuffer bound to the
+    //! given target.
+    //--------------------------------------------------------------------------
+    void invalidate(const GLenum target)
+    {
+        if (!GLEW_ARB_invalidate_subdata)
+            return ;
+
+        std::vector<GLenum> const points = attachments();
+        glCheck(glInvalidateFramebuffer(target, static_cast<GLsizei>(points.size()),
+                                        points.data()));
+    }
+
     //--------------------------------------------------------------------------
     //! \brief Check if the framebuffer has at least one render buffer.
     //! \throw GL::Exception if the framebuffer has not at least one render buffer.
@@ -682,8 +1020,13 @@ private:
     GLDepthBuffer*               m_depth_buffer = nullptr;   // 0 or 1 buffer
     GLStencilBuffer*             m_stencil_buffer = nullptr; // 0 or 1 buffer
     std::vector<GLRenderBuffer*> m_pending_attachments;
+    //! \brief Buffers created by this framebuffer (others are owned by the
+    //! caller).
+    std::vector<std::unique_ptr<GLRenderBuffer>> m_owned_buffers;
     uint32_t                     m_width = 0;
     uint32_t                     m_height = 0;
+    //! \brief Samples per pixel of the buffers created by this framebuffer.
+    GLsizei                      m_samples = 0;
 };
 
 #endif // OPENGLCPPWRAPPER_GLFRAMEBUFFER_HPP
@@ -0,0 +1,416 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "OpenGL/Buffers/FrameCapture.hpp"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+constexpr size_t GLFrameCapture::DEFAULT_QUEUE;
+
+//------------------------------------------------------------------------------
+//! \brief Table of the CRC-32 used by PNG chunks.
+//------------------------------------------------------------------------------
+static std::array<uint32_t, 256u> const& crcTable()
+{
+    static std::array<uint32_t, 256u> const table = []()
+    {
+        std::array<uint32_t, 256u> t;
+        for (uint32_t n = 0u; n < 256u; ++n)
+        {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1u) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+            t[n] = c;
+        }
+        return t;
+    }();
+    return table;
+}
+
+//------------------------------------------------------------------------------
+//! \brief Append a 32-bit big-endian integer.
+//------------------------------------------------------------------------------
+static void appendU32(std::vector<unsigned char>& out, uint32_t const value)
+{
+    out.push_back(static_cast<unsigned char>(value >> 24));
+    out.push_back(static_cast<unsigned char>(value >> 16));
+    out.push_back(static_cast<unsigned char>(value >> 8));
+    out.push_back(static_cast<unsigned char>(value));
+}
+
+//------------------------------------------------------------------------------
+//! \brief Append a PNG chunk: length, type, data and CRC of type and data.
+//------------------------------------------------------------------------------
+static void appendChunk(std::vector<unsigned char>& out, const char* type,
+                        std::vector<unsigned char> const& data)
+{
+    appendU32(out, static_cast<uint32_t>(data.size()));
+    size_t const start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = start; i < out.size(); ++i)
+        crc = crcTable()[(crc ^ out[i]) & 0xFFu] ^ (crc >> 8);
+    appendU32(out, crc ^ 0xFFFFFFFFu);
+}
+
+//------------------------------------------------------------------------------
+//! \brief Encode RGBA8 texels (bottom row first) into a PNG file in memory.
+//! The zlib stream holds stored (not compressed) deflate blocks: encoding is
+//! a copy and does not need zlib. Files are bigger than compressed PNG but
+//! the encoder keeps up with the rendering.
+//------------------------------------------------------------------------------
+static void encodePNG(std::vector<unsigned char>& out, size_t const width,
+                      size_t const height, const unsigned char* texels)
+{
+    static const unsigned char signature[8] =
+    {
+        0x89u, 'P', 'N', 'G', '\r', '\n', 0x1Au, '\n'
+    };
+
+    out.clear();
+    out.insert(out.end(), signature, signature + 8);
+
+    // Header: 8 bits per channel, RGBA, no interlace
+    std::vector<unsigned char> ihdr;
+    appendU32(ihdr, static_cast<uint32_t>(width));
+    appendU32(ihdr, static_cast<uint32_t>(height));
+    ihdr.insert(ihdr.end(), { 8u, 6u, 0u, 0u, 0u });
+    appendChunk(out, "IHDR", ihdr);
+
+    // Rows from top to bottom, each one prefixed by the filter type 'none'
+    size_t const stride = width * 4u;
+    std::vector<unsigned char> raw;
+    raw.reserve((stride + 1u) * height);
+    for (size_t y = height; y-- > 0u; )
+    {
+        raw.push_back(0u);
+        raw.insert(raw.end(), texels + y * stride, texels + (y + 1u) * stride);
+    }
+
+    // zlib stream of stored deflate blocks of at most 65535 bytes
+    std::vector<unsigned char> idat;
+    idat.reserve(raw.size() + raw.size() / 65535u * 5u + 11u);
+    idat.push_back(0x78u);
+    idat.push_back(0x01u);
+    size_t offset = 0u;
+    do
+    {
+        size_t const length = std::min(raw.size() - offset, size_t(65535u));
+        bool const last = (offset + length == raw.size());
+        idat.push_back(last ? 1u : 0u);
+        idat.push_back(static_cast<unsigned char>(length));
+        idat.push_back(static_cast<unsigned char>(length >> 8));
+        idat.push_back(static_cast<unsigned char>(~length));
+        idat.push_back(static_cast<unsigned char>(~length >> 8));
+        idat.insert(idat.end(), raw.begin() + long(offset),
+                    raw.begin() + long(offset + length));
+        offset += length;
+    } while (offset < raw.size());
+
+    uint32_t a = 1u, b = 0u;
+    for (unsigned char const c: raw)
+    {
+        a = (a + c) % 65521u;
+        b = (b + a) % 65521u;
+    }
+    appendU32(idat, (b << 16) | a);
+    appendChunk(out, "IDAT", idat);
+    appendChunk(out, "IEND", {});
+}
+
+//------------------------------------------------------------------------------
+//! \brief Convert RGBA8 texels (bottom row first) into the 4:4:4 planes of a
+//! Y4M frame (top row first). BT.601 studio range, as expected by players
+//! for Y4M files without color range tag.
+//------------------------------------------------------------------------------
+static void encodeY4M(std::vector<unsigned char>& out, size_t const width,
+                      size_t const height, const unsigned char* texels)
+{
+    size_t const count = width * height;
+    out.resize(3u * count);
+    unsigned char* Y = out.data();
+    unsigned char* U = Y + count;
+    unsigned char* V = U + count;
+
+    for (size_t y = 0u; y < height; ++y)
+    {
+        const unsigned char* row = texels + (height - 1u - y) * width * 4u;
+        for (size_t x = 0u; x < width; ++x, row += 4)
+        {
+            int const r = row[0], g = row[1], b = row[2];
+            *Y++ = static_cast<unsigned char>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+            *U++ = static_cast<unsigned char>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            *V++ = static_cast<unsigned char>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+GLFrameCapture::GLFrameCapture(size_t const queue, DropPolicy const policy)
+    : m_capacity(queue), m_policy(policy)
+{
+    assert(queue > 0u);
+}
+
+//------------------------------------------------------------------------------
+GLFrameCapture::~GLFrameCapture()
+{
+    stop();
+}
+
+//------------------------------------------------------------------------------
+std::string GLFrameCapture::filename(std::string const& prefix, size_t const frame)
+{
+    char number[32];
+    std::snprintf(number, sizeof(number), "_%06zu.png", frame);
+    return prefix + number;
+}
+
+//------------------------------------------------------------------------------
+bool GLFrameCapture::start(std::string const& path, Format const format,
+                           size_t const fps)
+{
+    if (m_recording)
+    {
+        std::cerr << "Failed recording '" << path
+                  << "'. Reason 'A recording is already running'" << std::endl;
+        return false;
+    }
+
+    if (format != Format::PNG)
+    {
+        m_file = std::fopen(path.c_str(), "wb");
+        if (m_file == nullptr)
+        {
+            std::cerr << "Failed recording '" << path << "'. Reason '"
+                      << std::strerror(errno) << "'" << std::endl;
+            return false;
+        }
+    }
+
+    m_path = path;
+    m_format = format;
+    m_fps = std::max(size_t(1u), fps);
+    m_width = m_height = 0u;
+    m_captured = m_dropped = m_written = 0u;
+    m_stop = false;
+    m_recording = true;
+    m_encoder = std::thread(&GLFrameCapture::encode, this);
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void GLFrameCapture::stop()
+{
+    if (!m_recording)
+        return;
+
+    // Frames still in the PBO ring belong to the recording
+    m_readbacks.finish();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_queued.notify_one();
+    m_encoder.join();
+
+    if (m_file != nullptr)
+    {
+        std::fclose(m_file);
+        m_file = nullptr;
+    }
+    m_recording = false;
+}
+
+//------------------------------------------------------------------------------
+bool GLFrameCapture::capture(GLFrameBuffer& framebuffer, size_t const color)
+{
+    if (!m_recording)
+        return false;
+
+    m_readbacks.requestReadback(framebuffer, color,
+                                enqueue(framebuffer.width(), framebuffer.height()));
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool GLFrameCapture::capture(size_t const width, size_t const height)
+{
+    if (!m_recording)
+        return false;
+
+    m_readbacks.requestReadback(width, height, enqueue(width, height));
+    return true;
+}
+
+//------------------------------------------------------------------------------
+size_t GLFrameCapture::poll()
+{
+    return m_readbacks.poll();
+}
+
+//------------------------------------------------------------------------------
+GLReadbackQueue::Callback GLFrameCapture::enqueue(size_t const width, size_t const height)
+{
+    return [this, width, height](GLReadbackQueue::Ticket const,
+                                 const unsigned char* texels, size_t const bytes)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        ++m_captured;
+
+        if (m_frames.size() >= m_capacity)
+        {
+            switch (m_policy)
+            {
+            case DropPolicy::DropNewest:
+                ++m_dropped;
+                return;
+            case DropPolicy::DropOldest:
+                m_spares.push_back(std::move(m_frames.front()));
+                m_frames.pop_front();
+                ++m_dropped;
+                break;
+            case DropPolicy::Block:
+                m_encoded.wait(lock, [this]() { return m_frames.size() < m_capacity; });
+                break;
+            }
+        }
+
+        Frame frame;
+        if (!m_spares.empty())
+        {
+            frame = std::move(m_spares.back());
+            m_spares.pop_back();
+        }
+        frame.width = width;
+        frame.height = height;
+        frame.texels.assign(texels, texels + bytes);
+        m_frames.push_back(std::move(frame));
+        lock.unlock();
+        m_queued.notify_one();
+    };
+}
+
+//------------------------------------------------------------------------------
+void GLFrameCapture::encode()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_queued.wait(lock, [this]() { return m_stop || !m_frames.empty(); });
+        if (m_frames.empty())
+            return;
+
+        Frame frame = std::move(m_frames.front());
+        m_frames.pop_front();
+        size_t const index = m_written;
+        lock.unlock();
+        m_encoded.notify_one();
+
+        // Write without holding the lock: the OpenGL thread keeps queuing.
+        bool const res = write(frame, index);
+
+        lock.lock();
+        if (res)
+        {
+            ++m_written;
+        }
+        m_spares.push_back(std::move(frame));
+    }
+}
+
+//------------------------------------------------------------------------------
+bool GLFrameCapture::write(Frame const& frame, size_t const index)
+{
+    if (frame.texels.size() < frame.width * frame.height * 4u)
+        return false;
+
+    std::vector<unsigned char> encoded;
+    switch (m_format)
+    {
+    case Format::Raw:
+        {
+            // Top row first as for the other formats
+            size_t const stride = frame.width * 4u;
+            for (size_t y = frame.height; y-- > 0u; )
+            {
+                if (std::fwrite(frame.texels.data() + y * stride, 1u, stride, m_file) != stride)
+                    return false;
+            }
+            return true;
+        }
+    case Format::Y4M:
+        {
+            if (m_width == 0u)
+            {
+                m_width = frame.width;
+                m_height = frame.height;
+                std::fprintf(m_file, "YUV4MPEG2 W%zu H%zu F%zu:1 Ip A1:1 C444\n",
+                             m_width, m_height, m_fps);
+            }
+            else if ((frame.width != m_width) || (frame.height != m_height))
+            {
+                std::cerr << "Failed recording a frame of '" << m_path
+                          << "'. Reason 'Frame size changed'" << std::endl;
+                return false;
+            }
+
+            encodeY4M(encoded, frame.width, frame.height, frame.texels.data());
+            return (std::fputs("FRAME\n", m_file) >= 0) &&
+                   (std::fwrite(encoded.data(), 1u, encoded.size(), m_file) == encoded.size());
+        }
+    case Format::PNG:
+        {
+            std::string const name = filename(m_path, index);
+            FILE* file = std::fopen(name.c_str(), "wb");
+            if (file == nullptr)
+            {
+                std::cerr << "Failed recording '" << name << "'. Reason '"
+                          << std::strerror(errno) << "'" << std::endl;
+                return false;
+            }
+
+            encodePNG(encoded, frame.width, frame.height, frame.texels.data());
+            bool const res = (std::fwrite(encoded.data(), 1u, encoded.size(), file)
+                              == encoded.size());
+            return (std::fclose(file) == 0) && res;
+        }
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------------
+size_t GLFrameCapture::dropped() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_dropped;
+}
+
+//------------------------------------------------------------------------------
+size_t GLFrameCapture::written() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_written;
+}
@@ -0,0 +1,236 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#ifndef OPENGLCPPWRAPPER_GLFRAME_CAPTURE_HPP
+#  define OPENGLCPPWRAPPER_GLFRAME_CAPTURE_HPP
+
+#  include "OpenGL/Buffers/ReadbackQueue.hpp"
+#  include <condition_variable>
+#  include <cstdio>
+#  include <deque>
+#  include <mutex>
+#  include <string>
+#  include <thread>
+
+// *****************************************************************************
+//! \brief Record rendered frames into a video file or a sequence of pictures
+//! without stalling the rendering.
+//!
+//! Frames are read back through the PBO ring of a GLReadbackQueue: capture()
+//! only queues the copy on the GPU and poll(), called once per frame, copies
+//! completed frames into a bounded queue. A background thread encodes queued
+//! frames into:
+//!   - a raw file: RGBA8 frames stored top to bottom one after the other;
+//!   - a YUV4MPEG2 (.y4m) video: 4:4:4 planar frames readable by ffmpeg, mpv
+//!     or vlc;
+//!   - a sequence of PNG files: <path>_000000.png, <path>_000001.png ...
+//!
+//! When the encoder is slower than the rendering, the queue fills up and the
+//! drop policy decides what happens to the new frame: drop it, drop the oldest
+//! queued frame or wait for the encoder (this last policy stalls rendering but
+//! never loses frames).
+//!
+//! \code
+//!   GLFrameCapture capture;
+//!   capture.start("video.y4m", GLFrameCapture::Format::Y4M, 60u);
+//!   // Each frame, after rendering into the framebuffer
+//!   capture.capture(framebuffer);
+//!   capture.poll();
+//!   ...
+//!   capture.stop();
+//! \endcode
+//!
+//! \note Except for the encoding, all methods shall be called from the thread
+//! owning the OpenGL context. GLWindow::record() captures the window.
+// *****************************************************************************
+class GLFrameCapture : private NonCopyable
+{
+public:
+
+    //! \brief Container of the recorded frames.
+    enum class Format { Raw, Y4M, PNG };
+
+    //! \brief What to do with a read back frame when the queue is full.
+    enum class DropPolicy { DropNewest, DropOldest, Block };
+
+    //--------------------------------------------------------------------------
+    //! \brief Default maximum number of frames waiting for the encoder.
+    //--------------------------------------------------------------------------
+    static constexpr size_t DEFAULT_QUEUE = 8u;
+
+    //--------------------------------------------------------------------------
+    //! \brief Define the queue of frames. Nothing is recorded until start().
+    //!
+    //! \param queue the maximum number of frames waiting for the encoder.
+    //! Shall be > 0.
+    //! \param policy the behavior when the queue is full.
+    //--------------------------------------------------------------------------
+    explicit GLFrameCapture(size_t const queue = DEFAULT_QUEUE,
+                            DropPolicy const policy = DropPolicy::DropOldest);
+
+    //--------------------------------------------------------------------------
+    //! \brief Stop the recording: see stop().
+    //--------------------------------------------------------------------------
+    ~GLFrameCapture();
+
+    //--------------------------------------------------------------------------
+    //! \brief Start the recording and the encoder thread. Counters are reset.
+    //!
+    //! \param path the file to create for Raw and Y4M formats, the prefix of
+    //! files for the PNG format.
+    //! \param format the container of frames.
+    //! \param fps the frame rate stored in Y4M files.
+    //! \return false if already recording or if the file cannot be created.
+    //--------------------------------------------------------------------------
+    bool start(std::string const& path, Format const format, size_t const fps = 60u);
+
+    //--------------------------------------------------------------------------
+    //! \brief Wait for pending readbacks, encode all queued frames, join the
+    //! encoder thread and close the file. Does nothing if not recording.
+    //--------------------------------------------------------------------------
+    void stop();
+
+    //--------------------------------------------------------------------------
+    //! \brief Return true between start() and stop().
+    //--------------------------------------------------------------------------
+    inline bool recording() const
+    {
+        return m_recording;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Queue the readback of a color attachment of the framebuffer as
+    //! the next frame. Does not wait for the GPU.
+    //!
+    //! \return false if not recording.
+    //! \throw GL::Exception if the framebuffer does not hold the attachment.
+    //--------------------------------------------------------------------------
+    bool capture(GLFrameBuffer& framebuffer, size_t const color = 0u);
+
+    //--------------------------------------------------------------------------
+    //! \brief Queue the readback of the back buffer of the window as the next
+    //! frame. To be called before swapping buffers.
+    //!
+    //! \param width, height the dimension of the window in pixels.
+    //! \return false if not recording.
+    //--------------------------------------------------------------------------
+    bool capture(size_t const width, size_t const height);
+
+    //--------------------------------------------------------------------------
+    //! \brief Give frames read back by the GPU to the encoder. Never waits for
+    //! the GPU. Waits for the encoder only with DropPolicy::Block.
+    //!
+    //! \return the number of readbacks still pending.
+    //--------------------------------------------------------------------------
+    size_t poll();
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of frames read back since start().
+    //--------------------------------------------------------------------------
+    inline size_t captured() const
+    {
+        return m_captured;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of frames dropped because the queue was full
+    //! since start().
+    //--------------------------------------------------------------------------
+    size_t dropped() const;
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of frames written by the encoder since
+    //! start().
+    //--------------------------------------------------------------------------
+    size_t written() const;
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the name of the PNG file of the given frame.
+    //--------------------------------------------------------------------------
+    static std::string filename(std::string const& prefix, size_t const frame);
+
+private:
+
+    //--------------------------------------------------------------------------
+    //! \brief A frame read back from the GPU: RGBA8 texels, bottom row first.
+    //--------------------------------------------------------------------------
+    struct Frame
+    {
+        size_t width = 0u;
+        size_t height = 0u;
+        std::vector<unsigned char> texels;
+    };
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the readback callback queuing a frame of the given size.
+    //--------------------------------------------------------------------------
+    GLReadbackQueue::Callback enqueue(size_t const width, size_t const height);
+
+    //--------------------------------------------------------------------------
+    //! \brief Loop of the encoder thread: write queued frames.
+    //--------------------------------------------------------------------------
+    void encode();
+
+    //--------------------------------------------------------------------------
+    //! \brief Write a frame in the file. Called by the encoder thread.
+    //! \return false on I/O error.
+    //--------------------------------------------------------------------------
+    bool write(Frame const& frame, size_t const index);
+
+private:
+
+    //! \brief PBO ring reading back frames.
+    GLReadbackQueue m_readbacks;
+    //! \brief Maximum number of frames in m_frames.
+    size_t const m_capacity;
+    //! \brief Behavior when m_frames is full.
+    DropPolicy const m_policy;
+    //! \brief Frames waiting for the encoder.
+    std::deque<Frame> m_frames;
+    //! \brief Frames already encoded: reused to avoid allocations each frame.
+    std::vector<Frame> m_spares;
+    //! \brief Protect m_frames, m_spares, counters and m_stop.
+    mutable std::mutex m_mutex;
+    //! \brief Wake up the encoder when a frame is queued.
+    std::condition_variable m_queued;
+    //! \brief Wake up a blocked poll() when a frame has been encoded.
+    std::condition_variable m_encoded;
+    //! \brief Encoder thread.
+    std::thread m_encoder;
+    //! \brief Ask the encoder to return once the queue is empty.
+    bool m_stop = false;
+    //! \brief Between start() and stop().
+    bool m_recording = false;
+    //! \brief Recording settings.
+    std::string m_path;
+    Format m_format = Format::Raw;
+    size_t m_fps = 60u;
+    //! \brief Raw or Y4M file (nullptr for PNG).
+    FILE* m_file = nullptr;
+    //! \brief Dimension of the first frame: Y4M frames shall have the same.
+    size_t m_width = 0u;
+    size_t m_height = 0u;
+    //! \brief Counters since start().
+    size_t m_captured = 0u;
+    size_t m_dropped = 0u;
+    size_t m_written = 0u;
+};
+
+#endif // OPENGLCPPWRAPPER_GLFRAME_CAPTURE_HPP
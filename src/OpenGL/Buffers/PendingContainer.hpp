@@ -25,6 +25,9 @@
 #  include "Common/Pending.hpp"
 #  include "OpenGL/Buffers/GPUMemory.hpp"
 #  include <vector>
+#  include <memory>
+#  include <iterator>
+#  include <cstdlib>
 #  include <cmath>
 #  include <fstream>
 
@@ -38,6 +41,9 @@
 //! flushed to the GPU memory. Mostly method impacting on the container size
 //! have a side effect: they modify the estimator on the GPU memory usage for
 //! the current running application.
+//!
+//! Elements are stored in a std::vector, or in an array allocated by a C
+//! library which has been adopted without copy (see adopt()).
 // *****************************************************************************
 template<class T>
 class PendingContainer: public Pending
@@ -150,7 +156,7 @@ public:
     {
         // Copy container as well as the capacity
         m_container.reserve(other.capacity());
-        m_container = other.m_container;
+        m_container.assign(other.elements(), other.elements() + other.size());
 
         // Set pending data
         const auto bound = other.getPending();
@@ -190,7 +196,7 @@ public:
     //--------------------------------------------------------------------------
     inline size_t capacity() const
     {
-        return m_container.capacity();
+        return (m_adopted != nullptr) ? m_adopted_size : m_container.capacity();
     }
 
     //--------------------------------------------------------------------------
@@ -198,7 +204,7 @@ public:
     //--------------------------------------------------------------------------
     inline size_t size() const
     {
-        return m_container.size();
+        return (m_adopted != nullptr) ? m_adopted_size : m_container.size();
     }
 
     //--------------------------------------------------------------------------
@@ -206,7 +212,7 @@ public:
     //--------------------------------------------------------------------------
     inline size_t bytes() const
     {
-        return sizeof (T) * m_container.size();
+        return sizeof (T) * size();
     }
 
     //--------------------------------------------------------------------------
@@ -216,6 +222,7 @@ public:
     inline void reserve(size_t const count)
     {
         throw_if_cannot_expand();
+        own();
         m_container.reserve(count);
     }
 
@@ -233,6 +240,7 @@ public:
 
         // Resize the container
         throw_if_cannot_expand();
+        own();
         m_container.resize(count);
         // FIXME not optimized concerning m_pending_start
         setPending(0u, m_container.size());
@@ -277,10 +285,10 @@ public:
     //--------------------------------------------------------------------------
     inline T& set(size_t const nth)
     {
-        if (unlikely(nth >= m_container.size()))
+        if (unlikely(nth >= size()))
         {
             throw_if_cannot_expand();
-            m_container.capacity();
+            own();
             m_container.resize(nth + 1u);
             // FIXME not optimized concerning m_pending_start
             setPending(0u, m_container.size());
@@ -291,7 +299,7 @@ public:
         {
             setPending(nth);
         }
-        return m_container[nth];
+        return elements()[nth];
     }
 
     //--------------------------------------------------------------------------
@@ -300,6 +308,12 @@ public:
     //--------------------------------------------------------------------------
     inline T const& get(size_t const nth) const
     {
+        if (unlikely(m_adopted != nullptr))
+        {
+            if (nth >= m_adopted_size)
+                throw std::out_of_range("PendingContainer::get");
+            return m_adopted[nth];
+        }
         return m_container.at(nth);
     }
 
@@ -314,6 +328,38 @@ public:
         clearPending(0u);
     }
 
+    //--------------------------------------------------------------------------
+    //! \brief Remove all elements of the container but keep its capacity: the
+    //! storage reserved by reserve() is reused by the next elements. Contrary
+    //! to clear(), the size of the container becomes 0.
+    //! \throw std::out_of_range if the container cannot be resized.
+    //--------------------------------------------------------------------------
+    void reset()
+    {
+        throw_if_cannot_expand();
+        GPUMemory() -= bytes();
+        m_adopted.reset();
+        m_adopted_size = 0u;
+        m_container.clear();
+        clearPending();
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Exchange elements with another container without copying them.
+    //! All elements of both containers are then considered as pending.
+    //! \throw std::out_of_range if one of the containers cannot be resized.
+    //--------------------------------------------------------------------------
+    void swap(PendingContainer<T>& other)
+    {
+        throw_if_cannot_expand();
+        other.throw_if_cannot_expand();
+        m_container.swap(other.m_container);
+        m_adopted.swap(other.m_adopted);
+        std::swap(m_adopted_size, other.m_adopted_size);
+        clearPending(size());
+        other.clearPending(other.size());
+    }
+
     //--------------------------------------------------------------------------
     //! \brief Concat two containers.
     //! \throw std::out_of_range if the container cannot be resized.
@@ -322,6 +368,7 @@ public:
     append(std::initializer_list<T> il)
     {
         throw_if_cannot_expand();
+        own();
         size_t start = m_container.size();
         m_container.insert(m_container.end(), il);
         setPending(start, m_container.size());
@@ -337,6 +384,7 @@ public:
     append(const T* other, size_t const size)
     {
         throw_if_cannot_expand();
+        own();
         size_t start = m_container.size();
         m_container.insert(m_container.end(),
                            other,
@@ -354,6 +402,7 @@ public:
     append(std::vector<T> const& other)
     {
         throw_if_cannot_expand();
+        own();
         size_t start = m_container.size();
         m_container.insert(m_container.end(),
                            other.begin(),
@@ -370,7 +419,7 @@ public:
     PendingContainer<T>&
     append(PendingContainer const& other)
     {
-        return PendingContainer<T>::append(other.m_container);
+        return PendingContainer<T>::append(other.elements(), other.size());
     }
 
     //--------------------------------------------------------------------------
@@ -381,6 +430,7 @@ public:
     append(T const& val)
     {
         throw_if_cannot_expand();
+        own();
 
         m_container.push_back(val);
         setPending(0u, m_container.size());
@@ -388,6 +438,52 @@ public:
         return *this;
     }
 
+    //--------------------------------------------------------------------------
+    //! \brief Append count elements and return the address of the first one,
+    //! so that a producer (ie a picture file decoder) writes them in place
+    //! instead of appending a copy of its own array. The storage reserved by
+    //! reserve() is used when large enough.
+    //!
+    //! \note the address is invalidated by the next modification of the size
+    //! of the container.
+    //! \throw std::out_of_range if the container cannot be resized.
+    //--------------------------------------------------------------------------
+    T* extend(size_t const count)
+    {
+        throw_if_cannot_expand();
+        own();
+
+        size_t start = m_container.size();
+        m_container.resize(start + count);
+        setPending(start, m_container.size());
+        GPUMemory() += count * sizeof (T);
+        return m_container.data() + start;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Replace elements by an array allocated with malloc() (ie decoded
+    //! by SOIL) without copying it: the container takes its ownership and
+    //! frees it. All elements are then considered as pending.
+    //!
+    //! \note The array is copied into a std::vector only when the size of the
+    //! container is modified or when data() is called.
+    //! \throw std::out_of_range if the container cannot be resized.
+    //--------------------------------------------------------------------------
+    void adopt(T* array, size_t const count)
+    {
+        static_assert(std::is_trivial<T>::value,
+                      "Only arrays of trivial types can be adopted");
+        throw_if_cannot_expand();
+        GPUMemory() -= bytes();
+
+        // Release the storage of the vector: the array holds the elements.
+        std::vector<T>().swap(m_container);
+        m_adopted.reset(array);
+        m_adopted_size = count;
+        clearPending(count);
+        GPUMemory() += bytes();
+    }
+
     //--------------------------------------------------------------------------
     //! \brief Concat two containers holding indexes of VBOs. This method shall
     //! only called for EBOs.
@@ -398,6 +494,7 @@ public:
     appendIndex(std::vector<T> const& other)
     {
         throw_if_cannot_expand();
+        own();
 
         T older_index{0};
         if (likely(0u != size()))
@@ -424,7 +521,12 @@ public:
     PendingContainer<T>&
     appendIndex(PendingContainer const& other)
     {
-        return PendingContainer<T>::appendIndex(other.m_container);
+        if (likely(other.m_adopted == nullptr))
+        {
+            return PendingContainer<T>::appendIndex(other.m_container);
+        }
+        return PendingContainer<T>::appendIndex(
+            std::vector<T>(other.elements(), other.elements() + other.size()));
     }
 
     //--------------------------------------------------------------------------
@@ -433,15 +535,15 @@ public:
     //--------------------------------------------------------------------------
     inline T sum() const
     {
-        if (unlikely(0u == m_container.size()))
+        if (unlikely(0u == size()))
         {
             throw std::out_of_range("Cannot compute the summation of an empty container");
         }
 
         T sum_of_elems = 0;
-        for (auto& n : m_container)
+        for (size_t i = 0u; i < size(); ++i)
         {
-            sum_of_elems += n;
+            sum_of_elems += elements()[i];
         }
 
         return sum_of_elems;
@@ -453,15 +555,15 @@ public:
     //--------------------------------------------------------------------------
     inline T prod() const
     {
-        if (unlikely(0u == m_container.size()))
+        if (unlikely(0u == size()))
         {
             throw std::out_of_range("Cannot compute the product of an empty container");
         }
 
         T prod_of_elems = 1;
 
-        for (auto& n : m_container) {
-            prod_of_elems *= n;
+        for (size_t i = 0u; i < size(); ++i) {
+            prod_of_elems *= elements()[i];
         }
 
         return prod_of_elems;
@@ -473,11 +575,11 @@ public:
     //--------------------------------------------------------------------------
     inline T min() const
     {
-        if (unlikely(0u == m_container.size()))
+        if (unlikely(0u == size()))
         {
             throw std::out_of_range("Cannot compute the min of an empty container");
         }
-        return *std::min_element(m_container.begin(), m_container.end());
+        return *std::min_element(elements(), elements() + size());
     }
 
     //--------------------------------------------------------------------------
@@ -486,11 +588,11 @@ public:
     //--------------------------------------------------------------------------
     inline T max() const
     {
-        if (unlikely(0u == m_container.size()))
+        if (unlikely(0u == size()))
         {
             throw std::out_of_range("Cannot compute the max of an empty container");
         }
-        return *std::max_element(m_container.begin(), m_container.end());
+        return *std::max_element(elements(), elements() + size());
     }
 
     //--------------------------------------------------------------------------
@@ -500,8 +602,8 @@ public:
     template<class Function>
     inline PendingContainer<T>& apply(Function f)
     {
-        clearPending(m_container.size());
-        std::for_each(m_container.begin(), m_container.end(), f);
+        clearPending(size());
+        std::for_each(elements(), elements() + size(), f);
         return *this;
     }
 
@@ -558,7 +660,11 @@ public:
     //--------------------------------------------------------------------------
     inline PendingContainer<T>& operator=(PendingContainer<T> const& other)
     {
-        return this->operator=(other.m_container);
+        if (this != &other)
+        {
+            assign(other.elements(), other.elements() + other.size());
+        }
+        return *this;
     }
 
     //--------------------------------------------------------------------------
@@ -570,17 +676,7 @@ public:
     template<class U>
     PendingContainer<T>& operator=(std::vector<U> const& other)
     {
-        const size_t my_size = m_container.size();
-        const size_t other_size = other.size();
-
-        if (other_size > my_size) {
-            throw_if_cannot_expand();
-        }
-
-        GPUMemory() += (other.size() * sizeof (T) - bytes());
-        m_container = other;
-        setPending(0u, other_size);
-        return *this;
+        return assign(other.begin(), other.end());
     }
 
     //--------------------------------------------------------------------------
@@ -593,7 +689,7 @@ public:
     template<class U>
     PendingContainer<T>& operator=(std::initializer_list<U> il)
     {
-        const size_t my_size = m_container.size();
+        const size_t my_size = size();
         const size_t other_size = il.size();
 
         if (other_size > my_size) {
@@ -601,6 +697,8 @@ public:
         }
 
         GPUMemory() += (il.size() * sizeof (T) - bytes());
+        m_adopted.reset();
+        m_adopted_size = 0u;
         m_container = il;
         setPending(0u, other_size);
         return *this;
@@ -614,6 +712,7 @@ public:
     inline PendingContainer<T>& operator*=(U const& val)
     {
         //FIXME return apply([val](T& x){ x *= val; });
+        own();
         for (auto& x: m_container) {
             x *= val;
         }
@@ -628,6 +727,7 @@ public:
     inline PendingContainer<T>& operator+=(U const& val)
     {
         //FIXME return apply([val](T& x){ x += val; });
+        own();
         for (auto& x: m_container) {
             x += val;
         }
@@ -643,6 +743,7 @@ public:
     inline PendingContainer<T>& operator-=(U const& val)
     {
         //FIXME return apply([val](T& x){ x -= val; });
+        own();
         for (auto& x: m_container) {
             x -= val;
         }
@@ -667,9 +768,9 @@ public:
     {
         if (likely(0u != cont.size()))
         {
-            stream << cont.m_container[0];
+            stream << cont.elements()[0];
             for (size_t i = 1u; i < cont.size(); ++i) {
-                stream << ", " << cont.m_container[i];
+                stream << ", " << cont.elements()[i];
             }
         }
         return stream;
@@ -680,9 +781,9 @@ public:
     //--------------------------------------------------------------------------
     inline T* to_array()
     {
-        if (likely(0u != m_container.size()))
+        if (likely(0u != size()))
         {
-            return m_container.data();
+            return elements();
         }
         else
         {
@@ -695,9 +796,9 @@ public:
     //--------------------------------------------------------------------------
     inline const T* to_array() const
     {
-        if (likely(0u != m_container.size()))
+        if (likely(0u != size()))
         {
-            return m_container.data();
+            return elements();
         }
         else
         {
@@ -707,9 +808,11 @@ public:
 
     //--------------------------------------------------------------------------
     //! \brief Return the container in read write access. FIXME should not be const ?
+    //! An adopted array is first copied into the std::vector.
     //--------------------------------------------------------------------------
     inline std::vector<T>& data()
     {
+        own();
         return m_container;
     }
 
@@ -735,9 +838,73 @@ protected:
         m_can_expand = false;
     }
 
-    //! \brief The container holding elements.
+    //--------------------------------------------------------------------------
+    //! \brief Return the address of the first element (of the adopted array if
+    //! any, else of the std::vector).
+    //--------------------------------------------------------------------------
+    inline T* elements()
+    {
+        return (m_adopted != nullptr) ? m_adopted.get() : m_container.data();
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the address of the first element (read only access).
+    //--------------------------------------------------------------------------
+    inline const T* elements() const
+    {
+        return (m_adopted != nullptr) ? m_adopted.get() : m_container.data();
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Copy the adopted array into the std::vector and free it. Called
+    //! before modifying the size of the container.
+    //--------------------------------------------------------------------------
+    void own()
+    {
+        if (unlikely(m_adopted != nullptr))
+        {
+            m_container.assign(m_adopted.get(), m_adopted.get() + m_adopted_size);
+            m_adopted.reset();
+            m_adopted_size = 0u;
+        }
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Replace elements by the given range. Impacted elements are set
+    //! dirty.
+    //!
+    //! \throw std::out_of_range if the range has more elements and the
+    //! container cannot be resized.
+    //--------------------------------------------------------------------------
+    template<class It>
+    PendingContainer<T>& assign(It first, It last)
+    {
+        const size_t my_size = size();
+        const size_t other_size = static_cast<size_t>(std::distance(first, last));
+
+        if (other_size > my_size) {
+            throw_if_cannot_expand();
+        }
+
+        GPUMemory() += (other_size * sizeof (T) - bytes());
+        m_adopted.reset();
+        m_adopted_size = 0u;
+        m_container.assign(first, last);
+        setPending(0u, other_size);
+        return *this;
+    }
+
+    //! \brief The container holding elements (unless an array has been
+    //! adopted).
     std::vector<T> m_container;
 
+    //! \brief Array adopted by adopt(): it holds the elements instead of
+    //! m_container until the size of the container is modified.
+    std::unique_ptr<T[], decltype(&free)> m_adopted{nullptr, &free};
+
+    //! \brief Number of elements of m_adopted.
+    size_t m_adopted_size = 0u;
+
     //! \brief When set to true the m_container can increase its size, else not
     //! which produce an exception. Forbidding resizing the container is needed
     //! because VBOs cannot be resized.
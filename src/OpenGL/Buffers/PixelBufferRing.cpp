@@ -0,0 +1,102 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "OpenGL/Buffers/PixelBufferRing.hpp"
+#include <algorithm>
+#include <cassert>
+
+constexpr size_t GLPixelBufferRing::DEFAULT_COUNT;
+
+//------------------------------------------------------------------------------
+GLPixelBufferRing::GLPixelBufferRing(GLenum const target, size_t const count)
+    : m_target(target),
+      m_handles(count, 0u),
+      m_capacities(count, 0u),
+      m_current(count - 1u)
+{
+    assert(count > 0u);
+}
+
+//------------------------------------------------------------------------------
+GLPixelBufferRing::~GLPixelBufferRing()
+{
+    release();
+}
+
+//------------------------------------------------------------------------------
+void GLPixelBufferRing::release()
+{
+    for (auto& it: m_handles)
+    {
+        if (it != 0u)
+        {
+            glCheck(glDeleteBuffers(1, &it));
+            it = 0u;
+        }
+    }
+    std::fill(m_capacities.begin(), m_capacities.end(), 0u);
+    m_current = m_handles.size() - 1u;
+}
+
+//------------------------------------------------------------------------------
+void* GLPixelBufferRing::map(size_t const bytes)
+{
+    m_current = (m_current + 1u) % m_handles.size();
+    GLuint& handle = m_handles[m_current];
+    if (handle == 0u)
+    {
+        glCheck(glGenBuffers(1, &handle));
+    }
+
+    glCheck(glBindBuffer(m_target, handle));
+    if (m_capacities[m_current] < bytes)
+    {
+        glCheck(glBufferData(m_target, static_cast<GLsizeiptr>(bytes),
+                             nullptr, GL_STREAM_DRAW));
+        m_capacities[m_current] = bytes;
+    }
+
+    // Invalidating the storage lets the driver give fresh memory when the
+    // PBO is still read by the GPU instead of waiting for it.
+    void* memory = nullptr;
+    glCheck(memory = glMapBufferRange(m_target, 0,
+                                      static_cast<GLsizeiptr>(bytes),
+                                      GL_MAP_WRITE_BIT |
+                                      GL_MAP_INVALIDATE_BUFFER_BIT));
+    if (memory == nullptr)
+    {
+        unbind();
+    }
+    return memory;
+}
+
+//------------------------------------------------------------------------------
+bool GLPixelBufferRing::unmap()
+{
+    GLboolean res = GL_FALSE;
+    glCheck(res = glUnmapBuffer(m_target));
+    return res == GL_TRUE;
+}
+
+//------------------------------------------------------------------------------
+void GLPixelBufferRing::unbind()
+{
+    glCheck(glBindBuffer(m_target, 0u));
+}
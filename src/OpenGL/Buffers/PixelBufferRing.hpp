@@ -0,0 +1,154 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#ifndef OPENGLCPPWRAPPER_GLPIXEL_BUFFER_RING_HPP
+#  define OPENGLCPPWRAPPER_GLPIXEL_BUFFER_RING_HPP
+
+#  include "OpenGL/Context/OpenGL.hpp"
+#  include "Common/NonCppStd.hpp"
+#  include <vector>
+
+// *****************************************************************************
+//! \brief Ring of pixel buffer objects (PBO) for streaming texels between the
+//! CPU and the GPU.
+//!
+//! Giving client memory to glTexSubImage*() forces the driver to copy texels
+//! synchronously before returning. With GL_PIXEL_UNPACK_BUFFER bound, texels
+//! are instead written into the mapped memory of a PBO and glTexSubImage*()
+//! receives an offset inside the PBO: the transfer to the texture is then made
+//! asynchronously by the driver. Since the PBO of the previous frame may still
+//! be read by the GPU, several PBOs are used in turn and their storage is
+//! invalidated when mapped so the CPU never waits for the GPU.
+//!
+//! \code
+//!   GLPixelBufferRing pbos(GL_PIXEL_UNPACK_BUFFER);
+//!   void* dst = pbos.map(bytes);
+//!   memcpy(dst, texels, bytes);
+//!   pbos.unmap();
+//!   glTexSubImage2D(..., pbos.offset());
+//!   pbos.unbind();
+//! \endcode
+// *****************************************************************************
+class GLPixelBufferRing : private NonCopyable
+{
+public:
+
+    //--------------------------------------------------------------------------
+    //! \brief Default number of PBOs in the ring (triple buffering).
+    //--------------------------------------------------------------------------
+    static constexpr size_t DEFAULT_COUNT = 3u;
+
+    //--------------------------------------------------------------------------
+    //! \brief Define the ring. PBOs are created lazily by map().
+    //!
+    //! \param target GL_PIXEL_UNPACK_BUFFER (CPU to GPU transfers).
+    //! \param count the number of PBOs in the ring. Shall be > 0.
+    //--------------------------------------------------------------------------
+    GLPixelBufferRing(GLenum const target, size_t const count = DEFAULT_COUNT);
+
+    //--------------------------------------------------------------------------
+    //! \brief Destroy PBOs.
+    //--------------------------------------------------------------------------
+    ~GLPixelBufferRing();
+
+    //--------------------------------------------------------------------------
+    //! \brief Bind the next PBO of the ring, grow it if smaller than the given
+    //! number of bytes and map its whole storage for writing. The previous
+    //! content of the PBO is invalidated.
+    //!
+    //! \return the address of the mapped memory or nullptr in case of failure
+    //! (the PBO is then unbound).
+    //--------------------------------------------------------------------------
+    void* map(size_t const bytes);
+
+    //--------------------------------------------------------------------------
+    //! \brief Unmap the current PBO and keep it bound for the glTexSubImage*()
+    //! call.
+    //!
+    //! \return false if the content of the PBO has been corrupted and shall be
+    //! written again.
+    //--------------------------------------------------------------------------
+    bool unmap();
+
+    //--------------------------------------------------------------------------
+    //! \brief Unbind the current PBO. Shall be called after glTexSubImage*()
+    //! else texels given as client memory would be read as offsets.
+    //--------------------------------------------------------------------------
+    void unbind();
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the pointer to pass to glTexSubImage*() for reading texels
+    //! from the given offset of the current PBO.
+    //--------------------------------------------------------------------------
+    inline const void* offset(size_t const bytes = 0u) const
+    {
+        return reinterpret_cast<const void*>(bytes);
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Destroy PBOs. They are created back by the next map().
+    //--------------------------------------------------------------------------
+    void release();
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of PBOs in the ring.
+    //--------------------------------------------------------------------------
+    inline size_t count() const
+    {
+        return m_handles.size();
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the index of the current PBO in the ring.
+    //--------------------------------------------------------------------------
+    inline size_t current() const
+    {
+        return m_current;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the OpenGL handle of the nth PBO (0 if not yet created).
+    //--------------------------------------------------------------------------
+    inline GLuint handle(size_t const nth) const
+    {
+        return m_handles[nth];
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of bytes allocated for the nth PBO.
+    //--------------------------------------------------------------------------
+    inline size_t capacity(size_t const nth) const
+    {
+        return m_capacities[nth];
+    }
+
+private:
+
+    //! \brief GL_PIXEL_UNPACK_BUFFER.
+    GLenum m_target;
+    //! \brief PBO handles.
+    std::vector<GLuint> m_handles;
+    //! \brief Bytes allocated for each PBO.
+    std::vector<size_t> m_capacities;
+    //! \brief Index of the current PBO.
+    size_t m_current;
+};
+
+#endif // OPENGLCPPWRAPPER_GLPIXEL_BUFFER_RING_HPP
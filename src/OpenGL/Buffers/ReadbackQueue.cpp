@@ -0,0 +1,432 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "OpenGL/Buffers/ReadbackQueue.hpp"
+#include <algorithm>
+#include <cassert>
+
+constexpr size_t GLReadbackQueue::DEFAULT_COUNT;
+
+//------------------------------------------------------------------------------
+//! \brief Return the number of bytes of a channel of the given type.
+//------------------------------------------------------------------------------
+static size_t channelSize(GLenum const type)
+{
+    switch (type)
+    {
+    case GL_UNSIGNED_SHORT:
+    case GL_SHORT:
+    case GL_HALF_FLOAT:
+        return 2u;
+    case GL_UNSIGNED_INT:
+    case GL_INT:
+    case GL_FLOAT:
+        return 4u;
+    default:
+        return 1u;
+    }
+}
+
+//------------------------------------------------------------------------------
+//! \brief Return the number of channels of the given format.
+//------------------------------------------------------------------------------
+static size_t channelCount(GLenum const format)
+{
+    switch (format)
+    {
+    case GL_RGBA:
+    case GL_BGRA:
+        return 4u;
+    case GL_RGB:
+    case GL_BGR:
+        return 3u;
+    case GL_RG:
+        return 2u;
+    default:
+        return 1u;
+    }
+}
+
+//------------------------------------------------------------------------------
+//! \brief Return the number of bytes of a pixel of the given format and type.
+//! Packed types (ie GL_UNSIGNED_SHORT_5_6_5) hold the whole pixel.
+//------------------------------------------------------------------------------
+static size_t pixelSize(GLenum const format, GLenum const type)
+{
+    switch (type)
+    {
+    case GL_UNSIGNED_BYTE_3_3_2:
+    case GL_UNSIGNED_BYTE_2_3_3_REV:
+        return 1u;
+    case GL_UNSIGNED_SHORT_5_6_5:
+    case GL_UNSIGNED_SHORT_5_6_5_REV:
+    case GL_UNSIGNED_SHORT_4_4_4_4:
+    case GL_UNSIGNED_SHORT_4_4_4_4_REV:
+    case GL_UNSIGNED_SHORT_5_5_5_1:
+    case GL_UNSIGNED_SHORT_1_5_5_5_REV:
+        return 2u;
+    case GL_UNSIGNED_INT_8_8_8_8:
+    case GL_UNSIGNED_INT_8_8_8_8_REV:
+    case GL_UNSIGNED_INT_10_10_10_2:
+    case GL_UNSIGNED_INT_2_10_10_10_REV:
+    case GL_UNSIGNED_INT_10F_11F_11F_REV:
+    case GL_UNSIGNED_INT_5_9_9_9_REV:
+    case GL_UNSIGNED_INT_24_8:
+        return 4u;
+    case GL_FLOAT_32_UNSIGNED_INT_24_8_REV:
+        return 8u;
+    default:
+        return channelCount(format) * channelSize(type);
+    }
+}
+
+//------------------------------------------------------------------------------
+GLReadbackQueue::GLReadbackQueue(size_t const count)
+    : m_slots(count), m_current(count - 1u)
+{
+    assert(count > 0u);
+}
+
+//------------------------------------------------------------------------------
+GLReadbackQueue::~GLReadbackQueue()
+{
+    for (auto& it: m_slots)
+    {
+        if (it.fence != nullptr)
+        {
+            glCheck(glDeleteSync(it.fence));
+        }
+        if (it.pbo != 0u)
+        {
+            glCheck(glDeleteBuffers(1, &it.pbo));
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+GLReadbackQueue::Slot& GLReadbackQueue::acquire(size_t const bytes)
+{
+    // Take the next free PBO of the ring. Grow the ring rather than waiting
+    // for a pending copy.
+    size_t i = 0u;
+    while ((i < m_slots.size()) &&
+           (m_slots[(m_current + 1u + i) % m_slots.size()].ticket != 0u))
+    {
+        ++i;
+    }
+
+    if (i == m_slots.size())
+    {
+        m_slots.emplace_back();
+        m_current = m_slots.size() - 1u;
+    }
+    else
+    {
+        m_current = (m_current + 1u + i) % m_slots.size();
+    }
+
+    Slot& slot = m_slots[m_current];
+    if (slot.pbo == 0u)
+    {
+        glCheck(glGenBuffers(1, &slot.pbo));
+    }
+
+    glCheck(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo));
+    if (slot.capacity < bytes)
+    {
+        glCheck(glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(bytes),
+                             nullptr, GL_STREAM_READ));
+        slot.capacity = bytes;
+    }
+    glCheck(glGetIntegerv(GL_PACK_ALIGNMENT, &m_pack_alignment));
+    glCheck(glPixelStorei(GL_PACK_ALIGNMENT, 1));
+    return slot;
+}
+
+//------------------------------------------------------------------------------
+GLReadbackQueue::Ticket GLReadbackQueue::submit(Slot& slot, size_t const bytes,
+                                                Callback const& callback)
+{
+    glCheck(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0u));
+    glCheck(glPixelStorei(GL_PACK_ALIGNMENT, m_pack_alignment));
+
+    // Flush for the fence to be signaled without waiting for another command
+    // forcing the flush.
+    glCheck(slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+    glCheck(glFlush());
+
+    slot.ticket = ++m_ticket;
+    slot.bytes = bytes;
+    slot.callback = callback;
+    return slot.ticket;
+}
+
+//------------------------------------------------------------------------------
+GLReadbackQueue::Ticket GLReadbackQueue::requestReadback(GLTexture& texture,
+                                                         Callback const& callback)
+{
+    if (texture.m_need_create || texture.m_need_setup)
+    {
+        throw GL::Exception("Texture '" + texture.name() +
+                            "' has not been specified to OpenGL");
+    }
+    if (texture.compressed())
+    {
+        throw GL::Exception("Texture '" + texture.name() +
+                            "' holds block-compressed texels");
+    }
+
+    GLenum const target = texture.target();
+    if ((target != GL_TEXTURE_1D) && (target != GL_TEXTURE_2D) &&
+        (target != GL_TEXTURE_3D) && (target != GL_TEXTURE_2D_ARRAY))
+    {
+        throw GL::Exception("Texture '" + texture.name() +
+                            "' cannot be read back with a single copy");
+    }
+
+    GLenum const format = static_cast<GLenum>(texture.m_cpuPixelFormat);
+    GLenum const type = static_cast<GLenum>(texture.m_cpuPixelType);
+    size_t const bytes = texture.m_width * std::max(size_t(1u), texture.m_height)
+                       * std::max(size_t(1u), texture.m_depth)
+                       * pixelSize(format, type);
+
+    Slot& slot = acquire(bytes);
+    glCheck(glBindTexture(target, texture.handle()));
+    glCheck(glGetTexImage(target, 0, format, type, nullptr));
+    glCheck(glBindTexture(target, 0u));
+    return submit(slot, bytes, callback);
+}
+
+//------------------------------------------------------------------------------
+GLReadbackQueue::Ticket GLReadbackQueue::requestReadback(GLFrameBuffer& framebuffer,
+                                                         size_t const color,
+                                                         Callback const& callback,
+                                                         GLenum const format,
+                                                         GLenum const type)
+{
+    if (framebuffer.m_need_create)
+    {
+        throw GL::Exception("Framebuffer '" + framebuffer.name() +
+                            "' has not been created");
+    }
+    if (color >= framebuffer.m_color_buffers.size())
+    {
+        throw GL::Exception("Framebuffer '" + framebuffer.name() +
+                            "' has no color buffer " + std::to_string(color));
+    }
+
+    size_t const bytes = size_t(framebuffer.width()) * size_t(framebuffer.height())
+                       * pixelSize(format, type);
+
+    Slot& slot = acquire(bytes);
+    glCheck(glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer.handle()));
+    glCheck(glReadBuffer(GLenum(GL_COLOR_ATTACHMENT0 + color)));
+    glCheck(glReadPixels(0, 0, static_cast<GLsizei>(framebuffer.width()),
+                         static_cast<GLsizei>(framebuffer.height()),
+                         format, type, nullptr));
+    glCheck(glBindFramebuffer(GL_READ_FRAMEBUFFER, 0u));
+    return submit(slot, bytes, callback);
+}
+
+//------------------------------------------------------------------------------
+GLReadbackQueue::Ticket GLReadbackQueue::requestReadback(size_t const width,
+                                                         size_t const height,
+                                                         Callback const& callback,
+                                                         GLenum const format,
+                                                         GLenum const type)
+{
+    size_t const bytes = width * height * pixelSize(format, type);
+
+    Slot& slot = acquire(bytes);
+    glCheck(glBindFramebuffer(GL_READ_FRAMEBUFFER, 0u));
+    glCheck(glReadBuffer(GL_BACK));
+    glCheck(glReadPixels(0, 0, static_cast<GLsizei>(width),
+                         static_cast<GLsizei>(height),
+                         format, type, nullptr));
+    return submit(slot, bytes, callback);
+}
+
+//------------------------------------------------------------------------------
+bool GLReadbackQueue::signaled(Slot& slot, GLuint64 const timeout)
+{
+    if (timeout == 0u)
+    {
+        GLint status = GL_UNSIGNALED;
+        glCheck(glGetSynciv(slot.fence, GL_SYNC_STATUS, 1, nullptr, &status));
+        return status == GL_SIGNALED;
+    }
+
+    GLenum const res = wait(slot, timeout);
+    return (res == GL_ALREADY_SIGNALED) || (res == GL_CONDITION_SATISFIED);
+}
+
+//------------------------------------------------------------------------------
+GLenum GLReadbackQueue::wait(Slot& slot, GLuint64 const timeout)
+{
+    GLenum res = GL_WAIT_FAILED;
+    glCheck(res = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout));
+    return res;
+}
+
+//------------------------------------------------------------------------------
+void GLReadbackQueue::deliver(Slot& slot, Callback const& callback)
+{
+    glCheck(glDeleteSync(slot.fence));
+    slot.fence = nullptr;
+
+    glCheck(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo));
+    void* texels = nullptr;
+    glCheck(texels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+                                      static_cast<GLsizeiptr>(slot.bytes),
+                                      GL_MAP_READ_BIT));
+    if (texels != nullptr)
+    {
+        if (callback != nullptr)
+        {
+            callback(slot.ticket, static_cast<const unsigned char*>(texels), slot.bytes);
+
+            // The callback may have requested another readback
+            glCheck(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo));
+        }
+        glCheck(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+    }
+    else
+    {
+        std::cerr << "Failed mapping the texels of the readback "
+                  << slot.ticket << std::endl;
+    }
+    glCheck(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0u));
+
+    slot.ticket = 0u;
+    slot.bytes = 0u;
+    slot.callback = nullptr;
+}
+
+//------------------------------------------------------------------------------
+void GLReadbackQueue::drop(Slot& slot)
+{
+    if (slot.fence != nullptr)
+    {
+        glCheck(glDeleteSync(slot.fence));
+        slot.fence = nullptr;
+    }
+
+    slot.ticket = 0u;
+    slot.bytes = 0u;
+    slot.callback = nullptr;
+}
+
+//------------------------------------------------------------------------------
+size_t GLReadbackQueue::poll()
+{
+    // Deliver in the order of requests: fences are signaled in this order.
+    Slot* slot = oldest();
+    while ((slot != nullptr) && signaled(*slot, 0u))
+    {
+        Callback const callback = slot->callback;
+        deliver(*slot, callback);
+        slot = oldest();
+    }
+    return pending();
+}
+
+//------------------------------------------------------------------------------
+void GLReadbackQueue::finish()
+{
+    Slot* slot = oldest();
+    while (slot != nullptr)
+    {
+        // Wait for at most 1 second before checking the fence again.
+        GLenum const res = wait(*slot, 1000000000u);
+        if ((res == GL_ALREADY_SIGNALED) || (res == GL_CONDITION_SATISFIED))
+        {
+            Callback const callback = slot->callback;
+            deliver(*slot, callback);
+        }
+        else if (res == GL_WAIT_FAILED)
+        {
+            // Waiting again would fail forever.
+            std::cerr << "Failed waiting for the readback " << slot->ticket
+                      << ". Dropped" << std::endl;
+            drop(*slot);
+        }
+        slot = oldest();
+    }
+}
+
+//------------------------------------------------------------------------------
+bool GLReadbackQueue::ready(Ticket const ticket)
+{
+    Slot* slot = find(ticket);
+    return (slot != nullptr) && signaled(*slot, 0u);
+}
+
+//------------------------------------------------------------------------------
+bool GLReadbackQueue::read(Ticket const ticket, std::vector<unsigned char>& texels)
+{
+    Slot* slot = find(ticket);
+    if ((slot == nullptr) || (!signaled(*slot, 0u)))
+        return false;
+
+    bool copied = false;
+    deliver(*slot, [&texels, &copied](Ticket const, const unsigned char* data,
+                                      size_t const bytes)
+    {
+        texels.assign(data, data + bytes);
+        copied = true;
+    });
+    return copied;
+}
+
+//------------------------------------------------------------------------------
+size_t GLReadbackQueue::pending() const
+{
+    return static_cast<size_t>(std::count_if(m_slots.begin(), m_slots.end(),
+                                             [](Slot const& slot)
+                                             {
+                                                 return slot.ticket != 0u;
+                                             }));
+}
+
+//------------------------------------------------------------------------------
+GLReadbackQueue::Slot* GLReadbackQueue::find(Ticket const ticket)
+{
+    if (ticket == 0u)
+        return nullptr;
+
+    for (auto& it: m_slots)
+    {
+        if (it.ticket == ticket)
+            return &it;
+    }
+    return nullptr;
+}
+
+//------------------------------------------------------------------------------
+GLReadbackQueue::Slot* GLReadbackQueue::oldest()
+{
+    Slot* slot = nullptr;
+    for (auto& it: m_slots)
+    {
+        if ((it.ticket != 0u) && ((slot == nullptr) || (it.ticket < slot->ticket)))
+            slot = &it;
+    }
+    return slot;
+}
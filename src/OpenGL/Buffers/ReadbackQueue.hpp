@@ -0,0 +1,254 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#ifndef OPENGLCPPWRAPPER_GLREADBACK_QUEUE_HPP
+#  define OPENGLCPPWRAPPER_GLREADBACK_QUEUE_HPP
+
+#  include "OpenGL/Buffers/FrameBuffers.hpp"
+#  include "Common/NonCppStd.hpp"
+#  include <deque>
+#  include <functional>
+#  include <vector>
+
+// *****************************************************************************
+//! \brief Asynchronous transfer of texels from the GPU to the CPU.
+//!
+//! GLTexture::repatriate() and glReadPixels() with client memory stall the CPU
+//! until the GPU has executed all previous commands. A readback request here
+//! instead copies texels into a pixel pack buffer (PBO) taken from a ring and
+//! inserts a fence after the copy. The request returns at once with a ticket.
+//! poll(), typically called once per frame, checks the fences without waiting
+//! and gives the mapped texels of completed copies to their callback (usually
+//! one or two frames later). Texels can also be fetched with read().
+//!
+//! \code
+//!   GLReadbackQueue readbacks;
+//!   // After rendering into the framebuffer
+//!   readbacks.requestReadback(framebuffer, 0u, [](GLReadbackQueue::Ticket,
+//!                             const unsigned char* texels, size_t bytes)
+//!   {
+//!       // analyze texels
+//!   });
+//!   // Each frame
+//!   readbacks.poll();
+//! \endcode
+//!
+//! \note All methods shall be called from the thread owning the OpenGL context.
+// *****************************************************************************
+class GLReadbackQueue : private NonCopyable
+{
+public:
+
+    //--------------------------------------------------------------------------
+    //! \brief Identifier of a readback request. 0 is never a valid ticket.
+    //--------------------------------------------------------------------------
+    using Ticket = size_t;
+
+    //--------------------------------------------------------------------------
+    //! \brief Function receiving the texels of a completed request. Texels are
+    //! the mapped memory of the PBO: they are only valid during the call.
+    //--------------------------------------------------------------------------
+    using Callback = std::function<void(Ticket const ticket,
+                                        const unsigned char* texels,
+                                        size_t const bytes)>;
+
+    //--------------------------------------------------------------------------
+    //! \brief Default number of PBOs in the ring.
+    //--------------------------------------------------------------------------
+    static constexpr size_t DEFAULT_COUNT = 3u;
+
+    //--------------------------------------------------------------------------
+    //! \brief Define the ring. PBOs are created lazily by requests.
+    //!
+    //! \param count the initial number of PBOs. The ring grows when all PBOs
+    //! are still waited for instead of stalling the CPU. Shall be > 0.
+    //--------------------------------------------------------------------------
+    explicit GLReadbackQueue(size_t const count = DEFAULT_COUNT);
+
+    //--------------------------------------------------------------------------
+    //! \brief Drop pending requests and destroy PBOs and fences.
+    //--------------------------------------------------------------------------
+    ~GLReadbackQueue();
+
+    //--------------------------------------------------------------------------
+    //! \brief Request the texels of the first level of the texture, in the
+    //! CPU pixel format and type of the texture. The texture shall have been
+    //! specified to OpenGL (ie drawn or begin() called).
+    //!
+    //! \param texture a 1D, 2D, 3D or 2D array texture with uncompressed
+    //! texels.
+    //! \param callback optional function called by poll() when the texels are
+    //! available.
+    //! \return the ticket of the request.
+    //! \throw GL::Exception if the texture cannot be read back.
+    //--------------------------------------------------------------------------
+    Ticket requestReadback(GLTexture& texture, Callback const& callback = nullptr);
+
+    //--------------------------------------------------------------------------
+    //! \brief Request the texels of a color attachment of the framebuffer
+    //! through glReadPixels().
+    //!
+    //! \param framebuffer the framebuffer. Shall have been created (ie
+    //! rendered).
+    //! \param color the index of the color attachment.
+    //! \param callback optional function called by poll() when the texels are
+    //! available.
+    //! \param format, type the format of the texels to read.
+    //! \return the ticket of the request.
+    //! \throw GL::Exception if the framebuffer does not hold the attachment.
+    //--------------------------------------------------------------------------
+    Ticket requestReadback(GLFrameBuffer& framebuffer, size_t const color = 0u,
+                           Callback const& callback = nullptr,
+                           GLenum const format = GL_RGBA,
+                           GLenum const type = GL_UNSIGNED_BYTE);
+
+    //--------------------------------------------------------------------------
+    //! \brief Request the texels of the back buffer of the default framebuffer
+    //! (the window) through glReadPixels(). To be called before swapping
+    //! buffers.
+    //!
+    //! \param width, height the dimension of the window in pixels.
+    //! \param callback optional function called by poll() when the texels are
+    //! available.
+    //! \param format, type the format of the texels to read.
+    //! \return the ticket of the request.
+    //--------------------------------------------------------------------------
+    Ticket requestReadback(size_t const width, size_t const height,
+                           Callback const& callback = nullptr,
+                           GLenum const format = GL_RGBA,
+                           GLenum const type = GL_UNSIGNED_BYTE);
+
+    //--------------------------------------------------------------------------
+    //! \brief Call callbacks of requests whose copy has been completed by the
+    //! GPU, in the order of requests. Never waits for the GPU.
+    //!
+    //! \return the number of requests still pending.
+    //--------------------------------------------------------------------------
+    size_t poll();
+
+    //--------------------------------------------------------------------------
+    //! \brief Wait for all pending requests and call their callbacks. Requests
+    //! whose fence cannot be waited for are dropped with an error message.
+    //--------------------------------------------------------------------------
+    void finish();
+
+    //--------------------------------------------------------------------------
+    //! \brief Return true if the copy of the request has been completed by the
+    //! GPU and its texels can be read. Never waits for the GPU.
+    //--------------------------------------------------------------------------
+    bool ready(Ticket const ticket);
+
+    //--------------------------------------------------------------------------
+    //! \brief Copy the texels of a ready request and remove the request from
+    //! the queue (its callback is not called). Never waits for the GPU.
+    //!
+    //! \return false if the request is not ready or is unknown.
+    //--------------------------------------------------------------------------
+    bool read(Ticket const ticket, std::vector<unsigned char>& texels);
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of requests not yet delivered.
+    //--------------------------------------------------------------------------
+    size_t pending() const;
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of PBOs in the ring.
+    //--------------------------------------------------------------------------
+    inline size_t count() const
+    {
+        return m_slots.size();
+    }
+
+private:
+
+    //--------------------------------------------------------------------------
+    //! \brief A PBO of the ring and the request using it.
+    //--------------------------------------------------------------------------
+    struct Slot
+    {
+        GLuint pbo = 0u;
+        //! \brief Bytes allocated for the PBO.
+        size_t capacity = 0u;
+        //! \brief Signaled when the GPU has copied texels into the PBO.
+        GLsync fence = nullptr;
+        //! \brief Request using the PBO (0 if free).
+        Ticket ticket = 0u;
+        //! \brief Number of bytes of the request.
+        size_t bytes = 0u;
+        Callback callback;
+    };
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the next free PBO of the ring (grow the ring if none),
+    //! bound to GL_PIXEL_PACK_BUFFER with at least the given size.
+    //--------------------------------------------------------------------------
+    Slot& acquire(size_t const bytes);
+
+    //--------------------------------------------------------------------------
+    //! \brief Unbind the PBO, insert the fence and register the request.
+    //--------------------------------------------------------------------------
+    Ticket submit(Slot& slot, size_t const bytes, Callback const& callback);
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the slot of the given request or nullptr.
+    //--------------------------------------------------------------------------
+    Slot* find(Ticket const ticket);
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the slot of the oldest pending request or nullptr.
+    //--------------------------------------------------------------------------
+    Slot* oldest();
+
+    //--------------------------------------------------------------------------
+    //! \brief Check the fence of the slot. Wait for it if timeout != 0.
+    //--------------------------------------------------------------------------
+    bool signaled(Slot& slot, GLuint64 const timeout);
+
+    //--------------------------------------------------------------------------
+    //! \brief Wait for the fence of the slot and return the result of
+    //! glClientWaitSync().
+    //--------------------------------------------------------------------------
+    GLenum wait(Slot& slot, GLuint64 const timeout);
+
+    //--------------------------------------------------------------------------
+    //! \brief Map the PBO of a signaled slot, give its texels to the function
+    //! and free the slot.
+    //--------------------------------------------------------------------------
+    void deliver(Slot& slot, Callback const& callback);
+
+    //--------------------------------------------------------------------------
+    //! \brief Free the slot of a request which will never be delivered.
+    //--------------------------------------------------------------------------
+    void drop(Slot& slot);
+
+private:
+
+    //! \brief The ring of PBOs. A deque for keeping references on slots while
+    //! callbacks request new readbacks.
+    std::deque<Slot> m_slots;
+    //! \brief Index of the last acquired slot.
+    size_t m_current;
+    //! \brief Ticket of the last request.
+    Ticket m_ticket = 0u;
+    //! \brief GL_PACK_ALIGNMENT saved by acquire() and restored by submit().
+    GLint m_pack_alignment = 4;
+};
+
+#endif // OPENGLCPPWRAPPER_GLREADBACK_QUEUE_HPP
@@ -0,0 +1,433 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "OpenGL/Buffers/RenderGraph.hpp"
+#include <algorithm>
+#include <set>
+
+constexpr size_t GLRenderGraph::NONE;
+
+//------------------------------------------------------------------------------
+GLRenderGraph::Pass::Pass(GLRenderGraph& graph, std::string const& name,
+                          size_t const index)
+    : m_graph(graph), m_name(name), m_index(index)
+{}
+
+//------------------------------------------------------------------------------
+GLRenderGraph::Pass& GLRenderGraph::Pass::read(Resource const resource)
+{
+    m_graph.check(resource);
+    if (std::find(m_writes.begin(), m_writes.end(), resource) != m_writes.end())
+    {
+        throw GL::Exception("Pass '" + m_name + "' cannot read resource '" +
+                            m_graph.m_resources[resource].name +
+                            "' it renders into");
+    }
+
+    if (std::find(m_reads.begin(), m_reads.end(), resource) == m_reads.end())
+    {
+        m_reads.push_back(resource);
+        m_graph.m_compiled = false;
+    }
+    return *this;
+}
+
+//------------------------------------------------------------------------------
+GLRenderGraph::Pass& GLRenderGraph::Pass::write(Resource const resource)
+{
+    m_graph.check(resource);
+    Info& info = m_graph.m_resources[resource];
+    if (info.writer != NONE)
+    {
+        throw GL::Exception("Resource '" + info.name + "' is already written by pass '" +
+                            m_graph.m_passes[info.writer]->m_name + "'");
+    }
+    if (std::find(m_reads.begin(), m_reads.end(), resource) != m_reads.end())
+    {
+        throw GL::Exception("Pass '" + m_name + "' cannot render into resource '" +
+                            info.name + "' it reads");
+    }
+    if (info.desc.depth())
+    {
+        for (auto const& it: m_writes)
+        {
+            if (m_graph.m_resources[it].desc.depth())
+            {
+                throw GL::Exception("Pass '" + m_name + "' already renders into "
+                                    "a depth resource");
+            }
+        }
+    }
+
+    info.writer = m_index;
+    m_writes.push_back(resource);
+    m_graph.m_compiled = false;
+    return *this;
+}
+
+//------------------------------------------------------------------------------
+GLRenderGraph::Pass& GLRenderGraph::Pass::screen()
+{
+    m_screen = true;
+    m_graph.m_compiled = false;
+    return *this;
+}
+
+//------------------------------------------------------------------------------
+GLRenderGraph::Pass& GLRenderGraph::Pass::execute(Execute const& execute)
+{
+    m_execute = execute;
+    return *this;
+}
+
+//------------------------------------------------------------------------------
+GLRenderGraph::GLRenderGraph(GLRenderTargetPool& pool)
+    : m_pool(pool)
+{}
+
+//------------------------------------------------------------------------------
+void GLRenderGraph::check(Resource const resource) const
+{
+    if (resource >= m_resources.size())
+    {
+        throw GL::Exception("Unknown render graph resource " + std::to_string(resource));
+    }
+}
+
+//------------------------------------------------------------------------------
+GLRenderGraph::Resource GLRenderGraph::create(std::string const& name,
+                                              GLRenderTargetPool::Desc const& desc)
+{
+    m_resources.emplace_back();
+    m_resources.back().name = name;
+    m_resources.back().desc = desc;
+    m_compiled = false;
+    return m_resources.size() - 1u;
+}
+
+//------------------------------------------------------------------------------
+GLRenderGraph::Pass& GLRenderGraph::addPass(std::string const& name)
+{
+    m_passes.emplace_back(new Pass(*this, name, m_passes.size()));
+    m_compiled = false;
+    return *m_passes.back();
+}
+
+//------------------------------------------------------------------------------
+void GLRenderGraph::output(Resource const resource)
+{
+    check(resource);
+    m_resources[resource].output = true;
+    m_compiled = false;
+}
+
+//------------------------------------------------------------------------------
+void GLRenderGraph::compile()
+{
+    m_schedule.clear();
+    m_slots = 0u;
+    for (auto& it: m_resources)
+    {
+        it.slot = NONE;
+    }
+
+    // Culling: keep passes rendering into the screen or into outputs, then
+    // passes producing what kept passes read.
+    std::vector<size_t> stack;
+    for (auto& pass: m_passes)
+    {
+        if (pass->m_screen && !pass->m_writes.empty())
+        {
+            throw GL::Exception("Pass '" + pass->m_name + "' cannot render both "
+                                "into the screen and into resources");
+        }
+
+        pass->m_culled = true;
+        bool root = pass->m_screen;
+        for (auto const& it: pass->m_writes)
+        {
+            root |= m_resources[it].output;
+        }
+        if (root)
+        {
+            pass->m_culled = false;
+            stack.push_back(pass->m_index);
+        }
+    }
+
+    while (!stack.empty())
+    {
+        Pass& pass = *m_passes[stack.back()];
+        stack.pop_back();
+        for (auto const& it: pass.m_reads)
+        {
+            size_t const writer = m_resources[it].writer;
+            if (writer == NONE)
+            {
+                throw GL::Exception("Resource '" + m_resources[it].name + "' read by pass '" +
+                                    pass.m_name + "' is never written");
+            }
+            if (m_passes[writer]->m_culled)
+            {
+                m_passes[writer]->m_culled = false;
+                stack.push_back(writer);
+            }
+        }
+    }
+
+    // Topological sort of kept passes. Ties are broken by the order of
+    // declaration for a predictable schedule.
+    std::vector<size_t> dependencies(m_passes.size(), 0u);
+    std::vector<std::vector<size_t>> dependents(m_passes.size());
+    std::set<size_t> ready;
+    size_t kept = 0u;
+    for (auto const& pass: m_passes)
+    {
+        if (pass->m_culled)
+            continue;
+
+        ++kept;
+        std::set<size_t> writers;
+        for (auto const& it: pass->m_reads)
+        {
+            writers.insert(m_resources[it].writer);
+        }
+        for (auto const& writer: writers)
+        {
+            dependents[writer].push_back(pass->m_index);
+        }
+        dependencies[pass->m_index] = writers.size();
+        if (writers.empty())
+        {
+            ready.insert(pass->m_index);
+        }
+    }
+
+    while (!ready.empty())
+    {
+        size_t const index = *ready.begin();
+        ready.erase(ready.begin());
+        m_schedule.push_back({ index, {}, {} });
+        for (auto const& it: dependents[index])
+        {
+            if (--dependencies[it] == 0u)
+            {
+                ready.insert(it);
+            }
+        }
+    }
+
+    if (m_schedule.size() != kept)
+    {
+        m_schedule.clear();
+        throw GL::Exception("Render passes depend on each other");
+    }
+
+    // Lifetimes: from the pass writing the resource to the last pass reading
+    // it. Outputs live until the end of the frame.
+    std::vector<size_t> step(m_passes.size(), NONE);
+    for (size_t i = 0u; i < m_schedule.size(); ++i)
+    {
+        step[m_schedule[i].pass] = i;
+    }
+
+    std::vector<size_t> last(m_resources.size(), NONE);
+    for (size_t i = 0u; i < m_schedule.size(); ++i)
+    {
+        Pass const& pass = *m_passes[m_schedule[i].pass];
+        for (auto const& it: pass.m_writes)
+        {
+            last[it] = i;
+        }
+        for (auto const& it: pass.m_reads)
+        {
+            last[it] = std::max(last[it], i);
+        }
+    }
+
+    // Aliasing: a resource takes the storage of a resource with the same
+    // description whose lifetime has ended.
+    std::vector<GLRenderTargetPool::Desc> descs;
+    std::vector<bool> available;
+    for (size_t i = 0u; i < m_schedule.size(); ++i)
+    {
+        Step& current = m_schedule[i];
+        for (auto const& it: m_passes[current.pass]->m_writes)
+        {
+            Info& info = m_resources[it];
+            size_t s = 0u;
+            while ((s < descs.size()) && !(available[s] && (descs[s] == info.desc)))
+            {
+                ++s;
+            }
+            if (s == descs.size())
+            {
+                descs.push_back(info.desc);
+                available.push_back(false);
+            }
+            available[s] = false;
+            info.slot = s;
+            current.acquire.push_back(it);
+        }
+
+        for (size_t r = 0u; r < m_resources.size(); ++r)
+        {
+            if ((last[r] == i) && (!m_resources[r].output))
+            {
+                available[m_resources[r].slot] = true;
+                current.invalidate.push_back(r);
+            }
+        }
+    }
+
+    m_slots = descs.size();
+    m_compiled = true;
+}
+
+//------------------------------------------------------------------------------
+void GLRenderGraph::execute()
+{
+    if (!m_compiled)
+    {
+        compile();
+    }
+
+    // Outputs of the previous frame have been handed back by
+    // GLRenderTargetPool::frame().
+    for (auto& it: m_resources)
+    {
+        it.target = nullptr;
+        it.framebuffer = nullptr;
+    }
+
+    for (auto const& step: m_schedule)
+    {
+        for (auto const& it: step.acquire)
+        {
+            m_resources[it].target = &m_pool.acquire(m_resources[it].desc);
+        }
+
+        render(*m_passes[step.pass]);
+        invalidate(step.invalidate);
+
+        for (auto const& it: step.invalidate)
+        {
+            m_pool.release(*m_resources[it].target);
+            m_resources[it].target = nullptr;
+            m_resources[it].framebuffer = nullptr;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void GLRenderGraph::render(Pass& pass)
+{
+    if (pass.m_writes.empty())
+    {
+        glCheck(glBindFramebuffer(GL_FRAMEBUFFER, 0u));
+        if (pass.m_execute != nullptr)
+        {
+            pass.m_execute(*this);
+        }
+        return ;
+    }
+
+    std::vector<GLRenderTargetPool::Target*> colors;
+    GLRenderTargetPool::Target* depth = nullptr;
+    for (auto const& it: pass.m_writes)
+    {
+        if (m_resources[it].desc.depth())
+            depth = m_resources[it].target;
+        else
+            colors.push_back(m_resources[it].target);
+    }
+
+    GLFrameBuffer& framebuffer = m_pool.framebuffer(colors, depth);
+    for (auto const& it: pass.m_writes)
+    {
+        m_resources[it].framebuffer = &framebuffer;
+    }
+
+    framebuffer.render(0u, 0u, framebuffer.width(), framebuffer.height(), [&]()
+    {
+        if (pass.m_execute != nullptr)
+        {
+            pass.m_execute(*this);
+        }
+    });
+}
+
+//------------------------------------------------------------------------------
+void GLRenderGraph::invalidate(std::vector<Resource> const& resources)
+{
+    if (!GLEW_ARB_invalidate_subdata)
+        return ;
+
+    for (auto const& it: resources)
+    {
+        Info const& info = m_resources[it];
+        GLenum attachment;
+        if (info.desc.depth())
+        {
+            attachment = ((info.desc.format == GL_DEPTH24_STENCIL8) ||
+                          (info.desc.format == GL_DEPTH32F_STENCIL8))
+                         ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+        }
+        else
+        {
+            // Color resources are attached in the order of write().
+            GLenum index = 0u;
+            for (auto const& w: m_passes[info.writer]->m_writes)
+            {
+                if (w == it)
+                    break;
+                if (!m_resources[w].desc.depth())
+                    ++index;
+            }
+            attachment = GL_COLOR_ATTACHMENT0 + index;
+        }
+
+        glCheck(glBindFramebuffer(GL_FRAMEBUFFER, info.framebuffer->handle()));
+        glCheck(glInvalidateFramebuffer(GL_FRAMEBUFFER, 1, &attachment));
+    }
+    glCheck(glBindFramebuffer(GL_FRAMEBUFFER, 0u));
+}
+
+//------------------------------------------------------------------------------
+GLRenderTargetPool::Target& GLRenderGraph::target(Resource const resource)
+{
+    check(resource);
+    if (m_resources[resource].target == nullptr)
+    {
+        throw GL::Exception("Resource '" + m_resources[resource].name +
+                            "' is not allocated");
+    }
+    return *m_resources[resource].target;
+}
+
+//------------------------------------------------------------------------------
+void GLRenderGraph::clear()
+{
+    m_passes.clear();
+    m_resources.clear();
+    m_schedule.clear();
+    m_slots = 0u;
+    m_compiled = false;
+}
@@ -0,0 +1,305 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#ifndef OPENGLCPPWRAPPER_GLRENDER_GRAPH_HPP
+#  define OPENGLCPPWRAPPER_GLRENDER_GRAPH_HPP
+
+#  include "OpenGL/Buffers/RenderTargetPool.hpp"
+#  include <functional>
+
+// *****************************************************************************
+//! \brief Frame made of render passes connected by the textures they read and
+//! write.
+//!
+//! Passes declare the transient resources (render targets) they read and
+//! write instead of being wired by hand to GLFrameBuffer::render(). compile()
+//! then:
+//!   - orders passes so that a resource is written before being read;
+//!   - culls passes whose outputs reach neither the screen nor a resource
+//!     marked as output;
+//!   - computes the lifetime of each resource: resources with non-overlapping
+//!     lifetimes and the same description share the same storage (slot);
+//!   - lists the resources whose content can be discarded after each pass.
+//! execute() runs the schedule: resources are acquired from a
+//! GLRenderTargetPool at their first pass, invalidated by
+//! glInvalidateFramebuffer() and handed back to the pool after their last
+//! pass.
+//!
+//! \code
+//!   GLRenderTargetPool pool;
+//!   GLRenderGraph graph(pool);
+//!   auto scene = graph.create("scene", { w, h, GL_RGBA16F });
+//!   auto depth = graph.create("depth", { w, h, GL_DEPTH_COMPONENT24 });
+//!   auto blur = graph.create("blur", { w, h, GL_RGBA16F });
+//!   graph.addPass("scene").write(scene).write(depth)
+//!        .execute([&](GLRenderGraph&) { ... });
+//!   graph.addPass("blur").read(scene).write(blur)
+//!        .execute([&](GLRenderGraph& g) { ... g.texture(scene) ... });
+//!   graph.addPass("screen").read(blur).screen()
+//!        .execute([&](GLRenderGraph& g) { ... g.texture(blur) ... });
+//!   // Each frame
+//!   graph.execute();
+//!   pool.frame();
+//! \endcode
+//!
+//! The graph is compiled once and executed each frame. Declare it again (after
+//! clear()) when descriptions change, ie when the window is resized.
+// *****************************************************************************
+class GLRenderGraph : private NonCopyable
+{
+public:
+
+    //--------------------------------------------------------------------------
+    //! \brief Handle of a resource of the graph.
+    //--------------------------------------------------------------------------
+    using Resource = size_t;
+
+    //--------------------------------------------------------------------------
+    //! \brief Function rendering a pass. Framebuffer holding the resources
+    //! written by the pass is bound and its viewport set.
+    //--------------------------------------------------------------------------
+    using Execute = std::function<void(GLRenderGraph& graph)>;
+
+    //--------------------------------------------------------------------------
+    //! \brief Index meaning "none".
+    //--------------------------------------------------------------------------
+    static constexpr size_t NONE = size_t(-1);
+
+    // *************************************************************************
+    //! \brief A render pass of the graph.
+    // *************************************************************************
+    class Pass : private NonCopyable
+    {
+    public:
+
+        //----------------------------------------------------------------------
+        //! \brief Declare that the pass samples the resource.
+        //! \throw GL::Exception if the resource is unknown or written by this
+        //! pass.
+        //----------------------------------------------------------------------
+        Pass& read(Resource const resource);
+
+        //----------------------------------------------------------------------
+        //! \brief Declare that the pass renders into the resource: color
+        //! resources are attached in the order of declaration, the depth
+        //! resource to the depth attachment.
+        //! \throw GL::Exception if the resource is unknown, already written by
+        //! a pass or read by this pass, or if the pass already writes a depth
+        //! resource.
+        //----------------------------------------------------------------------
+        Pass& write(Resource const resource);
+
+        //----------------------------------------------------------------------
+        //! \brief Declare that the pass renders into the default framebuffer
+        //! (the window). Such passes are never culled.
+        //----------------------------------------------------------------------
+        Pass& screen();
+
+        //----------------------------------------------------------------------
+        //! \brief Set the function rendering the pass.
+        //----------------------------------------------------------------------
+        Pass& execute(Execute const& execute);
+
+        inline std::string const& name() const
+        {
+            return m_name;
+        }
+
+        //----------------------------------------------------------------------
+        //! \brief Return true if compile() has removed the pass from the
+        //! schedule.
+        //----------------------------------------------------------------------
+        inline bool culled() const
+        {
+            return m_culled;
+        }
+
+    private:
+
+        friend class GLRenderGraph;
+
+        Pass(GLRenderGraph& graph, std::string const& name, size_t const index);
+
+    private:
+
+        GLRenderGraph& m_graph;
+        std::string m_name;
+        size_t m_index;
+        std::vector<Resource> m_reads;
+        std::vector<Resource> m_writes;
+        bool m_screen = false;
+        bool m_culled = false;
+        Execute m_execute;
+    };
+
+    // *************************************************************************
+    //! \brief A pass of the compiled schedule.
+    // *************************************************************************
+    struct Step
+    {
+        //! \brief Index of the pass (in the order of addPass()).
+        size_t pass;
+        //! \brief Resources whose lifetime starts with this pass.
+        std::vector<Resource> acquire;
+        //! \brief Resources whose lifetime ends with this pass: their content
+        //! is discarded and their storage reused by later passes.
+        std::vector<Resource> invalidate;
+    };
+
+    //--------------------------------------------------------------------------
+    //! \brief Empty graph allocating its resources from the given pool.
+    //--------------------------------------------------------------------------
+    explicit GLRenderGraph(GLRenderTargetPool& pool);
+
+    //--------------------------------------------------------------------------
+    //! \brief Declare a transient resource.
+    //--------------------------------------------------------------------------
+    Resource create(std::string const& name, GLRenderTargetPool::Desc const& desc);
+
+    //--------------------------------------------------------------------------
+    //! \brief Declare a new pass. Passes may be declared in any order.
+    //--------------------------------------------------------------------------
+    Pass& addPass(std::string const& name);
+
+    //--------------------------------------------------------------------------
+    //! \brief Keep the resource (and the passes producing it) until the end of
+    //! the frame, ie for reading it back with target().
+    //--------------------------------------------------------------------------
+    void output(Resource const resource);
+
+    //--------------------------------------------------------------------------
+    //! \brief Sort, cull passes and compute lifetimes of resources.
+    //! \throw GL::Exception if a used resource is never written or if passes
+    //! depend on each other.
+    //--------------------------------------------------------------------------
+    void compile();
+
+    //--------------------------------------------------------------------------
+    //! \brief Render the passes of the schedule. Compile the graph if needed.
+    //--------------------------------------------------------------------------
+    void execute();
+
+    //--------------------------------------------------------------------------
+    //! \brief Remove all passes and resources.
+    //--------------------------------------------------------------------------
+    void clear();
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the compiled schedule.
+    //--------------------------------------------------------------------------
+    inline std::vector<Step> const& schedule() const
+    {
+        return m_schedule;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the pass of the given index.
+    //--------------------------------------------------------------------------
+    inline Pass const& pass(size_t const index) const
+    {
+        return *m_passes[index];
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of declared passes.
+    //--------------------------------------------------------------------------
+    inline size_t passes() const
+    {
+        return m_passes.size();
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the storage shared by the resource once compiled (NONE
+    //! for resources of culled passes).
+    //--------------------------------------------------------------------------
+    inline size_t slot(Resource const resource) const
+    {
+        return m_resources[resource].slot;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of storages needed by the compiled graph.
+    //--------------------------------------------------------------------------
+    inline size_t slots() const
+    {
+        return m_slots;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the render target holding the resource. Only valid
+    //! during execute() between the first and last passes using the resource,
+    //! or after execute() for output resources.
+    //! \throw GL::Exception if the resource is not allocated.
+    //--------------------------------------------------------------------------
+    GLRenderTargetPool::Target& target(Resource const resource);
+
+    //--------------------------------------------------------------------------
+    //! \brief Shortcut for target(resource).texture().
+    //--------------------------------------------------------------------------
+    inline GLTexture2D& texture(Resource const resource)
+    {
+        return target(resource).texture();
+    }
+
+private:
+
+    //--------------------------------------------------------------------------
+    //! \brief Resource of the graph.
+    //--------------------------------------------------------------------------
+    struct Info
+    {
+        std::string name;
+        GLRenderTargetPool::Desc desc;
+        size_t writer = NONE;
+        bool output = false;
+        //! \brief Compiled storage.
+        size_t slot = NONE;
+        //! \brief Allocated target during execute().
+        GLRenderTargetPool::Target* target = nullptr;
+        //! \brief Framebuffer the resource has been rendered into.
+        GLFrameBuffer* framebuffer = nullptr;
+    };
+
+    //--------------------------------------------------------------------------
+    //! \brief Throw if the resource is unknown.
+    //--------------------------------------------------------------------------
+    void check(Resource const resource) const;
+
+    //--------------------------------------------------------------------------
+    //! \brief Render a pass of the schedule into its framebuffer.
+    //--------------------------------------------------------------------------
+    void render(Pass& pass);
+
+    //--------------------------------------------------------------------------
+    //! \brief Discard the content of resources at the end of their lifetime.
+    //--------------------------------------------------------------------------
+    void invalidate(std::vector<Resource> const& resources);
+
+private:
+
+    GLRenderTargetPool& m_pool;
+    std::vector<std::unique_ptr<Pass>> m_passes;
+    std::vector<Info> m_resources;
+    std::vector<Step> m_schedule;
+    size_t m_slots = 0u;
+    bool m_compiled = false;
+};
+
+#endif // OPENGLCPPWRAPPER_GLRENDER_GRAPH_HPP
@@ -0,0 +1,304 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "OpenGL/Buffers/RenderTargetPool.hpp"
+#include "OpenGL/Buffers/GPUMemory.hpp"
+#include <algorithm>
+
+constexpr size_t GLRenderTargetPool::DEFAULT_MAX_IDLE_FRAMES;
+
+// *****************************************************************************
+//! \brief Texture of a single-sample color target: texels are never given by
+//! the CPU, only the sized internal format matters.
+// *****************************************************************************
+class GLRenderTexture: public GLTexture2D
+{
+public:
+
+    GLRenderTexture(std::string const& name, GLenum const format)
+        : GLTexture2D(name)
+    {
+        m_gpuPixelFormat = static_cast<GLint>(format);
+        // Passes sample the whole target: no mipmaps, no repetition.
+        m_options.minFilter = Minification::LINEAR;
+        m_options.magFilter = Magnification::LINEAR;
+        wrap(Wrap::CLAMP_TO_EDGE);
+    }
+};
+
+//------------------------------------------------------------------------------
+bool GLRenderTargetPool::Desc::depth() const
+{
+    switch (format)
+    {
+    case GL_DEPTH_COMPONENT:
+    case GL_DEPTH_COMPONENT16:
+    case GL_DEPTH_COMPONENT24:
+    case GL_DEPTH_COMPONENT32:
+    case GL_DEPTH_COMPONENT32F:
+    case GL_DEPTH_STENCIL:
+    case GL_DEPTH24_STENCIL8:
+    case GL_DEPTH32F_STENCIL8:
+        return true;
+    default:
+        return false;
+    }
+}
+
+//------------------------------------------------------------------------------
+size_t GLRenderTargetPool::Desc::bytes() const
+{
+    size_t texel;
+    switch (format)
+    {
+    case GL_R8:
+        texel = 1u;
+        break;
+    case GL_RG8:
+    case GL_R16F:
+    case GL_DEPTH_COMPONENT16:
+        texel = 2u;
+        break;
+    case GL_RGBA16F:
+    case GL_RG32F:
+    case GL_DEPTH32F_STENCIL8:
+        texel = 8u;
+        break;
+    case GL_RGB32F:
+        texel = 12u;
+        break;
+    case GL_RGBA32F:
+        texel = 16u;
+        break;
+    case GL_RGB16F:
+        // Drivers pad 3-channel texels
+        texel = 8u;
+        break;
+    default:
+        // GL_RGBA8, GL_SRGB8_ALPHA8, GL_RGB10_A2, GL_R11F_G11F_B10F, GL_R32F,
+        // 24-bits depth (padded) ...
+        texel = 4u;
+        break;
+    }
+
+    return size_t(width) * size_t(height) * texel
+           * size_t(std::max(GLsizei(1), samples));
+}
+
+//------------------------------------------------------------------------------
+GLRenderTargetPool::Target::Target(std::string const& name, Desc const& desc)
+    : m_desc(desc)
+{
+    if (desc.depth())
+    {
+        m_buffer.reset(new GLDepthBuffer(name, desc.width, desc.height,
+                                         desc.format, desc.samples));
+    }
+    else if (desc.samples > 0)
+    {
+        m_buffer.reset(new GLColorBuffer(name, desc.width, desc.height,
+                                         GL_COLOR_ATTACHMENT0, desc.format,
+                                         desc.samples));
+    }
+    else
+    {
+        m_texture.reset(new GLRenderTexture(name, desc.format));
+        m_buffer.reset(new GLTextureBuffer(*m_texture, desc.width, desc.height,
+                                           GL_COLOR_ATTACHMENT0));
+    }
+}
+
+//------------------------------------------------------------------------------
+GLTexture2D& GLRenderTargetPool::Target::texture()
+{
+    if (m_texture == nullptr)
+    {
+        throw GL::Exception("Render target '" + m_buffer->name() +
+                            "' cannot be sampled");
+    }
+    return *m_texture;
+}
+
+//------------------------------------------------------------------------------
+GLRenderTargetPool::GLRenderTargetPool(size_t const max_idle_frames)
+    : m_max_idle_frames(max_idle_frames)
+{}
+
+//------------------------------------------------------------------------------
+GLRenderTargetPool::~GLRenderTargetPool()
+{
+    clear();
+}
+
+//------------------------------------------------------------------------------
+GLRenderTargetPool::Target& GLRenderTargetPool::acquire(Desc const& desc)
+{
+    if ((desc.width == 0u) || (desc.height == 0u))
+    {
+        throw GL::Exception("Render targets cannot have a null size");
+    }
+
+    for (auto& it: m_targets)
+    {
+        if ((!it->m_used) && (it->m_desc == desc))
+        {
+            it->m_used = true;
+            it->m_frame = m_frame;
+            return *it;
+        }
+    }
+
+    m_targets.emplace_back(new Target("RenderTarget" + std::to_string(m_created++), desc));
+    Target& target = *m_targets.back();
+    target.m_used = true;
+    target.m_frame = m_frame;
+
+    m_bytes += desc.bytes();
+    GPUMemory() += desc.bytes();
+    return target;
+}
+
+//------------------------------------------------------------------------------
+void GLRenderTargetPool::release(Target& target)
+{
+    target.m_used = false;
+}
+
+//------------------------------------------------------------------------------
+GLFrameBuffer& GLRenderTargetPool::framebuffer(std::vector<Target*> const& colors,
+                                               Target* depth)
+{
+    if (colors.empty() && (depth == nullptr))
+    {
+        throw GL::Exception("Framebuffers need at least one render target");
+    }
+    if (colors.size() > 16u)
+    {
+        throw GL::Exception("FrameBuffer cannot hold more than 16 color buffers");
+    }
+
+    Key key(colors.begin(), colors.end());
+    key.push_back(depth);
+
+    auto it = m_framebuffers.find(key);
+    if (it != m_framebuffers.end())
+        return *(it->second);
+
+    // All attachments of a framebuffer shall have the same size and samples.
+    Desc const& ref = (colors.empty() ? depth : colors[0])->m_desc;
+    for (auto const& target: key)
+    {
+        if (target == nullptr)
+            continue;
+
+        if ((target->m_desc.width != ref.width) ||
+            (target->m_desc.height != ref.height) ||
+            (target->m_desc.samples != ref.samples))
+        {
+            throw GL::Exception("Render targets of a framebuffer shall have the "
+                                "same size and number of samples");
+        }
+        if (target->m_desc.depth() != (target == depth))
+        {
+            throw GL::Exception("Render target '" + target->m_buffer->name() +
+                                "' is not attached to the right attachment point");
+        }
+    }
+
+    std::string name("RenderPass");
+    for (auto const& target: key)
+    {
+        if (target != nullptr)
+            name += "-" + target->m_buffer->name();
+    }
+
+    std::unique_ptr<GLFrameBuffer> fbo(new GLFrameBuffer(name));
+    fbo->resize(ref.width, ref.height);
+    for (auto& target: colors)
+    {
+        fbo->attachColorBuffer(*target->m_buffer);
+    }
+    if (depth != nullptr)
+    {
+        fbo->attachDepthBuffer(static_cast<GLDepthBuffer&>(*depth->m_buffer));
+    }
+
+    GLFrameBuffer& res = *fbo;
+    m_framebuffers[key] = std::move(fbo);
+    return res;
+}
+
+//------------------------------------------------------------------------------
+void GLRenderTargetPool::frame()
+{
+    ++m_frame;
+
+    size_t i = m_targets.size();
+    while (i--)
+    {
+        Target& target = *m_targets[i];
+        target.m_used = false;
+        if (m_frame - target.m_frame > m_max_idle_frames)
+        {
+            destroy(i);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void GLRenderTargetPool::clear()
+{
+    m_framebuffers.clear();
+    size_t i = m_targets.size();
+    while (i--)
+    {
+        destroy(i);
+    }
+}
+
+//------------------------------------------------------------------------------
+size_t GLRenderTargetPool::used() const
+{
+    return static_cast<size_t>(std::count_if(m_targets.begin(), m_targets.end(),
+                                             [](std::unique_ptr<Target> const& target)
+                                             {
+                                                 return target->m_used;
+                                             }));
+}
+
+//------------------------------------------------------------------------------
+void GLRenderTargetPool::destroy(size_t const index)
+{
+    const Target* target = m_targets[index].get();
+
+    // Framebuffers referencing the target shall be destroyed before it.
+    auto it = m_framebuffers.begin();
+    while (it != m_framebuffers.end())
+    {
+        if (std::find(it->first.begin(), it->first.end(), target) != it->first.end())
+            it = m_framebuffers.erase(it);
+        else
+            ++it;
+    }
+
+    m_bytes -= target->m_desc.bytes();
+    GPUMemory() -= target->m_desc.bytes();
+    m_targets.erase(m_targets.begin() + static_cast<std::ptrdiff_t>(index));
+}
@@ -0,0 +1,257 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#ifndef OPENGLCPPWRAPPER_GLRENDER_TARGET_POOL_HPP
+#  define OPENGLCPPWRAPPER_GLRENDER_TARGET_POOL_HPP
+
+#  include "OpenGL/Buffers/FrameBuffers.hpp"
+#  include "Common/NonCppStd.hpp"
+#  include <map>
+#  include <vector>
+
+// *****************************************************************************
+//! \brief Recycle transient render targets between the passes of a frame.
+//!
+//! A GLFrameBuffer built with its constructor owns a full set of attachments.
+//! A chain of post-processing passes built this way keeps one set per pass in
+//! GPU memory although each pass only reads the output of the previous one.
+//! Here, passes acquire targets by (width, height, format, samples) and
+//! release them once read by the next pass: a released target is handed out
+//! again to any later pass asking for the same description. Framebuffers are
+//! assembled from pooled targets and cached by set of targets.
+//!
+//! \code
+//!   GLRenderTargetPool pool;
+//!   // Each frame
+//!   auto& scene = pool.acquire({ w, h, GL_RGBA16F });
+//!   auto& depth = pool.acquire({ w, h, GL_DEPTH_COMPONENT24 });
+//!   pool.framebuffer({ &scene }, &depth).render([](){ ... });
+//!   pool.release(depth);
+//!   auto& blur = pool.acquire({ w, h, GL_RGBA16F });
+//!   pool.framebuffer({ &blur }).render([&](){ ... scene.texture() ... });
+//!   pool.release(scene);
+//!   ...
+//!   pool.frame();
+//! \endcode
+//!
+//! Targets and framebuffers are only created by OpenGL when first rendered:
+//! allocation decisions do not need an OpenGL context.
+//!
+//! \note Single-sample color targets are textures that can be sampled. Depth
+//! and multisampled targets are render buffers.
+// *****************************************************************************
+class GLRenderTargetPool : private NonCopyable
+{
+public:
+
+    // *************************************************************************
+    //! \brief Description of a render target. Targets with equal descriptions
+    //! are interchangeable.
+    // *************************************************************************
+    struct Desc
+    {
+        uint32_t width = 0u;
+        uint32_t height = 0u;
+        //! \brief Sized internal format (ie GL_RGBA8, GL_RGBA16F,
+        //! GL_DEPTH24_STENCIL8).
+        GLenum format = GL_RGBA8;
+        //! \brief Number of samples per pixel (0 for a single sample).
+        GLsizei samples = 0;
+
+        inline bool operator==(Desc const& other) const
+        {
+            return (width == other.width) && (height == other.height) &&
+                   (format == other.format) && (samples == other.samples);
+        }
+
+        //! \brief Return true for depth and depth-stencil formats.
+        bool depth() const;
+
+        //! \brief Return the estimated number of bytes of GPU memory.
+        size_t bytes() const;
+    };
+
+    // *************************************************************************
+    //! \brief A render target of the pool.
+    // *************************************************************************
+    class Target : private NonCopyable
+    {
+    public:
+
+        inline Desc const& desc() const
+        {
+            return m_desc;
+        }
+
+        //----------------------------------------------------------------------
+        //! \brief Return true if the target is a texture that can be sampled
+        //! by later passes.
+        //----------------------------------------------------------------------
+        inline bool sampleable() const
+        {
+            return m_texture != nullptr;
+        }
+
+        //----------------------------------------------------------------------
+        //! \brief Return the texture holding the rendered texels.
+        //! \throw GL::Exception if the target is not sampleable().
+        //----------------------------------------------------------------------
+        GLTexture2D& texture();
+
+        //----------------------------------------------------------------------
+        //! \brief Return the buffer to attach to framebuffers.
+        //----------------------------------------------------------------------
+        inline GLRenderBuffer& buffer()
+        {
+            return *m_buffer;
+        }
+
+    private:
+
+        friend class GLRenderTargetPool;
+
+        Target(std::string const& name, Desc const& desc);
+
+    private:
+
+        Desc m_desc;
+        //! \brief Storage of single-sample color targets.
+        std::unique_ptr<GLTexture2D> m_texture;
+        //! \brief GLTextureBuffer wrapping m_texture, else GLColorBuffer or
+        //! GLDepthBuffer.
+        std::unique_ptr<GLRenderBuffer> m_buffer;
+        //! \brief Acquired and not yet released.
+        bool m_used = false;
+        //! \brief Frame of the last acquisition.
+        size_t m_frame = 0u;
+    };
+
+    //--------------------------------------------------------------------------
+    //! \brief Default number of frames a released target is kept unused
+    //! before being destroyed.
+    //--------------------------------------------------------------------------
+    static constexpr size_t DEFAULT_MAX_IDLE_FRAMES = 3u;
+
+    //--------------------------------------------------------------------------
+    //! \brief Empty pool.
+    //! \param max_idle_frames released targets not acquired during this number
+    //! of frames are destroyed by frame().
+    //--------------------------------------------------------------------------
+    explicit GLRenderTargetPool(size_t const max_idle_frames = DEFAULT_MAX_IDLE_FRAMES);
+
+    //--------------------------------------------------------------------------
+    //! \brief Destroy framebuffers and targets.
+    //--------------------------------------------------------------------------
+    ~GLRenderTargetPool();
+
+    //--------------------------------------------------------------------------
+    //! \brief Return a released target with the same description or create a
+    //! new one. The target stays reserved until release() or frame().
+    //! \throw GL::Exception if the description has a null size.
+    //--------------------------------------------------------------------------
+    Target& acquire(Desc const& desc);
+
+    //--------------------------------------------------------------------------
+    //! \brief Hand the target to later acquisitions. To be called once the
+    //! last pass reading the target has been rendered.
+    //--------------------------------------------------------------------------
+    void release(Target& target);
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the framebuffer rendering into the given targets. The
+    //! framebuffer is created once per set of targets and kept until one of
+    //! its targets is destroyed.
+    //!
+    //! \param colors the color targets bound to GL_COLOR_ATTACHMENT0 and
+    //! followings.
+    //! \param depth the optional depth (or depth-stencil) target.
+    //! \throw GL::Exception if targets have different sizes or sample counts,
+    //! or are misplaced (ie depth format given as color).
+    //--------------------------------------------------------------------------
+    GLFrameBuffer& framebuffer(std::vector<Target*> const& colors,
+                               Target* depth = nullptr);
+
+    //--------------------------------------------------------------------------
+    //! \brief Mark the end of the frame: release all targets and destroy those
+    //! not acquired for max_idle_frames frames (ie after a window resize).
+    //--------------------------------------------------------------------------
+    void frame();
+
+    //--------------------------------------------------------------------------
+    //! \brief Destroy all targets and framebuffers.
+    //--------------------------------------------------------------------------
+    void clear();
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the estimated number of bytes of GPU memory held by the
+    //! targets.
+    //--------------------------------------------------------------------------
+    inline size_t bytes() const
+    {
+        return m_bytes;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of targets.
+    //--------------------------------------------------------------------------
+    inline size_t count() const
+    {
+        return m_targets.size();
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of acquired targets.
+    //--------------------------------------------------------------------------
+    size_t used() const;
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of cached framebuffers.
+    //--------------------------------------------------------------------------
+    inline size_t framebuffers() const
+    {
+        return m_framebuffers.size();
+    }
+
+private:
+
+    //--------------------------------------------------------------------------
+    //! \brief Destroy the target and the framebuffers using it.
+    //--------------------------------------------------------------------------
+    void destroy(size_t const index);
+
+private:
+
+    //! \brief Set of targets (colors then depth or nullptr).
+    using Key = std::vector<const Target*>;
+
+    //! \brief Targets. Held by pointers for keeping references valid.
+    std::vector<std::unique_ptr<Target>> m_targets;
+    //! \brief Framebuffers per set of targets. Destroyed before targets.
+    std::map<Key, std::unique_ptr<GLFrameBuffer>> m_framebuffers;
+    size_t m_max_idle_frames;
+    //! \brief Current frame number.
+    size_t m_frame = 0u;
+    //! \brief Bytes held by the targets.
+    size_t m_bytes = 0u;
+    //! \brief Counter for naming targets.
+    size_t m_created = 0u;
+};
+
+#endif // OPENGLCPPWRAPPER_GLRENDER_TARGET_POOL_HPP
@@ -166,6 +166,9 @@ void GLVAO::createTexturesFromSamplers(GLProgram::Samplers const& samplers)
         case GL_SAMPLER_CUBE:
             createTexture<GLTextureCube>(name);
             break;
+        case GL_SAMPLER_2D_ARRAY:
+            createTexture<GLTextureArray2D>(name);
+            break;
         default:
             throw GL::Exception("This kind of sampler is not managed: "
                                 + std::to_string(gltype));
@@ -179,9 +182,16 @@ bool GLVAO::draw(Mode const mode, size_t const first, size_t const count)
     if (likely(m_program != nullptr))
     {
         m_program->begin();   //glCheck(glUseProgram(m_program->handle()));
+
+        // The GLProgram is still compiled asynchronously (see GLCompileQueue):
+        // skip the drawing until it has been linked.
+        if (unlikely(!m_program->compiled()))
+            return false;
+
         begin(); // Optim: glBindVertexArray(m_vao->handle());
 
-        // Activate textures
+        // Activate textures. Textures still loading (see GLTextureLoadQueue)
+        // are bound to their 1x1 placeholder.
         for (auto& it: m_program->m_samplers)
         {
             it.second->begin();
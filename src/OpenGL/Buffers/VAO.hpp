@@ -84,10 +84,16 @@ public:
     }
 
     //--------------------------------------------------------------------------
-    //! \brief Destructor. Release elements in CPU and GPU memories.
+    //! \brief Destructor. Release elements in CPU and GPU memories. A VAO
+    //! bound to a program still compiled asynchronously is unregistered from
+    //! it.
     //--------------------------------------------------------------------------
     virtual ~GLVAO() override
     {
+        if (m_deferred)
+        {
+            m_program->undefer(*this);
+        }
         release();
     }
 
@@ -388,11 +394,52 @@ public:
     }
 
     //--------------------------------------------------------------------------
-    //! \brief Return true if this instance of VAO is bound to a GLProgram
+    //! \brief Return the reference of the named VBO holding an array of 2D
+    //! textures.
+    //!
+    //! This method wraps the \a texture() method hidding the misery of the
+    //! template.
+    //!
+    //! \throw GL::Exception if the texture does not exist or does not have the
+    //! correct type.
+    //--------------------------------------------------------------------------
+    inline GLTextureArray2D& textureArray2D(const char *name)
+    {
+        return getTexture<GLTextureArray2D>(name);
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Make the named sampler use a texture shared with other VAOs (ie
+    //! a page of a GLTextureAtlas) instead of its own texture. Draws of VAOs
+    //! sharing a texture do not need to bind different textures.
+    //!
+    //! \throw GL::Exception if the VAO is bound to a GLProgram having no
+    //! sampler with this name.
+    //--------------------------------------------------------------------------
+    void shareTexture(const char *name, std::shared_ptr<GLTexture> const& texture)
+    {
+        assert(name != nullptr);
+        assert(texture != nullptr);
+
+        if (isBound() && (m_textures.find(name) == m_textures.end()))
+        {
+            throw GL::Exception("GLTexture '" + std::string(name) +
+                                "' does not exist");
+        }
+
+        m_textures[name] = texture;
+        m_need_update = true;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return true if this instance of VAO is bound to a GLProgram.
+    //! Return false while the GLProgram is compiled asynchronously (see
+    //! GLCompileQueue).
     //--------------------------------------------------------------------------
     inline bool isBound() const
     {
-        return (m_program != nullptr) && (m_program->handle() != 0u);
+        return (m_program != nullptr) && (m_program->handle() != 0u) &&
+               (!m_program->pending());
     }
 
 private:
@@ -498,7 +545,8 @@ private:
     //! VAO with textures frome sampler names used in shader GLSL code.
     //!
     //! \param[in] name the sampler name for the texture.
-    //! \tparam T GLTexture1D or GLTexture2D or GLTexture3D or GLTextureCube.
+    //! \tparam T GLTexture1D or GLTexture2D or GLTexture3D or GLTextureCube or
+    //! GLTextureArray2D.
     //!
     //! \note name duplicata is not managed because this case should never
     //! happen (meaning two attribute names are used for different type which is
@@ -606,11 +654,13 @@ private:
 protected:
 
     using VBOs = std::map<std::string, std::unique_ptr<IGLBuffer>>;
-    using Textures = std::map<std::string, std::unique_ptr<GLTexture>>;
+    using Textures = std::map<std::string, std::shared_ptr<GLTexture>>;
 
     VBOs         m_vbos;
     Textures     m_textures;
     GLProgram*   m_program = nullptr;
+    //! \brief Is this VAO listed in the deferred VAOs of m_program ?
+    bool         m_deferred = false;
     size_t       m_count = 0u;
     BufferUsage  m_usage;
     size_t       m_reserve;
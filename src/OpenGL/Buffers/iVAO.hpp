@@ -62,6 +62,12 @@ public:
         if (likely(m_program != nullptr))
         {
             m_program->begin(); // m_program->begin();
+
+            // The GLProgram is still compiled asynchronously (see
+            // GLCompileQueue): skip the drawing until it has been linked.
+            if (unlikely(!m_program->compiled()))
+                return false;
+
             begin(); // Optim: glBindVertexArray(m_vao->handle());
             m_index.begin(); // FIXME should be stored inside the VAO
 
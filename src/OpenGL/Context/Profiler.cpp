@@ -0,0 +1,445 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "OpenGL/Context/Profiler.hpp"
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+constexpr size_t GLProfiler::DEFAULT_FRAMES;
+constexpr size_t GLProfiler::DEFAULT_HISTORY;
+
+//------------------------------------------------------------------------------
+GLuint GLProfiler::Backend::create()
+{
+    GLuint query = 0u;
+    glCheck(glGenQueries(1, &query));
+    return query;
+}
+
+//------------------------------------------------------------------------------
+void GLProfiler::Backend::destroy(GLuint const query)
+{
+    glCheck(glDeleteQueries(1, &query));
+}
+
+//------------------------------------------------------------------------------
+void GLProfiler::Backend::timestamp(GLuint const query)
+{
+    glCheck(glQueryCounter(query, GL_TIMESTAMP));
+}
+
+//------------------------------------------------------------------------------
+bool GLProfiler::Backend::available(GLuint const query)
+{
+    GLint available = GL_FALSE;
+    glCheck(glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available));
+    return available != GL_FALSE;
+}
+
+//------------------------------------------------------------------------------
+uint64_t GLProfiler::Backend::result(GLuint const query)
+{
+    GLuint64 nanoseconds = 0u;
+    glCheck(glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds));
+    return uint64_t(nanoseconds);
+}
+
+//------------------------------------------------------------------------------
+uint64_t GLProfiler::Backend::now()
+{
+    GLint64 nanoseconds = 0;
+    glCheck(glGetInteger64v(GL_TIMESTAMP, &nanoseconds));
+    return uint64_t(nanoseconds);
+}
+
+//------------------------------------------------------------------------------
+//! \brief Escape the string for being a JSON string.
+//------------------------------------------------------------------------------
+static std::string escape(std::string const& str)
+{
+    std::ostringstream oss;
+    for (char const c: str)
+    {
+        switch (c)
+        {
+        case '"': oss << "\\\""; break;
+        case '\\': oss << "\\\\"; break;
+        case '\n': oss << "\\n"; break;
+        case '\t': oss << "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20u)
+            {
+                oss << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+                    << int(c) << std::dec << std::setfill(' ');
+            }
+            else
+            {
+                oss << c;
+            }
+            break;
+        }
+    }
+    return oss.str();
+}
+
+//------------------------------------------------------------------------------
+//! \brief Write a complete event ("ph": "X") of the Chrome trace. Times are
+//! given in milliseconds and written in microseconds.
+//------------------------------------------------------------------------------
+static void event(std::ostringstream& oss, std::string const& name, int const tid,
+                  double const begin, double const duration, size_t const frame)
+{
+    oss << ",\n{\"name\":\"" << escape(name) << "\",\"cat\":\""
+        << (tid == 1 ? "cpu" : "gpu") << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+        << tid << ",\"ts\":" << begin * 1000.0 << ",\"dur\":"
+        << std::max(0.0, duration) * 1000.0
+        << ",\"args\":{\"frame\":" << frame << "}}";
+}
+
+//------------------------------------------------------------------------------
+GLProfiler::GLProfiler(size_t const frames, size_t const history,
+                       std::unique_ptr<Backend> backend)
+    : m_backend(std::move(backend)),
+      m_frames(frames),
+      m_current(frames),
+      m_history_size(history),
+      m_origin(std::chrono::steady_clock::now())
+{
+    assert(frames > 0u);
+    assert(history > 0u);
+
+    if (m_backend == nullptr)
+    {
+        m_backend = std::make_unique<Backend>();
+    }
+}
+
+//------------------------------------------------------------------------------
+GLProfiler::~GLProfiler()
+{
+    for (auto const& frame: m_frames)
+    {
+        for (auto const& record: frame.records)
+        {
+            if (record.begin != 0u)
+            {
+                m_backend->destroy(record.begin);
+                m_backend->destroy(record.end);
+            }
+        }
+    }
+    for (auto const query: m_pool)
+    {
+        m_backend->destroy(query);
+    }
+}
+
+//------------------------------------------------------------------------------
+double GLProfiler::elapsed() const
+{
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - m_origin).count();
+}
+
+//------------------------------------------------------------------------------
+GLuint GLProfiler::acquire()
+{
+    if (m_pool.empty())
+    {
+        ++m_created;
+        return m_backend->create();
+    }
+
+    GLuint const query = m_pool.back();
+    m_pool.pop_back();
+    return query;
+}
+
+//------------------------------------------------------------------------------
+void GLProfiler::beginFrame()
+{
+    if (m_current != m_frames.size())
+    {
+        throw GL::Exception("GLProfiler::beginFrame() called twice without "
+                            "GLProfiler::endFrame()");
+    }
+
+    // Take a free slot of the ring. Grow the ring rather than waiting for
+    // the GPU results of a frame in flight.
+    auto it = std::find_if(m_frames.begin(), m_frames.end(), [](InFlight const& frame)
+    {
+        return frame.number == 0u;
+    });
+    if (it == m_frames.end())
+    {
+        m_frames.emplace_back();
+        m_current = m_frames.size() - 1u;
+    }
+    else
+    {
+        m_current = size_t(it - m_frames.begin());
+    }
+
+    InFlight& frame = m_frames[m_current];
+    frame.number = ++m_number;
+    frame.records.clear();
+    frame.gpuOrigin = m_backend->now();
+    m_frame_start = std::chrono::steady_clock::now();
+    frame.begin = std::chrono::duration<double, std::milli>(
+        m_frame_start - m_origin).count();
+}
+
+//------------------------------------------------------------------------------
+void GLProfiler::endFrame()
+{
+    if (m_current == m_frames.size())
+        return ;
+
+    if (!m_stack.empty())
+    {
+        throw GL::Exception("GLProfiler scope '" +
+                            m_frames[m_current].records[m_stack.back()].name +
+                            "' not closed at the end of the frame");
+    }
+
+    InFlight& frame = m_frames[m_current];
+    frame.cpuMs = elapsed() - frame.begin;
+    m_current = m_frames.size();
+    collect();
+}
+
+//------------------------------------------------------------------------------
+void GLProfiler::push(std::string const& name, bool const gpu)
+{
+    if (m_current == m_frames.size())
+        return ;
+
+    InFlight& frame = m_frames[m_current];
+    frame.records.emplace_back();
+    Record& record = frame.records.back();
+    record.name = name;
+    record.depth = m_stack.size();
+    if (gpu)
+    {
+        record.begin = acquire();
+        record.end = acquire();
+        m_backend->timestamp(record.begin);
+    }
+    m_stack.push_back(frame.records.size() - 1u);
+    record.cpuBegin = elapsed() - frame.begin;
+}
+
+//------------------------------------------------------------------------------
+void GLProfiler::pop()
+{
+    if (m_current == m_frames.size())
+        return ;
+
+    if (m_stack.empty())
+    {
+        throw GL::Exception("GLProfiler::pop() called without opened scope");
+    }
+
+    InFlight& frame = m_frames[m_current];
+    Record& record = frame.records[m_stack.back()];
+    m_stack.pop_back();
+    record.cpuEnd = elapsed() - frame.begin;
+    if (record.end != 0u)
+    {
+        m_backend->timestamp(record.end);
+    }
+}
+
+//------------------------------------------------------------------------------
+GLProfiler::InFlight* GLProfiler::oldest()
+{
+    InFlight* oldest = nullptr;
+    for (size_t i = 0u; i < m_frames.size(); ++i)
+    {
+        InFlight& frame = m_frames[i];
+        if ((i != m_current) && (frame.number != 0u) &&
+            ((oldest == nullptr) || (frame.number < oldest->number)))
+        {
+            oldest = &frame;
+        }
+    }
+    return oldest;
+}
+
+//------------------------------------------------------------------------------
+bool GLProfiler::available(InFlight const& frame)
+{
+    // Timestamps complete in order: the last query of the frame is enough
+    // in practice but checking each one is cheap and does not assume it.
+    for (auto it = frame.records.rbegin(); it != frame.records.rend(); ++it)
+    {
+        if ((it->begin != 0u) && (!m_backend->available(it->end) ||
+                                  !m_backend->available(it->begin)))
+            return false;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void GLProfiler::latch(InFlight& frame)
+{
+    if (m_history.size() == m_history_size)
+    {
+        // Reuse the oldest latched frame for keeping its allocated samples
+        m_history.push_back(std::move(m_history.front()));
+        m_history.pop_front();
+    }
+    else
+    {
+        m_history.emplace_back();
+    }
+
+    Frame& latched = m_history.back();
+    latched.number = frame.number;
+    latched.begin = frame.begin;
+    latched.cpuMs = frame.cpuMs;
+    latched.gpuMs = 0.0;
+    latched.samples.resize(frame.records.size());
+
+    // GPU time of the outermost GPU scope being summed
+    size_t gpu_depth = size_t(-1);
+    for (size_t i = 0u; i < frame.records.size(); ++i)
+    {
+        Record& record = frame.records[i];
+        Sample& sample = latched.samples[i];
+        sample.name = record.name;
+        sample.depth = record.depth;
+        sample.cpuBegin = record.cpuBegin;
+        sample.cpuEnd = record.cpuEnd;
+        sample.gpu = (record.begin != 0u);
+        sample.gpuBegin = sample.gpuEnd = 0.0;
+
+        if (record.depth <= gpu_depth)
+        {
+            gpu_depth = size_t(-1);
+        }
+        if (!sample.gpu)
+            continue;
+
+        // The GPU clock may be behind the CPU: clamp to the frame origin
+        uint64_t const begin = m_backend->result(record.begin);
+        uint64_t const end = m_backend->result(record.end);
+        sample.gpuBegin = double(std::max(begin, frame.gpuOrigin) - frame.gpuOrigin) / 1000000.0;
+        sample.gpuEnd = double(std::max(end, frame.gpuOrigin) - frame.gpuOrigin) / 1000000.0;
+        if (gpu_depth == size_t(-1))
+        {
+            latched.gpuMs += sample.gpuMs();
+            gpu_depth = record.depth;
+        }
+
+        m_pool.push_back(record.begin);
+        m_pool.push_back(record.end);
+        record.begin = record.end = 0u;
+    }
+
+    frame.number = 0u;
+    frame.records.clear();
+}
+
+//------------------------------------------------------------------------------
+void GLProfiler::collect()
+{
+    // Latch in the order of frames: results of a frame are not read before
+    // the results of the previous frames.
+    InFlight* frame = oldest();
+    while ((frame != nullptr) && available(*frame))
+    {
+        latch(*frame);
+        frame = oldest();
+    }
+}
+
+//------------------------------------------------------------------------------
+void GLProfiler::finish()
+{
+    InFlight* frame = oldest();
+    while (frame != nullptr)
+    {
+        latch(*frame);
+        frame = oldest();
+    }
+}
+
+//------------------------------------------------------------------------------
+size_t GLProfiler::pending() const
+{
+    size_t count = 0u;
+    for (size_t i = 0u; i < m_frames.size(); ++i)
+    {
+        if ((i != m_current) && (m_frames[i].number != 0u))
+            ++count;
+    }
+    return count;
+}
+
+//------------------------------------------------------------------------------
+GLProfiler::Frame const& GLProfiler::latest() const
+{
+    static const Frame none;
+    return m_history.empty() ? none : m_history.back();
+}
+
+//------------------------------------------------------------------------------
+std::string GLProfiler::trace() const
+{
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(3);
+    oss << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+        << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"OpenGLCppWrapper\"}},\n"
+        << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n"
+        << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+
+    for (auto const& frame: m_history)
+    {
+        event(oss, "Frame " + std::to_string(frame.number), 1, frame.begin,
+              frame.cpuMs, frame.number);
+        for (auto const& sample: frame.samples)
+        {
+            event(oss, sample.name, 1, frame.begin + sample.cpuBegin,
+                  sample.cpuMs(), frame.number);
+            if (sample.gpu)
+            {
+                event(oss, sample.name, 2, frame.begin + sample.gpuBegin,
+                      sample.gpuMs(), frame.number);
+            }
+        }
+    }
+    oss << "\n]}\n";
+    return oss.str();
+}
+
+//------------------------------------------------------------------------------
+bool GLProfiler::exportTrace(std::string const& path) const
+{
+    std::ofstream out(path, std::ios::trunc);
+    if (!out)
+        return false;
+
+    out << trace();
+    return out.good();
+}
@@ -0,0 +1,356 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#ifndef OPENGLCPPWRAPPER_GLPROFILER_HPP
+#  define OPENGLCPPWRAPPER_GLPROFILER_HPP
+
+#  include "OpenGL/Context/OpenGL.hpp"
+#  include "Common/NonCppStd.hpp"
+#  include <chrono>
+#  include <deque>
+#  include <memory>
+#  include <string>
+#  include <vector>
+
+// *****************************************************************************
+//! \brief Measure the CPU and GPU time of each pass of the frame.
+//!
+//! Passes are delimited by scopes which can be nested. The CPU time of a scope
+//! is measured with std::chrono::steady_clock. The GPU time of a scope is
+//! measured by a pair of GL_TIMESTAMP queries: unlike GL_TIME_ELAPSED queries,
+//! timestamps can be nested. Queries are taken from a pool and the results of
+//! a frame are read a few frames later, once all its queries are available,
+//! so the CPU never waits for the GPU. The frames in flight form a ring which
+//! grows instead of stalling when the GPU is late. Frames are latched in
+//! order: latest() is the last frame whose measurements are complete and
+//! history() the last latched frames, which can be exported as a Chrome trace
+//! (chrome://tracing or https://ui.perfetto.dev).
+//!
+//! \code
+//!   GLProfiler profiler;
+//!   // Each frame
+//!   profiler.beginFrame();
+//!   {
+//!       GLProfiler::Scope scope(profiler, "shadows");
+//!       ...
+//!   }
+//!   profiler.endFrame();
+//!   std::cout << profiler.latest().gpuMs << std::endl;
+//! \endcode
+//!
+//! \note All methods shall be called from the thread owning the OpenGL context.
+// *****************************************************************************
+class GLProfiler : private NonCopyable
+{
+public:
+
+    // *************************************************************************
+    //! \brief OpenGL timer query routines used by the profiler. Can be derived
+    //! for running the profiler without OpenGL context.
+    // *************************************************************************
+    class Backend
+    {
+    public:
+
+        virtual ~Backend() = default;
+
+        //! \brief Create a query object.
+        virtual GLuint create();
+        //! \brief Destroy a query object.
+        virtual void destroy(GLuint const query);
+        //! \brief Record the GPU time when previous commands have completed.
+        virtual void timestamp(GLuint const query);
+        //! \brief Return true if the result of the query can be read without
+        //! waiting.
+        virtual bool available(GLuint const query);
+        //! \brief Return the recorded GPU time in nanoseconds. Wait for it if
+        //! not available.
+        virtual uint64_t result(GLuint const query);
+        //! \brief Return the current GPU time in nanoseconds.
+        virtual uint64_t now();
+    };
+
+    // *************************************************************************
+    //! \brief Measurements of a scope. Times are in milliseconds since the
+    //! beginning of the frame.
+    // *************************************************************************
+    struct Sample
+    {
+        std::string name;
+        //! \brief Number of enclosing scopes.
+        size_t depth = 0u;
+        double cpuBegin = 0.0;
+        double cpuEnd = 0.0;
+        //! \brief GPU times, aligned on the CPU time of beginFrame().
+        double gpuBegin = 0.0;
+        double gpuEnd = 0.0;
+        //! \brief False if the GPU time has not been measured.
+        bool gpu = false;
+
+        inline double cpuMs() const
+        {
+            return cpuEnd - cpuBegin;
+        }
+
+        inline double gpuMs() const
+        {
+            return gpuEnd - gpuBegin;
+        }
+    };
+
+    // *************************************************************************
+    //! \brief Measurements of a frame.
+    // *************************************************************************
+    struct Frame
+    {
+        //! \brief Number of the frame, starting from 1.
+        size_t number = 0u;
+        //! \brief CPU time of beginFrame() in milliseconds since the creation
+        //! of the profiler.
+        double begin = 0.0;
+        //! \brief CPU time between beginFrame() and endFrame().
+        double cpuMs = 0.0;
+        //! \brief Sum of the GPU time of the outermost GPU scopes.
+        double gpuMs = 0.0;
+        //! \brief Scopes in the order they have been opened.
+        std::vector<Sample> samples;
+
+        inline bool gpuBound() const
+        {
+            return gpuMs > cpuMs;
+        }
+    };
+
+    // *************************************************************************
+    //! \brief Measure the enclosing block from its creation to its destruction.
+    // *************************************************************************
+    class Scope : private NonCopyable
+    {
+    public:
+
+        //----------------------------------------------------------------------
+        //! \param name the name of the pass.
+        //! \param gpu false for measuring only the CPU time.
+        //----------------------------------------------------------------------
+        Scope(GLProfiler& profiler, std::string const& name, bool const gpu = true)
+            : m_profiler(profiler)
+        {
+            m_profiler.push(name, gpu);
+        }
+
+        ~Scope()
+        {
+            m_profiler.pop();
+        }
+
+    private:
+
+        GLProfiler& m_profiler;
+    };
+
+    //! \brief Default number of frames in flight.
+    static constexpr size_t DEFAULT_FRAMES = 4u;
+    //! \brief Default number of latched frames kept.
+    static constexpr size_t DEFAULT_HISTORY = 120u;
+
+    //--------------------------------------------------------------------------
+    //! \brief Define the ring. Queries are created lazily by scopes.
+    //!
+    //! \param frames the initial number of frames in flight. Shall be > 0.
+    //! \param history the number of latched frames kept. Shall be > 0.
+    //! \param backend the timer queries. nullptr for OpenGL.
+    //--------------------------------------------------------------------------
+    explicit GLProfiler(size_t const frames = DEFAULT_FRAMES,
+                        size_t const history = DEFAULT_HISTORY,
+                        std::unique_ptr<Backend> backend = nullptr);
+
+    //--------------------------------------------------------------------------
+    //! \brief Drop frames in flight and destroy queries.
+    //--------------------------------------------------------------------------
+    ~GLProfiler();
+
+    //--------------------------------------------------------------------------
+    //! \brief Start measuring a new frame.
+    //! \throw GL::Exception if the previous frame has not been ended.
+    //--------------------------------------------------------------------------
+    void beginFrame();
+
+    //--------------------------------------------------------------------------
+    //! \brief Stop measuring the frame and latch frames whose measurements
+    //! are complete. Never waits for the GPU.
+    //! \throw GL::Exception if a scope is still opened.
+    //--------------------------------------------------------------------------
+    void endFrame();
+
+    //--------------------------------------------------------------------------
+    //! \brief Open a scope nested in the current one. Prefer Scope. Ignored
+    //! outside beginFrame() .. endFrame().
+    //--------------------------------------------------------------------------
+    void push(std::string const& name, bool const gpu = true);
+
+    //--------------------------------------------------------------------------
+    //! \brief Close the innermost opened scope.
+    //! \throw GL::Exception if no scope is opened.
+    //--------------------------------------------------------------------------
+    void pop();
+
+    //--------------------------------------------------------------------------
+    //! \brief Wait for the GPU and latch all frames in flight.
+    //--------------------------------------------------------------------------
+    void finish();
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the last latched frame. Its number is 0 if no frame has
+    //! been latched yet.
+    //--------------------------------------------------------------------------
+    Frame const& latest() const;
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the last latched frames, oldest first.
+    //--------------------------------------------------------------------------
+    inline std::deque<Frame> const& history() const
+    {
+        return m_history;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the latched frames in the Chrome trace event format
+    //! (JSON). CPU scopes are on thread 1 and GPU scopes on thread 2.
+    //--------------------------------------------------------------------------
+    std::string trace() const;
+
+    //--------------------------------------------------------------------------
+    //! \brief Save trace() into the given file.
+    //! \return false if the file could not be written.
+    //--------------------------------------------------------------------------
+    bool exportTrace(std::string const& path) const;
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of frames in the ring.
+    //--------------------------------------------------------------------------
+    inline size_t frames() const
+    {
+        return m_frames.size();
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of frames waiting for their GPU results.
+    //--------------------------------------------------------------------------
+    size_t pending() const;
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of queries created.
+    //--------------------------------------------------------------------------
+    inline size_t queries() const
+    {
+        return m_created;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of queries ready for reuse.
+    //--------------------------------------------------------------------------
+    inline size_t freeQueries() const
+    {
+        return m_pool.size();
+    }
+
+private:
+
+    //--------------------------------------------------------------------------
+    //! \brief A scope being measured: its GPU times are still in its queries.
+    //--------------------------------------------------------------------------
+    struct Record
+    {
+        std::string name;
+        size_t depth = 0u;
+        double cpuBegin = 0.0;
+        double cpuEnd = 0.0;
+        //! \brief Timestamp queries (0 if the GPU time is not measured).
+        GLuint begin = 0u;
+        GLuint end = 0u;
+    };
+
+    //--------------------------------------------------------------------------
+    //! \brief A frame of the ring.
+    //--------------------------------------------------------------------------
+    struct InFlight
+    {
+        //! \brief Frame number (0 if the slot is free).
+        size_t number = 0u;
+        double begin = 0.0;
+        double cpuMs = 0.0;
+        //! \brief GPU time of beginFrame() in nanoseconds.
+        uint64_t gpuOrigin = 0u;
+        std::vector<Record> records;
+    };
+
+    //--------------------------------------------------------------------------
+    //! \brief Return milliseconds elapsed since the creation of the profiler.
+    //--------------------------------------------------------------------------
+    double elapsed() const;
+
+    //--------------------------------------------------------------------------
+    //! \brief Take a query from the pool (create one if empty).
+    //--------------------------------------------------------------------------
+    GLuint acquire();
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the frame in flight with the lowest number or nullptr.
+    //--------------------------------------------------------------------------
+    InFlight* oldest();
+
+    //--------------------------------------------------------------------------
+    //! \brief Return true if all GPU results of the frame can be read.
+    //--------------------------------------------------------------------------
+    bool available(InFlight const& frame);
+
+    //--------------------------------------------------------------------------
+    //! \brief Read the results of the frame, add it to the history, give back
+    //! its queries to the pool and free its slot.
+    //--------------------------------------------------------------------------
+    void latch(InFlight& frame);
+
+    //--------------------------------------------------------------------------
+    //! \brief Latch frames in order while their results are available.
+    //--------------------------------------------------------------------------
+    void collect();
+
+private:
+
+    std::unique_ptr<Backend> m_backend;
+    //! \brief The ring of frames in flight.
+    std::vector<InFlight> m_frames;
+    //! \brief Slot of the frame being measured (m_frames.size() if none).
+    size_t m_current;
+    //! \brief Indices of opened records of the current frame.
+    std::vector<size_t> m_stack;
+    //! \brief Queries ready for reuse.
+    std::vector<GLuint> m_pool;
+    //! \brief All created queries.
+    size_t m_created = 0u;
+    //! \brief Number of the last begun frame.
+    size_t m_number = 0u;
+    size_t m_history_size;
+    std::deque<Frame> m_history;
+    std::chrono::steady_clock::time_point m_origin;
+    std::chrono::steady_clock::time_point m_frame_start;
+};
+
+#endif // OPENGLCPPWRAPPER_GLPROFILER_HPP
@@ -0,0 +1,168 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributedin the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "OpenGL/Shaders/CompileQueue.hpp"
+#include "OpenGL/Shaders/Program.hpp"
+#include <algorithm>
+#include <thread>
+
+// Not defined by old versions of GLEW
+#ifndef GL_COMPLETION_STATUS_KHR
+#  define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+//------------------------------------------------------------------------------
+GLCompileQueue::GLCompileQueue()
+{
+#ifdef GL_KHR_parallel_shader_compile
+    if (GLEW_KHR_parallel_shader_compile)
+    {
+        // 0xFFFFFFFF: let the driver choose the number of threads.
+        glCheck(glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu));
+    }
+#endif
+}
+
+//------------------------------------------------------------------------------
+GLCompileQueue::~GLCompileQueue()
+{
+    for (auto& it: m_programs)
+    {
+        it->m_queue = nullptr;
+    }
+}
+
+//------------------------------------------------------------------------------
+bool GLCompileQueue::parallel()
+{
+#ifdef GL_KHR_parallel_shader_compile
+    if (GLEW_KHR_parallel_shader_compile)
+        return true;
+#endif
+#ifdef GL_ARB_parallel_shader_compile
+    if (GLEW_ARB_parallel_shader_compile)
+        return true;
+#endif
+    return false;
+}
+
+//------------------------------------------------------------------------------
+bool GLCompileQueue::queryCompletion(GLuint const handle, bool const is_program)
+{
+    if (!parallel())
+        return true;
+
+    GLint status = GL_TRUE;
+    if (is_program)
+    {
+        glCheck(glGetProgramiv(handle, GL_COMPLETION_STATUS_KHR, &status));
+    }
+    else
+    {
+        glCheck(glGetShaderiv(handle, GL_COMPLETION_STATUS_KHR, &status));
+    }
+    return status == GL_TRUE;
+}
+
+//------------------------------------------------------------------------------
+GLCompileQueue::Completion& GLCompileQueue::completion()
+{
+    static Completion query = &GLCompileQueue::queryCompletion;
+    return query;
+}
+
+//------------------------------------------------------------------------------
+bool GLCompileQueue::push(GLProgram& program, GLVertexShader& vertex,
+                          GLFragmentShader& fragment)
+{
+    return push(program, { &vertex, &fragment });
+}
+
+//------------------------------------------------------------------------------
+bool GLCompileQueue::push(GLProgram& program, GLVertexShader& vertex,
+                          GLFragmentShader& fragment, GLGeometryShader& geometry)
+{
+    return push(program, { &vertex, &fragment, &geometry });
+}
+
+//------------------------------------------------------------------------------
+bool GLCompileQueue::push(GLProgram& program, std::vector<GLShader*> const& shaders)
+{
+    if (program.compiled() || program.pending())
+        return false;
+
+    program.m_shaders = shaders;
+    program.m_async = GLProgram::AsyncState::Submit;
+    program.m_queue = this;
+    m_programs.push_back(&program);
+
+    // Submit shaders to the driver right now
+    program.begin();
+    program.end();
+    return true;
+}
+
+//------------------------------------------------------------------------------
+size_t GLCompileQueue::poll()
+{
+    auto it = m_programs.begin();
+    while (it != m_programs.end())
+    {
+        GLProgram& program = **it;
+        if (program.pending())
+        {
+            // Advance of one step: see GLProgram::onSetupAsync()
+            program.begin();
+            program.end();
+        }
+
+        if (program.pending())
+        {
+            ++it;
+        }
+        else
+        {
+            program.m_queue = nullptr;
+            it = m_programs.erase(it);
+        }
+    }
+
+    return m_programs.size();
+}
+
+//------------------------------------------------------------------------------
+void GLCompileQueue::finish()
+{
+    while (poll() != 0u)
+    {
+        std::this_thread::yield();
+    }
+}
+
+//------------------------------------------------------------------------------
+void GLCompileQueue::remove(GLProgram& program)
+{
+    auto it = std::find(m_programs.begin(), m_programs.end(), &program);
+    if (it != m_programs.end())
+    {
+        m_programs.erase(it);
+    }
+    program.m_queue = nullptr;
+}
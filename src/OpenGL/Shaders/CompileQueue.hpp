@@ -0,0 +1,163 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#ifndef OPENGLCPPWRAPPER_GLCOMPILE_QUEUE_HPP
+#  define OPENGLCPPWRAPPER_GLCOMPILE_QUEUE_HPP
+
+#  include "OpenGL/Context/OpenGL.hpp"
+#  include "Common/NonCppStd.hpp"
+#  include <functional>
+#  include <vector>
+
+class GLProgram;
+class GLShader;
+class GLVertexShader;
+class GLFragmentShader;
+class GLGeometryShader;
+
+// *****************************************************************************
+//! \brief Queue of GLPrograms compiled and linked asynchronously.
+//!
+//! GLProgram::compile() blocks until the driver has compiled shaders and
+//! linked them. With many programs, startup stalls for the sum of all
+//! compilations. GLCompileQueue submits the compilation of all programs up
+//! front and lets the driver work in background threads when the extension
+//! GL_KHR_parallel_shader_compile (or its ARB version) is available. The
+//! completion of each program is then polled without blocking (typically once
+//! per frame) with GL_COMPLETION_STATUS_KHR. Without the extension the
+//! compilation is still made step by step but each step may block.
+//!
+//! While a program is pending, VAOs can be bound to it: their VBOs and textures
+//! are created once the program has been linked and GLVAO::draw() skips the
+//! drawing until then.
+//!
+//! \code
+//!   GLCompileQueue queue;
+//!   queue.push(prog1, vs1, fs1);
+//!   queue.push(prog2, vs2, fs2);
+//!   ...
+//!   // In the rendering loop
+//!   queue.poll();
+//! \endcode
+//!
+//! \note Shaders shall be alive until their program is no longer pending.
+// *****************************************************************************
+class GLCompileQueue : private NonCopyable
+{
+    friend class GLProgram;
+
+public:
+
+    //--------------------------------------------------------------------------
+    //! \brief Query if the compilation of a shader (is_program = false) or the
+    //! linkage of a program (is_program = true) has completed. Shall not block.
+    //--------------------------------------------------------------------------
+    using Completion = std::function<bool(GLuint const handle, bool const is_program)>;
+
+    //--------------------------------------------------------------------------
+    //! \brief Let the driver use as many threads as it wants for compiling
+    //! shaders (when GL_KHR_parallel_shader_compile is available).
+    //--------------------------------------------------------------------------
+    GLCompileQueue();
+
+    //--------------------------------------------------------------------------
+    //! \brief Pending programs are left not compiled.
+    //--------------------------------------------------------------------------
+    ~GLCompileQueue();
+
+    //--------------------------------------------------------------------------
+    //! \brief Submit the compilation of a vertex and fragment shader and the
+    //! linkage of the program. Does not wait for the driver.
+    //!
+    //! \return false if the program is already compiled or pending.
+    //--------------------------------------------------------------------------
+    bool push(GLProgram& program, GLVertexShader& vertex,
+              GLFragmentShader& fragment);
+
+    //--------------------------------------------------------------------------
+    //! \brief Submit the compilation of a vertex, fragment and geometry shader
+    //! and the linkage of the program. Does not wait for the driver.
+    //!
+    //! \return false if the program is already compiled or pending.
+    //--------------------------------------------------------------------------
+    bool push(GLProgram& program, GLVertexShader& vertex,
+              GLFragmentShader& fragment, GLGeometryShader& geometry);
+
+    //--------------------------------------------------------------------------
+    //! \brief Advance pending programs which have completed their current
+    //! step. To be called once per frame. Finished programs (successfully
+    //! compiled or not) are removed from the queue: check GLProgram::compiled()
+    //! and GLProgram::strerror().
+    //!
+    //! \return the number of programs still pending.
+    //--------------------------------------------------------------------------
+    size_t poll();
+
+    //--------------------------------------------------------------------------
+    //! \brief Poll until no program is pending.
+    //--------------------------------------------------------------------------
+    void finish();
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of programs still pending.
+    //--------------------------------------------------------------------------
+    inline size_t pending() const
+    {
+        return m_programs.size();
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Does the current OpenGL context compile shaders in parallel
+    //! (GL_KHR_parallel_shader_compile or GL_ARB_parallel_shader_compile) ?
+    //--------------------------------------------------------------------------
+    static bool parallel();
+
+    //--------------------------------------------------------------------------
+    //! \brief Query used for polling the completion of shaders and programs.
+    //! Defaults to queryCompletion(). Can be replaced (for example by tests
+    //! simulating a delayed completion).
+    //--------------------------------------------------------------------------
+    static Completion& completion();
+
+    //--------------------------------------------------------------------------
+    //! \brief Query GL_COMPLETION_STATUS_KHR of a shader or a program. Always
+    //! return true if the context does not compile in parallel.
+    //--------------------------------------------------------------------------
+    static bool queryCompletion(GLuint const handle, bool const is_program);
+
+private:
+
+    //--------------------------------------------------------------------------
+    //! \brief Common code for push() methods.
+    //--------------------------------------------------------------------------
+    bool push(GLProgram& program, std::vector<GLShader*> const& shaders);
+
+    //--------------------------------------------------------------------------
+    //! \brief Called by GLProgram when released while pending.
+    //--------------------------------------------------------------------------
+    void remove(GLProgram& program);
+
+private:
+
+    //! \brief Programs not yet compiled and linked.
+    std::vector<GLProgram*> m_programs;
+};
+
+#endif // OPENGLCPPWRAPPER_GLCOMPILE_QUEUE_HPP
@@ -25,7 +25,10 @@
 //=====================================================================
 
 #include "OpenGL/Shaders/Program.hpp"
+#include "OpenGL/Shaders/ProgramBinaryCache.hpp"
+#include "OpenGL/Shaders/CompileQueue.hpp"
 #include "OpenGL/Buffers/iVAO.hpp"
+#include <algorithm>
 
 //------------------------------------------------------------------------------
 GLProgram::GLProgram(std::string const& name)
@@ -35,12 +38,23 @@ GLProgram::GLProgram(std::string const& name)
 //------------------------------------------------------------------------------
 GLProgram::~GLProgram()
 {
+    if (m_queue != nullptr)
+    {
+        m_queue->remove(*this);
+    }
+    undeferAll();
     release();
 }
 
 //------------------------------------------------------------------------------
 void GLProgram::onRelease()
 {
+    if (m_queue != nullptr)
+    {
+        m_queue->remove(*this);
+    }
+    m_async = AsyncState::None;
+    undeferAll();
     glCheck(glDeleteProgram(m_handle));
     m_uniforms.clear();
     m_samplers.clear();
@@ -63,8 +77,9 @@ bool GLProgram::bind(GLVAO& vao)
 
     // First compile the GLProgram (compile shaders and load GLSL variables) if
     // this has not been done yet. Indeed GLProgram will populate the bound VAO
-    // with VBOs.
-    if (unlikely(!compiled()))
+    // with VBOs. Programs compiled asynchronously (see GLCompileQueue) are not
+    // waited for.
+    if (unlikely(!compiled() && !pending()))
     {
         if (!compile())
         {
@@ -84,6 +99,20 @@ bool GLProgram::bind(GLVAO& vao)
     if (unlikely(!vao.isBound()))
     {
         vao.m_program = this;
+
+        // Lists of attributes and samplers are not yet known: VBOs and
+        // textures will be created once the program has been linked.
+        if (unlikely(pending()))
+        {
+            if (std::find(m_deferred_vaos.begin(), m_deferred_vaos.end(), &vao)
+                == m_deferred_vaos.end())
+            {
+                m_deferred_vaos.push_back(&vao);
+                vao.m_deferred = true;
+            }
+            return true;
+        }
+
         vao.createVBOsFromAttribs(m_attributes);
         vao.createTexturesFromSamplers(m_samplers);
         vao.m_need_update = true;
@@ -173,13 +202,27 @@ bool GLProgram::onCreate()
 }
 
 //------------------------------------------------------------------------------
-// GLObject::begin() calls onActivate() before onSetup() but for GLProgram
-// this should be the inversed.
-bool GLProgram::onSetup()
+std::string GLProgram::binaryCacheKey()
+{
+    std::vector<std::string> sources;
+
+    // The key is made from the fully preprocessed code (included files can
+    // have been modified while the root file did not).
+    for (auto& it: m_shaders)
+    {
+        if (!it->solveIncludes())
+            return {};
+        sources.push_back(std::to_string(it->target()));
+        sources.push_back(it->code());
+    }
+
+    return GLProgramBinaryCache::key(sources, GLProgramBinaryCache::driver());
+}
+
+//------------------------------------------------------------------------------
+bool GLProgram::compileAndLink()
 {
     bool success = true;
-    std::cout << "Linking shaders into GLProgram named "
-              << name() << " ..." << std::endl;
 
     // Compile shaders if they have not yet been compiled. Keep iterating even
     // if one has failed in the aim to display the most errors.
@@ -210,41 +253,246 @@ bool GLProgram::onSetup()
         // Link shaders to the program
         glCheck(glLinkProgram(m_handle));
         success = checkLinkageStatus(m_handle);
+    }
 
-        // Create the list of attributes, samplers and uniforms that will be
-        // used for populating list of VBOs (attibutes) and textures (samplers)
-        // when a VAO will be bind to the GLProgram.
-        if (success)
+    return success;
+}
+
+//------------------------------------------------------------------------------
+bool GLProgram::loadFromBinaryCache()
+{
+    // Try restoring the program binary from the cache. On failure (cache
+    // miss or binary rejected by the driver) silently fall back to the
+    // compilation from sources.
+    m_binary_key.clear();
+    m_from_binary_cache = false;
+    if (GLProgramBinaryCache::enabled() && GLProgramBinaryCache::supported())
+    {
+        m_binary_key = binaryCacheKey();
+        if (!m_binary_key.empty())
         {
-            std::cout << "Generating attributes and uniforms for GLProgram named "
-                      << name() << "..." << std::endl;
+            m_from_binary_cache = GLProgramBinaryCache::load(m_handle, m_binary_key);
+        }
+    }
+
+    if (m_from_binary_cache)
+    {
+        std::cout << "GLProgram named " << name()
+                  << " restored from the binary cache" << std::endl;
+        // Shaders have not been compiled: nothing to detach.
+        m_shaders.clear();
+    }
+    else if (!m_binary_key.empty())
+    {
+        glCheck(glProgramParameteri(m_handle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+    }
+
+    return m_from_binary_cache;
+}
 
-            success = generateAttributesAndUniforms();
-            if (success)
+//------------------------------------------------------------------------------
+// GLObject::begin() calls onActivate() before onSetup() but for GLProgram
+// this should be the inversed.
+bool GLProgram::onSetup()
+{
+    if (m_async != AsyncState::None)
+        return onSetupAsync();
+
+    std::cout << "Linking shaders into GLProgram named "
+              << name() << " ..." << std::endl;
+
+    bool success = loadFromBinaryCache();
+    if (!success)
+    {
+        success = compileAndLink();
+        if (success && !m_binary_key.empty())
+        {
+            GLProgramBinaryCache::save(m_handle, m_binary_key);
+        }
+    }
+
+    return endSetup(success);
+}
+
+//------------------------------------------------------------------------------
+bool GLProgram::onSetupAsync()
+{
+    bool success = true;
+
+    switch (m_async)
+    {
+    case AsyncState::Submit:
+        std::cout << "Submitting GLProgram named " << name()
+                  << " for asynchronous compilation ..." << std::endl;
+
+        if (loadFromBinaryCache())
+        {
+            m_async = AsyncState::None;
+            return endSetup(true);
+        }
+
+        // Submit all shaders before waiting for any of them.
+        for (auto& it: m_shaders)
+        {
+            if (it->code().size() == 0u)
+            {
+                std::string msg = "  - " + it->name() + ":\nhas empty code source\n";
+                concatError(msg);
+                success = false;
+            }
+            else if (!it->compiled())
+            {
+                it->m_async = true;
+                it->begin();
+            }
+        }
+        m_async = AsyncState::Compiling;
+        break;
+
+    case AsyncState::Compiling:
+        // Poll the compilation status of shaders without blocking.
+        for (auto& it: m_shaders)
+        {
+            if (it->m_compiling)
             {
-                m_error.clear();
-
-                // Force calling onActivate() without checks since GLObject::begin()
-                // ca                return true;lls onActivate() before onSetup() but for GLProgram this should
-                // be the inversed. So onActivate() was called before this method
-                // and has failed because this GLProgram was not yet compiled. So
-                // now, activate the GLProgram.
-                glCheck(glUseProgram(m_handle));
-
-                // Force calling onUpdate() allowing to update uniforms since the
-                // API allows the user to define uniforms before compiling the
-                // GLProgram. This allows for example to create 3d object with
-                // predefined materials before compiling shaders
-                m_need_update = true;
+                it->begin();
             }
         }
+
+        for (auto& it: m_shaders)
+        {
+            if (it->m_compiling)
+                return true;
+        }
+
+        // Keep iterating even if one has failed in the aim to display the
+        // most errors.
+        for (auto& it: m_shaders)
+        {
+            if (!it->compiled())
+            {
+                std::string msg = "  - " + it->name() + ":\n" + it->strerror();
+                concatError(msg);
+                success = false;
+            }
+        }
+
+        if (success)
+        {
+            for (auto& it: m_shaders)
+            {
+                glCheck(glAttachShader(m_handle, it->handle()));
+            }
+            glCheck(glLinkProgram(m_handle));
+            m_async = AsyncState::Linking;
+        }
+        break;
+
+    case AsyncState::Linking:
+        if (!GLCompileQueue::completion()(m_handle, true))
+            return true;
+
+        m_async = AsyncState::None;
+        success = checkLinkageStatus(m_handle);
+        if (success && !m_binary_key.empty())
+        {
+            GLProgramBinaryCache::save(m_handle, m_binary_key);
+        }
+        return endSetup(success);
+
+    default:
+        break;
+    }
+
+    if (!success)
+    {
+        m_async = AsyncState::None;
+        return endSetup(false);
+    }
+
+    // Not yet finished
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool GLProgram::endSetup(bool success)
+{
+    // Create the list of attributes, samplers and uniforms that will be
+    // used for populating list of VBOs (attibutes) and textures (samplers)
+    // when a VAO will be bind to the GLProgram.
+    if (success)
+    {
+        std::cout << "Generating attributes and uniforms for GLProgram named "
+                  << name() << "..." << std::endl;
+
+        success = generateAttributesAndUniforms();
+        if (success)
+        {
+            m_error.clear();
+
+            // Force calling onActivate() without checks since GLObject::begin()
+            // calls onActivate() before onSetup() but for GLProgram this should
+            // be the inversed. So onActivate() was called before this method
+            // and has failed because this GLProgram was not yet compiled. So
+            // now, activate the GLProgram.
+            glCheck(glUseProgram(m_handle));
+
+            // Force calling onUpdate() allowing to update uniforms since the
+            // API allows the user to define uniforms before compiling the
+            // GLProgram. This allows for example to create 3d object with
+            // predefined materials before compiling shaders
+            m_need_update = true;
+        }
     }
 
     // Release shaders stored in GPU: they are no longer needed.
+    for (auto& it: m_shaders)
+    {
+        it->m_async = false;
+    }
     detachAllShaders();
+
+    // VAOs bound while the program was compiled asynchronously: populate their
+    // VBOs and textures now. On failure, VAOs are left unbound.
+    for (auto& it: m_deferred_vaos)
+    {
+        it->m_deferred = false;
+        if (success)
+        {
+            it->createVBOsFromAttribs(m_attributes);
+            it->createTexturesFromSamplers(m_samplers);
+            it->m_need_update = true;
+        }
+        else
+        {
+            it->m_program = nullptr;
+        }
+    }
+    m_deferred_vaos.clear();
+
     return !success;
 }
 
+//------------------------------------------------------------------------------
+void GLProgram::undefer(GLVAO& vao)
+{
+    m_deferred_vaos.erase(std::remove(m_deferred_vaos.begin(),
+                                      m_deferred_vaos.end(), &vao),
+                          m_deferred_vaos.end());
+    vao.m_deferred = false;
+}
+
+//------------------------------------------------------------------------------
+void GLProgram::undeferAll()
+{
+    for (auto& it: m_deferred_vaos)
+    {
+        it->m_program = nullptr;
+        it->m_deferred = false;
+    }
+    m_deferred_vaos.clear();
+}
+
 //------------------------------------------------------------------------------
 bool GLProgram::onUpdate()
 {
@@ -338,7 +586,14 @@ bool GLProgram::generateAttributesAndUniforms()
     {
         glCheck(glGetActiveUniform(m_handle, location, BUFFER_SIZE, nullptr,
                                    &size, &type, name));
-        if (!storeUniformOrSampler(type, name))
+        // Arrays of uniforms are reflected as a single uniform named
+        // "name[0]" with size holding the number of elements.
+        if (size > 1)
+        {
+            if (!storeUniformArray(type, name, size))
+                return false;
+        }
+        else if (!storeUniformOrSampler(type, name))
             return false;
     }
 
@@ -460,6 +715,9 @@ bool GLProgram::storeUniformOrSampler(GLenum type, const char *name)
     case GL_SAMPLER_CUBE:
         createSampler<GLSamplerCube>(name);
         return true;
+    case GL_SAMPLER_2D_ARRAY:
+        createSampler<GLSampler2DArray>(name);
+        return true;
     default:
         std::string msg =
                 "The type " + std::to_string(type) + " of Uniform for " + std::string(name) +
@@ -471,6 +729,54 @@ bool GLProgram::storeUniformOrSampler(GLenum type, const char *name)
     return false;
 }
 
+//------------------------------------------------------------------------------
+bool GLProgram::storeUniformArray(GLenum type, const char *name, GLint size)
+{
+    // Strip the "[0]" suffix: the array is refered by its GLSL name.
+    std::string array_name(name);
+    std::string::size_type pos = array_name.rfind("[0]");
+    if ((pos != std::string::npos) && (pos + 3u == array_name.size()))
+        array_name.erase(pos);
+
+    switch (type)
+    {
+    case GL_FLOAT:
+        return updateOrCreateUniformArray<float>(array_name.c_str(), size);
+    case GL_FLOAT_VEC2:
+        return updateOrCreateUniformArray<Vector2f>(array_name.c_str(), size);
+    case GL_FLOAT_VEC3:
+        return updateOrCreateUniformArray<Vector3f>(array_name.c_str(), size);
+    case GL_FLOAT_VEC4:
+        return updateOrCreateUniformArray<Vector4f>(array_name.c_str(), size);
+    case GL_INT:
+        return updateOrCreateUniformArray<int>(array_name.c_str(), size);
+    case GL_INT_VEC2:
+        return updateOrCreateUniformArray<Vector2i>(array_name.c_str(), size);
+    case GL_INT_VEC3:
+        return updateOrCreateUniformArray<Vector3i>(array_name.c_str(), size);
+    case GL_INT_VEC4:
+        return updateOrCreateUniformArray<Vector4i>(array_name.c_str(), size);
+    case GL_UNSIGNED_INT:
+        return updateOrCreateUniformArray<unsigned int>(array_name.c_str(), size);
+    case GL_UNSIGNED_INT_VEC2:
+        return updateOrCreateUniformArray<Vector2u>(array_name.c_str(), size);
+    case GL_UNSIGNED_INT_VEC3:
+        return updateOrCreateUniformArray<Vector3u>(array_name.c_str(), size);
+    case GL_UNSIGNED_INT_VEC4:
+        return updateOrCreateUniformArray<Vector4u>(array_name.c_str(), size);
+    case GL_FLOAT_MAT2:
+        return updateOrCreateUniformArray<Matrix22f>(array_name.c_str(), size);
+    case GL_FLOAT_MAT3:
+        return updateOrCreateUniformArray<Matrix33f>(array_name.c_str(), size);
+    case GL_FLOAT_MAT4:
+        return updateOrCreateUniformArray<Matrix44f>(array_name.c_str(), size);
+    default:
+        // Arrays of samplers are not yet managed as arrays: keep the old
+        // behavior of storing their first element.
+        return storeUniformOrSampler(type, name);
+    }
+}
+
 //------------------------------------------------------------------------------
 size_t GLProgram::getFailedShaders(std::vector<std::string>& list, bool const clear) const
 {
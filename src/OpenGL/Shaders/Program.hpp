@@ -30,11 +30,13 @@
 #  include "OpenGL/Shaders/Shaders.hpp"
 #  include "OpenGL/Variables/Attribute.hpp"
 #  include "OpenGL/Variables/Uniform.hpp"
+#  include "OpenGL/Variables/UniformArray.hpp"
 #  include "OpenGL/Variables/Samplers.hpp"
 #  include "OpenGL/Context/OpenGL.hpp"
 #  include <map>
 
 class GLVAO;
+class GLCompileQueue;
 
 // *****************************************************************************
 //! \brief This class allows to compile shader code (vertex, fragment, geometry)
@@ -45,6 +47,7 @@ class GLVAO;
 class GLProgram: public GLObject<GLenum>
 {
     friend class GLVAO;
+    friend class GLCompileQueue;
 
     //! \brief Memorize GLAttributes, GLUniforms, GLSamplers.
     using Attributes = std::map<std::string, std::unique_ptr<GLAttribute>>;
@@ -106,6 +109,28 @@ public:
         return !m_need_setup;
     }
 
+    //--------------------------------------------------------------------------
+    //! \brief Is the program being compiled asynchronously by a
+    //! GLCompileQueue ?
+    //!
+    //! \return true while shaders are compiled or linked in background. Once
+    //! false, check compiled() to know if the compilation has succeeded.
+    //--------------------------------------------------------------------------
+    inline bool pending() const
+    {
+        return m_async != AsyncState::None;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return true if the program has been restored from the program
+    //! binary cache instead of being compiled from its sources. See
+    //! GLProgramBinaryCache.
+    //--------------------------------------------------------------------------
+    inline bool fromBinaryCache() const
+    {
+        return m_from_binary_cache;
+    }
+
     //--------------------------------------------------------------------------
     //! \brief Bind VAO with this GLProgram instance.
     //!
@@ -275,6 +300,122 @@ public:
         return (uniform != nullptr);
     }
 
+    //--------------------------------------------------------------------------
+    //! \brief Set the value of the uniform if present in the GLProgram with
+    //! the type T. Contrary to uniform<T>() no uniform is created and no
+    //! exception is thrown.
+    //!
+    //! \return true if the uniform exists with the type T.
+    //--------------------------------------------------------------------------
+    template<class T>
+    bool setUniform(const char *name, T const& value)
+    {
+        auto it = m_uniforms.find(name);
+        if (it == m_uniforms.end())
+            return false;
+        GLUniform<T>* uniform = dynamic_cast<GLUniform<T>*>(it->second.get());
+        if (uniform == nullptr)
+            return false;
+        *uniform = value;
+        return true;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Check the presence of the uniform array
+    //--------------------------------------------------------------------------
+    template<class T>
+    bool hasUniformArray(const char *name) const
+    {
+        auto it = m_uniforms.find(name);
+        if (it == m_uniforms.end())
+            return false;
+        GLUniformArray<T>* uniform = dynamic_cast<GLUniformArray<T>*>(it->second.get());
+        return (uniform != nullptr);
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Locate the uniform array variable by its name (without the
+    //! \c "[0]" suffix) and the type T of its elements.
+    //!
+    //! Like for uniform<T>(), the API allows the user to define uniform arrays
+    //! before compiling the GLProgram. In this case the size of the array is
+    //! unknown and will be fixed by the shader compilation.
+    //!
+    //! \return the uniform array instance if found else throw an exception.
+    //! \throw OpenGLException if the uniform does not exist or bad T type param.
+    //--------------------------------------------------------------------------
+    template<class T>
+    GLUniformArray<T>& uniformArray(const char *name)
+    {
+        if (compiled())
+        {
+            auto it = m_uniforms.find(name);
+            if (it != m_uniforms.end())
+            {
+                GLUniformArray<T> *uniform = dynamic_cast<GLUniformArray<T>*>(it->second.get());
+                if (uniform != nullptr)
+                    return *uniform;
+
+                throw GL::Exception("GLUniformArray " + std::string(name) +
+                                    " exists but has wrong template type");
+            }
+            throw GL::Exception("GLUniformArray " + std::string(name) + " does not exist");
+        }
+        else
+        {
+            if (m_uniforms.find(name) == m_uniforms.end())
+                createUniformArray<T>(name, 0u);
+
+            GLUniformArray<T> *uniform = dynamic_cast<GLUniformArray<T>*>(m_uniforms[name].get());
+            if (uniform == nullptr)
+            {
+                throw GL::Exception("GLUniformArray " + std::string(name) +
+                                    " exists but has wrong template type");
+            }
+            return *uniform;
+        }
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Locate and return the shader uniform array of float 4x4 matrices
+    //! (i.e. bone palettes). This method wraps the \a uniformArray() method
+    //! hidding the misery of the template.
+    //--------------------------------------------------------------------------
+    inline GLUniformArray<Matrix44f>& matrix44fArray(const char *name)
+    {
+        return uniformArray<Matrix44f>(name);
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Locate and return the shader uniform array of float 4D vectors.
+    //! This method wraps the \a uniformArray() method hidding the misery of
+    //! the template.
+    //--------------------------------------------------------------------------
+    inline GLUniformArray<Vector4f>& vector4fArray(const char *name)
+    {
+        return uniformArray<Vector4f>(name);
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Locate and return the shader uniform array of float 3D vectors
+    //! (i.e. light positions). This method wraps the \a uniformArray() method
+    //! hidding the misery of the template.
+    //--------------------------------------------------------------------------
+    inline GLUniformArray<Vector3f>& vector3fArray(const char *name)
+    {
+        return uniformArray<Vector3f>(name);
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Locate and return the shader uniform array of float scalars.
+    //! This method wraps the \a uniformArray() method hidding the misery of
+    //! the template.
+    //--------------------------------------------------------------------------
+    inline GLUniformArray<float>& scalarfArray(const char *name)
+    {
+        return uniformArray<float>(name);
+    }
+
     //--------------------------------------------------------------------------
     //! \brief Locate and return the shader uniform float 4x4 matrix. This method
     //! wraps the \a uniform() method hidding the misery of the template.
@@ -453,10 +594,50 @@ private:
     virtual void onActivate() override;
 
     //--------------------------------------------------------------------------
-    //! \brief
+    //! \brief Compile and link shaders (or restore the program from the binary
+    //! cache) then create the list of attributes, uniforms and samplers.
     //--------------------------------------------------------------------------
     virtual bool onSetup() override;
 
+    //--------------------------------------------------------------------------
+    //! \brief onSetup() for programs compiled by a GLCompileQueue: perform a
+    //! single step (submit shaders, poll their compilation then link, poll the
+    //! linkage) without blocking on the driver.
+    //!
+    //! \return true while not finished or if an error occurred.
+    //--------------------------------------------------------------------------
+    bool onSetupAsync();
+
+    //--------------------------------------------------------------------------
+    //! \brief Last step of onSetup() and onSetupAsync(): create the list of
+    //! attributes, uniforms and samplers, release shaders and populate VAOs
+    //! bound during an asynchronous compilation.
+    //!
+    //! \param[in] success false if shaders have failed to compile or link.
+    //! \return true if an error occurred (ie the setup shall be redone).
+    //--------------------------------------------------------------------------
+    bool endSetup(bool success);
+
+    //--------------------------------------------------------------------------
+    //! \brief Remove a VAO, being destroyed, from the list of VAOs bound during
+    //! the asynchronous compilation.
+    //--------------------------------------------------------------------------
+    void undefer(GLVAO& vao);
+
+    //--------------------------------------------------------------------------
+    //! \brief Unbind all VAOs bound during the asynchronous compilation (the
+    //! program is released before having been linked).
+    //--------------------------------------------------------------------------
+    void undeferAll();
+
+    //--------------------------------------------------------------------------
+    //! \brief Try restoring the program from the binary cache.
+    //!
+    //! \return true if restored. Else the program has to be compiled and
+    //! m_binary_key holds the key for saving it (empty if no cache).
+    //--------------------------------------------------------------------------
+    bool loadFromBinaryCache();
+
     //--------------------------------------------------------------------------
     //! \brief Dummy method. Nothing is made.
     //--------------------------------------------------------------------------
@@ -476,6 +657,21 @@ private:
     //--------------------------------------------------------------------------
     virtual void onRelease() override;
 
+    //--------------------------------------------------------------------------
+    //! \brief Compile attached shaders and link them to the program.
+    //!
+    //! \return true if case of success, else return false.
+    //--------------------------------------------------------------------------
+    bool compileAndLink();
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the key of this program in the program binary cache.
+    //! Includes of shaders are solved.
+    //!
+    //! \return the key or an empty string if included files are missing.
+    //--------------------------------------------------------------------------
+    std::string binaryCacheKey();
+
     //--------------------------------------------------------------------------
     //! \brief Check if the shaders have been successfully linked.
     //!
@@ -497,6 +693,7 @@ private:
     //! \brief General method for creating uniform instances.
     //--------------------------------------------------------------------------
     bool storeUniformOrSampler(GLenum type, const char *name);
+    bool storeUniformArray(GLenum type, const char *name, GLint size);
     void storeAttribute(GLenum type, const char *name);
 
     //--------------------------------------------------------------------------
@@ -548,6 +745,49 @@ private:
         return true;
     }
 
+    //--------------------------------------------------------------------------
+    //! \brief Specific method for creating uniform array instances.
+    //--------------------------------------------------------------------------
+    template<class T>
+    inline void createUniformArray(const char *name, size_t const count)
+    {
+        m_uniforms[name]
+                = std::make_unique<GLUniformArray<T>>
+                (name, getGLDimension<T>(), getGLUniformType<T>(), count, handle());
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Specific method for creating uniform array instances. The array
+    //! size is the one reflected by glGetActiveUniform.
+    //--------------------------------------------------------------------------
+    template<class T>
+    inline bool updateOrCreateUniformArray(const char *name, GLint const size)
+    {
+        size_t const count = static_cast<size_t>(size);
+        auto const& it = m_uniforms.insert(
+            std::make_pair(name, std::make_unique<GLUniformArray<T>>
+                           (name, getGLDimension<T>(), getGLUniformType<T>(),
+                            count, handle())));
+
+        // Already stored ? This is fine since the API allows creating uniform
+        // arrays before compiling the shader: in this case fix its size.
+        GLUniformArray<T> *uniform = dynamic_cast<GLUniformArray<T>*>(it.first->second.get());
+        if (uniform == nullptr)
+        {
+            std::string msg = "GLUniformArray " + std::string(name) + " mismatch type:"
+                              " shader type is different from the one you have"
+                              " created before compiling the shader code";
+            concatError(msg);
+            return false;
+        }
+
+        uniform->m_size = getGLDimension<T>();
+        uniform->m_target = getGLUniformType<T>();
+        uniform->m_program = handle();
+        uniform->reflect(count);
+        return true;
+    }
+
     //--------------------------------------------------------------------------
     //! \brief Create texture sampler instances.
     //--------------------------------------------------------------------------
@@ -585,6 +825,19 @@ private:
     std::vector<std::string> m_failedShaders;
     //! \brief Memorize all errors
     std::string m_error;
+    //! \brief Has the program been restored from the binary cache ?
+    bool m_from_binary_cache = false;
+    //! \brief Key of the program in the binary cache.
+    std::string m_binary_key;
+
+    //! \brief Steps of the asynchronous compilation (see GLCompileQueue).
+    enum class AsyncState { None, Submit, Compiling, Linking };
+    //! \brief Current step of the asynchronous compilation.
+    AsyncState m_async = AsyncState::None;
+    //! \brief Queue compiling this program.
+    GLCompileQueue* m_queue = nullptr;
+    //! \brief VAOs bound while the program was compiled asynchronously.
+    std::vector<GLVAO*> m_deferred_vaos;
 };
 
 template<> inline GLenum GLProgram::getGLAttributeType<float>() { return GL_FLOAT; }
@@ -0,0 +1,219 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributedin the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "OpenGL/Shaders/ProgramBinaryCache.hpp"
+#include "Common/File.hpp"
+#include <fstream>
+#include <iostream>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+//! \brief Magic number identifying our program binary files.
+static const char MAGIC[4] = { 'O', 'G', 'L', 'B' };
+
+//------------------------------------------------------------------------------
+//! \brief Return the directory of the cache (empty when disabled).
+//------------------------------------------------------------------------------
+static std::string& cacheDirectory()
+{
+    static std::string directory;
+    return directory;
+}
+
+//------------------------------------------------------------------------------
+std::string const& GLProgramBinaryCache::directory()
+{
+    return cacheDirectory();
+}
+
+//------------------------------------------------------------------------------
+bool GLProgramBinaryCache::setDirectory(std::string const& directory)
+{
+    cacheDirectory().clear();
+    if (directory.empty())
+        return true;
+
+    if (!File::exist(directory) && !File::mkdir(directory))
+    {
+        std::cerr << "Failed creating the program binary cache directory '"
+                  << directory << "'. Cache is disabled" << std::endl;
+        return false;
+    }
+
+    cacheDirectory() = directory;
+    if (cacheDirectory().back() != '/')
+        cacheDirectory() += '/';
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool GLProgramBinaryCache::supported()
+{
+    GLint formats = 0;
+    glCheck(glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats));
+    return formats > 0;
+}
+
+//------------------------------------------------------------------------------
+std::string GLProgramBinaryCache::driver()
+{
+    std::string str;
+    const GLenum names[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+
+    for (auto const name: names)
+    {
+        const GLubyte* s = glCheck(glGetString(name));
+        if (s != nullptr)
+            str += reinterpret_cast<const char*>(s);
+        str += '\n';
+    }
+    return str;
+}
+
+//------------------------------------------------------------------------------
+std::string GLProgramBinaryCache::key(std::vector<std::string> const& sources,
+                                      std::string const& driver)
+{
+    // 64-bit FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+    auto feed = [&hash](std::string const& str)
+    {
+        for (char const c: str)
+        {
+            hash ^= static_cast<uint8_t>(c);
+            hash *= 1099511628211ull;
+        }
+        // Separator: avoid {"ab", "c"} and {"a", "bc"} having the same hash.
+        hash ^= 0xffu;
+        hash *= 1099511628211ull;
+    };
+
+    feed(driver);
+    for (auto const& source: sources)
+        feed(source);
+
+    char buffer[17];
+    snprintf(buffer, sizeof(buffer), "%016llx",
+             static_cast<unsigned long long>(hash));
+    return buffer;
+}
+
+//------------------------------------------------------------------------------
+std::string GLProgramBinaryCache::path(std::string const& key)
+{
+    return directory() + key + ".bin";
+}
+
+//------------------------------------------------------------------------------
+bool GLProgramBinaryCache::write(std::string const& file, GLenum const format,
+                                 std::vector<char> const& binary)
+{
+    std::ofstream out(file, std::ios::binary | std::ios::trunc);
+    if (!out)
+        return false;
+
+    uint32_t const fmt = static_cast<uint32_t>(format);
+    uint64_t const size = static_cast<uint64_t>(binary.size());
+    out.write(MAGIC, sizeof(MAGIC));
+    out.write(reinterpret_cast<const char*>(&fmt), sizeof(fmt));
+    out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    out.write(binary.data(), static_cast<std::streamsize>(binary.size()));
+    return out.good();
+}
+
+//------------------------------------------------------------------------------
+bool GLProgramBinaryCache::read(std::string const& file, GLenum& format,
+                                std::vector<char>& binary)
+{
+    std::ifstream in(file, std::ios::binary);
+    if (!in)
+        return false;
+
+    char magic[sizeof(MAGIC)];
+    uint32_t fmt;
+    uint64_t size;
+
+    if (!in.read(magic, sizeof(magic)) ||
+        (0 != memcmp(magic, MAGIC, sizeof(MAGIC))) ||
+        !in.read(reinterpret_cast<char*>(&fmt), sizeof(fmt)) ||
+        !in.read(reinterpret_cast<char*>(&size), sizeof(size)))
+    {
+        return false;
+    }
+
+    // Check the file is not truncated before allocating memory.
+    std::streampos const data = in.tellg();
+    in.seekg(0, std::ios::end);
+    if ((size == 0u) ||
+        (static_cast<uint64_t>(in.tellg() - data) != size))
+    {
+        return false;
+    }
+    in.seekg(data);
+
+    binary.resize(static_cast<size_t>(size));
+    if (!in.read(binary.data(), static_cast<std::streamsize>(size)))
+        return false;
+
+    format = static_cast<GLenum>(fmt);
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool GLProgramBinaryCache::load(GLuint const program, std::string const& key)
+{
+    GLenum format;
+    std::vector<char> binary;
+
+    if (!read(path(key), format, binary))
+        return false;
+
+    // Not wrapped by glCheck: the driver may reject the binary with a
+    // GL_INVALID_ENUM error (unknown format) which is not an error for us.
+    glProgramBinary(program, format, binary.data(),
+                    static_cast<GLsizei>(binary.size()));
+    while (glGetError() != GL_NO_ERROR) {}
+
+    GLint status = GL_FALSE;
+    glCheck(glGetProgramiv(program, GL_LINK_STATUS, &status));
+    return (GL_TRUE == status);
+}
+
+//------------------------------------------------------------------------------
+bool GLProgramBinaryCache::save(GLuint const program, std::string const& key)
+{
+    GLint length = 0;
+    glCheck(glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length));
+    if (length <= 0)
+        return false;
+
+    GLenum format = 0;
+    std::vector<char> binary(static_cast<size_t>(length));
+    glCheck(glGetProgramBinary(program, length, nullptr, &format, binary.data()));
+
+    if (!write(path(key), format, binary))
+    {
+        std::cerr << "Failed writing the program binary '" << path(key)
+                  << "'" << std::endl;
+        return false;
+    }
+    return true;
+}
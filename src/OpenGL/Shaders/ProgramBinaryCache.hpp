@@ -0,0 +1,132 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributedin the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#ifndef OPENGLCPPWRAPPER_GLPROGRAM_BINARY_CACHE_HPP
+#  define OPENGLCPPWRAPPER_GLPROGRAM_BINARY_CACHE_HPP
+
+#  include "OpenGL/Context/OpenGL.hpp"
+#  include <string>
+#  include <vector>
+
+// *****************************************************************************
+//! \brief Optional on-disk cache of linked GLPrograms using glGetProgramBinary
+//! and glProgramBinary (OpenGL 4.1 or GL_ARB_get_program_binary).
+//!
+//! Startup of large scenes is dominated by shader compilation. When a cache
+//! directory is set, GLProgram looks for a binary matching the hash of its
+//! preprocessed shader sources and of the driver (vendor, renderer and version
+//! strings) before compiling shaders. The binary is saved after a successful
+//! link else. Drivers are allowed to reject binaries at any time (for example
+//! after a driver update): in this case the GLProgram silently falls back to
+//! the compilation from sources.
+//!
+//! The cache is disabled by default. Enable it with:
+//! \code
+//!   GLProgramBinaryCache::setDirectory("/home/user/.cache/myapp/shaders");
+//! \endcode
+// *****************************************************************************
+class GLProgramBinaryCache
+{
+public:
+
+    //--------------------------------------------------------------------------
+    //! \brief Set the directory where program binaries are stored. The
+    //! directory is created if it does not exist. Pass an empty string to
+    //! disable the cache.
+    //! \return false if the directory cannot be created (the cache is then
+    //! disabled).
+    //--------------------------------------------------------------------------
+    static bool setDirectory(std::string const& directory);
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the directory where program binaries are stored. Empty
+    //! if the cache is disabled.
+    //--------------------------------------------------------------------------
+    static std::string const& directory();
+
+    //--------------------------------------------------------------------------
+    //! \brief Is the cache enabled ?
+    //--------------------------------------------------------------------------
+    static inline bool enabled()
+    {
+        return !directory().empty();
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Does the current OpenGL context support at least one program
+    //! binary format ? An OpenGL context shall be current.
+    //--------------------------------------------------------------------------
+    static bool supported();
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the concatenation of the vendor, renderer and version
+    //! strings of the current OpenGL context. Binaries are only valid for the
+    //! driver which produced them.
+    //--------------------------------------------------------------------------
+    static std::string driver();
+
+    //--------------------------------------------------------------------------
+    //! \brief Compute the cache key from the fully preprocessed shader sources
+    //! (vertex, fragment and optionally geometry) and the driver string.
+    //! \return the hexadecimal string of a 64-bit FNV-1a hash.
+    //--------------------------------------------------------------------------
+    static std::string key(std::vector<std::string> const& sources,
+                           std::string const& driver);
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the path of the binary file associated to the key.
+    //--------------------------------------------------------------------------
+    static std::string path(std::string const& key);
+
+    //--------------------------------------------------------------------------
+    //! \brief Try to restore the program binary associated to the key.
+    //! Failures (missing file, corrupted file, binary rejected by the driver)
+    //! are silent.
+    //! \param[in] program the OpenGL handle of the program.
+    //! \return true if the program is linked, else false: the program shall be
+    //! compiled from its sources.
+    //--------------------------------------------------------------------------
+    static bool load(GLuint const program, std::string const& key);
+
+    //--------------------------------------------------------------------------
+    //! \brief Save the binary of a linked program. The program shall have
+    //! been linked with the GL_PROGRAM_BINARY_RETRIEVABLE_HINT parameter set.
+    //! \return true if the binary has been written.
+    //--------------------------------------------------------------------------
+    static bool save(GLuint const program, std::string const& key);
+
+    //--------------------------------------------------------------------------
+    //! \brief Write a program binary and its format into a file.
+    //! \return true on success.
+    //--------------------------------------------------------------------------
+    static bool write(std::string const& file, GLenum const format,
+                      std::vector<char> const& binary);
+
+    //--------------------------------------------------------------------------
+    //! \brief Read a program binary and its format from a file written by
+    //! write().
+    //! \return false if the file is missing, truncated or is not a program
+    //! binary file.
+    //--------------------------------------------------------------------------
+    static bool read(std::string const& file, GLenum& format,
+                     std::vector<char>& binary);
+};
+
+#endif // OPENGLCPPWRAPPER_GLPROGRAM_BINARY_CACHE_HPP
@@ -25,10 +25,13 @@
 //=====================================================================
 
 #include "OpenGL/Shaders/Shader.hpp"
+#include "OpenGL/Shaders/CompileQueue.hpp"
 #include "Common/File.hpp"
 #include <iostream>
-#include <regex>
-#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
 
 //--------------------------------------------------------------------------
 GLShader::GLShader(std::string const& name, const GLenum target)
@@ -99,68 +102,326 @@ bool GLShader::read(std::string const& file, std::string& code)
 }
 
 //--------------------------------------------------------------------------
-bool GLShader::solveIncludes()
+//! \brief Result of the include expansion of a root shader file.
+//--------------------------------------------------------------------------
+struct IncludeExpansion
+{
+    //! \brief The shader code before expansion.
+    std::string raw;
+    //! \brief The search path used for finding included files.
+    std::string search_path;
+    //! \brief The shader code after expansion.
+    std::string code;
+    //! \brief Expanded files indexed by their #line source string number.
+    std::vector<std::string> files;
+};
+
+//--------------------------------------------------------------------------
+//! \brief Guard the include caches: shaders can be read and expanded by
+//! worker threads (see GLCompileQueue).
+//--------------------------------------------------------------------------
+static std::mutex& includeCacheMutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+//--------------------------------------------------------------------------
+//! \brief Per-process cache of included file contents, indexed by their
+//! full path.
+//--------------------------------------------------------------------------
+static std::unordered_map<std::string, std::string>& includedFileCache()
+{
+    static std::unordered_map<std::string, std::string> cache;
+    return cache;
+}
+
+//--------------------------------------------------------------------------
+//! \brief Per-process cache of include expansions, indexed by the root
+//! shader file name.
+//--------------------------------------------------------------------------
+static std::unordered_map<std::string, IncludeExpansion>& includeExpansionCache()
+{
+    static std::unordered_map<std::string, IncludeExpansion> cache;
+    return cache;
+}
+
+//--------------------------------------------------------------------------
+void GLShader::clearIncludeCache()
+{
+    std::lock_guard<std::mutex> lock(includeCacheMutex());
+    includedFileCache().clear();
+    includeExpansionCache().clear();
+}
+
+//--------------------------------------------------------------------------
+//! \brief Hand-written equivalent of the regular expression
+//! ^\s*#\s*include\s+([\w\/.]+) (file names can also be quoted by "" or <>).
+//! \param[in] line the line to parse (without its '\n' char).
+//! \param[out] file the included file when the line is an include directive.
+//! \param[out] eol the characters following the file name.
+//! \return true if the line is an include directive.
+//--------------------------------------------------------------------------
+static bool parseInclude(const char* line, size_t const length,
+                         std::string& file, std::string& eol)
+{
+    const char* end = line + length;
+    const char* p = line;
+
+    auto blank = [](char const c) { return (c == ' ') || (c == '\t') || (c == '\r'); };
+    auto isname = [](char const c) { return ::isalnum(static_cast<unsigned char>(c)) ||
+                                            (c == '_') || (c == '/') || (c == '.'); };
+
+    while ((p != end) && blank(*p)) ++p;
+    if ((p == end) || (*p++ != '#'))
+        return false;
+    while ((p != end) && blank(*p)) ++p;
+    if ((end - p < 8) || (strncmp(p, "include", 7) != 0) || !blank(p[7]))
+        return false;
+    p += 8;
+    while ((p != end) && blank(*p)) ++p;
+
+    char closing = '\0';
+    if ((p != end) && ((*p == '"') || (*p == '<')))
+        closing = (*p++ == '"') ? '"' : '>';
+
+    const char* name = p;
+    while ((p != end) && isname(*p)) ++p;
+    if (p == name)
+        return false;
+    file.assign(name, p);
+
+    if (closing != '\0')
+    {
+        if ((p == end) || (*p != closing))
+            return false;
+        ++p;
+    }
+    eol.assign(p, end);
+    return true;
+}
+
+//--------------------------------------------------------------------------
+//! \brief Return true if the line is the given preprocessor directive (ie
+//! "version" for "#version 330 core").
+//--------------------------------------------------------------------------
+static bool isDirective(const char* line, size_t const length, const char* directive)
+{
+    const char* end = line + length;
+    const char* p = line;
+    size_t const size = strlen(directive);
+
+    auto blank = [](char const c) { return (c == ' ') || (c == '\t') || (c == '\r'); };
+
+    while ((p != end) && blank(*p)) ++p;
+    if ((p == end) || (*p++ != '#'))
+        return false;
+    while ((p != end) && blank(*p)) ++p;
+    if ((size_t(end - p) < size) || (strncmp(p, directive, size) != 0))
+        return false;
+    return (p + size == end) || blank(p[size]);
+}
+
+//--------------------------------------------------------------------------
+//! \brief #version shall be the first directive of a shader and #extension
+//! shall come before code: move them from the beginning of an included file
+//! to before the #line directive of the file. A #version is only kept if
+//! nothing has been emitted yet, else the shader already has one.
+//! \param[in] code the content of the included file.
+//! \param[inout] out the expanded code.
+//! \param[out] lines the number of lines moved.
+//! \return the position of the first line not moved.
+//--------------------------------------------------------------------------
+static size_t hoistDirectives(std::string const& code, std::string& out, size_t& lines)
+{
+    size_t pos = 0u;
+    lines = 0u;
+    while (pos < code.size())
+    {
+        size_t next = code.find('\n', pos);
+        if (next == std::string::npos)
+            next = code.size();
+        const char* line = code.c_str() + pos;
+        size_t const length = next - pos;
+
+        if (isDirective(line, length, "version"))
+        {
+            if (out.find_first_not_of(" \t\r\n") == std::string::npos)
+            {
+                out.append(line, length);
+                out += '\n';
+            }
+        }
+        else if (isDirective(line, length, "extension"))
+        {
+            out.append(line, length);
+            out += '\n';
+        }
+        else
+        {
+            break;
+        }
+
+        pos = next + 1u;
+        ++lines;
+    }
+    return pos;
+}
+
+//--------------------------------------------------------------------------
+bool GLShader::readIncludedFile(std::string const& file, std::string& code)
 {
-    std::regex regex(R"(^\s*#\s*include\s+([\w\/.]+))");
-    std::cmatch matches;
-
-    std::istringstream code(m_code);
-    std::string new_code;
-    std::string line;
-    std::list<std::string> opened_files;
-    bool changed;
-
-    opened_files.push_back(File::fileName(path.expand(m_file_name)));
-    do {
-        new_code = "";
-        changed = false;
-        while (std::getline(code, line))
+    {
+        std::lock_guard<std::mutex> lock(includeCacheMutex());
+        auto& cache = includedFileCache();
+        auto it = cache.find(file);
+        if (it != cache.end())
         {
-            std::regex_search(line.c_str(), matches, regex);
-            if (matches.empty())
+            code = it->second;
+            return true;
+        }
+    }
+
+    // Read without holding the lock: another thread may read the same file
+    // at the same time, both contents are identical.
+    if (!read(file, code))
+        return false;
+
+    std::lock_guard<std::mutex> lock(includeCacheMutex());
+    includedFileCache().emplace(file, code);
+    return true;
+}
+
+//--------------------------------------------------------------------------
+bool GLShader::expandIncludes(std::string const& code, size_t const id,
+                              std::vector<size_t>& stack, std::string& out,
+                              size_t pos, size_t line_number)
+{
+    std::string file;
+    std::string eol;
+
+    stack.push_back(id);
+    while (pos < code.size())
+    {
+        size_t next = code.find('\n', pos);
+        if (next == std::string::npos)
+            next = code.size();
+        const char* line = code.c_str() + pos;
+        size_t const length = next - pos;
+        pos = next + 1u;
+        ++line_number;
+
+        if (!parseInclude(line, length, file, eol))
+        {
+            // The shader already has a #version: an included one would be
+            // misplaced. Keep the line empty to preserve line numbers.
+            if ((id != 0u) && isDirective(line, length, "version"))
             {
-                new_code += line;
-                new_code += '\n';
+                out += '\n';
+                continue;
             }
-            else
+            out.append(line, length);
+            out += '\n';
+            continue;
+        }
+
+        std::string full_path = path.expand(file);
+        auto found = std::find(m_included_files.begin(), m_included_files.end(), full_path);
+        if (found != m_included_files.end())
+        {
+            size_t const included = size_t(found - m_included_files.begin());
+            if (stack.end() != std::find(stack.begin(), stack.end(), included))
             {
-                // Found a file to include, read its whole content and append it
-                // to the code
-                std::string full_path = path.expand(matches.str(1));
-                m_file_name = File::fileName(full_path);
-                if (opened_files.end() !=
-                    std::find(opened_files.begin(), opened_files.end(), m_file_name))
-                {
-                    std::cout << full_path << " already included" << std::endl;
-                    continue;
-                }
-                opened_files.push_back(m_file_name);
-                if (!read(full_path, new_code))
-                {
-                    return false;
-                }
-                // By security add the character on the same line
-                // after "include foo" for example "include foo uniform bar;"
-                std::string eol = line.substr(size_t(matches.position(0)) + matches.str(0).size());
-                if (!eol.empty())
-                {
-                    new_code += '\n';
-                    new_code += eol;
-                }
-                changed = true;
+                std::cerr << "Include cycle detected: " << m_included_files[id]
+                          << " includes " << full_path << ". Ignored" << std::endl;
             }
+
+            // Included once: keep the line to preserve line numbers.
+            out += eol;
+            out += '\n';
+            continue;
+        }
+
+        std::string content;
+        if (!readIncludedFile(full_path, content))
+        {
+            stack.pop_back();
+            return false;
         }
 
-        // Reparse the shader code to keep searching potential token 'include'
-        // added by the included file.
-        if (changed)
+        // Emit #line directives allowing compilation errors to refer to the
+        // correct file (given by its index in includedFileCache()) and line.
+        // They shall follow #version and #extension directives.
+        size_t const included = m_included_files.size();
+        m_included_files.push_back(full_path);
+        size_t hoisted;
+        size_t const start = hoistDirectives(content, out, hoisted);
+        out += "#line " + std::to_string(hoisted + 1u) + ' '
+               + std::to_string(included) + '\n';
+        if (!expandIncludes(content, included, stack, out, start, hoisted))
         {
-            code.clear();
-            code.str(new_code);
+            stack.pop_back();
+            return false;
         }
-    } while (changed);
 
-    m_code = new_code;
+        // Characters after "include foo" (for example "include foo uniform
+        // bar;") are kept on a line with the line number of the directive.
+        if (eol.empty())
+        {
+            out += "#line " + std::to_string(line_number + 1u) + ' '
+                   + std::to_string(id) + '\n';
+        }
+        else
+        {
+            out += "#line " + std::to_string(line_number) + ' '
+                   + std::to_string(id) + '\n';
+            out += eol;
+            out += '\n';
+        }
+    }
+
+    stack.pop_back();
+    return true;
+}
+
+//--------------------------------------------------------------------------
+bool GLShader::solveIncludes()
+{
+    std::string const root = path.expand(m_file_name);
+    std::string const& search_path = path.toString();
+
+    // Already expanded ? Same root file, same code and same search path give
+    // the same result.
+    {
+        std::lock_guard<std::mutex> lock(includeCacheMutex());
+        auto& cache = includeExpansionCache();
+        auto it = cache.find(root);
+        if ((it != cache.end()) && (it->second.search_path == search_path))
+        {
+            if ((it->second.raw == m_code) || (it->second.code == m_code))
+            {
+                m_code = it->second.code;
+                m_included_files = it->second.files;
+                return true;
+            }
+        }
+    }
+
+    std::string code;
+    std::vector<size_t> stack;
+    code.reserve(m_code.size());
+    m_included_files.clear();
+    m_included_files.push_back(root);
+    if (!expandIncludes(m_code, 0u, stack, code))
+        return false;
+
+    std::lock_guard<std::mutex> lock(includeCacheMutex());
+    IncludeExpansion& expansion = includeExpansionCache()[root];
+    expansion.raw = std::move(m_code);
+    expansion.search_path = search_path;
+    expansion.code = code;
+    expansion.files = m_included_files;
+    m_code = std::move(code);
     return true;
 }
 
@@ -196,27 +457,34 @@ void GLShader::onActivate()
 //--------------------------------------------------------------------------
 bool GLShader::onSetup()
 {
-    bool compiled = false;
-
-    std::cout << "Compiling shader " << name() << " ..." << std::endl;
-    if (loaded())
+    if (!m_compiling)
     {
+        std::cout << "Compiling shader " << name() << " ..." << std::endl;
+        if (!loaded())
+        {
+            std::string msg =
+                    "Failed compiling shader " + name() +
+                    ". Reason was 'no shader code was loaded'";
+            concatError(msg);
+            return true;
+        }
+
         solveIncludes();
         char const *source = m_code.c_str();
         GLint length = static_cast<GLint>(m_code.size());
         glCheck(glShaderSource(m_handle, 1, &source, &length));
         glCheck(glCompileShader(m_handle));
-        compiled = checkCompilationStatus(m_handle);
-    }
-    else
-    {
-        std::string msg =
-                "Failed compiling shader " + name() +
-                ". Reason was 'no shader code was loaded'";
-        concatError(msg);
+        m_compiling = true;
     }
 
-    return !compiled;
+    // Compiled asynchronously (see GLCompileQueue): do not block on the
+    // compilation status while the driver has not finished.
+    if (m_async && !GLCompileQueue::completion()(m_handle, false))
+        return true;
+
+    m_compiling = false;
+    m_async = false;
+    return !checkCompilationStatus(m_handle);
 }
 
 //--------------------------------------------------------------------------
@@ -233,6 +501,8 @@ void GLShader::onDeactivate()
 void GLShader::onRelease()
 {
     glCheck(glDeleteShader(m_handle));
+    m_compiling = false;
+    m_async = false;
     m_code.clear();
     m_error.clear();
 }
@@ -254,6 +524,15 @@ bool GLShader::checkCompilationStatus(GLuint obj)
                           ". Reason was: ";
         concatError(msg);
         concatError(&log[0U]);
+
+        // Help mapping #line source string numbers to included files.
+        if (m_included_files.size() > 1u)
+        {
+            msg = "Where source string numbers refer to:";
+            for (size_t i = 0u; i < m_included_files.size(); ++i)
+                msg += "\n  " + std::to_string(i) + ": " + m_included_files[i];
+            concatError(msg);
+        }
     }
     else
     {
@@ -165,6 +165,22 @@ public:
         return !m_code.empty();
     }
 
+    //-------------------------------------------------------------------------
+    //! \brief Return the list of files expanded by the last include
+    //! resolution. The index of a file is its source string number used by the
+    //! #line directives: the first element is the shader file itself.
+    //-------------------------------------------------------------------------
+    inline std::vector<std::string> const& includedFiles() const
+    {
+        return m_included_files;
+    }
+
+    //-------------------------------------------------------------------------
+    //! \brief Forget included files contents and include expansions cached by
+    //! all shaders. Call it when shader files have been modified on the disk.
+    //-------------------------------------------------------------------------
+    static void clearIncludeCache();
+
     //-------------------------------------------------------------------------
     //! \brief Erase the current shader code
     //-------------------------------------------------------------------------
@@ -194,8 +210,6 @@ public:
 
 private:
 
-    // TODO solveIncludes()
-
     //-------------------------------------------------------------------------
     //! \brief The shader is created inside the GPU.
     //-------------------------------------------------------------------------
@@ -207,7 +221,9 @@ private:
     virtual void onActivate() override;
 
     //-------------------------------------------------------------------------
-    //! \brief Compile the shader code in the GPU.
+    //! \brief Compile the shader code in the GPU. When compiled asynchronously
+    //! (see GLCompileQueue) return immediately while the driver has not
+    //! finished (the compilation is not submitted again).
     //!
     //! \return true if the compilation succeeded. Else return false.
     //! An error message is set and can be read through getError().
@@ -263,11 +279,37 @@ private:
     
     //-------------------------------------------------------------------------
     //! \brief Since includes are not an allowed tokens, this method allows
-    //! their usage.
-    //! \return false if no errors occured (ie missing files).
+    //! their usage. Files are expanded recursively in a single pass and are
+    //! included once. Include cycles are detected and ignored. #line
+    //! directives are emitted allowing compilation errors to refer to the
+    //! correct file and line (see includedFiles()). File contents and the
+    //! expansion result are cached per process.
+    //! \return true if no errors occured (ie missing files).
     //-------------------------------------------------------------------------
     bool solveIncludes();
 
+    //-------------------------------------------------------------------------
+    //! \brief Expand recursively include directives of the given code.
+    //! \param[in] code the code to expand.
+    //! \param[in] id the source string number of the code.
+    //! \param[inout] stack source string numbers of files being expanded (for
+    //! detecting include cycles).
+    //! \param[inout] out the expanded code.
+    //! \param[in] pos the position in the code of the first line to expand.
+    //! \param[in] line_number the number of lines before this position.
+    //! \return false if an included file cannot be read.
+    //-------------------------------------------------------------------------
+    bool expandIncludes(std::string const& code, size_t const id,
+                        std::vector<size_t>& stack, std::string& out,
+                        size_t pos = 0u, size_t line_number = 0u);
+
+    //-------------------------------------------------------------------------
+    //! \brief Copy the content of the file from the per-process cache. The
+    //! file is read on cache miss.
+    //! \return false if the file cannot be read.
+    //-------------------------------------------------------------------------
+    bool readIncludedFile(std::string const& file, std::string& code);
+
     //-------------------------------------------------------------------------
     //! \brief Concrete implementation for read(std::string const& file).
     //!
@@ -295,8 +337,17 @@ private:
     std::string m_code;
     //! \brief Current file name
     std::string m_file_name;
+    //! \brief Files expanded by solveIncludes() indexed by their source
+    //! string number.
+    std::vector<std::string> m_included_files;
     //! \brief Hold error messages
     std::string m_error;
+    //! \brief The code has been submitted to the driver and its compilation
+    //! status has not yet been checked.
+    bool m_compiling = false;
+    //! \brief Do not block on the compilation status (set by GLProgram when
+    //! compiled by a GLCompileQueue).
+    bool m_async = false;
 };
 
 //--------------------------------------------------------------------------
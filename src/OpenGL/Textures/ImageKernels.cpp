@@ -0,0 +1,454 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "OpenGL/Textures/ImageKernels.hpp"
+#include "Common/ThreadPool.hpp"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace image
+{
+
+//! \brief Radius of the Kaiser filter (in destination texels).
+static constexpr double KAISER_RADIUS = 3.0;
+//! \brief Shape of the Kaiser window.
+static constexpr double KAISER_ALPHA = 4.0;
+//! \brief Number of channels to compute below which threads are not worth
+//! being started.
+static constexpr size_t MIN_PARALLEL_WORK = 65536u;
+
+// *****************************************************************************
+//! \brief Weights of source texels for each destination texel along an axis:
+//! the destination texel i is the sum of weights[i * taps + t] times the source
+//! texel first[i] + t for t in [0 .. count[i][.
+// *****************************************************************************
+struct Contributors
+{
+    std::vector<size_t> first;
+    std::vector<size_t> count;
+    std::vector<float> weights;
+    size_t taps = 0u;
+};
+
+//------------------------------------------------------------------------------
+//! \brief Modified Bessel function of the first kind of order 0.
+//------------------------------------------------------------------------------
+static double besselI0(double const x)
+{
+    const double q = x * x / 4.0;
+    double term = 1.0;
+    double sum = 1.0;
+
+    for (int k = 1; k < 64; ++k)
+    {
+        term *= q / double(k * k);
+        sum += term;
+        if (term < 1e-12 * sum)
+            break;
+    }
+    return sum;
+}
+
+//------------------------------------------------------------------------------
+//! \brief Sinc windowed by a Kaiser window.
+//------------------------------------------------------------------------------
+static double kaiser(double const x)
+{
+    if (std::abs(x) >= KAISER_RADIUS)
+        return 0.0;
+
+    const double pi = 3.1415926535897932385;
+    const double t = x / KAISER_RADIUS;
+    const double window = besselI0(KAISER_ALPHA * std::sqrt(1.0 - t * t))
+                          / besselI0(KAISER_ALPHA);
+    const double sinc = (x == 0.0) ? 1.0 : std::sin(pi * x) / (pi * x);
+    return sinc * window;
+}
+
+//------------------------------------------------------------------------------
+//! \brief Compute weights for resizing n source texels into m destination
+//! texels. Source texels outside the image are clamped to the edges.
+//------------------------------------------------------------------------------
+static Contributors contributors(size_t const n, size_t const m, Filter const filter)
+{
+    const double scale = double(n) / double(m);
+    const double stretch = std::max(1.0, scale);
+    const double support = ((filter == Filter::BOX) ? 0.5 : KAISER_RADIUS) * stretch;
+
+    Contributors res;
+    res.taps = size_t(std::ceil(2.0 * support)) + 3u;
+    res.first.resize(m);
+    res.count.resize(m);
+    res.weights.assign(m * res.taps, 0.0f);
+
+    const long last = long(n) - 1;
+    std::vector<double> w(res.taps);
+    for (size_t i = 0u; i < m; ++i)
+    {
+        // Range of source texels under the filter
+        const double a = double(i) * scale;
+        const double b = double(i + 1u) * scale;
+        const double center = 0.5 * (a + b);
+        long lo, hi;
+        if (filter == Filter::BOX)
+        {
+            lo = long(std::floor(a));
+            hi = long(std::ceil(b)) - 1;
+        }
+        else
+        {
+            lo = long(std::floor(center - support));
+            hi = long(std::ceil(center + support));
+        }
+        lo = std::max(lo, long(hi - long(res.taps) + 1));
+
+        const long first = std::min(std::max(lo, 0L), last);
+        const long end = std::min(std::max(hi, 0L), last);
+        std::fill(w.begin(), w.end(), 0.0);
+
+        double sum = 0.0;
+        for (long j = lo; j <= hi; ++j)
+        {
+            const double weight = (filter == Filter::BOX)
+                ? std::max(0.0, std::min(b, double(j + 1)) - std::max(a, double(j)))
+                : kaiser((double(j) + 0.5 - center) / stretch);
+            w[size_t(std::min(std::max(j, 0L), last) - first)] += weight;
+            sum += weight;
+        }
+
+        res.first[i] = size_t(first);
+        res.count[i] = size_t(end - first + 1);
+        for (size_t t = 0u; t < res.count[i]; ++t)
+        {
+            res.weights[i * res.taps + t] = float(w[t] / sum);
+        }
+    }
+    return res;
+}
+
+//------------------------------------------------------------------------------
+//! \brief Range [begin, end[ of destination texels depending on the range
+//! [a, b[ of source texels. Empty range if none.
+//------------------------------------------------------------------------------
+static void dependents(Contributors const& c, size_t const a, size_t const b,
+                       size_t& begin, size_t& end)
+{
+    begin = end = 0u;
+    bool found = false;
+    for (size_t i = 0u; i < c.first.size(); ++i)
+    {
+        if ((c.first[i] < b) && (a < c.first[i] + c.count[i]))
+        {
+            if (!found)
+            {
+                begin = i;
+                found = true;
+            }
+            end = i + 1u;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+//! \brief Tables converting 8-bits channels into floats in the range [0 255]:
+//! table 0 for linear channels and table 1 for sRGB channels (converted to
+//! linear space).
+//------------------------------------------------------------------------------
+static float const* decoding(bool const srgb)
+{
+    struct Tables
+    {
+        Tables()
+        {
+            for (size_t i = 0u; i < 256u; ++i)
+            {
+                const double c = double(i) / 255.0;
+                linear[i] = float(i);
+                srgb[i] = float(255.0 * ((c <= 0.04045) ? (c / 12.92)
+                                         : std::pow((c + 0.055) / 1.055, 2.4)));
+            }
+        }
+
+        float linear[256];
+        float srgb[256];
+    };
+
+    static const Tables tables;
+    return srgb ? tables.srgb : tables.linear;
+}
+
+//------------------------------------------------------------------------------
+//! \brief Convert a float in the range [0 255] into a 8-bits channel.
+//------------------------------------------------------------------------------
+static inline unsigned char encode(float v, bool const srgb)
+{
+    if (srgb)
+    {
+        const double x = std::min(std::max(double(v) / 255.0, 0.0), 1.0);
+        v = float(255.0 * ((x <= 0.0031308) ? (12.92 * x)
+                           : (1.055 * std::pow(x, 1.0 / 2.4) - 0.055)));
+    }
+    return static_cast<unsigned char>(std::min(std::max(v, 0.0f), 255.0f) + 0.5f);
+}
+
+//------------------------------------------------------------------------------
+//! \brief Call f(begin, end) on slices of [0 .. count[ from several threads.
+//! Threads are taken from the pool of the process instead of being created at
+//! each call.
+//------------------------------------------------------------------------------
+template<class F>
+static void parallel(size_t const count, size_t const threads, F const& f)
+{
+    const size_t n = std::min(threads, count);
+    if (n <= 1u)
+    {
+        f(size_t(0u), count);
+        return;
+    }
+
+    ThreadPool::instance().run(n, [&](size_t const i)
+    {
+        f(count * i / n, count * (i + 1u) / n);
+    });
+}
+
+//------------------------------------------------------------------------------
+size_t levels(size_t width, size_t height)
+{
+    if ((width == 0u) || (height == 0u))
+        return 0u;
+
+    size_t res = 1u;
+    while ((width > 1u) || (height > 1u))
+    {
+        width = std::max(size_t(1u), width / 2u);
+        height = std::max(size_t(1u), height / 2u);
+        ++res;
+    }
+    return res;
+}
+
+//------------------------------------------------------------------------------
+Rect dependents(size_t const sw, size_t const sh, size_t const dw, size_t const dh,
+                Filter const filter, Rect const& region)
+{
+    Rect res;
+    if ((sw == 0u) || (sh == 0u) || (dw == 0u) || (dh == 0u) ||
+        (region.width == 0u) || (region.height == 0u))
+        return res;
+
+    size_t x0, x1, y0, y1;
+    dependents(contributors(sw, dw, filter), region.x, region.x + region.width, x0, x1);
+    dependents(contributors(sh, dh, filter), region.y, region.y + region.height, y0, y1);
+    if ((x0 == x1) || (y0 == y1))
+        return res;
+
+    res.x = x0;
+    res.y = y0;
+    res.width = x1 - x0;
+    res.height = y1 - y0;
+    res.depth = 1u;
+    return res;
+}
+
+//------------------------------------------------------------------------------
+void resize(const unsigned char* src, size_t const sw, size_t const sh,
+            unsigned char* dst, size_t const dw, size_t const dh,
+            size_t const channels, Filter const filter, bool const srgb,
+            Rect const& region, size_t const threads)
+{
+    // Clip the region to the destination
+    const size_t ox0 = std::min(region.x, dw);
+    const size_t oy0 = std::min(region.y, dh);
+    const size_t ox1 = std::min(region.x + region.width, dw);
+    const size_t oy1 = std::min(region.y + region.height, dh);
+    if ((ox0 == ox1) || (oy0 == oy1) || (sw == 0u) || (sh == 0u) || (channels == 0u))
+        return;
+
+    const Contributors cx = contributors(sw, dw, filter);
+    const Contributors cy = contributors(sh, dh, filter);
+
+    // Source columns and rows read
+    size_t sx0 = sw, sx1 = 0u, sy0 = sh, sy1 = 0u;
+    for (size_t i = ox0; i < ox1; ++i)
+    {
+        sx0 = std::min(sx0, cx.first[i]);
+        sx1 = std::max(sx1, cx.first[i] + cx.count[i]);
+    }
+    for (size_t i = oy0; i < oy1; ++i)
+    {
+        sy0 = std::min(sy0, cy.first[i]);
+        sy1 = std::max(sy1, cy.first[i] + cy.count[i]);
+    }
+
+    // Alpha channel is never sRGB encoded
+    bool srgbs[4];
+    float const* tables[4];
+    for (size_t c = 0u; c < 4u; ++c)
+    {
+        srgbs[c] = srgb && !((c + 1u == channels) && ((channels == 2u) || (channels == 4u)));
+        tables[c] = decoding(srgbs[c]);
+    }
+
+    const size_t rw = (ox1 - ox0) * channels;
+    const size_t rows = sy1 - sy0;
+    size_t n = (threads == 0u) ? size_t(std::thread::hardware_concurrency()) : threads;
+    if (rw * (oy1 - oy0) < MIN_PARALLEL_WORK)
+        n = 1u;
+
+    // Filter source rows
+    std::vector<float> tmp(rows * rw, 0.0f);
+    parallel(rows, n, [&](size_t const begin, size_t const end)
+    {
+        std::vector<float> line((sx1 - sx0) * channels);
+        for (size_t r = begin; r < end; ++r)
+        {
+            const unsigned char* s = src + ((sy0 + r) * sw + sx0) * channels;
+            for (size_t i = 0u; i < line.size(); i += channels)
+            {
+                for (size_t c = 0u; c < channels; ++c)
+                    line[i + c] = tables[c][s[i + c]];
+            }
+
+            float* out = tmp.data() + r * rw;
+            for (size_t i = ox0; i < ox1; ++i, out += channels)
+            {
+                const float* w = cx.weights.data() + i * cx.taps;
+                const float* in = line.data() + (cx.first[i] - sx0) * channels;
+                for (size_t t = 0u; t < cx.count[i]; ++t, in += channels)
+                {
+                    for (size_t c = 0u; c < channels; ++c)
+                        out[c] += w[t] * in[c];
+                }
+            }
+        }
+    });
+
+    // Filter columns
+    parallel(oy1 - oy0, n, [&](size_t const begin, size_t const end)
+    {
+        std::vector<float> acc(rw);
+        for (size_t j = oy0 + begin; j < oy0 + end; ++j)
+        {
+            std::fill(acc.begin(), acc.end(), 0.0f);
+            const float* w = cy.weights.data() + j * cy.taps;
+            for (size_t t = 0u; t < cy.count[j]; ++t)
+            {
+                const float wt = w[t];
+                const float* row = tmp.data() + (cy.first[j] + t - sy0) * rw;
+                for (size_t k = 0u; k < rw; ++k)
+                    acc[k] += wt * row[k];
+            }
+
+            unsigned char* d = dst + (j * dw + ox0) * channels;
+            for (size_t k = 0u; k < rw; k += channels)
+            {
+                for (size_t c = 0u; c < channels; ++c)
+                    d[k + c] = encode(acc[k + c], srgbs[c]);
+            }
+        }
+    });
+}
+
+//------------------------------------------------------------------------------
+void resize(const unsigned char* src, size_t const sw, size_t const sh,
+            unsigned char* dst, size_t const dw, size_t const dh,
+            size_t const channels, Filter const filter, bool const srgb,
+            size_t const threads)
+{
+    Rect region;
+    region.width = dw;
+    region.height = dh;
+    region.depth = 1u;
+    resize(src, sw, sh, dst, dw, dh, channels, filter, srgb, region, threads);
+}
+
+//------------------------------------------------------------------------------
+void MipChain::build(const unsigned char* base, size_t const width, size_t const height,
+                     size_t const channels, Filter const filter, bool const srgb,
+                     size_t const threads)
+{
+    m_width = width;
+    m_height = height;
+    m_channels = channels;
+    m_filter = filter;
+    m_srgb = srgb;
+    m_threads = threads;
+    const size_t count = image::levels(width, height);
+    m_levels.resize((count > 0u) ? count - 1u : 0u);
+
+    const unsigned char* prev = base;
+    size_t pw = width, ph = height;
+    for (auto& level: m_levels)
+    {
+        level.width = std::max(size_t(1u), pw / 2u);
+        level.height = std::max(size_t(1u), ph / 2u);
+        level.texels.resize(level.width * level.height * channels);
+        level.dirty.clear();
+        resize(prev, pw, ph, level.texels.data(), level.width, level.height,
+               channels, filter, srgb, threads);
+
+        prev = level.texels.data();
+        pw = level.width;
+        ph = level.height;
+    }
+}
+
+//------------------------------------------------------------------------------
+void MipChain::update(const unsigned char* base, std::vector<Rect> const& regions)
+{
+    std::vector<Rect> modified = regions;
+    const unsigned char* prev = base;
+    size_t pw = m_width, ph = m_height;
+
+    for (auto& level: m_levels)
+    {
+        // Merge overlapping regions to compute texels once
+        PendingBoxes boxes;
+        for (auto const& it: modified)
+        {
+            Rect r = dependents(pw, ph, level.width, level.height, m_filter, it);
+            if (r.volume() != 0u)
+                boxes.setPending(r.x, r.y, 0u, r.width, r.height, 1u);
+        }
+
+        level.dirty = boxes.getPending();
+        for (auto const& it: level.dirty)
+        {
+            resize(prev, pw, ph, level.texels.data(), level.width, level.height,
+                   m_channels, m_filter, m_srgb, it, m_threads);
+        }
+
+        modified = level.dirty;
+        prev = level.texels.data();
+        pw = level.width;
+        ph = level.height;
+    }
+}
+
+//------------------------------------------------------------------------------
+void MipChain::clear()
+{
+    m_levels.clear();
+    m_width = m_height = 0u;
+}
+
+} // namespace image
@@ -0,0 +1,167 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#ifndef OPENGLCPPWRAPPER_IMAGE_KERNELS_HPP
+#  define OPENGLCPPWRAPPER_IMAGE_KERNELS_HPP
+
+#  include "Common/PendingBoxes.hpp"
+#  include <vector>
+#  include <cstddef>
+
+// *****************************************************************************
+//! \file ImageKernels.hpp Resize images on the CPU: downsampling for building
+//! mipmaps and arbitrary resizing. Images are arrays of 8-bits channels (ie
+//! RGB, RGBA, luminance) with rows not padded.
+//!
+//! Filters are separable: rows are filtered first then columns, in floating
+//! point. Work is split by rows among threads. Inner loops work on contiguous
+//! arrays of floats so that the compiler can vectorize them.
+// *****************************************************************************
+
+namespace image
+{
+
+// *****************************************************************************
+//! \brief Resampling filters.
+// *****************************************************************************
+enum class Filter
+{
+    //! \brief Average of the source texels covered by the destination texel
+    //! (weighted by the covered area). Gives the exact 2x2 average for mipmaps
+    //! of even sizes.
+    BOX,
+    //! \brief Sinc windowed by a Kaiser window (3 lobes). Sharper than the box
+    //! filter and with less aliasing but may ring near sharp edges.
+    KAISER,
+};
+
+//! \brief Rectangle of texels (depth and z are not used).
+using Rect = PendingBoxes::Box;
+
+//------------------------------------------------------------------------------
+//! \brief Return the number of mipmap levels of an image, the image included
+//! (ie 9 for a 256x100 image).
+//------------------------------------------------------------------------------
+size_t levels(size_t const width, size_t const height);
+
+//------------------------------------------------------------------------------
+//! \brief Resize the region of the destination image from the source image.
+//!
+//! \param src the source image (sw x sh texels).
+//! \param dst the destination image (dw x dh texels). Only texels inside the
+//! region are written.
+//! \param channels number of channels per texel (1 .. 4).
+//! \param filter the resampling filter.
+//! \param srgb if true, color channels are sRGB encoded: they are averaged in
+//! linear space. Alpha channel (the last channel of 2 and 4 channels images) is
+//! always linear.
+//! \param threads number of threads. 0 for std::thread::hardware_concurrency().
+//! Small regions are computed by the calling thread.
+//------------------------------------------------------------------------------
+void resize(const unsigned char* src, size_t const sw, size_t const sh,
+            unsigned char* dst, size_t const dw, size_t const dh,
+            size_t const channels, Filter const filter, bool const srgb,
+            Rect const& region, size_t const threads = 0u);
+
+//------------------------------------------------------------------------------
+//! \brief Resize the whole destination image from the source image.
+//------------------------------------------------------------------------------
+void resize(const unsigned char* src, size_t const sw, size_t const sh,
+            unsigned char* dst, size_t const dw, size_t const dh,
+            size_t const channels, Filter const filter, bool const srgb,
+            size_t const threads = 0u);
+
+//------------------------------------------------------------------------------
+//! \brief Return the region of the destination image (dw x dh texels) holding
+//! texels depending on the given region of the source image (sw x sh texels):
+//! the texels to compute again when the region of the source is modified.
+//! Return an empty rectangle if the region is empty.
+//------------------------------------------------------------------------------
+Rect dependents(size_t const sw, size_t const sh, size_t const dw, size_t const dh,
+                Filter const filter, Rect const& region);
+
+// *****************************************************************************
+//! \brief Mipmaps of an image computed on the CPU. Each level halves the size
+//! of the previous one (rounded down, at least 1 texel) and is computed from
+//! it. The image itself (level 0) is not held.
+// *****************************************************************************
+class MipChain
+{
+public:
+
+    // *************************************************************************
+    //! \brief A mipmap level.
+    // *************************************************************************
+    struct Level
+    {
+        size_t width = 0u;
+        size_t height = 0u;
+        std::vector<unsigned char> texels;
+        //! \brief Regions modified by the last call to update().
+        std::vector<Rect> dirty;
+    };
+
+    //--------------------------------------------------------------------------
+    //! \brief Compute all levels from the image.
+    //!
+    //! \param base the image (level 0) of width x height texels.
+    //! \param channels, filter, srgb, threads: see image::resize().
+    //--------------------------------------------------------------------------
+    void build(const unsigned char* base, size_t const width, size_t const height,
+               size_t const channels, Filter const filter, bool const srgb,
+               size_t const threads = 0u);
+
+    //--------------------------------------------------------------------------
+    //! \brief Compute again texels of all levels depending on the modified
+    //! regions of the image. Regions computed again for each level are stored
+    //! in Level::dirty.
+    //!
+    //! \param base the image given to build() with modified texels.
+    //! \param regions the modified regions of the image.
+    //--------------------------------------------------------------------------
+    void update(const unsigned char* base, std::vector<Rect> const& regions);
+
+    //--------------------------------------------------------------------------
+    //! \brief Free all levels.
+    //--------------------------------------------------------------------------
+    void clear();
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the levels 1 .. n (level 1 is at index 0).
+    //--------------------------------------------------------------------------
+    inline std::vector<Level> const& levels() const
+    {
+        return m_levels;
+    }
+
+private:
+
+    std::vector<Level> m_levels;
+    size_t m_width = 0u;
+    size_t m_height = 0u;
+    size_t m_channels = 0u;
+    Filter m_filter = Filter::BOX;
+    bool m_srgb = false;
+    size_t m_threads = 0u;
+};
+
+} // namespace image
+
+#endif // OPENGLCPPWRAPPER_IMAGE_KERNELS_HPP
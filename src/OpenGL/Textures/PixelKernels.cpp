@@ -0,0 +1,822 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "OpenGL/Textures/PixelKernels.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <string>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#  define PIXEL_KERNELS_X86
+#  include <immintrin.h>
+#elif defined(__aarch64__)
+#  define PIXEL_KERNELS_NEON
+#  include <arm_neon.h>
+#endif
+
+namespace pixel
+{
+
+// *****************************************************************************
+//! \brief Instruction sets of the processor used by kernels.
+// *****************************************************************************
+struct Features
+{
+    Features()
+    {
+#if defined(PIXEL_KERNELS_X86)
+        __builtin_cpu_init();
+        sse2 = __builtin_cpu_supports("sse2");
+        ssse3 = sse2 && __builtin_cpu_supports("ssse3");
+        f16c = sse2 && __builtin_cpu_supports("f16c");
+#elif defined(PIXEL_KERNELS_NEON)
+        neon = true;
+#endif
+        names = (sse2 ? std::string("SSE2 ") : "") + (ssse3 ? "SSSE3 " : "")
+                + (f16c ? "F16C " : "") + (neon ? "NEON " : "");
+        names = names.empty() ? "none" : names.substr(0u, names.size() - 1u);
+    }
+
+    bool sse2 = false;
+    bool ssse3 = false;
+    bool f16c = false;
+    bool neon = false;
+    std::string names;
+};
+
+//! \brief Vectorized code enabled by simd().
+static std::atomic<bool> s_simd(true);
+
+//------------------------------------------------------------------------------
+static Features const& features()
+{
+    static const Features features;
+    return features;
+}
+
+//------------------------------------------------------------------------------
+void simd(bool const enable)
+{
+    s_simd = enable;
+}
+
+//------------------------------------------------------------------------------
+const char* simd()
+{
+    return s_simd ? features().names.c_str() : "none";
+}
+
+//------------------------------------------------------------------------------
+static inline bool hasSSE2()  { return s_simd && features().sse2; }
+static inline bool hasSSSE3() { return s_simd && features().ssse3; }
+static inline bool hasF16C()  { return s_simd && features().f16c; }
+static inline bool hasNEON()  { return s_simd && features().neon; }
+
+//------------------------------------------------------------------------------
+//! \brief Return the index of the alpha channel or 4 if texels have none.
+//------------------------------------------------------------------------------
+static inline size_t alphaChannel(size_t const channels)
+{
+    return ((channels == 2u) || (channels == 4u)) ? channels - 1u : 4u;
+}
+
+// *****************************************************************************
+//! \brief Byte shuffle equivalent to a swizzle, for the largest number of
+//! texels fitting in 16 bytes of source and of destination.
+// *****************************************************************************
+struct Shuffle
+{
+    Shuffle(size_t const srcChannels, size_t const dstChannels, Swizzle const& map)
+        : texels(std::min(16u / srcChannels, 16u / dstChannels)),
+          bytes(texels * dstChannels)
+    {
+        for (size_t j = 0u; j < 16u; ++j)
+        {
+            index[j] = 0x80u; // Out of range: gives 0
+            ones[j] = 0u;
+            if (j < bytes)
+            {
+                uint8_t const m = map[j % dstChannels];
+                if (m < srcChannels)
+                    index[j] = static_cast<uint8_t>((j / dstChannels) * srcChannels + m);
+                else if (m == ONE)
+                    ones[j] = 0xFFu;
+            }
+        }
+    }
+
+    //! \brief Source byte of each destination byte.
+    alignas(16) uint8_t index[16];
+    //! \brief Bytes to set to 255.
+    alignas(16) uint8_t ones[16];
+    //! \brief Texels converted per shuffle.
+    size_t const texels;
+    //! \brief Bytes written per shuffle.
+    size_t const bytes;
+};
+
+//------------------------------------------------------------------------------
+//! \brief sRGB tables.
+//------------------------------------------------------------------------------
+struct SrgbTables
+{
+    //! \brief Number of entries of the table of first codes.
+    static constexpr size_t STEPS = 4096u;
+
+    SrgbTables()
+    {
+        for (size_t i = 0u; i < 256u; ++i)
+        {
+            decode[i] = float(linear(double(i) / 255.0));
+        }
+        for (size_t i = 0u; i < 255u; ++i)
+        {
+            thresholds[i] = float(linear((double(i) + 0.5) / 255.0));
+        }
+        for (size_t k = 0u; k <= STEPS; ++k)
+        {
+            float const x = float(k) / float(STEPS);
+            start[k] = static_cast<uint8_t>(std::lower_bound(thresholds, thresholds + 255, x)
+                                            - thresholds);
+        }
+    }
+
+    static double linear(double const c)
+    {
+        return (c <= 0.04045) ? (c / 12.92) : std::pow((c + 0.055) / 1.055, 2.4);
+    }
+
+    //! \brief Linear value of each sRGB code.
+    float decode[256];
+    //! \brief Linear value half way between the sRGB codes i and i + 1.
+    float thresholds[255];
+    //! \brief sRGB code of the linear value k / STEPS: the first code to check.
+    uint8_t start[STEPS + 1u];
+};
+
+//------------------------------------------------------------------------------
+static SrgbTables const& srgbTables()
+{
+    static const SrgbTables tables;
+    return tables;
+}
+
+//------------------------------------------------------------------------------
+//! \brief Clamp to [0 1], NaN giving 0.
+//------------------------------------------------------------------------------
+static inline float saturate(float const x)
+{
+    return (x > 0.0f) ? ((x < 1.0f) ? x : 1.0f) : 0.0f;
+}
+
+//------------------------------------------------------------------------------
+static inline uint8_t byte(float const x)
+{
+    return static_cast<uint8_t>(saturate(x) * 255.0f + 0.5f);
+}
+
+//------------------------------------------------------------------------------
+//! \brief Scalar conversion of a float into a half float.
+//------------------------------------------------------------------------------
+static inline uint16_t half(float const value)
+{
+    uint32_t f;
+    memcpy(&f, &value, sizeof(f));
+    uint32_t const sign = (f >> 16) & 0x8000u;
+    uint32_t const abs = f & 0x7FFFFFFFu;
+
+    // Infinity and NaN (quiet, keeping the upper bits of the payload)
+    if (abs >= 0x7F800000u)
+    {
+        return static_cast<uint16_t>(sign | 0x7C00u | ((abs > 0x7F800000u)
+                                     ? (0x200u | ((abs >> 13) & 0x3FFu)) : 0u));
+    }
+
+    // Overflow (65520 and above round to infinity below)
+    if (abs >= 0x47800000u)
+        return static_cast<uint16_t>(sign | 0x7C00u);
+
+    // Normal half: rebias the exponent and round to the nearest even
+    if (abs >= 0x38800000u)
+    {
+        uint32_t const h = abs - 0x38000000u;
+        return static_cast<uint16_t>(sign | ((h + 0xFFFu + ((h >> 13) & 1u)) >> 13));
+    }
+
+    // Subnormal half (or zero): shift the mantissa with its implicit bit
+    if (abs < 0x33000000u)
+        return static_cast<uint16_t>(sign);
+    uint32_t const mantissa = (abs & 0x7FFFFFu) | 0x800000u;
+    uint32_t const shift = 126u - (abs >> 23);
+    uint32_t const rest = mantissa & ((1u << shift) - 1u);
+    uint32_t const middle = 1u << (shift - 1u);
+    uint32_t q = mantissa >> shift;
+    if ((rest > middle) || ((rest == middle) && (q & 1u)))
+        ++q;
+    return static_cast<uint16_t>(sign | q);
+}
+
+//------------------------------------------------------------------------------
+//! \brief Scalar conversion of a half float into a float.
+//------------------------------------------------------------------------------
+static inline float single(uint16_t const h)
+{
+    uint32_t const sign = uint32_t(h & 0x8000u) << 16;
+    uint32_t const exponent = (h >> 10) & 0x1Fu;
+    uint32_t const mantissa = h & 0x3FFu;
+    uint32_t f;
+
+    if (exponent == 0x1Fu)
+    {
+        f = sign | 0x7F800000u | (mantissa << 13) | ((mantissa != 0u) ? 0x400000u : 0u);
+    }
+    else if (exponent == 0u)
+    {
+        // Subnormal: exact product by a power of two
+        float const value = float(mantissa) * (1.0f / 16777216.0f);
+        memcpy(&f, &value, sizeof(f));
+        f |= sign;
+    }
+    else
+    {
+        f = sign | ((exponent + 112u) << 23) | (mantissa << 13);
+    }
+
+    float res;
+    memcpy(&res, &f, sizeof(res));
+    return res;
+}
+
+#if defined(PIXEL_KERNELS_X86)
+
+//------------------------------------------------------------------------------
+__attribute__((target("ssse3")))
+static size_t swizzleSSSE3(const uint8_t* src, size_t const sc, uint8_t* dst,
+                           size_t const dc, Swizzle const& map, size_t const count)
+{
+    Shuffle const s(sc, dc, map);
+    __m128i const index = _mm_load_si128(reinterpret_cast<const __m128i*>(s.index));
+    __m128i const ones = _mm_load_si128(reinterpret_cast<const __m128i*>(s.ones));
+
+    // 16 bytes are loaded: stay inside the source
+    size_t i = 0u;
+    for (; i * sc + 16u <= count * sc; i += s.texels)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * sc));
+        v = _mm_or_si128(_mm_shuffle_epi8(v, index), ones);
+        if (s.bytes == 16u)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * dc), v);
+        }
+        else
+        {
+            alignas(16) uint8_t tmp[16];
+            _mm_store_si128(reinterpret_cast<__m128i*>(tmp), v);
+            memcpy(dst + i * dc, tmp, s.bytes);
+        }
+    }
+    return i;
+}
+
+//------------------------------------------------------------------------------
+//! \brief (x + 127) / 255 for 16-bits lanes holding at most 255 * 255.
+//------------------------------------------------------------------------------
+__attribute__((target("sse2")))
+static inline __m128i div255(__m128i const x)
+{
+    __m128i const t = _mm_add_epi16(x, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+//------------------------------------------------------------------------------
+__attribute__((target("sse2")))
+static size_t premultiplySSE2(uint8_t* texels, size_t const count)
+{
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const alpha = _mm_set1_epi32(int(0xFF000000u));
+
+    size_t i = 0u;
+    for (; i + 4u <= count; i += 4u)
+    {
+        __m128i* p = reinterpret_cast<__m128i*>(texels + 4u * i);
+        __m128i const v = _mm_loadu_si128(p);
+        __m128i lo = _mm_unpacklo_epi8(v, zero);
+        __m128i hi = _mm_unpackhi_epi8(v, zero);
+        __m128i const alo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, 0xFF), 0xFF);
+        __m128i const ahi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, 0xFF), 0xFF);
+        lo = div255(_mm_mullo_epi16(lo, alo));
+        hi = div255(_mm_mullo_epi16(hi, ahi));
+        __m128i const r = _mm_packus_epi16(lo, hi);
+        _mm_storeu_si128(p, _mm_or_si128(_mm_andnot_si128(alpha, r), _mm_and_si128(alpha, v)));
+    }
+    return i;
+}
+
+//------------------------------------------------------------------------------
+__attribute__((target("sse2")))
+static size_t premultiplySSE2(float* texels, size_t const count)
+{
+    __m128 const alpha = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+    for (size_t i = 0u; i < count; ++i)
+    {
+        __m128 const v = _mm_loadu_ps(texels + 4u * i);
+        __m128 const r = _mm_mul_ps(v, _mm_shuffle_ps(v, v, 0xFF));
+        _mm_storeu_ps(texels + 4u * i, _mm_or_ps(_mm_andnot_ps(alpha, r),
+                                                 _mm_and_ps(alpha, v)));
+    }
+    return count;
+}
+
+//------------------------------------------------------------------------------
+__attribute__((target("sse2")))
+static size_t toFloatSSE2(const uint8_t* src, float* dst, size_t const count)
+{
+    __m128i const zero = _mm_setzero_si128();
+    __m128 const scale = _mm_set1_ps(255.0f);
+
+    size_t i = 0u;
+    for (; i + 16u <= count; i += 16u)
+    {
+        __m128i const v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i const lo = _mm_unpacklo_epi8(v, zero);
+        __m128i const hi = _mm_unpackhi_epi8(v, zero);
+        _mm_storeu_ps(dst + i, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), scale));
+        _mm_storeu_ps(dst + i + 4u, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), scale));
+        _mm_storeu_ps(dst + i + 8u, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), scale));
+        _mm_storeu_ps(dst + i + 12u, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), scale));
+    }
+    return i;
+}
+
+//------------------------------------------------------------------------------
+//! \brief byte() of 4 floats, as 32-bits integers.
+//------------------------------------------------------------------------------
+__attribute__((target("sse2")))
+static inline __m128i bytes(const float* src)
+{
+    // maxps returns its second operand for NaN
+    __m128 x = _mm_max_ps(_mm_loadu_ps(src), _mm_setzero_ps());
+    x = _mm_min_ps(x, _mm_set1_ps(1.0f));
+    x = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f));
+    return _mm_cvttps_epi32(x);
+}
+
+//------------------------------------------------------------------------------
+__attribute__((target("sse2")))
+static size_t toByteSSE2(const float* src, uint8_t* dst, size_t const count)
+{
+    size_t i = 0u;
+    for (; i + 16u <= count; i += 16u)
+    {
+        __m128i const lo = _mm_packs_epi32(bytes(src + i), bytes(src + i + 4u));
+        __m128i const hi = _mm_packs_epi32(bytes(src + i + 8u), bytes(src + i + 12u));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(lo, hi));
+    }
+    return i;
+}
+
+//------------------------------------------------------------------------------
+__attribute__((target("f16c")))
+static size_t toHalfF16C(const float* src, uint16_t* dst, size_t const count)
+{
+    size_t i = 0u;
+    for (; i + 4u <= count; i += 4u)
+    {
+        __m128i const h = _mm_cvtps_ph(_mm_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), h);
+    }
+    return i;
+}
+
+//------------------------------------------------------------------------------
+__attribute__((target("f16c")))
+static size_t toFloatF16C(const uint16_t* src, float* dst, size_t const count)
+{
+    size_t i = 0u;
+    for (; i + 4u <= count; i += 4u)
+    {
+        __m128i const h = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i));
+        _mm_storeu_ps(dst + i, _mm_cvtph_ps(h));
+    }
+    return i;
+}
+
+#elif defined(PIXEL_KERNELS_NEON)
+
+//------------------------------------------------------------------------------
+static size_t swizzleNEON(const uint8_t* src, size_t const sc, uint8_t* dst,
+                          size_t const dc, Swizzle const& map, size_t const count)
+{
+    Shuffle const s(sc, dc, map);
+    uint8x16_t const index = vld1q_u8(s.index);
+    uint8x16_t const ones = vld1q_u8(s.ones);
+
+    // 16 bytes are loaded: stay inside the source
+    size_t i = 0u;
+    for (; i * sc + 16u <= count * sc; i += s.texels)
+    {
+        uint8x16_t v = vld1q_u8(src + i * sc);
+        v = vorrq_u8(vqtbl1q_u8(v, index), ones);
+        if (s.bytes == 16u)
+        {
+            vst1q_u8(dst + i * dc, v);
+        }
+        else
+        {
+            uint8_t tmp[16];
+            vst1q_u8(tmp, v);
+            memcpy(dst + i * dc, tmp, s.bytes);
+        }
+    }
+    return i;
+}
+
+//------------------------------------------------------------------------------
+//! \brief (x + 127) / 255 for 16-bits lanes holding at most 255 * 255.
+//------------------------------------------------------------------------------
+static inline uint8x8_t div255(uint16x8_t const x)
+{
+    return vraddhn_u16(x, vrshrq_n_u16(x, 8));
+}
+
+//------------------------------------------------------------------------------
+static size_t premultiplyNEON(uint8_t* texels, size_t const count)
+{
+    size_t i = 0u;
+    for (; i + 16u <= count; i += 16u)
+    {
+        uint8x16x4_t v = vld4q_u8(texels + 4u * i);
+        for (int c = 0; c < 3; ++c)
+        {
+            uint16x8_t const lo = vmull_u8(vget_low_u8(v.val[c]), vget_low_u8(v.val[3]));
+            uint16x8_t const hi = vmull_u8(vget_high_u8(v.val[c]), vget_high_u8(v.val[3]));
+            v.val[c] = vcombine_u8(div255(lo), div255(hi));
+        }
+        vst4q_u8(texels + 4u * i, v);
+    }
+    return i;
+}
+
+//------------------------------------------------------------------------------
+static size_t premultiplyNEON(float* texels, size_t const count)
+{
+    for (size_t i = 0u; i < count; ++i)
+    {
+        float32x4_t const v = vld1q_f32(texels + 4u * i);
+        float const a = vgetq_lane_f32(v, 3);
+        vst1q_f32(texels + 4u * i, vsetq_lane_f32(a, vmulq_n_f32(v, a), 3));
+    }
+    return count;
+}
+
+//------------------------------------------------------------------------------
+static size_t toFloatNEON(const uint8_t* src, float* dst, size_t const count)
+{
+    float32x4_t const scale = vdupq_n_f32(255.0f);
+
+    size_t i = 0u;
+    for (; i + 16u <= count; i += 16u)
+    {
+        uint8x16_t const v = vld1q_u8(src + i);
+        uint16x8_t const lo = vmovl_u8(vget_low_u8(v));
+        uint16x8_t const hi = vmovl_u8(vget_high_u8(v));
+        vst1q_f32(dst + i, vdivq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(lo))), scale));
+        vst1q_f32(dst + i + 4u, vdivq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(lo))), scale));
+        vst1q_f32(dst + i + 8u, vdivq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(hi))), scale));
+        vst1q_f32(dst + i + 12u, vdivq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(hi))), scale));
+    }
+    return i;
+}
+
+//------------------------------------------------------------------------------
+static size_t toHalfNEON(const float* src, uint16_t* dst, size_t const count)
+{
+    size_t i = 0u;
+    for (; i + 4u <= count; i += 4u)
+    {
+        vst1_u16(dst + i, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(src + i))));
+    }
+    return i;
+}
+
+//------------------------------------------------------------------------------
+static size_t toFloatNEON(const uint16_t* src, float* dst, size_t const count)
+{
+    size_t i = 0u;
+    for (; i + 4u <= count; i += 4u)
+    {
+        vst1q_f32(dst + i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(src + i))));
+    }
+    return i;
+}
+
+#endif
+
+//------------------------------------------------------------------------------
+void swizzle(const uint8_t* src, size_t const srcChannels,
+             uint8_t* dst, size_t const dstChannels,
+             Swizzle const& map, size_t const count)
+{
+    assert((srcChannels >= 1u) && (srcChannels <= 4u));
+    assert((dstChannels >= 1u) && (dstChannels <= 4u));
+
+    size_t i = 0u;
+#if defined(PIXEL_KERNELS_X86)
+    if (hasSSSE3())
+        i = swizzleSSSE3(src, srcChannels, dst, dstChannels, map, count);
+#elif defined(PIXEL_KERNELS_NEON)
+    if (hasNEON())
+        i = swizzleNEON(src, srcChannels, dst, dstChannels, map, count);
+#endif
+
+    src += i * srcChannels;
+    dst += i * dstChannels;
+    for (; i < count; ++i)
+    {
+        for (size_t c = 0u; c < dstChannels; ++c)
+        {
+            uint8_t const m = map[c];
+            dst[c] = (m < srcChannels) ? src[m] : ((m == ONE) ? 255u : 0u);
+        }
+        src += srcChannels;
+        dst += dstChannels;
+    }
+}
+
+//------------------------------------------------------------------------------
+void premultiply(uint8_t* texels, size_t const channels, size_t const count)
+{
+    size_t const a = alphaChannel(channels);
+    if (a == 4u)
+        return ;
+
+    size_t i = 0u;
+    if (channels == 4u)
+    {
+#if defined(PIXEL_KERNELS_X86)
+        if (hasSSE2())
+            i = premultiplySSE2(texels, count);
+#elif defined(PIXEL_KERNELS_NEON)
+        if (hasNEON())
+            i = premultiplyNEON(texels, count);
+#endif
+    }
+
+    for (texels += i * channels; i < count; ++i, texels += channels)
+    {
+        unsigned const alpha = texels[a];
+        for (size_t c = 0u; c < a; ++c)
+        {
+            texels[c] = static_cast<uint8_t>((texels[c] * alpha + 127u) / 255u);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void premultiply(float* texels, size_t const channels, size_t const count)
+{
+    size_t const a = alphaChannel(channels);
+    if (a == 4u)
+        return ;
+
+    size_t i = 0u;
+    if (channels == 4u)
+    {
+#if defined(PIXEL_KERNELS_X86)
+        if (hasSSE2())
+            i = premultiplySSE2(texels, count);
+#elif defined(PIXEL_KERNELS_NEON)
+        if (hasNEON())
+            i = premultiplyNEON(texels, count);
+#endif
+    }
+
+    for (texels += i * channels; i < count; ++i, texels += channels)
+    {
+        for (size_t c = 0u; c < a; ++c)
+        {
+            texels[c] *= texels[a];
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void toFloat(const uint8_t* src, float* dst, size_t const count)
+{
+    size_t i = 0u;
+#if defined(PIXEL_KERNELS_X86)
+    if (hasSSE2())
+        i = toFloatSSE2(src, dst, count);
+#elif defined(PIXEL_KERNELS_NEON)
+    if (hasNEON())
+        i = toFloatNEON(src, dst, count);
+#endif
+
+    for (; i < count; ++i)
+    {
+        dst[i] = float(src[i]) / 255.0f;
+    }
+}
+
+//------------------------------------------------------------------------------
+void toByte(const float* src, uint8_t* dst, size_t const count)
+{
+    size_t i = 0u;
+#if defined(PIXEL_KERNELS_X86)
+    if (hasSSE2())
+        i = toByteSSE2(src, dst, count);
+#endif
+
+    for (; i < count; ++i)
+    {
+        dst[i] = byte(src[i]);
+    }
+}
+
+//------------------------------------------------------------------------------
+void toHalf(const float* src, uint16_t* dst, size_t const count)
+{
+    size_t i = 0u;
+#if defined(PIXEL_KERNELS_X86)
+    if (hasF16C())
+        i = toHalfF16C(src, dst, count);
+#elif defined(PIXEL_KERNELS_NEON)
+    if (hasNEON())
+        i = toHalfNEON(src, dst, count);
+#endif
+
+    for (; i < count; ++i)
+    {
+        dst[i] = half(src[i]);
+    }
+}
+
+//------------------------------------------------------------------------------
+void toFloat(const uint16_t* src, float* dst, size_t const count)
+{
+    size_t i = 0u;
+#if defined(PIXEL_KERNELS_X86)
+    if (hasF16C())
+        i = toFloatF16C(src, dst, count);
+#elif defined(PIXEL_KERNELS_NEON)
+    if (hasNEON())
+        i = toFloatNEON(src, dst, count);
+#endif
+
+    for (; i < count; ++i)
+    {
+        dst[i] = single(src[i]);
+    }
+}
+
+//------------------------------------------------------------------------------
+void srgbToLinear(const uint8_t* src, float* dst, size_t const channels,
+                  size_t const count)
+{
+    float const* decode = srgbTables().decode;
+    size_t const a = alphaChannel(channels);
+
+    for (size_t i = 0u; i < count; ++i, src += channels, dst += channels)
+    {
+        for (size_t c = 0u; c < channels; ++c)
+        {
+            dst[c] = (c == a) ? (float(src[c]) / 255.0f) : decode[src[c]];
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void linearToSrgb(const float* src, uint8_t* dst, size_t const channels,
+                  size_t const count)
+{
+    SrgbTables const& tables = srgbTables();
+    size_t const a = alphaChannel(channels);
+
+    for (size_t i = 0u; i < count; ++i, src += channels, dst += channels)
+    {
+        for (size_t c = 0u; c < channels; ++c)
+        {
+            if (c == a)
+            {
+                dst[c] = byte(src[c]);
+                continue;
+            }
+
+            // The table gives the code of the lower step: at most a couple of
+            // codes to climb.
+            float const x = saturate(src[c]);
+            size_t code = tables.start[size_t(x * float(SrgbTables::STEPS))];
+            while ((code < 255u) && (x > tables.thresholds[code]))
+                ++code;
+            dst[c] = static_cast<uint8_t>(code);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+//! \brief Tables of 8-bits values kept when stored in 5 or 6 bits. Drivers
+//! reduce bits by rounding or truncating and expand them by rounding or
+//! replicating high bits: the value shall be kept by all of them.
+//------------------------------------------------------------------------------
+struct LowBitTables
+{
+    LowBitTables()
+    {
+        for (unsigned v = 0u; v < 256u; ++v)
+        {
+            lossy[v] = uint8_t((kept(v, 5u) ? 0u : 1u) | (kept(v, 6u) ? 0u : 2u));
+        }
+    }
+
+    static bool kept(unsigned const v, unsigned const bits)
+    {
+        unsigned const max = (1u << bits) - 1u;
+        unsigned const q = (v * max + 127u) / 255u;
+        return ((v >> (8u - bits)) == q) &&
+               (((q * 255u + max / 2u) / max) == v) &&
+               (((q << (8u - bits)) | (q >> (2u * bits - 8u))) == v);
+    }
+
+    //! \brief Bit 0: value lost in 5 bits. Bit 1: value lost in 6 bits.
+    uint8_t lossy[256];
+};
+
+//------------------------------------------------------------------------------
+Content analyze(const uint8_t* texels, size_t const channels, size_t const count)
+{
+    // Texels are read by blocks without branches, properties being checked
+    // between blocks.
+    static constexpr size_t BLOCK = 4096u;
+    static LowBitTables const tables;
+
+    Content content;
+    size_t const a = alphaChannel(channels);
+    size_t const colors = (channels >= 3u) ? 3u : 1u;
+    content.rgb565 = (colors == 3u);
+    if (count == 0u)
+        return content;
+
+    for (size_t c = 0u; c < colors; ++c)
+        content.color[c] = texels[c];
+
+    for (size_t first = 0u; first < count; first += BLOCK)
+    {
+        size_t const n = std::min(BLOCK, count - first);
+        const uint8_t* t = texels + first * channels;
+        unsigned alpha = 0u, grey = 0u, uniform = 0u, lossy = 0u;
+
+        if (colors == 3u)
+        {
+            unsigned const r0 = content.color[0], g0 = content.color[1], b0 = content.color[2];
+            for (size_t i = 0u; i < n; ++i, t += channels)
+            {
+                unsigned const r = t[0], g = t[1], b = t[2];
+                grey |= (r ^ g) | (r ^ b);
+                uniform |= (r ^ r0) | (g ^ g0) | (b ^ b0);
+                lossy |= (tables.lossy[r] | tables.lossy[b]) & 1u;
+                lossy |= tables.lossy[g] & 2u;
+                alpha |= (a < channels) ? (t[a] ^ 255u) : 0u;
+            }
+        }
+        else
+        {
+            unsigned const l0 = content.color[0];
+            for (size_t i = 0u; i < n; ++i, t += channels)
+            {
+                uniform |= t[0] ^ l0;
+                alpha |= (a < channels) ? (t[a] ^ 255u) : 0u;
+            }
+        }
+
+        content.opaque = content.opaque && (alpha == 0u);
+        content.grey = content.grey && (grey == 0u);
+        content.uniform = content.uniform && (uniform == 0u);
+        content.rgb565 = content.rgb565 && (lossy == 0u);
+        if (!(content.opaque || content.grey || content.uniform || content.rgb565))
+            break;
+    }
+
+    return content;
+}
+
+} // namespace pixel
@@ -0,0 +1,167 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#ifndef OPENGLCPPWRAPPER_PIXEL_KERNELS_HPP
+#  define OPENGLCPPWRAPPER_PIXEL_KERNELS_HPP
+
+#  include <array>
+#  include <cstddef>
+#  include <cstdint>
+
+// *****************************************************************************
+//! \file PixelKernels.hpp Convert texels decoded from picture files into the
+//! pixel format of textures: reorder, add or remove channels, premultiply
+//! alpha, convert 8-bits channels to float or half float (with sRGB decoding)
+//! and back, find which channels texels really use.
+//!
+//! Kernels use SSE2, SSSE3 and F16C on x86 when the processor has them (checked
+//! at runtime: the library is not compiled for a given processor) and NEON on
+//! AArch64. Other processors, and remaining texels, use scalar code. Vectorized
+//! and scalar code give the same results bit for bit.
+// *****************************************************************************
+
+namespace pixel
+{
+
+//! \brief For each destination channel, the index of the source channel
+//! to copy, or ZERO or ONE (255) for a constant channel.
+using Swizzle = std::array<uint8_t, 4u>;
+
+//! \brief Swizzle value writing 0 in the destination channel.
+static constexpr uint8_t ZERO = 4u;
+//! \brief Swizzle value writing 255 (1.0) in the destination channel.
+static constexpr uint8_t ONE = 5u;
+
+//------------------------------------------------------------------------------
+//! \brief Enable or disable vectorized code (ie for benchmarks). Enabled by
+//! default when the processor has the needed instructions.
+//------------------------------------------------------------------------------
+void simd(bool const enable);
+
+//------------------------------------------------------------------------------
+//! \brief Return the instruction sets used by kernels (ie "SSE2 SSSE3 F16C",
+//! "NEON" or "none").
+//------------------------------------------------------------------------------
+const char* simd();
+
+//------------------------------------------------------------------------------
+//! \brief Reorder, duplicate, add or remove 8-bits channels: ie RGB to RGBA,
+//! RGBA to BGRA, RGBA to RGB, luminance to RGBA.
+//!
+//! \param src the source texels of srcChannels channels (1 .. 4).
+//! \param dst the destination texels of dstChannels channels (1 .. 4). Shall
+//! not overlap the source.
+//! \param map for each destination channel, a source channel, ZERO or ONE.
+//! \param count the number of texels.
+//------------------------------------------------------------------------------
+void swizzle(const uint8_t* src, size_t const srcChannels,
+             uint8_t* dst, size_t const dstChannels,
+             Swizzle const& map, size_t const count);
+
+//------------------------------------------------------------------------------
+//! \brief Multiply color channels by the alpha channel (the last channel of
+//! 2 and 4 channels texels), rounded to the nearest integer. Texels with 1 or
+//! 3 channels are not modified.
+//------------------------------------------------------------------------------
+void premultiply(uint8_t* texels, size_t const channels, size_t const count);
+
+//------------------------------------------------------------------------------
+//! \brief Multiply color channels of linear float texels by the alpha channel.
+//------------------------------------------------------------------------------
+void premultiply(float* texels, size_t const channels, size_t const count);
+
+//------------------------------------------------------------------------------
+//! \brief Convert 8-bits channels into floats in [0 1] (value / 255).
+//! \param count the number of channels.
+//------------------------------------------------------------------------------
+void toFloat(const uint8_t* src, float* dst, size_t const count);
+
+//------------------------------------------------------------------------------
+//! \brief Convert floats into 8-bits channels: clamped to [0 1] (NaN gives
+//! 0), multiplied by 255 and rounded to the nearest integer.
+//! \param count the number of channels.
+//------------------------------------------------------------------------------
+void toByte(const float* src, uint8_t* dst, size_t const count);
+
+//------------------------------------------------------------------------------
+//! \brief Convert floats into IEEE half floats, rounded to the nearest even.
+//! Infinities and NaN are kept (NaN become quiet).
+//! \param count the number of channels.
+//------------------------------------------------------------------------------
+void toHalf(const float* src, uint16_t* dst, size_t const count);
+
+//------------------------------------------------------------------------------
+//! \brief Convert IEEE half floats into floats (exact).
+//! \param count the number of channels.
+//------------------------------------------------------------------------------
+void toFloat(const uint16_t* src, float* dst, size_t const count);
+
+//------------------------------------------------------------------------------
+//! \brief Decode sRGB 8-bits texels into linear floats in [0 1] through a
+//! table. The alpha channel (the last channel of 2 and 4 channels texels) is
+//! linear: see toFloat().
+//! \param count the number of texels.
+//------------------------------------------------------------------------------
+void srgbToLinear(const uint8_t* src, float* dst, size_t const channels,
+                  size_t const count);
+
+//------------------------------------------------------------------------------
+//! \brief Encode linear float texels into sRGB 8-bits texels through a
+//! table: the result is the sRGB code whose linear value is the nearest
+//! (rounding made in sRGB space). The alpha channel is linear: see toByte().
+//! \param count the number of texels.
+//------------------------------------------------------------------------------
+void linearToSrgb(const float* src, uint8_t* dst, size_t const channels,
+                  size_t const count);
+
+// *****************************************************************************
+//! \brief Properties of 8-bits texels found by analyze(), allowing to store
+//! them with fewer channels or bits.
+// *****************************************************************************
+struct Content
+{
+    //! \brief The alpha channel is 255 in all texels (or texels have no
+    //! alpha).
+    bool opaque = true;
+    //! \brief Red, green and blue channels are equal in each texel (always
+    //! true for 1 and 2 channels texels).
+    bool grey = true;
+    //! \brief Color channels are the same in all texels: see color.
+    bool uniform = true;
+    //! \brief Color channels are kept when stored in 5 (red, blue) and 6
+    //! (green) bits then expanded to 8 bits.
+    bool rgb565 = true;
+    //! \brief Color channels of the first texel.
+    std::array<uint8_t, 3u> color = {{ 0u, 0u, 0u }};
+};
+
+//------------------------------------------------------------------------------
+//! \brief Find the properties of 8-bits texels. Stops reading texels once no
+//! property holds.
+//!
+//! \param channels the number of channels (1 .. 4), alpha being the last
+//! channel of 2 and 4 channels texels.
+//! \param count the number of texels.
+//------------------------------------------------------------------------------
+Content analyze(const uint8_t* texels, size_t const channels, size_t const count);
+
+} // namespace pixel
+
+#endif // OPENGLCPPWRAPPER_PIXEL_KERNELS_HPP
@@ -34,10 +34,17 @@
 //!   - GLTextureDepth2D:
 //!   - GLTexture3D: which is a set of 2D Textures.
 //!   - GLTextureCube: A 3D Texture specialized for rendering skybox.
+//!   - GLTextureArray2D: An array of 2D Textures sampled by sampler2DArray.
 // *****************************************************************************
 
 #  include "OpenGL/GLObject.hpp"
 #  include "OpenGL/Buffers/PendingContainer.hpp"
+#  include "OpenGL/Buffers/PixelBufferRing.hpp"
+#  include "OpenGL/Textures/ImageKernels.hpp"
+#  include "Common/PendingBoxes.hpp"
+#  include <array>
+#  include <cstring>
+#  include <memory>
 
 // *****************************************************************************
 //! \brief Helper converter CPU to GPU pixel format.
@@ -45,6 +52,9 @@
 // *****************************************************************************
 GLint CPU2GPUFormat(GLenum format, GLenum type);
 
+class GLTextureLoadQueue;
+class GLTextureResidency;
+
 // *****************************************************************************
 //! \brief Generic Texture.
 //!
@@ -56,6 +66,13 @@ GLint CPU2GPUFormat(GLenum format, GLenum type);
 // *****************************************************************************
 class GLTexture: public GLObject<GLenum>
 {
+    //! \brief Decodes texture files in background and uploads them.
+    friend class GLTextureLoadQueue;
+    //! \brief Frees GPU storage of textures not drawn recently.
+    friend class GLTextureResidency;
+    //! \brief Reads back texels asynchronously.
+    friend class GLReadbackQueue;
+
 public:
 
     //! \brief Internal format storing texture data
@@ -97,7 +114,10 @@ public:
         /* 0x1906 */ ALPHA = GL_ALPHA,
         /* 0x1907 */ RGB = GL_RGB,
         /* 0x1908 */ RGBA = GL_RGBA,
+        /* 0x80E0 */ BGR = GL_BGR,
+        /* 0x80E1 */ BGRA = GL_BGRA,
         /* 0x1909 */ LUMINANCE = GL_LUMINANCE, // Greyscale
+        /* 0x8227 */ RG = GL_RG,
         /* 0x190A */ LUMINANCE_ALPHA = GL_LUMINANCE_ALPHA, // Luminance with alpha
         /* 0x84F9 */ DEPTH_STENCIL = GL_DEPTH_STENCIL,
     };
@@ -112,7 +132,47 @@ public:
         Wrap wrapS = Wrap::REPEAT;
         Wrap wrapT = Wrap::REPEAT;
         Wrap wrapR = Wrap::REPEAT;
+        //! \brief Compute mipmaps on the CPU with this filter (see
+        //! ImageKernels.hpp).
         bool generateMipmaps = false;
+        image::Filter mipmapFilter = image::Filter::BOX;
+        //! \brief Analyze 8-bits RGB and RGBA texels once loaded and store them
+        //! with fewer channels or bits when no information is lost: opaque,
+        //! greyscale or mask images (see GLTexture2D::downsize()).
+        bool downsize = false;
+    };
+
+    // *****************************************************************************
+    //! \brief Layout of block-compressed texels (BC1 .. BC7) held by the buffer
+    //! of the texture, as read from DDS or KTX files: mipmap levels are pre-baked
+    //! and, for cube maps, stored face after face.
+    // *****************************************************************************
+    struct Compression
+    {
+        //! \brief A mipmap level of a face.
+        struct Level
+        {
+            //! \brief Position of the level inside the buffer (in bytes).
+            size_t offset = 0u;
+            //! \brief Number of bytes of the level.
+            size_t size = 0u;
+            size_t width = 0u;
+            size_t height = 0u;
+        };
+
+        //! \brief Number of mipmap levels of each face.
+        inline size_t mipmaps() const
+        {
+            return (faces == 0u) ? 0u : levels.size() / faces;
+        }
+
+        //! \brief Compressed internal format (ie GL_COMPRESSED_RGBA_BPTC_UNORM).
+        //! 0 for uncompressed texels.
+        GLenum format = 0u;
+        //! \brief 6 for cube maps, the number of images for 3D textures, else 1.
+        size_t faces = 1u;
+        //! \brief mipmaps() levels of the first face, then of the second face ...
+        std::vector<Level> levels;
     };
 
 public:
@@ -132,12 +192,10 @@ public:
     {}
 
     //--------------------------------------------------------------------------
-    //! \brief Destructor. Release elements in CPU and GPU memories.
+    //! \brief Destructor. Release elements in CPU and GPU memories. Cancel the
+    //! background loading if the texture is still in a GLTextureLoadQueue.
     //--------------------------------------------------------------------------
-    virtual ~GLTexture()
-    {
-        release();
-    }
+    virtual ~GLTexture();
 
     //--------------------------------------------------------------------------
     //! \brief Return the container holding texture data.
@@ -168,6 +226,70 @@ public:
         return 0 != m_buffer.size();
     }
 
+    //--------------------------------------------------------------------------
+    //! \brief Is the texture file still decoded in background or waiting for
+    //! its upload (see GLTextureLoadQueue) ? While loading, the texture is
+    //! bound to a 1x1 placeholder.
+    //--------------------------------------------------------------------------
+    inline bool loading() const
+    {
+        return m_load_queue != nullptr;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Are texels block-compressed (loaded from a DDS or KTX file) ? In
+    //! this case the buffer holds compressed blocks (see compression()) and
+    //! texels cannot be accessed individually.
+    //--------------------------------------------------------------------------
+    inline bool compressed() const
+    {
+        return m_compression.format != 0u;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the layout of block-compressed texels.
+    //--------------------------------------------------------------------------
+    inline Compression const& compression() const
+    {
+        return m_compression;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Change the format of texels held on the CPU, before loading them.
+    //! Loaders convert decoded texels into this format (see
+    //! TextureLoader::configure()): ie RGB files loaded as BGRA, 8-bits files
+    //! loaded as half floats.
+    //!
+    //! \param format the CPU pixel format.
+    //! \param type the type of channels (GL_UNSIGNED_BYTE, GL_HALF_FLOAT,
+    //! GL_FLOAT ...).
+    //! \param premultiplied multiply color channels by alpha when loading.
+    //! \return the reference of this instence.
+    //! \throw GL::Exception if texels are already loaded or if OpenGL has no
+    //! internal format for this format and type.
+    //--------------------------------------------------------------------------
+    GLTexture& setPixelFormat(PixelFormat const format,
+                              GLenum const type = GL_UNSIGNED_BYTE,
+                              bool const premultiplied = false);
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the channels returned to shaders (GL_TEXTURE_SWIZZLE_RGBA):
+    //! for each of red, green, blue and alpha, the stored channel (GL_RED ..
+    //! GL_ALPHA), GL_ZERO or GL_ONE.
+    //--------------------------------------------------------------------------
+    inline std::array<GLint, 4u> const& swizzle() const
+    {
+        return m_swizzle;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Are color channels multiplied by alpha when loading ?
+    //--------------------------------------------------------------------------
+    inline bool premultiplied() const
+    {
+        return m_premultiplied;
+    }
+
     //--------------------------------------------------------------------------
     //! \brief Change minifier and magnifier options.
     //! \return the reference of this instence.
@@ -207,6 +329,40 @@ public:
         return *this;
     }
 
+    //--------------------------------------------------------------------------
+    //! \brief Enable or disable the generation of mipmaps. For textures of
+    //! 8-bits channels, mipmaps are computed on the CPU with the given filter
+    //! and only the parts depending on modified texels are computed again
+    //! when the texture is updated. Other textures use glGenerateMipmap().
+    //!
+    //! \note Mipmaps are sampled only with a minifier filter using mipmaps (ie
+    //! Minification::LINEAR_MIPMAP_LINEAR).
+    //! \return the reference of this instence.
+    //--------------------------------------------------------------------------
+    GLTexture& mipmaps(bool const generate,
+                       image::Filter const filter = image::Filter::BOX)
+    {
+        m_options.generateMipmaps = generate;
+        m_options.mipmapFilter = filter;
+        m_need_setup = true;
+        return *this;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Reserve the CPU storage of texels before loading picture files
+    //! of known size (ie 16K x 16K textures): loaders decode directly into it
+    //! instead of growing the buffer while the previous storage is still
+    //! allocated.
+    //!
+    //! \param[in] bytes the number of bytes of the texels to load.
+    //! \return the reference of this instence.
+    //--------------------------------------------------------------------------
+    GLTexture& reserve(size_t const bytes)
+    {
+        m_buffer.reserve(bytes);
+        return *this;
+    }
+
     //--------------------------------------------------------------------------
     //! \brief Replace current texture settings by a new one.
     //! \return the reference of this instence.
@@ -217,6 +373,38 @@ public:
         return *this;
     }
 
+    //--------------------------------------------------------------------------
+    //! \brief Transfer modified texels to the GPU through a ring of pixel unpack
+    //! buffers (see GLPixelBufferRing) instead of client memory. Use it for
+    //! textures modified each frame (videos, CPU rendering): the CPU does not
+    //! wait for the driver copying texels.
+    //!
+    //! \param buffers the number of PBOs in the ring. 0 for transfering texels
+    //! from client memory (default).
+    //! \return the reference of this instence.
+    //--------------------------------------------------------------------------
+    GLTexture& streaming(size_t const buffers)
+    {
+        if (m_unpack != nullptr)
+        {
+            m_unpack->release();
+            m_unpack = nullptr;
+        }
+        if (buffers != 0u)
+        {
+            m_unpack = std::make_unique<GLPixelBufferRing>(GL_PIXEL_UNPACK_BUFFER, buffers);
+        }
+        return *this;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Are modified texels transfered through pixel unpack buffers ?
+    //--------------------------------------------------------------------------
+    inline bool streaming() const
+    {
+        return m_unpack != nullptr;
+    }
+
     //--------------------------------------------------------------------------
     //! \brief Return the texture dimension (1D, 2D, 3D).
     //--------------------------------------------------------------------------
@@ -256,7 +444,22 @@ public:
     }
 
     //--------------------------------------------------------------------------
-    //! \brief Read the texture data back into CPU memory
+    //! \brief Return the number of bytes the texture takes on the GPU, mipmaps
+    //! included. Estimated from texels held on the CPU.
+    //--------------------------------------------------------------------------
+    virtual size_t gpuBytes() const
+    {
+        const size_t bytes = m_buffer.size() - gpuSaving();
+        if (m_options.generateMipmaps && !compressed())
+            return bytes + bytes / 3u;
+        return bytes;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Read the texture data back into CPU memory.
+    //!
+    //! \note This call waits for the GPU to execute all previous commands. Use
+    //! GLReadbackQueue for reading back texels each frame.
     //--------------------------------------------------------------------------
     void repatriate()
     {
@@ -285,12 +488,198 @@ protected:
                                 static_cast<GLint>(m_options.wrapT)));
         glCheck(glTexParameteri(m_target, GL_TEXTURE_WRAP_R,
                                 static_cast<GLint>(m_options.wrapR)));
+        glCheck(glTexParameteriv(m_target, GL_TEXTURE_SWIZZLE_RGBA, m_swizzle.data()));
 
         //TODO
         //GLfloat borderColor[4] = { 1.0f, 0.0f, 0.0f, 1.0f};
         //glCheck(glTexParameterfv(m_target, GL_TEXTURE_BORDER_COLOR, borderColor));
     }
 
+    //--------------------------------------------------------------------------
+    //! \brief Are color channels sRGB encoded on the GPU ? In this case mipmaps
+    //! are averaged in linear space.
+    //--------------------------------------------------------------------------
+    inline bool srgb() const
+    {
+        return (m_gpuPixelFormat == GL_SRGB) || (m_gpuPixelFormat == GL_SRGB8) ||
+               (m_gpuPixelFormat == GL_SRGB_ALPHA) || (m_gpuPixelFormat == GL_SRGB8_ALPHA8);
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Delete the OpenGL texture but keep texels on the CPU: unlike
+    //! release(), the texture is specified again by the next begin().
+    //--------------------------------------------------------------------------
+    void evict()
+    {
+        if (m_handle == 0u)
+            return ;
+
+        glCheck(glDeleteTextures(1U, &m_handle));
+        if (m_unpack != nullptr)
+        {
+            m_unpack->release();
+        }
+        m_handle = 0u;
+        m_need_create = true;
+        m_need_setup = true;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Number of bytes of a texel in the CPU buffer: channels times the
+    //! size of the CPU pixel type (ie 16 bytes for RGBA GL_FLOAT).
+    //--------------------------------------------------------------------------
+    inline size_t texelBytes() const
+    {
+        switch (m_cpuPixelType)
+        {
+        case GL_FLOAT:
+        case GL_INT:
+        case GL_UNSIGNED_INT:
+            return m_cpuPixelCount * 4u;
+        case GL_HALF_FLOAT:
+        case GL_SHORT:
+        case GL_UNSIGNED_SHORT:
+            return m_cpuPixelCount * 2u;
+        default:
+            return m_cpuPixelCount;
+        }
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Bytes saved on the GPU compared to the current CPU buffer: RGB
+    //! texels downsized to 5-6-5 bits take 2 bytes instead of 3.
+    //--------------------------------------------------------------------------
+    inline size_t gpuSaving() const
+    {
+        return (m_downsized && (m_gpuPixelFormat == GL_RGB565))
+               ? m_buffer.size() / 3u : 0u;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Compute again m_gpuSaving from the current size of the CPU
+    //! buffer (ie once emptied or reloaded) and update GPUMemory().
+    //--------------------------------------------------------------------------
+    inline void updateGpuSaving()
+    {
+        GPUMemory() += m_gpuSaving;
+        m_gpuSaving = gpuSaving();
+        GPUMemory() -= m_gpuSaving;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Byte offset in the CPU buffer of the texel (x, y, z).
+    //--------------------------------------------------------------------------
+    inline size_t offset(size_t const x, size_t const y, size_t const z = 0u) const
+    {
+        return ((z * m_height + y) * m_width + x) * texelBytes();
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Number of bytes read by glTexSubImage*() for transfering the
+    //! box, from its first texel, when rows are m_width texels long and images
+    //! m_height rows high (see beginUnpackBoxes()).
+    //--------------------------------------------------------------------------
+    inline size_t span(PendingBoxes::Box const& box) const
+    {
+        return offset(box.x + box.width, box.y + box.height - 1u, box.z + box.depth - 1u)
+                - offset(box.x, box.y, box.z);
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the disjoint boxes of texels to transfer to the GPU: boxes
+    //! tagged by set() or setPending() plus rows (or whole images for 3D
+    //! textures) holding bytes modified through data().
+    //--------------------------------------------------------------------------
+    std::vector<PendingBoxes::Box> const& pendingBoxes()
+    {
+        const size_t height = std::max(size_t(1u), m_height);
+        const size_t texel = texelBytes();
+        const size_t bytes = m_width * height * std::max(size_t(1u), m_depth) * texel;
+
+        if (m_buffer.isPending() && (bytes != 0u))
+        {
+            size_t start, stop;
+            m_buffer.getPending(start, stop);
+            stop = std::min(stop, bytes);
+            if (start < stop)
+            {
+                const size_t first = start / texel;
+                const size_t last = (stop - 1u) / texel;
+                const size_t z0 = first / (m_width * height);
+                const size_t z1 = last / (m_width * height);
+                if (z0 == z1)
+                {
+                    const size_t y0 = (first / m_width) % height;
+                    const size_t y1 = (last / m_width) % height;
+                    m_dirty_boxes.setPending(0u, y0, z0, m_width, y1 - y0 + 1u, 1u);
+                }
+                else
+                {
+                    m_dirty_boxes.setPending(0u, 0u, z0, m_width, height, z1 - z0 + 1u);
+                }
+            }
+        }
+
+        m_buffer.clearPending();
+        return m_dirty_boxes.getPending();
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Let glTexSubImage*() read boxes of texels inside the CPU buffer:
+    //! rows are m_width texels long and images m_height rows high.
+    //--------------------------------------------------------------------------
+    void beginUnpackBoxes() const
+    {
+        glCheck(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+        glCheck(glPixelStorei(GL_UNPACK_ROW_LENGTH, static_cast<GLint>(m_width)));
+        glCheck(glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, static_cast<GLint>(m_height)));
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Restore default unpacking parameters.
+    //--------------------------------------------------------------------------
+    void endUnpackBoxes() const
+    {
+        glCheck(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+        glCheck(glPixelStorei(GL_UNPACK_ROW_LENGTH, 0));
+        glCheck(glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, 0));
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the source of texels to give to glTexSubImage*(): when
+    //! streaming, texels are copied into the next pixel unpack buffer of the
+    //! ring and the offset inside this buffer is returned, else texels are
+    //! returned unchanged. Shall be followed by endUnpack().
+    //--------------------------------------------------------------------------
+    const void* beginUnpack(const unsigned char* texels, size_t const bytes)
+    {
+        if (m_unpack == nullptr)
+            return texels;
+
+        void* memory = m_unpack->map(bytes);
+        if (unlikely(memory == nullptr))
+            return texels;
+
+        std::memcpy(memory, texels, bytes);
+        if (unlikely(!m_unpack->unmap()))
+        {
+            m_unpack->unbind();
+            return texels;
+        }
+        return m_unpack->offset();
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Restore client memory as the source of texels.
+    //--------------------------------------------------------------------------
+    inline void endUnpack()
+    {
+        if (m_unpack != nullptr)
+        {
+            m_unpack->unbind();
+        }
+    }
+
 private:
 
     //--------------------------------------------------------------------------
@@ -299,7 +688,7 @@ private:
     //--------------------------------------------------------------------------
     virtual inline bool needUpdate() const override
     {
-        return m_buffer.isPending();
+        return m_buffer.isPending() || m_dirty_boxes.isPending();
     }
 
     //--------------------------------------------------------------------------
@@ -312,12 +701,10 @@ private:
     }
 
     //--------------------------------------------------------------------------
-    //! \brief Bind the Texture to OpenGL.
+    //! \brief Bind the Texture to OpenGL. Tell the residency manager (if any)
+    //! that the texture is used.
     //--------------------------------------------------------------------------
-    virtual void onActivate() override
-    {
-        glCheck(glBindTexture(m_target, m_handle));
-    }
+    virtual void onActivate() override;
 
     //--------------------------------------------------------------------------
     //! \brief Unbind the Texture to OpenGL.
@@ -333,14 +720,28 @@ private:
     virtual void onRelease() override
     {
         glCheck(glDeleteTextures(1U, &m_handle));
+        if (m_unpack != nullptr)
+        {
+            m_unpack->release();
+        }
         m_buffer.clear();
+        m_dirty_boxes.clearPending();
+        m_compression = Compression();
         m_width = m_height = m_depth = 0;
         m_cpuPixelFormat = PixelFormat::RGBA;
         m_cpuPixelType = GL_UNSIGNED_BYTE;
+        m_premultiplied = false;
+        m_swizzle = IDENTITY;
+        GPUMemory() += m_gpuSaving;
+        m_gpuSaving = 0u;
+        m_downsized = false;
     }
 
 protected:
 
+    //! \brief Default swizzle: channels returned unchanged.
+    static constexpr std::array<GLint, 4u> IDENTITY = {{ GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA }};
+
     //! \brief Options to pass to OpenGL
     Options      m_options;
     //! \brief Hold the texture (CPU side)
@@ -358,8 +759,31 @@ protected:
     size_t       m_cpuPixelCount = 4u;
     //! \brief Specify the data type of the GPU pixel data
     GLenum       m_cpuPixelType = GL_UNSIGNED_BYTE;
+    //! \brief Multiply color channels by alpha when loading.
+    bool         m_premultiplied = false;
+    //! \brief Channels returned to shaders.
+    std::array<GLint, 4u> m_swizzle = IDENTITY;
+    //! \brief Bytes saved on the GPU compared to the CPU buffer, when the GPU
+    //! format has fewer bits than the CPU one (already removed from
+    //! GPUMemory()).
+    size_t       m_gpuSaving = 0u;
+    //! \brief Has GLTexture2D::downsize() changed the format ? Then the
+    //! format asked before.
+    bool         m_downsized = false;
+    PixelFormat  m_requestedFormat = PixelFormat::RGBA;
+    GLint        m_requestedGpuFormat = GL_RGBA8;
     //! \brief Desired format of texture once loaded into the GPU.
     GLint        m_gpuPixelFormat = GL_RGBA;
+    //! \brief Layout of block-compressed texels (if any).
+    Compression  m_compression;
+    //! \brief Boxes of texels modified since the last transfer to the GPU.
+    PendingBoxes m_dirty_boxes;
+    //! \brief Pixel unpack buffers used when streaming (else nullptr).
+    std::unique_ptr<GLPixelBufferRing> m_unpack;
+    //! \brief The queue decoding the texture file in background (if any).
+    GLTextureLoadQueue* m_load_queue = nullptr;
+    //! \brief The manager evicting the texture when not used (if any).
+    GLTextureResidency* m_residency = nullptr;
 
 private:
 
@@ -19,3 +19,119 @@
 //=====================================================================
 
 #include "OpenGL/Textures/Texture2D.hpp"
+
+//------------------------------------------------------------------------------
+void GLTexture2D::downsize()
+{
+    // Texels loaded again into a texture already downsized
+    updateGpuSaving();
+
+    if ((!m_options.downsize) || compressed() || (m_unpack != nullptr) ||
+        (m_cpuPixelType != GL_UNSIGNED_BYTE) || (m_buffer.size() == 0u) ||
+        ((m_cpuPixelFormat != PixelFormat::RGBA) && (m_cpuPixelFormat != PixelFormat::RGB)))
+        return ;
+
+    // Keep formats chosen by the user (ie integer or normalized signed)
+    bool const srgb = this->srgb();
+    if ((!srgb) && (m_gpuPixelFormat != CPU2GPUFormat(GLenum(m_cpuPixelFormat),
+                                                      GL_UNSIGNED_BYTE)))
+        return ;
+
+    size_t const channels = m_cpuPixelCount;
+    size_t const count = m_buffer.size() / channels;
+    pixel::Content const content = pixel::analyze(m_buffer.to_array(), channels, count);
+
+    auto binary = [](uint8_t const c) { return (c == 0u) || (c == 255u); };
+    auto constant = [](uint8_t const c) { return (c == 0u) ? GL_ZERO : GL_ONE; };
+
+    PixelFormat format;
+    pixel::Swizzle map;
+    GLint gpuFormat;
+    std::array<GLint, 4u> swizzle = IDENTITY;
+    if (srgb)
+    {
+        // No sRGB format with fewer channels than RGB
+        if ((!content.opaque) || (channels == 3u))
+            return ;
+        format = PixelFormat::RGB;
+        map = {{ 0u, 1u, 2u, pixel::ZERO }};
+        gpuFormat = GL_SRGB8;
+    }
+    else if ((channels == 4u) && content.uniform && binary(content.color[0]) &&
+             binary(content.color[1]) && binary(content.color[2]))
+    {
+        format = PixelFormat::RED;
+        map = {{ 3u, pixel::ZERO, pixel::ZERO, pixel::ZERO }};
+        gpuFormat = GL_R8;
+        swizzle = {{ constant(content.color[0]), constant(content.color[1]),
+                     constant(content.color[2]), GL_RED }};
+    }
+    else if (content.grey && content.opaque)
+    {
+        format = PixelFormat::RED;
+        map = {{ 0u, pixel::ZERO, pixel::ZERO, pixel::ZERO }};
+        gpuFormat = GL_R8;
+        swizzle = {{ GL_RED, GL_RED, GL_RED, GL_ONE }};
+    }
+    else if (content.grey)
+    {
+        format = PixelFormat::RG;
+        map = {{ 0u, 3u, pixel::ZERO, pixel::ZERO }};
+        gpuFormat = GL_RG8;
+        swizzle = {{ GL_RED, GL_RED, GL_RED, GL_GREEN }};
+    }
+    else if (content.opaque)
+    {
+        format = PixelFormat::RGB;
+        map = {{ 0u, 1u, 2u, pixel::ZERO }};
+        gpuFormat = content.rgb565 ? GL_RGB565 : GL_RGB8;
+    }
+    else
+    {
+        return ;
+    }
+
+    if ((format == m_cpuPixelFormat) && (gpuFormat == m_gpuPixelFormat))
+        return ;
+
+    m_downsized = true;
+    m_requestedFormat = m_cpuPixelFormat;
+    m_requestedGpuFormat = m_gpuPixelFormat;
+
+    // Pack texels on the CPU too: uploads and mipmaps use fewer bytes.
+    size_t const packed = (format == PixelFormat::RGB) ? 3u
+                        : ((format == PixelFormat::RG) ? 2u : 1u);
+    if (packed != channels)
+    {
+        Buffer texels;
+        pixel::swizzle(m_buffer.to_array(), channels, texels.extend(count * packed),
+                       packed, map, count);
+        m_buffer.swap(texels);
+    }
+
+    m_cpuPixelFormat = format;
+    m_cpuPixelCount = packed;
+    m_gpuPixelFormat = gpuFormat;
+    m_swizzle = swizzle;
+
+    // 5-6-5 bits texels take 2 bytes on the GPU instead of 3 on the CPU
+    updateGpuSaving();
+}
+
+//------------------------------------------------------------------------------
+void GLTexture2D::restore()
+{
+    if (!m_downsized)
+        return ;
+
+    m_downsized = false;
+    GPUMemory() += m_gpuSaving;
+    m_gpuSaving = 0u;
+    m_buffer.reset();
+    m_width = m_height = 0u;
+    m_cpuPixelFormat = m_requestedFormat;
+    m_cpuPixelCount = (m_requestedFormat == PixelFormat::RGBA) ? 4u : 3u;
+    m_gpuPixelFormat = m_requestedGpuFormat;
+    m_swizzle = IDENTITY;
+    m_need_setup = true;
+}
@@ -46,6 +46,9 @@ class GLTexture2D: public GLTexture
     //! GLTexture2D private states.
     friend class GLTextureCube;
     friend class GLTextureBuffer;
+    friend class GLTextureLoadQueue;
+    friend class GLTextureAtlas;
+    friend class GLTextureRegistry;
 
 public:
 
@@ -142,6 +145,27 @@ public:
         return doload(loader, filename);
     }
 
+    //--------------------------------------------------------------------------
+    //! \brief If enabled by options, store loaded texels with fewer channels
+    //! or bits when this loses no information, choosing in this order:
+    //!   - GL_R8 holding alpha for masks (color channels constant and 0 or 255).
+    //!   - GL_R8 for opaque greyscale texels.
+    //!   - GL_RG8 holding luminance and alpha for greyscale texels.
+    //!   - GL_RGB565 for opaque texels kept by 5-6-5 bits.
+    //!   - GL_RGB8 (GL_SRGB8 for sRGB textures) for opaque texels.
+    //! Texels of the CPU buffer are packed the same way and the swizzle mask
+    //! lets shaders sample the same channels than before.
+    //! \note sRGB textures only drop alpha. Streamed textures are not
+    //! modified since new frames come in the format of the texture.
+    //--------------------------------------------------------------------------
+    void downsize();
+
+    //--------------------------------------------------------------------------
+    //! \brief Undo downsize() before loading new texels: come back to the
+    //! format asked by the user and drop the packed texels.
+    //--------------------------------------------------------------------------
+    void restore();
+
     //--------------------------------------------------------------------------
     //! \brief Save the texture into a picture file depending on the file extension
     //! on filename.
@@ -179,16 +203,19 @@ public:
     }
 
     //--------------------------------------------------------------------------
-    //! \brief Set to the nth byte of the texture (write access).
+    //! \brief Set to the nth byte of the texture (write access). Only the
+    //! texel holding this byte will be transfered to the GPU.
+    //! \note Not usable with block-compressed textures (see compressed()).
     //--------------------------------------------------------------------------
     inline unsigned char& set(std::size_t const nth)
     {
-        //TBD ?
-        //if (nth > m_width * m_height)
-        //  {
-        //    reserve(nth);
-        //  }
-        return m_buffer.set(nth);
+        // Growing the buffer: transfer the whole texture
+        if (unlikely((nth >= m_buffer.size()) || (m_width == 0u)))
+            return m_buffer.set(nth);
+
+        const size_t texel = nth / texelBytes();
+        m_dirty_boxes.setPending(texel % m_width, texel / m_width);
+        return m_buffer.to_array()[nth];
     }
 
     //--------------------------------------------------------------------------
@@ -200,19 +227,100 @@ public:
     }
 
     //--------------------------------------------------------------------------
-    //! \brief Set to the nth byte of the texture (write access).
+    //! \brief Set to the byte off of the texel at row u and column v (write
+    //! access).
     //--------------------------------------------------------------------------
     inline unsigned char& set(const size_t u, const size_t v, const size_t off)
     {
-        return GLTexture2D::set((u * m_width + v) * 4 + off); //TODO 4 because RGBA
+        return GLTexture2D::set((u * m_width + v) * texelBytes() + off);
     }
 
     //--------------------------------------------------------------------------
-    //! \brief Get to the nth byte of the texture (read only access.
+    //! \brief Get to the byte off of the texel at row u and column v (read
+    //! only access).
     //--------------------------------------------------------------------------
     inline const unsigned char& get(const size_t u, const size_t v, const size_t off) const
     {
-        return GLTexture2D::get((u * m_width + v) * 4 + off);
+        return GLTexture2D::get((u * m_width + v) * texelBytes() + off);
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Tag as dirty a rectangle of texels modified through data(). Only
+    //! dirty rectangles are transfered to the GPU.
+    //!
+    //! \note Without it, rows holding bytes modified through data() are
+    //! transfered.
+    //--------------------------------------------------------------------------
+    inline void setPending(size_t const x, size_t const y,
+                           size_t const width, size_t const height)
+    {
+        m_dirty_boxes.setPending(x, y, 0u, width, height, 1u);
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Map the memory of the next pixel unpack buffer of the ring (see
+    //! streaming()) for writing directly the whole image of a new frame. This
+    //! avoids copying texels from the CPU buffer of the texture. Call unmap()
+    //! for transfering the image to the texture.
+    //!
+    //! \note The CPU buffer (data()) is not modified by the new frame.
+    //! \return the address where to write width() * height() pixels, or
+    //! nullptr if the texture is not streaming or has not been setup (call
+    //! begin() first).
+    //--------------------------------------------------------------------------
+    unsigned char* map()
+    {
+        if ((m_unpack == nullptr) || (m_handle == 0u) || m_need_setup)
+            return nullptr;
+
+        return static_cast<unsigned char*>(
+            m_unpack->map(m_width * m_height * texelBytes()));
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Unmap the memory given by map() and transfer the image to the
+    //! texture. The CPU does not wait for the transfer.
+    //!
+    //! \return false if the texture is not streaming or if the content of the
+    //! pixel unpack buffer has been corrupted: the frame is lost.
+    //--------------------------------------------------------------------------
+    bool unmap()
+    {
+        if (m_unpack == nullptr)
+            return false;
+
+        const bool res = m_unpack->unmap();
+        if (likely(res))
+        {
+            glCheck(glBindTexture(m_target, m_handle));
+            glCheck(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+            glCheck(glTexSubImage2D(m_target, 0, 0, 0,
+                                    static_cast<GLsizei>(m_width),
+                                    static_cast<GLsizei>(m_height),
+                                    static_cast<GLenum>(m_cpuPixelFormat),
+                                    static_cast<GLenum>(m_cpuPixelType),
+                                    m_unpack->offset()));
+            glCheck(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+        }
+        m_unpack->unbind();
+        if (likely(res))
+        {
+            // Texels are not in the CPU buffer: let OpenGL compute mipmaps.
+            if (m_options.generateMipmaps)
+            {
+                glCheck(glGenerateMipmap(m_target));
+            }
+            glCheck(glBindTexture(m_target, 0u));
+        }
+        return res;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the mipmaps computed on the CPU (see mipmaps()).
+    //--------------------------------------------------------------------------
+    inline image::MipChain const& mipChain() const
+    {
+        return m_mipmaps;
     }
 
 private:
@@ -229,18 +337,46 @@ private:
     //--------------------------------------------------------------------------
     bool doload(TextureLoader& loader, const char *const filename)
     {
-        if (!loader.setPixelFormat(m_cpuPixelFormat))
+        if (!configure(loader))
             return false;
 
-        m_cpuPixelCount = loader.getPixelCount();
-        m_cpuPixelType = loader.getPixelType();
-        m_gpuPixelFormat = CPU2GPUFormat(GLenum(m_cpuPixelFormat), GLenum(m_cpuPixelType));
-        if (m_gpuPixelFormat < 0)
+        // Texels are decoded into the reserved storage (see reserve())
+        m_buffer.reset();
+        m_width = m_height = 0;
+        if (!loader.decode(filename, m_buffer, m_width, m_height))
             return false;
 
-        m_buffer.clear();
-        m_width = m_height = 0;
-        return loader.load(filename, m_buffer, m_width, m_height);
+        compress(loader);
+        downsize();
+        return true;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Get back from the loader the layout of block-compressed texels
+    //! stored in the buffer (if any).
+    //--------------------------------------------------------------------------
+    void compress(TextureLoader const& loader)
+    {
+        GLTexture::Compression const* compression = loader.compression();
+        m_compression = (compression != nullptr) ? *compression : Compression();
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Configure the loader for the CPU pixel format of this texture
+    //! and get back from it the GPU pixel format.
+    //!
+    //! \return false if the loader does not manage the pixel format.
+    //--------------------------------------------------------------------------
+    bool configure(TextureLoader& loader)
+    {
+        // Texels are decoded again in the format asked before downsize()
+        restore();
+        if (!loader.configure(m_cpuPixelFormat, m_cpuPixelType, m_premultiplied))
+            return false;
+
+        m_cpuPixelCount = loader.channels();
+        m_gpuPixelFormat = CPU2GPUFormat(GLenum(m_cpuPixelFormat), GLenum(m_cpuPixelType));
+        return m_gpuPixelFormat >= 0;
     }
 
     //--------------------------------------------------------------------------
@@ -253,7 +389,9 @@ private:
     //--------------------------------------------------------------------------
     bool dosave(TextureLoader& loader, const char *const filename)
     {
-        if (loader.setPixelFormat(m_cpuPixelFormat))
+        // Loaders only save texels in the format they decode
+        if (loader.setPixelFormat(m_cpuPixelFormat) &&
+            (loader.getPixelType() == m_cpuPixelType))
             return loader.save(filename, m_buffer, m_width, m_height);
         return false;
     }
@@ -263,9 +401,17 @@ private:
     //--------------------------------------------------------------------------
     inline void specifyTexture2D() const
     {
+        if (compressed())
+        {
+            specifyCompressed();
+            return ;
+        }
+
         // Note: is allowed this case:
         // m_width != 0 and m_height != 0 and buffer == nullptr
         // This will reserve the buffer size.
+        // Rows are not padded (ie RGB textures with an odd width).
+        glCheck(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
         glCheck(glTexImage2D(m_target, 0,
                              static_cast<GLint>(m_gpuPixelFormat),
                              static_cast<GLsizei>(m_width),
@@ -274,6 +420,127 @@ private:
                              static_cast<GLenum>(m_cpuPixelFormat),
                              static_cast<GLenum>(m_cpuPixelType),
                              m_buffer.to_array()));
+        glCheck(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Specify to OpenGL the pre-baked levels of a block-compressed
+    //! two-dimensional texture image.
+    //--------------------------------------------------------------------------
+    inline void specifyCompressed() const
+    {
+        const size_t mipmaps = m_compression.mipmaps();
+        for (size_t level = 0u; level < mipmaps; ++level)
+        {
+            Compression::Level const& it = m_compression.levels[level];
+            glCheck(glCompressedTexImage2D(m_target, static_cast<GLint>(level),
+                                           m_compression.format,
+                                           static_cast<GLsizei>(it.width),
+                                           static_cast<GLsizei>(it.height),
+                                           0,
+                                           static_cast<GLsizei>(it.size),
+                                           m_buffer.to_array() + it.offset));
+        }
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Specify to OpenGL a 1x1 opaque white image, sampled while the
+    //! texture file is loaded in background.
+    //--------------------------------------------------------------------------
+    inline void specifyPlaceholder() const
+    {
+        static const unsigned char white[4] = { 255u, 255u, 255u, 255u };
+
+        glCheck(glTexImage2D(m_target, 0, GL_RGBA8, 1, 1, 0,
+                             GL_RGBA, GL_UNSIGNED_BYTE, white));
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Compute all mipmaps and specify them to OpenGL, if enabled by
+    //! options. Mipmaps of 8-bits channels are computed on the CPU, others by
+    //! glGenerateMipmap(). Block-compressed textures use their pre-baked levels.
+    //--------------------------------------------------------------------------
+    void specifyMipmaps()
+    {
+        m_mipmaps.clear();
+        if (compressed())
+        {
+            // Use pre-baked levels
+            glCheck(glTexParameteri(m_target, GL_TEXTURE_MAX_LEVEL,
+                                    static_cast<GLint>(m_compression.mipmaps()) - 1));
+            return;
+        }
+
+        if (!m_options.generateMipmaps || (m_buffer.size() == 0u))
+            return;
+
+        if (m_cpuPixelType != GL_UNSIGNED_BYTE)
+        {
+            glCheck(glGenerateMipmap(m_target));
+            return;
+        }
+
+        m_mipmaps.build(m_buffer.to_array(), m_width, m_height, m_cpuPixelCount,
+                        m_options.mipmapFilter, srgb());
+
+        GLint level = 0;
+        glCheck(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+        for (auto const& it: m_mipmaps.levels())
+        {
+            glCheck(glTexImage2D(m_target, ++level,
+                                 static_cast<GLint>(m_gpuPixelFormat),
+                                 static_cast<GLsizei>(it.width),
+                                 static_cast<GLsizei>(it.height),
+                                 0,
+                                 static_cast<GLenum>(m_cpuPixelFormat),
+                                 static_cast<GLenum>(m_cpuPixelType),
+                                 it.texels.data()));
+        }
+        glCheck(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+        glCheck(glTexParameteri(m_target, GL_TEXTURE_MAX_LEVEL, level));
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Compute again and upload the parts of mipmaps depending on the
+    //! given regions of modified texels.
+    //--------------------------------------------------------------------------
+    void updateMipmaps(std::vector<PendingBoxes::Box> const& boxes)
+    {
+        if (!m_options.generateMipmaps)
+            return;
+
+        if (m_mipmaps.levels().empty())
+        {
+            if (m_cpuPixelType != GL_UNSIGNED_BYTE)
+            {
+                glCheck(glGenerateMipmap(m_target));
+            }
+            return;
+        }
+
+        m_mipmaps.update(m_buffer.to_array(), boxes);
+
+        GLint level = 0;
+        glCheck(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+        for (auto const& it: m_mipmaps.levels())
+        {
+            ++level;
+            glCheck(glPixelStorei(GL_UNPACK_ROW_LENGTH, static_cast<GLint>(it.width)));
+            for (auto const& box: it.dirty)
+            {
+                glCheck(glTexSubImage2D(m_target, level,
+                                        static_cast<GLint>(box.x),
+                                        static_cast<GLint>(box.y),
+                                        static_cast<GLsizei>(box.width),
+                                        static_cast<GLsizei>(box.height),
+                                        static_cast<GLenum>(m_cpuPixelFormat),
+                                        static_cast<GLenum>(m_cpuPixelType),
+                                        it.texels.data() + (box.y * it.width + box.x)
+                                        * m_cpuPixelCount));
+            }
+        }
+        glCheck(glPixelStorei(GL_UNPACK_ROW_LENGTH, 0));
+        glCheck(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
     }
 
     //--------------------------------------------------------------------------
@@ -281,6 +548,15 @@ private:
     //--------------------------------------------------------------------------
     virtual bool onSetup() override
     {
+        // Texture file still decoded by a GLTextureLoadQueue: let GLVAO sample
+        // a placeholder until the queue uploads the picture.
+        if (loading())
+        {
+            applyTextureParam();
+            specifyPlaceholder();
+            return false;
+        }
+
         // Note: m_buffer can nullptr
         if (unlikely(!loaded()))
         {
@@ -292,39 +568,58 @@ private:
 
         applyTextureParam();
         specifyTexture2D();
+        specifyMipmaps();
+
+        // The whole buffer has just been transfered: do not transfer it again
+        // with onUpdate().
+        m_buffer.clearPending();
+        m_dirty_boxes.clearPending();
         return false;
     }
 
     //--------------------------------------------------------------------------
-    //! \brief Upload dirty CPU data to the GPU.
+    //! \brief Upload dirty rectangles of texels to the GPU, from client memory
+    //! or through pixel unpack buffers when streaming().
     //--------------------------------------------------------------------------
     virtual bool onUpdate() override
     {
-        //TODO
-#  pragma GCC diagnostic push
-#  pragma GCC diagnostic ignored "-Wsign-conversion"
-#  pragma GCC diagnostic ignored "-Wconversion"
-
-        size_t start, stop;
-        m_buffer.getPending(start, stop);
-
-        start = start / m_cpuPixelCount;
-        stop = stop / m_cpuPixelCount;
-        const GLint x = start / m_width;
-        const GLint y = start % m_width;
-        const GLsizei width = (stop / m_width) - x;
-        const GLsizei height = (stop % m_width) - y;
-
-        // FIXME: not working if width and height are not the texture size
-        glCheck(glTexSubImage2D(m_target, 0, x, y, width, height,
-                                static_cast<GLenum>(m_cpuPixelFormat),
-                                static_cast<GLenum>(m_cpuPixelType),
-                                m_buffer.to_array()));
+        // Blocks cannot be updated by texels: transfer again all levels.
+        if (compressed())
+        {
+            specifyCompressed();
+            m_buffer.clearPending();
+            m_dirty_boxes.clearPending();
+            return false;
+        }
 
-        m_buffer.clearPending();
+        auto const& boxes = pendingBoxes();
+
+        beginUnpackBoxes();
+        for (auto const& box: boxes)
+        {
+            const void* texels = beginUnpack(m_buffer.to_array() + offset(box.x, box.y),
+                                             span(box));
+            glCheck(glTexSubImage2D(m_target, 0,
+                                    static_cast<GLint>(box.x),
+                                    static_cast<GLint>(box.y),
+                                    static_cast<GLsizei>(box.width),
+                                    static_cast<GLsizei>(box.height),
+                                    static_cast<GLenum>(m_cpuPixelFormat),
+                                    static_cast<GLenum>(m_cpuPixelType),
+                                    texels));
+            endUnpack();
+        }
+        endUnpackBoxes();
+        updateMipmaps(boxes);
+
+        m_dirty_boxes.clearPending();
         return false;
-#  pragma GCC diagnostic pop
-    };
+    }
+
+private:
+
+    //! \brief Mipmaps computed on the CPU.
+    image::MipChain m_mipmaps;
 };
 
 // *****************************************************************************
@@ -375,4 +670,78 @@ public:
     }
 };
 
+// *****************************************************************************
+//! \brief A multisampled 2D texture to be rendered by a GLFrameBuffer. Texels
+//! cannot be given by the CPU nor filtered: shaders fetch samples with
+//! texelFetch() on a sampler2DMS, or GLFrameBuffer::resolve() averages them
+//! into a single-sample framebuffer.
+// *****************************************************************************
+class GLTexture2DMultisample: public GLTexture2D
+{
+public:
+
+    //--------------------------------------------------------------------------
+    //! \brief Constructor.
+    //!
+    //! Give a name to the instance. This constructor makes no other
+    //! actions. The size is given by the GLFrameBuffer.
+    //!
+    //! \param name the name of this instance used by GLProgram and GLVAO.
+    //! \param samples the number of samples per texel. Shall be > 0.
+    //! \param format the sized internal format (ie GL_RGBA8, GL_RGBA16F or
+    //! GL_DEPTH_COMPONENT24).
+    //--------------------------------------------------------------------------
+    GLTexture2DMultisample(std::string const& name, GLsizei const samples,
+                           GLenum const format = GL_RGBA8)
+        : GLTexture2D(name), m_samples(samples)
+    {
+        m_target = GL_TEXTURE_2D_MULTISAMPLE;
+        m_gpuPixelFormat = static_cast<GLint>(format);
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of samples per texel.
+    //--------------------------------------------------------------------------
+    inline GLsizei samples() const
+    {
+        return m_samples;
+    }
+
+private:
+
+    //--------------------------------------------------------------------------
+    //! \brief Allocate the samples. Multisampled textures have no sampler
+    //! parameters nor mipmaps.
+    //--------------------------------------------------------------------------
+    virtual bool onSetup() override
+    {
+        if (unlikely(!loaded()))
+        {
+            std::cerr << "Cannot setup texture '" << name()
+                      << "'. Reason 'Unknown size'"
+                      << std::endl;
+            return true;
+        }
+
+        glCheck(glTexImage2DMultisample(m_target, m_samples,
+                                        static_cast<GLenum>(m_gpuPixelFormat),
+                                        static_cast<GLsizei>(m_width),
+                                        static_cast<GLsizei>(m_height),
+                                        GL_TRUE));
+        return false;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Samples are only written by framebuffers.
+    //--------------------------------------------------------------------------
+    virtual bool onUpdate() override
+    {
+        return false;
+    }
+
+private:
+
+    GLsizei m_samples;
+};
+
 #endif // OPENGLCPPWRAPPER_GLTEXTURE2D_HPP
@@ -34,6 +34,8 @@
 // *****************************************************************************
 
 #  include "OpenGL/Textures/Texture2D.hpp"
+#  include "Common/ParallelFor.hpp"
+#  include <mutex>
 
 // *****************************************************************************
 //! \brief A 3D Texture.
@@ -50,62 +52,240 @@ public:
     {}
 
     //--------------------------------------------------------------------------
-    //! \brief
+    //! \brief Load the images of the texture from picture files.
+    //!
+    //! Files can be decoded concurrently: the first image gives the size of
+    //! all images, the buffer is then allocated once and each thread copies
+    //! the image it has decoded at its final offset (images decoded before the
+    //! first one are copied once it is known). The texture is uploaded by a
+    //! single glTexImage3D().
+    //!
+    //! \note Images can be block-compressed (see CompressedLoader): only their
+    //! first level is used. Beware OpenGL only accepts BC6H and BC7 formats for
+    //! 3D textures.
+    //!
+    //! \param filenames the picture files of the images, from the first one.
+    //! \param threads the number of threads decoding files. If 0 (default)
+    //! then the number of hardware threads is used. If 1 then files are
+    //! decoded one after another by the calling thread.
+    //! \tparam L: class deriving from TextureLoader (ie SOIL). Shall be
+    //! reentrant when threads != 1.
+    //! \return false if a file failed to be loaded or if images have not the
+    //! same dimension or format.
     //--------------------------------------------------------------------------
     template<class L>
-    bool load(std::vector<std::string> const& filenames)
+    bool load(std::vector<std::string> const& filenames, size_t const threads = 0u)
     {
         static_assert(std::is_base_of<TextureLoader, L>::value,
                       "Template l is not derived class from TextureLoader");
         L loader;
 
         m_width = m_height = m_depth = 0u;
-        size_t prevWidth = 0;
-        size_t prevHeight = 0;
-
-        if (!loader.setPixelFormat(m_cpuPixelFormat))
+        if (!loader.configure(m_cpuPixelFormat, m_cpuPixelType, m_premultiplied))
             return false;
 
-        m_cpuPixelCount = loader.getPixelCount();
-        m_cpuPixelType = loader.getPixelType();
+        m_cpuPixelCount = loader.channels();
         m_gpuPixelFormat = CPU2GPUFormat(GLenum(m_cpuPixelFormat), GLenum(m_cpuPixelType));
         if (m_gpuPixelFormat < 0)
             return false;
 
-        m_buffer.clear();
-        for (size_t i = 0u; i < filenames.size(); ++i)
+        m_buffer.reset();
+        m_compression = Compression();
+
+        std::vector<Slice> slices(filenames.size());
+        std::mutex mutex;
+        unsigned char* storage = nullptr;
+        size_t bytes = 0u;
+        parallelFor(filenames.size(), threads, [&](size_t const i)
         {
-            // Load a Texture2D and pack it subsequently into a large 2D texture
-            m_width = m_height = 0;
-            if (unlikely(!loader.load(filenames[i].c_str(), m_buffer, m_width, m_height)))
-                return false;
+            Slice& slice = slices[i];
+            L decoder;
+            Buffer texels;
+            if (!decoder.configure(m_cpuPixelFormat, m_cpuPixelType, m_premultiplied) ||
+                !decoder.decode(filenames[i], texels, slice.width, slice.height))
+                return ;
+
+            slice.decoded = true;
+            if (decoder.compression() != nullptr)
+                slice.compression = *decoder.compression();
+
+            // The first image gives the size of all images: keep images
+            // decoded before it until the buffer is allocated.
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (i == 0u)
+                {
+                    bytes = texels.size();
+                    storage = m_buffer.extend(bytes * filenames.size());
+                }
+                else if (storage == nullptr)
+                {
+                    slice.texels.swap(texels);
+                    return ;
+                }
+            }
+            copy(slice, texels, storage, i, bytes);
+        });
+
+        // Copy images decoded before the first one
+        for (size_t i = 1u; (storage != nullptr) && (i < slices.size()); ++i)
+        {
+            if (slices[i].decoded && !slices[i].copied)
+            {
+                copy(slices[i], slices[i].texels, storage, i, bytes);
+                slices[i].texels.clear();
+            }
+        }
+
+        // Check images in their order
+        for (size_t i = 0u; i < slices.size(); ++i)
+        {
+            Slice const& slice = slices[i];
+            if (unlikely(!slice.decoded))
+                return failed();
+
+            // Block-compressed image: keep its first level
+            if ((slice.compression.format != slices[0].compression.format) ||
+                ((slice.compression.format != 0u) && (slice.compression.faces != 1u)))
+            {
+                std::cerr << "Failed picture file " << i << ": '" << filenames[i]
+                          << "' has not the compressed format of the first image"
+                          << std::endl;
+                return failed();
+            }
 
             // Check consistency of Texture2D dimension
-            if ((i != 0u) && ((prevWidth != m_width) || (prevHeight != m_height)))
+            if ((slice.width != slices[0].width) || (slice.height != slices[0].height))
             {
                 std::cerr << "Failed picture file " << i << ": '" << filenames[i]
                           << "' has not correct dimension ("
-                          << prevWidth << " x " << prevHeight
+                          << slices[0].width << " x " << slices[0].height
                           << ")" << std::endl;
-                return false;
+                return failed();
+            }
+
+            if (unlikely(!slice.copied))
+            {
+                std::cerr << "Failed picture file " << i << ": '" << filenames[i]
+                          << "' has not the number of bytes of other images"
+                          << std::endl;
+                return failed();
             }
 
-            prevWidth = m_width;
-            prevHeight = m_height;
+            if (slice.compression.format != 0u)
+            {
+                Compression::Level level = slice.compression.levels[0];
+                level.offset += i * bytes;
+                m_compression.format = slice.compression.format;
+                m_compression.levels.push_back(level);
+            }
         }
 
         // Success
+        m_compression.faces = m_compression.levels.empty() ? 1u : m_compression.levels.size();
+        if (!slices.empty())
+        {
+            m_width = slices[0].width;
+            m_height = slices[0].height;
+        }
         m_depth = filenames.size();
         return true;
     }
 
+    //--------------------------------------------------------------------------
+    //! \brief Set to the byte off of the texel at row u, column v of the image
+    //! w (write access). Only the texel will be transfered to the GPU.
+    //--------------------------------------------------------------------------
+    inline unsigned char& set(const size_t u, const size_t v, const size_t w,
+                              const size_t off)
+    {
+        const size_t nth = offset(v, u, w) + off;
+        if (unlikely(nth >= m_buffer.size()))
+            return m_buffer.set(nth);
+
+        m_dirty_boxes.setPending(v, u, w);
+        return m_buffer.to_array()[nth];
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Get to the byte off of the texel at row u, column v of the image
+    //! w (read only access).
+    //--------------------------------------------------------------------------
+    inline const unsigned char& get(const size_t u, const size_t v, const size_t w,
+                                    const size_t off) const
+    {
+        return m_buffer.get(offset(v, u, w) + off);
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Tag as dirty a box of texels modified through data(). Only dirty
+    //! boxes are transfered to the GPU.
+    //!
+    //! \note Without it, images holding bytes modified through data() are
+    //! transfered.
+    //--------------------------------------------------------------------------
+    inline void setPending(size_t const x, size_t const y, size_t const z,
+                           size_t const width, size_t const height,
+                           size_t const depth)
+    {
+        m_dirty_boxes.setPending(x, y, z, width, height, depth);
+    }
+
 private:
 
+    //--------------------------------------------------------------------------
+    //! \brief Image decoded by a thread of load().
+    //--------------------------------------------------------------------------
+    struct Slice
+    {
+        size_t width = 0u;
+        size_t height = 0u;
+        Compression compression;
+        //! \brief The picture file has been decoded.
+        bool decoded = false;
+        //! \brief The image has been copied into the buffer of the texture.
+        bool copied = false;
+        //! \brief Texels decoded before the size of images was known.
+        Buffer texels;
+    };
+
+    //--------------------------------------------------------------------------
+    //! \brief Copy the decoded image at its offset in the buffer of the
+    //! texture if it has the size of the first image.
+    //--------------------------------------------------------------------------
+    static void copy(Slice& slice, Buffer const& texels, unsigned char* storage,
+                     size_t const index, size_t const bytes)
+    {
+        if (texels.size() == bytes)
+        {
+            memcpy(storage + index * bytes, texels.to_array(), bytes);
+            slice.copied = true;
+        }
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Drop images loaded by a failed load().
+    //! \return false.
+    //--------------------------------------------------------------------------
+    bool failed()
+    {
+        m_buffer.reset();
+        m_compression = Compression();
+        m_width = m_height = m_depth = 0u;
+        return false;
+    }
+
     //--------------------------------------------------------------------------
     //! \brief Specify to OpenGL a three-dimensional texture image.
     //--------------------------------------------------------------------------
     inline void specifyTexture3D() const
     {
+        if (compressed())
+        {
+            specifyCompressed();
+            return ;
+        }
+
         glCheck(glTexImage3D(m_target, 0,
                              static_cast<GLint>(m_gpuPixelFormat),
                              static_cast<GLsizei>(m_width),
@@ -117,6 +297,37 @@ private:
                              m_buffer.to_array()));
     }
 
+    //--------------------------------------------------------------------------
+    //! \brief Specify to OpenGL a block-compressed three-dimensional texture
+    //! image: images are not contiguous inside the buffer, transfer them one
+    //! by one.
+    //--------------------------------------------------------------------------
+    inline void specifyCompressed() const
+    {
+        size_t bytes = 0u;
+        for (auto const& it: m_compression.levels)
+        {
+            bytes += it.size;
+        }
+
+        glCheck(glCompressedTexImage3D(m_target, 0, m_compression.format,
+                                       static_cast<GLsizei>(m_width),
+                                       static_cast<GLsizei>(m_height),
+                                       static_cast<GLsizei>(m_depth),
+                                       0, static_cast<GLsizei>(bytes), nullptr));
+        GLint z = 0;
+        for (auto const& it: m_compression.levels)
+        {
+            glCheck(glCompressedTexSubImage3D(m_target, 0, 0, 0, z++,
+                                              static_cast<GLsizei>(it.width),
+                                              static_cast<GLsizei>(it.height),
+                                              1, m_compression.format,
+                                              static_cast<GLsizei>(it.size),
+                                              m_buffer.to_array() + it.offset));
+        }
+        glCheck(glTexParameteri(m_target, GL_TEXTURE_MAX_LEVEL, 0));
+    }
+
     //--------------------------------------------------------------------------
     //! \brief Apply OpenGL texture settings.
     //--------------------------------------------------------------------------
@@ -137,17 +348,52 @@ private:
         applyTextureParam();
         specifyTexture3D();
 
+        // The whole buffer has just been transfered: do not transfer it again
+        // with onUpdate().
+        m_buffer.clearPending();
+        m_dirty_boxes.clearPending();
         return false;
     }
 
     //--------------------------------------------------------------------------
-    //! \brief Upload dirty CPU data to the GPU.
-    //! \todo To be implemeted FIXME
+    //! \brief Upload dirty boxes of texels to the GPU, from client memory or
+    //! through pixel unpack buffers when streaming().
     //--------------------------------------------------------------------------
     virtual bool onUpdate() override
     {
+        // Blocks cannot be updated by texels: transfer again all images.
+        if (compressed())
+        {
+            specifyCompressed();
+            m_buffer.clearPending();
+            m_dirty_boxes.clearPending();
+            return false;
+        }
+
+        auto const& boxes = pendingBoxes();
+
+        beginUnpackBoxes();
+        for (auto const& box: boxes)
+        {
+            const void* texels = beginUnpack(m_buffer.to_array() + offset(box.x, box.y, box.z),
+                                             span(box));
+            glCheck(glTexSubImage3D(m_target, 0,
+                                    static_cast<GLint>(box.x),
+                                    static_cast<GLint>(box.y),
+                                    static_cast<GLint>(box.z),
+                                    static_cast<GLsizei>(box.width),
+                                    static_cast<GLsizei>(box.height),
+                                    static_cast<GLsizei>(box.depth),
+                                    static_cast<GLenum>(m_cpuPixelFormat),
+                                    static_cast<GLenum>(m_cpuPixelType),
+                                    texels));
+            endUnpack();
+        }
+        endUnpackBoxes();
+
+        m_dirty_boxes.clearPending();
         return false;
-    };
+    }
 };
 
 #endif // OPENGLCPPWRAPPER_GLTEXTURE3D_HPP
@@ -0,0 +1,490 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#ifndef OPENGLCPPWRAPPER_GLTEXTURE_ARRAY2D_HPP
+#  define OPENGLCPPWRAPPER_GLTEXTURE_ARRAY2D_HPP
+
+#  include "OpenGL/Textures/Texture2D.hpp"
+
+// *****************************************************************************
+//! \brief An array of 2D images (layers) of the same size and pixel format,
+//! sampled in GLSL by a sampler2DArray with the layer index as third texture
+//! coordinate. Meshes differing only by their texture can therefore be merged
+//! into a single draw call, each vertex telling the layer of its material:
+//! \code
+//!   uniform sampler2DArray materials;
+//!   in vec2 UV;
+//!   in float layer;
+//!   ...
+//!   color = texture(materials, vec3(UV, layer));
+//! \endcode
+//!
+//! Layers are loaded, tagged as dirty and get their mipmaps independently:
+//! modifying texels of a layer only transfers this layer (and the parts of
+//! its mipmaps depending on them) to the GPU.
+//!
+//! \note Block-compressed picture files are not managed.
+// *****************************************************************************
+class GLTextureArray2D: public GLTexture
+{
+public:
+
+    //--------------------------------------------------------------------------
+    //! \brief Constructor. Layers are given by load().
+    //!
+    //! \param name the name of this instance used by GLProgram and GLVAO.
+    //--------------------------------------------------------------------------
+    GLTextureArray2D(std::string const& name)
+        : GLTexture(3u, name, GL_TEXTURE_2D_ARRAY)
+    {}
+
+    //--------------------------------------------------------------------------
+    //! \brief Constructor. Create layers of RGBA black texels to fill through
+    //! set() or data().
+    //!
+    //! \param name the name of this instance used by GLProgram and GLVAO.
+    //! \param width, height the size of layers (texels). Shall be > 0.
+    //! \param layers the number of layers. Shall be > 0.
+    //--------------------------------------------------------------------------
+    GLTextureArray2D(std::string const& name, uint32_t const width,
+                     uint32_t const height, uint32_t const layers)
+        : GLTexture(3u, name, GL_TEXTURE_2D_ARRAY)
+    {
+        m_width = width;
+        m_height = height;
+        m_depth = layers;
+        m_buffer = std::vector<unsigned char>(m_width * m_height * m_depth * m_cpuPixelCount, 0u);
+        m_mipmaps.resize(m_depth);
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Load all layers from picture files (one layer per file). Files
+    //! shall have the same size.
+    //!
+    //! \tparam L: class deriving from TextureLoader (ie SOIL).
+    //! \return true if all files have been loaded.
+    //--------------------------------------------------------------------------
+    template<class L>
+    bool load(std::vector<std::string> const& filenames)
+    {
+        static_assert(std::is_base_of<TextureLoader, L>::value,
+                      "Template L is not derived class from TextureLoader");
+        L loader;
+
+        if (!configure(loader))
+            return false;
+
+        std::vector<unsigned char> texels;
+        size_t width = 0u;
+        size_t height = 0u;
+        for (size_t i = 0u; i < filenames.size(); ++i)
+        {
+            Buffer layer;
+            size_t w, h;
+            if (!doload(loader, filenames[i], layer, w, h))
+                return false;
+
+            // Check consistency of layer dimension
+            if ((i != 0u) && ((width != w) || (height != h)))
+            {
+                std::cerr << "Failed picture file " << i << ": '" << filenames[i]
+                          << "' has not correct dimension ("
+                          << width << " x " << height
+                          << ")" << std::endl;
+                return false;
+            }
+
+            width = w;
+            height = h;
+            texels.insert(texels.end(), layer.to_array(), layer.to_array() + layer.size());
+        }
+
+        // Success
+        m_width = width;
+        m_height = height;
+        m_depth = filenames.size();
+        m_buffer = texels;
+        m_mipmaps.assign(m_depth, image::MipChain());
+        m_need_setup = true;
+        return true;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Load a layer from a picture file having the size of other layers.
+    //! Only this layer is transfered again to the GPU.
+    //!
+    //! \param layer the index of the layer to replace, or layers() for adding a
+    //! new layer (all layers are then transfered again to the GPU).
+    //! \tparam L: class deriving from TextureLoader (ie SOIL).
+    //! \return true if the file has been loaded.
+    //--------------------------------------------------------------------------
+    template<class L>
+    bool load(size_t const layer, std::string const& filename)
+    {
+        static_assert(std::is_base_of<TextureLoader, L>::value,
+                      "Template L is not derived class from TextureLoader");
+        L loader;
+
+        if (layer > m_depth)
+        {
+            std::cerr << "Failed picture file '" << filename << "': layer "
+                      << layer << " is after the last layer of texture '"
+                      << name() << "'" << std::endl;
+            return false;
+        }
+
+        if (!configure(loader))
+            return false;
+
+        Buffer texels;
+        size_t width, height;
+        if (!doload(loader, filename, texels, width, height))
+            return false;
+
+        if ((m_depth != 0u) && ((width != m_width) || (height != m_height)))
+        {
+            std::cerr << "Failed picture file '" << filename
+                      << "' has not correct dimension ("
+                      << m_width << " x " << m_height
+                      << ")" << std::endl;
+            return false;
+        }
+
+        m_width = width;
+        m_height = height;
+        if (layer == m_depth)
+        {
+            // The storage grows: specify again the whole texture
+            std::vector<unsigned char> layers(m_buffer.data());
+            layers.insert(layers.end(), texels.to_array(), texels.to_array() + texels.size());
+            m_buffer = layers;
+            m_mipmaps.resize(++m_depth);
+            m_need_setup = true;
+        }
+        else
+        {
+            std::copy(texels.to_array(), texels.to_array() + texels.size(),
+                      m_buffer.data().begin() + static_cast<std::ptrdiff_t>(offset(0u, 0u, layer)));
+            m_dirty_boxes.setPending(0u, 0u, layer, m_width, m_height, 1u);
+        }
+        return true;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of layers.
+    //--------------------------------------------------------------------------
+    inline size_t layers() const
+    {
+        return m_depth;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Set to the byte off of the texel at row u, column v of the given
+    //! layer (write access). Only the texel will be transfered to the GPU.
+    //--------------------------------------------------------------------------
+    inline unsigned char& set(const size_t u, const size_t v, const size_t layer,
+                              const size_t off)
+    {
+        const size_t nth = offset(v, u, layer) + off;
+        if (unlikely(nth >= m_buffer.size()))
+            return m_buffer.set(nth);
+
+        m_dirty_boxes.setPending(v, u, layer);
+        return m_buffer.to_array()[nth];
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Get to the byte off of the texel at row u, column v of the given
+    //! layer (read only access).
+    //--------------------------------------------------------------------------
+    inline const unsigned char& get(const size_t u, const size_t v, const size_t layer,
+                                    const size_t off) const
+    {
+        return m_buffer.get(offset(v, u, layer) + off);
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Tag as dirty a rectangle of texels of a layer modified through
+    //! data(). Only dirty rectangles are transfered to the GPU.
+    //!
+    //! \note Without it, layers holding bytes modified through data() are
+    //! transfered.
+    //--------------------------------------------------------------------------
+    inline void setPending(size_t const x, size_t const y, size_t const layer,
+                           size_t const width, size_t const height)
+    {
+        m_dirty_boxes.setPending(x, y, layer, width, height, 1u);
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the mipmaps of the layer computed on the CPU (see
+    //! mipmaps()).
+    //--------------------------------------------------------------------------
+    inline image::MipChain const& mipChain(size_t const layer) const
+    {
+        return m_mipmaps.at(layer);
+    }
+
+private:
+
+    //--------------------------------------------------------------------------
+    //! \brief Set the pixel format of the loader and get back from it the CPU
+    //! and GPU pixel formats of this texture.
+    //!
+    //! \return false if the loader does not manage the pixel format.
+    //--------------------------------------------------------------------------
+    bool configure(TextureLoader& loader)
+    {
+        if (!loader.configure(m_cpuPixelFormat, m_cpuPixelType, m_premultiplied))
+            return false;
+
+        m_cpuPixelCount = loader.channels();
+        m_gpuPixelFormat = CPU2GPUFormat(GLenum(m_cpuPixelFormat), GLenum(m_cpuPixelType));
+        return m_gpuPixelFormat >= 0;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Load the picture file of a layer.
+    //!
+    //! \param[out] texels the texels of the picture file. Shall be empty.
+    //! \param[out] width, height the size of the picture.
+    //! \return true if the file has been loaded.
+    //--------------------------------------------------------------------------
+    bool doload(TextureLoader& loader, std::string const& filename,
+                Buffer& texels, size_t& width, size_t& height)
+    {
+        width = height = 0u;
+        if (!loader.decode(filename, texels, width, height))
+            return false;
+
+        if (loader.compression() != nullptr)
+        {
+            std::cerr << "Failed picture file '" << filename
+                      << "': block-compressed layers are not managed"
+                      << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Specify to OpenGL all layers.
+    //--------------------------------------------------------------------------
+    inline void specifyTextureArray2D() const
+    {
+        glCheck(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+        glCheck(glTexImage3D(m_target, 0,
+                             static_cast<GLint>(m_gpuPixelFormat),
+                             static_cast<GLsizei>(m_width),
+                             static_cast<GLsizei>(m_height),
+                             static_cast<GLsizei>(m_depth),
+                             0,
+                             static_cast<GLenum>(m_cpuPixelFormat),
+                             static_cast<GLenum>(m_cpuPixelType),
+                             m_buffer.to_array()));
+        glCheck(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Compute mipmaps of all layers and specify them to OpenGL, if
+    //! enabled by options. Mipmaps of 8-bits channels are computed on the CPU,
+    //! others by glGenerateMipmap().
+    //--------------------------------------------------------------------------
+    void specifyMipmaps()
+    {
+        for (auto& it: m_mipmaps)
+            it.clear();
+
+        if (!m_options.generateMipmaps || (m_buffer.size() == 0u))
+            return;
+
+        if (m_cpuPixelType != GL_UNSIGNED_BYTE)
+        {
+            glCheck(glGenerateMipmap(m_target));
+            return;
+        }
+
+        for (size_t layer = 0u; layer < m_depth; ++layer)
+        {
+            m_mipmaps[layer].build(m_buffer.to_array() + offset(0u, 0u, layer),
+                                   m_width, m_height, m_cpuPixelCount,
+                                   m_options.mipmapFilter, srgb());
+        }
+
+        // All layers have the same number of levels
+        const size_t levels = m_mipmaps[0].levels().size();
+        glCheck(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+        for (size_t level = 0u; level < levels; ++level)
+        {
+            image::MipChain::Level const& first = m_mipmaps[0].levels()[level];
+            glCheck(glTexImage3D(m_target, static_cast<GLint>(level + 1u),
+                                 static_cast<GLint>(m_gpuPixelFormat),
+                                 static_cast<GLsizei>(first.width),
+                                 static_cast<GLsizei>(first.height),
+                                 static_cast<GLsizei>(m_depth),
+                                 0,
+                                 static_cast<GLenum>(m_cpuPixelFormat),
+                                 static_cast<GLenum>(m_cpuPixelType),
+                                 nullptr));
+            for (size_t layer = 0u; layer < m_depth; ++layer)
+            {
+                glCheck(glTexSubImage3D(m_target, static_cast<GLint>(level + 1u),
+                                        0, 0, static_cast<GLint>(layer),
+                                        static_cast<GLsizei>(first.width),
+                                        static_cast<GLsizei>(first.height),
+                                        1,
+                                        static_cast<GLenum>(m_cpuPixelFormat),
+                                        static_cast<GLenum>(m_cpuPixelType),
+                                        m_mipmaps[layer].levels()[level].texels.data()));
+            }
+        }
+        glCheck(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+        glCheck(glTexParameteri(m_target, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(levels)));
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Compute again and upload the parts of mipmaps depending on the
+    //! given boxes of modified texels. Only mipmaps of modified layers are
+    //! computed again.
+    //--------------------------------------------------------------------------
+    void updateMipmaps(std::vector<PendingBoxes::Box> const& boxes)
+    {
+        if (!m_options.generateMipmaps)
+            return;
+
+        if (m_mipmaps.empty() || m_mipmaps[0].levels().empty())
+        {
+            if (m_cpuPixelType != GL_UNSIGNED_BYTE)
+            {
+                glCheck(glGenerateMipmap(m_target));
+            }
+            return;
+        }
+
+        // Split boxes into the modified rectangles of each layer
+        std::vector<std::vector<image::Rect>> regions(m_depth);
+        for (auto const& box: boxes)
+        {
+            image::Rect rect = box;
+            rect.z = 0u;
+            rect.depth = 1u;
+            for (size_t layer = box.z; layer < box.z + box.depth; ++layer)
+                regions[layer].push_back(rect);
+        }
+
+        glCheck(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+        for (size_t layer = 0u; layer < m_depth; ++layer)
+        {
+            if (regions[layer].empty())
+                continue;
+
+            m_mipmaps[layer].update(m_buffer.to_array() + offset(0u, 0u, layer),
+                                    regions[layer]);
+
+            GLint level = 0;
+            for (auto const& it: m_mipmaps[layer].levels())
+            {
+                ++level;
+                glCheck(glPixelStorei(GL_UNPACK_ROW_LENGTH, static_cast<GLint>(it.width)));
+                for (auto const& rect: it.dirty)
+                {
+                    glCheck(glTexSubImage3D(m_target, level,
+                                            static_cast<GLint>(rect.x),
+                                            static_cast<GLint>(rect.y),
+                                            static_cast<GLint>(layer),
+                                            static_cast<GLsizei>(rect.width),
+                                            static_cast<GLsizei>(rect.height),
+                                            1,
+                                            static_cast<GLenum>(m_cpuPixelFormat),
+                                            static_cast<GLenum>(m_cpuPixelType),
+                                            it.texels.data() + (rect.y * it.width + rect.x)
+                                            * m_cpuPixelCount));
+                }
+            }
+        }
+        glCheck(glPixelStorei(GL_UNPACK_ROW_LENGTH, 0));
+        glCheck(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Apply OpenGL texture settings.
+    //--------------------------------------------------------------------------
+    virtual bool onSetup() override
+    {
+        // Note: m_buffer can nullptr
+        if (unlikely(!loaded()))
+        {
+            std::cerr << "Cannot setup texture '" << name()
+                      << "'. Reason 'Data not yet loaded'"
+                      << std::endl;
+            return true;
+        }
+
+        applyTextureParam();
+        specifyTextureArray2D();
+        specifyMipmaps();
+
+        // The whole buffer has just been transfered: do not transfer it again
+        // with onUpdate().
+        m_buffer.clearPending();
+        m_dirty_boxes.clearPending();
+        return false;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Upload dirty rectangles of layers to the GPU, from client memory
+    //! or through pixel unpack buffers when streaming().
+    //--------------------------------------------------------------------------
+    virtual bool onUpdate() override
+    {
+        auto const& boxes = pendingBoxes();
+
+        beginUnpackBoxes();
+        for (auto const& box: boxes)
+        {
+            const void* texels = beginUnpack(m_buffer.to_array() + offset(box.x, box.y, box.z),
+                                             span(box));
+            glCheck(glTexSubImage3D(m_target, 0,
+                                    static_cast<GLint>(box.x),
+                                    static_cast<GLint>(box.y),
+                                    static_cast<GLint>(box.z),
+                                    static_cast<GLsizei>(box.width),
+                                    static_cast<GLsizei>(box.height),
+                                    static_cast<GLsizei>(box.depth),
+                                    static_cast<GLenum>(m_cpuPixelFormat),
+                                    static_cast<GLenum>(m_cpuPixelType),
+                                    texels));
+            endUnpack();
+        }
+        endUnpackBoxes();
+        updateMipmaps(boxes);
+
+        m_dirty_boxes.clearPending();
+        return false;
+    }
+
+private:
+
+    //! \brief Mipmaps of each layer computed on the CPU.
+    std::vector<image::MipChain> m_mipmaps;
+};
+
+#endif // OPENGLCPPWRAPPER_GLTEXTURE_ARRAY2D_HPP
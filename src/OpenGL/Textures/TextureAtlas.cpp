@@ -0,0 +1,392 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "OpenGL/Textures/TextureAtlas.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace image
+{
+
+//------------------------------------------------------------------------------
+static Rect makeRect(size_t const x, size_t const y,
+                     size_t const width, size_t const height)
+{
+    Rect rect;
+    rect.x = x;
+    rect.y = y;
+    rect.width = width;
+    rect.height = height;
+    rect.depth = 1u;
+    return rect;
+}
+
+//------------------------------------------------------------------------------
+static bool contains(Rect const& outer, Rect const& inner)
+{
+    return (inner.x >= outer.x) && (inner.y >= outer.y) &&
+           (inner.x + inner.width <= outer.x + outer.width) &&
+           (inner.y + inner.height <= outer.y + outer.height);
+}
+
+//------------------------------------------------------------------------------
+RectPacker::RectPacker(size_t const width, size_t const height)
+    : m_width(width), m_height(height)
+{
+    clear();
+}
+
+//------------------------------------------------------------------------------
+void RectPacker::clear()
+{
+    m_area = 0u;
+    m_free.clear();
+    m_free.push_back(makeRect(0u, 0u, m_width, m_height));
+}
+
+//------------------------------------------------------------------------------
+bool RectPacker::insert(size_t const width, size_t const height, Rect& rect)
+{
+    if ((width == 0u) || (height == 0u))
+        return false;
+
+    // Best Short Side Fit, ties broken by the longest leftover side.
+    size_t best_short = size_t(-1);
+    size_t best_long = size_t(-1);
+    size_t best = m_free.size();
+    for (size_t i = 0u; i < m_free.size(); ++i)
+    {
+        Rect const& free = m_free[i];
+        if ((width > free.width) || (height > free.height))
+            continue;
+
+        const size_t dw = free.width - width;
+        const size_t dh = free.height - height;
+        const size_t short_side = std::min(dw, dh);
+        const size_t long_side = std::max(dw, dh);
+        if ((short_side < best_short) ||
+            ((short_side == best_short) && (long_side < best_long)))
+        {
+            best_short = short_side;
+            best_long = long_side;
+            best = i;
+        }
+    }
+
+    if (best == m_free.size())
+        return false;
+
+    const Rect used = makeRect(m_free[best].x, m_free[best].y, width, height);
+
+    // Free rectangles overlapped by the new one are replaced by their parts
+    // not overlapped (appended at the end of the list).
+    size_t count = m_free.size();
+    for (size_t i = 0u; i < count; )
+    {
+        const Rect free = m_free[i];
+        if (split(free, used))
+        {
+            m_free.erase(m_free.begin() + static_cast<std::ptrdiff_t>(i));
+            --count;
+        }
+        else
+        {
+            ++i;
+        }
+    }
+    prune();
+
+    m_area += width * height;
+    rect = used;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool RectPacker::split(Rect const& free, Rect const& used)
+{
+    if ((used.x >= free.x + free.width) || (used.x + used.width <= free.x) ||
+        (used.y >= free.y + free.height) || (used.y + used.height <= free.y))
+        return false;
+
+    // Left
+    if (used.x > free.x)
+    {
+        m_free.push_back(makeRect(free.x, free.y, used.x - free.x, free.height));
+    }
+
+    // Right
+    if (used.x + used.width < free.x + free.width)
+    {
+        m_free.push_back(makeRect(used.x + used.width, free.y,
+                                  free.x + free.width - used.x - used.width,
+                                  free.height));
+    }
+
+    // Top
+    if (used.y > free.y)
+    {
+        m_free.push_back(makeRect(free.x, free.y, free.width, used.y - free.y));
+    }
+
+    // Bottom
+    if (used.y + used.height < free.y + free.height)
+    {
+        m_free.push_back(makeRect(free.x, used.y + used.height, free.width,
+                                  free.y + free.height - used.y - used.height));
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void RectPacker::prune()
+{
+    std::vector<bool> dead(m_free.size(), false);
+    for (size_t i = 0u; i < m_free.size(); ++i)
+    {
+        for (size_t j = 0u; (j < m_free.size()) && (!dead[i]); ++j)
+        {
+            if ((i == j) || dead[j] || !contains(m_free[j], m_free[i]))
+                continue;
+
+            // Keep one of two identical rectangles
+            if (contains(m_free[i], m_free[j]) && (i < j))
+                continue;
+
+            dead[i] = true;
+        }
+    }
+
+    size_t k = 0u;
+    for (size_t i = 0u; i < m_free.size(); ++i)
+    {
+        if (!dead[i])
+            m_free[k++] = m_free[i];
+    }
+    m_free.resize(k);
+}
+
+//------------------------------------------------------------------------------
+double RectPacker::occupancy() const
+{
+    return double(m_area) / double(m_width * m_height);
+}
+
+} // namespace image
+
+//------------------------------------------------------------------------------
+GLTextureAtlas::GLTextureAtlas(std::string const& name, size_t const width,
+                               size_t const height, size_t const padding)
+    : m_name(name), m_width(width), m_height(height), m_padding(padding)
+{
+    assert(width > 2u * padding);
+    assert(height > 2u * padding);
+}
+
+//------------------------------------------------------------------------------
+size_t GLTextureAtlas::add(GLTexture2D const& texture)
+{
+    if (texture.compressed())
+    {
+        throw GL::Exception("GLTexture '" + texture.name() +
+                            "' is compressed and cannot be packed into an atlas");
+    }
+
+    if (texture.m_cpuPixelType != GL_UNSIGNED_BYTE)
+    {
+        throw GL::Exception("GLTexture '" + texture.name() +
+                            "' has no 8-bits channels and cannot be packed into an atlas");
+    }
+
+    if ((texture.m_width == 0u) || (texture.m_height == 0u) ||
+        (texture.m_buffer.size() != texture.m_width * texture.m_height *
+         texture.m_cpuPixelCount))
+    {
+        throw GL::Exception("GLTexture '" + texture.name() +
+                            "' has no texels to pack into an atlas");
+    }
+
+    if ((texture.m_width + 2u * m_padding > m_width) ||
+        (texture.m_height + 2u * m_padding > m_height))
+    {
+        throw GL::Exception("GLTexture '" + texture.name() +
+                            "' is larger than pages of the atlas '" +
+                            m_name + "'");
+    }
+
+    if (m_channels == 0u)
+    {
+        m_channels = texture.m_cpuPixelCount;
+        m_format = texture.m_cpuPixelFormat;
+        m_gpu_format = texture.m_gpuPixelFormat;
+    }
+    else if ((m_channels != texture.m_cpuPixelCount) ||
+             (m_format != texture.m_cpuPixelFormat))
+    {
+        throw GL::Exception("GLTexture '" + texture.name() +
+                            "' has not the pixel format of the atlas '" +
+                            m_name + "'");
+    }
+
+    m_entries.push_back(Entry());
+    m_pending.push_back(std::make_pair(m_entries.size() - 1u, &texture));
+    return m_entries.size() - 1u;
+}
+
+//------------------------------------------------------------------------------
+void GLTextureAtlas::pack()
+{
+    std::stable_sort(m_pending.begin(), m_pending.end(),
+                     [](std::pair<size_t, GLTexture2D const*> const& a,
+                        std::pair<size_t, GLTexture2D const*> const& b)
+    {
+        return a.second->m_width * a.second->m_height >
+               b.second->m_width * b.second->m_height;
+    });
+
+    for (auto const& it: m_pending)
+    {
+        GLTexture2D const& texture = *it.second;
+        const size_t width = texture.m_width + 2u * m_padding;
+        const size_t height = texture.m_height + 2u * m_padding;
+
+        image::Rect rect;
+        size_t page = 0u;
+        while ((page < m_packers.size()) &&
+               (!m_packers[page].insert(width, height, rect)))
+        {
+            ++page;
+        }
+
+        if (page == m_packers.size())
+        {
+            m_packers.push_back(image::RectPacker(m_width, m_height));
+            m_packers.back().insert(width, height, rect);
+            createPage();
+        }
+
+        Entry& entry = m_entries[it.first];
+        entry.page = page;
+        entry.rect = rect;
+        entry.rect.x += m_padding;
+        entry.rect.y += m_padding;
+        entry.rect.width = texture.m_width;
+        entry.rect.height = texture.m_height;
+        entry.packed = true;
+        blit(texture, entry);
+    }
+
+    m_pending.clear();
+}
+
+//------------------------------------------------------------------------------
+void GLTextureAtlas::createPage()
+{
+    auto page = std::make_shared<GLTexture2D>(
+        m_name + "/" + std::to_string(m_pages.size()),
+        static_cast<uint32_t>(m_width), static_cast<uint32_t>(m_height));
+
+    page->m_cpuPixelFormat = m_format;
+    page->m_cpuPixelCount = m_channels;
+    page->m_gpuPixelFormat = m_gpu_format;
+    page->mipmaps(m_mipmaps, m_filter);
+    page->data() = std::vector<unsigned char>(m_width * m_height * m_channels, 0u);
+    m_pages.push_back(page);
+}
+
+//------------------------------------------------------------------------------
+void GLTextureAtlas::blit(GLTexture2D const& texture, Entry const& entry)
+{
+    GLTexture2D& page = *m_pages[entry.page];
+    const unsigned char* src = texture.m_buffer.to_array();
+    unsigned char* dst = page.m_buffer.to_array();
+
+    const size_t c = m_channels;
+    const size_t p = m_padding;
+    const size_t w = entry.rect.width;
+    const size_t h = entry.rect.height;
+    const size_t x0 = entry.rect.x - p;
+    const size_t y0 = entry.rect.y - p;
+
+    // Rows of padding replicate the first and last rows, columns of padding
+    // replicate the first and last columns.
+    for (size_t j = 0u; j < h + 2u * p; ++j)
+    {
+        const size_t sj = (j < p) ? 0u : std::min(j - p, h - 1u);
+        const unsigned char* from = src + sj * w * c;
+        unsigned char* to = dst + ((y0 + j) * m_width + x0) * c;
+
+        for (size_t i = 0u; i < p; ++i)
+        {
+            std::memcpy(to + i * c, from, c);
+            std::memcpy(to + (p + w + i) * c, from + (w - 1u) * c, c);
+        }
+        std::memcpy(to + p * c, from, w * c);
+    }
+
+    page.setPending(x0, y0, w + 2u * p, h + 2u * p);
+}
+
+//------------------------------------------------------------------------------
+double GLTextureAtlas::occupancy() const
+{
+    if (m_packers.empty())
+        return 0.0;
+
+    double occupancy = 0.0;
+    for (auto const& packer: m_packers)
+        occupancy += packer.occupancy();
+    return occupancy / double(m_packers.size());
+}
+
+//------------------------------------------------------------------------------
+Vector2f GLTextureAtlas::remap(size_t const nth, Vector2f const& uv) const
+{
+    image::Rect const& rect = m_entries.at(nth).rect;
+    return Vector2f((float(rect.x) + uv.x * float(rect.width)) / float(m_width),
+                    (float(rect.y) + uv.y * float(rect.height)) / float(m_height));
+}
+
+//------------------------------------------------------------------------------
+void GLTextureAtlas::remap(size_t const nth, std::vector<Vector2f> const& coords,
+                           GLVertexBuffer<Vector2f>& uv) const
+{
+    std::vector<Vector2f> remapped(coords.size());
+    for (size_t i = 0u; i < coords.size(); ++i)
+    {
+        remapped[i] = remap(nth, coords[i]);
+    }
+    uv = remapped;
+}
+
+//------------------------------------------------------------------------------
+void GLTextureAtlas::bind(size_t const nth, GLVAO& vao, const char *sampler,
+                          const char *uv, std::vector<Vector2f> const& coords) const
+{
+    Entry const& entry = m_entries.at(nth);
+    if (!entry.packed)
+    {
+        throw GL::Exception("Image " + std::to_string(nth) + " of the atlas '" +
+                            m_name + "' has not been packed");
+    }
+
+    vao.shareTexture(sampler, m_pages[entry.page]);
+    remap(nth, coords, vao.vector2f(uv));
+}
@@ -0,0 +1,270 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#ifndef OPENGLCPPWRAPPER_GLTEXTURE_ATLAS_HPP
+#  define OPENGLCPPWRAPPER_GLTEXTURE_ATLAS_HPP
+
+#  include "OpenGL/Buffers/VAO.hpp"
+#  include <memory>
+#  include <vector>
+
+namespace image
+{
+
+// *****************************************************************************
+//! \brief Pack rectangles inside a bin with the MaxRects algorithm: the free
+//! space is held as the list of maximal free rectangles (which may overlap).
+//! A rectangle is placed inside the free rectangle leaving the shortest
+//! leftover side (Best Short Side Fit). Rectangles are not rotated.
+//!
+//! \note Inserting rectangles sorted by decreasing area packs better than
+//! inserting them in random order.
+// *****************************************************************************
+class RectPacker
+{
+public:
+
+    //--------------------------------------------------------------------------
+    //! \brief Empty bin of the given size (texels).
+    //--------------------------------------------------------------------------
+    RectPacker(size_t const width, size_t const height);
+
+    //--------------------------------------------------------------------------
+    //! \brief Remove all rectangles.
+    //--------------------------------------------------------------------------
+    void clear();
+
+    //--------------------------------------------------------------------------
+    //! \brief Find a place for a rectangle of the given size.
+    //!
+    //! \param[out] rect the place of the rectangle (not modified on failure).
+    //! \return false if there is no room left for this rectangle.
+    //--------------------------------------------------------------------------
+    bool insert(size_t const width, size_t const height, Rect& rect);
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the ratio of the bin area covered by rectangles [0 .. 1].
+    //--------------------------------------------------------------------------
+    double occupancy() const;
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the maximal free rectangles (mainly for debug purpose).
+    //--------------------------------------------------------------------------
+    inline std::vector<Rect> const& freeRects() const
+    {
+        return m_free;
+    }
+
+private:
+
+    //--------------------------------------------------------------------------
+    //! \brief Replace the free rectangle by its parts not covered by the used
+    //! one. Return false if they do not intersect.
+    //--------------------------------------------------------------------------
+    bool split(Rect const& free, Rect const& used);
+
+    //--------------------------------------------------------------------------
+    //! \brief Remove free rectangles contained inside another one.
+    //--------------------------------------------------------------------------
+    void prune();
+
+private:
+
+    size_t m_width;
+    size_t m_height;
+    size_t m_area = 0u;
+    std::vector<Rect> m_free;
+};
+
+} // namespace image
+
+// *****************************************************************************
+//! \brief Pack many 2D textures into one or a few large textures (the pages)
+//! so that VAOs using different images can share the same texture binding.
+//!
+//! Images are copied with a border of padding texels replicating their edges:
+//! bilinear filtering and the first mipmap levels do not bleed neighbour
+//! images. Texture coordinates of VAOs are remapped into the page holding
+//! their image.
+//!
+//! \code
+//!   GLTextureAtlas atlas("atlas", 1024u, 1024u);
+//!   size_t crate = atlas.add(crateTexture);
+//!   size_t grass = atlas.add(grassTexture);
+//!   atlas.pack();
+//!   atlas.bind(crate, vao1, "texID", "UV", cubeUV);
+//!   atlas.bind(grass, vao2, "texID", "UV", quadUV);
+//! \endcode
+//!
+//! \note Texture coordinates shall be inside [0 .. 1]: repeating an image of
+//! the atlas with Wrap::REPEAT is not possible.
+// *****************************************************************************
+class GLTextureAtlas
+{
+public:
+
+    // *************************************************************************
+    //! \brief Place of an image inside the atlas.
+    // *************************************************************************
+    struct Entry
+    {
+        //! \brief Index of the page holding the image.
+        size_t page = 0u;
+        //! \brief Texels of the image inside the page (padding excluded).
+        image::Rect rect;
+        //! \brief False until pack() has been called.
+        bool packed = false;
+    };
+
+    //--------------------------------------------------------------------------
+    //! \brief Constructor. Pages are created by pack().
+    //!
+    //! \param name the name of the atlas. Pages are named name/0, name/1 ...
+    //! \param width, height the size of pages (texels).
+    //! \param padding the number of texels replicated around each image.
+    //--------------------------------------------------------------------------
+    GLTextureAtlas(std::string const& name, size_t const width = 2048u,
+                   size_t const height = 2048u, size_t const padding = 2u);
+
+    //--------------------------------------------------------------------------
+    //! \brief Enable or disable mipmaps of pages (see GLTexture::mipmaps()).
+    //! Shall be called before pack(). The minification filter of pages shall
+    //! use mipmaps (see GLTexture::interpolation()).
+    //!
+    //! \note Images bleed into their neighbours in levels where the padding is
+    //! smaller than one texel (level log2(padding) + 1 and next ones).
+    //--------------------------------------------------------------------------
+    GLTextureAtlas& mipmaps(bool const generate,
+                            image::Filter const filter = image::Filter::BOX)
+    {
+        m_mipmaps = generate;
+        m_filter = filter;
+        return *this;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Add an image to the atlas. Its texels are copied by pack(): the
+    //! texture shall not be destroyed before.
+    //!
+    //! \return the index of the entry of the image.
+    //! \throw GL::Exception if the texture has no texels on the CPU, is
+    //! block-compressed, has not 8-bits channels, has not the same channels
+    //! than the previous images or is larger than pages.
+    //--------------------------------------------------------------------------
+    size_t add(GLTexture2D const& texture);
+
+    //--------------------------------------------------------------------------
+    //! \brief Place images added since the last call and copy their texels
+    //! into the pages. Images are sorted by decreasing area and placed in the
+    //! first page having room, new pages are created when needed. Images
+    //! already packed are not moved.
+    //--------------------------------------------------------------------------
+    void pack();
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the place of the image.
+    //--------------------------------------------------------------------------
+    inline Entry const& entry(size_t const nth) const
+    {
+        return m_entries.at(nth);
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of images.
+    //--------------------------------------------------------------------------
+    inline size_t size() const
+    {
+        return m_entries.size();
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the pages.
+    //--------------------------------------------------------------------------
+    inline std::vector<std::shared_ptr<GLTexture2D>> const& pages() const
+    {
+        return m_pages;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the ratio of the area of pages covered by images, padding
+    //! included [0 .. 1].
+    //--------------------------------------------------------------------------
+    double occupancy() const;
+
+    //--------------------------------------------------------------------------
+    //! \brief Convert texture coordinates of the image into texture coordinates
+    //! of its page.
+    //--------------------------------------------------------------------------
+    Vector2f remap(size_t const nth, Vector2f const& uv) const;
+
+    //--------------------------------------------------------------------------
+    //! \brief Fill the VBO with texture coordinates of the image converted
+    //! into texture coordinates of its page. The VBO is set dirty.
+    //!
+    //! \param coords the texture coordinates of the image. They are kept by
+    //! the caller: remapping the VBO again (ie for another image) does not
+    //! convert coordinates twice.
+    //--------------------------------------------------------------------------
+    void remap(size_t const nth, std::vector<Vector2f> const& coords,
+               GLVertexBuffer<Vector2f>& uv) const;
+
+    //--------------------------------------------------------------------------
+    //! \brief Make the VAO sample the page holding the image through the given
+    //! sampler and remap its texture coordinates.
+    //!
+    //! \param sampler the name of the sampler in the GLSL code.
+    //! \param uv the name of the attribute holding texture coordinates.
+    //! \param coords the texture coordinates of the image (see remap()).
+    //--------------------------------------------------------------------------
+    void bind(size_t const nth, GLVAO& vao, const char *sampler, const char *uv,
+              std::vector<Vector2f> const& coords) const;
+
+private:
+
+    //--------------------------------------------------------------------------
+    //! \brief Create an empty page taking the pixel format of the images.
+    //--------------------------------------------------------------------------
+    void createPage();
+
+    //--------------------------------------------------------------------------
+    //! \brief Copy the image and its padding into its page.
+    //--------------------------------------------------------------------------
+    void blit(GLTexture2D const& texture, Entry const& entry);
+
+private:
+
+    std::string m_name;
+    size_t m_width;
+    size_t m_height;
+    size_t m_padding;
+    //! \brief Pixel format of images (set by the first one).
+    size_t m_channels = 0u;
+    GLTexture::PixelFormat m_format = GLTexture::PixelFormat::RGBA;
+    GLint m_gpu_format = GL_RGBA;
+    bool m_mipmaps = false;
+    image::Filter m_filter = image::Filter::BOX;
+    std::vector<Entry> m_entries;
+    //! \brief Images added but not yet packed (index of entry, texture).
+    std::vector<std::pair<size_t, GLTexture2D const*>> m_pending;
+    std::vector<image::RectPacker> m_packers;
+    std::vector<std::shared_ptr<GLTexture2D>> m_pages;
+};
+
+#endif // OPENGLCPPWRAPPER_GLTEXTURE_ATLAS_HPP
@@ -35,6 +35,7 @@
 
 #  include <array>
 #  include "OpenGL/Textures/Texture2D.hpp"
+#  include "Common/ParallelFor.hpp"
 
 // *****************************************************************************
 //! \brief A 3D Texture specialized for rendering skybox.
@@ -84,6 +85,22 @@ public:
         return true;
     }
 
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of bytes of the 6 faces on the GPU, mipmaps
+    //! included.
+    //--------------------------------------------------------------------------
+    virtual size_t gpuBytes() const override
+    {
+        size_t bytes = 0u;
+        for (uint8_t i = 0; i < MAX_TEXTURES; ++i)
+        {
+            bytes += m_textures[i]->m_buffer.size();
+        }
+        if (m_options.generateMipmaps && !m_textures[0]->compressed())
+            return bytes + bytes / 3u;
+        return bytes;
+    }
+
     //--------------------------------------------------------------------------
     //! \brief Load a texture 2D at the given location on the cube.
     //!
@@ -106,8 +123,101 @@ public:
         return m_textures[index]->load<L>(filename);
     }
 
+    //--------------------------------------------------------------------------
+    //! \brief Load the 6 faces of the cube from 6 picture files. Files can be
+    //! decoded concurrently, each one into the buffer of its face. Faces are
+    //! uploaded by the next begin().
+    //!
+    //! \param filenames the path of jpeg or bmp or png files, in the order of
+    //! faces: POSITIVE_X, NEGATIVE_X, POSITIVE_Y, NEGATIVE_Y, POSITIVE_Z and
+    //! NEGATIVE_Z.
+    //! \param threads the number of threads decoding files. If 0 (default)
+    //! then the number of hardware threads is used. If 1 then files are
+    //! decoded one after another by the calling thread.
+    //! \tparam L: class deriving from TextureLoader (ie SOIL). Shall be
+    //! reentrant when threads != 1.
+    //!
+    //! \return false if one of the faces failed to be loaded.
+    //--------------------------------------------------------------------------
+    template<class L>
+    bool load(std::array<std::string, 6u> const& filenames, size_t const threads = 0u)
+    {
+        static_assert(std::is_base_of<TextureLoader, L>::value,
+                      "Template L is not derived class from TextureLoader");
+
+        std::array<bool, MAX_TEXTURES> loaded;
+        parallelFor(MAX_TEXTURES, threads, [&](size_t const i)
+        {
+            L loader;
+            loaded[i] = m_textures[i]->doload(loader, filenames[i].c_str());
+        });
+
+        return std::all_of(loaded.begin(), loaded.end(), [](bool const ok) { return ok; });
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Load the 6 faces of the cube from a single file holding a cube
+    //! map (ie a DDS or KTX file loaded by CompressedLoader).
+    //!
+    //! \param filename the path of the cube map file.
+    //! \tparam L: class deriving from TextureLoader.
+    //!
+    //! \return false if the texture failed to be loaded or if the file does
+    //! not hold a cube map.
+    //--------------------------------------------------------------------------
+    template<class L>
+    bool load(const char *const filename)
+    {
+        if (!m_textures[0]->load<L>(filename))
+            return false;
+
+        return splitFaces(filename);
+    }
+
 private:
 
+    //--------------------------------------------------------------------------
+    //! \brief Move the faces of the block-compressed cube map loaded by the
+    //! first texture 2D to the 6 textures 2D.
+    //--------------------------------------------------------------------------
+    bool splitFaces(const char *const filename)
+    {
+        GLTexture2D& first = *m_textures[0];
+        const Compression layout = first.m_compression;
+        if (layout.faces != MAX_TEXTURES)
+        {
+            std::cerr << "Failed loading cube map '" << filename
+                      << "'. Reason 'The file does not hold 6 faces'"
+                      << std::endl;
+            first.m_buffer.clear();
+            first.m_compression = Compression();
+            return false;
+        }
+
+        const std::vector<unsigned char> texels(first.m_buffer.to_array(),
+                                                first.m_buffer.to_array() + first.m_buffer.size());
+        const size_t mipmaps = layout.mipmaps();
+        for (size_t i = 0u; i < MAX_TEXTURES; ++i)
+        {
+            GLTexture2D& face = *m_textures[i];
+            std::vector<unsigned char> blocks;
+            face.m_compression = Compression();
+            face.m_compression.format = layout.format;
+            face.m_width = layout.levels[i * mipmaps].width;
+            face.m_height = layout.levels[i * mipmaps].height;
+            for (size_t level = 0u; level < mipmaps; ++level)
+            {
+                Compression::Level it = layout.levels[i * mipmaps + level];
+                blocks.insert(blocks.end(), texels.begin() + long(it.offset),
+                              texels.begin() + long(it.offset + it.size));
+                it.offset = blocks.size() - it.size;
+                face.m_compression.levels.push_back(it);
+            }
+            face.m_buffer = blocks;
+        }
+        return true;
+    }
+
     //--------------------------------------------------------------------------
     //! \brief Apply OpenGL texture settings.
     //--------------------------------------------------------------------------
@@ -129,6 +239,13 @@ private:
             m_textures[i]->specifyTexture2D();
         }
         applyTextureParam();
+
+        // Use pre-baked levels of block-compressed faces
+        if (m_textures[0]->compressed())
+        {
+            glCheck(glTexParameteri(m_target, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(
+                m_textures[0]->compression().mipmaps()) - 1));
+        }
         return false;
     }
 
@@ -0,0 +1,234 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "OpenGL/Textures/TextureLoadQueue.hpp"
+#include <algorithm>
+#include <limits>
+
+constexpr size_t GLTextureLoadQueue::DEFAULT_BUDGET;
+
+//------------------------------------------------------------------------------
+GLTextureLoadQueue::GLTextureLoadQueue(size_t const threads)
+{
+    size_t count = threads;
+    if (count == 0u)
+    {
+        count = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    m_workers.reserve(count);
+    for (size_t i = 0u; i < count; ++i)
+    {
+        m_workers.emplace_back(&GLTextureLoadQueue::work, this);
+    }
+}
+
+//------------------------------------------------------------------------------
+GLTextureLoadQueue::~GLTextureLoadQueue()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& it: m_jobs)
+        {
+            it->texture->m_load_queue = nullptr;
+        }
+        m_jobs.clear();
+        m_todo.clear();
+        m_stop = true;
+    }
+    m_condition.notify_all();
+
+    for (auto& it: m_workers)
+    {
+        it.join();
+    }
+}
+
+//------------------------------------------------------------------------------
+bool GLTextureLoadQueue::push(GLTexture2D& texture, std::string const& filename,
+                              std::unique_ptr<TextureLoader> loader)
+{
+    if (texture.loading())
+        return false;
+
+    if (!texture.configure(*loader))
+    {
+        std::cerr << "Failed loading texture '" << filename
+                  << "'. Reason 'Pixel format not managed by the loader'"
+                  << std::endl;
+        return false;
+    }
+
+    // Until the upload, the texture is bound to its placeholder.
+    texture.m_load_queue = this;
+    texture.m_need_setup = true;
+
+    auto job = std::make_shared<Job>();
+    job->texture = &texture;
+    job->loader = std::move(loader);
+    job->filename = filename;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back(job);
+        m_todo.push_back(job);
+    }
+    m_condition.notify_one();
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool GLTextureLoadQueue::cancel(GLTexture& texture)
+{
+    if (texture.m_load_queue != this)
+        return false;
+
+    texture.m_load_queue = nullptr;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto match = [&texture](std::shared_ptr<Job> const& job)
+    {
+        return job->texture == &texture;
+    };
+
+    // A file being decoded by a worker thread is discarded once decoded since
+    // the worker holds the last reference on the job.
+    m_todo.erase(std::remove_if(m_todo.begin(), m_todo.end(), match), m_todo.end());
+    m_jobs.erase(std::remove_if(m_jobs.begin(), m_jobs.end(), match), m_jobs.end());
+    return true;
+}
+
+//------------------------------------------------------------------------------
+size_t GLTextureLoadQueue::pending() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_jobs.size();
+}
+
+//------------------------------------------------------------------------------
+size_t GLTextureLoadQueue::ready() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return static_cast<size_t>(std::count_if(m_jobs.begin(), m_jobs.end(),
+        [](std::shared_ptr<Job> const& job)
+        {
+            return (job->state == State::Decoded) || (job->state == State::Failed);
+        }));
+}
+
+//------------------------------------------------------------------------------
+void GLTextureLoadQueue::work()
+{
+    while (true)
+    {
+        std::shared_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this] { return m_stop || !m_todo.empty(); });
+            if (m_stop)
+                return ;
+
+            job = m_todo.front();
+            m_todo.pop_front();
+            job->state = State::Decoding;
+        }
+
+        size_t width = 0u, height = 0u;
+        bool const success = job->loader->decode(job->filename, job->buffer,
+                                               width, height);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        job->width = width;
+        job->height = height;
+        job->state = success ? State::Decoded : State::Failed;
+    }
+}
+
+//------------------------------------------------------------------------------
+size_t GLTextureLoadQueue::poll(size_t const budget)
+{
+    std::vector<std::shared_ptr<Job>> ready;
+    size_t bytes = 0u;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_jobs.begin();
+        while (it != m_jobs.end())
+        {
+            // Keep the push order: stop at the first texture not yet decoded
+            // or exceeding the budget. Always upload at least one texture else
+            // a picture bigger than the budget would never be uploaded.
+            Job& job = **it;
+            if ((job.state == State::Queued) || (job.state == State::Decoding))
+                break;
+            if (job.state == State::Decoded)
+            {
+                if ((bytes != 0u) && (bytes + job.buffer.bytes() > budget))
+                    break;
+                bytes += job.buffer.bytes();
+            }
+
+            ready.push_back(*it);
+            it = m_jobs.erase(it);
+        }
+    }
+
+    // Workers no longer access to these jobs: upload them without locking.
+    for (auto& it: ready)
+    {
+        upload(*it);
+    }
+
+    return pending();
+}
+
+//------------------------------------------------------------------------------
+void GLTextureLoadQueue::upload(Job& job)
+{
+    GLTexture2D& texture = static_cast<GLTexture2D&>(*job.texture);
+    texture.m_load_queue = nullptr;
+
+    if (job.state == State::Failed)
+    {
+        std::cerr << "Failed loading texture '" << job.filename
+                  << "'. Reason '" << job.loader->error() << "'"
+                  << std::endl;
+        return ;
+    }
+
+    texture.m_buffer.swap(job.buffer);
+    texture.m_width = job.width;
+    texture.m_height = job.height;
+    texture.compress(*job.loader);
+    texture.downsize();
+
+    // Replace the placeholder by the picture.
+    texture.m_need_setup = true;
+    texture.begin();
+    texture.end();
+}
+
+//------------------------------------------------------------------------------
+void GLTextureLoadQueue::finish()
+{
+    while (poll(std::numeric_limits<size_t>::max()) != 0u)
+    {
+        std::this_thread::yield();
+    }
+}
@@ -0,0 +1,201 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#ifndef OPENGLCPPWRAPPER_GLTEXTURE_LOAD_QUEUE_HPP
+#  define OPENGLCPPWRAPPER_GLTEXTURE_LOAD_QUEUE_HPP
+
+#  include "OpenGL/Textures/Texture2D.hpp"
+#  include "Common/NonCppStd.hpp"
+#  include <condition_variable>
+#  include <deque>
+#  include <memory>
+#  include <mutex>
+#  include <thread>
+#  include <vector>
+
+// *****************************************************************************
+//! \brief Queue of GLTexture2D whose picture files are decoded in background.
+//!
+//! GLTexture2D::load() decodes the picture file on the calling thread and the
+//! first GLTexture2D::begin() uploads it. With hundreds of textures, startup
+//! stalls for seconds. GLTextureLoadQueue decodes files on a pool of worker
+//! threads while the OpenGL thread keeps rendering: until its file has been
+//! decoded and uploaded a texture is loading() and is bound to a 1x1
+//! placeholder. Decoded pictures are uploaded by poll() (typically once per
+//! frame) in the order they have been pushed and within a budget of bytes
+//! per call to avoid frame spikes.
+//!
+//! \code
+//!   GLTextureLoadQueue queue;
+//!   queue.push<SOIL>(vao.texture2D("texID"), "wooden-crate.jpg");
+//!   ...
+//!   // In the rendering loop
+//!   queue.poll();
+//! \endcode
+//!
+//! \note Except for the decoding made by worker threads, all methods shall
+//! be called from the thread owning the OpenGL context. Loaders shall be
+//! reentrant since several files are decoded at the same time.
+// *****************************************************************************
+class GLTextureLoadQueue : private NonCopyable
+{
+public:
+
+    //--------------------------------------------------------------------------
+    //! \brief Default maximum number of bytes uploaded by poll().
+    //--------------------------------------------------------------------------
+    static constexpr size_t DEFAULT_BUDGET = 8u * 1024u * 1024u;
+
+    //--------------------------------------------------------------------------
+    //! \brief Start the worker threads decoding texture files.
+    //!
+    //! \param threads the number of worker threads. If 0 then the number of
+    //! hardware threads is used.
+    //--------------------------------------------------------------------------
+    explicit GLTextureLoadQueue(size_t const threads = 0u);
+
+    //--------------------------------------------------------------------------
+    //! \brief Cancel pending textures and join the worker threads. A file being
+    //! decoded is decoded until its end before being discarded.
+    //--------------------------------------------------------------------------
+    ~GLTextureLoadQueue();
+
+    //--------------------------------------------------------------------------
+    //! \brief Queue the decoding of a jpeg, png, bmp ... file into a texture.
+    //! Does not wait for the decoding. The texture is loading() until poll()
+    //! uploads it.
+    //!
+    //! \param texture the texture receiving the picture. Shall stay alive or
+    //! shall be destroyed (the decoding is then cancelled).
+    //! \param filename the path of the jpeg, png, bmp file.
+    //! \tparam L: class deriving from TextureLoader (ie SOIL).
+    //!
+    //! \return false if the texture is already loading or if the loader does
+    //! not manage the pixel format of the texture.
+    //--------------------------------------------------------------------------
+    template<class L>
+    inline bool push(GLTexture2D& texture, std::string const& filename)
+    {
+        static_assert(std::is_base_of<TextureLoader, L>::value,
+                      "Template L is not derived class from TextureLoader");
+        return push(texture, filename, std::make_unique<L>());
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Queue the decoding of a jpeg, png, bmp ... file with the given
+    //! loader. See push<L>().
+    //--------------------------------------------------------------------------
+    bool push(GLTexture2D& texture, std::string const& filename,
+              std::unique_ptr<TextureLoader> loader);
+
+    //--------------------------------------------------------------------------
+    //! \brief Remove the texture from the queue. Its CPU and GPU data are not
+    //! modified.
+    //!
+    //! \return false if the texture was not in the queue.
+    //--------------------------------------------------------------------------
+    bool cancel(GLTexture& texture);
+
+    //--------------------------------------------------------------------------
+    //! \brief Upload to the GPU textures whose files have been decoded, in the
+    //! order they have been pushed: a texture still decoding holds back the
+    //! textures pushed after it. To be called once per frame. The upload
+    //! stops before exceeding the budget but at least one texture is uploaded
+    //! when one is ready. Textures which failed to be decoded leave the queue
+    //! with an error message and are not loaded().
+    //!
+    //! \param budget the maximum number of bytes uploaded by this call.
+    //! \return the number of textures still loading.
+    //--------------------------------------------------------------------------
+    size_t poll(size_t const budget = DEFAULT_BUDGET);
+
+    //--------------------------------------------------------------------------
+    //! \brief Poll without budget until no texture is loading.
+    //--------------------------------------------------------------------------
+    void finish();
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of textures still loading.
+    //--------------------------------------------------------------------------
+    size_t pending() const;
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of textures whose files have been decoded (or
+    //! failed to be decoded) and which wait for poll().
+    //--------------------------------------------------------------------------
+    size_t ready() const;
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of worker threads.
+    //--------------------------------------------------------------------------
+    inline size_t threads() const
+    {
+        return m_workers.size();
+    }
+
+private:
+
+    //! \brief Progress of a texture file in the queue.
+    enum class State { Queued, Decoding, Decoded, Failed };
+
+    //--------------------------------------------------------------------------
+    //! \brief A texture file to decode. The worker threads only access to the
+    //! loader, the filename and the decoded picture, never to the texture.
+    //--------------------------------------------------------------------------
+    struct Job
+    {
+        //! \brief Always a GLTexture2D: kept as GLTexture to be compared by
+        //! cancel() while the texture is destroyed.
+        GLTexture* texture;
+        std::unique_ptr<TextureLoader> loader;
+        std::string filename;
+        GLTexture::Buffer buffer;
+        size_t width = 0u;
+        size_t height = 0u;
+        State state = State::Queued;
+    };
+
+    //--------------------------------------------------------------------------
+    //! \brief Loop of worker threads: decode queued files.
+    //--------------------------------------------------------------------------
+    void work();
+
+    //--------------------------------------------------------------------------
+    //! \brief Transfer the decoded picture to the texture and upload it.
+    //--------------------------------------------------------------------------
+    void upload(Job& job);
+
+private:
+
+    //! \brief Textures still loading, in the order they have been pushed.
+    std::deque<std::shared_ptr<Job>> m_jobs;
+    //! \brief Files not yet taken by a worker thread.
+    std::deque<std::shared_ptr<Job>> m_todo;
+    //! \brief Protect m_jobs, m_todo and the state of jobs.
+    mutable std::mutex m_mutex;
+    //! \brief Wake up worker threads.
+    std::condition_variable m_condition;
+    //! \brief Ask worker threads to return.
+    bool m_stop = false;
+    //! \brief Worker threads.
+    std::vector<std::thread> m_workers;
+};
+
+#endif // OPENGLCPPWRAPPER_GLTEXTURE_LOAD_QUEUE_HPP
@@ -0,0 +1,105 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "OpenGL/Textures/TextureRegistry.hpp"
+#include "Common/File.hpp"
+
+//------------------------------------------------------------------------------
+GLTextureRegistry& GLTextureRegistry::instance()
+{
+    static GLTextureRegistry registry;
+    return registry;
+}
+
+//------------------------------------------------------------------------------
+std::string GLTextureRegistry::key(std::string const& path,
+                                   GLTexture::Options const& options,
+                                   const char* loader)
+{
+    std::string k(File::normalize(path));
+    k += '|'; k += loader;
+    for (GLenum const param: { GLenum(options.minFilter), GLenum(options.magFilter),
+                               GLenum(options.wrapS), GLenum(options.wrapT),
+                               GLenum(options.wrapR) })
+    {
+        k += '|'; k += std::to_string(param);
+    }
+    if (options.generateMipmaps)
+    {
+        k += "|mipmaps:";
+        k += std::to_string(static_cast<int>(options.mipmapFilter));
+    }
+    if (options.downsize)
+    {
+        // Changes the pixel format of the texture
+        k += "|downsize";
+    }
+    return k;
+}
+
+//------------------------------------------------------------------------------
+std::shared_ptr<GLTexture2D> GLTextureRegistry::acquire(std::string const& path,
+                                                        GLTexture::Options const& options,
+                                                        TextureLoader& loader,
+                                                        const char* name)
+{
+    std::string const k = key(path, options, name);
+
+    auto it = m_textures.find(k);
+    if (it != m_textures.end())
+    {
+        std::shared_ptr<GLTexture2D> texture = it->second.lock();
+        if (texture != nullptr)
+            return texture;
+    }
+
+    // Purge before inserting in the aim to not grow the map with released
+    // textures.
+    purge();
+
+    auto texture = std::make_shared<GLTexture2D>(File::normalize(path));
+    texture->options(options);
+    if (!texture->doload(loader, path.c_str()))
+        return nullptr;
+    ++m_decoded;
+
+    m_textures[k] = texture;
+    return texture;
+}
+
+//------------------------------------------------------------------------------
+size_t GLTextureRegistry::size()
+{
+    purge();
+    return m_textures.size();
+}
+
+//------------------------------------------------------------------------------
+void GLTextureRegistry::purge()
+{
+    auto it = m_textures.begin();
+    while (it != m_textures.end())
+    {
+        if (it->second.expired())
+            it = m_textures.erase(it);
+        else
+            ++it;
+    }
+}
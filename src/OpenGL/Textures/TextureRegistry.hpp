@@ -0,0 +1,117 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#ifndef OPENGLCPPWRAPPER_GLTEXTURE_REGISTRY_HPP
+#  define OPENGLCPPWRAPPER_GLTEXTURE_REGISTRY_HPP
+
+#  include "OpenGL/Textures/Texture2D.hpp"
+#  include <unordered_map>
+#  include <memory>
+#  include <typeinfo>
+
+// *****************************************************************************
+//! \brief Process-wide registry of 2D textures shared by VAOs.
+//!
+//! Without it, each VAO loading the same image file decodes it and allocates
+//! its own OpenGL texture. The registry maps the normalized path of the file,
+//! the loader and the texture options to a single GLTexture2D: the image is
+//! decoded once and stored once in the GPU memory whatever the number of VAOs
+//! sampling it. Textures are reference counted: a texture is released when the
+//! last VAO holding it is destroyed.
+//!
+//! \code
+//! auto texture = GLTextureRegistry::instance().acquire<SOIL>("brick.png");
+//! vao1.shareTexture("texID", texture);
+//! vao2.shareTexture("texID", texture);
+//! \endcode
+// *****************************************************************************
+class GLTextureRegistry
+{
+public:
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the unique instance.
+    //--------------------------------------------------------------------------
+    static GLTextureRegistry& instance();
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the key of the texture loaded from the given file: the
+    //! normalized path, the loader and the options of the texture.
+    //--------------------------------------------------------------------------
+    static std::string key(std::string const& path, GLTexture::Options const& options,
+                           const char* loader);
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the texture loaded from the given file. The file is
+    //! loaded if no live texture has the same key.
+    //!
+    //! \param[in] path the path of the jpeg, png, bmp ... file.
+    //! \param[in] options the filtering, wrapping and mipmaps of the texture.
+    //! \tparam L: class deriving from TextureLoader (ie SOIL).
+    //! \return the shared texture or nullptr if the file cannot be loaded.
+    //--------------------------------------------------------------------------
+    template<class L>
+    std::shared_ptr<GLTexture2D> acquire(std::string const& path,
+                                         GLTexture::Options const& options = GLTexture::Options())
+    {
+        static_assert(std::is_base_of<TextureLoader, L>::value,
+                      "Template L is not derived class from TextureLoader");
+        L loader;
+        return acquire(path, options, loader, typeid(L).name());
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of live textures.
+    //--------------------------------------------------------------------------
+    size_t size();
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of files successfully decoded since the start
+    //! of the process.
+    //--------------------------------------------------------------------------
+    inline size_t decoded() const
+    {
+        return m_decoded;
+    }
+
+private:
+
+    //--------------------------------------------------------------------------
+    //! \brief Non template implementation of acquire().
+    //--------------------------------------------------------------------------
+    std::shared_ptr<GLTexture2D> acquire(std::string const& path,
+                                         GLTexture::Options const& options,
+                                         TextureLoader& loader,
+                                         const char* name);
+
+    //--------------------------------------------------------------------------
+    //! \brief Remove entries of released textures.
+    //--------------------------------------------------------------------------
+    void purge();
+
+private:
+
+    //! \brief Textures indexed by their key. Textures are owned by VAOs.
+    std::unordered_map<std::string, std::weak_ptr<GLTexture2D>> m_textures;
+    //! \brief Number of files successfully decoded.
+    size_t m_decoded = 0u;
+};
+
+#endif // OPENGLCPPWRAPPER_GLTEXTURE_REGISTRY_HPP
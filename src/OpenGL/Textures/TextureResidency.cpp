@@ -0,0 +1,197 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "OpenGL/Textures/TextureResidency.hpp"
+#include <algorithm>
+#include <iostream>
+
+//------------------------------------------------------------------------------
+GLTextureResidency::GLTextureResidency(size_t const budget)
+    : m_budget(budget)
+{}
+
+//------------------------------------------------------------------------------
+GLTextureResidency::~GLTextureResidency()
+{
+    for (auto& it: m_records)
+    {
+        const_cast<GLTexture*>(it.first)->m_residency = nullptr;
+    }
+}
+
+//------------------------------------------------------------------------------
+bool GLTextureResidency::manage(GLTexture& texture)
+{
+    return manage(texture, nullptr);
+}
+
+//------------------------------------------------------------------------------
+bool GLTextureResidency::manage(GLTexture& texture, Reload const& reload)
+{
+    if ((texture.m_residency != nullptr) && (texture.m_residency != this))
+        return false;
+
+    texture.m_residency = this;
+    Record& record = m_records[&texture];
+    record.reload = reload;
+    if ((!record.resident) && (texture.handle() != 0u))
+    {
+        record.resident = true;
+        record.bytes = texture.gpuBytes();
+        m_bytes += record.bytes;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+bool GLTextureResidency::unmanage(GLTexture& texture)
+{
+    if (texture.m_residency != this)
+        return false;
+
+    auto it = m_records.find(&texture);
+    if (it->second.resident)
+    {
+        m_bytes -= it->second.bytes;
+    }
+    m_records.erase(it);
+    texture.m_residency = nullptr;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void GLTextureResidency::touch(GLTexture& texture)
+{
+    auto it = m_records.find(&texture);
+    if (unlikely(it == m_records.end()))
+        return ;
+
+    Record& record = it->second;
+    record.frame = m_frame;
+    if (record.resident)
+        return ;
+
+    if (record.dropped)
+    {
+        record.dropped = false;
+        if (!record.reload(texture))
+        {
+            std::cerr << "Failed reloading texels of the evicted texture '"
+                      << texture.name() << "'" << std::endl;
+        }
+        texture.updateGpuSaving();
+    }
+
+    record.resident = true;
+    record.bytes = texture.gpuBytes();
+    m_bytes += record.bytes;
+}
+
+//------------------------------------------------------------------------------
+void GLTextureResidency::evict(GLTexture& texture, Record& record)
+{
+    texture.evict();
+    if (record.reload != nullptr)
+    {
+        texture.m_buffer = std::vector<unsigned char>();
+        texture.m_dirty_boxes.clearPending();
+        texture.updateGpuSaving();
+        record.dropped = true;
+    }
+
+    m_bytes -= record.bytes;
+    record.bytes = 0u;
+    record.resident = false;
+    ++m_evictions;
+}
+
+//------------------------------------------------------------------------------
+size_t GLTextureResidency::frame()
+{
+    using Candidate = std::pair<GLTexture*, Record*>;
+    std::vector<Candidate> candidates;
+
+    // Sizes of textures may have changed since bound (ie loaded again) and
+    // textures may have been released by the user.
+    m_bytes = 0u;
+    for (auto& it: m_records)
+    {
+        GLTexture* texture = const_cast<GLTexture*>(it.first);
+        Record& record = it.second;
+        if (!record.resident)
+            continue;
+
+        if (texture->handle() == 0u)
+        {
+            record.resident = false;
+            record.bytes = 0u;
+            continue;
+        }
+
+        record.bytes = texture->gpuBytes();
+        m_bytes += record.bytes;
+
+        // Textures used by this frame or not yet decoded are kept
+        if ((record.frame != m_frame) && (!texture->loading()))
+        {
+            candidates.push_back(Candidate(texture, &record));
+        }
+    }
+
+    size_t evicted = 0u;
+    if (m_bytes > m_budget)
+    {
+        // Least recently used first. Ties: largest first.
+        std::sort(candidates.begin(), candidates.end(),
+                  [](Candidate const& a, Candidate const& b)
+        {
+            if (a.second->frame != b.second->frame)
+                return (a.second->frame == NEVER) ||
+                       ((b.second->frame != NEVER) && (a.second->frame < b.second->frame));
+            return a.second->bytes > b.second->bytes;
+        });
+
+        for (auto& it: candidates)
+        {
+            if (m_bytes <= m_budget)
+                break;
+
+            evict(*it.first, *it.second);
+            ++evicted;
+        }
+    }
+
+    ++m_frame;
+    return evicted;
+}
+
+//------------------------------------------------------------------------------
+bool GLTextureResidency::resident(GLTexture const& texture) const
+{
+    auto it = m_records.find(&texture);
+    return (it != m_records.end()) && it->second.resident;
+}
+
+//------------------------------------------------------------------------------
+size_t GLTextureResidency::lastUsed(GLTexture const& texture) const
+{
+    auto it = m_records.find(&texture);
+    return (it != m_records.end()) ? it->second.frame : NEVER;
+}
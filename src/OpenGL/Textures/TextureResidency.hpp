@@ -0,0 +1,218 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#ifndef OPENGLCPPWRAPPER_GLTEXTURE_RESIDENCY_HPP
+#  define OPENGLCPPWRAPPER_GLTEXTURE_RESIDENCY_HPP
+
+#  include "OpenGL/Textures/Texture.hpp"
+#  include "Common/NonCppStd.hpp"
+#  include <functional>
+#  include <unordered_map>
+
+// *****************************************************************************
+//! \brief Keep the GPU memory taken by textures under a budget of bytes by
+//! deleting the OpenGL storage of textures not drawn recently.
+//!
+//! Each managed texture remembers the last frame it has been bound (by
+//! GLTexture::begin(), ie when drawing a VAO). At the end of each frame,
+//! frame() evicts the least recently used textures until the budget is
+//! respected. Evicted textures keep their texels on the CPU (or drop them and
+//! reload them with a user function) and are transparently specified again to
+//! OpenGL by their next begin().
+//!
+//! \code
+//!   GLTextureResidency residency(64u * 1024u * 1024u);
+//!   residency.manage(vao.texture2D("texID"));
+//!   residency.manage(vao2.texture2D("texID"), [](GLTexture& texture)
+//!   {
+//!       return static_cast<GLTexture2D&>(texture).load<SOIL>("grass.png");
+//!   });
+//!   ...
+//!   // In the rendering loop, after drawing
+//!   residency.frame();
+//! \endcode
+//!
+//! \note Frames are counted by frame(): the frame counter is the clock of the
+//! manager. Textures bound during the current frame are never evicted: the
+//! budget may be exceeded when they do not fit inside.
+//! \note All methods shall be called from the thread owning the OpenGL context.
+// *****************************************************************************
+class GLTextureResidency : private NonCopyable
+{
+    friend class GLTexture;
+
+public:
+
+    //--------------------------------------------------------------------------
+    //! \brief Function loading again texels of an evicted texture. Return false
+    //! on failure.
+    //--------------------------------------------------------------------------
+    using Reload = std::function<bool(GLTexture&)>;
+
+    //--------------------------------------------------------------------------
+    //! \brief Returned by lastUsed() for textures never bound.
+    //--------------------------------------------------------------------------
+    static constexpr size_t NEVER = size_t(-1);
+
+    //--------------------------------------------------------------------------
+    //! \brief Constructor.
+    //! \param budget the maximum number of bytes of textures on the GPU.
+    //--------------------------------------------------------------------------
+    explicit GLTextureResidency(size_t const budget);
+
+    //--------------------------------------------------------------------------
+    //! \brief Stop managing textures. They are not modified.
+    //--------------------------------------------------------------------------
+    ~GLTextureResidency();
+
+    //--------------------------------------------------------------------------
+    //! \brief Change the maximum number of bytes of textures on the GPU. Taken
+    //! into account by the next frame().
+    //--------------------------------------------------------------------------
+    inline void budget(size_t const bytes)
+    {
+        m_budget = bytes;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the maximum number of bytes of textures on the GPU.
+    //--------------------------------------------------------------------------
+    inline size_t budget() const
+    {
+        return m_budget;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Manage a texture keeping its texels on the CPU when evicted.
+    //!
+    //! \param texture shall stay alive or shall be destroyed (it is then no
+    //! longer managed).
+    //! \return false if the texture is managed by another manager.
+    //--------------------------------------------------------------------------
+    bool manage(GLTexture& texture);
+
+    //--------------------------------------------------------------------------
+    //! \brief Manage a texture dropping its texels from the CPU when evicted.
+    //! They are loaded again by the given function when the texture is bound.
+    //!
+    //! \note Only for textures holding their own texels (not GLTextureCube).
+    //! \return false if the texture is managed by another manager.
+    //--------------------------------------------------------------------------
+    bool manage(GLTexture& texture, Reload const& reload);
+
+    //--------------------------------------------------------------------------
+    //! \brief Stop managing the texture. Texels dropped from the CPU are not
+    //! loaded again.
+    //!
+    //! \return false if the texture was not managed by this instance.
+    //--------------------------------------------------------------------------
+    bool unmanage(GLTexture& texture);
+
+    //--------------------------------------------------------------------------
+    //! \brief End the current frame: evict the least recently used textures
+    //! until the budget is respected, then start the next frame. Shall be
+    //! called once per frame.
+    //!
+    //! \return the number of evicted textures.
+    //--------------------------------------------------------------------------
+    size_t frame();
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of the current frame.
+    //--------------------------------------------------------------------------
+    inline size_t currentFrame() const
+    {
+        return m_frame;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of bytes of managed textures on the GPU.
+    //--------------------------------------------------------------------------
+    inline size_t residentBytes() const
+    {
+        return m_bytes;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of evictions since the creation.
+    //--------------------------------------------------------------------------
+    inline size_t evictions() const
+    {
+        return m_evictions;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of managed textures.
+    //--------------------------------------------------------------------------
+    inline size_t size() const
+    {
+        return m_records.size();
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Is the managed texture stored on the GPU ?
+    //--------------------------------------------------------------------------
+    bool resident(GLTexture const& texture) const;
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the last frame the managed texture has been bound or
+    //! NEVER.
+    //--------------------------------------------------------------------------
+    size_t lastUsed(GLTexture const& texture) const;
+
+private:
+
+    // *************************************************************************
+    //! \brief Residency of a managed texture.
+    // *************************************************************************
+    struct Record
+    {
+        //! \brief Last frame the texture has been bound.
+        size_t frame = NEVER;
+        //! \brief Bytes on the GPU when resident.
+        size_t bytes = 0u;
+        bool resident = false;
+        //! \brief Texels have been dropped from the CPU.
+        bool dropped = false;
+        //! \brief Load texels again (if set, texels are dropped when evicted).
+        Reload reload;
+    };
+
+    //--------------------------------------------------------------------------
+    //! \brief Called by GLTexture::begin(): the texture is used by the current
+    //! frame. Load again dropped texels.
+    //--------------------------------------------------------------------------
+    void touch(GLTexture& texture);
+
+    //--------------------------------------------------------------------------
+    //! \brief Delete the OpenGL storage of the texture.
+    //--------------------------------------------------------------------------
+    void evict(GLTexture& texture, Record& record);
+
+private:
+
+    std::unordered_map<GLTexture const*, Record> m_records;
+    size_t m_budget;
+    size_t m_frame = 0u;
+    size_t m_bytes = 0u;
+    size_t m_evictions = 0u;
+};
+
+#endif // OPENGLCPPWRAPPER_GLTEXTURE_RESIDENCY_HPP
@@ -25,10 +25,81 @@
 //=====================================================================
 
 #include "OpenGL/Textures/Textures.hpp"
+#include "OpenGL/Textures/TextureLoadQueue.hpp"
+#include "OpenGL/Textures/TextureResidency.hpp"
 
+constexpr std::array<GLint, 4u> GLTexture::IDENTITY;
+
+//------------------------------------------------------------------------------
+GLTexture::~GLTexture()
+{
+    if (m_load_queue != nullptr)
+    {
+        m_load_queue->cancel(*this);
+    }
+    if (m_residency != nullptr)
+    {
+        m_residency->unmanage(*this);
+    }
+    release();
+}
+
+//------------------------------------------------------------------------------
+GLTexture& GLTexture::setPixelFormat(PixelFormat const format, GLenum const type,
+                                     bool const premultiplied)
+{
+    if (loaded() || loading())
+    {
+        throw GL::Exception("GLTexture '" + name() +
+                            "' cannot change the format of its texels");
+    }
+
+    GLint const gpuFormat = CPU2GPUFormat(GLenum(format), type);
+    if (gpuFormat < 0)
+    {
+        throw GL::Exception("GLTexture '" + name() +
+                            "' has no OpenGL format for its texels");
+    }
+
+    m_cpuPixelFormat = format;
+    m_cpuPixelType = type;
+    m_gpuPixelFormat = gpuFormat;
+    m_premultiplied = premultiplied;
+    switch (format)
+    {
+    case PixelFormat::RGBA:
+    case PixelFormat::BGRA:
+        m_cpuPixelCount = 4u;
+        break;
+    case PixelFormat::RGB:
+    case PixelFormat::BGR:
+        m_cpuPixelCount = 3u;
+        break;
+    case PixelFormat::LUMINANCE_ALPHA:
+    case PixelFormat::RG:
+        m_cpuPixelCount = 2u;
+        break;
+    default:
+        m_cpuPixelCount = 1u;
+        break;
+    }
+    return *this;
+}
+
+//------------------------------------------------------------------------------
+void GLTexture::onActivate()
+{
+    if (m_residency != nullptr)
+    {
+        m_residency->touch(*this);
+    }
+    glCheck(glBindTexture(m_target, m_handle));
+}
+
+//------------------------------------------------------------------------------
 GLint CPU2GPUFormat(GLenum format, GLenum type)
 {
-    if (format == GL_RGBA)
+    if ((format == GL_RGBA) || (format == GL_BGRA))
     {
         if (type == GL_UNSIGNED_BYTE)
             return GL_RGBA8;
@@ -54,7 +125,7 @@ GLint CPU2GPUFormat(GLenum format, GLenum type)
         if (type == GL_UNSIGNED_INT)
             return GL_RGBA32UI;
     }
-    else if (format == GL_RGB)
+    else if ((format == GL_RGB) || (format == GL_BGR))
     {
         if (type == GL_UNSIGNED_BYTE)
             return GL_RGB8;
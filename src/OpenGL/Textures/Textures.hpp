@@ -31,5 +31,6 @@
 #  include "OpenGL/Textures/Texture2D.hpp"
 #  include "OpenGL/Textures/Texture3D.hpp"
 #  include "OpenGL/Textures/TextureCube.hpp"
+#  include "OpenGL/Textures/TextureArray2D.hpp"
 
 #endif // OPENGLCPPWRAPPER_GLTEXTURES_HPP
@@ -34,6 +34,7 @@
 //!   - GLSampler2D:
 //!   - GLSampler3D:
 //!   - GLSamplerCube:
+//!   - GLSampler2DArray:
 // *****************************************************************************
 
 #  include "OpenGL/Variables/Location.hpp"
@@ -34,6 +34,7 @@
 //!   - GLSampler2D:
 //!   - GLSampler3D:
 //!   - GLSamplerCube:
+//!   - GLSampler2DArray:
 // *****************************************************************************
 
 #  include "OpenGL/Variables/Sampler.hpp"
@@ -98,4 +99,19 @@ public:
     {}
 };
 
+// *****************************************************************************
+//! \brief Sampler for array of 2D textures.
+// *****************************************************************************
+class GLSampler2DArray: public GLSampler
+{
+public:
+
+    //----------------------------------------------------------------------------
+    //! \brief See GLLocation constructor.
+    //----------------------------------------------------------------------------
+    GLSampler2DArray(const char *name, const GLenum texture_id, const GLuint prog)
+        : GLSampler(name, GL_SAMPLER_2D_ARRAY, texture_id, prog)
+    {}
+};
+
 #endif // OPENGLCPPWRAPPER_GLSAMPLERS_HPP
@@ -0,0 +1,380 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributedin the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#ifndef OPENGLCPPWRAPPER_GLUNIFORM_ARRAY_HPP
+#  define OPENGLCPPWRAPPER_GLUNIFORM_ARRAY_HPP
+
+#  include "OpenGL/Variables/Location.hpp"
+#  include "Common/Pending.hpp"
+#  include "Math/Matrix.hpp"
+#  include <vector>
+#  include <stdexcept>
+
+// *****************************************************************************
+//! \brief Represent an array of uniform variables used in a GLSL shader
+//! program. Example:
+//!
+//! \code
+//!   #define MAX_JOINTS 50
+//!   uniform mat4 jointTransforms[MAX_JOINTS];
+//!   uniform vec3 lightPositions[4];
+//! \endcode
+//!
+//! OpenGL reflects such variable as a single active uniform named
+//! \c "jointTransforms[0]" with a size of 50. GLProgram strips the \c "[0]"
+//! suffix and stores it as a single GLUniformArray named \c "jointTransforms"
+//! holding 50 elements.
+//!
+//! Modified elements are tracked by the Pending base class and only the
+//! smallest contiguous range of dirty elements is transfered to the GPU with a
+//! single glUniform*v() call (for example glUniformMatrix4fv(loc, count, ...))
+//! instead of one call by element.
+//!
+//! \tparam T float, int, unsigned int, VectorXf, VectorXi, VectorXu or
+//! MatrixXXf with X = [2 .. 4].
+// *****************************************************************************
+template<class T>
+class GLUniformArray: public GLLocation, public Pending
+{
+public:
+
+    //--------------------------------------------------------------------------
+    //! \brief See GLLocation constructor.
+    //! \param[in] name Give a name to the instance. The name shall be in
+    //! accordance to the uniform variable in the GLSL shader without the
+    //! \c "[0]" suffix. GLProgram uses these names as internal hash key.
+    //! \param[in] dim set the dimension of elements (1 for scalar, 2 .. 4
+    //! depending on the dimension of the vector).
+    //! \param[in] gltype set the OpenGL type of data (GL_FLOAT, GL_INT ...)
+    //! \param[in] count the number of elements of the array (as given by
+    //! glGetActiveUniform).
+    //! \param[in] prog the handle of the GLProgram (which is the owner of this
+    //! instance).
+    //--------------------------------------------------------------------------
+    GLUniformArray(const char *name, const GLint dim, const GLint gltype,
+                   const size_t count, const GLuint prog)
+        : GLLocation(name, dim, static_cast<GLenum>(gltype), prog),
+          Pending(count), m_data(count)
+    {
+        m_need_update = (count > 0u);
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Destructor. Release elements from CPU and GPU.
+    //--------------------------------------------------------------------------
+    virtual ~GLUniformArray() override
+    {
+        release();
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of elements of the array.
+    //--------------------------------------------------------------------------
+    inline size_t count() const
+    {
+        return m_data.size();
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Getter. Return the reference of the CPU data of the nth element
+    //! in read only mode.
+    //! \throw std::out_of_range if nth is out of the array bounds.
+    //--------------------------------------------------------------------------
+    inline T const& get(size_t const nth) const
+    {
+        return m_data.at(nth);
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Setter. Return the reference of the CPU data of the nth element
+    //! in write mode. The element is tagged as dirty and will be transfered to
+    //! GPU memory on the next GLObject::begin() call.
+    //! \throw std::out_of_range if nth is out of the array bounds.
+    //--------------------------------------------------------------------------
+    inline T& set(size_t const nth)
+    {
+        T& elt = m_data.at(nth);
+        setPending(nth, nth + 1u);
+        m_need_update = true;
+        return elt;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Setter. Replace the nth element by the given value.
+    //! \throw std::out_of_range if nth is out of the array bounds.
+    //--------------------------------------------------------------------------
+    template<class U>
+    inline void set(size_t const nth, U const& val)
+    {
+        set(nth) = T(val);
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Replace the first elements of the array by the given
+    //! values. Extra values are ignored since the size of GLSL arrays is fixed.
+    //! If the array was created before the shader compilation (and therefore
+    //! has an unknown size), the array is resized: GLProgram will truncate it
+    //! to the real size when compiling.
+    //--------------------------------------------------------------------------
+    template<class U>
+    GLUniformArray<T>& operator=(std::vector<U> const& values)
+    {
+        if (!isReflected())
+            m_data.resize(values.size());
+
+        size_t const n = std::min(values.size(), m_data.size());
+        for (size_t i = 0u; i < n; ++i)
+            m_data[i] = T(values[i]);
+
+        if (n > 0u)
+        {
+            setPending(0u, n);
+            m_need_update = true;
+        }
+        return *this;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Getter in the C# propety style. Return the reference of the CPU
+    //! data in read only mode.
+    //--------------------------------------------------------------------------
+    inline operator std::vector<T> const&() const
+    {
+        return m_data;
+    }
+
+private:
+
+    //--------------------------------------------------------------------------
+    //! \brief Return true if the array size has been given by the GLProgram
+    //! (after shader compilation) else false if the instance was created by the
+    //! user before compiling the GLProgram.
+    //--------------------------------------------------------------------------
+    inline bool isReflected() const
+    {
+        return m_reflected;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Called by GLProgram when reflecting the shader code: fix the size
+    //! of the array and tag all elements as dirty.
+    //--------------------------------------------------------------------------
+    void reflect(size_t const count)
+    {
+        m_reflected = true;
+        m_data.resize(count);
+        clearPending(count);
+        m_need_update = (count > 0u);
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Locate the OpenGL Uniform array and each of its elements. Element
+    //! locations are memorized because OpenGL does not guarantee them to be
+    //! contiguous: uploading a range starting at the nth element needs the
+    //! location of "name[nth]".
+    //! \return always false (success).
+    //--------------------------------------------------------------------------
+    virtual bool onCreate() override
+    {
+        m_handle = glCheck(glGetUniformLocation(m_program, cname()));
+        m_locations.resize(m_data.size());
+        if (m_locations.size() > 0u)
+        {
+            m_locations[0] = m_handle;
+        }
+        for (size_t i = 1u; i < m_locations.size(); ++i)
+        {
+            std::string elt(name() + "[" + std::to_string(i) + "]");
+            m_locations[i] = glCheck(glGetUniformLocation(m_program, elt.c_str()));
+        }
+        return false;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Bind the OpenGL Uniform. This is a dummy method. No
+    //! action is made.
+    //--------------------------------------------------------------------------
+    virtual void onActivate() override
+    {}
+
+    //--------------------------------------------------------------------------
+    //! \brief Setup the behavior of the instance. This is a dummy
+    //! method. No action is made.
+    //! \return always false (success).
+    //--------------------------------------------------------------------------
+    virtual bool onSetup() override
+    {
+        return false;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Transfer the range of dirty CPU elements to the GPU with a single
+    //! OpenGL call.
+    //! \return always false (success).
+    //--------------------------------------------------------------------------
+    virtual bool onUpdate() override
+    {
+        if (isPending())
+        {
+            size_t pos_start, pos_end;
+            getPending(pos_start, pos_end);
+            clearPending();
+
+            pos_end = std::min(pos_end, m_locations.size());
+            if (pos_start < pos_end)
+            {
+                apply(m_locations[pos_start],
+                      static_cast<GLsizei>(pos_end - pos_start),
+                      &m_data[pos_start]);
+            }
+        }
+        return false;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Unbind the OpenGL Uniform. This is a dummy method. No
+    //! action is made.
+    //--------------------------------------------------------------------------
+    virtual void onDeactivate() override
+    {}
+
+    //--------------------------------------------------------------------------
+    //! \brief Forget element locations. The CPU data is kept in the case the
+    //! program is recompiled.
+    //--------------------------------------------------------------------------
+    virtual void onRelease() override
+    {
+        m_locations.clear();
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Transfer count CPU elements to the GPU starting at the given
+    //! location.
+    //--------------------------------------------------------------------------
+    inline void apply(GLint const location, GLsizei const count,
+                      T const* values) const;
+
+    //! \brief GLProgram fixes the array size after the shader reflection.
+    friend class GLProgram;
+
+protected:
+
+    //! \brief CPU data.
+    std::vector<T> m_data;
+    //! \brief Location of each element of the array.
+    std::vector<GLint> m_locations;
+    //! \brief Has the array size been fixed by the GLProgram ?
+    bool m_reflected = false;
+};
+
+template<>
+inline void GLUniformArray<float>::apply(GLint const l, GLsizei const n, float const* v) const
+{
+    glCheck(glUniform1fv(l, n, v));
+}
+
+template<>
+inline void GLUniformArray<Vector2f>::apply(GLint const l, GLsizei const n, Vector2f const* v) const
+{
+    glCheck(glUniform2fv(l, n, reinterpret_cast<const GLfloat*>(v)));
+}
+
+template<>
+inline void GLUniformArray<Vector3f>::apply(GLint const l, GLsizei const n, Vector3f const* v) const
+{
+    glCheck(glUniform3fv(l, n, reinterpret_cast<const GLfloat*>(v)));
+}
+
+template<>
+inline void GLUniformArray<Vector4f>::apply(GLint const l, GLsizei const n, Vector4f const* v) const
+{
+    glCheck(glUniform4fv(l, n, reinterpret_cast<const GLfloat*>(v)));
+}
+
+template<>
+inline void GLUniformArray<int>::apply(GLint const l, GLsizei const n, int const* v) const
+{
+    glCheck(glUniform1iv(l, n, v));
+}
+
+template<>
+inline void GLUniformArray<Vector2i>::apply(GLint const l, GLsizei const n, Vector2i const* v) const
+{
+    glCheck(glUniform2iv(l, n, reinterpret_cast<const GLint*>(v)));
+}
+
+template<>
+inline void GLUniformArray<Vector3i>::apply(GLint const l, GLsizei const n, Vector3i const* v) const
+{
+    glCheck(glUniform3iv(l, n, reinterpret_cast<const GLint*>(v)));
+}
+
+template<>
+inline void GLUniformArray<Vector4i>::apply(GLint const l, GLsizei const n, Vector4i const* v) const
+{
+    glCheck(glUniform4iv(l, n, reinterpret_cast<const GLint*>(v)));
+}
+
+template<>
+inline void GLUniformArray<unsigned int>::apply(GLint const l, GLsizei const n, unsigned int const* v) const
+{
+    glCheck(glUniform1uiv(l, n, v));
+}
+
+template<>
+inline void GLUniformArray<Vector2u>::apply(GLint const l, GLsizei const n, Vector2u const* v) const
+{
+    glCheck(glUniform2uiv(l, n, reinterpret_cast<const GLuint*>(v)));
+}
+
+template<>
+inline void GLUniformArray<Vector3u>::apply(GLint const l, GLsizei const n, Vector3u const* v) const
+{
+    glCheck(glUniform3uiv(l, n, reinterpret_cast<const GLuint*>(v)));
+}
+
+template<>
+inline void GLUniformArray<Vector4u>::apply(GLint const l, GLsizei const n, Vector4u const* v) const
+{
+    glCheck(glUniform4uiv(l, n, reinterpret_cast<const GLuint*>(v)));
+}
+
+template<>
+inline void GLUniformArray<Matrix22f>::apply(GLint const l, GLsizei const n, Matrix22f const* m) const
+{
+    // GL_FALSE because our matrices are already transposed (column-major).
+    glCheck(glUniformMatrix2fv(l, n, GL_FALSE, reinterpret_cast<const GLfloat*>(m)));
+}
+
+template<>
+inline void GLUniformArray<Matrix33f>::apply(GLint const l, GLsizei const n, Matrix33f const* m) const
+{
+    // GL_FALSE because our matrices are already transposed (column-major).
+    glCheck(glUniformMatrix3fv(l, n, GL_FALSE, reinterpret_cast<const GLfloat*>(m)));
+}
+
+template<>
+inline void GLUniformArray<Matrix44f>::apply(GLint const l, GLsizei const n, Matrix44f const* m) const
+{
+    // GL_FALSE because our matrices are already transposed (column-major).
+    glCheck(glUniformMatrix4fv(l, n, GL_FALSE, reinterpret_cast<const GLfloat*>(m)));
+}
+
+#endif // OPENGLCPPWRAPPER_GLUNIFORM_ARRAY_HPP
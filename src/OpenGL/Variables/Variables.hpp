@@ -29,6 +29,7 @@
 
 #  include "OpenGL/Variables/Attribute.hpp"
 #  include "OpenGL/Variables/Uniform.hpp"
+#  include "OpenGL/Variables/UniformArray.hpp"
 #  include "OpenGL/Variables/Samplers.hpp"
 
 #endif // OPENGLCPPWRAPPER_GLVARIABLES_HPP
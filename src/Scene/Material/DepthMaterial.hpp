@@ -35,17 +35,17 @@ public:
 
     float& near()
     {
-        return program.scalarf("near");
+        return uniforms.scalarf("near");
     }
 
     float& far()
     {
-        return program.scalarf("far");
+        return uniforms.scalarf("far");
     }
 
     float& opacity()
     {
-        return program.scalarf("opacity");
+        return uniforms.scalarf("opacity");
     }
 
 private:
@@ -25,10 +25,10 @@
 void LineBasicMaterial::generate(GLVertexShader& vertexShader,
                                  GLFragmentShader& fragmentShader)
 {
-    //if (program.hasUniform<Vector3f>("color"))
+    //if (uniforms.has<Vector3f>("color"))
     //    config.useColor = true;
 
-    //if (program.hasUniform<float>("width"))
+    //if (uniforms.has<float>("width"))
     //    config.useWidth = true;
 
     shaders::materials::basic::line::code(vertexShader);//, config);
@@ -38,9 +38,9 @@ void LineBasicMaterial::generate(GLVertexShader& vertexShader,
 //-----------------------------------------------------------------------------
 void LineBasicMaterial::init()
 {
-    //if (!program.hasUniform<Vector3f>("color"))
+    //if (!uniforms.has<Vector3f>("color"))
     //    color() = Vector3f(1.0f, 1.0f, 1.0f);
 
-    //if (!program.hasUniform<Vector3f>("width"))
+    //if (!uniforms.has<Vector3f>("width"))
     //    width() = 1.0f;
 }
@@ -46,7 +46,7 @@ public:
 
     /*inline float& width()
     {
-        return program.scalarf("width");
+        return uniforms.scalarf("width");
     }
 */
 
@@ -19,11 +19,12 @@
 //=====================================================================
 
 #include "Scene/Material/Material.hpp"
+#include "Scene/Material/ProgramRegistry.hpp"
 
 //------------------------------------------------------------------------------
 bool Material::compile()
 {
-    if (program.compiled())
+    if (m_program != nullptr)
         return true;
 
     // Generate shaders
@@ -35,17 +36,25 @@ bool Material::compile()
     //std::cout << m_vert_shader << std::endl;
     //std::cout << m_frag_shader << std::endl;
 
-    // Compile generated shaders
-    if (!program.compile(m_vert_shader, m_frag_shader))
+    // Get the program compiled from generated shaders. Compiled once for all
+    // materials generating the same code.
+    std::shared_ptr<GLProgram> program =
+            ProgramRegistry::instance().acquire(name(), m_vert_shader, m_frag_shader);
+    if (!program->compiled())
     {
         std::cerr << "Failed compiling Material " << name()
-                  << ". Reason was '" << program.strerror()
+                  << ". Reason was '" << program->strerror()
                   << "'" << std::endl;
         return false;
     }
+    m_program = program;
 
     // Init variables of generated shaders
     init();
 
+    // Uniforms not set by this instance shall not keep the values of the
+    // material drawn before with the shared program.
+    uniforms.complete(*m_program);
+
     return true;
 }
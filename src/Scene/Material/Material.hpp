@@ -18,13 +18,146 @@
 // along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
 //=====================================================================
 
+
 #ifndef MATERIAL_HPP
 #  define MATERIAL_HPP
 
 #  include "OpenGL/Buffers/VAO.hpp"
+#  include <memory>
+
+// *****************************************************************************
+//! \brief Uniform values of a material instance. Materials with the same
+//! configuration share the same GLProgram (see ProgramRegistry), so values
+//! specific to an object (model matrix, color ...) are stored here and copied
+//! to the shared GLProgram before each draw.
+// *****************************************************************************
+class MaterialUniforms
+{
+public:
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the value of the uniform refered by its name and its type
+    //! T. The value is created if it does not exist.
+    //! \throw GL::Exception if the uniform exists with a different type.
+    //--------------------------------------------------------------------------
+    template<class T>
+    T& get(const char *name)
+    {
+        auto it = m_values.find(name);
+        if (it == m_values.end())
+        {
+            it = m_values.emplace(name, std::make_unique<Value<T>>()).first;
+        }
+
+        Value<T>* value = dynamic_cast<Value<T>*>(it->second.get());
+        if (value == nullptr)
+        {
+            throw GL::Exception("Material uniform " + std::string(name) +
+                                " exists but has wrong template type");
+        }
+        return value->data;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Check the presence of the uniform.
+    //--------------------------------------------------------------------------
+    template<class T>
+    bool has(const char *name) const
+    {
+        auto it = m_values.find(name);
+        if (it == m_values.end())
+            return false;
+        return dynamic_cast<Value<T>*>(it->second.get()) != nullptr;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Copy values to the uniforms of the program. Values not used by
+    //! the program are ignored.
+    //--------------------------------------------------------------------------
+    void apply(GLProgram& program) const
+    {
+        for (auto const& it: m_values)
+        {
+            it.second->apply(program, it.first.c_str());
+        }
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Add the uniforms of the program not set by this instance, with
+    //! the value they have in a newly created program (zero). apply() then
+    //! writes every uniform: materials sharing the program do not inherit the
+    //! values of the previously drawn material. Uniform arrays are ignored.
+    //--------------------------------------------------------------------------
+    void complete(GLProgram const& program)
+    {
+        for (auto const& it: program.uniforms())
+        {
+            if (m_values.find(it.first) != m_values.end())
+                continue;
+
+            GLLocation const* uniform = it.second.get();
+            const char* name = it.first.c_str();
+            addDefault<float>(uniform, name) || addDefault<int>(uniform, name) ||
+            addDefault<unsigned int>(uniform, name) ||
+            addDefault<Vector2f>(uniform, name) || addDefault<Vector3f>(uniform, name) ||
+            addDefault<Vector4f>(uniform, name) || addDefault<Vector2i>(uniform, name) ||
+            addDefault<Vector3i>(uniform, name) || addDefault<Vector4i>(uniform, name) ||
+            addDefault<Vector2u>(uniform, name) || addDefault<Vector3u>(uniform, name) ||
+            addDefault<Vector4u>(uniform, name) || addDefault<Matrix22f>(uniform, name) ||
+            addDefault<Matrix33f>(uniform, name) || addDefault<Matrix44f>(uniform, name);
+        }
+    }
+
+    inline Matrix44f& matrix44f(const char *name) { return get<Matrix44f>(name); }
+    inline Matrix33f& matrix33f(const char *name) { return get<Matrix33f>(name); }
+    inline Vector4f& vector4f(const char *name) { return get<Vector4f>(name); }
+    inline Vector3f& vector3f(const char *name) { return get<Vector3f>(name); }
+    inline Vector2f& vector2f(const char *name) { return get<Vector2f>(name); }
+    inline float& scalarf(const char *name) { return get<float>(name); }
+    inline int& scalar(const char *name) { return get<int>(name); }
+
+private:
+
+    struct BaseValue
+    {
+        virtual ~BaseValue() = default;
+        virtual void apply(GLProgram& program, const char *name) const = 0;
+    };
+
+    template<class T>
+    struct Value: public BaseValue
+    {
+        virtual void apply(GLProgram& program, const char *name) const override
+        {
+            program.setUniform<T>(name, data);
+        }
+
+        T data{};
+    };
+
+    //--------------------------------------------------------------------------
+    //! \brief Add a default value if the uniform has the type T.
+    //--------------------------------------------------------------------------
+    template<class T>
+    bool addDefault(GLLocation const* uniform, const char *name)
+    {
+        if (dynamic_cast<GLUniform<T> const*>(uniform) == nullptr)
+            return false;
+        m_values.emplace(name, std::make_unique<Value<T>>());
+        return true;
+    }
+
+private:
+
+    std::map<std::string, std::unique_ptr<BaseValue>> m_values;
+};
 
 // *****************************************************************************
 //! \brief Interface class for defining the reaction of an object to the light.
+//!
+//! The GLProgram is shared between materials generating the same shaders (see
+//! ProgramRegistry). Values of uniforms are specific to the material instance
+//! and shall be accessed through \c uniforms.
 // *****************************************************************************
 class Material
 {
@@ -35,7 +168,7 @@ public:
     //! shaders.
     //--------------------------------------------------------------------------
     Material(std::string const& name, GLVAO& vao)
-        : program(name),
+        : m_name(name),
           m_vert_shader("VS_" + name),
           m_frag_shader("FS_" + name),
           m_vao(vao)
@@ -51,15 +184,46 @@ public:
     //--------------------------------------------------------------------------
     inline std::string const& name() const
     {
-        return program.name();
+        return m_name;
     }
 
     //--------------------------------------------------------------------------
-    //! \brief Generate shaders, compile shaders and init their variables.
+    //! \brief Generate shaders, get the shared program compiled from them and
+    //! init their variables.
     //! \return true if shader have been compiled, else return false.
     //--------------------------------------------------------------------------
     bool compile();
 
+    //--------------------------------------------------------------------------
+    //! \brief Return true if compile() has succeeded.
+    //--------------------------------------------------------------------------
+    inline bool compiled() const
+    {
+        return m_program != nullptr;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the GLProgram shared with materials having the same
+    //! shaders. Shall be called after compile().
+    //--------------------------------------------------------------------------
+    inline GLProgram& program()
+    {
+        assert(m_program != nullptr);
+        return *m_program;
+    }
+
+    //--------------------------------------------------------------------------
+    //! \brief Copy uniform values of this instance to the shared GLProgram.
+    //! All uniforms of the program are written, including those this instance
+    //! did not set (see MaterialUniforms::complete()). To be called before
+    //! drawing.
+    //--------------------------------------------------------------------------
+    inline void apply()
+    {
+        assert(m_program != nullptr);
+        uniforms.apply(*m_program);
+    }
+
 private:
 
     //--------------------------------------------------------------------------
@@ -76,10 +240,13 @@ private:
 
 public:
 
-    GLProgram program;
+    //! \brief Uniform values of this instance.
+    MaterialUniforms uniforms;
 
 private:
 
+    std::string m_name;
+    std::shared_ptr<GLProgram> m_program;
     GLVertexShader m_vert_shader;
     GLFragmentShader m_frag_shader;
 
@@ -25,20 +25,20 @@
 void BasicMaterial::generate(GLVertexShader& vertexShader,
                              GLFragmentShader& fragmentShader)
 {
-    if (program.hasUniform<float>("ALPHATEST"))
+    if (uniforms.has<float>("ALPHATEST"))
         config.useAlphaTest = true;
 
-    if (program.hasUniform<Vector3f>("color"))
+    if (uniforms.has<Vector3f>("color"))
         config.useColor = true;
 
-    if (program.hasUniform<Vector3f>("fogColor") ||
-        program.hasUniform<float>("fogNear") ||
-        program.hasUniform<float>("fogFar"))
+    if (uniforms.has<Vector3f>("fogColor") ||
+        uniforms.has<float>("fogNear") ||
+        uniforms.has<float>("fogFar"))
     {
         config.useFog = BasicMaterial::Config::Fog::Linear;
     }
 
-    if (program.hasUniform<float>("fogDensity"))
+    if (uniforms.has<float>("fogDensity"))
     {
         config.useFog = BasicMaterial::Config::Fog::Exponential;
     }
@@ -50,13 +50,13 @@ void BasicMaterial::generate(GLVertexShader& vertexShader,
 //-----------------------------------------------------------------------------
 void BasicMaterial::init()
 {
-    if (!program.hasUniform<Vector3f>("diffuse"))
+    if (!uniforms.has<Vector3f>("diffuse"))
     {
         std::cout << "diffuse" << std::endl;
         diffuse() = Vector3f(1.0f, 1.0f, 1.0f);
     }
 
-    if (!program.hasUniform<float>("opacity"))
+    if (!uniforms.has<float>("opacity"))
     {
         opacity() = 1.0f;
     }
@@ -73,35 +73,35 @@ void BasicMaterial::init()
 
     if (config.useAlphaTest)
     {
-        if (!program.hasUniform<float>("ALPHATEST"))
+        if (!uniforms.has<float>("ALPHATEST"))
             alphaTest() = 0.5f;
     }
 
     if ((config.useMap) || (config.useBumpMap) || (config.useSpecularMap))
     {
-        if (!program.hasUniform<Vector4f>("offsetRepeat"))
+        if (!uniforms.has<Vector4f>("offsetRepeat"))
             offsetTexture() = Vector4f(0.0f, 0.0f, 1.0f, 1.0f);
     }
 
     if (config.useFog != BasicMaterial::Config::Fog::None)
     {
-        if (!program.hasUniform<Vector3f>("color"))
+        if (!uniforms.has<Vector3f>("color"))
             config.useFog = BasicMaterial::Config::Fog::Linear;
     }
 
     if (config.useFog == BasicMaterial::Config::Fog::Linear)
     {
-        if (!program.hasUniform<Vector3f>("fogColor"))
+        if (!uniforms.has<Vector3f>("fogColor"))
             fogColor() = Vector3f(0.5f, 0.5f, 0.5f);
-        if (!program.hasUniform<float>("fogNear"))
+        if (!uniforms.has<float>("fogNear"))
             fogNear() = 1.0f;
-        if (!program.hasUniform<float>("fogFar"))
+        if (!uniforms.has<float>("fogFar"))
             fogFar() = 10.0f;
     }
 
     if (config.useFog == BasicMaterial::Config::Fog::Exponential)
     {
-        if (!program.hasUniform<float>("fogDensity"))
+        if (!uniforms.has<float>("fogDensity"))
             fogDensity() = 0.00025f;
     }
 }
@@ -74,22 +74,22 @@ public:
 
     inline Vector3f& diffuse()
     {
-        return program.vector3f("diffuse");
+        return uniforms.vector3f("diffuse");
     }
 
     inline float& opacity()
     {
-        return program.scalarf("opacity");
+        return uniforms.scalarf("opacity");
     }
 
     inline Vector3f& color()
     {
-        return program.vector3f("color");
+        return uniforms.vector3f("color");
     }
 
     inline float& alphaTest()
     {
-        return program.scalarf("ALPHATEST");
+        return uniforms.scalarf("ALPHATEST");
     }
 
     GLTexture2D& texture()
@@ -99,27 +99,27 @@ public:
 
     inline Vector4f& offsetTexture()
     {
-        return program.vector4f("offsetRepeat");
+        return uniforms.vector4f("offsetRepeat");
     }
 
     inline float& fogDensity()
     {
-        return program.scalarf("fogDensity");
+        return uniforms.scalarf("fogDensity");
     }
 
     inline float& fogNear()
     {
-        return program.scalarf("fogNear");
+        return uniforms.scalarf("fogNear");
     }
 
     inline float& fogFar()
     {
-        return program.scalarf("fogFar");
+        return uniforms.scalarf("fogFar");
     }
 
     inline Vector3f& fogColor()
     {
-        return program.vector3f("fogColor");
+        return uniforms.vector3f("fogColor");
     }
 
 private:
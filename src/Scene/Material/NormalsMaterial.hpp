@@ -35,12 +35,12 @@ public:
 
     inline float& opacity()
     {
-        return program.scalarf("opacity");
+        return uniforms.scalarf("opacity");
     }
 
     inline Matrix33f& normalMatrix()
     {
-        return program.matrix33f("normalMatrix");
+        return uniforms.matrix33f("normalMatrix");
     }
 
 private:
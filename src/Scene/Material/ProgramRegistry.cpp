@@ -0,0 +1,84 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributedin the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "Scene/Material/ProgramRegistry.hpp"
+#include "OpenGL/Shaders/ProgramBinaryCache.hpp"
+
+//------------------------------------------------------------------------------
+ProgramRegistry& ProgramRegistry::instance()
+{
+    static ProgramRegistry registry;
+    return registry;
+}
+
+//------------------------------------------------------------------------------
+std::string ProgramRegistry::key(std::string const& name, GLVertexShader const& vertex,
+                                 GLFragmentShader const& fragment)
+{
+    return GLProgramBinaryCache::key({ name, vertex.code(), fragment.code() }, "");
+}
+
+//------------------------------------------------------------------------------
+std::shared_ptr<GLProgram> ProgramRegistry::acquire(std::string const& name,
+                                                    GLVertexShader& vertex,
+                                                    GLFragmentShader& fragment)
+{
+    std::string const k = key(name, vertex, fragment);
+
+    auto it = m_programs.find(k);
+    if (it != m_programs.end())
+    {
+        std::shared_ptr<GLProgram> program = it->second.lock();
+        if (program != nullptr)
+            return program;
+    }
+
+    // Purge before inserting in the aim to not grow the map with released
+    // programs.
+    purge();
+
+    auto program = std::make_shared<GLProgram>(name);
+    ++m_created;
+    if (program->compile(vertex, fragment))
+    {
+        m_programs[k] = program;
+    }
+    return program;
+}
+
+//------------------------------------------------------------------------------
+size_t ProgramRegistry::size()
+{
+    purge();
+    return m_programs.size();
+}
+
+//------------------------------------------------------------------------------
+void ProgramRegistry::purge()
+{
+    auto it = m_programs.begin();
+    while (it != m_programs.end())
+    {
+        if (it->second.expired())
+            it = m_programs.erase(it);
+        else
+            ++it;
+    }
+}
@@ -0,0 +1,95 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributedin the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#ifndef PROGRAM_REGISTRY_HPP
+#  define PROGRAM_REGISTRY_HPP
+
+#  include "OpenGL/Shaders/Program.hpp"
+#  include <unordered_map>
+#  include <memory>
+
+// *****************************************************************************
+//! \brief Process-wide registry of GLPrograms shared by materials.
+//!
+//! Materials generate their shaders from their configuration. Materials with
+//! the same configuration generate the same code: instead of compiling and
+//! linking the same GLProgram for each of them, the registry returns the
+//! program already compiled from the same code. Programs are reference
+//! counted: a program is released when the last material using it is
+//! destroyed.
+// *****************************************************************************
+class ProgramRegistry
+{
+public:
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the unique instance.
+    //--------------------------------------------------------------------------
+    static ProgramRegistry& instance();
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the key of the program made of the given shaders: hash of
+    //! the material name and of the generated code.
+    //--------------------------------------------------------------------------
+    static std::string key(std::string const& name, GLVertexShader const& vertex,
+                           GLFragmentShader const& fragment);
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the program compiled from the given shaders. The program
+    //! is created and compiled if no live program has the same key.
+    //!
+    //! \param[in] name the name of the program (the name of the material).
+    //! \return the shared program. Programs failing to compile are not shared:
+    //! check GLProgram::compiled() and GLProgram::strerror().
+    //--------------------------------------------------------------------------
+    std::shared_ptr<GLProgram> acquire(std::string const& name,
+                                       GLVertexShader& vertex,
+                                       GLFragmentShader& fragment);
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of live programs.
+    //--------------------------------------------------------------------------
+    size_t size();
+
+    //--------------------------------------------------------------------------
+    //! \brief Return the number of programs created since the start of the
+    //! process.
+    //--------------------------------------------------------------------------
+    inline size_t created() const
+    {
+        return m_created;
+    }
+
+private:
+
+    //--------------------------------------------------------------------------
+    //! \brief Remove entries of released programs.
+    //--------------------------------------------------------------------------
+    void purge();
+
+private:
+
+    //! \brief Programs indexed by their key. Programs are owned by materials.
+    std::unordered_map<std::string, std::weak_ptr<GLProgram>> m_programs;
+    //! \brief Number of programs created.
+    size_t m_created = 0u;
+};
+
+#endif
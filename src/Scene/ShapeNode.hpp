@@ -74,7 +74,7 @@ public:
             return false;
         }
 
-        if (!material.program.bind(m_vao))
+        if (!material.program().bind(m_vao))
         {
             std::cerr << "Shape " << name()
                       << ": Failed binding its VAO "
@@ -103,6 +103,10 @@ public:
     virtual bool onDraw(Matrix44f const& model_matrix = Matrix44f(matrix::Identity)) override
     {
         modelMatrix() = model_matrix;
+
+        // The program is shared with shapes having the same material
+        // configuration: upload values of this shape.
+        material.apply();
         return m_vao.draw(m_drawMode);
     }
 
@@ -136,7 +140,7 @@ public:
     //! V_clip = M_proj * M_view * M_model * V_local
     virtual Matrix44f& modelMatrix() override
     {
-        return material.program.matrix44f("modelMatrix");
+        return material.uniforms.matrix44f("modelMatrix");
     }
 
     //! \bref After modelMatrix() this matrix make process coordinates of our
@@ -146,7 +150,7 @@ public:
     //! V_clip = M_proj * M_view * M_model * V_local
     virtual Matrix44f& viewMatrix() override
     {
-        return material.program.matrix44f("viewMatrix");
+        return material.uniforms.matrix44f("viewMatrix");
     }
 
     //! \bref After viewMatrix() the coordinates are in view space we want to
@@ -157,7 +161,7 @@ public:
     //! V_clip = M_proj * M_view * M_model * V_local
     virtual Matrix44f& projectionMatrix() override
     {
-        return material.program.matrix44f("projectionMatrix");
+        return material.uniforms.matrix44f("projectionMatrix");
     }
 
 protected:
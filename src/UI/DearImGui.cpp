@@ -24,6 +24,7 @@
 // *****************************************************************************
 
 #include "UI/DearImGui.hpp"
+#include <cfloat>
 
 void DearImGuiLayer::setFont()
 {
@@ -57,6 +58,54 @@ void DearImGuiLayer::reactTo(GLWindow::Event const events)
     //io.ConfigFlags |= ImGuiConfigFlags_ViewportsNoMerge;
 }
 
+void DearImGuiLayer::profilerPanel(GLProfiler const& profiler, const char* title)
+{
+    ImGui::Begin(title);
+    GLProfiler::Frame const& frame = profiler.latest();
+    if (frame.number == 0u)
+    {
+        ImGui::Text("No frame measured yet");
+        ImGui::End();
+        return ;
+    }
+
+    ImGui::Text("Frame %zu: CPU %.2f ms, GPU %.2f ms (%s bound)", frame.number,
+                frame.cpuMs, frame.gpuMs, frame.gpuBound() ? "GPU" : "CPU");
+
+    std::vector<float> cpu, gpu;
+    for (auto const& it: profiler.history())
+    {
+        cpu.push_back(static_cast<float>(it.cpuMs));
+        gpu.push_back(static_cast<float>(it.gpuMs));
+    }
+    ImGui::PlotLines("CPU ms", cpu.data(), static_cast<int>(cpu.size()), 0,
+                     nullptr, 0.0f, FLT_MAX, ImVec2(0.0f, 40.0f));
+    ImGui::PlotLines("GPU ms", gpu.data(), static_cast<int>(gpu.size()), 0,
+                     nullptr, 0.0f, FLT_MAX, ImVec2(0.0f, 40.0f));
+
+    ImGui::Separator();
+    ImGui::Columns(3, "passes");
+    ImGui::Text("Pass"); ImGui::NextColumn();
+    ImGui::Text("CPU ms"); ImGui::NextColumn();
+    ImGui::Text("GPU ms"); ImGui::NextColumn();
+    ImGui::Separator();
+    for (auto const& sample: frame.samples)
+    {
+        ImGui::Text("%*s%s", static_cast<int>(2u * sample.depth), "",
+                    sample.name.c_str());
+        ImGui::NextColumn();
+        ImGui::Text("%.3f", sample.cpuMs());
+        ImGui::NextColumn();
+        if (sample.gpu)
+            ImGui::Text("%.3f", sample.gpuMs());
+        else
+            ImGui::Text("-");
+        ImGui::NextColumn();
+    }
+    ImGui::Columns(1);
+    ImGui::End();
+}
+
 // setup
 bool DearImGuiLayer::onSetup()
 {
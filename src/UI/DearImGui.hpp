@@ -27,6 +27,7 @@
 
 #  include "UI/Window.hpp"
 #  include "UI/Layer.hpp"
+#  include "OpenGL/Context/Profiler.hpp"
 
 #  define IMGUI_IMPL_OPENGL_LOADER_GLEW
 #  pragma GCC diagnostic push
@@ -75,6 +76,13 @@ public:
     void theme(Theme const style);
     void reactTo(GLWindow::Event const events);
 
+    //--------------------------------------------------------------------------
+    //! \brief Draw a window showing the last frames measured by the profiler:
+    //! CPU and GPU frame times and the time of each pass. To be called from
+    //! onImGuiRender().
+    //--------------------------------------------------------------------------
+    void profilerPanel(GLProfiler const& profiler, const char* title = "Profiler");
+
 private:
 
     //--------------------------------------------------------------------------
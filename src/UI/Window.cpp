@@ -21,6 +21,7 @@
 #include "UI/Window.hpp"
 #include "UI/Layer.hpp"
 #include "OpenGL/Buffers/GPUMemory.hpp"
+#include "OpenGL/Buffers/FrameCapture.hpp"
 #include <stdexcept>
 #include <iostream>
 #include <sstream>
@@ -456,6 +457,15 @@ bool GLWindow::update()
         return false;
     }
 
+    // Read back the frame before the back buffer is swapped
+    if (m_capture != nullptr)
+    {
+        int width, height;
+        glfwGetFramebufferSize(m_context, &width, &height);
+        m_capture->capture(size_t(width), size_t(height));
+        m_capture->poll();
+    }
+
     // Swap buffers
     glfwSwapBuffers(m_context);
 
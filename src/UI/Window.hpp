@@ -30,6 +30,7 @@
 #  include <mutex>
 
 class Layer;
+class GLFrameCapture;
 
 // ***************************************************************************
 //! \class GLWindow Window.hpp
@@ -186,6 +187,16 @@ public:
     //--------------------------------------------------------------------------
     void resize(uint32_t const width, uint32_t const height);
 
+    //--------------------------------------------------------------------------
+    //! \brief Record each frame rendered by the window, after layers have been
+    //! painted. The capture shall have been started and shall outlive the
+    //! recording. Pass nullptr to stop recording.
+    //--------------------------------------------------------------------------
+    inline void record(GLFrameCapture* capture)
+    {
+        m_capture = capture;
+    }
+
     //--------------------------------------------------------------------------
     //! \brief Is the window is on full screen or not.
     //! \return true if the windows is in full screen, return false else.
@@ -398,6 +409,8 @@ private:
     size_t previous_gpu_mem = 0_z;
     //! \brief Protect the keyboard against concurrent accesses.
     mutable std::mutex m_mutex_keyboard;
+    //! \brief Records frames (nullptr if not recording).
+    GLFrameCapture* m_capture = nullptr;
 };
 
 //--------------------------------------------------------------------------
@@ -0,0 +1,271 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "main.hpp"
+#define protected public
+#define private public
+#  include "Common/PendingBoxes.hpp"
+#  include "OpenGL/Textures/Textures.hpp"
+#undef protected
+#undef private
+#  include <random>
+
+using Box = PendingBoxes::Box;
+
+//--------------------------------------------------------------------------
+static Box box(size_t x, size_t y, size_t width, size_t height)
+{
+    Box b;
+    b.x = x; b.y = y; b.z = 0u;
+    b.width = width; b.height = height; b.depth = 1u;
+    return b;
+}
+
+//--------------------------------------------------------------------------
+//! \brief Check boxes are disjoint, not too many and hold all painted texels.
+//--------------------------------------------------------------------------
+static void checkBoxes(std::vector<Box> const& boxes,
+                       std::vector<bool> const& painted,
+                       size_t const width, size_t const max_boxes)
+{
+    ASSERT_LE(boxes.size(), max_boxes);
+    for (size_t i = 0u; i < boxes.size(); ++i)
+    {
+        for (size_t j = i + 1u; j < boxes.size(); ++j)
+        {
+            ASSERT_EQ(false, boxes[i].overlaps(boxes[j]));
+        }
+    }
+
+    for (size_t t = 0u; t < painted.size(); ++t)
+    {
+        if (!painted[t])
+            continue;
+
+        bool covered = false;
+        for (auto const& b: boxes)
+        {
+            covered |= b.contains(t % width, t / width);
+        }
+        ASSERT_EQ(true, covered) << "Texel " << t % width << " " << t / width;
+    }
+}
+
+//--------------------------------------------------------------------------
+TEST(TestPendingBoxes, TestEmptyConstructor)
+{
+    PendingBoxes pb;
+    ASSERT_EQ(false, pb.isPending());
+    ASSERT_EQ(0_z, pb.getPending().size());
+    ASSERT_EQ(size_t(PendingBoxes::MAX_BOXES), pb.m_max_boxes);
+
+    // Empty boxes are ignored
+    pb.setPending(1u, 2u, 0u, 0u, 4u, 1u);
+    ASSERT_EQ(false, pb.isPending());
+
+    PendingBoxes pb0(0u);
+    ASSERT_EQ(1_z, pb0.m_max_boxes);
+}
+
+//--------------------------------------------------------------------------
+TEST(TestPendingBoxes, TestMerge)
+{
+    PendingBoxes pb;
+
+    // Distant texels give distinct boxes
+    pb.setPending(1u, 1u);
+    pb.setPending(6u, 4u);
+    ASSERT_EQ(true, pb.isPending());
+    ASSERT_EQ(2_z, pb.getPending().size());
+    ASSERT_EQ(box(1u, 1u, 1u, 1u), pb.getPending()[0]);
+    ASSERT_EQ(box(6u, 4u, 1u, 1u), pb.getPending()[1]);
+
+    // Adjacent texels of a row are merged without extra texels
+    pb.setPending(2u, 1u);
+    pb.setPending(3u, 1u);
+    ASSERT_EQ(2_z, pb.getPending().size());
+    ASSERT_EQ(box(1u, 1u, 3u, 1u), pb.getPending()[1]);
+
+    // Diagonal neighbours are not merged
+    pb.setPending(7u, 5u);
+    ASSERT_EQ(3_z, pb.getPending().size());
+
+    // A box overlapping two boxes merges them
+    pb.setPending(3u, 1u, 0u, 5u, 5u, 1u);
+    ASSERT_EQ(1_z, pb.getPending().size());
+    ASSERT_EQ(box(1u, 1u, 7u, 5u), pb.getPending()[0]);
+
+    // A box already covered changes nothing
+    pb.setPending(2u, 2u, 0u, 2u, 2u, 1u);
+    ASSERT_EQ(1_z, pb.getPending().size());
+    ASSERT_EQ(box(1u, 1u, 7u, 5u), pb.getPending()[0]);
+
+    pb.clearPending();
+    ASSERT_EQ(false, pb.isPending());
+
+    // Boxes in different images
+    pb.setPending(0u, 0u, 0u, 2u, 2u, 1u);
+    pb.setPending(0u, 0u, 2u, 2u, 2u, 1u);
+    ASSERT_EQ(2_z, pb.getPending().size());
+    pb.setPending(0u, 0u, 1u, 2u, 2u, 1u);
+    ASSERT_EQ(1_z, pb.getPending().size());
+    ASSERT_EQ(3_z, pb.getPending()[0].depth);
+}
+
+//--------------------------------------------------------------------------
+TEST(TestPendingBoxes, TestMaxBoxes)
+{
+    PendingBoxes pb(3u);
+
+    pb.setPending(0u, 0u);
+    pb.setPending(10u, 0u);
+    pb.setPending(20u, 20u);
+    ASSERT_EQ(3_z, pb.getPending().size());
+
+    // Merged with the nearest box (wasting the least texels)
+    pb.setPending(12u, 0u);
+    ASSERT_EQ(3_z, pb.getPending().size());
+    ASSERT_EQ(box(10u, 0u, 3u, 1u), pb.getPending()[2]);
+
+    pb.setPending(19u, 19u);
+    ASSERT_EQ(3_z, pb.getPending().size());
+    ASSERT_EQ(box(19u, 19u, 2u, 2u), pb.getPending()[2]);
+}
+
+//--------------------------------------------------------------------------
+// Random paint patterns (texels, lines, rectangles) on a 64x64 texture.
+TEST(TestPendingBoxes, TestRandomPaint)
+{
+    const size_t W = 64u;
+    const size_t H = 64u;
+    std::mt19937 rng(42u);
+
+    for (size_t max_boxes: { 1u, 4u, 16u, 64u })
+    {
+        for (size_t run = 0u; run < 50u; ++run)
+        {
+            PendingBoxes pb(max_boxes);
+            std::vector<bool> painted(W * H, false);
+            const size_t strokes = 1u + rng() % 40u;
+
+            for (size_t s = 0u; s < strokes; ++s)
+            {
+                const size_t x = rng() % W;
+                const size_t y = rng() % H;
+                const size_t kind = rng() % 3u;
+                const size_t w = (kind == 0u) ? 1u : 1u + rng() % (W - x);
+                const size_t h = (kind == 2u) ? 1u + rng() % (H - y) : 1u;
+
+                pb.setPending(x, y, 0u, w, h, 1u);
+                for (size_t j = y; j < y + h; ++j)
+                    for (size_t i = x; i < x + w; ++i)
+                        painted[j * W + i] = true;
+
+                checkBoxes(pb.getPending(), painted, W, max_boxes);
+                if (HasFatalFailure())
+                    return;
+            }
+
+            // Boxes stay inside the painted bounding box
+            size_t area = 0u;
+            for (auto const& b: pb.getPending())
+            {
+                ASSERT_LE(b.x + b.width, W);
+                ASSERT_LE(b.y + b.height, H);
+                area += b.volume();
+            }
+            ASSERT_LE(area, W * H);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------
+// Upload rectangles computed by textures (no OpenGL needed).
+TEST(TestPendingBoxes, TestTexture2DRects)
+{
+    GLTexture2D texture("tex", 16u, 8u);
+    texture.m_cpuPixelFormat = GLTexture::PixelFormat::RGB;
+    texture.m_cpuPixelCount = 3u;
+    texture.data().resize(16u * 8u * 3u);
+    texture.data().clearPending();
+
+    // set(u, v, off) uses the number of channels of the texture
+    texture.set(2u, 5u, 2u) = 42u;
+    ASSERT_EQ(42u, texture.data().get((2u * 16u + 5u) * 3u + 2u));
+    ASSERT_EQ(42u, texture.get(2u, 5u, 2u));
+    texture.set(2u, 6u, 0u) = 43u;
+    texture.set(7u, 15u, 1u) = 44u;
+    ASSERT_EQ(false, texture.data().isPending());
+    ASSERT_EQ(true, texture.needUpdate());
+
+    auto boxes = texture.pendingBoxes();
+    ASSERT_EQ(2_z, boxes.size());
+    ASSERT_EQ(box(5u, 2u, 2u, 1u), boxes[0]);
+    ASSERT_EQ(box(15u, 7u, 1u, 1u), boxes[1]);
+    ASSERT_EQ(2u * 3u, texture.span(boxes[0]));
+    texture.m_dirty_boxes.clearPending();
+
+    // Bytes modified through data(): their rows
+    texture.data().set(16u * 3u * 4u + 1u) = 1u;
+    texture.data().set(16u * 3u * 5u + 7u) = 1u;
+    boxes = texture.pendingBoxes();
+    ASSERT_EQ(1_z, boxes.size());
+    ASSERT_EQ(box(0u, 4u, 16u, 2u), boxes[0]);
+    ASSERT_EQ(false, texture.data().isPending());
+    texture.m_dirty_boxes.clearPending();
+
+    // Tagged rectangle: spans rows of the buffer
+    texture.setPending(3u, 1u, 4u, 3u);
+    boxes = texture.pendingBoxes();
+    ASSERT_EQ(1_z, boxes.size());
+    ASSERT_EQ(box(3u, 1u, 4u, 3u), boxes[0]);
+    ASSERT_EQ((2u * 16u + 4u) * 3u, texture.span(boxes[0]));
+    ASSERT_EQ((1u * 16u + 3u) * 3u, texture.offset(3u, 1u));
+}
+
+//--------------------------------------------------------------------------
+TEST(TestPendingBoxes, TestTexture3DBoxes)
+{
+    GLTexture3D texture("tex");
+    texture.m_width = 4u;
+    texture.m_height = 4u;
+    texture.m_depth = 3u;
+    texture.data().resize(4u * 4u * 3u * 4u);
+    texture.data().clearPending();
+
+    texture.set(1u, 2u, 2u, 3u) = 42u;
+    ASSERT_EQ(42u, texture.get(1u, 2u, 2u, 3u));
+    auto boxes = texture.pendingBoxes();
+    ASSERT_EQ(1_z, boxes.size());
+    ASSERT_EQ(2_z, boxes[0].x);
+    ASSERT_EQ(1_z, boxes[0].y);
+    ASSERT_EQ(2_z, boxes[0].z);
+    ASSERT_EQ(1_z, boxes[0].volume());
+    texture.m_dirty_boxes.clearPending();
+
+    // Bytes of two images modified through data(): whole images
+    texture.data().set(4u * 4u * 4u * 0u + 5u) = 1u;
+    texture.data().set(4u * 4u * 4u * 1u + 5u) = 1u;
+    boxes = texture.pendingBoxes();
+    ASSERT_EQ(1_z, boxes.size());
+    ASSERT_EQ(0_z, boxes[0].z);
+    ASSERT_EQ(2_z, boxes[0].depth);
+    ASSERT_EQ(4u * 4u * 2u, boxes[0].volume());
+}
@@ -0,0 +1,330 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributedin the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "main.hpp"
+#define protected public
+#define private public
+#  include "OpenGL/Shaders/CompileQueue.hpp"
+#  include "OpenGL/Shaders/Program.hpp"
+#  include "OpenGL/Buffers/VAO.hpp"
+#undef protected
+#undef private
+#  include <map>
+
+//--------------------------------------------------------------------------
+//! \brief Replace the completion query by a stub simulating a driver which
+//! needs a given number of polls before completing each shader and program.
+//--------------------------------------------------------------------------
+class DelayedCompletion
+{
+public:
+
+    DelayedCompletion(size_t const polls)
+        : m_saved(GLCompileQueue::completion())
+    {
+        GLCompileQueue::completion() = [this, polls](GLuint const handle, bool const is_program)
+        {
+            ++queries;
+            size_t& count = (is_program ? m_programs[handle] : m_shaders[handle]);
+            return ++count > polls;
+        };
+    }
+
+    ~DelayedCompletion()
+    {
+        GLCompileQueue::completion() = m_saved;
+    }
+
+    size_t queries = 0u;
+
+private:
+
+    GLCompileQueue::Completion m_saved;
+    std::map<GLuint, size_t> m_shaders;
+    std::map<GLuint, size_t> m_programs;
+};
+
+//--------------------------------------------------------------------------
+static void loadShaders(GLVertexShader& vs, GLFragmentShader& fs)
+{
+    vs.path.add("tests/OpenGL/shaders:tests/OpenGL/shaders/include:"
+                "OpenGL/shaders:OpenGL/shaders/include");
+    fs.path.add("tests/OpenGL/shaders:tests/OpenGL/shaders/include:"
+                "OpenGL/shaders:OpenGL/shaders/include");
+    EXPECT_EQ(true, vs.read("test4.vs"));
+    EXPECT_EQ(true, fs.read("test4.fs"));
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLCompileQueue, TestConstructor)
+{
+    // No OpenGL context
+    {
+        GLCompileQueue queue;
+        ASSERT_EQ(0_z, queue.pending());
+        ASSERT_EQ(0_z, queue.poll());
+        queue.finish();
+    }
+
+    // With OpenGL context
+    OpenGLContext context([]()
+    {
+        GLCompileQueue queue;
+        ASSERT_EQ(0_z, queue.pending());
+        ASSERT_EQ(0_z, queue.poll());
+
+        GLProgram prog("prog");
+        ASSERT_EQ(false, prog.pending());
+    });
+}
+
+//--------------------------------------------------------------------------
+// Shaders and programs complete after 3 polls: the queue shall never block.
+TEST(TestGLCompileQueue, TestDelayedCompletion)
+{
+    OpenGLContext context([]()
+    {
+        DelayedCompletion stub(3u);
+        GLVertexShader vs1, vs2;
+        GLFragmentShader fs1, fs2;
+        GLProgram prog1("prog1");
+        GLProgram prog2("prog2");
+        GLCompileQueue queue;
+
+        loadShaders(vs1, fs1);
+        loadShaders(vs2, fs2);
+
+        // Submit all programs up front
+        ASSERT_EQ(true, queue.push(prog1, vs1, fs1));
+        ASSERT_EQ(true, queue.push(prog2, vs2, fs2));
+        ASSERT_EQ(false, queue.push(prog2, vs2, fs2));
+        ASSERT_EQ(2_z, queue.pending());
+        ASSERT_EQ(true, prog1.pending());
+        ASSERT_EQ(false, prog1.compiled());
+        ASSERT_EQ(GLProgram::AsyncState::Compiling, prog1.m_async);
+        ASSERT_EQ(true, vs1.m_compiling);
+        ASSERT_EQ(true, fs1.m_compiling);
+        // Shaders are queried once when submitted
+        ASSERT_EQ(4_z, stub.queries);
+
+        // Shaders are not yet compiled
+        ASSERT_EQ(2_z, queue.poll());
+        ASSERT_EQ(GLProgram::AsyncState::Compiling, prog1.m_async);
+        ASSERT_EQ(2_z, queue.poll());
+        ASSERT_EQ(GLProgram::AsyncState::Compiling, prog1.m_async);
+
+        // Shaders compiled: the program is linking
+        ASSERT_EQ(2_z, queue.poll());
+        ASSERT_EQ(GLProgram::AsyncState::Linking, prog1.m_async);
+        ASSERT_EQ(true, vs1.compiled());
+        ASSERT_EQ(true, fs1.compiled());
+        ASSERT_EQ(false, prog1.compiled());
+        ASSERT_EQ(0_z, prog1.m_attributes.size());
+
+        // Linkage not yet finished
+        ASSERT_EQ(2_z, queue.poll());
+        ASSERT_EQ(2_z, queue.poll());
+        ASSERT_EQ(2_z, queue.poll());
+        ASSERT_EQ(true, prog1.pending());
+
+        // Linked
+        ASSERT_EQ(0_z, queue.poll());
+        ASSERT_EQ(false, prog1.pending());
+        ASSERT_EQ(false, prog2.pending());
+        ASSERT_EQ(true, prog1.compiled());
+        ASSERT_EQ(true, prog2.compiled());
+        ASSERT_EQ(nullptr, prog1.m_queue);
+        ASSERT_EQ(2_z, prog1.m_attributes.size());
+        ASSERT_EQ(true, prog1.hasAttribute("position"));
+        ASSERT_EQ(true, prog1.hasAttribute("color"));
+        ASSERT_EQ(0_z, prog1.m_shaders.size());
+        ASSERT_STREQ("", prog1.strerror().c_str());
+        ASSERT_EQ(false, vs1.m_async);
+
+        // 4 shaders and 2 programs polled 4 times each
+        ASSERT_EQ(24_z, stub.queries);
+        ASSERT_EQ(0_z, queue.poll());
+    });
+}
+
+//--------------------------------------------------------------------------
+// VAOs bound to a pending program are not drawn and get their VBOs once the
+// program has been linked.
+TEST(TestGLCompileQueue, TestDeferredBind)
+{
+    OpenGLContext context([]()
+    {
+        DelayedCompletion stub(2u);
+        GLVertexShader vs;
+        GLFragmentShader fs;
+        GLProgram prog("prog");
+        GLCompileQueue queue;
+        GLVAO vao("vao");
+
+        loadShaders(vs, fs);
+        ASSERT_EQ(true, queue.push(prog, vs, fs));
+        ASSERT_EQ(true, prog.bind(vao));
+        ASSERT_EQ(true, prog.bind(vao));
+        ASSERT_EQ(1_z, prog.m_deferred_vaos.size());
+        ASSERT_EQ(&prog, vao.m_program);
+        ASSERT_EQ(false, vao.isBound());
+
+        // VBOs can be filled before the program has been linked
+        vao.vector2f("position") = { Vector2f(1.0f, 2.0f), Vector2f(2.0f, 3.0f), Vector2f(4.0f, 5.0f) };
+        ASSERT_EQ(1_z, vao.hasVBOs());
+
+        // Drawing is skipped (and advances the compilation)
+        ASSERT_EQ(false, vao.draw());
+        ASSERT_EQ(true, prog.pending());
+
+        queue.finish();
+        ASSERT_EQ(0_z, queue.pending());
+        ASSERT_EQ(true, prog.compiled());
+        ASSERT_EQ(true, vao.isBound());
+        ASSERT_EQ(0_z, prog.m_deferred_vaos.size());
+
+        // Missing VBOs have been created, existing ones have been kept
+        ASSERT_EQ(2_z, vao.hasVBOs());
+        ASSERT_EQ(true, vao.hasVBO<Vector2f>("position"));
+        ASSERT_EQ(true, vao.hasVBO<Vector3f>("color"));
+        ASSERT_EQ(3_z, vao.vector2f("position").size());
+        vao.vector3f("color") = { Vector3f(1.0f), Vector3f(2.0f), Vector3f(3.0f) };
+
+        ASSERT_EQ(true, vao.draw());
+    });
+}
+
+//--------------------------------------------------------------------------
+// VAOs destroyed, or outliving their program, during the asynchronous
+// compilation are unregistered.
+TEST(TestGLCompileQueue, TestDestroyDeferredVAO)
+{
+    OpenGLContext context([]()
+    {
+        DelayedCompletion stub(2u);
+        GLVertexShader vs;
+        GLFragmentShader fs;
+        GLProgram prog("prog");
+        GLCompileQueue queue;
+        GLVAO vao1("vao1");
+
+        loadShaders(vs, fs);
+        ASSERT_EQ(true, queue.push(prog, vs, fs));
+        ASSERT_EQ(true, prog.bind(vao1));
+        {
+            GLVAO vao2("vao2");
+            ASSERT_EQ(true, prog.bind(vao2));
+            ASSERT_EQ(2_z, prog.m_deferred_vaos.size());
+        }
+        ASSERT_EQ(1_z, prog.m_deferred_vaos.size());
+        ASSERT_EQ(&vao1, prog.m_deferred_vaos[0]);
+
+        queue.finish();
+        ASSERT_EQ(true, prog.compiled());
+        ASSERT_EQ(true, vao1.isBound());
+        ASSERT_EQ(false, vao1.m_deferred);
+
+        GLVAO vao3("vao3");
+        {
+            GLProgram prog2("prog2");
+            ASSERT_EQ(true, queue.push(prog2, vs, fs));
+            ASSERT_EQ(true, prog2.bind(vao3));
+            ASSERT_EQ(true, vao3.m_deferred);
+        }
+        ASSERT_EQ(nullptr, vao3.m_program);
+        ASSERT_EQ(false, vao3.m_deferred);
+    });
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLCompileQueue, TestFailure)
+{
+    OpenGLContext context([]()
+    {
+        DelayedCompletion stub(1u);
+        GLVertexShader vs;
+        GLFragmentShader fs;
+        GLProgram prog("prog");
+        GLCompileQueue queue;
+        GLVAO vao("vao");
+
+        vs = "#version 330 core\n"
+             "in vec2 position;\n"
+             "void main() { gl_Position = vec4(position, 0.0, 1.0); }";
+        fs = "#version 330 core\n"
+             "out vec4 color;\n"
+             "void main() { color = foobar; }";
+
+        ASSERT_EQ(true, queue.push(prog, vs, fs));
+        ASSERT_EQ(true, prog.bind(vao));
+        queue.finish();
+
+        ASSERT_EQ(false, prog.pending());
+        ASSERT_EQ(false, prog.compiled());
+        ASSERT_EQ(true, vs.compiled());
+        ASSERT_EQ(false, fs.compiled());
+        ASSERT_EQ(nullptr, vao.m_program);
+        ASSERT_EQ(false, vao.draw());
+        ASSERT_STRNE("", prog.strerror().c_str());
+    });
+}
+
+//--------------------------------------------------------------------------
+// A program destroyed while pending is removed from the queue.
+TEST(TestGLCompileQueue, TestDestroyPending)
+{
+    OpenGLContext context([]()
+    {
+        DelayedCompletion stub(10u);
+        GLVertexShader vs;
+        GLFragmentShader fs;
+        GLCompileQueue queue;
+
+        loadShaders(vs, fs);
+        {
+            GLProgram prog("prog");
+            ASSERT_EQ(true, queue.push(prog, vs, fs));
+            ASSERT_EQ(1_z, queue.pending());
+        }
+        ASSERT_EQ(0_z, queue.pending());
+        ASSERT_EQ(0_z, queue.poll());
+    });
+}
+
+//--------------------------------------------------------------------------
+// Without the stub: compile with the driver (parallel or not).
+TEST(TestGLCompileQueue, TestDriver)
+{
+    OpenGLContext context([]()
+    {
+        GLVertexShader vs;
+        GLFragmentShader fs;
+        GLProgram prog("prog");
+        GLCompileQueue queue;
+
+        std::cout << "Parallel shader compilation: "
+                  << GLCompileQueue::parallel() << std::endl;
+        loadShaders(vs, fs);
+        ASSERT_EQ(true, queue.push(prog, vs, fs));
+        queue.finish();
+        ASSERT_EQ(true, prog.compiled());
+        ASSERT_EQ(2_z, prog.m_attributes.size());
+    });
+}
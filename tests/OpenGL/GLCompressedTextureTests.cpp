@@ -0,0 +1,488 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "main.hpp"
+#define protected public
+#define private public
+#  include "OpenGL/Textures/Textures.hpp"
+#  include "OpenGL/Textures/TextureLoadQueue.hpp"
+#  include "Loaders/Textures/CompressedLoader.hpp"
+#undef protected
+#undef private
+#  include "Common/File.hpp"
+#  include <fstream>
+
+static const std::string DIR("/tmp/OpenGLCppWrapper-tests/compressed/");
+
+//--------------------------------------------------------------------------
+//! \brief Write a little-endian 32-bits integer.
+//--------------------------------------------------------------------------
+static void put32(std::vector<unsigned char>& file, size_t const offset, size_t const value)
+{
+    for (size_t i = 0u; i < 4u; ++i)
+        file[offset + i] = static_cast<unsigned char>(value >> (8u * i));
+}
+
+//--------------------------------------------------------------------------
+//! \brief Bytes of the given level of the given face: all equal to a value
+//! depending on them.
+//--------------------------------------------------------------------------
+static unsigned char value(size_t const seed, size_t const face, size_t const level)
+{
+    return static_cast<unsigned char>(seed + face * 16u + level + 1u);
+}
+
+//--------------------------------------------------------------------------
+//! \brief Return a DDS file. If dxgi is not 0 a DX10 header is added.
+//--------------------------------------------------------------------------
+static std::vector<unsigned char>
+makeDDS(const char* fourcc, size_t const dxgi, size_t const w, size_t const h,
+        size_t const mipmaps, bool const cube, size_t const block, size_t const seed = 0u)
+{
+    std::vector<unsigned char> file(128u + ((dxgi != 0u) ? 20u : 0u), 0u);
+    memcpy(file.data(), "DDS ", 4u);
+    put32(file, 4u, 124u);
+    put32(file, 8u, 0x1007u | 0x20000u);
+    put32(file, 12u, h);
+    put32(file, 16u, w);
+    put32(file, 28u, mipmaps);
+    put32(file, 76u, 32u);
+    put32(file, 80u, 0x4u);
+    memcpy(&file[84], (dxgi != 0u) ? "DX10" : fourcc, 4u);
+    put32(file, 108u, 0x1000u);
+    if (cube)
+        put32(file, 112u, 0x200u | 0xFC00u);
+    if (dxgi != 0u)
+    {
+        put32(file, 128u, dxgi);
+        put32(file, 132u, 3u);
+        put32(file, 136u, cube ? 4u : 0u);
+        put32(file, 140u, 1u);
+    }
+
+    for (size_t face = 0u; face < (cube ? 6u : 1u); ++face)
+    {
+        for (size_t level = 0u; level < mipmaps; ++level)
+        {
+            const size_t bytes = ((std::max(size_t(1u), w >> level) + 3u) / 4u)
+                               * ((std::max(size_t(1u), h >> level) + 3u) / 4u) * block;
+            file.insert(file.end(), bytes, value(seed, face, level));
+        }
+    }
+    return file;
+}
+
+//--------------------------------------------------------------------------
+//! \brief Return a KTX file holding 8 bytes of key/value data.
+//--------------------------------------------------------------------------
+static std::vector<unsigned char>
+makeKTX(GLenum const format, size_t const w, size_t const h, size_t const mipmaps,
+        size_t const faces, size_t const block)
+{
+    static const unsigned char magic[12] =
+    {
+        0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
+    };
+
+    std::vector<unsigned char> file(64u + 8u, 0u);
+    memcpy(file.data(), magic, 12u);
+    put32(file, 12u, 0x04030201u);
+    put32(file, 20u, 1u);
+    put32(file, 28u, format);
+    put32(file, 32u, GL_RGBA);
+    put32(file, 36u, w);
+    put32(file, 40u, h);
+    put32(file, 52u, faces);
+    put32(file, 56u, mipmaps);
+    put32(file, 60u, 8u);
+
+    for (size_t level = 0u; level < mipmaps; ++level)
+    {
+        const size_t bytes = ((std::max(size_t(1u), w >> level) + 3u) / 4u)
+                           * ((std::max(size_t(1u), h >> level) + 3u) / 4u) * block;
+        file.resize(file.size() + 4u);
+        put32(file, file.size() - 4u, bytes);
+        for (size_t face = 0u; face < faces; ++face)
+        {
+            file.insert(file.end(), bytes, value(0u, face, level));
+        }
+    }
+    return file;
+}
+
+//--------------------------------------------------------------------------
+static void writeFile(std::string const& filename, std::vector<unsigned char> const& file)
+{
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(file.data()), std::streamsize(file.size()));
+}
+
+//--------------------------------------------------------------------------
+//! \brief Check that all bytes of the range hold the value.
+//--------------------------------------------------------------------------
+static bool filled(const unsigned char* data, size_t const size, unsigned char const val)
+{
+    for (size_t i = 0u; i < size; ++i)
+    {
+        if (data[i] != val)
+            return false;
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------------
+TEST(TestCompressedLoader, TestSizes)
+{
+    ASSERT_EQ(8_z, CompressedLoader::blockSize(GL_COMPRESSED_RGBA_S3TC_DXT1_EXT));
+    ASSERT_EQ(8_z, CompressedLoader::blockSize(GL_COMPRESSED_RED_RGTC1));
+    ASSERT_EQ(16_z, CompressedLoader::blockSize(GL_COMPRESSED_RGBA_S3TC_DXT5_EXT));
+    ASSERT_EQ(16_z, CompressedLoader::blockSize(GL_COMPRESSED_RGBA_BPTC_UNORM));
+    ASSERT_EQ(0_z, CompressedLoader::blockSize(GL_RGBA8));
+
+    ASSERT_EQ(8_z, CompressedLoader::levelSize(GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 1u, 1u));
+    ASSERT_EQ(32_z, CompressedLoader::levelSize(GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 5u, 5u));
+    ASSERT_EQ(64_z * 32_z * 16_z, CompressedLoader::levelSize(GL_COMPRESSED_RGBA_BPTC_UNORM, 256u, 128u));
+}
+
+//--------------------------------------------------------------------------
+TEST(TestCompressedLoader, TestParseDDS)
+{
+    CompressedLoader loader;
+    size_t width = 0u, height = 0u;
+
+    // BC1 with mipmaps
+    std::vector<unsigned char> file = makeDDS("DXT1", 0u, 64u, 32u, 7u, false, 8u);
+    ASSERT_EQ(true, loader.parse(file.data(), file.size(), width, height));
+    ASSERT_EQ(64_z, width);
+    ASSERT_EQ(32_z, height);
+    GLTexture::Compression const& c = *loader.compression();
+    ASSERT_EQ(GLenum(GL_COMPRESSED_RGBA_S3TC_DXT1_EXT), c.format);
+    ASSERT_EQ(1_z, c.faces);
+    ASSERT_EQ(7_z, c.mipmaps());
+    const size_t sizes[7] = { 1024u, 256u, 64u, 16u, 8u, 8u, 8u };
+    size_t offset = 128u;
+    for (size_t i = 0u; i < 7u; ++i)
+    {
+        ASSERT_EQ(offset, c.levels[i].offset);
+        ASSERT_EQ(sizes[i], c.levels[i].size);
+        ASSERT_EQ(std::max(size_t(1u), 64_z >> i), c.levels[i].width);
+        ASSERT_EQ(std::max(size_t(1u), 32_z >> i), c.levels[i].height);
+        ASSERT_EQ(true, filled(file.data() + offset, sizes[i], value(0u, 0u, i)));
+        offset += sizes[i];
+    }
+    ASSERT_EQ(file.size(), offset);
+
+    // Other four character codes
+    file = makeDDS("ATI2", 0u, 8u, 8u, 1u, false, 16u);
+    ASSERT_EQ(true, loader.parse(file.data(), file.size(), width, height));
+    ASSERT_EQ(GLenum(GL_COMPRESSED_RG_RGTC2), loader.compression()->format);
+
+    // DX10 header: BC7 sRGB cube map
+    file = makeDDS(nullptr, 99u, 16u, 16u, 5u, true, 16u);
+    ASSERT_EQ(true, loader.parse(file.data(), file.size(), width, height));
+    ASSERT_EQ(GLenum(GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM), c.format);
+    ASSERT_EQ(6_z, c.faces);
+    ASSERT_EQ(5_z, c.mipmaps());
+    ASSERT_EQ(148_z, c.levels[0].offset);
+    const size_t face = 256u + 64u + 16u + 16u + 16u;
+    for (size_t f = 0u; f < 6u; ++f)
+    {
+        ASSERT_EQ(148u + f * face, c.levels[f * 5u].offset);
+        ASSERT_EQ(true, filled(file.data() + c.levels[f * 5u + 2u].offset, 16u, value(0u, f, 2u)));
+    }
+}
+
+//--------------------------------------------------------------------------
+TEST(TestCompressedLoader, TestParseKTX)
+{
+    CompressedLoader loader;
+    size_t width = 0u, height = 0u;
+
+    std::vector<unsigned char> file = makeKTX(GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 8u, 8u, 4u, 6u, 16u);
+    ASSERT_EQ(true, loader.parse(file.data(), file.size(), width, height));
+    ASSERT_EQ(8_z, width);
+    ASSERT_EQ(8_z, height);
+    GLTexture::Compression const& c = *loader.compression();
+    ASSERT_EQ(GLenum(GL_COMPRESSED_RGBA_S3TC_DXT5_EXT), c.format);
+    ASSERT_EQ(6_z, c.faces);
+    ASSERT_EQ(4_z, c.mipmaps());
+
+    // Levels are reordered face after face
+    const size_t sizes[4] = { 64u, 16u, 16u, 16u };
+    size_t offset = 72u;
+    for (size_t level = 0u; level < 4u; ++level)
+    {
+        offset += 4u;
+        for (size_t f = 0u; f < 6u; ++f)
+        {
+            GLTexture::Compression::Level const& it = c.levels[f * 4u + level];
+            ASSERT_EQ(offset, it.offset);
+            ASSERT_EQ(sizes[level], it.size);
+            ASSERT_EQ(true, filled(file.data() + it.offset, it.size, value(0u, f, level)));
+            offset += sizes[level];
+        }
+    }
+    ASSERT_EQ(file.size(), offset);
+
+    // BC4 2D texture
+    file = makeKTX(GL_COMPRESSED_RED_RGTC1, 12u, 4u, 1u, 1u, 8u);
+    ASSERT_EQ(true, loader.parse(file.data(), file.size(), width, height));
+    ASSERT_EQ(1_z, c.levels.size());
+    ASSERT_EQ(24_z, c.levels[0].size);
+}
+
+//--------------------------------------------------------------------------
+TEST(TestCompressedLoader, TestErrors)
+{
+    CompressedLoader loader;
+    size_t width = 0u, height = 0u;
+
+    std::vector<unsigned char> file(200u, 0u);
+    ASSERT_EQ(false, loader.parse(file.data(), file.size(), width, height));
+    ASSERT_STREQ("Neither a DDS nor a KTX file", loader.error().c_str());
+
+    // Truncated
+    file = makeDDS("DXT5", 0u, 16u, 16u, 1u, false, 16u);
+    ASSERT_EQ(false, loader.parse(file.data(), file.size() - 1u, width, height));
+    ASSERT_STREQ("Truncated file", loader.error().c_str());
+    ASSERT_EQ(0_z, loader.compression()->levels.size());
+    ASSERT_EQ(false, loader.parse(file.data(), 100u, width, height));
+    ASSERT_STREQ("Truncated or invalid DDS header", loader.error().c_str());
+
+    // Unknown formats
+    file = makeDDS("ABCD", 0u, 16u, 16u, 1u, false, 16u);
+    ASSERT_EQ(false, loader.parse(file.data(), file.size(), width, height));
+    ASSERT_STREQ("Compressed format not managed", loader.error().c_str());
+    file = makeDDS(nullptr, 28u, 16u, 16u, 1u, false, 16u);
+    ASSERT_EQ(false, loader.parse(file.data(), file.size(), width, height));
+    ASSERT_STREQ("Compressed format not managed", loader.error().c_str());
+
+    // Uncompressed
+    file = makeDDS("DXT1", 0u, 16u, 16u, 1u, false, 8u);
+    put32(file, 80u, 0x40u);
+    ASSERT_EQ(false, loader.parse(file.data(), file.size(), width, height));
+    ASSERT_STREQ("Uncompressed DDS files are not managed", loader.error().c_str());
+
+    // Volume
+    file = makeDDS("DXT1", 0u, 16u, 16u, 1u, false, 8u);
+    put32(file, 112u, 0x200000u);
+    ASSERT_EQ(false, loader.parse(file.data(), file.size(), width, height));
+    ASSERT_STREQ("Volume DDS files are not managed", loader.error().c_str());
+
+    // Too many levels
+    file = makeDDS("DXT1", 0u, 16u, 16u, 6u, false, 8u);
+    ASSERT_EQ(false, loader.parse(file.data(), file.size(), width, height));
+    ASSERT_STREQ("Too many mipmap levels", loader.error().c_str());
+
+    // KTX
+    file = makeKTX(GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 8u, 8u, 1u, 3u, 8u);
+    ASSERT_EQ(false, loader.parse(file.data(), file.size(), width, height));
+    ASSERT_STREQ("Cube maps shall have 6 faces", loader.error().c_str());
+    file = makeKTX(GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 8u, 8u, 1u, 1u, 8u);
+    put32(file, 16u, GL_UNSIGNED_BYTE);
+    ASSERT_EQ(false, loader.parse(file.data(), file.size(), width, height));
+    ASSERT_STREQ("Uncompressed KTX files are not managed", loader.error().c_str());
+    file = makeKTX(GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 8u, 8u, 2u, 1u, 8u);
+    put32(file, 72u, 31u);
+    ASSERT_EQ(false, loader.parse(file.data(), file.size(), width, height));
+    ASSERT_STREQ("Invalid image size", loader.error().c_str());
+    file = makeKTX(GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 8u, 8u, 2u, 1u, 8u);
+    ASSERT_EQ(false, loader.parse(file.data(), file.size() - 2u, width, height));
+    ASSERT_STREQ("Truncated file", loader.error().c_str());
+}
+
+//--------------------------------------------------------------------------
+TEST(TestCompressedLoader, TestLoad)
+{
+    ASSERT_EQ(true, File::mkdir(DIR));
+    writeFile(DIR + "cube.dds", makeDDS("DXT1", 0u, 8u, 8u, 2u, true, 8u));
+
+    CompressedLoader loader;
+    GLTexture::Buffer buffer;
+    size_t width = 0u, height = 0u;
+
+    // setPixelFormat() not called
+    ASSERT_EQ(false, loader.load(DIR + "cube.dds", buffer, width, height));
+    ASSERT_EQ(true, loader.setPixelFormat(GLTexture::PixelFormat::RGBA));
+    ASSERT_EQ(false, loader.load(DIR + "missing.dds", buffer, width, height));
+
+    // Levels are packed: the buffer holds the compressed size
+    ASSERT_EQ(true, loader.load(DIR + "cube.dds", buffer, width, height));
+    ASSERT_EQ(8_z, width);
+    ASSERT_EQ(6_z * (32_z + 8_z), buffer.size());
+    GLTexture::Compression const& c = *loader.compression();
+    size_t offset = 0u;
+    for (size_t i = 0u; i < c.levels.size(); ++i)
+    {
+        ASSERT_EQ(offset, c.levels[i].offset);
+        ASSERT_EQ(true, filled(buffer.to_array() + offset, c.levels[i].size,
+                               value(0u, i / 2u, i % 2u)));
+        offset += c.levels[i].size;
+    }
+
+    ASSERT_EQ(false, loader.save(DIR + "cube.dds", buffer, width, height));
+}
+
+//--------------------------------------------------------------------------
+//! \brief Read back compressed blocks of a level of the texture.
+//--------------------------------------------------------------------------
+static std::vector<unsigned char> readback(GLenum const target, GLint const level)
+{
+    GLint bytes = 0;
+    glCheck(glGetTexLevelParameteriv(target, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &bytes));
+    std::vector<unsigned char> blocks(static_cast<size_t>(bytes));
+    glCheck(glGetCompressedTexImage(target, level, blocks.data()));
+    return blocks;
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLCompressedTexture, TestTexture2D)
+{
+    OpenGLContext context([]()
+    {
+        ASSERT_EQ(true, File::mkdir(DIR));
+        writeFile(DIR + "bc1.dds", makeDDS("DXT1", 0u, 16u, 8u, 5u, false, 8u));
+
+        GLTexture2D texture("tex");
+        ASSERT_EQ(true, texture.load<CompressedLoader>(DIR + "bc1.dds"));
+        ASSERT_EQ(true, texture.compressed());
+        ASSERT_EQ(16_z, texture.width());
+        ASSERT_EQ(8_z, texture.height());
+        ASSERT_EQ(64_z + 16_z + 8_z + 8_z + 8_z, texture.data().bytes());
+        ASSERT_EQ(5_z, texture.compression().mipmaps());
+
+        texture.begin();
+        for (GLint level = 0; level < 5; ++level)
+        {
+            GLTexture::Compression::Level const& it = texture.compression().levels[size_t(level)];
+            std::vector<unsigned char> blocks = readback(GL_TEXTURE_2D, level);
+            ASSERT_EQ(it.size, blocks.size());
+            ASSERT_EQ(true, filled(blocks.data(), blocks.size(), value(0u, 0u, size_t(level))));
+        }
+        GLint format = 0;
+        glCheck(glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &format));
+        ASSERT_EQ(GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, format);
+        texture.end();
+
+        // Opaque white blocks: color0 = 0xFFFF, indices 0. The whole level is
+        // transfered again.
+        unsigned char* texels = texture.data().to_array();
+        for (size_t i = 0u; i < 64u; i += 8u)
+        {
+            const unsigned char block[8] = { 0xFF, 0xFF, 0u, 0u, 0u, 0u, 0u, 0u };
+            memcpy(texels + i, block, 8u);
+        }
+        texture.data().setPending(0u, 64u);
+        texture.begin();
+        std::vector<unsigned char> rgba(16u * 8u * 4u);
+        glCheck(glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data()));
+        ASSERT_EQ(true, filled(rgba.data(), rgba.size(), 255u));
+        texture.end();
+        ASSERT_EQ(false, texture.needUpdate());
+    });
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLCompressedTexture, TestTextureCube)
+{
+    OpenGLContext context([]()
+    {
+        ASSERT_EQ(true, File::mkdir(DIR));
+        writeFile(DIR + "cube.ktx", makeKTX(GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 8u, 8u, 4u, 6u, 16u));
+        writeFile(DIR + "flat.ktx", makeKTX(GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 8u, 8u, 4u, 1u, 16u));
+
+        GLTextureCube flat("flat");
+        ASSERT_EQ(false, flat.load<CompressedLoader>((DIR + "flat.ktx").c_str()));
+
+        GLTextureCube cube("cube");
+        ASSERT_EQ(true, cube.load<CompressedLoader>((DIR + "cube.ktx").c_str()));
+        for (size_t f = 0u; f < 6u; ++f)
+        {
+            ASSERT_EQ(true, cube.m_textures[f]->compressed());
+            ASSERT_EQ(64_z + 16_z + 16_z + 16_z, cube.m_textures[f]->data().size());
+            ASSERT_EQ(8_z, cube.m_textures[f]->width());
+        }
+
+        cube.begin();
+        for (size_t f = 0u; f < 6u; ++f)
+        {
+            for (GLint level = 0; level < 4; ++level)
+            {
+                std::vector<unsigned char> blocks =
+                    readback(GLenum(GL_TEXTURE_CUBE_MAP_POSITIVE_X + f), level);
+                ASSERT_EQ(cube.m_textures[f]->compression().levels[size_t(level)].size, blocks.size());
+                ASSERT_EQ(true, filled(blocks.data(), blocks.size(), value(0u, f, size_t(level))));
+            }
+        }
+        cube.end();
+    });
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLCompressedTexture, TestTexture3D)
+{
+    OpenGLContext context([]()
+    {
+        ASSERT_EQ(true, File::mkdir(DIR));
+        writeFile(DIR + "slice0.dds", makeDDS(nullptr, 98u, 8u, 8u, 2u, false, 16u, 0u));
+        writeFile(DIR + "slice1.dds", makeDDS(nullptr, 98u, 8u, 8u, 2u, false, 16u, 100u));
+        writeFile(DIR + "bc1.dds", makeDDS("DXT1", 0u, 8u, 8u, 1u, false, 8u));
+
+        GLTexture3D wrong("wrong");
+        ASSERT_EQ(false, wrong.load<CompressedLoader>({ DIR + "slice0.dds", DIR + "bc1.dds" }));
+
+        GLTexture3D texture("tex");
+        ASSERT_EQ(true, texture.load<CompressedLoader>({ DIR + "slice0.dds", DIR + "slice1.dds" }));
+        ASSERT_EQ(true, texture.compressed());
+        ASSERT_EQ(2_z, texture.depth());
+        ASSERT_EQ(2_z, texture.compression().levels.size());
+
+        texture.begin();
+        std::vector<unsigned char> blocks = readback(GL_TEXTURE_3D, 0);
+        ASSERT_EQ(128_z, blocks.size());
+        ASSERT_EQ(true, filled(blocks.data(), 64u, value(0u, 0u, 0u)));
+        ASSERT_EQ(true, filled(blocks.data() + 64u, 64u, value(100u, 0u, 0u)));
+        texture.end();
+    });
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLCompressedTexture, TestLoadQueue)
+{
+    OpenGLContext context([]()
+    {
+        ASSERT_EQ(true, File::mkdir(DIR));
+        writeFile(DIR + "bc3.ktx", makeKTX(GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 8u, 4u, 2u, 1u, 16u));
+
+        GLTextureLoadQueue queue(1u);
+        GLTexture2D texture("tex");
+        ASSERT_EQ(true, queue.push<CompressedLoader>(texture, DIR + "bc3.ktx"));
+        queue.finish();
+        ASSERT_EQ(false, texture.loading());
+        ASSERT_EQ(true, texture.compressed());
+        ASSERT_EQ(2_z, texture.compression().mipmaps());
+
+        texture.begin();
+        std::vector<unsigned char> blocks = readback(GL_TEXTURE_2D, 1);
+        ASSERT_EQ(16_z, blocks.size());
+        ASSERT_EQ(true, filled(blocks.data(), blocks.size(), value(0u, 0u, 1u)));
+        texture.end();
+    });
+}
@@ -0,0 +1,247 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "main.hpp"
+#define protected public
+#define private public
+#  include "OpenGL/Buffers/DynamicResolution.hpp"
+#undef protected
+#undef private
+#  include <array>
+#  include <cmath>
+#  include <deque>
+
+//--------------------------------------------------------------------------
+//! \brief Synthetic GPU: the frame time is proportional to the number of
+//! pixels. Return the scale after the given number of frames.
+//--------------------------------------------------------------------------
+static float simulate(GLDynamicResolution& resolution, float const full_resolution_ms,
+                      size_t const frames, std::vector<float>* scales = nullptr)
+{
+    for (size_t i = 0u; i < frames; ++i)
+    {
+        float const s = resolution.scale();
+        resolution.update(full_resolution_ms * s * s, s);
+        if (scales != nullptr)
+            scales->push_back(resolution.scale());
+    }
+    return resolution.scale();
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLDynamicResolution, TestConverge)
+{
+    GLDynamicResolution resolution(GLDynamicResolution::Timing::MANUAL);
+    ASSERT_EQ(resolution.scale(), 1.0f);
+
+    // 25 ms at full resolution for a 16.7 ms target: 82% of the resolution
+    std::vector<float> scales;
+    float const scale = simulate(resolution, 25.0f, 300u, &scales);
+    float const expected = std::sqrt((1000.0f / 60.0f) / 25.0f);
+    ASSERT_NEAR(scale, expected, 0.05f);
+    ASSERT_LE(std::fabs(resolution.frameTime() - 1000.0f / 60.0f), 0.06f * 1000.0f / 60.0f);
+    ASSERT_EQ(resolution.measurements(), 300_z);
+
+    // Without oscillations
+    for (size_t i = 1u; i < scales.size(); ++i)
+    {
+        ASSERT_LE(scales[i], scales[i - 1u]);
+    }
+
+    // The load goes down: the resolution goes back up
+    ASSERT_EQ(simulate(resolution, 10.0f, 300u), 1.0f);
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLDynamicResolution, TestLimits)
+{
+    GLDynamicResolution::Config config;
+    config.minScale = 0.5f;
+    config.maxScale = 0.9f;
+    GLDynamicResolution resolution(config, GLDynamicResolution::Timing::MANUAL);
+    ASSERT_EQ(resolution.scale(), 0.9f);
+
+    // Far too heavy: stuck at the minimal scale
+    ASSERT_EQ(simulate(resolution, 200.0f, 300u), 0.5f);
+
+    // Very light: stuck at the maximal scale
+    ASSERT_EQ(simulate(resolution, 1.0f, 300u), 0.9f);
+
+    // Invalid measurements are ignored
+    resolution.update(0.0f);
+    resolution.update(-5.0f);
+    ASSERT_EQ(resolution.measurements(), 600_z);
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLDynamicResolution, TestSpikesAndTolerance)
+{
+    GLDynamicResolution resolution(GLDynamicResolution::Timing::MANUAL);
+
+    // Frames close to the target keep the scale
+    for (size_t i = 0u; i < 100u; ++i)
+    {
+        resolution.update((i & 1u) ? 16.0f : 17.2f);
+        ASSERT_EQ(resolution.scale(), 1.0f);
+    }
+
+    // A single spike is smoothed and limited to one step
+    resolution.update(100.0f);
+    ASSERT_GE(resolution.scale(), 0.95f - 1e-6f);
+    ASSERT_LT(resolution.scale(), 1.0f);
+    resolution.update(1000.0f / 60.0f);
+    ASSERT_GE(resolution.scale(), 0.9f - 1e-6f);
+}
+
+//--------------------------------------------------------------------------
+//! \brief Timer query results arrive frames after the scale has changed:
+//! they are normalized with the scale of their own frame.
+//--------------------------------------------------------------------------
+TEST(TestGLDynamicResolution, TestLateMeasurements)
+{
+    GLDynamicResolution resolution(GLDynamicResolution::Timing::MANUAL);
+    float const full_resolution_ms = 30.0f;
+    float const expected = std::sqrt((1000.0f / 60.0f) / full_resolution_ms);
+
+    // Results read 2 frames late, as with the ring of queries
+    std::deque<float> scales;
+    float lowest = 1.0f;
+    for (size_t i = 0u; i < 300u; ++i)
+    {
+        scales.push_back(resolution.scale());
+        if (scales.size() > 2u)
+        {
+            float const s = scales.front();
+            scales.pop_front();
+            resolution.update(full_resolution_ms * s * s, s);
+
+            // The full resolution cost is not biased by scale changes
+            ASSERT_NEAR(resolution.m_cost, full_resolution_ms, 1e-3f);
+        }
+        lowest = std::min(lowest, resolution.scale());
+    }
+
+    // Converges without going under the target scale
+    ASSERT_NEAR(resolution.scale(), expected, 0.05f);
+    ASSERT_GE(lowest, expected - 0.05f);
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLDynamicResolution, TestAllocations)
+{
+    GLDynamicResolution resolution(GLDynamicResolution::Timing::MANUAL);
+    ASSERT_THROW(resolution.framebuffer(), GL::Exception);
+    ASSERT_EQ(resolution.allocations(), 0_z);
+
+    resolution.resize(1920u, 1080u);
+    ASSERT_EQ(resolution.allocations(), 1_z);
+    ASSERT_EQ(resolution.capacityWidth(), 1920u);
+    ASSERT_EQ(resolution.capacityHeight(), 1080u);
+    ASSERT_EQ(resolution.framebuffer().width(), 1920u);
+    ASSERT_EQ(resolution.texture().m_width, 1920_z);
+    ASSERT_EQ(resolution.viewportWidth(), 1920u);
+
+    // Changing the scale only changes the viewport
+    simulate(resolution, 30.0f, 300u);
+    ASSERT_LT(resolution.scale(), 1.0f);
+    ASSERT_EQ(resolution.allocations(), 1_z);
+    ASSERT_EQ(resolution.viewportWidth(), uint32_t(std::lround(1920.0f * resolution.scale())));
+    ASSERT_EQ(resolution.viewportHeight(), uint32_t(std::lround(1080.0f * resolution.scale())));
+    ASSERT_FLOAT_EQ(resolution.uvScaleX(), float(resolution.viewportWidth()) / 1920.0f);
+
+    // Smaller windows reuse attachments
+    resolution.resize(1280u, 720u);
+    ASSERT_EQ(resolution.allocations(), 1_z);
+    ASSERT_EQ(resolution.capacityWidth(), 1920u);
+    ASSERT_EQ(resolution.viewportWidth(), uint32_t(std::lround(1280.0f * resolution.scale())));
+    resolution.resize(1920u, 1080u);
+    ASSERT_EQ(resolution.allocations(), 1_z);
+
+    // Larger ones reallocate, without shrinking the other dimension
+    resolution.resize(1200u, 1600u);
+    ASSERT_EQ(resolution.allocations(), 2_z);
+    ASSERT_EQ(resolution.capacityWidth(), 1920u);
+    ASSERT_EQ(resolution.capacityHeight(), 1600u);
+    ASSERT_EQ(resolution.framebuffer().height(), 1600u);
+
+    // Attachments sized for the maximal scale
+    GLDynamicResolution::Config config;
+    config.maxScale = 0.75f;
+    GLDynamicResolution reduced(config, GLDynamicResolution::Timing::MANUAL);
+    reduced.resize(1920u, 1080u);
+    ASSERT_EQ(reduced.capacityWidth(), 1440u);
+    ASSERT_EQ(reduced.capacityHeight(), 810u);
+}
+
+//--------------------------------------------------------------------------
+//! \brief Render at half the resolution and upscale with llvmpipe.
+//--------------------------------------------------------------------------
+TEST(TestGLDynamicResolution, TestRender)
+{
+    OpenGLContext context([]()
+    {
+        GLDynamicResolution::Config config;
+        config.minScale = config.maxScale = 0.5f;
+        config.filter = GL_NEAREST;
+        GLDynamicResolution resolution(config, GLDynamicResolution::Timing::GPU);
+        resolution.resize(16u, 16u);
+        ASSERT_EQ(resolution.viewportWidth(), 8u);
+
+        for (size_t frame = 0u; frame < 6u; ++frame)
+        {
+            resolution.render([]()
+            {
+                GLint viewport[4];
+                glCheck(glGetIntegerv(GL_VIEWPORT, viewport));
+                ASSERT_EQ(viewport[2], 8);
+                ASSERT_EQ(viewport[3], 8);
+                glCheck(glClearColor(0.0f, 1.0f, 0.0f, 1.0f));
+                glCheck(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+            });
+            glCheck(glFinish());
+        }
+        // GPU times have been read back
+        ASSERT_GT(resolution.measurements(), 0_z);
+        ASSERT_GT(resolution.frameTime(), 0.0f);
+
+        GLTexture2D texture("window");
+        GLFrameBuffer window("window");
+        window.resize(16u, 16u);
+        window.createColorTexture(texture);
+        window.render([]()
+        {
+            glCheck(glClearColor(1.0f, 0.0f, 0.0f, 1.0f));
+            glCheck(glClear(GL_COLOR_BUFFER_BIT));
+        });
+        resolution.present(window);
+        ASSERT_EQ(glGetError(), GLenum(GL_NO_ERROR));
+
+        // The whole window is covered by the upscaled viewport
+        std::array<unsigned char, 16u * 16u * 4u> texels;
+        glCheck(glBindTexture(GL_TEXTURE_2D, texture.handle()));
+        glCheck(glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, texels.data()));
+        glCheck(glBindTexture(GL_TEXTURE_2D, 0u));
+        for (size_t i = 0u; i < texels.size(); i += 4u)
+        {
+            ASSERT_EQ(texels[i], 0u);
+            ASSERT_EQ(texels[i + 1u], 255u);
+        }
+    });
+}
@@ -0,0 +1,227 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "main.hpp"
+#define protected public
+#define private public
+#  include "OpenGL/Buffers/FrameBuffers.hpp"
+#undef protected
+#undef private
+#  include <array>
+
+static constexpr uint32_t SIZE = 16u;
+using Texels = std::array<unsigned char, SIZE * SIZE * 4u>;
+
+//--------------------------------------------------------------------------
+//! \brief Draw a white triangle covering the lower left half of the color
+//! buffers of the bound framebuffer: pixels along the diagonal are partially
+//! covered.
+//--------------------------------------------------------------------------
+static void drawTriangle()
+{
+    const char* vs = "#version 330 core\n"
+                     "layout(location = 0) in vec2 position;\n"
+                     "void main() { gl_Position = vec4(position, 0.0, 1.0); }\n";
+    const char* fs = "#version 330 core\n"
+                     "layout(location = 0) out vec4 color0;\n"
+                     "layout(location = 1) out vec4 color1;\n"
+                     "void main() { color0 = vec4(1.0); color1 = vec4(1.0); }\n";
+    const GLfloat vertices[] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f };
+
+    GLuint program = glCreateProgram();
+    GLuint shaders[2] = { glCreateShader(GL_VERTEX_SHADER), glCreateShader(GL_FRAGMENT_SHADER) };
+    glCheck(glShaderSource(shaders[0], 1, &vs, nullptr));
+    glCheck(glShaderSource(shaders[1], 1, &fs, nullptr));
+    for (auto const& shader: shaders)
+    {
+        glCheck(glCompileShader(shader));
+        glCheck(glAttachShader(program, shader));
+    }
+    glCheck(glLinkProgram(program));
+
+    GLuint vao, vbo;
+    glCheck(glGenVertexArrays(1, &vao));
+    glCheck(glGenBuffers(1, &vbo));
+    glCheck(glBindVertexArray(vao));
+    glCheck(glBindBuffer(GL_ARRAY_BUFFER, vbo));
+    glCheck(glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW));
+    glCheck(glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, nullptr));
+    glCheck(glEnableVertexAttribArray(0));
+
+    glCheck(glViewport(0, 0, SIZE, SIZE));
+    glCheck(glClearColor(0.0f, 0.0f, 0.0f, 1.0f));
+    glCheck(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+    glCheck(glUseProgram(program));
+    glCheck(glDrawArrays(GL_TRIANGLES, 0, 3));
+
+    glCheck(glUseProgram(0));
+    glCheck(glBindVertexArray(0));
+    glCheck(glDeleteBuffers(1, &vbo));
+    glCheck(glDeleteVertexArrays(1, &vao));
+    for (auto const& shader: shaders)
+    {
+        glCheck(glDeleteShader(shader));
+    }
+    glCheck(glDeleteProgram(program));
+}
+
+//--------------------------------------------------------------------------
+//! \brief Return the number of texels neither black nor white.
+//--------------------------------------------------------------------------
+static size_t blended(GLTexture2D& texture)
+{
+    Texels texels;
+    glCheck(glBindTexture(GL_TEXTURE_2D, texture.handle()));
+    glCheck(glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, texels.data()));
+    glCheck(glBindTexture(GL_TEXTURE_2D, 0u));
+
+    size_t count = 0u;
+    for (size_t i = 0u; i < texels.size(); i += 4u)
+    {
+        if ((texels[i] != 0u) && (texels[i] != 255u))
+            ++count;
+    }
+    return count;
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLFrameBuffer, TestMultisampleRenderBuffers)
+{
+    OpenGLContext context([]()
+    {
+        GLFrameBuffer msaa("msaa", SIZE, SIZE, 2u, true, false, 4);
+        ASSERT_EQ(msaa.samples(), 4);
+        ASSERT_EQ(msaa.m_color_buffers[0]->samples(), 4);
+        ASSERT_EQ(msaa.m_color_buffers[0]->format(), GLenum(GL_RGBA8));
+        ASSERT_EQ(msaa.m_depth_buffer->samples(), 4);
+
+        msaa.render([]()
+        {
+            GLint samples = 0;
+            glCheck(glGetIntegerv(GL_SAMPLES, &samples));
+            ASSERT_GE(samples, 4);
+            drawTriangle();
+        });
+
+        // Resolve both color buffers into textures
+        GLTexture2D a("a"), b("b");
+        GLFrameBuffer resolved("resolved");
+        resolved.resize(SIZE, SIZE);
+        resolved.createColorTexture(a);
+        resolved.createColorTexture(b);
+        msaa.resolve(resolved);
+        ASSERT_EQ(glGetError(), GLenum(GL_NO_ERROR));
+        ASSERT_GT(blended(a), 0_z);
+        ASSERT_GT(blended(b), 0_z);
+
+        // Without multisampling, pixels are either covered or not
+        GLTexture2D c("c");
+        GLFrameBuffer single("single");
+        single.resize(SIZE, SIZE);
+        single.createColorTexture(c);
+        single.render(drawTriangle);
+        ASSERT_EQ(blended(c), 0_z);
+    });
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLFrameBuffer, TestMultisampleTexture)
+{
+    OpenGLContext context([]()
+    {
+        GLTexture2DMultisample samples("samples", 4);
+        ASSERT_EQ(samples.target(), GLenum(GL_TEXTURE_2D_MULTISAMPLE));
+        ASSERT_EQ(samples.samples(), 4);
+
+        GLFrameBuffer msaa("msaa", SIZE, SIZE, 0u, true, false, 4);
+        msaa.createColorTexture(samples);
+        msaa.render(drawTriangle);
+
+        GLint count = 0;
+        glCheck(glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, samples.handle()));
+        glCheck(glGetTexLevelParameteriv(GL_TEXTURE_2D_MULTISAMPLE, 0, GL_TEXTURE_SAMPLES, &count));
+        glCheck(glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, 0u));
+        ASSERT_GE(count, 4);
+
+        GLTexture2D texture("texture");
+        GLFrameBuffer resolved("resolved");
+        resolved.resize(SIZE, SIZE);
+        resolved.createColorTexture(texture);
+        msaa.resolve(resolved);
+        ASSERT_EQ(glGetError(), GLenum(GL_NO_ERROR));
+        ASSERT_GT(blended(texture), 0_z);
+
+        // Explicit invalidation
+        msaa.invalidate();
+        ASSERT_EQ(glGetError(), GLenum(GL_NO_ERROR));
+    });
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLFrameBuffer, TestResolveErrors)
+{
+    OpenGLContext context([]()
+    {
+        GLFrameBuffer msaa("msaa", SIZE, SIZE, 1u, true, false, 4);
+        GLFrameBuffer small("small", SIZE / 2u, SIZE / 2u);
+        ASSERT_THROW(msaa.resolve(msaa), GL::Exception);
+        ASSERT_THROW(msaa.resolve(small), GL::Exception);
+
+        // Attachments shall have the same number of samples
+        GLTexture2D texture("texture");
+        msaa.createColorTexture(texture);
+        ASSERT_THROW(msaa.begin(), GL::Exception);
+    });
+}
+
+//--------------------------------------------------------------------------
+//! \brief Shared color buffers are invalidated and resolved at the attachment
+//! point of their index in each framebuffer.
+//--------------------------------------------------------------------------
+TEST(TestGLFrameBuffer, TestSharedBufferAttachments)
+{
+    OpenGLContext context([]()
+    {
+        GLColorBuffer a("a", SIZE, SIZE, GL_COLOR_ATTACHMENT0, GL_RGBA8, 4);
+        GLColorBuffer b("b", SIZE, SIZE, GL_COLOR_ATTACHMENT0, GL_RGBA8, 4);
+        GLFrameBuffer first("first", SIZE, SIZE, 0u, false, false, 4);
+        GLFrameBuffer second("second", SIZE, SIZE, 0u, false, false, 4);
+        first.attachColorBuffer(a);
+        second.attachColorBuffer(b).attachColorBuffer(a);
+        second.begin(); second.end();
+        first.begin(); first.end();
+
+        std::vector<GLenum> const expected = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+        ASSERT_EQ(second.attachments(), expected);
+        ASSERT_EQ(first.attachments(), std::vector<GLenum>{ GL_COLOR_ATTACHMENT0 });
+
+        // Resolve both color buffers of the framebuffer sharing a
+        GLTexture2D t0("t0"), t1("t1");
+        GLFrameBuffer resolved("resolved");
+        resolved.resize(SIZE, SIZE);
+        resolved.createColorTexture(t0);
+        resolved.createColorTexture(t1);
+        second.render(drawTriangle);
+        second.resolve(resolved);
+        ASSERT_EQ(glGetError(), GLenum(GL_NO_ERROR));
+        ASSERT_GT(blended(t0), 0_z);
+        ASSERT_GT(blended(t1), 0_z);
+    });
+}
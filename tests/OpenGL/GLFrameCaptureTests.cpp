@@ -0,0 +1,326 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "main.hpp"
+#define protected public
+#define private public
+#  include "OpenGL/Buffers/FrameCapture.hpp"
+#undef protected
+#undef private
+#  include "Common/File.hpp"
+#  include <array>
+#  include <fstream>
+
+static const std::string DIR("/tmp/OpenGLCppWrapper-tests/capture/");
+static constexpr size_t WIDTH = 6u;
+static constexpr size_t HEIGHT = 4u;
+
+//--------------------------------------------------------------------------
+//! \brief RGBA color of the bottom half of the given frame. The top half
+//! is white.
+//--------------------------------------------------------------------------
+static std::array<unsigned char, 4u> color(size_t const frame)
+{
+    return {{ static_cast<unsigned char>((frame & 1u) ? 255u : 0u),
+              static_cast<unsigned char>((frame & 2u) ? 255u : 0u),
+              static_cast<unsigned char>((frame & 4u) ? 255u : 0u),
+              255u }};
+}
+
+//--------------------------------------------------------------------------
+//! \brief Expected RGBA texel of the given frame at the given row (0 is the
+//! top of the picture).
+//--------------------------------------------------------------------------
+static std::array<unsigned char, 4u> texel(size_t const frame, size_t const row)
+{
+    if (row < HEIGHT / 2u)
+        return {{ 255u, 255u, 255u, 255u }};
+    return color(frame);
+}
+
+//--------------------------------------------------------------------------
+//! \brief Render the given frame into the framebuffer.
+//--------------------------------------------------------------------------
+static void render(GLFrameBuffer& framebuffer, size_t const frame)
+{
+    framebuffer.render([frame]()
+    {
+        std::array<unsigned char, 4u> const c = color(frame);
+        glCheck(glClearColor(c[0] / 255.0f, c[1] / 255.0f, c[2] / 255.0f, 1.0f));
+        glCheck(glClear(GL_COLOR_BUFFER_BIT));
+
+        // OpenGL rows start from the bottom: paint the upper half in white
+        glCheck(glEnable(GL_SCISSOR_TEST));
+        glCheck(glScissor(0, GLint(HEIGHT / 2u), GLsizei(WIDTH), GLsizei(HEIGHT / 2u)));
+        glCheck(glClearColor(1.0f, 1.0f, 1.0f, 1.0f));
+        glCheck(glClear(GL_COLOR_BUFFER_BIT));
+        glCheck(glDisable(GL_SCISSOR_TEST));
+    });
+}
+
+//--------------------------------------------------------------------------
+//! \brief Render and capture frames as a rendering loop would do.
+//--------------------------------------------------------------------------
+static void record(GLFrameCapture& capture, GLFrameBuffer& framebuffer,
+                   size_t const frames)
+{
+    for (size_t i = 0u; i < frames; ++i)
+    {
+        render(framebuffer, i);
+        ASSERT_EQ(true, capture.capture(framebuffer));
+        capture.poll();
+    }
+    capture.stop();
+}
+
+//--------------------------------------------------------------------------
+static std::vector<unsigned char> readFile(std::string const& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<unsigned char>(std::istreambuf_iterator<char>(file),
+                                      std::istreambuf_iterator<char>());
+}
+
+//--------------------------------------------------------------------------
+static size_t get32(std::vector<unsigned char> const& data, size_t const offset)
+{
+    return (size_t(data[offset]) << 24) | (size_t(data[offset + 1u]) << 16) |
+           (size_t(data[offset + 2u]) << 8) | size_t(data[offset + 3u]);
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLFrameCapture, TestRaw)
+{
+    ASSERT_EQ(true, File::mkdir(DIR));
+    OpenGLContext context([]()
+    {
+        GLFrameCapture capture;
+        GLFrameBuffer framebuffer("fbo", WIDTH, HEIGHT, 1u, false);
+        render(framebuffer, 0u);
+
+        // Not recording
+        ASSERT_EQ(false, capture.recording());
+        ASSERT_EQ(false, capture.capture(framebuffer));
+
+        ASSERT_EQ(true, capture.start(DIR + "video.raw", GLFrameCapture::Format::Raw));
+        ASSERT_EQ(true, capture.recording());
+        ASSERT_EQ(false, capture.start(DIR + "video.raw", GLFrameCapture::Format::Raw));
+        record(capture, framebuffer, 5u);
+        ASSERT_EQ(false, capture.recording());
+        ASSERT_EQ(5_z, capture.captured());
+        ASSERT_EQ(5_z, capture.written());
+        ASSERT_EQ(0_z, capture.dropped());
+
+        std::vector<unsigned char> const data = readFile(DIR + "video.raw");
+        ASSERT_EQ(5_z * WIDTH * HEIGHT * 4_z, data.size());
+        size_t i = 0u;
+        for (size_t frame = 0u; frame < 5u; ++frame)
+        {
+            for (size_t y = 0u; y < HEIGHT; ++y)
+            {
+                for (size_t x = 0u; x < WIDTH; ++x, i += 4u)
+                {
+                    std::array<unsigned char, 4u> const c = texel(frame, y);
+                    ASSERT_EQ(c[0], data[i]);
+                    ASSERT_EQ(c[1], data[i + 1u]);
+                    ASSERT_EQ(c[2], data[i + 2u]);
+                    ASSERT_EQ(c[3], data[i + 3u]);
+                }
+            }
+        }
+
+        ASSERT_EQ(false, capture.start("/nonexistent/dir/video.raw",
+                                       GLFrameCapture::Format::Raw));
+    });
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLFrameCapture, TestY4M)
+{
+    ASSERT_EQ(true, File::mkdir(DIR));
+    OpenGLContext context([]()
+    {
+        GLFrameCapture capture;
+        GLFrameBuffer framebuffer("fbo", WIDTH, HEIGHT, 1u, false);
+        ASSERT_EQ(true, capture.start(DIR + "video.y4m", GLFrameCapture::Format::Y4M, 30u));
+        record(capture, framebuffer, 8u);
+        ASSERT_EQ(8_z, capture.written());
+
+        std::vector<unsigned char> const data = readFile(DIR + "video.y4m");
+        std::string const header("YUV4MPEG2 W6 H4 F30:1 Ip A1:1 C444\n");
+        ASSERT_EQ(header, std::string(data.begin(), data.begin() + long(header.size())));
+
+        size_t const plane = WIDTH * HEIGHT;
+        ASSERT_EQ(header.size() + 8_z * (6_z + 3_z * plane), data.size());
+        size_t offset = header.size();
+        for (size_t frame = 0u; frame < 8u; ++frame)
+        {
+            ASSERT_EQ("FRAME\n", std::string(data.begin() + long(offset),
+                                             data.begin() + long(offset + 6u)));
+            offset += 6u;
+            for (size_t y = 0u; y < HEIGHT; ++y)
+            {
+                std::array<unsigned char, 4u> const c = texel(frame, y);
+                int const r = c[0], g = c[1], b = c[2];
+                for (size_t x = 0u; x < WIDTH; ++x)
+                {
+                    size_t const i = offset + y * WIDTH + x;
+                    ASSERT_EQ(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16, data[i]);
+                    ASSERT_EQ(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128, data[i + plane]);
+                    ASSERT_EQ(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128, data[i + 2u * plane]);
+                }
+            }
+            offset += 3u * plane;
+        }
+
+        // White is Y = 235 and black Y = 16 in studio range
+        ASSERT_EQ(235u, data[header.size() + 6u]);
+        ASSERT_EQ(16u, data[header.size() + 6u + (HEIGHT - 1u) * WIDTH]);
+    });
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLFrameCapture, TestPNG)
+{
+    ASSERT_EQ(true, File::mkdir(DIR));
+    OpenGLContext context([]()
+    {
+        GLFrameCapture capture;
+        GLFrameBuffer framebuffer("fbo", WIDTH, HEIGHT, 1u, false);
+        std::string const prefix(DIR + "frame");
+        ASSERT_EQ(DIR + "frame_000012.png", GLFrameCapture::filename(prefix, 12u));
+        ASSERT_EQ(true, capture.start(prefix, GLFrameCapture::Format::PNG));
+        record(capture, framebuffer, 3u);
+        ASSERT_EQ(3_z, capture.written());
+
+        for (size_t frame = 0u; frame < 3u; ++frame)
+        {
+            std::vector<unsigned char> const data =
+                    readFile(GLFrameCapture::filename(prefix, frame));
+            ASSERT_GT(data.size(), 8u + 25u + 12u + 12u);
+
+            // Signature and header
+            const unsigned char signature[8] = { 0x89u, 'P', 'N', 'G', '\r', '\n', 0x1Au, '\n' };
+            ASSERT_EQ(0, memcmp(data.data(), signature, 8u));
+            ASSERT_EQ(13_z, get32(data, 8u));
+            ASSERT_EQ(0, memcmp(&data[12], "IHDR", 4u));
+            ASSERT_EQ(WIDTH, get32(data, 16u));
+            ASSERT_EQ(HEIGHT, get32(data, 20u));
+            ASSERT_EQ(8u, data[24]); // bit depth
+            ASSERT_EQ(6u, data[25]); // RGBA
+
+            // Image data: zlib header then a single stored deflate block
+            size_t const idat = 8u + 25u;
+            size_t const rows = HEIGHT * (1u + WIDTH * 4u);
+            ASSERT_EQ(0, memcmp(&data[idat + 4u], "IDAT", 4u));
+            ASSERT_EQ(2_z + 5_z + rows + 4_z, get32(data, idat));
+            size_t offset = idat + 8u;
+            ASSERT_EQ(0x78u, data[offset]);
+            ASSERT_EQ(1u, data[offset + 2u]); // last block, stored
+            ASSERT_EQ(rows, size_t(data[offset + 3u]) | (size_t(data[offset + 4u]) << 8));
+            offset += 7u;
+            for (size_t y = 0u; y < HEIGHT; ++y)
+            {
+                ASSERT_EQ(0u, data[offset++]); // filter
+                std::array<unsigned char, 4u> const c = texel(frame, y);
+                for (size_t x = 0u; x < WIDTH; ++x, offset += 4u)
+                {
+                    ASSERT_EQ(0, memcmp(&data[offset], c.data(), 4u));
+                }
+            }
+
+            // Adler-32 of rows
+            uint32_t a = 1u, b = 0u;
+            for (size_t i = offset - rows; i < offset; ++i)
+            {
+                a = (a + data[i]) % 65521u;
+                b = (b + a) % 65521u;
+            }
+            ASSERT_EQ(size_t((b << 16) | a), get32(data, offset));
+
+            // Trailer
+            ASSERT_EQ(0, memcmp(&data[data.size() - 8u], "IEND", 4u));
+            ASSERT_EQ(0xAE426082u, get32(data, data.size() - 4u));
+        }
+    });
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLFrameCapture, TestDropPolicy)
+{
+    OpenGLContext context([]()
+    {
+        // Without encoder thread the queue is never emptied: frames from 0 to
+        // 4 arrive in a queue of 2 frames.
+        auto push = [](GLFrameCapture& capture)
+        {
+            for (unsigned char i = 0u; i < 5u; ++i)
+            {
+                std::vector<unsigned char> texels(WIDTH * HEIGHT * 4u, i);
+                capture.enqueue(WIDTH, HEIGHT)(i + 1u, texels.data(), texels.size());
+            }
+        };
+
+        GLFrameCapture newest(2u, GLFrameCapture::DropPolicy::DropNewest);
+        push(newest);
+        ASSERT_EQ(5_z, newest.captured());
+        ASSERT_EQ(3_z, newest.dropped());
+        ASSERT_EQ(2_z, newest.m_frames.size());
+        ASSERT_EQ(0u, newest.m_frames[0].texels[0]);
+        ASSERT_EQ(1u, newest.m_frames[1].texels[0]);
+
+        GLFrameCapture oldest(2u, GLFrameCapture::DropPolicy::DropOldest);
+        push(oldest);
+        ASSERT_EQ(5_z, oldest.captured());
+        ASSERT_EQ(3_z, oldest.dropped());
+        ASSERT_EQ(2_z, oldest.m_frames.size());
+        ASSERT_EQ(3u, oldest.m_frames[0].texels[0]);
+        ASSERT_EQ(4u, oldest.m_frames[1].texels[0]);
+
+        // Dropped frames have been reused by the next ones
+        ASSERT_EQ(0_z, oldest.m_spares.size());
+    });
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLFrameCapture, TestBlock)
+{
+    ASSERT_EQ(true, File::mkdir(DIR));
+    OpenGLContext context([]()
+    {
+        // A queue of a single frame: the rendering waits for the encoder but
+        // no frame is lost.
+        GLFrameCapture capture(1u, GLFrameCapture::DropPolicy::Block);
+        GLFrameBuffer framebuffer("fbo", WIDTH, HEIGHT, 1u, false);
+        ASSERT_EQ(true, capture.start(DIR + "block.y4m", GLFrameCapture::Format::Y4M));
+        record(capture, framebuffer, 20u);
+        ASSERT_EQ(20_z, capture.captured());
+        ASSERT_EQ(20_z, capture.written());
+        ASSERT_EQ(0_z, capture.dropped());
+
+        // Restart: counters are reset and the file is overwritten
+        ASSERT_EQ(true, capture.start(DIR + "block.y4m", GLFrameCapture::Format::Y4M));
+        record(capture, framebuffer, 2u);
+        ASSERT_EQ(2_z, capture.written());
+        std::string const header("YUV4MPEG2 W6 H4 F60:1 Ip A1:1 C444\n");
+        ASSERT_EQ(header.size() + 2_z * (6_z + 3_z * WIDTH * HEIGHT),
+                  readFile(DIR + "block.y4m").size());
+    });
+}
@@ -0,0 +1,299 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "main.hpp"
+#define protected public
+#define private public
+#  include "OpenGL/Context/Profiler.hpp"
+#undef protected
+#undef private
+#  include <map>
+#  include <set>
+
+//--------------------------------------------------------------------------
+//! \brief Fake GPU: timestamps are given by the test and results become
+//! available when the test decides it.
+//--------------------------------------------------------------------------
+class MockBackend : public GLProfiler::Backend
+{
+public:
+
+    virtual GLuint create() override
+    {
+        ++created;
+        alive->insert(++last);
+        return last;
+    }
+
+    virtual void destroy(GLuint const query) override
+    {
+        alive->erase(query);
+    }
+
+    virtual void timestamp(GLuint const query) override
+    {
+        // A reused query loses its previous result
+        done.erase(query);
+        issued.push_back(query);
+        values[query] = clock;
+    }
+
+    virtual bool available(GLuint const query) override
+    {
+        ++polls;
+        return done.count(query) != 0u;
+    }
+
+    virtual uint64_t result(GLuint const query) override
+    {
+        ++reads;
+        return values[query];
+    }
+
+    virtual uint64_t now() override
+    {
+        return clock;
+    }
+
+    //! \brief The GPU completes all issued queries.
+    void complete()
+    {
+        done.insert(issued.begin(), issued.end());
+        issued.clear();
+    }
+
+    uint64_t clock = 0u;
+    GLuint last = 0u;
+    size_t created = 0u;
+    size_t polls = 0u;
+    size_t reads = 0u;
+    //! \brief Shared for being checked after the destruction of the profiler.
+    std::shared_ptr<std::set<GLuint>> alive = std::make_shared<std::set<GLuint>>();
+    std::set<GLuint> done;
+    std::vector<GLuint> issued;
+    std::map<GLuint, uint64_t> values;
+};
+
+//--------------------------------------------------------------------------
+//! \brief Profile a frame with a "scene" pass holding a "shadows" pass and
+//! followed by a "post" pass. GPU durations are 3, 2 and 1 ms.
+//--------------------------------------------------------------------------
+static void frame(GLProfiler& profiler, MockBackend& gpu)
+{
+    profiler.beginFrame();
+    {
+        GLProfiler::Scope scene(profiler, "scene");
+        {
+            GLProfiler::Scope shadows(profiler, "shadows");
+            gpu.clock += 2000000u;
+        }
+        gpu.clock += 1000000u;
+    }
+    {
+        GLProfiler::Scope post(profiler, "post");
+        gpu.clock += 1000000u;
+    }
+    {
+        GLProfiler::Scope ui(profiler, "ui", false);
+    }
+    profiler.endFrame();
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLProfiler, TestLatching)
+{
+    MockBackend* gpu = new MockBackend();
+    GLProfiler profiler(3u, 10u, std::unique_ptr<GLProfiler::Backend>(gpu));
+
+    ASSERT_EQ(profiler.latest().number, 0_z);
+    ASSERT_EQ(profiler.history().size(), 0_z);
+
+    // GPU results not available: nothing is latched and nothing waits
+    frame(profiler, *gpu);
+    frame(profiler, *gpu);
+    ASSERT_EQ(profiler.pending(), 2_z);
+    ASSERT_EQ(profiler.latest().number, 0_z);
+    ASSERT_EQ(gpu->reads, 0_z);
+
+    // GPU done: the frames are latched in order on the next frame end
+    gpu->complete();
+    frame(profiler, *gpu);
+    ASSERT_EQ(profiler.pending(), 1_z);
+    ASSERT_EQ(profiler.history().size(), 2_z);
+    ASSERT_EQ(profiler.history()[0].number, 1_z);
+    ASSERT_EQ(profiler.history()[1].number, 2_z);
+
+    GLProfiler::Frame const& latest = profiler.latest();
+    ASSERT_EQ(latest.number, 2_z);
+    ASSERT_EQ(latest.samples.size(), 4_z);
+    ASSERT_STREQ(latest.samples[0].name.c_str(), "scene");
+    ASSERT_STREQ(latest.samples[1].name.c_str(), "shadows");
+    ASSERT_STREQ(latest.samples[2].name.c_str(), "post");
+    ASSERT_STREQ(latest.samples[3].name.c_str(), "ui");
+    ASSERT_EQ(latest.samples[0].depth, 0_z);
+    ASSERT_EQ(latest.samples[1].depth, 1_z);
+    ASSERT_EQ(latest.samples[2].depth, 0_z);
+    ASSERT_NEAR(latest.samples[0].gpuMs(), 3.0, 1e-9);
+    ASSERT_NEAR(latest.samples[1].gpuMs(), 2.0, 1e-9);
+    ASSERT_NEAR(latest.samples[2].gpuMs(), 1.0, 1e-9);
+    ASSERT_NEAR(latest.samples[1].gpuBegin, 0.0, 1e-9);
+    ASSERT_NEAR(latest.samples[2].gpuBegin, 3.0, 1e-9);
+    ASSERT_FALSE(latest.samples[3].gpu);
+
+    // Nested scopes are not counted twice
+    ASSERT_NEAR(latest.gpuMs, 4.0, 1e-9);
+    ASSERT_TRUE(latest.gpuBound());
+    ASSERT_GE(latest.cpuMs, latest.samples[0].cpuMs());
+    ASSERT_GE(latest.samples[0].cpuMs(), latest.samples[1].cpuMs());
+
+    // Frame 3 waits for its results even if frame 4 is ready
+    frame(profiler, *gpu);
+    ASSERT_EQ(profiler.latest().number, 2_z);
+    gpu->complete();
+    profiler.finish();
+    ASSERT_EQ(profiler.pending(), 0_z);
+    ASSERT_EQ(profiler.latest().number, 4_z);
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLProfiler, TestQueryPool)
+{
+    MockBackend* gpu = new MockBackend();
+    std::shared_ptr<std::set<GLuint>> alive = gpu->alive;
+    {
+        GLProfiler profiler(3u, 4u, std::unique_ptr<GLProfiler::Backend>(gpu));
+
+        // 3 GPU scopes = 6 queries per frame. Results come 2 frames later.
+        frame(profiler, *gpu);
+        frame(profiler, *gpu);
+        for (size_t i = 0u; i < 100u; ++i)
+        {
+            gpu->complete();
+            frame(profiler, *gpu);
+        }
+
+        // Queries of latched frames are reused: no more than the frames in
+        // flight need.
+        ASSERT_EQ(profiler.frames(), 3_z);
+        ASSERT_LE(profiler.queries(), 3_z * 6_z);
+        ASSERT_EQ(gpu->created, profiler.queries());
+        ASSERT_EQ(profiler.history().size(), 4_z);
+        ASSERT_EQ(profiler.latest().number, 101_z);
+
+        // GPU late: the ring grows instead of waiting
+        for (size_t i = 0u; i < 5u; ++i)
+        {
+            frame(profiler, *gpu);
+        }
+        ASSERT_EQ(profiler.frames(), 6_z);
+        ASSERT_EQ(profiler.pending(), 6_z);
+        ASSERT_EQ(profiler.latest().number, 101_z);
+        gpu->complete();
+        frame(profiler, *gpu);
+        ASSERT_EQ(profiler.pending(), 1_z);
+        ASSERT_EQ(profiler.latest().number, 107_z);
+        ASSERT_EQ(profiler.freeQueries(), profiler.queries() - 6_z);
+    }
+
+    // All queries have been destroyed
+    ASSERT_EQ(alive->size(), 0_z);
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLProfiler, TestMisuse)
+{
+    MockBackend* gpu = new MockBackend();
+    GLProfiler profiler(2u, 2u, std::unique_ptr<GLProfiler::Backend>(gpu));
+
+    // Outside frames scopes are ignored
+    {
+        GLProfiler::Scope scope(profiler, "ignored");
+    }
+    ASSERT_EQ(gpu->created, 0_z);
+
+    profiler.beginFrame();
+    ASSERT_THROW(profiler.beginFrame(), GL::Exception);
+    ASSERT_THROW(profiler.pop(), GL::Exception);
+    profiler.push("opened");
+    ASSERT_THROW(profiler.endFrame(), GL::Exception);
+    profiler.pop();
+    profiler.endFrame();
+    profiler.finish();
+    ASSERT_EQ(profiler.latest().samples.size(), 1_z);
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLProfiler, TestTrace)
+{
+    MockBackend* gpu = new MockBackend();
+    GLProfiler profiler(2u, 2u, std::unique_ptr<GLProfiler::Backend>(gpu));
+
+    frame(profiler, *gpu);
+    profiler.beginFrame();
+    {
+        GLProfiler::Scope scope(profiler, "say \"hi\"\\");
+    }
+    profiler.endFrame();
+    gpu->complete();
+    profiler.finish();
+
+    std::string const json = profiler.trace();
+    ASSERT_EQ(json.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["), 0u);
+    ASSERT_NE(json.find("\"name\":\"Frame 1\""), std::string::npos);
+    ASSERT_NE(json.find("\"name\":\"Frame 2\""), std::string::npos);
+    ASSERT_NE(json.find("\"name\":\"say \\\"hi\\\"\\\\\""), std::string::npos);
+    ASSERT_NE(json.find("\"name\":\"shadows\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":1,\"tid\":2"),
+              std::string::npos);
+    ASSERT_NE(json.find("\"dur\":2000.000"), std::string::npos);
+
+    // Balanced braces and closed array of events
+    size_t open = size_t(std::count(json.begin(), json.end(), '{'));
+    ASSERT_EQ(open, size_t(std::count(json.begin(), json.end(), '}')));
+    ASSERT_EQ(json.compare(json.size() - 4u, 4u, "\n]}\n"), 0);
+
+    ASSERT_TRUE(profiler.exportTrace("/tmp/GLProfilerTests.json"));
+    ASSERT_FALSE(profiler.exportTrace("/nonexistent/dir/trace.json"));
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLProfiler, TestOpenGL)
+{
+    OpenGLContext context([]()
+    {
+        GLProfiler profiler;
+
+        for (size_t i = 0u; i < 3u; ++i)
+        {
+            profiler.beginFrame();
+            {
+                GLProfiler::Scope scope(profiler, "flush");
+                glCheck(glFlush());
+            }
+            profiler.endFrame();
+        }
+        profiler.finish();
+
+        ASSERT_EQ(profiler.latest().number, 3_z);
+        ASSERT_EQ(profiler.queries(), profiler.freeQueries());
+        ASSERT_TRUE(profiler.latest().samples[0].gpu);
+        ASSERT_GE(profiler.latest().samples[0].gpuMs(), 0.0);
+        ASSERT_GE(profiler.latest().gpuMs, 0.0);
+    });
+}
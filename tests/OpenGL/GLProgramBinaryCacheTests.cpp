@@ -0,0 +1,177 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributedin the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "main.hpp"
+#define protected public
+#define private public
+#  include "OpenGL/Shaders/Program.hpp"
+#  include "OpenGL/Shaders/ProgramBinaryCache.hpp"
+#undef protected
+#undef private
+#  include "Common/File.hpp"
+#  include <cstdio>
+
+static const std::string CACHE_DIR("/tmp/OpenGLCppWrapper-tests/cache/");
+
+//--------------------------------------------------------------------------
+TEST(TestGLProgramBinaryCache, TestDirectory)
+{
+    ASSERT_EQ(true, GLProgramBinaryCache::setDirectory(""));
+    ASSERT_EQ(false, GLProgramBinaryCache::enabled());
+    ASSERT_STREQ("", GLProgramBinaryCache::directory().c_str());
+
+    ASSERT_EQ(true, GLProgramBinaryCache::setDirectory("/tmp/OpenGLCppWrapper-tests/cache"));
+    ASSERT_EQ(true, GLProgramBinaryCache::enabled());
+    ASSERT_STREQ(CACHE_DIR.c_str(), GLProgramBinaryCache::directory().c_str());
+    ASSERT_EQ(true, File::exist(CACHE_DIR));
+    ASSERT_STREQ((CACHE_DIR + "0123.bin").c_str(), GLProgramBinaryCache::path("0123").c_str());
+
+    ASSERT_EQ(true, GLProgramBinaryCache::setDirectory(""));
+    ASSERT_EQ(false, GLProgramBinaryCache::enabled());
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLProgramBinaryCache, TestKey)
+{
+    std::string k1 = GLProgramBinaryCache::key({"vertex", "fragment"}, "Mesa\nllvmpipe\n4.5");
+
+    // 64-bit hash in hexadecimal
+    ASSERT_EQ(16_z, k1.size());
+    ASSERT_STREQ(k1.c_str(), GLProgramBinaryCache::key({"vertex", "fragment"}, "Mesa\nllvmpipe\n4.5").c_str());
+
+    // Sources, their order and driver are part of the key
+    ASSERT_STRNE(k1.c_str(), GLProgramBinaryCache::key({"vertex", "fragment2"}, "Mesa\nllvmpipe\n4.5").c_str());
+    ASSERT_STRNE(k1.c_str(), GLProgramBinaryCache::key({"fragment", "vertex"}, "Mesa\nllvmpipe\n4.5").c_str());
+    ASSERT_STRNE(k1.c_str(), GLProgramBinaryCache::key({"vertex", "fragment"}, "Mesa\nllvmpipe\n4.6").c_str());
+    ASSERT_STRNE(GLProgramBinaryCache::key({"ab", "c"}, "").c_str(),
+                 GLProgramBinaryCache::key({"a", "bc"}, "").c_str());
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLProgramBinaryCache, TestReadWrite)
+{
+    ASSERT_EQ(true, GLProgramBinaryCache::setDirectory(CACHE_DIR));
+    std::string file = GLProgramBinaryCache::path("readwrite");
+
+    std::vector<char> binary = { 'a', 'b', '\0', 'c' };
+    std::vector<char> readback;
+    GLenum format = 0u;
+
+    ASSERT_EQ(true, GLProgramBinaryCache::write(file, 42u, binary));
+    ASSERT_EQ(true, GLProgramBinaryCache::read(file, format, readback));
+    ASSERT_EQ(42u, format);
+    ASSERT_EQ(binary, readback);
+
+    // Missing file
+    ASSERT_EQ(false, GLProgramBinaryCache::read(CACHE_DIR + "nothing.bin", format, readback));
+
+    // Empty binary
+    ASSERT_EQ(true, GLProgramBinaryCache::write(file, 42u, {}));
+    ASSERT_EQ(false, GLProgramBinaryCache::read(file, format, readback));
+
+    // Not a binary file
+    {
+        std::ofstream out(file, std::ios::trunc);
+        out << "hello world, this is not a program binary";
+    }
+    ASSERT_EQ(false, GLProgramBinaryCache::read(file, format, readback));
+
+    // Truncated binary file
+    ASSERT_EQ(true, GLProgramBinaryCache::write(file, 42u, binary));
+    ASSERT_EQ(0, truncate(file.c_str(), 17));
+    ASSERT_EQ(false, GLProgramBinaryCache::read(file, format, readback));
+
+    std::remove(file.c_str());
+    GLProgramBinaryCache::setDirectory("");
+}
+
+//--------------------------------------------------------------------------
+// Compile the same program twice: the second link shall be restored from the
+// cache without compiling shaders.
+TEST(TestGLProgramBinaryCache, TestSecondRunLinkTime)
+{
+    OpenGLContext context([]()
+    {
+        if (!GLProgramBinaryCache::supported())
+        {
+            std::cout << "No program binary format supported: skip test" << std::endl;
+            return ;
+        }
+
+        ASSERT_EQ(true, GLProgramBinaryCache::setDirectory(CACHE_DIR));
+
+        std::string key;
+        size_t compilations = 0u;
+        auto link = [&key, &compilations](bool& from_cache)
+        {
+            GLVertexShader vs;
+            GLFragmentShader fs;
+            GLProgram prog("prog");
+
+            vs.path.add("tests/OpenGL/shaders:tests/OpenGL/shaders/include:"
+                        "OpenGL/shaders:OpenGL/shaders/include");
+            fs.path.add("tests/OpenGL/shaders:tests/OpenGL/shaders/include:"
+                        "OpenGL/shaders:OpenGL/shaders/include");
+            EXPECT_EQ(true, vs.read("test5.vs"));
+            EXPECT_EQ(true, fs.read("test5.fs"));
+
+            EXPECT_EQ(true, prog.compile(vs, fs));
+            compilations += size_t(vs.compiled()) + size_t(fs.compiled());
+
+            // Reflection shall be the same whatever the way of linking
+            std::vector<std::string> names;
+            EXPECT_NE(0_z, prog.getUniformNames(names));
+            EXPECT_NE(0_z, prog.getAttributeNames(names));
+
+            from_cache = prog.fromBinaryCache();
+            key = GLProgramBinaryCache::key({ std::to_string(vs.target()), vs.code(),
+                                              std::to_string(fs.target()), fs.code() },
+                                            GLProgramBinaryCache::driver());
+        };
+
+        bool from_cache;
+
+        link(from_cache);
+        if (from_cache)
+        {
+            // Cache from a previous run of this test: make a cold run.
+            std::remove(GLProgramBinaryCache::path(key).c_str());
+            link(from_cache);
+        }
+        ASSERT_EQ(false, from_cache);
+        ASSERT_EQ(2_z, compilations);
+
+        compilations = 0u;
+        link(from_cache);
+        ASSERT_EQ(true, from_cache);
+        ASSERT_EQ(0_z, compilations);
+
+        // A binary rejected by the driver silently falls back on the
+        // compilation from sources.
+        std::vector<char> garbage(64u, 'x');
+        ASSERT_EQ(true, GLProgramBinaryCache::write(GLProgramBinaryCache::path(key), 42u, garbage));
+        link(from_cache);
+        ASSERT_EQ(false, from_cache);
+        ASSERT_EQ(2_z, compilations);
+        ASSERT_EQ(GL_NO_ERROR, glGetError());
+
+        GLProgramBinaryCache::setDirectory("");
+    });
+}
@@ -0,0 +1,338 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "main.hpp"
+#define protected public
+#define private public
+#  include "OpenGL/Buffers/ReadbackQueue.hpp"
+#  include "OpenGL/Textures/Textures.hpp"
+#undef protected
+#undef private
+#  include <chrono>
+#  include <thread>
+
+//--------------------------------------------------------------------------
+//! \brief RGBA texels of a 4x4 texture depending on a seed.
+//--------------------------------------------------------------------------
+static std::vector<unsigned char> texels(size_t const seed)
+{
+    std::vector<unsigned char> pixels(4u * 4u * 4u);
+    for (size_t i = 0u; i < pixels.size(); ++i)
+        pixels[i] = static_cast<unsigned char>(i * 5u + seed * 17u);
+    return pixels;
+}
+
+//--------------------------------------------------------------------------
+//! \brief Specify the texture to OpenGL as when drawing a VAO.
+//--------------------------------------------------------------------------
+static void draw(GLTexture& texture)
+{
+    texture.begin();
+    texture.end();
+}
+
+//--------------------------------------------------------------------------
+//! \brief Poll once per "frame" until no request is pending.
+//! \return the number of frames.
+//--------------------------------------------------------------------------
+static size_t frames(GLReadbackQueue& queue)
+{
+    size_t count = 0u;
+    while ((queue.poll() != 0u) && (count < 1000u))
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        ++count;
+    }
+    return count;
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLReadbackQueue, TestTexture)
+{
+    OpenGLContext context([]()
+    {
+        GLReadbackQueue queue;
+        ASSERT_EQ(size_t(GLReadbackQueue::DEFAULT_COUNT), queue.count());
+        ASSERT_EQ(0_z, queue.pending());
+
+        GLTexture2D texture("tex", 4u, 4u);
+        texture.data() = texels(1u);
+        draw(texture);
+
+        std::vector<unsigned char> received;
+        GLReadbackQueue::Ticket ticket = 0u;
+        GLReadbackQueue::Ticket t = queue.requestReadback(texture,
+            [&](GLReadbackQueue::Ticket const id, const unsigned char* data, size_t const bytes)
+        {
+            ticket = id;
+            received.assign(data, data + bytes);
+        });
+
+        // Non-blocking: the request returns before texels reach the CPU. The
+        // callback is only called by poll().
+        ASSERT_NE(0u, t);
+        ASSERT_EQ(0u, ticket);
+        ASSERT_EQ(true, received.empty());
+        ASSERT_EQ(1_z, queue.pending());
+
+        frames(queue);
+        ASSERT_EQ(0_z, queue.pending());
+        ASSERT_EQ(t, ticket);
+        ASSERT_EQ(texels(1u), received);
+
+        // Texels modified by the GPU are read back
+        texture.data() = texels(2u);
+        draw(texture);
+        received.clear();
+        queue.requestReadback(texture, [&](GLReadbackQueue::Ticket const,
+                                           const unsigned char* data, size_t const bytes)
+        {
+            received.assign(data, data + bytes);
+        });
+        queue.finish();
+        ASSERT_EQ(texels(2u), received);
+        ASSERT_EQ(size_t(GLReadbackQueue::DEFAULT_COUNT), queue.count());
+    });
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLReadbackQueue, TestRead)
+{
+    OpenGLContext context([]()
+    {
+        GLReadbackQueue queue;
+        GLTexture2D a("a", 4u, 4u), b("b", 4u, 4u);
+        a.data() = texels(3u);
+        b.data() = texels(4u);
+        draw(a);
+        draw(b);
+
+        size_t calls = 0u;
+        GLReadbackQueue::Ticket ta = queue.requestReadback(a,
+            [&calls](GLReadbackQueue::Ticket const, const unsigned char*, size_t const)
+        {
+            ++calls;
+        });
+        GLReadbackQueue::Ticket tb = queue.requestReadback(b);
+        ASSERT_LT(ta, tb);
+
+        std::vector<unsigned char> pixels;
+        ASSERT_EQ(false, queue.ready(0u));
+        ASSERT_EQ(false, queue.read(tb + 1u, pixels));
+        while (!queue.ready(tb))
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        ASSERT_EQ(true, queue.read(tb, pixels));
+        ASSERT_EQ(texels(4u), pixels);
+        ASSERT_EQ(false, queue.read(tb, pixels));
+        ASSERT_EQ(0_z, calls);
+
+        // Fetched texels do not call the callback
+        ASSERT_EQ(1_z, queue.pending());
+        ASSERT_EQ(true, queue.read(ta, pixels));
+        ASSERT_EQ(texels(3u), pixels);
+        ASSERT_EQ(0_z, calls);
+        ASSERT_EQ(0_z, queue.pending());
+    });
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLReadbackQueue, TestRingGrows)
+{
+    OpenGLContext context([]()
+    {
+        GLReadbackQueue queue(2u);
+        std::vector<GLReadbackQueue::Ticket> order;
+        std::vector<std::unique_ptr<GLTexture2D>> textures;
+        for (size_t i = 0u; i < 5u; ++i)
+        {
+            textures.push_back(std::make_unique<GLTexture2D>("tex", 4u, 4u));
+            textures.back()->data() = texels(i);
+            draw(*textures.back());
+        }
+
+        // No request waits for a free PBO
+        for (size_t i = 0u; i < 5u; ++i)
+        {
+            queue.requestReadback(*textures[i], [&order, i](GLReadbackQueue::Ticket const t,
+                                                            const unsigned char* data,
+                                                            size_t const bytes)
+            {
+                ASSERT_EQ(texels(i), std::vector<unsigned char>(data, data + bytes));
+                order.push_back(t);
+            });
+        }
+        ASSERT_EQ(5_z, queue.count());
+        ASSERT_EQ(5_z, queue.pending());
+
+        // Delivered in the order of requests
+        queue.finish();
+        ASSERT_EQ(std::vector<GLReadbackQueue::Ticket>({ 1u, 2u, 3u, 4u, 5u }), order);
+
+        // Free PBOs are reused
+        queue.requestReadback(*textures[0]);
+        queue.finish();
+        ASSERT_EQ(5_z, queue.count());
+    });
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLReadbackQueue, TestFrameBuffer)
+{
+    OpenGLContext context([]()
+    {
+        GLReadbackQueue queue;
+        GLFrameBuffer framebuffer("fbo", 8u, 4u, 1u, false);
+        framebuffer.render([]()
+        {
+            glCheck(glClearColor(0.0f, 1.0f, 0.0f, 1.0f));
+            glCheck(glClear(GL_COLOR_BUFFER_BIT));
+        });
+
+        std::vector<unsigned char> received;
+        queue.requestReadback(framebuffer, 0u, [&received](GLReadbackQueue::Ticket const,
+                                                           const unsigned char* data,
+                                                           size_t const bytes)
+        {
+            received.assign(data, data + bytes);
+        });
+        frames(queue);
+
+        ASSERT_EQ(8_z * 4_z * 4_z, received.size());
+        for (size_t i = 0u; i < received.size(); i += 4u)
+        {
+            ASSERT_EQ(0u, received[i]);
+            ASSERT_EQ(255u, received[i + 1u]);
+            ASSERT_EQ(0u, received[i + 2u]);
+            ASSERT_EQ(255u, received[i + 3u]);
+        }
+
+        ASSERT_THROW(queue.requestReadback(framebuffer, 1u), GL::Exception);
+    });
+}
+
+//--------------------------------------------------------------------------
+// Packed types hold the whole pixel.
+TEST(TestGLReadbackQueue, TestPackedTypes)
+{
+    OpenGLContext context([]()
+    {
+        GLReadbackQueue queue;
+        GLFrameBuffer framebuffer("fbo", 8u, 4u, 1u, false);
+        framebuffer.render([]()
+        {
+            glCheck(glClearColor(0.0f, 1.0f, 0.0f, 1.0f));
+            glCheck(glClear(GL_COLOR_BUFFER_BIT));
+        });
+
+        std::vector<unsigned char> received;
+        auto callback = [&received](GLReadbackQueue::Ticket const,
+                                    const unsigned char* data, size_t const bytes)
+        {
+            received.assign(data, data + bytes);
+        };
+
+        queue.requestReadback(framebuffer, 0u, callback, GL_RGB, GL_UNSIGNED_SHORT_5_6_5);
+        frames(queue);
+        ASSERT_EQ(8_z * 4_z * 2_z, received.size());
+        uint16_t pixel;
+        memcpy(&pixel, &received[received.size() - 2u], 2u);
+        ASSERT_EQ(0x07E0u, pixel);
+
+        queue.requestReadback(framebuffer, 0u, callback, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8);
+        frames(queue);
+        ASSERT_EQ(8_z * 4_z * 4_z, received.size());
+        uint32_t rgba;
+        memcpy(&rgba, &received[received.size() - 4u], 4u);
+        ASSERT_EQ(0x00FF00FFu, rgba);
+    });
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLReadbackQueue, TestErrors)
+{
+    OpenGLContext context([]()
+    {
+        GLReadbackQueue queue;
+        GLTexture2D texture("tex", 4u, 4u);
+        texture.data() = texels(0u);
+        ASSERT_THROW(queue.requestReadback(texture), GL::Exception);
+
+        GLFrameBuffer framebuffer("fbo", 4u, 4u);
+        ASSERT_THROW(queue.requestReadback(framebuffer), GL::Exception);
+
+        GLTextureCube cube("cube");
+        cube.m_need_create = cube.m_need_setup = false;
+        ASSERT_THROW(queue.requestReadback(cube), GL::Exception);
+        ASSERT_EQ(0_z, queue.pending());
+    });
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLReadbackQueue, TestPackAlignment)
+{
+    OpenGLContext context([]()
+    {
+        GLReadbackQueue queue;
+        GLTexture2D texture("tex", 4u, 4u);
+        texture.data() = texels(1u);
+        draw(texture);
+
+        // The pixel store state of the application is restored
+        GLint alignment = 0;
+        glCheck(glPixelStorei(GL_PACK_ALIGNMENT, 8));
+        queue.requestReadback(texture);
+        glCheck(glGetIntegerv(GL_PACK_ALIGNMENT, &alignment));
+        ASSERT_EQ(8, alignment);
+        queue.finish();
+        glCheck(glPixelStorei(GL_PACK_ALIGNMENT, 4));
+    });
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLReadbackQueue, TestWaitFailed)
+{
+    OpenGLContext context([]()
+    {
+        GLReadbackQueue queue;
+        GLTexture2D texture("tex", 4u, 4u);
+        texture.data() = texels(1u);
+        draw(texture);
+
+        bool called = false;
+        GLReadbackQueue::Ticket t = queue.requestReadback(texture,
+            [&](GLReadbackQueue::Ticket const, const unsigned char*, size_t const)
+        {
+            called = true;
+        });
+        GLReadbackQueue::Ticket u = queue.requestReadback(texture);
+
+        // Invalid fence: glClientWaitSync() returns GL_WAIT_FAILED. finish()
+        // drops the request instead of waiting forever and delivers the
+        // next ones.
+        GLReadbackQueue::Slot* slot = queue.find(t);
+        ASSERT_NE(nullptr, slot);
+        glCheck(glDeleteSync(slot->fence));
+        slot->fence = nullptr;
+        queue.finish();
+        ASSERT_EQ(0_z, queue.pending());
+        ASSERT_EQ(false, called);
+        ASSERT_EQ(nullptr, queue.find(u));
+    });
+}
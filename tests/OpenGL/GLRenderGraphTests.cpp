@@ -0,0 +1,299 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "main.hpp"
+#define protected public
+#define private public
+#  include "OpenGL/Buffers/RenderGraph.hpp"
+#undef protected
+#undef private
+#  include <array>
+
+using Resource = GLRenderGraph::Resource;
+static const GLRenderTargetPool::Desc COLOR({ 16u, 8u, GL_RGBA8, 0 });
+static const GLRenderTargetPool::Desc DEPTH({ 16u, 8u, GL_DEPTH_COMPONENT24, 0 });
+
+//--------------------------------------------------------------------------
+//! \brief Return the names of the scheduled passes.
+//--------------------------------------------------------------------------
+static std::vector<std::string> order(GLRenderGraph const& graph)
+{
+    std::vector<std::string> names;
+    for (auto const& it: graph.schedule())
+    {
+        names.push_back(graph.pass(it.pass).name());
+    }
+    return names;
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLRenderGraph, TestSort)
+{
+    GLRenderTargetPool pool;
+    GLRenderGraph graph(pool);
+    Resource scene = graph.create("scene", COLOR);
+    Resource bright = graph.create("bright", COLOR);
+    Resource bloom = graph.create("bloom", COLOR);
+
+    // Declared in reverse order
+    graph.addPass("compose").read(scene).read(bloom).screen();
+    graph.addPass("bloom").read(bright).write(bloom);
+    graph.addPass("bright").read(scene).write(bright);
+    graph.addPass("scene").write(scene);
+
+    graph.compile();
+    ASSERT_THAT(order(graph), ElementsAre("scene", "bright", "bloom", "compose"));
+
+    // Independent passes keep the order of declaration
+    graph.clear();
+    Resource a = graph.create("a", COLOR);
+    Resource b = graph.create("b", COLOR);
+    graph.addPass("B").write(b);
+    graph.addPass("A").write(a);
+    graph.addPass("screen").read(a).read(b).screen();
+    graph.compile();
+    ASSERT_THAT(order(graph), ElementsAre("B", "A", "screen"));
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLRenderGraph, TestCulling)
+{
+    GLRenderTargetPool pool;
+    GLRenderGraph graph(pool);
+    Resource scene = graph.create("scene", COLOR);
+    Resource depth = graph.create("depth", DEPTH);
+    Resource debug = graph.create("debug", COLOR);
+    Resource ssao = graph.create("ssao", COLOR);
+    Resource picking = graph.create("picking", COLOR);
+
+    graph.addPass("scene").write(scene).write(depth);
+    graph.addPass("ssao").read(depth).write(ssao);
+    graph.addPass("debug").read(ssao).write(debug);
+    graph.addPass("picking").read(depth).write(picking);
+    graph.addPass("screen").read(scene).screen();
+
+    // Nothing reaches the screen from ssao, debug and picking
+    graph.compile();
+    ASSERT_THAT(order(graph), ElementsAre("scene", "screen"));
+    ASSERT_FALSE(graph.pass(0u).culled());
+    ASSERT_TRUE(graph.pass(1u).culled());
+    ASSERT_TRUE(graph.pass(2u).culled());
+    ASSERT_TRUE(graph.pass(3u).culled());
+    ASSERT_EQ(graph.slot(ssao), GLRenderGraph::NONE);
+    ASSERT_EQ(graph.slot(debug), GLRenderGraph::NONE);
+
+    // Outputs keep their producers
+    graph.output(picking);
+    graph.compile();
+    ASSERT_THAT(order(graph), ElementsAre("scene", "picking", "screen"));
+    ASSERT_TRUE(graph.pass(1u).culled());
+
+    // A graph without screen pass nor output renders nothing
+    graph.clear();
+    scene = graph.create("scene", COLOR);
+    graph.addPass("scene").write(scene);
+    graph.compile();
+    ASSERT_TRUE(graph.schedule().empty());
+    ASSERT_EQ(graph.slots(), 0_z);
+}
+
+//--------------------------------------------------------------------------
+//! \brief A scene pass followed by five post-processing passes: colors
+//! ping-pong between two storages.
+//--------------------------------------------------------------------------
+TEST(TestGLRenderGraph, TestAliasing)
+{
+    GLRenderTargetPool pool;
+    GLRenderGraph graph(pool);
+    std::vector<Resource> colors;
+    for (size_t i = 0u; i < 6u; ++i)
+    {
+        colors.push_back(graph.create("color" + std::to_string(i), COLOR));
+    }
+    Resource depth = graph.create("depth", DEPTH);
+
+    graph.addPass("scene").write(colors[0]).write(depth);
+    for (size_t i = 1u; i < 6u; ++i)
+    {
+        graph.addPass("post" + std::to_string(i)).read(colors[i - 1u]).write(colors[i]);
+    }
+    graph.addPass("screen").read(colors[5]).screen();
+    graph.compile();
+
+    ASSERT_EQ(graph.schedule().size(), 7_z);
+    ASSERT_EQ(graph.slots(), 3_z);
+    for (size_t i = 0u; i < 6u; ++i)
+    {
+        ASSERT_EQ(graph.slot(colors[i]), (i & 1u) ? 2_z : 0_z);
+    }
+    ASSERT_EQ(graph.slot(depth), 1_z);
+
+    // Depth is never read: discarded after the scene pass. Colors are
+    // discarded by the pass reading them.
+    auto const& schedule = graph.schedule();
+    ASSERT_THAT(schedule[0].acquire, ElementsAre(colors[0], depth));
+    ASSERT_THAT(schedule[0].invalidate, ElementsAre(depth));
+    for (size_t i = 1u; i < 6u; ++i)
+    {
+        ASSERT_THAT(schedule[i].acquire, ElementsAre(colors[i]));
+        ASSERT_THAT(schedule[i].invalidate, ElementsAre(colors[i - 1u]));
+    }
+    ASSERT_TRUE(schedule[6].acquire.empty());
+    ASSERT_THAT(schedule[6].invalidate, ElementsAre(colors[5]));
+
+    // Different descriptions never share storages. Outputs are never
+    // reused.
+    graph.clear();
+    Resource a = graph.create("a", COLOR);
+    Resource b = graph.create("b", { 16u, 8u, GL_RGBA16F, 0 });
+    Resource c = graph.create("c", COLOR);
+    Resource d = graph.create("d", COLOR);
+    graph.addPass("A").write(a);
+    graph.addPass("B").read(a).write(b);
+    graph.addPass("C").read(b).write(c);
+    graph.addPass("D").read(c).write(d);
+    graph.output(d);
+    graph.compile();
+    ASSERT_EQ(graph.slot(a), 0_z);
+    ASSERT_EQ(graph.slot(b), 1_z);
+    ASSERT_EQ(graph.slot(c), 0_z);
+    ASSERT_EQ(graph.slot(d), 2_z);
+    ASSERT_TRUE(graph.schedule()[3].invalidate == std::vector<Resource>{ c });
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLRenderGraph, TestErrors)
+{
+    GLRenderTargetPool pool;
+    GLRenderGraph graph(pool);
+    Resource a = graph.create("a", COLOR);
+    Resource b = graph.create("b", COLOR);
+    Resource depth1 = graph.create("depth1", DEPTH);
+    Resource depth2 = graph.create("depth2", DEPTH);
+
+    ASSERT_THROW(graph.addPass("unknown").read(42u), GL::Exception);
+    ASSERT_THROW(graph.output(42u), GL::Exception);
+    ASSERT_THROW(graph.addPass("feedback").write(a).read(a), GL::Exception);
+    ASSERT_THROW(graph.addPass("twice").write(a), GL::Exception);
+    ASSERT_THROW(graph.addPass("depths").write(depth1).write(depth2), GL::Exception);
+    ASSERT_THROW(graph.target(a), GL::Exception);
+
+    // Read but never written
+    graph.clear();
+    a = graph.create("a", COLOR);
+    b = graph.create("b", COLOR);
+    graph.addPass("screen").read(a).screen();
+    ASSERT_THROW(graph.compile(), GL::Exception);
+
+    // Cycle
+    graph.clear();
+    a = graph.create("a", COLOR);
+    b = graph.create("b", COLOR);
+    graph.addPass("A").read(b).write(a);
+    graph.addPass("B").read(a).write(b);
+    graph.addPass("screen").read(a).screen();
+    ASSERT_THROW(graph.compile(), GL::Exception);
+    ASSERT_TRUE(graph.schedule().empty());
+
+    // Screen and resources
+    graph.clear();
+    a = graph.create("a", COLOR);
+    graph.addPass("A").write(a).screen();
+    ASSERT_THROW(graph.compile(), GL::Exception);
+}
+
+//--------------------------------------------------------------------------
+//! \brief Render a graph with llvmpipe: culled passes are not executed and
+//! reads see what previous passes have written.
+//--------------------------------------------------------------------------
+TEST(TestGLRenderGraph, TestRender)
+{
+    OpenGLContext context([]()
+    {
+        GLRenderTargetPool pool;
+        GLRenderGraph graph(pool);
+        Resource scene = graph.create("scene", COLOR);
+        Resource depth = graph.create("depth", DEPTH);
+        Resource copy = graph.create("copy", COLOR);
+        Resource unused = graph.create("unused", COLOR);
+        Resource result = graph.create("result", COLOR);
+        size_t culled = 0u;
+        size_t screen = 0u;
+
+        graph.addPass("scene").write(scene).write(depth).execute([](GLRenderGraph&)
+        {
+            glCheck(glClearColor(1.0f, 0.0f, 0.0f, 1.0f));
+            glCheck(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+        });
+        graph.addPass("unused").read(scene).write(unused).execute([&culled](GLRenderGraph&)
+        {
+            ++culled;
+        });
+        // Copy the red channel of the scene into the green channel
+        graph.addPass("copy").read(scene).write(copy).execute([scene](GLRenderGraph& g)
+        {
+            std::array<unsigned char, 16u * 8u * 4u> texels;
+            glCheck(glBindTexture(GL_TEXTURE_2D, g.texture(scene).handle()));
+            glCheck(glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, texels.data()));
+            glCheck(glBindTexture(GL_TEXTURE_2D, 0u));
+            glCheck(glClearColor(0.0f, texels[0] / 255.0f, 0.0f, 1.0f));
+            glCheck(glClear(GL_COLOR_BUFFER_BIT));
+        });
+        // Keep the green channel of the copy and set blue
+        graph.addPass("result").read(copy).write(result).execute([copy](GLRenderGraph& g)
+        {
+            std::array<unsigned char, 16u * 8u * 4u> texels;
+            glCheck(glBindTexture(GL_TEXTURE_2D, g.texture(copy).handle()));
+            glCheck(glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, texels.data()));
+            glCheck(glBindTexture(GL_TEXTURE_2D, 0u));
+            glCheck(glClearColor(0.0f, texels[1] / 255.0f, 1.0f, 1.0f));
+            glCheck(glClear(GL_COLOR_BUFFER_BIT));
+        });
+        graph.addPass("screen").read(copy).screen().execute([&screen](GLRenderGraph&)
+        {
+            GLint fbo = -1;
+            glCheck(glGetIntegerv(GL_FRAMEBUFFER_BINDING, &fbo));
+            ASSERT_EQ(fbo, 0);
+            ++screen;
+        });
+        graph.output(result);
+
+        for (size_t frame = 1u; frame <= 2u; ++frame)
+        {
+            graph.execute();
+            ASSERT_EQ(culled, 0_z);
+            ASSERT_EQ(screen, frame);
+            ASSERT_EQ(pool.count(), graph.slots());
+
+            // Only outputs survive the frame
+            ASSERT_THROW(graph.target(scene), GL::Exception);
+            std::array<unsigned char, 16u * 8u * 4u> texels;
+            glCheck(glBindTexture(GL_TEXTURE_2D, graph.texture(result).handle()));
+            glCheck(glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, texels.data()));
+            glCheck(glBindTexture(GL_TEXTURE_2D, 0u));
+            ASSERT_EQ(texels[0], 0u);
+            ASSERT_EQ(texels[1], 255u);
+            ASSERT_EQ(texels[2], 255u);
+            ASSERT_EQ(glGetError(), GLenum(GL_NO_ERROR));
+
+            pool.frame();
+        }
+    });
+}
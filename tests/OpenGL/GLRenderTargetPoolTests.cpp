@@ -0,0 +1,327 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "main.hpp"
+#define protected public
+#define private public
+#  include "OpenGL/Buffers/RenderTargetPool.hpp"
+#  include "OpenGL/Buffers/GPUMemory.hpp"
+#undef protected
+#undef private
+#  include <array>
+
+using Desc = GLRenderTargetPool::Desc;
+
+//--------------------------------------------------------------------------
+//! \brief Render a frame of a post-processing chain: a scene pass (color and
+//! depth) followed by the given number of full screen passes, each reading
+//! the output of the previous one.
+//--------------------------------------------------------------------------
+static void postProcessChain(GLRenderTargetPool& pool, size_t const passes,
+                             uint32_t const width, uint32_t const height)
+{
+    GLRenderTargetPool::Target* input = &pool.acquire({ width, height, GL_RGBA16F });
+    GLRenderTargetPool::Target& depth = pool.acquire({ width, height, GL_DEPTH_COMPONENT24 });
+    pool.framebuffer({ input }, &depth);
+    pool.release(depth);
+
+    for (size_t i = 0u; i < passes; ++i)
+    {
+        GLRenderTargetPool::Target& output = pool.acquire({ width, height, GL_RGBA16F });
+        pool.framebuffer({ &output });
+        pool.release(*input);
+        input = &output;
+    }
+
+    pool.release(*input);
+    pool.frame();
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLRenderTargetPool, TestDesc)
+{
+    ASSERT_EQ(Desc({ 4u, 2u, GL_RGBA8, 0 }).bytes(), 32_z);
+    ASSERT_EQ(Desc({ 4u, 2u, GL_RGBA16F, 0 }).bytes(), 64_z);
+    ASSERT_EQ(Desc({ 4u, 2u, GL_RGBA32F, 0 }).bytes(), 128_z);
+    ASSERT_EQ(Desc({ 4u, 2u, GL_R8, 0 }).bytes(), 8_z);
+    ASSERT_EQ(Desc({ 4u, 2u, GL_RGBA8, 4 }).bytes(), 128_z);
+    ASSERT_EQ(Desc({ 4u, 2u, GL_DEPTH24_STENCIL8, 0 }).bytes(), 32_z);
+
+    ASSERT_TRUE(Desc({ 1u, 1u, GL_DEPTH_COMPONENT24, 0 }).depth());
+    ASSERT_TRUE(Desc({ 1u, 1u, GL_DEPTH32F_STENCIL8, 0 }).depth());
+    ASSERT_FALSE(Desc({ 1u, 1u, GL_RGBA8, 0 }).depth());
+
+    ASSERT_TRUE(Desc({ 4u, 2u, GL_RGBA8, 0 }) == Desc({ 4u, 2u, GL_RGBA8, 0 }));
+    ASSERT_FALSE(Desc({ 4u, 2u, GL_RGBA8, 0 }) == Desc({ 2u, 4u, GL_RGBA8, 0 }));
+    ASSERT_FALSE(Desc({ 4u, 2u, GL_RGBA8, 0 }) == Desc({ 4u, 2u, GL_RGBA8, 2 }));
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLRenderTargetPool, TestTargetKinds)
+{
+    GLRenderTargetPool pool;
+
+    // Single-sample colors are textures
+    auto& color = pool.acquire({ 8u, 8u, GL_RGBA8 });
+    ASSERT_TRUE(color.sampleable());
+    ASSERT_EQ(color.texture().m_gpuPixelFormat, GLint(GL_RGBA8));
+    ASSERT_EQ(color.texture().m_width, 8_z);
+    ASSERT_EQ(color.texture().m_options.wrapS, GLTexture::Wrap::CLAMP_TO_EDGE);
+
+    // Depth and multisampled targets are render buffers
+    auto& depth = pool.acquire({ 8u, 8u, GL_DEPTH24_STENCIL8 });
+    ASSERT_FALSE(depth.sampleable());
+    ASSERT_THROW(depth.texture(), GL::Exception);
+    ASSERT_EQ(depth.buffer().m_attachment, GLenum(GL_DEPTH_STENCIL_ATTACHMENT));
+
+    auto& msaa = pool.acquire({ 8u, 8u, GL_RGBA8, 4 });
+    ASSERT_FALSE(msaa.sampleable());
+    ASSERT_EQ(msaa.buffer().samples(), 4);
+    ASSERT_EQ(msaa.buffer().format(), GLenum(GL_RGBA8));
+
+    ASSERT_THROW(pool.acquire({ 0u, 8u, GL_RGBA8 }), GL::Exception);
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLRenderTargetPool, TestRecycle)
+{
+    size_t const memory = GPUMemory();
+    {
+        GLRenderTargetPool pool;
+        Desc const desc({ 16u, 8u, GL_RGBA8, 0 });
+
+        // Acquired targets are never shared
+        auto& a = pool.acquire(desc);
+        auto& b = pool.acquire(desc);
+        ASSERT_NE(&a, &b);
+        ASSERT_EQ(pool.count(), 2_z);
+        ASSERT_EQ(pool.used(), 2_z);
+        ASSERT_EQ(pool.bytes(), 2_z * desc.bytes());
+        ASSERT_EQ(GPUMemory(), memory + pool.bytes());
+
+        // Released targets are handed out again to the same description
+        pool.release(a);
+        ASSERT_EQ(pool.used(), 1_z);
+        ASSERT_EQ(&pool.acquire(desc), &a);
+        ASSERT_EQ(pool.count(), 2_z);
+
+        // but not to others
+        pool.release(a);
+        auto& c = pool.acquire({ 16u, 8u, GL_RGBA16F });
+        ASSERT_NE(&c, &a);
+        auto& d = pool.acquire({ 8u, 16u, GL_RGBA8 });
+        ASSERT_NE(&d, &a);
+        ASSERT_EQ(pool.count(), 4_z);
+        ASSERT_EQ(pool.used(), 3_z);
+
+        // The end of the frame releases everything
+        pool.frame();
+        ASSERT_EQ(pool.used(), 0_z);
+        ASSERT_EQ(pool.count(), 4_z);
+    }
+    ASSERT_EQ(GPUMemory(), memory);
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLRenderTargetPool, TestIdleTargets)
+{
+    GLRenderTargetPool pool(2u);
+
+    // Window resized: targets of the old size are no longer acquired
+    postProcessChain(pool, 2u, 64u, 32u);
+    ASSERT_EQ(pool.count(), 3_z);
+    ASSERT_EQ(pool.framebuffers(), 3_z);
+
+    postProcessChain(pool, 2u, 128u, 64u);
+    ASSERT_EQ(pool.count(), 6_z);
+    ASSERT_EQ(pool.framebuffers(), 6_z);
+
+    // Destroyed after 2 idle frames, with their framebuffers
+    postProcessChain(pool, 2u, 128u, 64u);
+    ASSERT_EQ(pool.count(), 3_z);
+    ASSERT_EQ(pool.bytes(), 2_z * Desc({ 128u, 64u, GL_RGBA16F, 0 }).bytes()
+              + Desc({ 128u, 64u, GL_DEPTH_COMPONENT24, 0 }).bytes());
+    for (auto const& it: pool.m_framebuffers)
+    {
+        ASSERT_EQ(it.second->width(), 128u);
+    }
+
+    pool.clear();
+    ASSERT_EQ(pool.count(), 0_z);
+    ASSERT_EQ(pool.framebuffers(), 0_z);
+    ASSERT_EQ(pool.bytes(), 0_z);
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLRenderTargetPool, TestFramebuffers)
+{
+    GLRenderTargetPool pool;
+    auto& a = pool.acquire({ 8u, 8u, GL_RGBA8 });
+    auto& b = pool.acquire({ 8u, 8u, GL_RGBA16F });
+    auto& depth = pool.acquire({ 8u, 8u, GL_DEPTH_COMPONENT24 });
+
+    // Cached by set of targets
+    GLFrameBuffer& fbo = pool.framebuffer({ &a, &b }, &depth);
+    ASSERT_EQ(&fbo, &pool.framebuffer({ &a, &b }, &depth));
+    ASSERT_NE(&fbo, &pool.framebuffer({ &b, &a }, &depth));
+    ASSERT_NE(&fbo, &pool.framebuffer({ &a, &b }));
+    ASSERT_EQ(pool.framebuffers(), 3_z);
+
+    ASSERT_EQ(fbo.width(), 8u);
+    ASSERT_EQ(fbo.height(), 8u);
+    ASSERT_EQ(fbo.m_color_buffers.size(), 2_z);
+    ASSERT_EQ(fbo.m_color_buffers[0], &a.buffer());
+    ASSERT_EQ(fbo.m_depth_buffer, &depth.buffer());
+    ASSERT_TRUE(fbo.m_owned_buffers.empty());
+
+    // Misuses
+    auto& small = pool.acquire({ 4u, 4u, GL_RGBA8 });
+    auto& msaa = pool.acquire({ 8u, 8u, GL_RGBA8, 4 });
+    ASSERT_THROW(pool.framebuffer({}), GL::Exception);
+    ASSERT_THROW(pool.framebuffer({ &a, &small }), GL::Exception);
+    ASSERT_THROW(pool.framebuffer({ &msaa }, &depth), GL::Exception);
+    ASSERT_THROW(pool.framebuffer({ &depth }), GL::Exception);
+    ASSERT_THROW(pool.framebuffer({ &a }, &b), GL::Exception);
+    ASSERT_EQ(pool.framebuffers(), 3_z);
+}
+
+//--------------------------------------------------------------------------
+//! \brief Compare the memory of a 6-pass chain with one GLFrameBuffer (a
+//! color and a depth buffer) per pass.
+//--------------------------------------------------------------------------
+TEST(TestGLRenderTargetPool, TestPostProcessMemory)
+{
+    constexpr uint32_t width = 1920u;
+    constexpr uint32_t height = 1080u;
+    constexpr size_t passes = 6u;
+
+    GLRenderTargetPool pool;
+    for (size_t frame = 0u; frame < 4u; ++frame)
+    {
+        postProcessChain(pool, passes - 1u, width, height);
+
+        // Ping-pong between two colors
+        ASSERT_EQ(pool.count(), 3_z);
+        ASSERT_EQ(pool.used(), 0_z);
+    }
+
+    size_t const baseline = passes * (Desc({ width, height, GL_RGBA16F, 0 }).bytes() +
+                                      Desc({ width, height, GL_DEPTH_COMPONENT24, 0 }).bytes());
+    size_t const pooled = pool.bytes();
+    ASSERT_LT(pooled * 3_z, baseline);
+}
+
+//--------------------------------------------------------------------------
+//! \brief Render through pooled framebuffers.
+//--------------------------------------------------------------------------
+TEST(TestGLRenderTargetPool, TestRender)
+{
+    OpenGLContext context([]()
+    {
+        GLRenderTargetPool pool;
+
+        // Two color attachments cleared to different colors, and a depth
+        // stencil buffer
+        auto& a = pool.acquire({ 4u, 4u, GL_RGBA8 });
+        auto& b = pool.acquire({ 4u, 4u, GL_RGBA8 });
+        auto& depth = pool.acquire({ 4u, 4u, GL_DEPTH24_STENCIL8 });
+        pool.framebuffer({ &a, &b }, &depth).render([]()
+        {
+            GLfloat const red[4] = { 1.0f, 0.0f, 0.0f, 1.0f };
+            GLfloat const green[4] = { 0.0f, 1.0f, 0.0f, 1.0f };
+            glCheck(glClearBufferfv(GL_COLOR, 0, red));
+            glCheck(glClearBufferfv(GL_COLOR, 1, green));
+            glCheck(glClearBufferfi(GL_DEPTH_STENCIL, 0, 1.0f, 0));
+        });
+        pool.release(depth);
+
+        // Later pass sharing b at another attachment point, and a depth-only
+        // pass
+        pool.release(a);
+        auto& c = pool.acquire({ 4u, 4u, GL_RGBA8 });
+        ASSERT_EQ(&c, &a);
+        pool.framebuffer({ &b }).render([]()
+        {
+            GLfloat const blue[4] = { 0.0f, 0.0f, 1.0f, 1.0f };
+            glCheck(glClearBufferfv(GL_COLOR, 0, blue));
+        });
+        pool.framebuffer({}, &depth).render([]()
+        {
+            glCheck(glClear(GL_DEPTH_BUFFER_BIT));
+        });
+        auto& msaa = pool.acquire({ 4u, 4u, GL_RGBA8, 4 });
+        auto& msaa_depth = pool.acquire({ 4u, 4u, GL_DEPTH_COMPONENT24, 4 });
+        pool.framebuffer({ &msaa }, &msaa_depth).render([]()
+        {
+            glCheck(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+        });
+
+        std::array<unsigned char, 4u * 4u * 4u> texels;
+        glCheck(glBindTexture(GL_TEXTURE_2D, a.texture().handle()));
+        glCheck(glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, texels.data()));
+        ASSERT_EQ(texels[0], 255u);
+        ASSERT_EQ(texels[1], 0u);
+        glCheck(glBindTexture(GL_TEXTURE_2D, b.texture().handle()));
+        glCheck(glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, texels.data()));
+        ASSERT_EQ(texels[1], 0u);
+        ASSERT_EQ(texels[2], 255u);
+        glCheck(glBindTexture(GL_TEXTURE_2D, 0u));
+
+        pool.frame();
+        ASSERT_EQ(pool.framebuffers(), 4_z);
+    });
+}
+
+//--------------------------------------------------------------------------
+//! \brief The attachment point of a shared target belongs to each framebuffer.
+//--------------------------------------------------------------------------
+TEST(TestGLRenderTargetPool, TestSharedAttachment)
+{
+    OpenGLContext context([]()
+    {
+        GLRenderTargetPool pool;
+
+        auto& a = pool.acquire({ 4u, 4u, GL_RGBA8 });
+        auto& b = pool.acquire({ 4u, 4u, GL_RGBA8 });
+        GLFrameBuffer& first = pool.framebuffer({ &a });
+        GLFrameBuffer& second = pool.framebuffer({ &b, &a });
+        first.begin(); first.end();
+        second.begin(); second.end();
+
+        // Pooled buffers are not modified by framebuffers
+        ASSERT_EQ(a.buffer().attachment(), GLenum(GL_COLOR_ATTACHMENT0));
+        ASSERT_EQ(b.buffer().attachment(), GLenum(GL_COLOR_ATTACHMENT0));
+        ASSERT_EQ(first.attachmentOf(a.buffer()), GLenum(GL_COLOR_ATTACHMENT0));
+        ASSERT_EQ(second.attachmentOf(a.buffer()), GLenum(GL_COLOR_ATTACHMENT1));
+
+        GLint name = 0;
+        glCheck(glBindFramebuffer(GL_FRAMEBUFFER, second.handle()));
+        glCheck(glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1,
+                                                      GL_FRAMEBUFFER_ATTACHMENT_OBJECT_NAME,
+                                                      &name));
+        ASSERT_EQ(GLuint(name), a.texture().handle());
+        glCheck(glBindFramebuffer(GL_FRAMEBUFFER, first.handle()));
+        glCheck(glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                                      GL_FRAMEBUFFER_ATTACHMENT_OBJECT_NAME,
+                                                      &name));
+        ASSERT_EQ(GLuint(name), a.texture().handle());
+        glCheck(glBindFramebuffer(GL_FRAMEBUFFER, 0u));
+    });
+}
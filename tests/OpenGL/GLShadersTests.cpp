@@ -25,6 +25,10 @@
 #  include "OpenGL/Shaders/Shaders.hpp"
 #undef protected
 #undef private
+#include "Common/File.hpp"
+#include <regex>
+#include <list>
+#include <thread>
 
 using namespace glwrap;
 
@@ -204,9 +208,19 @@ TEST(TestGLShaders, solveIncludes1)
         shader.path.add("tests/OpenGL/shaders:tests/OpenGL/shaders/include:"
                         "OpenGL/shaders:OpenGL/shaders/include");
         ASSERT_EQ(true, shader.read("test1.txt"));
-        // Ignore already included files
+        // Ignore already included files (file3.txt includes file2.txt which
+        // is a cycle). #line directives refer to included files.
         ASSERT_EQ(true, shader.solveIncludes());
-        ASSERT_STREQ("\nhello\n", shader.code().c_str());
+        ASSERT_STREQ("#line 1 1\n"
+                     "#line 1 2\n"
+                     "\n"
+                     "#line 2 1\n"
+                     "#line 2 0\n"
+                     "\nhello\n", shader.code().c_str());
+        ASSERT_EQ(3_z, shader.includedFiles().size());
+        ASSERT_STREQ("tests/OpenGL/shaders/test1.txt", shader.includedFiles()[0].c_str());
+        ASSERT_STREQ("tests/OpenGL/shaders/include/file2.txt", shader.includedFiles()[1].c_str());
+        ASSERT_STREQ("tests/OpenGL/shaders/include/file3.txt", shader.includedFiles()[2].c_str());
         ASSERT_STREQ("", shader.strerror().c_str());
     });
 }
@@ -222,7 +236,14 @@ TEST(TestGLShaders, solveIncludes2)
         ASSERT_EQ(true, shader.read("test3.txt"));
         // Ignore already included files
         ASSERT_EQ(true, shader.solveIncludes());
-        ASSERT_STREQ("\n fooo bar\nhello\n", shader.code().c_str());
+        // Characters after the included file are kept on their own line
+        ASSERT_STREQ("#line 1 1\n"
+                     "#line 1 2\n"
+                     "\n"
+                     "#line 2 1\n"
+                     "#line 1 0\n"
+                     " fooo bar\n"
+                     "\nhello\n", shader.code().c_str());
         ASSERT_STREQ("", shader.strerror().c_str());
     });
 }
@@ -240,6 +261,7 @@ TEST(TestGLShaders, solveIncludes3)
         ASSERT_STREQ("#version 330 core\n"
                      "layout (location = 0) in vec3 position;\n\n"
                      "// Include other files\n"
+                     "#line 1 1\n"
                      "vec3 doFancyCalculationA()\n"
                      "{\n"
                      "    return vec3(1.0, 0.0, 1.0);\n"
@@ -252,9 +274,12 @@ TEST(TestGLShaders, solveIncludes3)
                      "{\n"
                      "    return vec3(0.0, 0.0, 1.0);\n"
                      "}\n"
+                     "#line 6 0\n"
+                     "#line 1 2\n"
                      "uniform vec3 offsetA;\n"
                      "uniform vec3 offsetB;\n"
-                     "uniform vec3 offsetC;\n\n"
+                     "uniform vec3 offsetC;\n"
+                     "#line 7 0\n\n"
                      "void main()\n"
                      "{\n"
                      "    position += doFancyCalculationA() * offsetA;\n"
@@ -349,3 +374,328 @@ TEST(TestGLShaders, testFailedCompilation2)
         ASSERT_EQ(false, shader.m_need_update);
     });
 }
+
+//--------------------------------------------------------------------------
+//! \brief Write a shader file used by tests.
+//--------------------------------------------------------------------------
+static void writeFile(std::string const& file, std::string const& code)
+{
+    std::ofstream out(file, std::ios::trunc);
+    out << code;
+}
+
+TEST(TestGLShaders, solveIncludesCycle)
+{
+    // No OpenGL context
+    {
+        const std::string dir("/tmp/OpenGLCppWrapper-tests/include/");
+        ASSERT_EQ(true, File::mkdir(dir));
+        writeFile(dir + "cycle_a.glsl", "a1\n#include cycle_b.glsl\na3\n");
+        writeFile(dir + "cycle_b.glsl", "b1\n#include cycle_a.glsl\nb3\n");
+        GLShader::clearIncludeCache();
+
+        GLVertexShader shader;
+        shader.path.add(dir);
+        ASSERT_EQ(true, shader.read("cycle_a.glsl"));
+        ASSERT_EQ(true, shader.solveIncludes());
+        ASSERT_STREQ("a1\n"
+                     "#line 1 1\n"
+                     "b1\n"
+                     "\n"
+                     "b3\n"
+                     "#line 3 0\n"
+                     "a3\n", shader.code().c_str());
+
+        // Missing included file
+        GLVertexShader missing;
+        missing.path.add(dir);
+        missing = "#include does_not_exist.glsl\n";
+        ASSERT_EQ(false, missing.solveIncludes());
+        ASSERT_STRNE("", missing.strerror().c_str());
+    }
+}
+
+TEST(TestGLShaders, solveIncludesCache)
+{
+    // No OpenGL context
+    {
+        const std::string dir("/tmp/OpenGLCppWrapper-tests/include/");
+        ASSERT_EQ(true, File::mkdir(dir));
+        writeFile(dir + "cache_root.glsl", "#include cache_inc.glsl\nmain\n");
+        writeFile(dir + "cache_inc.glsl", "old\n");
+        GLShader::clearIncludeCache();
+
+        GLVertexShader s1;
+        s1.path.add(dir);
+        ASSERT_EQ(true, s1.read("cache_root.glsl"));
+        ASSERT_EQ(true, s1.solveIncludes());
+        ASSERT_STREQ("#line 1 1\nold\n#line 2 0\nmain\n", s1.code().c_str());
+
+        // Solving twice is idempotent
+        ASSERT_EQ(true, s1.solveIncludes());
+        ASSERT_STREQ("#line 1 1\nold\n#line 2 0\nmain\n", s1.code().c_str());
+        ASSERT_EQ(2_z, s1.includedFiles().size());
+
+        // Included files are cached per process: modifying them on the disk
+        // has no effect until the cache is cleared.
+        writeFile(dir + "cache_inc.glsl", "new\n");
+        GLVertexShader s2;
+        s2.path.add(dir);
+        ASSERT_EQ(true, s2.read("cache_root.glsl"));
+        ASSERT_EQ(true, s2.solveIncludes());
+        ASSERT_STREQ("#line 1 1\nold\n#line 2 0\nmain\n", s2.code().c_str());
+        ASSERT_EQ(2_z, s2.includedFiles().size());
+
+        GLShader::clearIncludeCache();
+        GLVertexShader s3;
+        s3.path.add(dir);
+        ASSERT_EQ(true, s3.read("cache_root.glsl"));
+        ASSERT_EQ(true, s3.solveIncludes());
+        ASSERT_STREQ("#line 1 1\nnew\n#line 2 0\nmain\n", s3.code().c_str());
+
+        // Same root file name but different code: not taken from the cache
+        GLVertexShader s4("cache_root.glsl");
+        s4.path.add(dir);
+        s4 = "#include cache_inc.glsl\nother\n";
+        ASSERT_EQ(true, s4.solveIncludes());
+        ASSERT_STREQ("#line 1 1\nnew\n#line 2 0\nother\n", s4.code().c_str());
+    }
+}
+
+TEST(TestGLShaders, solveIncludesLineDirectives)
+{
+    OpenGLContext context([]()
+    {
+        const std::string dir("/tmp/OpenGLCppWrapper-tests/include/");
+        ASSERT_EQ(true, File::mkdir(dir));
+        writeFile(dir + "error_inc.glsl", "float foo() {\n  return 1.0;\n}\nfloat bar() { syntax error }\n");
+        GLShader::clearIncludeCache();
+
+        GLVertexShader shader;
+        shader.path.add(dir);
+        shader = "#version 330 core\n#include error_inc.glsl\nvoid main() {}\n";
+        ASSERT_EQ(false, shader.compile());
+
+        // The error refers to the 4th line of the included file and the
+        // message lists included files.
+        std::string error = shader.strerror();
+        ASSERT_NE(std::string::npos, error.find("1:4"));
+        ASSERT_NE(std::string::npos, error.find("1: " + dir + "error_inc.glsl"));
+    });
+}
+
+TEST(TestGLShaders, solveIncludesVersion)
+{
+    // No OpenGL context
+    {
+        const std::string dir("/tmp/OpenGLCppWrapper-tests/include/");
+        ASSERT_EQ(true, File::mkdir(dir));
+        writeFile(dir + "version_root.glsl", "#include version_inc.glsl\nvoid main() {}\n");
+        writeFile(dir + "version_inc.glsl", "#version 330 core\n#extension GL_ARB_foo : enable\nfloat foo;\n#version 330 core\n");
+        GLShader::clearIncludeCache();
+
+        // #version and #extension of the included file come before #line
+        GLVertexShader shader;
+        shader.path.add(dir);
+        ASSERT_EQ(true, shader.read("version_root.glsl"));
+        ASSERT_EQ(true, shader.solveIncludes());
+        ASSERT_STREQ("#version 330 core\n"
+                     "#extension GL_ARB_foo : enable\n"
+                     "#line 3 1\n"
+                     "float foo;\n"
+                     "\n"
+                     "#line 2 0\n"
+                     "void main() {}\n", shader.code().c_str());
+
+        // The shader already has a #version: the included one is dropped
+        GLVertexShader versioned;
+        versioned.path.add(dir);
+        versioned = "#version 330 core\n#include version_inc.glsl\nvoid main() {}\n";
+        ASSERT_EQ(true, versioned.solveIncludes());
+        ASSERT_STREQ("#version 330 core\n"
+                     "#extension GL_ARB_foo : enable\n"
+                     "#line 3 1\n"
+                     "float foo;\n"
+                     "\n"
+                     "#line 3 0\n"
+                     "void main() {}\n", versioned.code().c_str());
+    }
+}
+
+TEST(TestGLShaders, compileIncludedVersion)
+{
+    OpenGLContext context([]()
+    {
+        const std::string dir("/tmp/OpenGLCppWrapper-tests/include/");
+        ASSERT_EQ(true, File::mkdir(dir));
+        writeFile(dir + "header.glsl", "#version 330 core\nuniform float foo;\n");
+        GLShader::clearIncludeCache();
+
+        GLVertexShader shader;
+        shader.path.add(dir);
+        shader = "#include header.glsl\nvoid main() { gl_Position = vec4(foo); }\n";
+        ASSERT_EQ(true, shader.compile());
+        ASSERT_STREQ("", shader.strerror().c_str());
+    });
+}
+
+TEST(TestGLShaders, solveIncludesThreads)
+{
+    // No OpenGL context
+    {
+        const std::string dir("/tmp/OpenGLCppWrapper-tests/include/");
+        ASSERT_EQ(true, File::mkdir(dir));
+        writeFile(dir + "thread_inc.glsl", "float foo;\n");
+        for (size_t i = 0u; i < 8u; ++i)
+        {
+            writeFile(dir + "thread" + std::to_string(i) + ".glsl",
+                      "#include thread_inc.glsl\nfloat bar" + std::to_string(i) + ";\n");
+        }
+        GLShader::clearIncludeCache();
+
+        // Shaders can be expanded by worker threads: caches are shared.
+        std::vector<std::string> codes(8u);
+        std::vector<std::thread> threads;
+        for (size_t i = 0u; i < 8u; ++i)
+        {
+            threads.emplace_back([&dir, &codes, i]()
+            {
+                for (size_t n = 0u; n < 50u; ++n)
+                {
+                    GLVertexShader shader;
+                    shader.path.add(dir);
+                    if (shader.read("thread" + std::to_string(i) + ".glsl") &&
+                        shader.solveIncludes())
+                    {
+                        codes[i] = shader.code();
+                    }
+                }
+            });
+        }
+        for (auto& thread: threads)
+            thread.join();
+
+        for (size_t i = 0u; i < 8u; ++i)
+        {
+            std::string expected = "#line 1 1\nfloat foo;\n#line 2 0\nfloat bar"
+                                   + std::to_string(i) + ";\n";
+            ASSERT_STREQ(expected.c_str(), codes[i].c_str());
+        }
+    }
+}
+
+//--------------------------------------------------------------------------
+//! \brief Copy of the former include resolver (regex and rescan of the whole
+//! code after each expansion) used as reference for the tests.
+//--------------------------------------------------------------------------
+static std::string regexSolveIncludes(std::string const& source, Path const& path)
+{
+    std::regex regex(R"(^\s*#\s*include\s+([\w\/.]+))");
+    std::cmatch matches;
+    std::istringstream code(source);
+    std::string new_code;
+    std::string line;
+    std::list<std::string> opened_files;
+    bool changed;
+
+    do {
+        new_code = "";
+        changed = false;
+        while (std::getline(code, line))
+        {
+            std::regex_search(line.c_str(), matches, regex);
+            if (matches.empty())
+            {
+                new_code += line;
+                new_code += '\n';
+            }
+            else
+            {
+                std::string full_path = path.expand(matches.str(1));
+                std::string file_name = File::fileName(full_path);
+                if (opened_files.end() !=
+                    std::find(opened_files.begin(), opened_files.end(), file_name))
+                    continue;
+                opened_files.push_back(file_name);
+                std::string content;
+                File::readAllFile(full_path, content);
+                new_code += content;
+                changed = true;
+            }
+        }
+        if (changed)
+        {
+            code.clear();
+            code.str(new_code);
+        }
+    } while (changed);
+
+    return new_code;
+}
+
+//--------------------------------------------------------------------------
+//! \brief Remove #line directives from the code.
+//--------------------------------------------------------------------------
+static std::string removeLineDirectives(std::string const& code)
+{
+    std::istringstream in(code);
+    std::string out, line;
+    while (std::getline(in, line))
+    {
+        if (line.compare(0, 6, "#line ") != 0)
+        {
+            out += line;
+            out += '\n';
+        }
+    }
+    return out;
+}
+
+TEST(TestGLShaders, solveIncludesTree)
+{
+    // No OpenGL context
+    {
+        // Synthetic tree of 200 files: each node includes its two children and
+        // a shared file (included once).
+        const size_t N = 200u;
+        const std::string dir("/tmp/OpenGLCppWrapper-tests/includes/");
+        ASSERT_EQ(true, File::mkdir(dir));
+        writeFile(dir + "common.glsl", "uniform float common_value;\n");
+        for (size_t i = 0u; i < N; ++i)
+        {
+            std::string code("#include common.glsl\n");
+            for (size_t child = 2u * i + 1u; (child <= 2u * i + 2u) && (child < N); ++child)
+                code += "#include node" + std::to_string(child) + ".glsl\n";
+            code += "float f" + std::to_string(i) + "() { return common_value * "
+                    + std::to_string(i) + ".0; }\n";
+            writeFile(dir + "node" + std::to_string(i) + ".glsl", code);
+        }
+
+        Path path(dir);
+        std::string root;
+        ASSERT_EQ(true, File::readAllFile(dir + "node0.glsl", root));
+
+        std::string expected = regexSolveIncludes(root, path);
+
+        GLShader::clearIncludeCache();
+        GLVertexShader shader;
+        shader.path.add(dir);
+        ASSERT_EQ(true, shader.read("node0.glsl"));
+        ASSERT_EQ(true, shader.solveIncludes());
+        ASSERT_EQ(N + 1u, shader.includedFiles().size());
+
+        // Cached expansion
+        GLVertexShader cached;
+        cached.path.add(dir);
+        ASSERT_EQ(true, cached.read("node0.glsl"));
+        ASSERT_EQ(true, cached.solveIncludes());
+
+        // Same code than the former implementation (except #line directives
+        // and since lines of a skipped include are kept empty).
+        std::string code = removeLineDirectives(shader.code());
+        code.erase(std::remove(code.begin(), code.end(), '\n'), code.end());
+        expected.erase(std::remove(expected.begin(), expected.end(), '\n'), expected.end());
+        ASSERT_STREQ(expected.c_str(), code.c_str());
+        ASSERT_STREQ(shader.code().c_str(), cached.code().c_str());
+    }
+}
@@ -0,0 +1,305 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "main.hpp"
+#define protected public
+#define private public
+#  include "OpenGL/Buffers/VAO.hpp"
+#undef protected
+#undef private
+
+//--------------------------------------------------------------------------
+//! \brief Loader of RGBA layers made of texels depending on the file name:
+//! "missing..." is not found, "large..." is 8x8 texels, others are 4x2.
+//--------------------------------------------------------------------------
+class LayerLoader: public TextureLoader
+{
+public:
+
+    virtual bool setPixelFormat(GLTexture::PixelFormat const pixelformat) override
+    {
+        return pixelformat == GLTexture::PixelFormat::RGBA;
+    }
+
+    virtual GLenum getPixelType() const override
+    {
+        return GL_UNSIGNED_BYTE;
+    }
+
+    virtual size_t getPixelCount() const override
+    {
+        return 4u;
+    }
+
+    virtual bool load(std::string const& filename, GLTexture::Buffer& buffer,
+                      size_t& width, size_t& height) override
+    {
+        if (filename.find("missing") == 0u)
+        {
+            m_error = "File not found";
+            return false;
+        }
+
+        width = (filename.find("large") == 0u) ? 8u : 4u;
+        height = (filename.find("large") == 0u) ? 8u : 2u;
+        std::vector<unsigned char> pixels(width * height * 4u);
+        for (size_t i = 0u; i < pixels.size(); ++i)
+            pixels[i] = static_cast<unsigned char>(filename[0] + i);
+        buffer.append(pixels.data(), pixels.size());
+        return true;
+    }
+
+    virtual bool save(std::string const&, GLTexture::Buffer const&,
+                      size_t const, size_t const) override
+    {
+        return false;
+    }
+};
+
+//--------------------------------------------------------------------------
+//! \brief Expected texels of the layer loaded from the given file.
+//--------------------------------------------------------------------------
+static std::vector<unsigned char> layer(char const c)
+{
+    std::vector<unsigned char> pixels(4u * 2u * 4u);
+    for (size_t i = 0u; i < pixels.size(); ++i)
+        pixels[i] = static_cast<unsigned char>(c + i);
+    return pixels;
+}
+
+//--------------------------------------------------------------------------
+//! \brief Read back texels of all layers of the given mipmap level.
+//--------------------------------------------------------------------------
+static std::vector<unsigned char> readback(GLTextureArray2D& texture, size_t const bytes,
+                                           GLint const level = 0)
+{
+    std::vector<unsigned char> texels(bytes);
+    glCheck(glBindTexture(GL_TEXTURE_2D_ARRAY, texture.handle()));
+    glCheck(glPixelStorei(GL_PACK_ALIGNMENT, 1));
+    glCheck(glGetTexImage(GL_TEXTURE_2D_ARRAY, level, GL_RGBA, GL_UNSIGNED_BYTE, texels.data()));
+    glCheck(glBindTexture(GL_TEXTURE_2D_ARRAY, 0u));
+    return texels;
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLTextureArray2D, TestConstructors)
+{
+    GLTextureArray2D empty("empty");
+    ASSERT_EQ(GL_TEXTURE_2D_ARRAY, empty.target());
+    ASSERT_EQ(3u, empty.dimension());
+    ASSERT_EQ(0_z, empty.layers());
+    ASSERT_EQ(false, empty.loaded());
+
+    GLTextureArray2D texture("tex", 4u, 2u, 3u);
+    ASSERT_EQ(3_z, texture.layers());
+    ASSERT_EQ(4_z, texture.width());
+    ASSERT_EQ(2_z, texture.height());
+    ASSERT_EQ(3_z, texture.m_mipmaps.size());
+    ASSERT_EQ(4_z * 2_z * 3_z * 4_z, texture.data().size());
+    ASSERT_EQ(true, texture.loaded());
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLTextureArray2D, TestLoadLayers)
+{
+    GLTextureArray2D texture("tex");
+    ASSERT_EQ(true, texture.load<LayerLoader>({"a", "b", "c"}));
+    ASSERT_EQ(3_z, texture.layers());
+    ASSERT_EQ(4_z, texture.width());
+    ASSERT_EQ(2_z, texture.height());
+    ASSERT_EQ(3_z, texture.m_mipmaps.size());
+    ASSERT_EQ(GL_RGBA8, texture.m_gpuPixelFormat);
+
+    std::vector<unsigned char> expected;
+    for (char c: { 'a', 'b', 'c' })
+    {
+        auto l = layer(c);
+        expected.insert(expected.end(), l.begin(), l.end());
+    }
+    ASSERT_EQ(expected, texture.data().m_container);
+    ASSERT_EQ(static_cast<unsigned char>('b' + 17u), texture.get(1u, 0u, 1u, 1u));
+
+    // Failures do not modify layers
+    ASSERT_EQ(false, texture.load<LayerLoader>({"a", "missing"}));
+    ASSERT_EQ(false, texture.load<LayerLoader>({"a", "large"}));
+    ASSERT_EQ(3_z, texture.layers());
+    ASSERT_EQ(expected, texture.data().m_container);
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLTextureArray2D, TestLoadOneLayer)
+{
+    GLTextureArray2D texture("tex");
+    ASSERT_EQ(true, texture.load<LayerLoader>(0u, "a"));
+    ASSERT_EQ(true, texture.load<LayerLoader>(1u, "b"));
+    ASSERT_EQ(2_z, texture.layers());
+    ASSERT_EQ(true, texture.m_need_setup);
+
+    // Replacing a layer only tags it as dirty
+    texture.m_need_setup = false;
+    texture.m_buffer.clearPending();
+    texture.m_dirty_boxes.clearPending();
+    ASSERT_EQ(true, texture.load<LayerLoader>(0u, "c"));
+    ASSERT_EQ(false, texture.m_need_setup);
+    ASSERT_EQ(false, texture.m_buffer.isPending());
+    ASSERT_EQ(1_z, texture.m_dirty_boxes.getPending().size());
+    auto const& box = texture.m_dirty_boxes.getPending()[0];
+    ASSERT_EQ(0_z, box.z);
+    ASSERT_EQ(1_z, box.depth);
+    ASSERT_EQ(4_z, box.width);
+    ASSERT_EQ(2_z, box.height);
+
+    std::vector<unsigned char> expected = layer('c');
+    auto b = layer('b');
+    expected.insert(expected.end(), b.begin(), b.end());
+    ASSERT_EQ(expected, texture.data().m_container);
+
+    // Wrong layer index or size
+    ASSERT_EQ(false, texture.load<LayerLoader>(3u, "d"));
+    ASSERT_EQ(false, texture.load<LayerLoader>(1u, "large"));
+    ASSERT_EQ(false, texture.load<LayerLoader>(1u, "missing"));
+    ASSERT_EQ(2_z, texture.layers());
+    ASSERT_EQ(expected, texture.data().m_container);
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLTextureArray2D, TestLayerUploads)
+{
+    OpenGLContext context([]()
+    {
+        const size_t bytes = 4u * 2u * 4u * 3u;
+        GLTextureArray2D texture("tex");
+        ASSERT_EQ(true, texture.load<LayerLoader>({"a", "b", "c"}));
+
+        texture.begin();
+        texture.end();
+        ASSERT_NE(0u, texture.handle());
+        ASSERT_EQ(false, texture.needUpdate());
+        ASSERT_EQ(texture.data().m_container, readback(texture, bytes));
+
+        // Replace the middle layer: only this layer is transfered
+        ASSERT_EQ(true, texture.load<LayerLoader>(1u, "z"));
+        ASSERT_EQ(true, texture.needUpdate());
+        auto const& boxes = texture.pendingBoxes();
+        ASSERT_EQ(1_z, boxes.size());
+        ASSERT_EQ(1_z, boxes[0].z);
+        ASSERT_EQ(1_z, boxes[0].depth);
+        texture.begin();
+        texture.end();
+        ASSERT_EQ(false, texture.needUpdate());
+        ASSERT_EQ(texture.data().m_container, readback(texture, bytes));
+
+        // Modify a texel of the last layer and a rectangle of the first one
+        texture.set(1u, 2u, 2u, 3u) = 42u;
+        texture.data().data()[texture.offset(1u, 0u, 0u)] = 7u;
+        texture.setPending(1u, 0u, 0u, 1u, 1u);
+        ASSERT_EQ(2_z, texture.pendingBoxes().size());
+        texture.begin();
+        texture.end();
+        ASSERT_EQ(texture.data().m_container, readback(texture, bytes));
+        ASSERT_EQ(42u, readback(texture, bytes)[texture.offset(2u, 1u, 2u) + 3u]);
+
+        // Adding a layer specifies again the texture
+        ASSERT_EQ(true, texture.load<LayerLoader>(3u, "d"));
+        texture.begin();
+        texture.end();
+        ASSERT_EQ(4_z, texture.layers());
+        ASSERT_EQ(texture.data().m_container, readback(texture, bytes + 32u));
+    });
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLTextureArray2D, TestLayerMipmaps)
+{
+    OpenGLContext context([]()
+    {
+        const size_t W = 16u;
+        GLTextureArray2D texture("tex", W, W, 3u);
+        for (size_t i = 0u; i < texture.data().size(); ++i)
+            texture.data().data()[i] = static_cast<unsigned char>(i * 7u);
+        texture.mipmaps(true);
+
+        texture.begin();
+        texture.end();
+        for (size_t l = 0u; l < 3u; ++l)
+        {
+            ASSERT_EQ(4_z, texture.mipChain(l).levels().size());
+            ASSERT_EQ(8_z, texture.mipChain(l).levels()[0].width);
+        }
+
+        auto check = [&texture]()
+        {
+            for (GLint level = 1; level <= 4; ++level)
+            {
+                const size_t w = W >> level;
+                std::vector<unsigned char> expected;
+                for (size_t l = 0u; l < 3u; ++l)
+                {
+                    auto const& texels = texture.mipChain(l).levels()[size_t(level - 1)].texels;
+                    expected.insert(expected.end(), texels.begin(), texels.end());
+                }
+                ASSERT_EQ(expected, readback(texture, w * w * 4u * 3u, level));
+            }
+        };
+        check();
+
+        // Only mipmaps of the modified layer are computed again
+        const auto first = texture.mipChain(0u).levels()[0].texels;
+        texture.set(3u, 5u, 1u, 0u) = 255u;
+        texture.begin();
+        texture.end();
+        ASSERT_EQ(1_z, texture.mipChain(1u).levels()[0].dirty.size());
+        ASSERT_EQ(first, texture.mipChain(0u).levels()[0].texels);
+        check();
+    });
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLTextureArray2D, TestSamplerReflection)
+{
+    OpenGLContext context([]()
+    {
+        GLVertexShader vs;
+        GLFragmentShader fs;
+        GLProgram prog("prog");
+        GLVAO vao("vao");
+
+        vs = "#version 330 core\n"
+             "in vec2 position;\n"
+             "in vec2 UV;\n"
+             "in float layer;\n"
+             "out vec3 uvw;\n"
+             "void main() { uvw = vec3(UV, layer); gl_Position = vec4(position, 0.0, 1.0); }";
+        fs = "#version 330 core\n"
+             "uniform sampler2DArray materials;\n"
+             "in vec3 uvw;\n"
+             "out vec4 color;\n"
+             "void main() { color = texture(materials, uvw); }";
+
+        ASSERT_EQ(true, prog.compile(vs, fs));
+        ASSERT_EQ(true, prog.hasSampler("materials"));
+        ASSERT_EQ(GLenum(GL_SAMPLER_2D_ARRAY), prog.samplers().at("materials")->target());
+        ASSERT_EQ(true, prog.bind(vao));
+        ASSERT_EQ(true, vao.hasTexture("materials"));
+        ASSERT_EQ(true, vao.textureArray2D("materials").load<LayerLoader>({"a", "b"}));
+        ASSERT_EQ(2_z, vao.textureArray2D("materials").layers());
+        ASSERT_THROW(vao.texture2D("materials"), GL::Exception);
+    });
+}
@@ -0,0 +1,328 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "main.hpp"
+#define protected public
+#define private public
+#  include "OpenGL/Textures/TextureAtlas.hpp"
+#undef protected
+#undef private
+#  include <random>
+
+//--------------------------------------------------------------------------
+//! \brief Return true if the two rectangles share texels.
+//--------------------------------------------------------------------------
+static bool overlap(image::Rect const& a, image::Rect const& b)
+{
+    return (a.x < b.x + b.width) && (b.x < a.x + a.width) &&
+           (a.y < b.y + b.height) && (b.y < a.y + a.height);
+}
+
+//--------------------------------------------------------------------------
+//! \brief Texture of RGB texels depending on their position and on a seed.
+//--------------------------------------------------------------------------
+static std::unique_ptr<GLTexture2D> makeImage(size_t const w, size_t const h,
+                                              size_t const seed)
+{
+    auto texture = std::make_unique<GLTexture2D>("img" + std::to_string(seed),
+                                                 uint32_t(w), uint32_t(h));
+    texture->m_cpuPixelFormat = GLTexture::PixelFormat::RGB;
+    texture->m_cpuPixelCount = 3u;
+    texture->m_gpuPixelFormat = GL_RGB8;
+
+    std::vector<unsigned char> texels(w * h * 3u);
+    for (size_t i = 0u; i < texels.size(); ++i)
+        texels[i] = static_cast<unsigned char>(i * 13u + seed * 29u);
+    texture->data() = texels;
+    return texture;
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLTextureAtlas, TestPackerSquares)
+{
+    // 16 squares of 64x64 fill exactly 256x256
+    image::RectPacker packer(256u, 256u);
+    std::vector<image::Rect> rects;
+    for (size_t i = 0u; i < 16u; ++i)
+    {
+        image::Rect rect;
+        ASSERT_EQ(true, packer.insert(64u, 64u, rect));
+        ASSERT_EQ(64_z, rect.width);
+        ASSERT_EQ(64_z, rect.height);
+        rects.push_back(rect);
+    }
+    ASSERT_DOUBLE_EQ(1.0, packer.occupancy());
+    ASSERT_EQ(0_z, packer.freeRects().size());
+
+    image::Rect rect;
+    ASSERT_EQ(false, packer.insert(1u, 1u, rect));
+    ASSERT_EQ(false, packer.insert(0u, 1u, rect));
+
+    for (size_t i = 0u; i < rects.size(); ++i)
+        for (size_t j = i + 1u; j < rects.size(); ++j)
+            ASSERT_EQ(false, overlap(rects[i], rects[j]));
+
+    packer.clear();
+    ASSERT_DOUBLE_EQ(0.0, packer.occupancy());
+    ASSERT_EQ(false, packer.insert(257u, 1u, rect));
+    ASSERT_EQ(true, packer.insert(256u, 256u, rect));
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLTextureAtlas, TestPackerEfficiency)
+{
+    std::mt19937 rng(42u);
+    std::vector<std::pair<size_t, size_t>> sizes;
+    for (size_t i = 0u; i < 300u; ++i)
+        sizes.push_back(std::make_pair(8u + rng() % 57u, 8u + rng() % 57u));
+    std::sort(sizes.begin(), sizes.end(), [](std::pair<size_t, size_t> const& a,
+                                             std::pair<size_t, size_t> const& b)
+    {
+        return a.first * a.second > b.first * b.second;
+    });
+
+    image::RectPacker packer(512u, 512u);
+    std::vector<image::Rect> rects;
+    size_t area = 0u;
+    for (auto const& it: sizes)
+    {
+        image::Rect rect;
+        if (!packer.insert(it.first, it.second, rect))
+            continue;
+
+        ASSERT_LE(rect.x + rect.width, 512_z);
+        ASSERT_LE(rect.y + rect.height, 512_z);
+        for (auto const& other: rects)
+            ASSERT_EQ(false, overlap(rect, other));
+        rects.push_back(rect);
+        area += it.first * it.second;
+    }
+
+    ASSERT_DOUBLE_EQ(double(area) / (512.0 * 512.0), packer.occupancy());
+    ASSERT_GT(packer.occupancy(), 0.85);
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLTextureAtlas, TestPackAndPadding)
+{
+    const size_t P = 2u;
+    GLTextureAtlas atlas("atlas", 64u, 64u, P);
+    ASSERT_EQ(0_z, atlas.pages().size());
+    ASSERT_DOUBLE_EQ(0.0, atlas.occupancy());
+
+    // Images sized to fill more than one page
+    std::vector<std::unique_ptr<GLTexture2D>> images;
+    for (size_t i = 0u; i < 6u; ++i)
+    {
+        images.push_back(makeImage(5u + 4u * i, 28u - 3u * i, i));
+        ASSERT_EQ(i, atlas.add(*images.back()));
+        ASSERT_EQ(false, atlas.entry(i).packed);
+    }
+    images.push_back(makeImage(60u, 60u, 6u));
+    ASSERT_EQ(6_z, atlas.add(*images.back()));
+    atlas.pack();
+    ASSERT_EQ(2_z, atlas.pages().size());
+    ASSERT_STREQ("atlas/0", atlas.pages()[0]->cname());
+    ASSERT_STREQ("atlas/1", atlas.pages()[1]->cname());
+
+    // Sorted by area: the largest image comes first
+    ASSERT_EQ(0_z, atlas.entry(6u).page);
+
+    for (size_t i = 0u; i < atlas.size(); ++i)
+    {
+        auto const& entry = atlas.entry(i);
+        GLTexture2D const& src = *images[i];
+        ASSERT_EQ(true, entry.packed);
+        ASSERT_EQ(src.width(), entry.rect.width);
+        ASSERT_EQ(src.height(), entry.rect.height);
+        ASSERT_GE(entry.rect.x, P);
+        ASSERT_GE(entry.rect.y, P);
+        ASSERT_LE(entry.rect.x + entry.rect.width + P, 64_z);
+        ASSERT_LE(entry.rect.y + entry.rect.height + P, 64_z);
+
+        // Padded rectangles do not overlap
+        for (size_t j = 0u; j < i; ++j)
+        {
+            auto const& other = atlas.entry(j);
+            if (other.page != entry.page)
+                continue;
+
+            image::Rect a = entry.rect; a.x -= P; a.y -= P; a.width += 2u * P; a.height += 2u * P;
+            image::Rect b = other.rect; b.x -= P; b.y -= P; b.width += 2u * P; b.height += 2u * P;
+            ASSERT_EQ(false, overlap(a, b));
+        }
+
+        // Texels are copied and borders are replicated in the padding
+        const unsigned char* page = atlas.pages()[entry.page]->data().to_array();
+        const unsigned char* texels = src.data().to_array();
+        for (size_t y = 0u; y < entry.rect.height + 2u * P; ++y)
+        {
+            for (size_t x = 0u; x < entry.rect.width + 2u * P; ++x)
+            {
+                const size_t sx = std::min(std::max(x, P) - P, entry.rect.width - 1u);
+                const size_t sy = std::min(std::max(y, P) - P, entry.rect.height - 1u);
+                const size_t dst = ((entry.rect.y - P + y) * 64u + entry.rect.x - P + x) * 3u;
+                const size_t from = (sy * entry.rect.width + sx) * 3u;
+                ASSERT_EQ(0, memcmp(page + dst, texels + from, 3u));
+            }
+        }
+    }
+
+    // Incremental packing does not move previous images
+    const image::Rect first = atlas.entry(0u).rect;
+    images.push_back(makeImage(4u, 4u, 7u));
+    ASSERT_EQ(7_z, atlas.add(*images.back()));
+    atlas.pack();
+    ASSERT_EQ(true, atlas.entry(7u).packed);
+    ASSERT_EQ(first.x, atlas.entry(0u).rect.x);
+    ASSERT_EQ(first.y, atlas.entry(0u).rect.y);
+    ASSERT_GT(atlas.occupancy(), 0.0);
+    ASSERT_LE(atlas.occupancy(), 1.0);
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLTextureAtlas, TestAddErrors)
+{
+    GLTextureAtlas atlas("atlas", 32u, 32u, 2u);
+
+    // No texels
+    GLTexture2D empty("empty");
+    ASSERT_THROW(atlas.add(empty), GL::Exception);
+
+    // Larger than pages once padded
+    auto large = makeImage(30u, 4u, 0u);
+    ASSERT_THROW(atlas.add(*large), GL::Exception);
+
+    // Not the pixel format of the first image
+    auto rgb = makeImage(4u, 4u, 0u);
+    ASSERT_EQ(0_z, atlas.add(*rgb));
+    GLTexture2D rgba("rgba", 4u, 4u);
+    rgba.data() = std::vector<unsigned char>(4u * 4u * 4u, 0u);
+    ASSERT_THROW(atlas.add(rgba), GL::Exception);
+
+    // Not packed yet
+    GLVAO vao("vao");
+    ASSERT_THROW(atlas.bind(0u, vao, "texID", "UV", {}), GL::Exception);
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLTextureAtlas, TestRemapUV)
+{
+    GLTextureAtlas atlas("atlas", 128u, 64u, 1u);
+    auto a = makeImage(30u, 20u, 0u);
+    auto b = makeImage(10u, 40u, 1u);
+    atlas.add(*a);
+    atlas.add(*b);
+    atlas.pack();
+
+    GLVertexBuffer<Vector2f> uv("UV", 4u, BufferUsage::DYNAMIC_DRAW);
+    std::vector<Vector2f> const coords = {
+        Vector2f(0.0f, 0.0f), Vector2f(1.0f, 0.0f),
+        Vector2f(1.0f, 1.0f), Vector2f(0.5f, 0.25f) };
+    uv = coords;
+    uv.clearPending();
+    atlas.remap(1u, coords, uv);
+    ASSERT_EQ(true, uv.isPending());
+
+    // Corners of the image map onto corners of its rectangle in the page
+    auto const& rect = atlas.entry(1u).rect;
+    ASSERT_FLOAT_EQ(float(rect.x) / 128.0f, uv.get(0u).x);
+    ASSERT_FLOAT_EQ(float(rect.y) / 64.0f, uv.get(0u).y);
+    ASSERT_FLOAT_EQ(float(rect.x + rect.width) / 128.0f, uv.get(1u).x);
+    ASSERT_FLOAT_EQ(float(rect.y) / 64.0f, uv.get(1u).y);
+    ASSERT_FLOAT_EQ(float(rect.x + rect.width) / 128.0f, uv.get(2u).x);
+    ASSERT_FLOAT_EQ(float(rect.y + rect.height) / 64.0f, uv.get(2u).y);
+    ASSERT_FLOAT_EQ((float(rect.x) + 5.0f) / 128.0f, uv.get(3u).x);
+    ASSERT_FLOAT_EQ((float(rect.y) + 10.0f) / 64.0f, uv.get(3u).y);
+
+    // Remapping again converts the original coordinates
+    uv.clearPending();
+    atlas.remap(1u, coords, uv);
+    ASSERT_EQ(true, uv.isPending());
+    ASSERT_FLOAT_EQ(float(rect.x + rect.width) / 128.0f, uv.get(2u).x);
+    ASSERT_FLOAT_EQ(float(rect.y + rect.height) / 64.0f, uv.get(2u).y);
+    atlas.remap(0u, coords, uv);
+    auto const& first = atlas.entry(0u).rect;
+    ASSERT_FLOAT_EQ(float(first.x + first.width) / 128.0f, uv.get(2u).x);
+    ASSERT_FLOAT_EQ(float(first.y + first.height) / 64.0f, uv.get(2u).y);
+
+    // Sampling the center of each texel of the image gives its texel
+    GLTexture2D const& page = *atlas.pages()[0];
+    for (size_t y = 0u; y < b->height(); ++y)
+    {
+        for (size_t x = 0u; x < b->width(); ++x)
+        {
+            Vector2f coord = atlas.remap(1u, Vector2f((float(x) + 0.5f) / 10.0f,
+                                                      (float(y) + 0.5f) / 40.0f));
+            const size_t px = size_t(coord.x * 128.0f);
+            const size_t py = size_t(coord.y * 64.0f);
+            ASSERT_EQ(0, memcmp(page.data().to_array() + (py * 128u + px) * 3u,
+                                b->data().to_array() + (y * 10u + x) * 3u, 3u));
+        }
+    }
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLTextureAtlas, TestSharedPage)
+{
+    OpenGLContext context([]()
+    {
+        GLTextureAtlas atlas("atlas", 64u, 64u, 2u);
+        atlas.mipmaps(true);
+        auto a = makeImage(16u, 8u, 0u);
+        auto b = makeImage(8u, 16u, 1u);
+        atlas.add(*a);
+        atlas.add(*b);
+        atlas.pack();
+        ASSERT_EQ(1_z, atlas.pages().size());
+        ASSERT_EQ(true, atlas.pages()[0]->m_options.generateMipmaps);
+
+        GLVAO vao1("vao1");
+        GLVAO vao2("vao2");
+        std::vector<Vector2f> const coords = { Vector2f(0.0f, 0.0f), Vector2f(1.0f, 1.0f) };
+        atlas.bind(0u, vao1, "texID", "UV", coords);
+        atlas.bind(1u, vao2, "texID", "UV", coords);
+
+        // Both VAOs sample the same texture
+        ASSERT_EQ(true, vao1.hasTexture("texID"));
+        ASSERT_EQ(vao1.m_textures["texID"].get(), vao2.m_textures["texID"].get());
+        ASSERT_EQ(atlas.pages()[0].get(), vao1.m_textures["texID"].get());
+        ASSERT_EQ(3, atlas.pages()[0].use_count());
+        ASSERT_FLOAT_EQ(float(atlas.entry(1u).rect.x) / 64.0f,
+                        vao2.vector2f("UV").get(0u).x);
+
+        // Binding twice does not convert coordinates twice
+        atlas.bind(1u, vao2, "texID", "UV", coords);
+        ASSERT_FLOAT_EQ(float(atlas.entry(1u).rect.x) / 64.0f,
+                        vao2.vector2f("UV").get(0u).x);
+        ASSERT_FLOAT_EQ(float(atlas.entry(1u).rect.x + atlas.entry(1u).rect.width) / 64.0f,
+                        vao2.vector2f("UV").get(1u).x);
+
+        // The page is uploaded with the images
+        GLTexture2D& page = *atlas.pages()[0];
+        page.begin();
+        std::vector<unsigned char> texels(64u * 64u * 3u);
+        glCheck(glPixelStorei(GL_PACK_ALIGNMENT, 1));
+        glCheck(glGetTexImage(GL_TEXTURE_2D, 0, GL_RGB, GL_UNSIGNED_BYTE, texels.data()));
+        page.end();
+        ASSERT_EQ(page.data().m_container, texels);
+        ASSERT_EQ(false, page.mipChain().levels().empty());
+    });
+}
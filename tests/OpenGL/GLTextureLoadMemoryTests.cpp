@@ -0,0 +1,347 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "main.hpp"
+#define protected public
+#define private public
+#  include "OpenGL/Textures/Textures.hpp"
+#  include "Loaders/Textures/CompressedLoader.hpp"
+#  include "Common/MappedFile.hpp"
+#undef protected
+#undef private
+#  include "Common/File.hpp"
+#  include <atomic>
+#  include <fstream>
+#  include <new>
+
+static const std::string DIR("/tmp/OpenGLCppWrapper-tests/memory/");
+
+//--------------------------------------------------------------------------
+//! \brief Heap allocations made while counting is enabled.
+//--------------------------------------------------------------------------
+static std::atomic<bool> counting{false};
+static std::atomic<size_t> allocations{0u};
+static std::atomic<size_t> allocated{0u};
+static std::atomic<size_t> largest{0u};
+
+//--------------------------------------------------------------------------
+//! \brief Replace the global allocator of the test program for counting
+//! allocations made during the load of picture files.
+//--------------------------------------------------------------------------
+void* operator new(size_t size)
+{
+    if (counting)
+    {
+        ++allocations;
+        allocated += size;
+        size_t l = largest;
+        while ((size > l) && !largest.compare_exchange_weak(l, size));
+    }
+
+    void* p = malloc((size == 0u) ? 1u : size);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+//--------------------------------------------------------------------------
+static void startCounting()
+{
+    allocations = allocated = largest = 0u;
+    counting = true;
+}
+
+//--------------------------------------------------------------------------
+static void stopCounting()
+{
+    counting = false;
+}
+
+//--------------------------------------------------------------------------
+static void put32(std::vector<unsigned char>& file, size_t const offset, size_t const value)
+{
+    for (size_t i = 0u; i < 4u; ++i)
+        file[offset + i] = static_cast<unsigned char>(value >> (8u * i));
+}
+
+//--------------------------------------------------------------------------
+//! \brief Write a DDS file holding a single level of DXT5 blocks (1 byte per
+//! texel) and return the number of bytes of blocks.
+//--------------------------------------------------------------------------
+static size_t writeDDS(std::string const& filename, size_t const w, size_t const h)
+{
+    std::vector<unsigned char> file(128u, 0u);
+    memcpy(file.data(), "DDS ", 4u);
+    put32(file, 4u, 124u);
+    put32(file, 8u, 0x1007u);
+    put32(file, 12u, h);
+    put32(file, 16u, w);
+    put32(file, 76u, 32u);
+    put32(file, 80u, 0x4u);
+    memcpy(&file[84], "DXT5", 4u);
+    for (size_t i = 0u; i < w * h; ++i)
+        file.push_back(static_cast<unsigned char>(i * 7u));
+
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(file.data()), std::streamsize(file.size()));
+    return w * h;
+}
+
+//--------------------------------------------------------------------------
+//! \brief Check texels hold the blocks written by writeDDS().
+//--------------------------------------------------------------------------
+static bool blocks(const unsigned char* data, size_t const size)
+{
+    for (size_t i = 0u; i < size; ++i)
+    {
+        if (data[i] != static_cast<unsigned char>(i * 7u))
+            return false;
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------------
+TEST(TestTextureLoadMemory, TestMappedFile)
+{
+    ASSERT_EQ(true, File::mkdir(DIR));
+    {
+        std::ofstream out(DIR + "hello.txt", std::ios::trunc);
+        out << "hello world";
+        std::ofstream empty(DIR + "empty.txt", std::ios::trunc);
+    }
+
+    MappedFile file;
+    ASSERT_EQ(false, file.isOpen());
+    ASSERT_EQ(true, file.open(DIR + "hello.txt"));
+    ASSERT_EQ(true, file.isOpen());
+    ASSERT_EQ(11_z, file.size());
+    ASSERT_EQ(0, memcmp("hello world", file.data(), 11u));
+
+    ASSERT_EQ(false, file.open(DIR + "missing.txt"));
+    ASSERT_EQ(false, file.isOpen());
+    ASSERT_EQ(0_z, file.size());
+    ASSERT_STRNE("", file.strerror().c_str());
+
+    ASSERT_EQ(false, file.open(DIR + "empty.txt"));
+    ASSERT_STREQ("Empty file", file.strerror().c_str());
+
+    MappedFile other(DIR + "hello.txt");
+    ASSERT_EQ(true, other.isOpen());
+    other.close();
+    ASSERT_EQ(nullptr, other.data());
+}
+
+//--------------------------------------------------------------------------
+TEST(TestTextureLoadMemory, TestExtend)
+{
+    PendingContainer<unsigned char> pc;
+    pc.reserve(16u);
+    const unsigned char* storage = pc.data().data();
+    size_t const memory = GPUMemory();
+
+    // Elements are written in the reserved storage
+    unsigned char* p = pc.extend(8u);
+    ASSERT_EQ(storage, p);
+    ASSERT_EQ(8_z, pc.size());
+    ASSERT_EQ(0_z, pc.getPending().first);
+    ASSERT_EQ(8_z, pc.getPending().second);
+    pc.clearPending();
+
+    p = pc.extend(4u);
+    ASSERT_EQ(storage + 8u, p);
+    ASSERT_EQ(12_z, pc.size());
+    ASSERT_EQ(8_z, pc.getPending().first);
+    ASSERT_EQ(12_z, pc.getPending().second);
+    ASSERT_EQ(memory + 12u, GPUMemory());
+
+    // Reset empties the container but keeps the storage
+    pc.reset();
+    ASSERT_EQ(0_z, pc.size());
+    ASSERT_EQ(16_z, pc.capacity());
+    ASSERT_EQ(false, pc.isPending());
+    ASSERT_EQ(memory, GPUMemory());
+    ASSERT_EQ(storage, pc.extend(16u));
+}
+
+//--------------------------------------------------------------------------
+TEST(TestTextureLoadMemory, TestAdopt)
+{
+    GLTexture::Buffer buffer;
+    buffer.append({ 1u, 2u, 3u });
+    buffer.clearPending();
+    size_t const memory = GPUMemory();
+
+    // The array allocated by malloc() (ie by SOIL) holds the elements: no
+    // copy, no allocation.
+    unsigned char* array = static_cast<unsigned char*>(malloc(1024u));
+    for (size_t i = 0u; i < 1024u; ++i)
+        array[i] = static_cast<unsigned char>(i * 7u);
+    startCounting();
+    buffer.adopt(array, 1024u);
+    stopCounting();
+    ASSERT_EQ(0_z, allocations.load());
+    ASSERT_EQ(array, buffer.to_array());
+    ASSERT_EQ(1024_z, buffer.size());
+    ASSERT_EQ(1024_z, buffer.capacity());
+    ASSERT_EQ(0_z, buffer.m_container.capacity());
+    ASSERT_EQ(true, blocks(buffer.to_array(), 1024u));
+    ASSERT_EQ(7u, buffer.get(1u));
+    ASSERT_THROW(buffer.get(1024u), std::out_of_range);
+    ASSERT_EQ(0_z, buffer.getPending().first);
+    ASSERT_EQ(1024_z, buffer.getPending().second);
+    ASSERT_EQ(memory - 3u + 1024u, GPUMemory());
+
+    // Writing elements keeps the array
+    buffer.clearPending();
+    buffer.set(2u) = 42u;
+    ASSERT_EQ(array, buffer.to_array());
+    ASSERT_EQ(42u, buffer.get(2u));
+    buffer.set(2u) = 14u;
+
+    // Copies
+    GLTexture::Buffer copy(buffer);
+    ASSERT_EQ(1024_z, copy.size());
+    ASSERT_EQ(true, blocks(copy.to_array(), 1024u));
+    GLTexture::Buffer assigned;
+    assigned = buffer;
+    ASSERT_EQ(1024_z, assigned.size());
+    ASSERT_EQ(true, blocks(assigned.to_array(), 1024u));
+
+    // Growing moves elements into the std::vector
+    buffer.resize(2048u);
+    ASSERT_NE(array, buffer.to_array());
+    ASSERT_EQ(2048_z, buffer.m_container.size());
+    ASSERT_EQ(true, blocks(buffer.to_array(), 1024u));
+    ASSERT_EQ(0u, buffer.get(2047u));
+
+    // Swapping exchanges the adopted array
+    array = static_cast<unsigned char*>(malloc(16u));
+    copy.adopt(array, 16u);
+    copy.swap(buffer);
+    ASSERT_EQ(array, buffer.to_array());
+    ASSERT_EQ(16_z, buffer.size());
+    ASSERT_EQ(2048_z, copy.size());
+
+    // The adopted array is freed by reset() or by the destructor
+    buffer.reset();
+    ASSERT_EQ(0_z, buffer.size());
+    ASSERT_EQ(nullptr, buffer.to_array());
+    buffer.adopt(static_cast<unsigned char*>(malloc(16u)), 16u);
+}
+
+//--------------------------------------------------------------------------
+TEST(TestTextureLoadMemory, TestLoaderAllocations)
+{
+    ASSERT_EQ(true, File::mkdir(DIR));
+    size_t const bytes = writeDDS(DIR + "large.dds", 512u, 512u);
+
+    CompressedLoader loader;
+    ASSERT_EQ(true, loader.setPixelFormat(GLTexture::PixelFormat::RGBA));
+    size_t width = 0u, height = 0u;
+
+    // Not reserved: a single allocation of the size of the texels. The file is
+    // not copied on the heap.
+    {
+        GLTexture::Buffer buffer;
+        startCounting();
+        bool res = loader.load(DIR + "large.dds", buffer, width, height);
+        stopCounting();
+        ASSERT_EQ(true, res);
+        ASSERT_EQ(bytes, largest.load());
+        ASSERT_LT(allocated.load(), bytes + bytes / 16u);
+        ASSERT_EQ(bytes, buffer.size());
+        ASSERT_EQ(true, blocks(buffer.to_array(), bytes));
+    }
+
+    // Reserved: blocks are copied into the reserved storage. No allocation of
+    // texels.
+    {
+        GLTexture::Buffer buffer;
+        buffer.reserve(bytes);
+        const unsigned char* storage = buffer.data().data();
+        startCounting();
+        bool res = loader.load(DIR + "large.dds", buffer, width, height);
+        stopCounting();
+        ASSERT_EQ(true, res);
+        ASSERT_LT(largest.load(), bytes / 16u);
+        ASSERT_LT(allocated.load(), bytes / 16u);
+        ASSERT_EQ(storage, buffer.to_array());
+        ASSERT_EQ(true, blocks(buffer.to_array(), bytes));
+    }
+}
+
+//--------------------------------------------------------------------------
+TEST(TestTextureLoadMemory, TestDecodeCompressed)
+{
+    ASSERT_EQ(true, File::mkdir(DIR));
+    writeDDS(DIR + "small.dds", 16u, 16u);
+
+    // Blocks cannot be premultiplied: the buffer is left untouched.
+    CompressedLoader loader;
+    ASSERT_EQ(true, loader.configure(GLTexture::PixelFormat::RGBA,
+                                     GL_UNSIGNED_BYTE, true));
+    GLTexture::Buffer buffer;
+    buffer.append({ 1u, 2u, 3u, 4u });
+    size_t width = 0u, height = 0u;
+    ASSERT_EQ(false, loader.decode(DIR + "small.dds", buffer, width, height));
+    ASSERT_STRNE("", loader.error().c_str());
+    ASSERT_EQ(4_z, buffer.size());
+    ASSERT_EQ(1u, buffer.to_array()[0]);
+}
+
+//--------------------------------------------------------------------------
+TEST(TestTextureLoadMemory, TestTextureAllocations)
+{
+    ASSERT_EQ(true, File::mkdir(DIR));
+    size_t const bytes = writeDDS(DIR + "large.dds", 512u, 512u);
+
+    GLTexture2D texture("tex");
+    texture.reserve(bytes);
+    const unsigned char* storage = texture.m_buffer.data().data();
+
+    startCounting();
+    bool res = texture.load<CompressedLoader>(DIR + "large.dds");
+    stopCounting();
+    ASSERT_EQ(true, res);
+    ASSERT_EQ(512_z, texture.width());
+    ASSERT_LT(largest.load(), bytes / 16u);
+    ASSERT_EQ(storage, texture.m_buffer.to_array());
+    ASSERT_EQ(true, blocks(texture.m_buffer.to_array(), bytes));
+
+    // Loading again replaces texels in the same storage
+    startCounting();
+    res = texture.load<CompressedLoader>(DIR + "large.dds");
+    stopCounting();
+    ASSERT_EQ(true, res);
+    ASSERT_EQ(bytes, texture.m_buffer.size());
+    ASSERT_LT(largest.load(), bytes / 16u);
+    ASSERT_EQ(storage, texture.m_buffer.to_array());
+    ASSERT_EQ(true, blocks(texture.m_buffer.to_array(), bytes));
+}
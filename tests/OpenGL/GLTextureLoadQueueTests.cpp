@@ -0,0 +1,431 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "main.hpp"
+#define protected public
+#define private public
+#  include "OpenGL/Textures/TextureLoadQueue.hpp"
+#  include "OpenGL/Shaders/Program.hpp"
+#  include "OpenGL/Buffers/VAO.hpp"
+#undef protected
+#undef private
+#  include <set>
+
+//--------------------------------------------------------------------------
+//! \brief Decide when the files decoded by GatedLoader are ready and count
+//! decoded files.
+//--------------------------------------------------------------------------
+class Gate
+{
+public:
+
+    //! \brief Let the decoding of the given file finish.
+    void open(std::string const& filename)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_opened.insert(filename);
+        m_condition.notify_all();
+    }
+
+    //! \brief Called by worker threads: block until the file is opened.
+    void pass(std::string const& filename)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        ++m_started;
+        m_condition.notify_all();
+        m_condition.wait(lock, [&] { return m_opened.count(filename) != 0u; });
+    }
+
+    //! \brief Called by worker threads: a file has been decoded.
+    void done()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_decoded;
+        m_condition.notify_all();
+    }
+
+    //! \brief Block until the given number of files started their decoding.
+    void waitStarted(size_t const count)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [&] { return m_started >= count; });
+    }
+
+    //! \brief Block until the given number of files have been decoded.
+    void waitDecoded(size_t const count)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [&] { return m_decoded >= count; });
+    }
+
+    size_t started()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_started;
+    }
+
+private:
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::set<std::string> m_opened;
+    size_t m_started = 0u;
+    size_t m_decoded = 0u;
+};
+
+//--------------------------------------------------------------------------
+//! \brief Replace SOIL by a loader decoding nothing: it makes a 4x2 RGBA
+//! picture filled with the first letter of the filename once the Gate lets it
+//! pass. Files starting by "missing" fail.
+//--------------------------------------------------------------------------
+class GatedLoader: public TextureLoader
+{
+public:
+
+    GatedLoader(Gate& gate)
+        : m_gate(gate)
+    {}
+
+    virtual bool setPixelFormat(GLTexture::PixelFormat const pixelformat) override
+    {
+        return pixelformat == GLTexture::PixelFormat::RGBA;
+    }
+
+    virtual GLenum getPixelType() const override
+    {
+        return GL_UNSIGNED_BYTE;
+    }
+
+    virtual size_t getPixelCount() const override
+    {
+        return 4u;
+    }
+
+    virtual bool load(std::string const& filename, GLTexture::Buffer& buffer,
+                      size_t& width, size_t& height) override
+    {
+        m_gate.pass(filename);
+        bool res = (filename.find("missing") != 0u);
+        if (res)
+        {
+            width = 4u; height = 2u;
+            std::vector<unsigned char> pixels(width * height * 4u,
+                                              static_cast<unsigned char>(filename[0]));
+            buffer.append(pixels.data(), pixels.size());
+        }
+        else
+        {
+            m_error = "File not found";
+        }
+        m_gate.done();
+        return res;
+    }
+
+    virtual bool save(std::string const&, GLTexture::Buffer const&,
+                      size_t const, size_t const) override
+    {
+        return false;
+    }
+
+private:
+
+    Gate& m_gate;
+};
+
+//--------------------------------------------------------------------------
+static void push(GLTextureLoadQueue& queue, Gate& gate, GLTexture2D& texture,
+                 std::string const& filename)
+{
+    ASSERT_EQ(true, queue.push(texture, filename, std::make_unique<GatedLoader>(gate)));
+}
+
+//--------------------------------------------------------------------------
+//! \brief Block until the given number of textures wait for their upload.
+//--------------------------------------------------------------------------
+static void waitReady(GLTextureLoadQueue& queue, size_t const count)
+{
+    while (queue.ready() < count)
+    {
+        std::this_thread::yield();
+    }
+}
+
+//--------------------------------------------------------------------------
+//! \brief Return the size of the image specified on the GPU for the texture.
+//--------------------------------------------------------------------------
+static GLint gpuWidth(GLTexture2D& texture)
+{
+    GLint width = -1;
+    glCheck(glBindTexture(GL_TEXTURE_2D, texture.handle()));
+    glCheck(glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width));
+    glCheck(glBindTexture(GL_TEXTURE_2D, 0u));
+    return width;
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLTextureLoadQueue, TestConstructor)
+{
+    // No OpenGL context
+    {
+        GLTextureLoadQueue queue(3u);
+        ASSERT_EQ(3_z, queue.threads());
+        ASSERT_EQ(0_z, queue.pending());
+        ASSERT_EQ(0_z, queue.poll());
+        queue.finish();
+    }
+    {
+        GLTextureLoadQueue queue;
+        ASSERT_GE(queue.threads(), 1_z);
+    }
+
+    GLTexture2D texture("tex");
+    ASSERT_EQ(false, texture.loading());
+    ASSERT_EQ(nullptr, texture.m_load_queue);
+}
+
+//--------------------------------------------------------------------------
+// The texture is bound to a 1x1 placeholder until the picture is uploaded.
+TEST(TestGLTextureLoadQueue, TestPlaceholderSwitch)
+{
+    OpenGLContext context([]()
+    {
+        Gate gate;
+        GLTextureLoadQueue queue(1u);
+        GLTexture2D texture("tex");
+
+        push(queue, gate, texture, "a.png");
+        ASSERT_EQ(false, queue.push(texture, "b.png", std::make_unique<GatedLoader>(gate)));
+        ASSERT_EQ(true, texture.loading());
+        ASSERT_EQ(false, texture.loaded());
+        ASSERT_EQ(1_z, queue.pending());
+
+        // Still decoding
+        texture.begin();
+        texture.end();
+        ASSERT_EQ(false, texture.m_need_setup);
+        ASSERT_EQ(1, gpuWidth(texture));
+        ASSERT_EQ(1_z, queue.poll());
+        ASSERT_EQ(true, texture.loading());
+        ASSERT_EQ(0_z, texture.width());
+
+        // Decoded: uploaded by the next poll
+        gate.open("a.png");
+        waitReady(queue, 1u);
+        ASSERT_EQ(true, texture.loading());
+        ASSERT_EQ(0_z, queue.poll());
+        ASSERT_EQ(false, texture.loading());
+        ASSERT_EQ(true, texture.loaded());
+        ASSERT_EQ(4_z, texture.width());
+        ASSERT_EQ(2_z, texture.height());
+        ASSERT_EQ(32_z, texture.data().size());
+        ASSERT_EQ('a', texture.get(0u));
+        ASSERT_EQ(4, gpuWidth(texture));
+
+        // The picture has been transfered once by onSetup()
+        ASSERT_EQ(false, texture.m_need_setup);
+        ASSERT_EQ(false, texture.data().isPending());
+    });
+}
+
+//--------------------------------------------------------------------------
+// GLVAO::draw samples the placeholder while the texture is loading.
+TEST(TestGLTextureLoadQueue, TestVAODraw)
+{
+    OpenGLContext context([]()
+    {
+        Gate gate;
+        GLTextureLoadQueue queue(1u);
+        GLVertexShader vs;
+        GLFragmentShader fs;
+        GLProgram prog("prog");
+        GLVAO vao("vao");
+
+        vs << "#version 330 core\n"
+              "in vec2 position;\n"
+              "in vec2 UV;\n"
+              "out vec2 uv;\n"
+              "void main() { uv = UV; gl_Position = vec4(position, 0.0, 1.0); }\n";
+        fs << "#version 330 core\n"
+              "uniform sampler2D texID;\n"
+              "in vec2 uv;\n"
+              "out vec4 color;\n"
+              "void main() { color = texture(texID, uv); }\n";
+        ASSERT_EQ(true, prog.compile(vs, fs));
+        ASSERT_EQ(true, prog.bind(vao));
+
+        vao.vector2f("position") = { Vector2f(-1.0f, -1.0f), Vector2f(3.0f, -1.0f), Vector2f(-1.0f, 3.0f) };
+        vao.vector2f("UV") = { Vector2f(0.0f, 0.0f), Vector2f(2.0f, 0.0f), Vector2f(0.0f, 2.0f) };
+        GLTexture2D& texture = vao.texture2D("texID");
+        push(queue, gate, texture, "a.png");
+
+        ASSERT_EQ(true, vao.draw(Mode::TRIANGLES, 0u, 3u));
+        ASSERT_EQ(true, texture.loading());
+        ASSERT_EQ(1, gpuWidth(texture));
+
+        gate.open("a.png");
+        queue.finish();
+        ASSERT_EQ(false, texture.loading());
+        ASSERT_EQ(true, vao.draw(Mode::TRIANGLES, 0u, 3u));
+        ASSERT_EQ(4, gpuWidth(texture));
+    });
+}
+
+//--------------------------------------------------------------------------
+// Textures are uploaded in the push order, within the budget of bytes.
+TEST(TestGLTextureLoadQueue, TestOrdering)
+{
+    OpenGLContext context([]()
+    {
+        Gate gate;
+        // One worker per texture: all files are decoded at the same time
+        GLTextureLoadQueue queue(4u);
+        GLTexture2D a("a"), b("b"), c("c"), d("d");
+
+        push(queue, gate, a, "a.png");
+        push(queue, gate, b, "b.png");
+        push(queue, gate, c, "c.png");
+        push(queue, gate, d, "d.png");
+        ASSERT_EQ(4_z, queue.pending());
+
+        // Decoded in reverse order
+        gate.open("d.png");
+        waitReady(queue, 1u);
+        gate.open("c.png");
+        waitReady(queue, 2u);
+        gate.open("a.png");
+        waitReady(queue, 3u);
+        ASSERT_EQ(4_z, queue.pending());
+
+        // One picture (32 bytes) per poll: b is still decoding and holds back
+        // c and d.
+        ASSERT_EQ(3_z, queue.poll(32u));
+        ASSERT_EQ(false, a.loading());
+        ASSERT_EQ(true, c.loading());
+        ASSERT_EQ(3_z, queue.poll(32u));
+        ASSERT_EQ(true, b.loading());
+        ASSERT_EQ(true, c.loading());
+        ASSERT_EQ(true, d.loading());
+
+        gate.open("b.png");
+        waitReady(queue, 3u);
+        ASSERT_EQ(2_z, queue.poll(32u));
+        ASSERT_EQ(false, b.loading());
+        ASSERT_EQ(true, c.loading());
+
+        // At least one picture is uploaded even if bigger than the budget
+        ASSERT_EQ(1_z, queue.poll(0u));
+        ASSERT_EQ(false, c.loading());
+        ASSERT_EQ(true, d.loading());
+        ASSERT_EQ(0_z, queue.poll(0u));
+        ASSERT_EQ(false, d.loading());
+        ASSERT_EQ('a', a.get(0u));
+        ASSERT_EQ('b', b.get(0u));
+        ASSERT_EQ('c', c.get(0u));
+        ASSERT_EQ('d', d.get(0u));
+
+        // The budget stops the upload before exceeding it
+        push(queue, gate, a, "a2.png");
+        push(queue, gate, b, "b2.png");
+        push(queue, gate, c, "c2.png");
+        gate.open("a2.png");
+        gate.open("b2.png");
+        gate.open("c2.png");
+        waitReady(queue, 3u);
+        ASSERT_EQ(1_z, queue.poll(64u + 31u));
+        ASSERT_EQ(false, a.loading());
+        ASSERT_EQ(false, b.loading());
+        ASSERT_EQ(true, c.loading());
+        ASSERT_EQ(0_z, queue.poll());
+    });
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLTextureLoadQueue, TestCancellation)
+{
+    OpenGLContext context([]()
+    {
+        Gate gate;
+        auto a = std::make_unique<GLTexture2D>("a");
+        GLTexture2D b("b"), c("c");
+
+        {
+            // A single worker: b waits for the decoding of a
+            GLTextureLoadQueue queue(1u);
+            push(queue, gate, *a, "a.png");
+            push(queue, gate, b, "b.png");
+            push(queue, gate, c, "c.png");
+            gate.waitStarted(1u);
+
+            // Cancel a file not yet decoded
+            ASSERT_EQ(true, queue.cancel(b));
+            ASSERT_EQ(false, queue.cancel(b));
+            ASSERT_EQ(false, b.loading());
+            ASSERT_EQ(2_z, queue.pending());
+
+            // Destroy a texture while its file is decoded
+            a.reset();
+            ASSERT_EQ(1_z, queue.pending());
+            gate.open("a.png");
+            gate.waitDecoded(1u);
+            ASSERT_EQ(1_z, queue.poll());
+
+            // b has never been decoded: c is the next one
+            gate.waitStarted(2u);
+            ASSERT_EQ(2_z, gate.started());
+            ASSERT_EQ(1_z, queue.poll());
+            ASSERT_EQ(true, c.loading());
+
+            // Destroy the queue while c is decoded
+            gate.open("c.png");
+        }
+
+        ASSERT_EQ(false, c.loading());
+        ASSERT_EQ(false, c.loaded());
+        ASSERT_EQ(false, b.loaded());
+    });
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLTextureLoadQueue, TestFailure)
+{
+    OpenGLContext context([]()
+    {
+        Gate gate;
+        GLTextureLoadQueue queue(2u);
+        GLTexture2D a("a"), b("b");
+
+        // Pixel format not managed by the loader
+        GLTextureFloat2D f("f");
+        f.m_cpuPixelFormat = GLTexture::PixelFormat::RED;
+        ASSERT_EQ(false, queue.push(f, "f.png", std::make_unique<GatedLoader>(gate)));
+        ASSERT_EQ(false, f.loading());
+
+        push(queue, gate, a, "missing.png");
+        push(queue, gate, b, "b.png");
+        gate.open("missing.png");
+        gate.open("b.png");
+        queue.finish();
+        ASSERT_EQ(0_z, queue.pending());
+        ASSERT_EQ(false, a.loading());
+        ASSERT_EQ(false, a.loaded());
+        ASSERT_EQ(false, b.loading());
+        ASSERT_EQ(true, b.loaded());
+    });
+}
@@ -0,0 +1,271 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "main.hpp"
+#define protected public
+#define private public
+#  include "OpenGL/Textures/Textures.hpp"
+#undef protected
+#undef private
+#  include <atomic>
+#  include <chrono>
+#  include <sstream>
+#  include <thread>
+
+//--------------------------------------------------------------------------
+//! \brief Slow fake loader recording the number of files decoded at the same
+//! time. Texels depend on the filename.
+//--------------------------------------------------------------------------
+class SlowLoader: public TextureLoader
+{
+public:
+
+    virtual bool setPixelFormat(GLTexture::PixelFormat const pixelformat) override
+    {
+        return pixelformat == GLTexture::PixelFormat::RGBA;
+    }
+
+    virtual GLenum getPixelType() const override
+    {
+        return GL_UNSIGNED_BYTE;
+    }
+
+    virtual size_t getPixelCount() const override
+    {
+        return 4u;
+    }
+
+    virtual bool load(std::string const& filename, GLTexture::Buffer& buffer,
+                      size_t& width, size_t& height) override
+    {
+        size_t const count = ++decoding;
+        size_t m = concurrency;
+        while ((count > m) && !concurrency.compare_exchange_weak(m, count));
+        std::this_thread::sleep_for(std::chrono::milliseconds(
+            (filename.find("slow") == 0u) ? 100 : 20));
+        --decoding;
+
+        if (filename.find("missing") == 0u)
+        {
+            m_error = "File not found";
+            return false;
+        }
+
+        width = height = (filename.find("large") == 0u) ? 8u : 4u;
+        unsigned char* texels = buffer.extend(width * height * 4u);
+        for (size_t i = 0u; i < width * height * 4u; ++i)
+            texels[i] = static_cast<unsigned char>(filename.back() * 13u + i);
+        return true;
+    }
+
+    virtual bool save(std::string const&, GLTexture::Buffer const&,
+                      size_t const, size_t const) override
+    {
+        return false;
+    }
+
+    static std::atomic<size_t> decoding;
+    static std::atomic<size_t> concurrency;
+};
+
+std::atomic<size_t> SlowLoader::decoding{0u};
+std::atomic<size_t> SlowLoader::concurrency{0u};
+
+//--------------------------------------------------------------------------
+static std::vector<std::string> slices(size_t const count)
+{
+    std::vector<std::string> filenames;
+    for (size_t i = 0u; i < count; ++i)
+        filenames.push_back("slice" + std::to_string(i));
+    return filenames;
+}
+
+//--------------------------------------------------------------------------
+static std::array<std::string, 6u> faces()
+{
+    return { "face0", "face1", "face2", "face3", "face4", "face5" };
+}
+
+//--------------------------------------------------------------------------
+TEST(TestParallelLoad, TestParallelFor)
+{
+    std::vector<std::atomic<size_t>> calls(100u);
+    parallelFor(calls.size(), 4u, [&calls](size_t const i) { ++calls[i]; });
+    for (auto const& it: calls)
+        ASSERT_EQ(1_z, it.load());
+
+    // Single thread: in order by the calling thread
+    std::vector<size_t> order;
+    std::thread::id const id = std::this_thread::get_id();
+    bool same = true;
+    parallelFor(5u, 1u, [&](size_t const i)
+    {
+        order.push_back(i);
+        same = same && (std::this_thread::get_id() == id);
+    });
+    ASSERT_EQ(std::vector<size_t>({ 0u, 1u, 2u, 3u, 4u }), order);
+    ASSERT_EQ(true, same);
+
+    // Nothing to do
+    parallelFor(0u, 0u, [](size_t const) { FAIL(); });
+}
+
+//--------------------------------------------------------------------------
+TEST(TestParallelLoad, TestTexture3D)
+{
+    GLTexture3D serial("serial");
+    SlowLoader::concurrency = 0u;
+    ASSERT_EQ(true, serial.load<SlowLoader>(slices(8u), 1u));
+    ASSERT_EQ(1_z, SlowLoader::concurrency.load());
+    ASSERT_EQ(4_z, serial.width());
+    ASSERT_EQ(4_z, serial.height());
+    ASSERT_EQ(8_z, serial.depth());
+    ASSERT_EQ(8_z * 64_z, serial.m_buffer.size());
+
+    // Byte-identical to the serial path
+    GLTexture3D parallel("parallel");
+    SlowLoader::concurrency = 0u;
+    ASSERT_EQ(true, parallel.load<SlowLoader>(slices(8u), 4u));
+    ASSERT_LT(1_z, SlowLoader::concurrency.load());
+    ASSERT_EQ(serial.width(), parallel.width());
+    ASSERT_EQ(serial.height(), parallel.height());
+    ASSERT_EQ(serial.depth(), parallel.depth());
+    ASSERT_EQ(serial.m_buffer.data(), parallel.m_buffer.data());
+    ASSERT_EQ(false, parallel.compressed());
+
+    // Loading again replaces images
+    ASSERT_EQ(true, parallel.load<SlowLoader>(slices(2u), 4u));
+    ASSERT_EQ(2_z, parallel.depth());
+    ASSERT_EQ(2_z * 64_z, parallel.m_buffer.size());
+}
+
+//--------------------------------------------------------------------------
+TEST(TestParallelLoad, TestTexture3DErrors)
+{
+    for (size_t const threads: { 1u, 4u })
+    {
+        GLTexture3D texture("tex");
+        std::vector<std::string> filenames = slices(4u);
+        filenames[2] = "missing2";
+        ASSERT_EQ(false, texture.load<SlowLoader>(filenames, threads));
+        ASSERT_EQ(0_z, texture.depth());
+        ASSERT_EQ(0_z, texture.m_buffer.size());
+
+        filenames[2] = "large2";
+        ASSERT_EQ(false, texture.load<SlowLoader>(filenames, threads));
+        ASSERT_EQ(0_z, texture.depth());
+        ASSERT_EQ(0_z, texture.m_buffer.size());
+
+        // The first image gives the dimension
+        filenames[0] = "large0";
+        filenames[2] = "slice2";
+        ASSERT_EQ(false, texture.load<SlowLoader>(filenames, threads));
+        ASSERT_EQ(true, texture.load<SlowLoader>(slices(4u), threads));
+    }
+}
+
+//--------------------------------------------------------------------------
+TEST(TestParallelLoad, TestFirstSliceDecodedLast)
+{
+    // Concurrent by default
+    GLTexture3D serial("serial");
+    SlowLoader::concurrency = 0u;
+    ASSERT_EQ(true, serial.load<SlowLoader>(slices(4u), 1u));
+    ASSERT_EQ(1_z, SlowLoader::concurrency.load());
+    GLTexture3D byDefault("default");
+    SlowLoader::concurrency = 0u;
+    ASSERT_EQ(true, byDefault.load<SlowLoader>(slices(4u)));
+    if (std::thread::hardware_concurrency() > 1u)
+    {
+        ASSERT_LT(1_z, SlowLoader::concurrency.load());
+    }
+    ASSERT_EQ(serial.m_buffer.data(), byDefault.m_buffer.data());
+
+    // Slices decoded before the first one are copied once its size is known
+    GLTexture3D parallel("parallel");
+    ASSERT_EQ(true, parallel.load<SlowLoader>({ "slow0", "slice1", "slice2", "slice3" }, 4u));
+    ASSERT_EQ(serial.m_buffer.data(), parallel.m_buffer.data());
+
+    // The wrong slice is reported even if it is decoded before the first one
+    std::stringstream err;
+    std::streambuf* old = std::cerr.rdbuf(err.rdbuf());
+    bool const loaded = parallel.load<SlowLoader>({ "slow0", "slice1", "large2", "slice3" }, 4u);
+    std::cerr.rdbuf(old);
+    ASSERT_EQ(false, loaded);
+    ASSERT_NE(std::string::npos, err.str().find("'large2' has not correct dimension"));
+    ASSERT_EQ(std::string::npos, err.str().find("slow0"));
+}
+
+//--------------------------------------------------------------------------
+TEST(TestParallelLoad, TestTextureCube)
+{
+    GLTextureCube serial("serial");
+    SlowLoader::concurrency = 0u;
+    ASSERT_EQ(true, serial.load<SlowLoader>(faces(), 1u));
+    ASSERT_EQ(1_z, SlowLoader::concurrency.load());
+    ASSERT_EQ(true, serial.loaded());
+
+    GLTextureCube parallel("parallel");
+    SlowLoader::concurrency = 0u;
+    ASSERT_EQ(true, parallel.load<SlowLoader>({ "face0", "face1", "face2",
+                                                "face3", "face4", "face5" }, 6u));
+    ASSERT_LT(1_z, SlowLoader::concurrency.load());
+    ASSERT_EQ(true, parallel.loaded());
+    for (size_t i = 0u; i < 6u; ++i)
+    {
+        ASSERT_EQ(4_z, parallel.m_textures[i]->width());
+        ASSERT_EQ(serial.m_textures[i]->m_buffer.data(),
+                  parallel.m_textures[i]->m_buffer.data());
+    }
+
+    std::array<std::string, 6u> filenames = faces();
+    filenames[3] = "missing3";
+    GLTextureCube failed("failed");
+    ASSERT_EQ(false, failed.load<SlowLoader>(filenames));
+    ASSERT_EQ(false, failed.loaded());
+}
+
+//--------------------------------------------------------------------------
+TEST(TestParallelLoad, TestUpload)
+{
+    OpenGLContext context([]()
+    {
+        GLTexture3D serial("serial"), parallel("parallel");
+        ASSERT_EQ(true, serial.load<SlowLoader>(slices(6u), 1u));
+        ASSERT_EQ(true, parallel.load<SlowLoader>(slices(6u), 3u));
+        parallel.begin();
+        std::vector<unsigned char> texels(serial.m_buffer.size());
+        glCheck(glGetTexImage(GL_TEXTURE_3D, 0, GL_RGBA, GL_UNSIGNED_BYTE, texels.data()));
+        parallel.end();
+        ASSERT_EQ(serial.m_buffer.data(), texels);
+
+        GLTextureCube cube("cube");
+        ASSERT_EQ(true, cube.load<SlowLoader>(faces(), 3u));
+        cube.begin();
+        for (size_t i = 0u; i < 6u; ++i)
+        {
+            std::vector<unsigned char> face(64u);
+            glCheck(glGetTexImage(GLenum(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i), 0,
+                                  GL_RGBA, GL_UNSIGNED_BYTE, face.data()));
+            ASSERT_EQ(cube.m_textures[i]->m_buffer.data(), face);
+        }
+        cube.end();
+    });
+}
@@ -0,0 +1,215 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "main.hpp"
+#define protected public
+#define private public
+#  include "OpenGL/Buffers/VAO.hpp"
+#  include "OpenGL/Textures/TextureRegistry.hpp"
+#  include "Common/File.hpp"
+#undef protected
+#undef private
+
+//--------------------------------------------------------------------------
+//! \brief Fake loader counting the number of decoded files.
+//--------------------------------------------------------------------------
+class CountingLoader: public TextureLoader
+{
+public:
+
+    virtual bool setPixelFormat(GLTexture::PixelFormat const pixelformat) override
+    {
+        return pixelformat == GLTexture::PixelFormat::RGBA;
+    }
+
+    virtual GLenum getPixelType() const override
+    {
+        return GL_UNSIGNED_BYTE;
+    }
+
+    virtual size_t getPixelCount() const override
+    {
+        return 4u;
+    }
+
+    virtual bool load(std::string const& filename, GLTexture::Buffer& buffer,
+                      size_t& width, size_t& height) override
+    {
+        ++decodes;
+        if (filename.find("missing") != std::string::npos)
+        {
+            m_error = "File not found";
+            return false;
+        }
+
+        width = height = 4u;
+        std::vector<unsigned char> pixels(width * height * 4u);
+        for (size_t i = 0u; i < pixels.size(); ++i)
+            pixels[i] = static_cast<unsigned char>(i);
+        buffer.append(pixels.data(), pixels.size());
+        return true;
+    }
+
+    virtual bool save(std::string const&, GLTexture::Buffer const&,
+                      size_t const, size_t const) override
+    {
+        return false;
+    }
+
+    static size_t decodes;
+};
+
+size_t CountingLoader::decodes = 0u;
+
+//--------------------------------------------------------------------------
+TEST(TestGLTextureRegistry, TestNormalize)
+{
+    ASSERT_STREQ("textures/wall.png", File::normalize("textures/wall.png").c_str());
+    ASSERT_STREQ("textures/wall.png", File::normalize("textures//./wall.png").c_str());
+    ASSERT_STREQ("textures/wall.png", File::normalize("./textures/foo/../wall.png").c_str());
+    ASSERT_STREQ("../wall.png", File::normalize("textures/../../wall.png").c_str());
+    ASSERT_STREQ("/wall.png", File::normalize("/../wall.png").c_str());
+    ASSERT_STREQ(".", File::normalize("textures/..").c_str());
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLTextureRegistry, TestKey)
+{
+    GLTexture::Options options;
+    std::string const k = GLTextureRegistry::key("foo/wall.png", options, "L");
+    ASSERT_EQ(k, GLTextureRegistry::key("foo/./bar/../wall.png", options, "L"));
+    ASSERT_NE(k, GLTextureRegistry::key("foo/wall.png", options, "M"));
+    ASSERT_NE(k, GLTextureRegistry::key("bar/wall.png", options, "L"));
+
+    options.wrapS = GLTexture::Wrap::CLAMP_TO_EDGE;
+    ASSERT_NE(k, GLTextureRegistry::key("foo/wall.png", options, "L"));
+    options = GLTexture::Options();
+    options.generateMipmaps = true;
+    ASSERT_NE(k, GLTextureRegistry::key("foo/wall.png", options, "L"));
+    options = GLTexture::Options();
+    options.downsize = true;
+    ASSERT_NE(k, GLTextureRegistry::key("foo/wall.png", options, "L"));
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLTextureRegistry, TestAcquire)
+{
+    GLTextureRegistry registry;
+    CountingLoader::decodes = 0u;
+
+    auto a = registry.acquire<CountingLoader>("foo/wall.png");
+    ASSERT_NE(nullptr, a);
+    ASSERT_EQ(true, a->loaded());
+    ASSERT_EQ(4_z, a->width());
+    ASSERT_EQ(1_z, registry.size());
+
+    // Same file spelled differently
+    auto b = registry.acquire<CountingLoader>("./foo//wall.png");
+    ASSERT_EQ(a, b);
+    ASSERT_EQ(1_z, CountingLoader::decodes);
+    ASSERT_EQ(1_z, registry.decoded());
+
+    // Same file with other options
+    GLTexture::Options options;
+    options.minFilter = GLTexture::Minification::NEAREST;
+    auto c = registry.acquire<CountingLoader>("foo/wall.png", options);
+    ASSERT_NE(a, c);
+    ASSERT_EQ(GLTexture::Minification::NEAREST, c->m_options.minFilter);
+    ASSERT_EQ(2_z, CountingLoader::decodes);
+    ASSERT_EQ(2_z, registry.size());
+
+    // Downsized textures have another pixel format: not shared
+    GLTexture::Options downsize;
+    downsize.downsize = true;
+    auto d = registry.acquire<CountingLoader>("foo/wall.png", downsize);
+    ASSERT_NE(a, d);
+    ASSERT_EQ(true, d->m_options.downsize);
+    ASSERT_EQ(3_z, registry.decoded());
+    d.reset();
+
+    // Failed files are not shared nor counted as decoded
+    ASSERT_EQ(nullptr, registry.acquire<CountingLoader>("missing.png"));
+    ASSERT_EQ(nullptr, registry.acquire<CountingLoader>("missing.png"));
+    ASSERT_EQ(5_z, CountingLoader::decodes);
+    ASSERT_EQ(3_z, registry.decoded());
+    ASSERT_EQ(2_z, registry.size());
+
+    // Released with the last user
+    a.reset();
+    ASSERT_EQ(2_z, registry.size());
+    b.reset();
+    ASSERT_EQ(1_z, registry.size());
+    c.reset();
+    ASSERT_EQ(0_z, registry.size());
+
+    // Decoded again once released
+    a = registry.acquire<CountingLoader>("foo/wall.png");
+    ASSERT_EQ(6_z, CountingLoader::decodes);
+    ASSERT_EQ(4_z, registry.decoded());
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLTextureRegistry, TestSharedByVAOs)
+{
+    OpenGLContext context([]()
+    {
+        GLTextureRegistry registry;
+        CountingLoader::decodes = 0u;
+        size_t const N = 8u;
+
+        {
+            std::vector<std::unique_ptr<GLVAO>> vaos;
+            for (size_t i = 0u; i < N; ++i)
+            {
+                vaos.push_back(std::make_unique<GLVAO>("vao" + std::to_string(i)));
+                vaos.back()->shareTexture("texID", registry.acquire<CountingLoader>("wall.png"));
+            }
+
+            // Single decode
+            ASSERT_EQ(1_z, CountingLoader::decodes);
+            ASSERT_EQ(1_z, registry.size());
+            ASSERT_EQ(long(N), registry.m_textures.begin()->second.use_count());
+
+            // Single GPU allocation: all VAOs bind the same OpenGL texture
+            GLTexture2D& first = vaos[0]->texture2D("texID");
+            first.begin();
+            first.end();
+            GLenum const handle = first.handle();
+            ASSERT_NE(0u, handle);
+            for (auto& vao: vaos)
+            {
+                GLTexture2D& texture = vao->texture2D("texID");
+                ASSERT_EQ(&first, &texture);
+                texture.begin();
+                ASSERT_EQ(handle, texture.handle());
+                ASSERT_EQ(false, texture.needUpdate());
+                texture.end();
+            }
+
+            // Still shared while a VAO holds it
+            vaos.resize(1u);
+            ASSERT_EQ(1_z, registry.size());
+            ASSERT_EQ(1_z, CountingLoader::decodes);
+        }
+
+        // Released with the last VAO
+        ASSERT_EQ(0_z, registry.size());
+    });
+}
@@ -0,0 +1,268 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "main.hpp"
+#define protected public
+#define private public
+#  include "OpenGL/Textures/Textures.hpp"
+#  include "OpenGL/Textures/TextureResidency.hpp"
+#undef protected
+#undef private
+
+//--------------------------------------------------------------------------
+//! \brief RGBA texels of a 4x4 texture depending on a seed.
+//--------------------------------------------------------------------------
+static std::vector<unsigned char> texels(size_t const seed)
+{
+    std::vector<unsigned char> pixels(4u * 4u * 4u);
+    for (size_t i = 0u; i < pixels.size(); ++i)
+        pixels[i] = static_cast<unsigned char>(i * 3u + seed * 11u);
+    return pixels;
+}
+
+//--------------------------------------------------------------------------
+//! \brief Read back texels of the texture from the GPU.
+//--------------------------------------------------------------------------
+static std::vector<unsigned char> readback(GLTexture& texture)
+{
+    std::vector<unsigned char> pixels(4u * 4u * 4u);
+    glCheck(glBindTexture(GL_TEXTURE_2D, texture.handle()));
+    glCheck(glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data()));
+    glCheck(glBindTexture(GL_TEXTURE_2D, 0u));
+    return pixels;
+}
+
+//--------------------------------------------------------------------------
+//! \brief Bind the texture as when drawing a VAO.
+//--------------------------------------------------------------------------
+static void draw(GLTexture& texture)
+{
+    texture.begin();
+    texture.end();
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLTextureResidency, TestGpuBytes)
+{
+    GLTexture2D texture("tex", 4u, 4u);
+    ASSERT_EQ(0_z, texture.gpuBytes());
+    texture.data() = texels(0u);
+    ASSERT_EQ(64_z, texture.gpuBytes());
+    texture.mipmaps(true);
+    ASSERT_EQ(85_z, texture.gpuBytes());
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLTextureResidency, TestManage)
+{
+    GLTextureResidency residency(100u);
+    GLTextureResidency other(100u);
+    ASSERT_EQ(100_z, residency.budget());
+    ASSERT_EQ(0_z, residency.currentFrame());
+
+    GLTexture2D texture("tex", 4u, 4u);
+    ASSERT_EQ(false, residency.unmanage(texture));
+    ASSERT_EQ(true, residency.manage(texture));
+    ASSERT_EQ(true, residency.manage(texture));
+    ASSERT_EQ(false, other.manage(texture));
+    ASSERT_EQ(&residency, texture.m_residency);
+    ASSERT_EQ(1_z, residency.size());
+    ASSERT_EQ(false, residency.resident(texture));
+    ASSERT_EQ(size_t(GLTextureResidency::NEVER), residency.lastUsed(texture));
+
+    ASSERT_EQ(true, residency.unmanage(texture));
+    ASSERT_EQ(nullptr, texture.m_residency);
+    ASSERT_EQ(0_z, residency.size());
+    ASSERT_EQ(true, other.manage(texture));
+
+    // Destroyed textures are no longer managed
+    {
+        GLTexture2D temporary("tmp", 4u, 4u);
+        ASSERT_EQ(true, residency.manage(temporary));
+        ASSERT_EQ(1_z, residency.size());
+    }
+    ASSERT_EQ(0_z, residency.size());
+
+    // Destroyed managers no longer manage textures
+    {
+        GLTextureResidency temporary(1u);
+        GLTexture2D tex("tex2", 4u, 4u);
+        ASSERT_EQ(true, temporary.manage(tex));
+        ASSERT_EQ(true, other.unmanage(texture));
+        ASSERT_EQ(true, temporary.manage(texture));
+    }
+    ASSERT_EQ(nullptr, texture.m_residency);
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLTextureResidency, TestEvictLeastRecentlyUsed)
+{
+    OpenGLContext context([]()
+    {
+        // Room for two 4x4 RGBA textures
+        GLTextureResidency residency(128u);
+        GLTexture2D a("a", 4u, 4u), b("b", 4u, 4u), c("c", 4u, 4u);
+        size_t seed = 0u;
+        for (GLTexture2D* texture: { &a, &b, &c })
+        {
+            texture->data() = texels(seed++);
+            ASSERT_EQ(true, residency.manage(*texture));
+        }
+
+        // Frame 0: all textures are used and kept even over budget
+        draw(a); draw(b); draw(c);
+        ASSERT_EQ(192_z, residency.residentBytes());
+        ASSERT_EQ(0_z, residency.frame());
+        ASSERT_EQ(192_z, residency.residentBytes());
+        ASSERT_EQ(1_z, residency.currentFrame());
+
+        // Frame 1: c is the least recently used
+        draw(a); draw(b);
+        ASSERT_EQ(0_z, residency.lastUsed(c));
+        ASSERT_EQ(1_z, residency.frame());
+        ASSERT_EQ(false, residency.resident(c));
+        ASSERT_EQ(0u, c.handle());
+        ASSERT_EQ(true, c.m_need_setup);
+        ASSERT_EQ(texels(2u), c.data().m_container);
+        ASSERT_EQ(128_z, residency.residentBytes());
+        ASSERT_EQ(1_z, residency.evictions());
+
+        // Frame 2: c is uploaded again on its next use, a is evicted
+        draw(b);
+        draw(c);
+        ASSERT_NE(0u, c.handle());
+        ASSERT_EQ(true, residency.resident(c));
+        ASSERT_EQ(texels(2u), readback(c));
+        ASSERT_EQ(1_z, residency.frame());
+        ASSERT_EQ(false, residency.resident(a));
+        ASSERT_EQ(true, residency.resident(b));
+        ASSERT_EQ(true, residency.resident(c));
+
+        // Frames 3 .. 5: nothing used, under budget: nothing evicted
+        for (size_t i = 0u; i < 3u; ++i)
+            ASSERT_EQ(0_z, residency.frame());
+
+        // Smaller budget: least recently used first
+        draw(a);
+        ASSERT_EQ(texels(0u), readback(a));
+        residency.budget(64u);
+        ASSERT_EQ(2_z, residency.frame());
+        ASSERT_EQ(true, residency.resident(a));
+        ASSERT_EQ(64_z, residency.residentBytes());
+        ASSERT_EQ(4_z, residency.evictions());
+    });
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLTextureResidency, TestDropAndReload)
+{
+    OpenGLContext context([]()
+    {
+        GLTextureResidency residency(64u);
+        GLTexture2D a("a", 4u, 4u), b("b", 4u, 4u);
+        a.data() = texels(1u);
+        b.data() = texels(2u);
+
+        size_t reloads = 0u;
+        ASSERT_EQ(true, residency.manage(a, [&reloads](GLTexture& texture)
+        {
+            ++reloads;
+            texture.data() = texels(1u);
+            return true;
+        }));
+        ASSERT_EQ(true, residency.manage(b));
+
+        draw(a);
+        residency.frame();
+        draw(b);
+        ASSERT_EQ(1_z, residency.frame());
+
+        // Texels of a are dropped from the CPU
+        ASSERT_EQ(false, residency.resident(a));
+        ASSERT_EQ(0_z, a.data().size());
+        ASSERT_EQ(0_z, reloads);
+
+        // And reloaded when bound
+        draw(a);
+        ASSERT_EQ(1_z, reloads);
+        ASSERT_EQ(64_z, a.data().size());
+        ASSERT_EQ(texels(1u), readback(a));
+        ASSERT_EQ(true, residency.resident(a));
+        ASSERT_EQ(128_z, residency.residentBytes());
+
+        // Released by the user: no longer resident
+        b.release();
+        residency.frame();
+        ASSERT_EQ(false, residency.resident(b));
+        ASSERT_EQ(64_z, residency.residentBytes());
+    });
+}
+
+//--------------------------------------------------------------------------
+// Texels of a texture downsized to 5-6-5 bits are dropped then reloaded.
+TEST(TestGLTextureResidency, TestDropDownsized)
+{
+    OpenGLContext context([]()
+    {
+        size_t const memory = GPUMemory();
+        GLTextureResidency residency(1024u);
+        GLTexture2D texture("tex", 4u, 4u);
+        // Opaque red and green texels: kept by 5-6-5 bits
+        std::vector<unsigned char> pixels(4u * 4u * 4u, 255u);
+        for (size_t i = 0u; i < 16u; ++i)
+        {
+            pixels[4u * i + ((i % 2u) ? 0u : 1u)] = 0u;
+            pixels[4u * i + 2u] = 0u;
+        }
+        texture.data() = pixels;
+        GLTexture::Options options;
+        options.downsize = true;
+        texture.options(options);
+        texture.m_gpuPixelFormat = GL_RGBA8;
+        texture.downsize();
+        ASSERT_EQ(GL_RGB565, texture.m_gpuPixelFormat);
+        ASSERT_EQ(32_z, texture.gpuBytes());
+        ASSERT_EQ(memory + 32u, size_t(GPUMemory()));
+
+        std::vector<unsigned char> const rgb = texture.data().data();
+        ASSERT_EQ(true, residency.manage(texture, [&rgb](GLTexture& t)
+        {
+            t.data() = rgb;
+            return true;
+        }));
+        draw(texture);
+        ASSERT_EQ(true, residency.resident(texture));
+
+        // Dropped: no underflow of the estimations
+        residency.evict(texture, residency.m_records[&texture]);
+        ASSERT_EQ(0_z, texture.gpuBytes());
+        ASSERT_EQ(memory, size_t(GPUMemory()));
+
+        // Reloaded
+        draw(texture);
+        ASSERT_EQ(32_z, texture.gpuBytes());
+        ASSERT_EQ(32_z, residency.residentBytes());
+        ASSERT_EQ(memory + 32u, size_t(GPUMemory()));
+
+        // Released
+        texture.release();
+        ASSERT_EQ(memory, size_t(GPUMemory()));
+    });
+}
@@ -0,0 +1,435 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "main.hpp"
+#define protected public
+#define private public
+#  include "OpenGL/Textures/Textures.hpp"
+#  include "OpenGL/Buffers/PixelBufferRing.hpp"
+#undef protected
+#undef private
+#  include <random>
+
+//--------------------------------------------------------------------------
+//! \brief Fill a texture of the given size with texels depending on their
+//! index and on the frame number.
+//--------------------------------------------------------------------------
+static void fill(GLTexture& texture, size_t const bytes, unsigned char const frame)
+{
+    GLTexture::Buffer& buffer = texture.data();
+    if (buffer.size() != bytes)
+    {
+        buffer.resize(bytes);
+    }
+
+    unsigned char* texels = buffer.to_array();
+    for (size_t i = 0u; i < bytes; ++i)
+    {
+        texels[i] = static_cast<unsigned char>(i * 7u + frame);
+    }
+    buffer.setPending(0u, bytes);
+}
+
+//--------------------------------------------------------------------------
+//! \brief Read back texels of the texture from the GPU.
+//--------------------------------------------------------------------------
+static std::vector<unsigned char> readback(GLTexture& texture, size_t const bytes,
+                                           GLenum const format = GL_RGBA,
+                                           GLenum const type = GL_UNSIGNED_BYTE)
+{
+    std::vector<unsigned char> texels(bytes);
+    glCheck(glBindTexture(texture.m_target, texture.handle()));
+    glCheck(glPixelStorei(GL_PACK_ALIGNMENT, 1));
+    glCheck(glGetTexImage(texture.m_target, 0, format, type, texels.data()));
+    glCheck(glBindTexture(texture.m_target, 0u));
+    return texels;
+}
+
+//--------------------------------------------------------------------------
+static GLint unpackBinding()
+{
+    GLint binding = -1;
+    glCheck(glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &binding));
+    return binding;
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLPixelBufferRing, TestConstructor)
+{
+    // No OpenGL context: PBOs are not created
+    GLPixelBufferRing pbos(GL_PIXEL_UNPACK_BUFFER);
+    ASSERT_EQ(GLenum(GL_PIXEL_UNPACK_BUFFER), pbos.m_target);
+    ASSERT_EQ(GLPixelBufferRing::DEFAULT_COUNT, pbos.count());
+    ASSERT_EQ(0u, pbos.handle(0u));
+    ASSERT_EQ(0_z, pbos.capacity(0u));
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLPixelBufferRing, TestRing)
+{
+    OpenGLContext context([]()
+    {
+        GLPixelBufferRing pbos(GL_PIXEL_UNPACK_BUFFER, 2u);
+
+        // PBOs are used in turn
+        ASSERT_NE(nullptr, pbos.map(16u));
+        ASSERT_EQ(0_z, pbos.current());
+        ASSERT_EQ(true, pbos.unmap());
+        ASSERT_EQ(GLint(pbos.handle(0u)), unpackBinding());
+        pbos.unbind();
+        ASSERT_EQ(0, unpackBinding());
+
+        ASSERT_NE(nullptr, pbos.map(32u));
+        ASSERT_EQ(1_z, pbos.current());
+        ASSERT_EQ(true, pbos.unmap());
+        ASSERT_NE(0u, pbos.handle(1u));
+        ASSERT_NE(pbos.handle(0u), pbos.handle(1u));
+
+        // Grow the first PBO only when needed
+        ASSERT_NE(nullptr, pbos.map(8u));
+        ASSERT_EQ(0_z, pbos.current());
+        ASSERT_EQ(16_z, pbos.capacity(0u));
+        ASSERT_EQ(true, pbos.unmap());
+        ASSERT_NE(nullptr, pbos.map(64u));
+        ASSERT_EQ(1_z, pbos.current());
+        ASSERT_EQ(64_z, pbos.capacity(1u));
+        ASSERT_EQ(true, pbos.unmap());
+        pbos.unbind();
+
+        pbos.release();
+        ASSERT_EQ(0u, pbos.handle(0u));
+        ASSERT_EQ(0u, pbos.handle(1u));
+        ASSERT_EQ(0_z, pbos.capacity(1u));
+    });
+}
+
+//--------------------------------------------------------------------------
+// Dirty rows are transfered through the PBOs of the texture.
+TEST(TestGLTextureStreaming, TestTexture2D)
+{
+    OpenGLContext context([]()
+    {
+        const size_t bytes = 8u * 4u * 4u;
+
+        for (size_t buffers: { 0u, 3u })
+        {
+            GLTexture2D texture("tex", 8u, 4u);
+            texture.streaming(buffers);
+            ASSERT_EQ(buffers != 0u, texture.streaming());
+
+            fill(texture, bytes, 0u);
+            texture.begin();
+            texture.end();
+            ASSERT_EQ(false, texture.data().isPending());
+            ASSERT_EQ(texture.data().m_container, readback(texture, bytes));
+
+            // Modify texels of the third row only
+            for (unsigned char frame = 1u; frame <= 5u; ++frame)
+            {
+                texture.set(2u, 3u, 1u) = frame;
+                ASSERT_EQ(true, texture.needUpdate());
+                ASSERT_EQ(1_z, texture.m_dirty_boxes.getPending().size());
+                texture.begin();
+                texture.end();
+                ASSERT_EQ(false, texture.data().isPending());
+                ASSERT_EQ(0, unpackBinding());
+                ASSERT_EQ(texture.data().m_container, readback(texture, bytes));
+            }
+
+            // Modify all texels
+            fill(texture, bytes, 42u);
+            texture.begin();
+            texture.end();
+            ASSERT_EQ(texture.data().m_container, readback(texture, bytes));
+
+            if (buffers != 0u)
+            {
+                ASSERT_NE(0u, texture.m_unpack->handle(2u));
+                ASSERT_EQ(bytes, texture.m_unpack->capacity(texture.m_unpack->current()));
+            }
+        }
+    });
+}
+
+//--------------------------------------------------------------------------
+// Random paints on a RGB texture with an odd width: only dirty rectangles
+// are transfered, from client memory and through PBOs.
+TEST(TestGLTextureStreaming, TestDirtyRectangles)
+{
+    OpenGLContext context([]()
+    {
+        const size_t W = 13u;
+        const size_t H = 7u;
+        const size_t bytes = W * H * 3u;
+        std::mt19937 rng(7u);
+
+        for (size_t buffers: { 0u, 2u })
+        {
+            GLTexture2D texture("tex", W, H);
+            texture.m_cpuPixelFormat = GLTexture::PixelFormat::RGB;
+            texture.m_cpuPixelCount = 3u;
+            texture.m_gpuPixelFormat = GL_RGB8;
+            texture.streaming(buffers);
+
+            fill(texture, bytes, 0u);
+            texture.begin();
+            texture.end();
+            ASSERT_EQ(texture.data().m_container, readback(texture, bytes, GL_RGB));
+
+            for (size_t frame = 0u; frame < 20u; ++frame)
+            {
+                for (size_t stroke = rng() % 6u; stroke > 0u; --stroke)
+                {
+                    const size_t x = rng() % W;
+                    const size_t y = rng() % H;
+                    if (rng() % 2u)
+                    {
+                        // A texel through set()
+                        texture.set(y, x, rng() % 3u) = static_cast<unsigned char>(rng());
+                    }
+                    else
+                    {
+                        // A rectangle through data() and setPending()
+                        const size_t w = 1u + rng() % (W - x);
+                        const size_t h = 1u + rng() % (H - y);
+                        for (size_t j = y; j < y + h; ++j)
+                            for (size_t i = x * 3u; i < (x + w) * 3u; ++i)
+                                texture.data().to_array()[j * W * 3u + i] =
+                                    static_cast<unsigned char>(rng());
+                        texture.setPending(x, y, w, h);
+                    }
+                }
+
+                texture.begin();
+                texture.end();
+                ASSERT_EQ(false, texture.needUpdate());
+                ASSERT_EQ(texture.data().m_container, readback(texture, bytes, GL_RGB));
+            }
+        }
+    });
+}
+
+//--------------------------------------------------------------------------
+// Offsets and dirty rectangles of float textures are in texels of 16 bytes.
+TEST(TestGLTextureStreaming, TestFloatTexture)
+{
+    OpenGLContext context([]()
+    {
+        const size_t W = 5u;
+        const size_t H = 3u;
+        const size_t bytes = W * H * 4u * sizeof(float);
+
+        for (size_t buffers: { 0u, 2u })
+        {
+            GLTextureFloat2D texture("tex");
+            texture.m_width = W;
+            texture.m_height = H;
+            ASSERT_EQ(16u, texture.texelBytes());
+            ASSERT_EQ(16u * (2u * W + 3u), texture.offset(3u, 2u));
+            texture.streaming(buffers);
+
+            GLTexture::Buffer& buffer = texture.data();
+            buffer.resize(bytes);
+            float* texels = reinterpret_cast<float*>(buffer.to_array());
+            for (size_t i = 0u; i < W * H * 4u; ++i)
+            {
+                texels[i] = static_cast<float>(i);
+            }
+            buffer.setPending(0u, bytes);
+            texture.begin();
+            texture.end();
+            ASSERT_EQ(texture.data().m_container, readback(texture, bytes, GL_RGBA, GL_FLOAT));
+
+            // Last channel of the texel (x=3, y=2) through set()
+            texels[(2u * W + 3u) * 4u + 3u] = -1.0f;
+            texture.set(2u, 3u, 3u * sizeof(float) + 3u);
+            ASSERT_EQ(true, texture.needUpdate());
+            texture.begin();
+            texture.end();
+            ASSERT_EQ(false, texture.needUpdate());
+            ASSERT_EQ(texture.data().m_container, readback(texture, bytes, GL_RGBA, GL_FLOAT));
+
+            // Rectangle of the two last texels of the two first rows
+            for (size_t y = 0u; y < 2u; ++y)
+                for (size_t x = W - 2u; x < W; ++x)
+                    for (size_t c = 0u; c < 4u; ++c)
+                        texels[(y * W + x) * 4u + c] = 0.5f;
+            texture.setPending(W - 2u, 0u, 2u, 2u);
+            texture.begin();
+            texture.end();
+            ASSERT_EQ(texture.data().m_container, readback(texture, bytes, GL_RGBA, GL_FLOAT));
+        }
+    });
+}
+
+//--------------------------------------------------------------------------
+// Dirty slices are transfered through the PBOs of the texture.
+TEST(TestGLTextureStreaming, TestTexture3D)
+{
+    OpenGLContext context([]()
+    {
+        const size_t slice = 4u * 2u * 4u;
+        GLTexture3D texture("tex");
+        texture.m_width = 4u;
+        texture.m_height = 2u;
+        texture.m_depth = 3u;
+        texture.streaming(2u);
+
+        fill(texture, 3u * slice, 0u);
+        texture.begin();
+        texture.end();
+        ASSERT_EQ(texture.data().m_container, readback(texture, 3u * slice));
+
+        // Modify the second slice
+        for (size_t i = slice; i < 2u * slice; ++i)
+        {
+            texture.data().set(i) = 0xAB;
+        }
+        texture.begin();
+        texture.end();
+        ASSERT_EQ(0, unpackBinding());
+        ASSERT_EQ(slice, texture.m_unpack->capacity(texture.m_unpack->current()));
+        ASSERT_EQ(texture.data().m_container, readback(texture, 3u * slice));
+    });
+}
+
+//--------------------------------------------------------------------------
+// Frames written directly into the mapped memory of PBOs.
+TEST(TestGLTextureStreaming, TestMap)
+{
+    OpenGLContext context([]()
+    {
+        const size_t bytes = 8u * 4u * 4u;
+        GLTexture2D texture("tex", 8u, 4u);
+
+        // Not streaming
+        fill(texture, bytes, 0u);
+        texture.begin();
+        texture.end();
+        ASSERT_EQ(nullptr, texture.map());
+        ASSERT_EQ(false, texture.unmap());
+
+        // Not yet setup
+        GLTexture2D texture2("tex2", 8u, 4u);
+        texture2.streaming(2u);
+        ASSERT_EQ(nullptr, texture2.map());
+
+        texture.streaming(2u);
+        for (unsigned char frame = 1u; frame <= 3u; ++frame)
+        {
+            unsigned char* texels = texture.map();
+            ASSERT_NE(nullptr, texels);
+            for (size_t i = 0u; i < bytes; ++i)
+            {
+                texels[i] = static_cast<unsigned char>(i + frame);
+            }
+            ASSERT_EQ(true, texture.unmap());
+            ASSERT_EQ(0, unpackBinding());
+
+            std::vector<unsigned char> gpu = readback(texture, bytes);
+            ASSERT_EQ(static_cast<unsigned char>(frame), gpu[0]);
+            ASSERT_EQ(static_cast<unsigned char>(bytes - 1u + frame), gpu[bytes - 1u]);
+        }
+
+        // CPU buffer is unchanged
+        ASSERT_EQ(0u, texture.get(0u));
+        ASSERT_EQ(false, texture.data().isPending());
+    });
+}
+
+//--------------------------------------------------------------------------
+// Rows of mapped RGB frames are not aligned on 4 bytes.
+TEST(TestGLTextureStreaming, TestMapRGB)
+{
+    OpenGLContext context([]()
+    {
+        const size_t W = 5u;
+        const size_t H = 3u;
+        const size_t bytes = W * H * 3u;
+        GLTexture2D texture("tex", W, H);
+        texture.m_cpuPixelFormat = GLTexture::PixelFormat::RGB;
+        texture.m_cpuPixelCount = 3u;
+        texture.m_gpuPixelFormat = GL_RGB8;
+        texture.streaming(2u);
+        fill(texture, bytes, 0u);
+        texture.begin();
+        texture.end();
+
+        std::vector<unsigned char> frame(bytes);
+        unsigned char* texels = texture.map();
+        ASSERT_NE(nullptr, texels);
+        for (size_t i = 0u; i < bytes; ++i)
+        {
+            frame[i] = texels[i] = static_cast<unsigned char>(i * 3u + 1u);
+        }
+        ASSERT_EQ(true, texture.unmap());
+        ASSERT_EQ(frame, readback(texture, bytes, GL_RGB));
+    });
+}
+
+//--------------------------------------------------------------------------
+// Stream frames of a 4K texture from client memory, through PBOs filled from
+// the CPU buffer and through PBOs written directly.
+TEST(TestGLTextureStreaming, TestLargeFrames)
+{
+    OpenGLContext context([]()
+    {
+        const size_t width = 3840u;
+        const size_t height = 2160u;
+        const size_t bytes = width * height * 4u;
+        const unsigned char frames = 8u;
+
+        for (size_t mode = 0u; mode < 3u; ++mode)
+        {
+            GLTexture2D texture("tex", width, height);
+            texture.streaming(mode == 0u ? 0u : 3u);
+            fill(texture, bytes, 0u);
+            texture.begin();
+            texture.end();
+            glCheck(glFinish());
+
+            for (unsigned char frame = 1u; frame <= frames; ++frame)
+            {
+                if (mode == 2u)
+                {
+                    unsigned char* texels = texture.map();
+                    ASSERT_NE(nullptr, texels);
+                    for (size_t i = 0u; i < bytes; ++i)
+                    {
+                        texels[i] = static_cast<unsigned char>(i * 7u + frame);
+                    }
+                    ASSERT_EQ(true, texture.unmap());
+                }
+                else
+                {
+                    fill(texture, bytes, frame);
+                    texture.begin();
+                    texture.end();
+                }
+            }
+
+            // Last frame has been transfered
+            glCheck(glFinish());
+            std::vector<unsigned char> texels = readback(texture, bytes);
+            ASSERT_EQ(static_cast<unsigned char>(frames), texels[0]);
+            ASSERT_EQ(static_cast<unsigned char>((bytes - 1u) * 7u + frames), texels[bytes - 1u]);
+        }
+    });
+}
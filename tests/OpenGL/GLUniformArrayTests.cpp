@@ -0,0 +1,208 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributedin the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "main.hpp"
+#define protected public
+#define private public
+#  include "OpenGL/Shaders/Program.hpp"
+#undef protected
+#undef private
+
+static constexpr size_t npos = static_cast<size_t>(-1);
+
+//--------------------------------------------------------------------------
+TEST(TestGLUniformArray, TestConstructor)
+{
+    GLUniformArray<Matrix44f> joints("jointTransforms", 16, GL_FLOAT_MAT4, 50u, 0u);
+
+    ASSERT_STREQ("jointTransforms", joints.cname());
+    ASSERT_EQ(50_z, joints.count());
+    ASSERT_EQ(16, joints.size());
+    ASSERT_EQ(GL_FLOAT_MAT4, joints.target());
+    ASSERT_EQ(false, joints.m_reflected);
+
+    // All elements are dirty
+    ASSERT_EQ(true, joints.isPending());
+    ASSERT_EQ(0_z, joints.getPending().first);
+    ASSERT_EQ(50_z, joints.getPending().second);
+    ASSERT_EQ(true, joints.m_need_update);
+
+    // Empty array: nothing to transfer
+    GLUniformArray<Vector3f> lights("lights", 3, GL_FLOAT_VEC3, 0u, 0u);
+    ASSERT_EQ(0_z, lights.count());
+    ASSERT_EQ(false, lights.isPending());
+    ASSERT_EQ(false, lights.m_need_update);
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLUniformArray, TestDirtyRange)
+{
+    GLUniformArray<float> array("weights", 1, GL_FLOAT, 10u, 0u);
+    array.clearPending();
+
+    array.set(4) = 4.0f;
+    ASSERT_EQ(4_z, array.getPending().first);
+    ASSERT_EQ(5_z, array.getPending().second);
+    ASSERT_EQ(4.0f, array.get(4));
+
+    array.set(7, 7.0f);
+    ASSERT_EQ(4_z, array.getPending().first);
+    ASSERT_EQ(8_z, array.getPending().second);
+
+    array.set(2, 2.0f);
+    ASSERT_EQ(2_z, array.getPending().first);
+    ASSERT_EQ(8_z, array.getPending().second);
+
+    // Reading does not tag elements as dirty
+    array.clearPending();
+    ASSERT_EQ(7.0f, array.get(7));
+    ASSERT_EQ(false, array.isPending());
+    ASSERT_EQ(npos, array.getPending().first);
+
+    // Out of bounds: GLSL arrays have fixed size
+    ASSERT_THROW(array.set(10), std::out_of_range);
+    ASSERT_THROW(array.get(10), std::out_of_range);
+    ASSERT_EQ(false, array.isPending());
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLUniformArray, TestAssignVector)
+{
+    // Reflected array: extra values are ignored
+    GLUniformArray<float> array("weights", 1, GL_FLOAT, 4u, 0u);
+    array.reflect(4u);
+    array.clearPending();
+    array = std::vector<float>{ 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f };
+    ASSERT_EQ(4_z, array.count());
+    ASSERT_EQ(0_z, array.getPending().first);
+    ASSERT_EQ(4_z, array.getPending().second);
+    ASSERT_EQ(4.0f, array.get(3));
+
+    array.clearPending();
+    array = std::vector<float>{ 8.0f, 9.0f };
+    ASSERT_EQ(4_z, array.count());
+    ASSERT_EQ(0_z, array.getPending().first);
+    ASSERT_EQ(2_z, array.getPending().second);
+    ASSERT_EQ(9.0f, array.get(1));
+    ASSERT_EQ(3.0f, array.get(2));
+
+    // Not yet reflected array: the array is resized then truncated by the
+    // reflection.
+    GLUniformArray<float> early("early", 1, GL_FLOAT, 0u, 0u);
+    early = std::vector<float>{ 1.0f, 2.0f, 3.0f };
+    ASSERT_EQ(3_z, early.count());
+    early.reflect(2u);
+    ASSERT_EQ(true, early.m_reflected);
+    ASSERT_EQ(2_z, early.count());
+    ASSERT_EQ(2.0f, early.get(1));
+    ASSERT_EQ(0_z, early.getPending().first);
+    ASSERT_EQ(2_z, early.getPending().second);
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLUniformArray, TestProgramCreatesArrayBeforeCompilation)
+{
+    GLProgram prog("prog");
+
+    GLUniformArray<Matrix44f>& joints = prog.matrix44fArray("jointTransforms");
+    ASSERT_EQ(0_z, joints.count());
+    ASSERT_EQ(true, prog.hasUniformArray<Matrix44f>("jointTransforms"));
+    ASSERT_EQ(false, prog.hasUniformArray<Matrix33f>("jointTransforms"));
+    ASSERT_EQ(false, prog.hasUniform<Matrix44f>("jointTransforms"));
+    ASSERT_THROW(prog.uniformArray<float>("jointTransforms"), GL::Exception);
+
+    // Reflection fixes the size of arrays created by the user
+    ASSERT_EQ(true, prog.updateOrCreateUniformArray<Matrix44f>("jointTransforms", 50));
+    ASSERT_EQ(50_z, joints.count());
+    ASSERT_EQ(true, joints.m_reflected);
+
+    // Reflection refuses arrays created by the user with a different type
+    prog.vector3fArray("lights");
+    ASSERT_EQ(false, prog.storeUniformArray(GL_FLOAT_VEC4, "lights[0]", 4));
+}
+
+//--------------------------------------------------------------------------
+TEST(TestGLUniformArray, TestProgramReflection)
+{
+    OpenGLContext context([]()
+    {
+        GLVertexShader vs;
+        GLFragmentShader fs;
+        GLProgram prog("prog");
+
+        vs = "#version 330 core\n"
+             "#define MAX_JOINTS 50\n"
+             "uniform mat4 jointTransforms[MAX_JOINTS];\n"
+             "uniform float weights[3];\n"
+             "uniform mat4 projection;\n"
+             "in vec3 position;\n"
+             "in float joint;\n"
+             "void main() {\n"
+             "  float w = weights[0] + weights[1] + weights[2];\n"
+             "  gl_Position = projection * jointTransforms[int(joint)]\n"
+             "              * vec4(w * position, 1.0);\n"
+             "}";
+        fs = "#version 330 core\n"
+             "uniform vec3 lightPositions[4];\n"
+             "out vec4 color;\n"
+             "void main() {\n"
+             "  vec3 c = vec3(0.0);\n"
+             "  for (int i = 0; i < 4; ++i) c += lightPositions[i];\n"
+             "  color = vec4(c, 1.0);\n"
+             "}";
+
+        ASSERT_EQ(true, prog.compile(vs, fs));
+        ASSERT_STREQ("", prog.strerror().c_str());
+
+        // Arrays are reflected as a single uniform without the "[0]" suffix
+        std::vector<std::string> names;
+        ASSERT_EQ(4_z, prog.getUniformNames(names));
+        ASSERT_EQ(true, prog.hasUniformArray<Matrix44f>("jointTransforms"));
+        ASSERT_EQ(true, prog.hasUniformArray<float>("weights"));
+        ASSERT_EQ(true, prog.hasUniformArray<Vector3f>("lightPositions"));
+        ASSERT_EQ(true, prog.hasUniform<Matrix44f>("projection"));
+        ASSERT_EQ(false, prog.hasUniform<Matrix44f>("jointTransforms[0]"));
+
+        ASSERT_EQ(50_z, prog.matrix44fArray("jointTransforms").count());
+        ASSERT_EQ(3_z, prog.scalarfArray("weights").count());
+        ASSERT_EQ(4_z, prog.vector3fArray("lightPositions").count());
+        ASSERT_THROW(prog.matrix44fArray("foo"), GL::Exception);
+        ASSERT_THROW(prog.scalarfArray("jointTransforms"), GL::Exception);
+
+        // Element locations are known once the program has been used
+        GLUniformArray<Matrix44f>& joints = prog.matrix44fArray("jointTransforms");
+        joints.set(10) = Matrix44f(matrix::Identity);
+        prog.begin();
+        ASSERT_EQ(50_z, joints.m_locations.size());
+        ASSERT_NE(-1, joints.m_locations[0]);
+        ASSERT_NE(-1, joints.m_locations[49]);
+        ASSERT_EQ(false, joints.isPending());
+
+        // Only the dirty sub-range is pending
+        joints.set(12) = Matrix44f(matrix::Identity);
+        joints.set(15) = Matrix44f(matrix::Identity);
+        ASSERT_EQ(12_z, joints.getPending().first);
+        ASSERT_EQ(16_z, joints.getPending().second);
+        prog.begin();
+        ASSERT_EQ(false, joints.isPending());
+        ASSERT_EQ(GL_NO_ERROR, glGetError());
+        prog.end();
+    });
+}
@@ -0,0 +1,406 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "main.hpp"
+#define protected public
+#define private public
+#  include "OpenGL/Textures/Textures.hpp"
+#  include "OpenGL/Textures/ImageKernels.hpp"
+#  include "Common/ThreadPool.hpp"
+#  include <atomic>
+#undef protected
+#undef private
+#  include <random>
+
+//--------------------------------------------------------------------------
+//! \brief Return an image of random texels.
+//--------------------------------------------------------------------------
+static std::vector<unsigned char> noise(size_t const bytes, unsigned const seed)
+{
+    std::mt19937 rng(seed);
+    std::vector<unsigned char> texels(bytes);
+    for (auto& it: texels)
+    {
+        it = static_cast<unsigned char>(rng());
+    }
+    return texels;
+}
+
+//--------------------------------------------------------------------------
+static image::Rect rect(size_t const x, size_t const y, size_t const w, size_t const h)
+{
+    image::Rect r;
+    r.x = x; r.y = y; r.width = w; r.height = h; r.depth = 1u;
+    return r;
+}
+
+//--------------------------------------------------------------------------
+TEST(TestImageKernels, TestLevels)
+{
+    ASSERT_EQ(0_z, image::levels(0u, 4u));
+    ASSERT_EQ(1_z, image::levels(1u, 1u));
+    ASSERT_EQ(2_z, image::levels(2u, 1u));
+    ASSERT_EQ(9_z, image::levels(256u, 100u));
+    ASSERT_EQ(10_z, image::levels(513u, 3u));
+}
+
+//--------------------------------------------------------------------------
+// Box filter on even sizes is the exact 2x2 average of each level.
+TEST(TestImageKernels, TestBoxMipChain)
+{
+    const size_t W = 64u, H = 32u, C = 4u;
+    std::vector<unsigned char> base = noise(W * H * C, 1u);
+
+    image::MipChain chain;
+    chain.build(base.data(), W, H, C, image::Filter::BOX, false);
+    ASSERT_EQ(6_z, chain.levels().size());
+
+    const unsigned char* prev = base.data();
+    size_t pw = W;
+    for (auto const& level: chain.levels())
+    {
+        ASSERT_EQ(std::max(size_t(1u), pw / 2u), level.width);
+        for (size_t y = 0u; y < level.height; ++y)
+        {
+            for (size_t x = 0u; x < level.width; ++x)
+            {
+                const size_t x0 = 2u * x;
+                const size_t x1 = std::min(2u * x + 1u, pw - 1u);
+                const size_t y0 = 2u * y, y1 = 2u * y + 1u;
+                for (size_t c = 0u; c < C; ++c)
+                {
+                    const unsigned sum = prev[(y0 * pw + x0) * C + c] + prev[(y0 * pw + x1) * C + c]
+                                       + prev[(y1 * pw + x0) * C + c] + prev[(y1 * pw + x1) * C + c];
+                    ASSERT_EQ((sum + 2u) / 4u, level.texels[(y * level.width + x) * C + c]);
+                }
+            }
+        }
+        prev = level.texels.data();
+        pw = level.width;
+        if (level.height == 1u)
+            break;
+    }
+
+    // Last levels: 2x1 then 1x1
+    ASSERT_EQ(1_z, chain.levels().back().width);
+    ASSERT_EQ(1_z, chain.levels().back().height);
+}
+
+//--------------------------------------------------------------------------
+// Box filter on odd sizes weights source texels by their covered area.
+TEST(TestImageKernels, TestBoxOdd)
+{
+    const unsigned char src[3] = { 0u, 90u, 180u };
+    unsigned char dst[1] = { 0u };
+    image::resize(src, 3u, 1u, dst, 1u, 1u, 1u, image::Filter::BOX, false);
+    ASSERT_EQ(90u, dst[0]);
+
+    // 5x5 into 2x2: first texel covers source texels 0, 1 and half of 2
+    std::vector<unsigned char> img = noise(25u, 2u);
+    unsigned char res[4];
+    image::resize(img.data(), 5u, 5u, res, 2u, 2u, 1u, image::Filter::BOX, false);
+    const double w[2][3] = { { 1.0, 1.0, 0.5 }, { 0.5, 1.0, 1.0 } };
+    for (size_t y = 0u; y < 2u; ++y)
+    {
+        for (size_t x = 0u; x < 2u; ++x)
+        {
+            double sum = 0.0;
+            for (size_t j = 0u; j < 3u; ++j)
+                for (size_t i = 0u; i < 3u; ++i)
+                    sum += w[y][j] * w[x][i] * img[(2u * y + j) * 5u + 2u * x + i];
+            ASSERT_NEAR(sum / 6.25, double(res[y * 2u + x]), 0.5001);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------
+// Averages of black and white texels in linear and sRGB spaces. Alpha stays
+// linear.
+TEST(TestImageKernels, TestSRGB)
+{
+    const unsigned char src[16] =
+    {
+        0u, 0u, 0u, 0u,     255u, 255u, 255u, 255u,
+        255u, 255u, 255u, 255u,   0u, 0u, 0u, 0u,
+    };
+    unsigned char dst[4];
+
+    image::resize(src, 2u, 2u, dst, 1u, 1u, 4u, image::Filter::BOX, false);
+    ASSERT_EQ(128u, dst[0]); ASSERT_EQ(128u, dst[2]); ASSERT_EQ(128u, dst[3]);
+
+    image::resize(src, 2u, 2u, dst, 1u, 1u, 4u, image::Filter::BOX, true);
+    ASSERT_EQ(188u, dst[0]); ASSERT_EQ(188u, dst[1]); ASSERT_EQ(188u, dst[2]);
+    ASSERT_EQ(128u, dst[3]);
+
+    // Luminance + alpha
+    const unsigned char la[4] = { 0u, 0u, 255u, 255u };
+    image::resize(la, 2u, 1u, dst, 1u, 1u, 2u, image::Filter::BOX, true);
+    ASSERT_EQ(188u, dst[0]); ASSERT_EQ(128u, dst[1]);
+
+    // Identity on an sRGB image
+    std::vector<unsigned char> img = noise(7u * 5u * 3u, 3u);
+    std::vector<unsigned char> copy(img.size());
+    image::resize(img.data(), 7u, 5u, copy.data(), 7u, 5u, 3u, image::Filter::BOX, true);
+    ASSERT_EQ(img, copy);
+}
+
+//--------------------------------------------------------------------------
+// Constant images stay constant whatever the filter and the sizes.
+TEST(TestImageKernels, TestConstant)
+{
+    std::vector<unsigned char> src(37u * 23u * 3u, 77u);
+    for (auto filter: { image::Filter::BOX, image::Filter::KAISER })
+    {
+        for (auto size: { std::make_pair(13u, 50u), std::make_pair(18u, 11u),
+                          std::make_pair(1u, 1u), std::make_pair(74u, 46u) })
+        {
+            std::vector<unsigned char> dst(size.first * size.second * 3u, 0u);
+            image::resize(src.data(), 37u, 23u, dst.data(), size.first, size.second,
+                          3u, filter, false);
+            for (auto it: dst)
+            {
+                ASSERT_EQ(77u, it);
+            }
+        }
+    }
+}
+
+//--------------------------------------------------------------------------
+// A checkerboard is above the Nyquist frequency of its mipmap: Kaiser filter
+// shall remove it.
+TEST(TestImageKernels, TestKaiserChecker)
+{
+    const size_t N = 64u;
+    std::vector<unsigned char> src(N * N);
+    for (size_t y = 0u; y < N; ++y)
+        for (size_t x = 0u; x < N; ++x)
+            src[y * N + x] = ((x + y) & 1u) ? 255u : 0u;
+
+    std::vector<unsigned char> dst(N * N / 4u);
+    image::resize(src.data(), N, N, dst.data(), N / 2u, N / 2u, 1u, image::Filter::KAISER, false);
+    for (size_t y = 4u; y < N / 2u - 4u; ++y)
+        for (size_t x = 4u; x < N / 2u - 4u; ++x)
+            ASSERT_NEAR(127.5, double(dst[y * N / 2u + x]), 2.0);
+
+    // Low frequencies are kept: a step stays a step far from the edge
+    for (size_t y = 0u; y < N; ++y)
+        for (size_t x = 0u; x < N; ++x)
+            src[y * N + x] = (x < N / 2u) ? 0u : 255u;
+    image::resize(src.data(), N, N, dst.data(), N / 2u, N / 2u, 1u, image::Filter::KAISER, false);
+    ASSERT_EQ(0u, dst[5u * N / 2u + 4u]);
+    ASSERT_EQ(255u, dst[5u * N / 2u + 27u]);
+}
+
+//--------------------------------------------------------------------------
+// Results do not depend on the number of threads.
+TEST(TestImageKernels, TestThreads)
+{
+    const size_t W = 600u, H = 400u, C = 3u;
+    std::vector<unsigned char> src = noise(W * H * C, 4u);
+    std::vector<unsigned char> a(400u * 300u * C), b(a.size());
+
+    for (auto filter: { image::Filter::BOX, image::Filter::KAISER })
+    {
+        image::resize(src.data(), W, H, a.data(), 400u, 300u, C, filter, true, 1u);
+        image::resize(src.data(), W, H, b.data(), 400u, 300u, C, filter, true, 4u);
+        ASSERT_EQ(a, b);
+    }
+}
+
+//--------------------------------------------------------------------------
+// Threads are reused between calls instead of being created at each call.
+TEST(TestImageKernels, TestThreadPool)
+{
+    const size_t W = 600u, H = 400u, C = 3u;
+    std::vector<unsigned char> src = noise(W * H * C, 5u);
+    std::vector<unsigned char> dst(400u * 300u * C);
+
+    image::resize(src.data(), W, H, dst.data(), 400u, 300u, C,
+                  image::Filter::BOX, false, 4u);
+    size_t const workers = ThreadPool::instance().workers();
+    ASSERT_LE(3_z, workers);
+    for (size_t i = 0u; i < 10u; ++i)
+    {
+        image::resize(src.data(), W, H, dst.data(), 400u, 300u, C,
+                      image::Filter::BOX, false, 4u);
+    }
+    ASSERT_EQ(workers, ThreadPool::instance().workers());
+
+    // Each index is called once. A job calling run() does not wait for the
+    // pool: its jobs are called by its thread.
+    std::vector<std::atomic<size_t>> calls(4u);
+    std::vector<size_t> nested(4u, 0u);
+    ThreadPool::instance().run(4u, [&](size_t const i)
+    {
+        ++calls[i];
+        std::thread::id const id = std::this_thread::get_id();
+        ThreadPool::instance().run(4u, [&](size_t const)
+        {
+            if (std::this_thread::get_id() == id)
+                ++nested[i];
+        });
+    });
+    for (size_t i = 0u; i < 4u; ++i)
+    {
+        ASSERT_EQ(1_z, calls[i].load());
+        ASSERT_EQ(4_z, nested[i]);
+    }
+}
+
+//--------------------------------------------------------------------------
+// Resizing a region gives the same texels than resizing the whole image and
+// does not touch texels outside the region.
+TEST(TestImageKernels, TestRegion)
+{
+    const size_t C = 4u;
+    std::vector<unsigned char> src = noise(50u * 40u * C, 5u);
+    std::vector<unsigned char> full(31u * 17u * C);
+    std::vector<unsigned char> part(full.size(), 0u);
+
+    image::resize(src.data(), 50u, 40u, full.data(), 31u, 17u, C, image::Filter::KAISER, false);
+    image::Rect r = rect(5u, 3u, 10u, 7u);
+    image::resize(src.data(), 50u, 40u, part.data(), 31u, 17u, C, image::Filter::KAISER, false, r);
+    for (size_t y = 0u; y < 17u; ++y)
+    {
+        for (size_t x = 0u; x < 31u; ++x)
+        {
+            for (size_t c = 0u; c < C; ++c)
+            {
+                const size_t i = (y * 31u + x) * C + c;
+                ASSERT_EQ(r.contains(x, y) ? full[i] : 0u, part[i]);
+            }
+        }
+    }
+
+    // Dependents of a texel
+    image::Rect d = image::dependents(64u, 64u, 32u, 32u, image::Filter::BOX, rect(9u, 20u, 1u, 1u));
+    ASSERT_EQ(rect(4u, 10u, 1u, 1u), d);
+    d = image::dependents(64u, 64u, 32u, 32u, image::Filter::KAISER, rect(9u, 20u, 1u, 1u));
+    ASSERT_EQ(true, d.contains(4u, 10u));
+    ASSERT_LT(d.width, 8u);
+    ASSERT_EQ(0_z, image::dependents(64u, 64u, 32u, 32u, image::Filter::BOX, image::Rect()).volume());
+}
+
+//--------------------------------------------------------------------------
+// Regenerating mipmaps covering modified regions gives the same mipmaps than
+// building them again.
+TEST(TestImageKernels, TestIncrementalUpdate)
+{
+    const size_t W = 100u, H = 70u, C = 4u;
+    std::mt19937 rng(6u);
+
+    for (auto filter: { image::Filter::BOX, image::Filter::KAISER })
+    {
+        for (bool srgb: { false, true })
+        {
+            std::vector<unsigned char> base = noise(W * H * C, 7u);
+            image::MipChain chain;
+            chain.build(base.data(), W, H, C, filter, srgb);
+
+            for (size_t frame = 0u; frame < 5u; ++frame)
+            {
+                std::vector<image::Rect> regions;
+                for (size_t n = 1u + rng() % 3u; n > 0u; --n)
+                {
+                    const size_t x = rng() % W, y = rng() % H;
+                    image::Rect r = rect(x, y, 1u + rng() % (W - x), 1u + rng() % std::min(size_t(8u), H - y));
+                    for (size_t j = r.y; j < r.y + r.height; ++j)
+                        for (size_t i = r.x * C; i < (r.x + r.width) * C; ++i)
+                            base[j * W * C + i] = static_cast<unsigned char>(rng());
+                    regions.push_back(r);
+                }
+                chain.update(base.data(), regions);
+                ASSERT_EQ(false, chain.levels()[0].dirty.empty());
+
+                image::MipChain expected;
+                expected.build(base.data(), W, H, C, filter, srgb);
+                ASSERT_EQ(expected.levels().size(), chain.levels().size());
+                for (size_t l = 0u; l < chain.levels().size(); ++l)
+                {
+                    ASSERT_EQ(expected.levels()[l].texels, chain.levels()[l].texels);
+                }
+            }
+        }
+    }
+}
+
+//--------------------------------------------------------------------------
+//! \brief Read back texels of the mipmap level of the texture from the GPU.
+//--------------------------------------------------------------------------
+static std::vector<unsigned char> readback(GLTexture& texture, GLint const level,
+                                           size_t const bytes)
+{
+    std::vector<unsigned char> texels(bytes);
+    glCheck(glBindTexture(texture.m_target, texture.handle()));
+    glCheck(glPixelStorei(GL_PACK_ALIGNMENT, 1));
+    glCheck(glGetTexImage(texture.m_target, level, GL_RGBA, GL_UNSIGNED_BYTE, texels.data()));
+    glCheck(glBindTexture(texture.m_target, 0u));
+    return texels;
+}
+
+//--------------------------------------------------------------------------
+// Mipmaps are uploaded when the texture is setup and updated when texels are
+// modified.
+TEST(TestGLTextureMipmaps, TestTexture2D)
+{
+    OpenGLContext context([]()
+    {
+        const size_t W = 40u, H = 24u;
+        GLTexture2D texture("tex", W, H);
+        texture.mipmaps(true, image::Filter::KAISER);
+        texture.interpolation(GLTexture::Minification::LINEAR_MIPMAP_LINEAR,
+                              GLTexture::Magnification::LINEAR);
+        ASSERT_EQ(true, texture.m_options.generateMipmaps);
+
+        std::vector<unsigned char> texels = noise(W * H * 4u, 8u);
+        texture.data() = texels;
+        texture.begin();
+        texture.end();
+
+        auto check = [&]()
+        {
+            image::MipChain expected;
+            expected.build(texture.data().to_array(), W, H, 4u, image::Filter::KAISER, false);
+            ASSERT_EQ(5_z, texture.mipChain().levels().size());
+            GLint level = 0;
+            for (auto const& it: expected.levels())
+            {
+                ASSERT_EQ(it.texels, texture.mipChain().levels()[size_t(level)].texels);
+                ASSERT_EQ(it.texels, readback(texture, ++level, it.texels.size()));
+            }
+        };
+        check();
+
+        // Paint some texels
+        texture.set(3u, 5u, 0u) = 255u;
+        texture.set(20u, 33u, 2u) = 0u;
+        texture.setPending(10u, 10u, 4u, 4u);
+        texture.begin();
+        texture.end();
+        check();
+        ASSERT_EQ(false, texture.mipChain().levels()[0].dirty.empty());
+
+        // Disabled
+        texture.mipmaps(false);
+        texture.begin();
+        texture.end();
+        ASSERT_EQ(0_z, texture.mipChain().levels().size());
+    });
+}
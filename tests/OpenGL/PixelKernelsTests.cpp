@@ -0,0 +1,795 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+#include "main.hpp"
+#define protected public
+#define private public
+#  include "OpenGL/Textures/PixelKernels.hpp"
+#  include "OpenGL/Textures/Textures.hpp"
+#undef protected
+#undef private
+#  include <algorithm>
+#  include <cmath>
+#  include <limits>
+#  include <random>
+
+//--------------------------------------------------------------------------
+//! \brief Call the function with vectorized code then with scalar code.
+//--------------------------------------------------------------------------
+template<class F>
+static void bothPaths(F const& f)
+{
+    pixel::simd(true);
+    f();
+    pixel::simd(false);
+    f();
+    pixel::simd(true);
+}
+
+//--------------------------------------------------------------------------
+static std::vector<uint8_t> noise(size_t const bytes, unsigned const seed)
+{
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> texels(bytes);
+    for (auto& it: texels)
+        it = static_cast<uint8_t>(rng());
+    return texels;
+}
+
+//--------------------------------------------------------------------------
+static uint32_t bits(float const f)
+{
+    uint32_t b;
+    memcpy(&b, &f, sizeof(b));
+    return b;
+}
+
+//--------------------------------------------------------------------------
+static float fromBits(uint32_t const b)
+{
+    float f;
+    memcpy(&f, &b, sizeof(f));
+    return f;
+}
+
+//--------------------------------------------------------------------------
+//! \brief Scalar reference of the conversion of a float into a half float
+//! computed in double precision.
+//--------------------------------------------------------------------------
+static uint16_t refHalf(float const f)
+{
+    uint16_t const sign = (bits(f) & 0x80000000u) ? 0x8000u : 0u;
+    if (std::isnan(f))
+        return uint16_t(sign | 0x7E00u | ((bits(f) >> 13) & 0x3FFu));
+
+    double const x = std::fabs(double(f));
+    if (x >= 65520.0)
+        return uint16_t(sign | 0x7C00u);
+    if (x < std::ldexp(1.0, -14))
+        return uint16_t(sign | uint16_t(std::nearbyint(std::ldexp(x, 24))));
+
+    int k;
+    std::frexp(x, &k);
+    int e = k - 1;
+    double q = std::nearbyint(std::ldexp(x, 10 - e));
+    if (q == 2048.0)
+    {
+        q = 1024.0;
+        ++e;
+    }
+    if (e + 15 >= 31)
+        return uint16_t(sign | 0x7C00u);
+    return uint16_t(sign | ((e + 15) << 10) | (int(q) - 1024));
+}
+
+//--------------------------------------------------------------------------
+//! \brief Scalar reference of the conversion of a half float into a float.
+//--------------------------------------------------------------------------
+static float refSingle(uint16_t const h)
+{
+    int const e = (h >> 10) & 0x1F;
+    int const m = h & 0x3FF;
+    double const sign = (h & 0x8000u) ? -1.0 : 1.0;
+    if (e == 31)
+    {
+        uint32_t const b = (uint32_t(h & 0x8000u) << 16) | 0x7F800000u
+                         | (uint32_t(m) << 13) | ((m != 0) ? 0x400000u : 0u);
+        return fromBits(b);
+    }
+    if (e == 0)
+        return float(sign * std::ldexp(double(m), -24));
+    return float(sign * std::ldexp(double(1024 + m), e - 25));
+}
+
+//--------------------------------------------------------------------------
+static double srgbDecode(double const c)
+{
+    return (c <= 0.04045) ? (c / 12.92) : std::pow((c + 0.055) / 1.055, 2.4);
+}
+
+//--------------------------------------------------------------------------
+//! \brief Scalar reference of the sRGB encoding: the number of half way
+//! points between codes below the value.
+//--------------------------------------------------------------------------
+static uint8_t refSrgb(float const x)
+{
+    static std::vector<float> const thresholds = []()
+    {
+        std::vector<float> t(255u);
+        for (size_t i = 0u; i < 255u; ++i)
+            t[i] = float(srgbDecode((double(i) + 0.5) / 255.0));
+        return t;
+    }();
+
+    if (!(x > 0.0f))
+        return 0u;
+    return uint8_t(std::lower_bound(thresholds.begin(), thresholds.end(), x)
+                   - thresholds.begin());
+}
+
+//--------------------------------------------------------------------------
+static uint8_t refByte(float const x)
+{
+    if (!(x > 0.0f))
+        return 0u;
+    return uint8_t(std::floor(std::min(x, 1.0f) * 255.0f + 0.5f));
+}
+
+//--------------------------------------------------------------------------
+//! \brief Floats around the rounding points of 8-bits channels and outside
+//! of [0 1].
+//--------------------------------------------------------------------------
+static std::vector<float> unitFloats()
+{
+    std::vector<float> values =
+    {
+        0.0f, -0.0f, 1.0f, -1.0f, 2.0f, 1e-30f, -1e-30f,
+        std::numeric_limits<float>::infinity(),
+        -std::numeric_limits<float>::infinity(),
+        std::numeric_limits<float>::quiet_NaN(),
+        std::numeric_limits<float>::denorm_min(),
+    };
+    for (int k = -100; k <= 4180; ++k)
+        values.push_back(float(k) / 4080.0f);
+    for (int k = 0; k < 256; ++k)
+    {
+        float const mid = (float(k) + 0.5f) / 255.0f;
+        values.push_back(mid);
+        values.push_back(std::nextafter(mid, 0.0f));
+        values.push_back(std::nextafter(mid, 2.0f));
+    }
+    return values;
+}
+
+//--------------------------------------------------------------------------
+TEST(TestPixelKernels, TestSimd)
+{
+    pixel::simd(false);
+    ASSERT_STREQ("none", pixel::simd());
+    pixel::simd(true);
+    std::cout << "Pixel kernels use: " << pixel::simd() << std::endl;
+}
+
+//--------------------------------------------------------------------------
+TEST(TestPixelKernels, TestSwizzleExhaustive)
+{
+    bothPaths([]()
+    {
+        // All swizzles between all numbers of channels on a number of texels
+        // not multiple of vector sizes and a misaligned source.
+        const size_t count = 67u;
+        std::vector<uint8_t> const src = noise(4u * count + 1u, 1u);
+        std::vector<uint8_t> dst(4u * count + 16u), ref(4u * count + 16u);
+
+        for (size_t sc = 1u; sc <= 4u; ++sc)
+        {
+            for (size_t dc = 1u; dc <= 4u; ++dc)
+            {
+                size_t const choices = sc + 2u;
+                size_t combinations = 1u;
+                for (size_t c = 0u; c < dc; ++c)
+                    combinations *= choices;
+
+                for (size_t k = 0u; k < combinations; ++k)
+                {
+                    pixel::Swizzle map = {{ 0u, 0u, 0u, 0u }};
+                    size_t n = k;
+                    for (size_t c = 0u; c < dc; ++c, n /= choices)
+                    {
+                        size_t const m = n % choices;
+                        map[c] = uint8_t((m < sc) ? m : ((m == sc) ? pixel::ZERO : pixel::ONE));
+                    }
+
+                    for (size_t t = 0u; t < count; ++t)
+                    {
+                        for (size_t c = 0u; c < dc; ++c)
+                        {
+                            uint8_t const m = map[c];
+                            ref[t * dc + c] = (m < sc) ? src[1u + t * sc + m]
+                                              : ((m == pixel::ONE) ? 255u : 0u);
+                        }
+                    }
+
+                    // Bytes after the destination are not written
+                    std::fill(dst.begin(), dst.end(), 0xA5u);
+                    std::fill(ref.begin() + long(count * dc), ref.end(), 0xA5u);
+                    pixel::swizzle(src.data() + 1u, sc, dst.data(), dc, map, count);
+                    ASSERT_EQ(ref, dst) << sc << " -> " << dc << " swizzle " << k;
+                }
+            }
+        }
+    });
+}
+
+//--------------------------------------------------------------------------
+TEST(TestPixelKernels, TestSwizzleCommon)
+{
+    const uint8_t rgb[6] = { 1u, 2u, 3u, 4u, 5u, 6u };
+    uint8_t rgba[8];
+    pixel::swizzle(rgb, 3u, rgba, 4u, {{ 2u, 1u, 0u, pixel::ONE }}, 2u);
+    ASSERT_EQ(std::vector<uint8_t>({ 3u, 2u, 1u, 255u, 6u, 5u, 4u, 255u }),
+              std::vector<uint8_t>(rgba, rgba + 8));
+
+    uint8_t back[6];
+    pixel::swizzle(rgba, 4u, back, 3u, {{ 2u, 1u, 0u, 0u }}, 2u);
+    ASSERT_EQ(std::vector<uint8_t>(rgb, rgb + 6), std::vector<uint8_t>(back, back + 6));
+
+    // Nothing to convert
+    pixel::swizzle(rgb, 3u, back, 3u, {{ 0u, 1u, 2u, 0u }}, 0u);
+}
+
+//--------------------------------------------------------------------------
+TEST(TestPixelKernels, TestPremultiplyExhaustive)
+{
+    bothPaths([]()
+    {
+        // All pairs of channel and alpha values, for 4 and 2 channels
+        for (size_t channels: { 2u, 4u })
+        {
+            std::vector<uint8_t> texels(65536u * channels);
+            for (size_t i = 0u; i < 65536u; ++i)
+            {
+                for (size_t c = 0u; c + 1u < channels; ++c)
+                    texels[i * channels + c] = uint8_t((i & 0xFFu) ^ (c * 0x55u));
+                texels[i * channels + channels - 1u] = uint8_t(i >> 8);
+            }
+
+            std::vector<uint8_t> res(texels);
+            pixel::premultiply(res.data(), channels, 65535u); // Tail texel
+            pixel::premultiply(res.data() + 65535u * channels, channels, 1u);
+            for (size_t i = 0u; i < texels.size(); ++i)
+            {
+                size_t const a = texels[(i / channels) * channels + channels - 1u];
+                uint8_t const expected = ((i % channels) == channels - 1u) ? uint8_t(a)
+                    : uint8_t(std::lround(double(texels[i]) * double(a) / 255.0));
+                ASSERT_EQ(expected, res[i]) << "texel " << i / channels;
+            }
+        }
+
+        // No alpha channel: not modified
+        std::vector<uint8_t> rgb = noise(300u, 2u);
+        std::vector<uint8_t> const copy(rgb);
+        pixel::premultiply(rgb.data(), 3u, 100u);
+        ASSERT_EQ(copy, rgb);
+
+        // Floats
+        std::vector<float> f(4u * 37u), g;
+        for (size_t i = 0u; i < f.size(); ++i)
+            f[i] = float(i) / 97.0f;
+        g = f;
+        pixel::premultiply(g.data(), 4u, 37u);
+        for (size_t i = 0u; i < f.size(); ++i)
+        {
+            float const a = f[(i / 4u) * 4u + 3u];
+            ASSERT_EQ(bits(((i % 4u) == 3u) ? a : f[i] * a), bits(g[i]));
+        }
+    });
+}
+
+//--------------------------------------------------------------------------
+TEST(TestPixelKernels, TestByteFloat)
+{
+    bothPaths([]()
+    {
+        // All 8-bits values, at all positions inside vectors
+        std::vector<uint8_t> src(256u + 37u);
+        for (size_t i = 0u; i < src.size(); ++i)
+            src[i] = uint8_t(i * 7u);
+        std::vector<float> dst(src.size());
+        pixel::toFloat(src.data(), dst.data(), src.size());
+        for (size_t i = 0u; i < src.size(); ++i)
+            ASSERT_EQ(bits(float(src[i]) / 255.0f), bits(dst[i]));
+
+        // Back to bytes without loss
+        std::vector<uint8_t> back(src.size());
+        pixel::toByte(dst.data(), back.data(), dst.size());
+        ASSERT_EQ(src, back);
+
+        // Rounding, clamping and NaN
+        std::vector<float> const values = unitFloats();
+        std::vector<uint8_t> bytes(values.size());
+        pixel::toByte(values.data(), bytes.data(), values.size());
+        for (size_t i = 0u; i < values.size(); ++i)
+            ASSERT_EQ(refByte(values[i]), bytes[i]) << values[i];
+    });
+}
+
+//--------------------------------------------------------------------------
+TEST(TestPixelKernels, TestHalfToFloatExhaustive)
+{
+    bothPaths([]()
+    {
+        std::vector<uint16_t> halves(65536u + 3u);
+        for (size_t i = 0u; i < halves.size(); ++i)
+            halves[i] = uint16_t(i);
+        std::vector<float> floats(halves.size());
+        pixel::toFloat(halves.data(), floats.data(), halves.size());
+        for (size_t i = 0u; i < halves.size(); ++i)
+            ASSERT_EQ(bits(refSingle(halves[i])), bits(floats[i])) << "half " << i;
+    });
+}
+
+//--------------------------------------------------------------------------
+TEST(TestPixelKernels, TestFloatToHalf)
+{
+    // Every rounding point: each half, the middle between each pair of
+    // consecutive halves and the floats next to them. Then a sampling of all
+    // float bit patterns.
+    std::vector<float> values;
+    for (uint32_t h = 0u; h < 0x7C00u; ++h)
+    {
+        for (float const sign: { 1.0f, -1.0f })
+        {
+            float const a = sign * refSingle(uint16_t(h));
+            float const b = sign * ((h + 1u == 0x7C00u) ? 65536.0f : refSingle(uint16_t(h + 1u)));
+            float const mid = float((double(a) + double(b)) / 2.0);
+            values.insert(values.end(), { a, mid, std::nextafter(mid, a), std::nextafter(mid, b) });
+        }
+    }
+    for (uint64_t b = 0u; b <= 0xFFFFFFFFu; b += 4093u)
+        values.push_back(fromBits(uint32_t(b)));
+    values.insert(values.end(), { std::numeric_limits<float>::infinity(),
+                                  -std::numeric_limits<float>::infinity(),
+                                  fromBits(0x7F800001u), fromBits(0xFFC01234u),
+                                  std::numeric_limits<float>::max() });
+
+    bothPaths([&values]()
+    {
+        std::vector<uint16_t> halves(values.size());
+        pixel::toHalf(values.data(), halves.data(), values.size());
+        for (size_t i = 0u; i < values.size(); ++i)
+        {
+            ASSERT_EQ(refHalf(values[i]), halves[i])
+                    << std::hex << "float 0x" << bits(values[i]);
+        }
+    });
+}
+
+//--------------------------------------------------------------------------
+TEST(TestPixelKernels, TestSrgb)
+{
+    bothPaths([]()
+    {
+        // Decoding: all codes for all numbers of channels. Alpha is linear.
+        for (size_t channels = 1u; channels <= 4u; ++channels)
+        {
+            std::vector<uint8_t> src(256u * channels);
+            for (size_t i = 0u; i < src.size(); ++i)
+                src[i] = uint8_t(i / channels);
+            std::vector<float> linear(src.size());
+            pixel::srgbToLinear(src.data(), linear.data(), channels, 256u);
+            bool const alpha = (channels == 2u) || (channels == 4u);
+            for (size_t i = 0u; i < src.size(); ++i)
+            {
+                float const expected = (alpha && ((i % channels) == channels - 1u))
+                        ? float(src[i]) / 255.0f
+                        : float(srgbDecode(double(src[i]) / 255.0));
+                ASSERT_EQ(bits(expected), bits(linear[i]));
+            }
+
+            // Encoding gives back the codes
+            std::vector<uint8_t> back(src.size());
+            pixel::linearToSrgb(linear.data(), back.data(), channels, 256u);
+            ASSERT_EQ(src, back);
+        }
+
+        // Encoding: values around all half way points between codes
+        std::vector<float> values = unitFloats();
+        for (size_t i = 0u; i < 255u; ++i)
+        {
+            float const t = float(srgbDecode((double(i) + 0.5) / 255.0));
+            values.insert(values.end(), { t, std::nextafter(t, 0.0f), std::nextafter(t, 1.0f) });
+        }
+        for (size_t k = 0u; k <= 100000u; ++k)
+            values.push_back(float(k) / 100000.0f);
+
+        std::vector<uint8_t> codes(values.size());
+        pixel::linearToSrgb(values.data(), codes.data(), 1u, values.size());
+        for (size_t i = 0u; i < values.size(); ++i)
+        {
+            ASSERT_EQ(refSrgb(values[i]), codes[i]) << values[i];
+
+            // Nearest code in sRGB space (up to the float precision)
+            if ((values[i] >= 0.0f) && (values[i] <= 1.0f))
+            {
+                double const x = values[i];
+                double const s = (x <= 0.0031308) ? (12.92 * x) : (1.055 * std::pow(x, 1.0 / 2.4) - 0.055);
+                ASSERT_LE(std::fabs(255.0 * s - codes[i]), 0.5 + 1e-3);
+            }
+        }
+    });
+}
+
+//--------------------------------------------------------------------------
+//! \brief Fake loader decoding noise, or the given picture, into a single
+//! pixel format.
+//--------------------------------------------------------------------------
+class NoiseLoader: public TextureLoader
+{
+public:
+
+    virtual bool setPixelFormat(GLTexture::PixelFormat const pixelformat) override
+    {
+        return pixelformat == decoded;
+    }
+
+    virtual GLenum getPixelType() const override
+    {
+        return GL_UNSIGNED_BYTE;
+    }
+
+    virtual size_t getPixelCount() const override
+    {
+        return (decoded == GLTexture::PixelFormat::RGBA) ? 4u : 3u;
+    }
+
+    virtual bool load(std::string const&, GLTexture::Buffer& buffer,
+                      size_t& width, size_t& height) override
+    {
+        width = 50u; height = 30u;
+        std::vector<uint8_t> const texels = picture.empty()
+                ? noise(width * height * getPixelCount(), 7u) : picture;
+        memcpy(buffer.extend(texels.size()), texels.data(), texels.size());
+        return true;
+    }
+
+    virtual bool save(std::string const&, GLTexture::Buffer const&,
+                      size_t const, size_t const) override
+    {
+        return false;
+    }
+
+    static GLTexture::PixelFormat decoded;
+    static std::vector<uint8_t> picture;
+};
+
+GLTexture::PixelFormat NoiseLoader::decoded = GLTexture::PixelFormat::RGBA;
+std::vector<uint8_t> NoiseLoader::picture;
+
+//--------------------------------------------------------------------------
+TEST(TestPixelKernels, TestTextureLoader)
+{
+    OpenGLContext context([]()
+    {
+        NoiseLoader::decoded = GLTexture::PixelFormat::RGBA;
+        std::vector<uint8_t> const rgba = noise(50u * 30u * 4u, 7u);
+        size_t const count = 50u * 30u;
+
+        // Reordered channels
+        GLTexture2D bgra("bgra");
+        bgra.setPixelFormat(GLTexture::PixelFormat::BGRA);
+        ASSERT_EQ(GL_RGBA8, bgra.m_gpuPixelFormat);
+        ASSERT_EQ(true, bgra.load<NoiseLoader>("noise.png"));
+        ASSERT_EQ(count * 4u, bgra.m_buffer.size());
+        for (size_t i = 0u; i < count * 4u; i += 4u)
+        {
+            ASSERT_EQ(rgba[i + 2u], bgra.m_buffer[i + 0u]);
+            ASSERT_EQ(rgba[i + 1u], bgra.m_buffer[i + 1u]);
+            ASSERT_EQ(rgba[i + 0u], bgra.m_buffer[i + 2u]);
+            ASSERT_EQ(rgba[i + 3u], bgra.m_buffer[i + 3u]);
+        }
+        bgra.begin();
+        std::vector<unsigned char> texels(bgra.m_buffer.size());
+        glCheck(glGetTexImage(GL_TEXTURE_2D, 0, GL_BGRA, GL_UNSIGNED_BYTE, texels.data()));
+        bgra.end();
+        ASSERT_EQ(bgra.m_buffer.data(), texels);
+
+        // Stripped alpha
+        GLTexture2D rgb("rgb");
+        rgb.setPixelFormat(GLTexture::PixelFormat::RGB);
+        ASSERT_EQ(true, rgb.load<NoiseLoader>("noise.png"));
+        ASSERT_EQ(3u, rgb.m_cpuPixelCount);
+        for (size_t i = 0u; i < count; ++i)
+        {
+            for (size_t c = 0u; c < 3u; ++c)
+                ASSERT_EQ(rgba[i * 4u + c], rgb.m_buffer[i * 3u + c]);
+        }
+
+        // Premultiplied in place
+        std::vector<uint8_t> premultiplied(rgba);
+        pixel::premultiply(premultiplied.data(), 4u, count);
+        GLTexture2D pre("pre");
+        pre.setPixelFormat(GLTexture::PixelFormat::RGBA, GL_UNSIGNED_BYTE, true);
+        ASSERT_EQ(true, pre.load<NoiseLoader>("noise.png"));
+        ASSERT_EQ(premultiplied, pre.m_buffer.data());
+
+        // sRGB decoded to linear floats
+        std::vector<float> linear(count * 4u);
+        pixel::srgbToLinear(rgba.data(), linear.data(), 4u, count);
+        GLTextureFloat2D f("f");
+        ASSERT_EQ(true, f.load<NoiseLoader>("noise.png"));
+        ASSERT_EQ(GLenum(GL_FLOAT), f.m_cpuPixelType);
+        ASSERT_EQ(count * 4u * sizeof(float), f.m_buffer.size());
+        ASSERT_EQ(0, memcmp(linear.data(), f.m_buffer.to_array(), f.m_buffer.size()));
+        f.begin();
+        std::vector<float> floats(count * 4u);
+        glCheck(glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, floats.data()));
+        f.end();
+        ASSERT_EQ(linear, floats);
+
+        // Premultiplied half floats
+        pixel::premultiply(linear.data(), 4u, count);
+        std::vector<uint16_t> halves(count * 4u);
+        pixel::toHalf(linear.data(), halves.data(), halves.size());
+        GLTexture2D h("h");
+        h.setPixelFormat(GLTexture::PixelFormat::RGBA, GL_HALF_FLOAT, true);
+        ASSERT_EQ(GL_RGBA16F, h.m_gpuPixelFormat);
+        ASSERT_EQ(true, h.load<NoiseLoader>("noise.png"));
+        ASSERT_EQ(0, memcmp(halves.data(), h.m_buffer.to_array(), h.m_buffer.size()));
+
+        // Added alpha
+        NoiseLoader::decoded = GLTexture::PixelFormat::RGB;
+        std::vector<uint8_t> const rgb8 = noise(count * 3u, 7u);
+        GLTexture2D a("a");
+        a.setPixelFormat(GLTexture::PixelFormat::BGRA);
+        ASSERT_EQ(true, a.load<NoiseLoader>("noise.png"));
+        for (size_t i = 0u; i < count; ++i)
+        {
+            ASSERT_EQ(rgb8[i * 3u + 2u], a.m_buffer[i * 4u + 0u]);
+            ASSERT_EQ(rgb8[i * 3u + 1u], a.m_buffer[i * 4u + 1u]);
+            ASSERT_EQ(rgb8[i * 3u + 0u], a.m_buffer[i * 4u + 2u]);
+            ASSERT_EQ(255u, a.m_buffer[i * 4u + 3u]);
+        }
+
+        // No conversion from the decoded format
+        GLTexture2D red("red");
+        red.setPixelFormat(GLTexture::PixelFormat::RED, GL_FLOAT);
+        ASSERT_EQ(false, red.load<NoiseLoader>("noise.png"));
+
+        // Invalid format and texels already loaded
+        GLTexture2D l("l");
+        ASSERT_THROW(l.setPixelFormat(GLTexture::PixelFormat::LUMINANCE, GL_FLOAT),
+                     GL::Exception);
+        ASSERT_THROW(a.setPixelFormat(GLTexture::PixelFormat::RGBA), GL::Exception);
+    });
+}
+
+//--------------------------------------------------------------------------
+//! \brief Synthetic picture of 50 x 30 texels given by f(texel, channel).
+//--------------------------------------------------------------------------
+template<class F>
+static std::vector<uint8_t> picture(size_t const channels, F const& f)
+{
+    std::vector<uint8_t> texels(50u * 30u * channels);
+    for (size_t i = 0u; i < texels.size(); ++i)
+        texels[i] = static_cast<uint8_t>(f(i / channels, i % channels));
+    return texels;
+}
+
+//--------------------------------------------------------------------------
+//! \brief Is the 8-bits value kept when reduced to max + 1 levels then
+//! expanded, whether the GPU rounds, truncates or replicates bits ?
+//--------------------------------------------------------------------------
+static bool kept(unsigned const v, unsigned const max)
+{
+    unsigned const bits = (max == 31u) ? 5u : 6u;
+    long const q = std::lround(v * double(max) / 255.0);
+    return (std::lround(double(q) * 255.0 / max) == long(v)) &&
+           (long(v >> (8u - bits)) == q) &&
+           (long((q << (8u - bits)) | (q >> (2u * bits - 8u))) == long(v));
+}
+
+//--------------------------------------------------------------------------
+static std::vector<uint8_t> keptValues(unsigned const max)
+{
+    std::vector<uint8_t> values;
+    for (unsigned v = 0u; v < 256u; ++v)
+    {
+        if (kept(v, max))
+            values.push_back(uint8_t(v));
+    }
+    return values;
+}
+
+//--------------------------------------------------------------------------
+TEST(TestPixelKernels, TestAnalyze)
+{
+    std::vector<uint8_t> const rgba = noise(50u * 30u * 4u, 3u);
+    size_t const count = 50u * 30u;
+
+    // Values kept by 5 and 6 bits, compared with a floating point reference
+    for (unsigned v = 0u; v < 256u; ++v)
+    {
+        std::vector<uint8_t> const red = { uint8_t(v), 0u, 0u };
+        std::vector<uint8_t> const green = { 0u, uint8_t(v), 0u };
+        ASSERT_EQ(kept(v, 31u), pixel::analyze(red.data(), 3u, 1u).rgb565) << v;
+        ASSERT_EQ(kept(v, 63u), pixel::analyze(green.data(), 3u, 1u).rgb565) << v;
+    }
+    ASSERT_EQ(28_z, keptValues(31u).size());
+    ASSERT_EQ(54_z, keptValues(63u).size());
+
+    // Colored and transparent
+    pixel::Content c = pixel::analyze(rgba.data(), 4u, count);
+    ASSERT_EQ(false, c.opaque);
+    ASSERT_EQ(false, c.grey);
+    ASSERT_EQ(false, c.uniform);
+    ASSERT_EQ(false, c.rgb565);
+
+    // Colored and opaque
+    std::vector<uint8_t> texels = picture(4u, [&](size_t i, size_t k)
+    {
+        return (k == 3u) ? 255u : rgba[i * 4u + k];
+    });
+    c = pixel::analyze(texels.data(), 4u, count);
+    ASSERT_EQ(true, c.opaque);
+    ASSERT_EQ(false, c.grey);
+    ASSERT_EQ(false, c.rgb565);
+
+    // Greyscale and transparent
+    texels = picture(4u, [&](size_t i, size_t k)
+    {
+        return (k == 3u) ? rgba[i * 4u + 3u] : rgba[i * 4u];
+    });
+    c = pixel::analyze(texels.data(), 4u, count);
+    ASSERT_EQ(false, c.opaque);
+    ASSERT_EQ(true, c.grey);
+    ASSERT_EQ(false, c.uniform);
+
+    // Mask: constant color
+    texels = picture(4u, [&](size_t i, size_t k)
+    {
+        return (k == 3u) ? rgba[i * 4u + 3u] : ((k == 1u) ? 0u : 255u);
+    });
+    c = pixel::analyze(texels.data(), 4u, count);
+    ASSERT_EQ(false, c.opaque);
+    ASSERT_EQ(true, c.uniform);
+    ASSERT_EQ(255u, c.color[0]);
+    ASSERT_EQ(0u, c.color[1]);
+    ASSERT_EQ(255u, c.color[2]);
+
+    // 5-6-5 bits RGB
+    std::vector<uint8_t> const kept5 = keptValues(31u), kept6 = keptValues(63u);
+    texels = picture(3u, [&](size_t i, size_t k)
+    {
+        std::vector<uint8_t> const& values = (k == 1u) ? kept6 : kept5;
+        return values[rgba[i * 3u + k] % values.size()];
+    });
+    c = pixel::analyze(texels.data(), 3u, count);
+    ASSERT_EQ(true, c.opaque);
+    ASSERT_EQ(true, c.rgb565);
+    texels[count * 3u - 1u] ^= 1u;
+    ASSERT_EQ(false, pixel::analyze(texels.data(), 3u, count).rgb565);
+
+    // Properties broken by the last texel of a big picture
+    std::vector<uint8_t> grey(100000u * 2u, 255u);
+    c = pixel::analyze(grey.data(), 2u, 100000u);
+    ASSERT_EQ(true, c.opaque && c.grey && c.uniform);
+    ASSERT_EQ(false, c.rgb565);
+    grey.back() = 0u;
+    ASSERT_EQ(false, pixel::analyze(grey.data(), 2u, 100000u).opaque);
+
+    // No texels
+    c = pixel::analyze(nullptr, 4u, 0u);
+    ASSERT_EQ(true, c.opaque && c.grey && c.uniform && c.rgb565);
+}
+
+//--------------------------------------------------------------------------
+TEST(TestPixelKernels, TestDownsize)
+{
+    OpenGLContext context([]()
+    {
+        NoiseLoader::decoded = GLTexture::PixelFormat::RGBA;
+        std::vector<uint8_t> const rgba = noise(50u * 30u * 4u, 5u);
+        size_t const count = 50u * 30u;
+        GLTexture::Options options;
+        options.downsize = true;
+
+        // Load the picture, check the format and what shaders sample
+        auto check = [&](std::vector<uint8_t> const& texels, GLint const format,
+                         size_t const channels, std::array<GLint, 4u> const& swizzle)
+        {
+            NoiseLoader::picture = texels;
+            size_t const memory = GPUMemory();
+            GLTexture2D texture("texture");
+            texture.options(options);
+            ASSERT_EQ(true, texture.load<NoiseLoader>("picture.png"));
+            ASSERT_EQ(format, texture.m_gpuPixelFormat);
+            ASSERT_EQ(channels, texture.m_cpuPixelCount);
+            ASSERT_EQ(count * channels, texture.m_buffer.size());
+            ASSERT_EQ(swizzle, texture.swizzle());
+            size_t const bytes = count * ((format == GL_RGB565) ? 2u : channels);
+            ASSERT_EQ(bytes, texture.gpuBytes());
+            ASSERT_EQ(memory + bytes, size_t(GPUMemory()));
+
+            texture.begin();
+            GLint internal = 0;
+            glCheck(glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &internal));
+            ASSERT_EQ(format, internal);
+            std::vector<uint8_t> sampled(count * 4u);
+            glCheck(glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, sampled.data()));
+            texture.end();
+
+            // glGetTexImage() ignores the swizzle: apply it
+            for (size_t i = 0u; i < count; ++i)
+            {
+                for (size_t k = 0u; k < 4u; ++k)
+                {
+                    GLint const s = swizzle[k];
+                    uint8_t const expected = (s == GL_ZERO) ? 0u : ((s == GL_ONE) ? 255u
+                                           : sampled[i * 4u + size_t(s - GL_RED)]);
+                    ASSERT_EQ(texels[i * 4u + k], expected) << i << " " << k;
+                }
+            }
+
+            // Released or loaded again: back to the requested format
+            NoiseLoader::picture.clear();
+            ASSERT_EQ(true, texture.load<NoiseLoader>("picture.png"));
+            ASSERT_EQ(GL_RGBA8, texture.m_gpuPixelFormat);
+            texture.release();
+            ASSERT_EQ(memory, size_t(GPUMemory()));
+        };
+
+        // Mask
+        check(picture(4u, [&](size_t i, size_t k) { return (k == 3u) ? rgba[i * 4u] : 255u; }),
+              GL_R8, 1u, {{ GL_ONE, GL_ONE, GL_ONE, GL_RED }});
+        // Opaque greyscale
+        check(picture(4u, [&](size_t i, size_t k) { return (k == 3u) ? 255u : rgba[i * 4u]; }),
+              GL_R8, 1u, {{ GL_RED, GL_RED, GL_RED, GL_ONE }});
+        // Greyscale
+        check(picture(4u, [&](size_t i, size_t k) { return (k == 3u) ? rgba[i * 4u + 3u] : rgba[i * 4u]; }),
+              GL_RG8, 2u, {{ GL_RED, GL_RED, GL_RED, GL_GREEN }});
+        // Opaque 5-6-5 bits
+        std::vector<uint8_t> const kept5 = keptValues(31u), kept6 = keptValues(63u);
+        check(picture(4u, [&](size_t i, size_t k)
+              {
+                  std::vector<uint8_t> const& values = (k == 1u) ? kept6 : kept5;
+                  return (k == 3u) ? 255u : values[rgba[i * 4u + k] % values.size()];
+              }),
+              GL_RGB565, 3u, {{ GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA }});
+        // Opaque
+        check(picture(4u, [&](size_t i, size_t k) { return (k == 3u) ? 255u : rgba[i * 4u + k]; }),
+              GL_RGB8, 3u, {{ GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA }});
+
+        // Nothing to save: unchanged
+        NoiseLoader::picture = rgba;
+        GLTexture2D texture("texture");
+        texture.options(options);
+        ASSERT_EQ(true, texture.load<NoiseLoader>("picture.png"));
+        ASSERT_EQ(GL_RGBA8, texture.m_gpuPixelFormat);
+        ASSERT_EQ(false, texture.m_downsized);
+
+        // Not asked
+        NoiseLoader::picture = picture(4u, [&](size_t i, size_t k) { return (k == 3u) ? 255u : rgba[i * 4u]; });
+        GLTexture2D kept("kept");
+        ASSERT_EQ(true, kept.load<NoiseLoader>("picture.png"));
+        ASSERT_EQ(GL_RGBA8, kept.m_gpuPixelFormat);
+        NoiseLoader::picture.clear();
+    });
+}
@@ -0,0 +1,160 @@
+//=====================================================================
+// OpenGLCppWrapper: A C++11 OpenGL 'Core' wrapper.
+// Copyright 2018-2022 Quentin Quadrat <lecrapouille@gmail.com>
+//
+// This file is part of OpenGLCppWrapper.
+//
+// OpenGLCppWrapper is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// OpenGLCppWrapper is distributedin the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with OpenGLCppWrapper.  If not, see <http://www.gnu.org/licenses/>.
+//=====================================================================
+
+// Scene headers are included before main.hpp: Key from Common/ClassCounter.hpp
+// is ambiguous with testing::Key once "using namespace ::testing" is made.
+#include <gmock/gmock.h>
+#define protected public
+#define private public
+#  include "Scene/ShapeNode.hpp"
+#  include "Scene/Geometry/Box.hpp"
+#  include "Scene/Material/MeshBasicMaterial.hpp"
+#  include "Scene/Material/DepthMaterial.hpp"
+#  include "Scene/Material/ProgramRegistry.hpp"
+#undef protected
+#undef private
+#include "main.hpp"
+
+using BoxShape = Shape<Box, BasicMaterial>;
+
+//--------------------------------------------------------------------------
+TEST(TestProgramRegistry, TestMaterialUniforms)
+{
+    MaterialUniforms uniforms;
+
+    ASSERT_EQ(false, uniforms.has<float>("opacity"));
+    uniforms.scalarf("opacity") = 0.5f;
+    ASSERT_EQ(true, uniforms.has<float>("opacity"));
+    ASSERT_EQ(false, uniforms.has<Vector3f>("opacity"));
+    ASSERT_EQ(0.5f, uniforms.scalarf("opacity"));
+    ASSERT_THROW(uniforms.vector3f("opacity"), GL::Exception);
+}
+
+//--------------------------------------------------------------------------
+//! \brief Material whose shaders have uniforms set by no init().
+//--------------------------------------------------------------------------
+class TintMaterial : public Material
+{
+public:
+
+    TintMaterial(GLVAO& vao)
+        : Material("TintMaterial", vao)
+    {}
+
+private:
+
+    virtual void generate(GLVertexShader& vert, GLFragmentShader& frag) override
+    {
+        vert << "#version 330 core\n"
+                "layout(location = 0) in vec3 position;\n"
+                "uniform float scale;\n"
+                "void main() { gl_Position = vec4(scale * position, 1.0); }\n";
+        frag << "#version 330 core\n"
+                "uniform vec3 tint;\n"
+                "out vec4 color;\n"
+                "void main() { color = vec4(tint, 1.0); }\n";
+    }
+};
+
+//--------------------------------------------------------------------------
+// Two materials share a program but only one sets the uniforms: the other
+// one shall not inherit its values.
+TEST(TestProgramRegistry, TestUnsetUniforms)
+{
+    OpenGLContext context([]()
+    {
+        GLVAO vao("vao");
+        TintMaterial first(vao);
+        TintMaterial second(vao);
+        ASSERT_EQ(true, first.compile());
+        ASSERT_EQ(true, second.compile());
+        ASSERT_EQ(&first.program(), &second.program());
+
+        first.uniforms.vector3f("tint") = Vector3f(1.0f, 0.5f, 0.25f);
+        first.uniforms.scalarf("scale") = 2.0f;
+        ASSERT_EQ(true, second.uniforms.has<Vector3f>("tint"));
+        ASSERT_EQ(true, second.uniforms.has<float>("scale"));
+
+        GLProgram& program = first.program();
+        first.apply();
+        ASSERT_EQ(1.0f, program.vector3f("tint").x);
+        ASSERT_EQ(2.0f, program.scalarf("scale"));
+        second.apply();
+        ASSERT_EQ(0.0f, program.vector3f("tint").x);
+        ASSERT_EQ(0.0f, program.scalarf("scale"));
+        first.apply();
+        ASSERT_EQ(0.25f, program.vector3f("tint").z);
+    });
+}
+
+//--------------------------------------------------------------------------
+// 1000 shapes with the same material configuration share a single program.
+TEST(TestProgramRegistry, TestIdenticalShapes)
+{
+    OpenGLContext context([]()
+    {
+        ProgramRegistry& registry = ProgramRegistry::instance();
+        ASSERT_EQ(0_z, registry.size());
+        size_t const created = registry.created();
+
+        {
+            std::vector<BoxShape::Ptr> shapes;
+            for (size_t i = 0u; i < 1000u; ++i)
+            {
+                shapes.push_back(std::make_unique<BoxShape>("box" + std::to_string(i)));
+                ASSERT_EQ(true, shapes.back()->compile());
+            }
+
+            ASSERT_EQ(1_z, registry.size());
+            ASSERT_EQ(created + 1u, registry.created());
+
+            GLProgram& program = shapes[0]->material.program();
+            for (auto const& it: shapes)
+            {
+                ASSERT_EQ(&program, &(it->material.program()));
+                ASSERT_EQ(true, it->m_vao.isBound());
+            }
+            ASSERT_EQ(1000, shapes[0]->material.m_program.use_count());
+
+            // Per-object values are kept by materials and uploaded to the
+            // shared program when drawing.
+            shapes[0]->material.diffuse() = Vector3f(1.0f, 0.0f, 0.0f);
+            shapes[1]->material.diffuse() = Vector3f(0.0f, 1.0f, 0.0f);
+            ASSERT_EQ(1.0f, shapes[0]->material.diffuse().x);
+            ASSERT_EQ(1.0f, shapes[1]->material.diffuse().y);
+
+            shapes[0]->material.apply();
+            ASSERT_EQ(1.0f, program.vector3f("diffuse").x);
+            ASSERT_EQ(0.0f, program.vector3f("diffuse").y);
+            shapes[1]->material.apply();
+            ASSERT_EQ(0.0f, program.vector3f("diffuse").x);
+            ASSERT_EQ(1.0f, program.vector3f("diffuse").y);
+
+            // Different configuration: different program
+            DepthMaterial depth(shapes[0]->m_vao);
+            ASSERT_EQ(true, depth.compile());
+            ASSERT_NE(&program, &(depth.program()));
+            ASSERT_EQ(2_z, registry.size());
+        }
+
+        // Programs are released with their last material
+        ASSERT_EQ(0_z, registry.size());
+    });
+}